@@ -130,6 +130,7 @@ AC_DEFUN([DOVECOT_SSL], [
   DOVECOT_CHECK_SSL_FUNC([SSL_CTX_set_ciphersuites])
   DOVECOT_CHECK_SSL_FUNC([SSL_CTX_set_ecdh_auto])
   DOVECOT_CHECK_SSL_FUNC([SSL_CTX_set_min_proto_version])
+  DOVECOT_CHECK_SSL_FUNC([SSL_CTX_set_tlsext_ticket_key_evp_cb])
   DOVECOT_CHECK_SSL_FUNC([SSL_CTX_set_tmp_dh_callback])
   DOVECOT_CHECK_SSL_FUNC([SSL_CTX_set_tmp_rsa_callback])
   DOVECOT_CHECK_SSL_FUNC([SSL_get1_peer_certificate])
@@ -12,15 +12,22 @@
 
 #include <time.h>
 
+struct auth_cache_pending {
+	char *key;
+	ARRAY_TYPE(auth_cache_waiters) waiters;
+};
+
 struct auth_cache {
 	HASH_TABLE(char *, struct auth_cache_node *) hash;
+	/* expanded cache keys whose passdb lookup is currently in flight */
+	HASH_TABLE(char *, struct auth_cache_pending *) pending;
 	struct auth_cache_node *head, *tail;
 	struct event *event;
 
 	size_t max_size, size_left;
 	unsigned int ttl_secs, neg_ttl_secs;
 
-	unsigned int hit_count, miss_count;
+	unsigned int hit_count, miss_count, wait_count;
 	unsigned int pos_entries, neg_entries;
 	unsigned long long pos_size, neg_size;
 };
@@ -204,9 +211,11 @@ static void sig_auth_cache_stats(const siginfo_t *si ATTR_UNUSED, void *context)
 	size_t cache_used;
 
 	total_count = cache->hit_count + cache->miss_count;
-	e_info(cache->event, "Authentication cache hits %u/%u (%u%%)",
+	e_info(cache->event, "Authentication cache hits %u/%u (%u%%), "
+	       "%u waited for an in-flight lookup",
 	       cache->hit_count, total_count,
-	       total_count == 0 ? 100 : (cache->hit_count * 100 / total_count));
+	       total_count == 0 ? 100 : (cache->hit_count * 100 / total_count),
+	       cache->wait_count);
 
 	e_info(cache->event, "Authentication cache inserts: "
 	       "positive: %u entries %llu bytes, "
@@ -221,7 +230,7 @@ static void sig_auth_cache_stats(const siginfo_t *si ATTR_UNUSED, void *context)
 	       (unsigned int)(cache_used * 100ULL / cache->max_size));
 
 	/* reset counters */
-	cache->hit_count = cache->miss_count = 0;
+	cache->hit_count = cache->miss_count = cache->wait_count = 0;
 	cache->pos_entries = cache->neg_entries = 0;
 	cache->pos_size = cache->neg_size = 0;
 }
@@ -234,6 +243,7 @@ struct auth_cache *auth_cache_new(size_t max_size, unsigned int ttl_secs,
 
 	cache = i_new(struct auth_cache, 1);
 	hash_table_create(&cache->hash, default_pool, 0, str_hash, strcmp);
+	hash_table_create(&cache->pending, default_pool, 0, str_hash, strcmp);
 	cache->max_size = max_size;
 	cache->size_left = max_size;
 	cache->ttl_secs = ttl_secs;
@@ -257,6 +267,9 @@ void auth_cache_free(struct auth_cache **_cache)
 
 	auth_cache_clear(cache);
 	hash_table_destroy(&cache->hash);
+	/* all in-flight lookups must have finished by now */
+	i_assert(hash_table_count(cache->pending) == 0);
+	hash_table_destroy(&cache->pending);
 	event_unref(&cache->event);
 	i_free(cache);
 }
@@ -481,3 +494,48 @@ void auth_cache_remove(struct auth_cache *cache,
 
 	auth_cache_node_destroy(cache, node);
 }
+
+bool auth_cache_lookup_pending(struct auth_cache *cache,
+			       struct auth_request *request, const char *key)
+{
+	struct auth_cache_pending *pending;
+
+	key = auth_request_expand_cache_key(request, key,
+		request->fields.translated_username);
+	pending = hash_table_lookup(cache->pending, key);
+	if (pending == NULL) {
+		/* first request for this key - register the lookup so
+		   identical requests can wait for its result. */
+		pending = i_new(struct auth_cache_pending, 1);
+		pending->key = i_strdup(key);
+		i_array_init(&pending->waiters, 4);
+		hash_table_insert(cache->pending, pending->key, pending);
+		request->passdb_cache_pending_key =
+			p_strdup(request->pool, key);
+		return FALSE;
+	}
+	auth_request_ref(request);
+	array_push_back(&pending->waiters, &request);
+	cache->wait_count++;
+	e_debug(authdb_event(request),
+		"cache: waiting for an identical lookup already in flight");
+	return TRUE;
+}
+
+void auth_cache_pending_finish(struct auth_cache *cache,
+			       struct auth_request *request,
+			       ARRAY_TYPE(auth_cache_waiters) *waiters)
+{
+	struct auth_cache_pending *pending;
+
+	pending = hash_table_lookup(cache->pending,
+				    request->passdb_cache_pending_key);
+	i_assert(pending != NULL);
+	request->passdb_cache_pending_key = NULL;
+
+	hash_table_remove(cache->pending, pending->key);
+	array_append_array(waiters, &pending->waiters);
+	array_free(&pending->waiters);
+	i_free(pending->key);
+	i_free(pending);
+}
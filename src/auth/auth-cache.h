@@ -16,6 +16,8 @@ struct auth_cache_node {
 struct auth_cache;
 struct auth_request;
 
+ARRAY_DEFINE_TYPE(auth_cache_waiters, struct auth_request *);
+
 /* Parses all %x variables from query and compresses them into tab-separated
    list, so it can be used as a cache key. */
 char *auth_cache_parse_key(pool_t pool, const char *query);
@@ -50,4 +52,16 @@ void auth_cache_remove(struct auth_cache *cache,
 		       const struct auth_request *request,
 		       const char *key);
 
+/* If a passdb lookup for the same expanded cache key is already in flight,
+   add the request as a waiter for it (referenced) and return TRUE. Otherwise
+   register this request's lookup as the in-flight one and return FALSE. */
+bool auth_cache_lookup_pending(struct auth_cache *cache,
+			       struct auth_request *request, const char *key);
+/* Called when the lookup registered by auth_cache_lookup_pending() finishes,
+   successfully or not. Appends the requests that were waiting for it to
+   waiters. The caller must resume each waiter and drop its reference. */
+void auth_cache_pending_finish(struct auth_cache *cache,
+			       struct auth_request *request,
+			       ARRAY_TYPE(auth_cache_waiters) *waiters);
+
 #endif
@@ -4,6 +4,8 @@
 #include "ioloop.h"
 #include "net.h"
 #include "crc32.h"
+#include "hash.h"
+#include "llist.h"
 #include "master-service.h"
 #include "anvil-client.h"
 #include "auth-request.h"
@@ -15,15 +17,41 @@
    tracking with tons of different IPs. */
 #define PENALTY_IPV6_MASK_BITS 48
 
+/* Serve repeated lookups for the same IP from a local cache for this long
+   before asking anvil again. Penalty increases done by other auth processes
+   become visible the next time the entry is synced. */
+#define AUTH_PENALTY_CACHE_SYNC_SECS 10
+/* Drop the least recently used cache entries above this count. */
+#define AUTH_PENALTY_CACHE_MAX_ENTRIES 1000
+
 struct auth_penalty_request {
+	struct auth_penalty *penalty;
 	struct auth_request *auth_request;
 	struct anvil_client *client;
 	auth_penalty_callback_t *callback;
+	char *ident;
+};
+
+struct auth_penalty_cache_rec {
+	/* ordered by last use */
+	struct auth_penalty_cache_rec *prev, *next;
+
+	char *ident;
+	unsigned int penalty;
+	time_t last_penalty;
+	/* when the values were last synced from an anvil reply.
+	   0 = updated only locally, not synced yet */
+	time_t synced;
+	unsigned int last_checksum;
 };
 
 struct auth_penalty {
 	struct anvil_client *client;
 
+	/* ident => auth_penalty_cache_rec */
+	HASH_TABLE(char *, struct auth_penalty_cache_rec *) cache;
+	struct auth_penalty_cache_rec *lru_oldest, *lru_newest;
+
 	bool disabled:1;
 };
 
@@ -32,6 +60,7 @@ struct auth_penalty *auth_penalty_init(const char *path)
 	struct auth_penalty *penalty;
 
 	penalty = i_new(struct auth_penalty, 1);
+	hash_table_create(&penalty->cache, default_pool, 0, str_hash, strcmp);
 	penalty->client = anvil_client_init(path, NULL,
 					    ANVIL_CLIENT_FLAG_HIDE_ENOENT);
 	if (anvil_client_connect(penalty->client, TRUE) < 0)
@@ -49,9 +78,46 @@ void auth_penalty_deinit(struct auth_penalty **_penalty)
 
 	*_penalty = NULL;
 	anvil_client_deinit(&penalty->client);
+	while (penalty->lru_oldest != NULL) {
+		struct auth_penalty_cache_rec *rec = penalty->lru_oldest;
+
+		DLLIST2_REMOVE(&penalty->lru_oldest, &penalty->lru_newest, rec);
+		i_free(rec->ident);
+		i_free(rec);
+	}
+	hash_table_destroy(&penalty->cache);
 	i_free(penalty);
 }
 
+static struct auth_penalty_cache_rec *
+auth_penalty_cache_get(struct auth_penalty *penalty, const char *ident)
+{
+	struct auth_penalty_cache_rec *rec;
+
+	rec = hash_table_lookup(penalty->cache, ident);
+	if (rec == NULL) {
+		if (hash_table_count(penalty->cache) >=
+		    AUTH_PENALTY_CACHE_MAX_ENTRIES) {
+			/* drop the least recently used entry */
+			struct auth_penalty_cache_rec *old =
+				penalty->lru_oldest;
+
+			DLLIST2_REMOVE(&penalty->lru_oldest,
+				       &penalty->lru_newest, old);
+			hash_table_remove(penalty->cache, old->ident);
+			i_free(old->ident);
+			i_free(old);
+		}
+		rec = i_new(struct auth_penalty_cache_rec, 1);
+		rec->ident = i_strdup(ident);
+		hash_table_insert(penalty->cache, rec->ident, rec);
+	} else {
+		DLLIST2_REMOVE(&penalty->lru_oldest, &penalty->lru_newest, rec);
+	}
+	DLLIST2_APPEND(&penalty->lru_oldest, &penalty->lru_newest, rec);
+	return rec;
+}
+
 unsigned int auth_penalty_to_secs(unsigned int penalty)
 {
 	unsigned int i, secs = AUTH_PENALTY_INIT_SECS;
@@ -61,13 +127,33 @@ unsigned int auth_penalty_to_secs(unsigned int penalty)
 	return secs < AUTH_PENALTY_MAX_SECS ? secs : AUTH_PENALTY_MAX_SECS;
 }
 
+static unsigned int
+auth_penalty_get_current(unsigned int penalty, time_t last_penalty)
+{
+	unsigned int secs, drop_penalty;
+
+	if (last_penalty > ioloop_time) {
+		/* time moved backwards? */
+		last_penalty = ioloop_time;
+	}
+
+	drop_penalty = AUTH_PENALTY_MAX_PENALTY;
+	while (penalty > 0) {
+		secs = auth_penalty_to_secs(drop_penalty);
+		if (ioloop_time - last_penalty < secs)
+			break;
+		drop_penalty--;
+		penalty--;
+	}
+	return penalty;
+}
+
 static void
 auth_penalty_anvil_callback(const char *reply,
 			    struct auth_penalty_request *request)
 {
 	unsigned int penalty = 0;
 	unsigned long last_penalty = 0;
-	unsigned int secs, drop_penalty;
 
 	if (reply == NULL) {
 		/* internal failure. */
@@ -80,24 +166,22 @@ auth_penalty_anvil_callback(const char *reply,
 		e_error(request->auth_request->event,
 			"Invalid PENALTY-GET reply: %s", reply);
 	} else {
-		if ((time_t)last_penalty > ioloop_time) {
-			/* time moved backwards? */
-			last_penalty = ioloop_time;
-		}
+		/* sync the local cache, so further lookups for this IP don't
+		   need to ask anvil for a while */
+		struct auth_penalty_cache_rec *rec =
+			auth_penalty_cache_get(request->penalty,
+					       request->ident);
+		rec->penalty = penalty;
+		rec->last_penalty = (time_t)last_penalty;
+		rec->synced = ioloop_time;
 
-		/* update penalty. */
-		drop_penalty = AUTH_PENALTY_MAX_PENALTY;
-		while (penalty > 0) {
-			secs = auth_penalty_to_secs(drop_penalty);
-			if (ioloop_time - last_penalty < secs)
-				break;
-			drop_penalty--;
-			penalty--;
-		}
+		penalty = auth_penalty_get_current(penalty,
+						   (time_t)last_penalty);
 	}
 
 	request->callback(penalty, request->auth_request);
 	auth_request_unref(&request->auth_request);
+	i_free(request->ident);
 	i_free(request);
 }
 
@@ -129,10 +213,27 @@ void auth_penalty_lookup(struct auth_penalty *penalty,
 		return;
 	}
 
+	struct auth_penalty_cache_rec *rec =
+		hash_table_lookup(penalty->cache, ident);
+	if (rec != NULL && rec->synced != 0 &&
+	    ioloop_time - rec->synced <= AUTH_PENALTY_CACHE_SYNC_SECS) {
+		/* recently synced from anvil - answer without a round-trip.
+		   the entry is also kept up-to-date by our own
+		   auth_penalty_update() calls. */
+		DLLIST2_REMOVE(&penalty->lru_oldest, &penalty->lru_newest, rec);
+		DLLIST2_APPEND(&penalty->lru_oldest, &penalty->lru_newest, rec);
+		callback(auth_penalty_get_current(rec->penalty,
+						  rec->last_penalty),
+			 auth_request);
+		return;
+	}
+
 	request = i_new(struct auth_penalty_request, 1);
+	request->penalty = penalty;
 	request->auth_request = auth_request;
 	request->client = penalty->client;
 	request->callback = callback;
+	request->ident = i_strdup(ident);
 	auth_request_ref(auth_request);
 
 	T_BEGIN {
@@ -174,5 +275,23 @@ void auth_penalty_update(struct auth_penalty *penalty,
 		cmd = t_strdup_printf("PENALTY-INC\t%s\t%u\t%u",
 				      ident, checksum, value);
 		anvil_client_cmd(penalty->client, cmd);
+
+		/* mirror the update to the local cache, the same way anvil
+		   applies it, so cached lookups see it immediately */
+		struct auth_penalty_cache_rec *rec =
+			auth_penalty_cache_get(penalty, ident);
+		if (value == 0) {
+			rec->penalty = 0;
+			rec->last_checksum = 0;
+			rec->last_penalty = ioloop_time;
+		} else if (checksum != 0 && checksum == rec->last_checksum) {
+			/* same username+password as last time - anvil won't
+			   raise the penalty either */
+			rec->penalty = value - 1;
+		} else {
+			rec->last_checksum = checksum;
+			rec->penalty = value;
+			rec->last_penalty = ioloop_time;
+		}
 	} T_END;
 }
@@ -12,6 +12,7 @@
 #include "http-url.h"
 #include "http-client.h"
 #include "json-parser.h"
+#include "time-util.h"
 #include "master-service.h"
 #include "master-service-settings.h"
 #include "master-service-ssl-settings.h"
@@ -37,6 +38,13 @@ static char *auth_policy_json_template;
 
 static struct http_client *http_client;
 
+/* Circuit breaker state: after policy_server_max_failures consecutive
+   failed requests the policy server is left alone for
+   policy_server_failure_backoff_msecs and lookups are answered locally
+   according to policy_reject_on_fail. */
+static unsigned int auth_policy_failure_count;
+static struct timeval auth_policy_backoff_until;
+
 struct policy_lookup_ctx {
 	pool_t pool;
 	string_t *json;
@@ -241,6 +249,54 @@ void auth_policy_deinit(void)
 	i_free(auth_policy_json_template);
 }
 
+static bool auth_policy_circuit_open(const struct auth_settings *set)
+{
+	if (set->policy_server_max_failures == 0)
+		return FALSE;
+	if (auth_policy_failure_count < set->policy_server_max_failures)
+		return FALSE;
+	if (timeval_cmp(&ioloop_timeval, &auth_policy_backoff_until) >= 0) {
+		/* backoff is over - let a probe request through */
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static void
+auth_policy_record_result(struct policy_lookup_ctx *context, bool success)
+{
+	unsigned int max_failures = context->set->policy_server_max_failures;
+
+	if (max_failures == 0)
+		return;
+	if (success) {
+		if (auth_policy_failure_count >= max_failures) {
+			e_info(context->event,
+			       "Policy server answered again - "
+			       "resuming policy lookups");
+		}
+		auth_policy_failure_count = 0;
+		return;
+	}
+	auth_policy_failure_count++;
+	if (auth_policy_failure_count < max_failures)
+		return;
+	auth_policy_backoff_until = ioloop_timeval;
+	timeval_add_msecs(&auth_policy_backoff_until,
+			  context->set->policy_server_failure_backoff_msecs);
+	if (auth_policy_failure_count == max_failures) {
+		e_warning(context->event,
+			  "Policy server failed %u times in a row - %s for "
+			  "the next %u milliseconds "
+			  "(auth_policy_server_max_failures)",
+			  auth_policy_failure_count,
+			  context->set->policy_reject_on_fail ?
+			  "rejecting authentications locally" :
+			  "skipping policy lookups",
+			  context->set->policy_server_failure_backoff_msecs);
+	}
+}
+
 static
 void auth_policy_log_result(struct policy_lookup_ctx *context)
 {
@@ -351,6 +407,7 @@ void auth_policy_parse_response(struct policy_lookup_ctx *context)
 			context->parse_error = FALSE;
 	}
 
+	auth_policy_record_result(context, !context->parse_error);
 	if (context->parse_error) {
 		context->result = (context->set->policy_reject_on_fail ? -1 : 0);
 	}
@@ -393,6 +450,7 @@ void auth_policy_process_response(const struct http_response *response,
 		e_error(context->event,
 			"Policy server HTTP error: %s",
 			http_response_get_message(response));
+		auth_policy_record_result(context, FALSE);
 		auth_policy_callback(context);
 		return;
 	}
@@ -401,6 +459,7 @@ void auth_policy_process_response(const struct http_response *response,
 		if (context->expect_result)
 			e_error(context->event,
 				"Policy server result was empty");
+		auth_policy_record_result(context, !context->expect_result);
 		auth_policy_callback(context);
 		return;
 	}
@@ -411,6 +470,7 @@ void auth_policy_process_response(const struct http_response *response,
 		context->parser = json_parser_init(response->payload);
 		auth_policy_parse_response(ctx);
 	} else {
+		auth_policy_record_result(context, TRUE);
 		auth_policy_callback(context);
 	}
 }
@@ -610,6 +670,12 @@ void auth_policy_check(struct auth_request *request, const char *password,
 		cb(0, context);
 		return;
 	}
+	if (auth_policy_circuit_open(request->set)) {
+		/* the policy server is known to be broken right now - answer
+		   locally according to policy_reject_on_fail */
+		cb(request->set->policy_reject_on_fail ? -1 : 0, context);
+		return;
+	}
 	pool_t pool = pool_alloconly_create("auth policy", 512);
 	struct policy_lookup_ctx *ctx = p_new(pool, struct policy_lookup_ctx, 1);
 	ctx->pool = pool;
@@ -637,6 +703,10 @@ void auth_policy_report(struct auth_request *request)
 
 	if (*(request->set->policy_server_url) == '\0')
 		return;
+	if (auth_policy_circuit_open(request->set)) {
+		/* reports would fail the same way the lookups did */
+		return;
+	}
 	pool_t pool = pool_alloconly_create("auth policy", 512);
 	struct policy_lookup_ctx *ctx = p_new(pool, struct policy_lookup_ctx, 1);
 	ctx->pool = pool;
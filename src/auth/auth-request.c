@@ -64,6 +64,8 @@ static void get_log_identifier(string_t *str, struct auth_request *auth_request)
 static void
 auth_request_userdb_import(struct auth_request *request, const char *args);
 
+static void
+auth_request_verify_plain_continue_lookup(struct auth_request *request);
 static
 void auth_request_lookup_credentials_policy_continue(struct auth_request *request,
 						     lookup_credentials_callback_t *callback);
@@ -900,6 +902,26 @@ auth_request_verify_plain_callback_finish(enum passdb_result result,
 	}
 }
 
+static void auth_request_resume_cache_waiters(struct auth_request *request)
+{
+	ARRAY_TYPE(auth_cache_waiters) waiters;
+	struct auth_request *waiter;
+
+	if (request->passdb_cache_pending_key == NULL || passdb_cache == NULL)
+		return;
+
+	/* requests that wanted the same passdb lookup waited for this one
+	   to finish instead of each querying the passdb themselves. retry
+	   them from the cache, where our result was just saved. a waiter
+	   whose retry still misses does its own lookup. */
+	t_array_init(&waiters, 4);
+	auth_cache_pending_finish(passdb_cache, request, &waiters);
+	array_foreach_elem(&waiters, waiter) {
+		auth_request_verify_plain_continue_lookup(waiter);
+		auth_request_unref(&waiter);
+	}
+}
+
 void auth_request_verify_plain_callback(enum passdb_result result,
 					struct auth_request *request)
 {
@@ -915,7 +937,8 @@ void auth_request_verify_plain_callback(enum passdb_result result,
 
 	if (result != PASSDB_RESULT_INTERNAL_FAILURE)
 		auth_request_save_cache(request, result);
-	else {
+	auth_request_resume_cache_waiters(request);
+	if (result == PASSDB_RESULT_INTERNAL_FAILURE) {
 		/* lookup failed. if we're looking here only because the
 		   request was expired in cache, fallback to using cached
 		   expired record. */
@@ -1045,8 +1068,6 @@ void auth_request_default_verify_plain_continue(struct auth_request *request,
 						verify_plain_callback_t *callback)
 {
 	struct auth_passdb *passdb;
-	enum passdb_result result;
-	const char *cache_key, *error;
 	const char *password = request->mech_password;
 
 	i_assert(request->state == AUTH_REQUEST_STATE_MECH_CONTINUE);
@@ -1081,11 +1102,29 @@ void auth_request_default_verify_plain_continue(struct auth_request *request,
 	auth_request_passdb_lookup_begin(request);
 	request->private_callback.verify_plain = callback;
 
+	auth_request_verify_plain_continue_lookup(request);
+}
+
+static void
+auth_request_verify_plain_continue_lookup(struct auth_request *request)
+{
+	struct auth_passdb *passdb = request->passdb;
+	enum passdb_result result;
+	const char *cache_key, *error;
+	const char *password = request->mech_password;
+
 	cache_key = passdb_cache == NULL ? NULL : passdb->cache_key;
 	if (passdb_cache_verify_plain(request, cache_key, password,
 				      &result, FALSE)) {
 		return;
 	}
+	if (passdb_cache != NULL && cache_key != NULL &&
+	    auth_cache_lookup_pending(passdb_cache, request, cache_key)) {
+		/* An identical passdb lookup is already in flight. Instead
+		   of sending a duplicate query to the passdb, wait for it to
+		   finish and retry from the cache. */
+		return;
+	}
 
 	auth_request_set_state(request, AUTH_REQUEST_STATE_PASSDB);
 	/* In case this request had already done a credentials lookup (is it
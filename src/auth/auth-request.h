@@ -167,6 +167,9 @@ struct auth_request {
 
 	enum auth_request_cache_result passdb_cache_result;
 	enum auth_request_cache_result userdb_cache_result;
+	/* non-NULL while this request's passdb lookup is registered in the
+	   auth cache as the in-flight lookup for this expanded cache key */
+	const char *passdb_cache_pending_key;
 
 	/* this is a lookup on auth socket (not login socket).
 	   skip any proxying stuff if enabled. */
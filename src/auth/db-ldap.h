@@ -6,7 +6,7 @@
    It is now set in m4/want_ldap.m4 if ldap is enabled. */
 /* #define LDAP_DEPRECATED 1 */
 
-/* Maximum number of pending requests before delaying new requests. */
+/* Default for the max_pending_requests setting. */
 #define DB_LDAP_MAX_PENDING_REQUESTS 8
 /* connect() timeout to LDAP */
 #define DB_LDAP_CONNECT_TIMEOUT_SECS 5
@@ -67,6 +67,8 @@ struct ldap_settings {
 
 	const char *default_pass_scheme;
 	bool blocking;
+	/* Maximum number of pending requests before delaying new requests. */
+	unsigned int max_pending_requests;
 
 	/* ... */
 	int ldap_deref, ldap_scope, ldap_tls_require_cert_parsed;
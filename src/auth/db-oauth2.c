@@ -2,6 +2,10 @@
 
 #include "auth-common.h"
 #include "array.h"
+#include "ioloop.h"
+#include "hash.h"
+#include "hex-binary.h"
+#include "sha2.h"
 #include "str.h"
 #include "var-expand.h"
 #include "env-util.h"
@@ -77,6 +81,10 @@ struct passdb_oauth2_settings {
 	unsigned int max_idle_time_msecs;
 	unsigned int max_parallel_connections;
 	unsigned int max_pipelined_requests;
+	/* how long a successful tokeninfo/introspection result can be reused
+	   without contacting the oauth2 server again, 0 = disabled. The
+	   token's own expiry is always honored when it's shorter. */
+	unsigned int introspection_cache_ttl_secs;
 	bool tls_allow_invalid_cert;
 
 	bool debug;
@@ -87,6 +95,18 @@ struct passdb_oauth2_settings {
 	bool use_grant_password;
 };
 
+/* Maximum number of cached token validation results per database */
+#define DB_OAUTH2_TOKEN_CACHE_MAX_ENTRIES 1000
+
+struct db_oauth2_token_cache_entry {
+	struct db_oauth2_token_cache_entry *prev, *next;
+
+	char *cache_key;
+	time_t expires_at;
+	/* name,value pairs, NULL-terminated */
+	const char **fields;
+};
+
 struct db_oauth2 {
 	struct db_oauth2 *prev,*next;
 
@@ -100,11 +120,19 @@ struct db_oauth2 {
 
 	struct db_oauth2_request *head;
 
+	HASH_TABLE(char *, struct db_oauth2_token_cache_entry *) token_cache;
+	struct db_oauth2_token_cache_entry *token_cache_head, *token_cache_tail;
+	unsigned int token_cache_count;
+
 	unsigned int refcount;
 };
 
 static struct db_oauth2 *db_oauth2_head = NULL;
 
+static void
+db_oauth2_token_cache_entry_free(struct db_oauth2 *db,
+				 struct db_oauth2_token_cache_entry *entry);
+
 #undef DEF_STR
 #undef DEF_BOOL
 #undef DEF_INT
@@ -134,6 +162,7 @@ static struct setting_def setting_defs[] = {
 	DEF_INT(max_idle_time_msecs),
 	DEF_INT(max_parallel_connections),
 	DEF_INT(max_pipelined_requests),
+	DEF_INT(introspection_cache_ttl_secs),
 	DEF_BOOL(send_auth_headers),
 	DEF_BOOL(use_grant_password),
 
@@ -173,6 +202,7 @@ static struct passdb_oauth2_settings default_oauth2_settings = {
 	.max_idle_time_msecs = 60000,
 	.max_parallel_connections = 10,
 	.max_pipelined_requests = 1,
+	.introspection_cache_ttl_secs = 0,
 	.tls_ca_cert_file = NULL,
 	.tls_ca_cert_dir = NULL,
 	.tls_cert_file = NULL,
@@ -256,6 +286,11 @@ struct db_oauth2 *db_oauth2_init(const char *config_path)
 
 	db->client = http_client_init(&http_set);
 
+	if (db->set.introspection_cache_ttl_secs > 0) {
+		hash_table_create(&db->token_cache, default_pool, 0,
+				  str_hash, strcmp);
+	}
+
 	i_zero(&db->oauth2_set);
 	db->oauth2_set.client = db->client;
 	db->oauth2_set.tokeninfo_url = db->set.tokeninfo_url,
@@ -349,6 +384,13 @@ void db_oauth2_unref(struct db_oauth2 **_db)
 	while (db->head != NULL)
 		oauth2_request_abort(&db->head->req);
 
+	if (hash_table_is_created(db->token_cache)) {
+		while (db->token_cache_head != NULL) {
+			db_oauth2_token_cache_entry_free(db,
+				db->token_cache_head);
+		}
+		hash_table_destroy(&db->token_cache);
+	}
 	http_client_deinit(&db->client);
 	if (db->oauth2_set.key_dict != NULL)
 		dict_deinit(&db->oauth2_set.key_dict);
@@ -532,6 +574,84 @@ db_oauth2_field_find(const ARRAY_TYPE(oauth2_field) *fields, const char *name)
 	return NULL;
 }
 
+static char *db_oauth2_token_cache_key_get(const char *token)
+{
+	unsigned char digest[SHA256_RESULTLEN];
+
+	/* don't keep the tokens themselves around in memory */
+	sha256_get_digest(token, strlen(token), digest);
+	return i_strdup(binary_to_hex(digest, sizeof(digest)));
+}
+
+static void
+db_oauth2_token_cache_entry_free(struct db_oauth2 *db,
+				 struct db_oauth2_token_cache_entry *entry)
+{
+	hash_table_remove(db->token_cache, entry->cache_key);
+	DLLIST2_REMOVE(&db->token_cache_head, &db->token_cache_tail, entry);
+	i_assert(db->token_cache_count > 0);
+	db->token_cache_count--;
+
+	i_free(entry->fields);
+	i_free(entry->cache_key);
+	i_free(entry);
+}
+
+static void
+db_oauth2_token_cache_add(struct db_oauth2 *db, const char *token,
+			  const ARRAY_TYPE(oauth2_field) *fields,
+			  time_t expires_at)
+{
+	struct db_oauth2_token_cache_entry *entry;
+	const struct oauth2_field *field;
+	ARRAY_TYPE(const_string) arr;
+	char *cache_key;
+	time_t cache_expires_at =
+		ioloop_time + db->set.introspection_cache_ttl_secs;
+
+	if (!hash_table_is_created(db->token_cache) || token == NULL)
+		return;
+
+	/* RFC 7662 introspection responses carry the expiry in "exp" */
+	if (expires_at == 0) {
+		const char *exp = db_oauth2_field_find(fields, "exp");
+		time_t exp_time;
+
+		if (exp != NULL && str_to_time(exp, &exp_time) == 0)
+			expires_at = exp_time;
+	}
+	/* never cache beyond the token's own expiry */
+	if (expires_at != 0 && expires_at < cache_expires_at)
+		cache_expires_at = expires_at;
+	if (cache_expires_at <= ioloop_time)
+		return;
+
+	cache_key = db_oauth2_token_cache_key_get(token);
+	entry = hash_table_lookup(db->token_cache, cache_key);
+	if (entry != NULL) {
+		/* introspection may return more fields than an earlier
+		   tokeninfo lookup did - replace the old entry */
+		db_oauth2_token_cache_entry_free(db, entry);
+	}
+	while (db->token_cache_count >= DB_OAUTH2_TOKEN_CACHE_MAX_ENTRIES)
+		db_oauth2_token_cache_entry_free(db, db->token_cache_tail);
+
+	t_array_init(&arr, array_count(fields)*2 + 1);
+	array_foreach(fields, field) {
+		array_push_back(&arr, &field->name);
+		array_push_back(&arr, &field->value);
+	}
+	array_append_zero(&arr);
+
+	entry = i_new(struct db_oauth2_token_cache_entry, 1);
+	entry->cache_key = cache_key;
+	entry->expires_at = cache_expires_at;
+	entry->fields = p_strarray_dup(default_pool, array_front(&arr));
+	hash_table_insert(db->token_cache, entry->cache_key, entry);
+	DLLIST2_PREPEND(&db->token_cache_head, &db->token_cache_tail, entry);
+	db->token_cache_count++;
+}
+
 static void db_oauth2_callback(struct db_oauth2_request *req,
 			       enum passdb_result result,
 			       const char *error_prefix, const char *error)
@@ -704,6 +824,8 @@ db_oauth2_introspect_continue(struct oauth2_request_result *result,
 	} else {
 		e_debug(authdb_event(req->auth_request),
 			"Introspection succeeded");
+		db_oauth2_token_cache_add(req->db, req->token, result->fields,
+					  result->expires_at);
 		db_oauth2_fields_merge(req, result->fields);
 		db_oauth2_process_fields(req, &passdb_result, &error);
 	}
@@ -786,6 +908,44 @@ db_oauth2_lookup_continue_valid(struct db_oauth2_request *req,
 	db_oauth2_callback(req, passdb_result, error_prefix, error);
 }
 
+static bool
+db_oauth2_token_cache_lookup(struct db_oauth2 *db,
+			     struct db_oauth2_request *req)
+{
+	struct db_oauth2_token_cache_entry *entry;
+	ARRAY_TYPE(oauth2_field) fields;
+	char *cache_key;
+	unsigned int i;
+
+	if (!hash_table_is_created(db->token_cache))
+		return FALSE;
+
+	cache_key = db_oauth2_token_cache_key_get(req->token);
+	entry = hash_table_lookup(db->token_cache, cache_key);
+	i_free(cache_key);
+	if (entry == NULL)
+		return FALSE;
+	if (entry->expires_at <= ioloop_time) {
+		db_oauth2_token_cache_entry_free(db, entry);
+		return FALSE;
+	}
+	/* mark the entry as most recently used */
+	DLLIST2_REMOVE(&db->token_cache_head, &db->token_cache_tail, entry);
+	DLLIST2_PREPEND(&db->token_cache_head, &db->token_cache_tail, entry);
+
+	e_debug(authdb_event(req->auth_request),
+		"Using cached token validation result");
+	t_array_init(&fields, 8);
+	for (i = 0; entry->fields[i] != NULL; i += 2) {
+		struct oauth2_field *field = array_append_space(&fields);
+		field->name = entry->fields[i];
+		field->value = entry->fields[i+1];
+	}
+	db_oauth2_lookup_continue_valid(req, &fields,
+					"Cached token validation failed: ");
+	return TRUE;
+}
+
 static void
 db_oauth2_lookup_continue(struct oauth2_request_result *result,
 			  struct db_oauth2_request *req)
@@ -803,6 +963,8 @@ db_oauth2_lookup_continue(struct oauth2_request_result *result,
 	} else {
 		e_debug(authdb_event(req->auth_request),
 			"Token validation succeeded");
+		db_oauth2_token_cache_add(req->db, req->token, result->fields,
+					  result->expires_at);
 		db_oauth2_lookup_continue_valid(req, result->fields,
 						"Token validation failed: ");
 	}
@@ -883,6 +1045,12 @@ void db_oauth2_lookup(struct db_oauth2 *db, struct db_oauth2_request *req,
 		return;
 
 	}
+	if (!db->oauth2_set.use_grant_password &&
+	    db_oauth2_token_cache_lookup(db, req)) {
+		/* the token was validated recently - the result was already
+		   delivered to the callback */
+		return;
+	}
 	if (db->oauth2_set.use_grant_password) {
 		e_debug(authdb_event(req->auth_request),
 			"Making grant url request to %s",
@@ -172,6 +172,9 @@ static void main_preinit(void)
 	userdbs_init();
 	/* init schemes before plugins are loaded */
 	password_schemes_init();
+	/* cache SCRAM keys derived from plaintext credentials, so
+	   re-authenticating clients don't repeat the PBKDF2 rounds */
+	scram_key_cache_init(SCRAM_KEY_CACHE_DEFAULT_MAX_ENTRIES);
 
 	services = read_global_settings();
 
@@ -289,6 +292,7 @@ static void main_deinit(void)
 	userdbs_deinit();
 	passdbs_deinit();
 	passdb_cache_deinit();
+	scram_key_cache_deinit();
         password_schemes_deinit();
 
 	sql_drivers_deinit();
@@ -197,6 +197,32 @@ static int dict_connection_input_line(struct connection *_conn, const char *line
 	return 1;
 }
 
+static int
+dict_connection_input_lines_batch(struct connection *_conn,
+				  const char *const *lines, unsigned int count)
+{
+	struct dict_connection *conn =
+		container_of(_conn, struct dict_connection, conn);
+	unsigned int i;
+
+	i_assert(conn->dict != NULL);
+
+	/* the lines have already been consumed from the input stream, so
+	   they must all be processed even if the pending command limit is
+	   crossed in the middle of the batch */
+	for (i = 0; i < count; i++) {
+		if (dict_command_input(conn, lines[i]) < 0)
+			return -1;
+	}
+
+	if (array_count(&conn->cmds) >= DICT_CONN_MAX_PENDING_COMMANDS) {
+		connection_input_halt(_conn);
+		return 0;
+	}
+
+	return 1;
+}
+
 static void dict_connection_unref_safe_callback(struct dict_connection *conn)
 {
 	timeout_remove(&conn->to_unref);
@@ -263,6 +289,7 @@ static struct connection_vfuncs dict_connections_vfuncs = {
 	.destroy = dict_connection_destroy,
 	.handshake_line = dict_connection_handshake_line,
 	.input_line = dict_connection_input_line,
+	.input_lines_batch = dict_connection_input_lines_batch,
 };
 
 void dict_connections_init(void)
@@ -79,7 +79,11 @@ struct service_settings dict_async_service_settings = {
 
 	.process_min_avail = 0,
 	.process_limit = 0,
-	.client_limit = 0,
+	/* Cap the number of clients per process, so busy installations get
+	   their dict load sharded across multiple processes - each with its
+	   own ioloop and backend connections - instead of every client
+	   multiplexing onto a single process's event loop. */
+	.client_limit = 100,
 	.service_count = 0,
 	.idle_kill = 0,
 	.vsz_limit = UOFF_T_MAX,
@@ -20,6 +20,16 @@ struct index_vsize_header {
 	uint32_t highest_uid;
 	uint32_t message_count;
 };
+#define INDEX_STATS_RDATE_BUCKET_COUNT 32
+#define INDEX_STATS_SIZE_BUCKET_COUNT 32
+struct index_stats_header {
+	uint32_t highest_uid;
+	uint32_t message_count;
+	uint32_t rdate_base;
+	uint32_t rdate_older_count;
+	uint32_t rdate_buckets[INDEX_STATS_RDATE_BUCKET_COUNT];
+	uint32_t size_buckets[INDEX_STATS_SIZE_BUCKET_COUNT];
+};
 struct maildir_index_header {
 	uint32_t new_check_time, new_mtime, new_mtime_nsecs;
 	uint32_t cur_check_time, cur_mtime, cur_mtime_nsecs;
@@ -232,6 +242,29 @@ static void dump_extension_header(struct mail_index *index,
 		printf(" - highest uid . = %u\n", hdr->highest_uid);
 		printf(" - message count = %u\n", hdr->message_count);
 		printf(" - vsize ....... = %"PRIu64"\n", hdr->vsize);
+	} else if (strcmp(ext->name, "hdr-stats") == 0) {
+		const struct index_stats_header *hdr = data;
+		unsigned int i;
+
+		printf("header\n");
+		printf(" - highest uid ....... = %u\n", hdr->highest_uid);
+		printf(" - message count ..... = %u\n", hdr->message_count);
+		printf(" - rdate base ........ = %s\n",
+		       unixdate2str(hdr->rdate_base));
+		printf(" - rdate older count . = %u\n", hdr->rdate_older_count);
+		for (i = 0; i < INDEX_STATS_RDATE_BUCKET_COUNT; i++) {
+			if (hdr->rdate_buckets[i] == 0)
+				continue;
+			printf(" - rdate day %-2u ...... = %u (%s)\n", i,
+			       hdr->rdate_buckets[i],
+			       unixdate2str(hdr->rdate_base + i*24*60*60));
+		}
+		for (i = 0; i < INDEX_STATS_SIZE_BUCKET_COUNT; i++) {
+			if (hdr->size_buckets[i] == 0)
+				continue;
+			printf(" - size 2^%-2u ......... = %u\n", i+1,
+			       hdr->size_buckets[i]);
+		}
 	} else if (strcmp(ext->name, "maildir") == 0) {
 		const struct maildir_index_header *hdr = data;
 
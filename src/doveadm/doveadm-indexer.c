@@ -107,7 +107,7 @@ static int cmd_indexer_list_print(const char *const *args)
 		return -1;
 
 	/* <tag> <username> <mailbox> <session-id> <max-recent-msgs> <type>
-	   <flags> */
+	   <flags> [<priority>] */
 	doveadm_print(args[1]);
 	doveadm_print(args[2]);
 	doveadm_print(args[3]);
@@ -131,6 +131,25 @@ static int cmd_indexer_list_print(const char *const *args)
 		doveadm_print("working/tail-queued");
 	else
 		doveadm_print("working");
+	if (str_array_length(args) < 8) {
+		/* old indexer that doesn't send the priority */
+		doveadm_print("-");
+		return 0;
+	}
+	switch (args[7][0]) {
+	case 'i':
+		doveadm_print("interactive");
+		break;
+	case 'd':
+		doveadm_print("delivery");
+		break;
+	case 'b':
+		doveadm_print("backfill");
+		break;
+	default:
+		doveadm_print(args[7]);
+		break;
+	}
 	return 0;
 }
 
@@ -151,6 +170,7 @@ static void cmd_indexer_list(struct doveadm_cmd_context *cctx)
 	doveadm_print_header_simple("max_recent");
 	doveadm_print_header_simple("type");
 	doveadm_print_header_simple("status");
+	doveadm_print_header_simple("priority");
 
 	alarm(30);
 	while ((line = i_stream_read_next_line(input)) != NULL) {
@@ -0,0 +1,368 @@
+/* Copyright (c) 2026 Dovecot authors, see the included COPYING file */
+
+#include "lib.h"
+#include "array.h"
+#include "str.h"
+#include "ioloop.h"
+#include "istream.h"
+#include "message-date.h"
+#include "mail-namespace.h"
+#include "mail-storage.h"
+#include "doveadm-mail.h"
+
+/* Generates a synthetic mailbox for performance testing. The messages are
+   produced from a seeded PRNG, so the same parameters always generate the
+   same corpus regardless of the host. */
+
+#define GENERATE_COMMIT_INTERVAL 1024
+/* how many recent messages are candidates for being replied to */
+#define GENERATE_THREAD_WINDOW 32
+
+struct generate_thread_msg {
+	char *msgid;
+	uint32_t depth;
+};
+
+struct generate_cmd_context {
+	struct doveadm_mail_cmd_context ctx;
+
+	const char *mailbox;
+	uint32_t count;
+	uint32_t avg_size;
+	uint32_t mime_parts;
+	uint32_t thread_depth;
+	uint32_t keywords;
+	uint32_t seed;
+
+	uint64_t rand_state;
+	/* ring buffer of the last GENERATE_THREAD_WINDOW messages */
+	struct generate_thread_msg thread_window[GENERATE_THREAD_WINDOW];
+	unsigned int thread_window_count;
+};
+
+static uint32_t generate_rand(struct generate_cmd_context *ctx)
+{
+	/* xorshift64* - not cryptographic, but stable across platforms */
+	uint64_t x = ctx->rand_state;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	ctx->rand_state = x;
+	return (uint32_t)((x * 2685821657736338717ULL) >> 32);
+}
+
+static uint32_t
+generate_rand_limit(struct generate_cmd_context *ctx, uint32_t limit)
+{
+	i_assert(limit > 0);
+	return generate_rand(ctx) % limit;
+}
+
+static void
+generate_append_body(struct generate_cmd_context *ctx, string_t *msg,
+		     size_t size)
+{
+	size_t end = str_len(msg) + size;
+
+	while (str_len(msg) < end) {
+		str_printfa(msg, "Filler line %u with some words that make "
+			    "the body look like plain mail text.\n",
+			    generate_rand(ctx));
+	}
+}
+
+static void
+generate_append_base64_body(struct generate_cmd_context *ctx, string_t *msg,
+			    size_t size)
+{
+	size_t end = str_len(msg) + size;
+
+	while (str_len(msg) < end) {
+		str_printfa(msg, "QmVuY2htYXJrIGZpbGxlciBkYXRhICV1Cg%02u=\n",
+			    generate_rand_limit(ctx, 100));
+	}
+}
+
+static void
+generate_msg_write(struct generate_cmd_context *ctx, string_t *msg,
+		   uint32_t idx, time_t sent_date)
+{
+	struct generate_thread_msg *parent = NULL;
+	const char *msgid;
+	size_t body_size;
+	uint32_t nparts, depth = 0;
+
+	msgid = t_strdup_printf("<generated.%u.%u@corpus.invalid>",
+				ctx->seed, idx);
+
+	/* half of the messages continue an existing thread, if one with
+	   room left below thread-depth is available */
+	if (ctx->thread_depth > 0 && ctx->thread_window_count > 0 &&
+	    generate_rand_limit(ctx, 2) == 0) {
+		unsigned int i = generate_rand_limit(ctx, ctx->thread_window_count);
+		if (ctx->thread_window[i].depth < ctx->thread_depth) {
+			parent = &ctx->thread_window[i];
+			depth = parent->depth + 1;
+		}
+	}
+
+	str_printfa(msg, "Return-Path: <sender%u@example.com>\n",
+		    generate_rand_limit(ctx, 1000));
+	str_printfa(msg, "From: Sender User <sender%u@example.com>\n",
+		    generate_rand_limit(ctx, 1000));
+	str_printfa(msg, "To: Test User <user%u@example.com>\n",
+		    generate_rand_limit(ctx, 100));
+	if (parent != NULL) {
+		str_printfa(msg, "Subject: Re: Generated thread %u\n",
+			    generate_rand_limit(ctx, 100));
+		str_printfa(msg, "In-Reply-To: %s\n", parent->msgid);
+		str_printfa(msg, "References: %s\n", parent->msgid);
+	} else {
+		str_printfa(msg, "Subject: Generated message %u\n", idx);
+	}
+	str_printfa(msg, "Message-ID: %s\n", msgid);
+	str_printfa(msg, "Date: %s\n", message_date_create(sent_date));
+	str_append(msg, "Mime-Version: 1.0\n");
+
+	/* body size varies between 50% and 150% of avg-size */
+	body_size = ctx->avg_size / 2 +
+		generate_rand_limit(ctx, I_MAX(ctx->avg_size, 1));
+	nparts = 1 + generate_rand_limit(ctx, ctx->mime_parts);
+
+	if (nparts == 1) {
+		str_append(msg, "Content-Type: text/plain\n\n");
+		generate_append_body(ctx, msg, body_size);
+	} else {
+		uint32_t part;
+
+		str_append(msg, "Content-Type: multipart/mixed; "
+			   "boundary=\"generated-boundary\"\n\n");
+		for (part = 0; part < nparts; part++) {
+			str_append(msg, "--generated-boundary\n");
+			if (part % 2 == 0) {
+				str_append(msg, "Content-Type: text/plain\n\n");
+				generate_append_body(ctx, msg,
+						     body_size / nparts);
+			} else {
+				str_append(msg,
+					"Content-Type: application/octet-stream\n"
+					"Content-Transfer-Encoding: base64\n\n");
+				generate_append_base64_body(ctx, msg,
+							    body_size / nparts);
+			}
+		}
+		str_append(msg, "--generated-boundary--\n");
+	}
+
+	/* remember the message for threading. overwrite a random older slot
+	   once the window is full. */
+	struct generate_thread_msg *slot;
+	if (ctx->thread_window_count < GENERATE_THREAD_WINDOW)
+		slot = &ctx->thread_window[ctx->thread_window_count++];
+	else
+		slot = &ctx->thread_window[generate_rand_limit(ctx, GENERATE_THREAD_WINDOW)];
+	i_free(slot->msgid);
+	slot->msgid = i_strdup(msgid);
+	slot->depth = depth;
+}
+
+static enum mail_flags generate_msg_flags(struct generate_cmd_context *ctx)
+{
+	enum mail_flags flags = 0;
+	uint32_t n = generate_rand_limit(ctx, 100);
+
+	if (n < 70)
+		flags |= MAIL_SEEN;
+	if (n < 15)
+		flags |= MAIL_ANSWERED;
+	if (n >= 95)
+		flags |= MAIL_FLAGGED;
+	return flags;
+}
+
+static int
+generate_save_msg(struct generate_cmd_context *ctx, struct mailbox *box,
+		  struct mailbox_transaction_context *trans,
+		  string_t *msg, time_t received_date)
+{
+	struct mail_save_context *save_ctx;
+	struct mail_keywords *keywords = NULL;
+	struct istream *input;
+	int ret = 0;
+
+	input = i_stream_create_from_data(str_data(msg), str_len(msg));
+
+	save_ctx = mailbox_save_alloc(trans);
+	if (ctx->keywords > 0 && generate_rand_limit(ctx, 4) == 0) {
+		const char *kw[] = {
+			t_strdup_printf("$Generated%u",
+				generate_rand_limit(ctx, ctx->keywords)),
+			NULL
+		};
+		keywords = mailbox_keywords_create_valid(box, kw);
+	}
+	mailbox_save_set_flags(save_ctx, generate_msg_flags(ctx), keywords);
+	mailbox_save_set_received_date(save_ctx, received_date, 0);
+
+	if (mailbox_save_begin(&save_ctx, input) < 0)
+		ret = -1;
+	else {
+		do {
+			if (mailbox_save_continue(save_ctx) < 0) {
+				ret = -1;
+				break;
+			}
+		} while (i_stream_read(input) > 0);
+		if (ret == 0)
+			ret = mailbox_save_finish(&save_ctx);
+		else
+			mailbox_save_cancel(&save_ctx);
+	}
+
+	if (keywords != NULL)
+		mailbox_keywords_unref(&keywords);
+	i_stream_unref(&input);
+	return ret;
+}
+
+static int
+cmd_mailbox_generate_run(struct doveadm_mail_cmd_context *_ctx,
+			 struct mail_user *user)
+{
+	struct generate_cmd_context *ctx =
+		container_of(_ctx, struct generate_cmd_context, ctx);
+	struct mail_namespace *ns;
+	struct mailbox *box;
+	struct mailbox_transaction_context *trans;
+	time_t received_date;
+	uint32_t idx;
+	int ret = 0;
+
+	ns = mail_namespace_find(user->namespaces, ctx->mailbox);
+	box = mailbox_alloc(ns->list, ctx->mailbox, MAILBOX_FLAG_SAVEONLY);
+	if (mailbox_create(box, NULL, FALSE) < 0 &&
+	    mailbox_get_last_mail_error(box) != MAIL_ERROR_EXISTS) {
+		e_error(_ctx->cctx->event, "Failed to create mailbox %s: %s",
+			mailbox_get_vname(box),
+			mailbox_get_last_internal_error(box, NULL));
+		doveadm_mail_failed_mailbox(_ctx, box);
+		mailbox_free(&box);
+		return -1;
+	}
+	if (mailbox_open(box) < 0) {
+		e_error(_ctx->cctx->event, "Failed to open mailbox %s: %s",
+			mailbox_get_vname(box),
+			mailbox_get_last_internal_error(box, NULL));
+		doveadm_mail_failed_mailbox(_ctx, box);
+		mailbox_free(&box);
+		return -1;
+	}
+
+	/* spread the received dates one minute apart, ending now */
+	received_date = ioloop_time - (time_t)ctx->count * 60;
+
+	trans = mailbox_transaction_begin(box,
+		MAILBOX_TRANSACTION_FLAG_EXTERNAL | _ctx->transaction_flags,
+		__func__);
+	for (idx = 0; idx < ctx->count; idx++) {
+		T_BEGIN {
+			string_t *msg = t_str_new(ctx->avg_size + 512);
+
+			generate_msg_write(ctx, msg, idx, received_date);
+			ret = generate_save_msg(ctx, box, trans, msg,
+						received_date);
+		} T_END;
+		if (ret < 0)
+			break;
+		received_date += 60;
+
+		/* commit in batches - a single huge transaction would grow
+		   memory usage and delay everything to one commit */
+		if ((idx+1) % GENERATE_COMMIT_INTERVAL == 0 &&
+		    idx+1 < ctx->count) {
+			if (mailbox_transaction_commit(&trans) < 0) {
+				ret = -1;
+				break;
+			}
+			trans = mailbox_transaction_begin(box,
+				MAILBOX_TRANSACTION_FLAG_EXTERNAL |
+				_ctx->transaction_flags, __func__);
+		}
+	}
+
+	if (ret < 0) {
+		e_error(_ctx->cctx->event, "Generating failed: %s",
+			mailbox_get_last_internal_error(box, NULL));
+		doveadm_mail_failed_mailbox(_ctx, box);
+		if (trans != NULL)
+			mailbox_transaction_rollback(&trans);
+	} else if (mailbox_transaction_commit(&trans) < 0) {
+		e_error(_ctx->cctx->event, "Commit failed: %s",
+			mailbox_get_last_internal_error(box, NULL));
+		doveadm_mail_failed_mailbox(_ctx, box);
+		ret = -1;
+	}
+	for (idx = 0; idx < ctx->thread_window_count; idx++)
+		i_free(ctx->thread_window[idx].msgid);
+	mailbox_free(&box);
+	return ret;
+}
+
+static void cmd_mailbox_generate_init(struct doveadm_mail_cmd_context *_ctx)
+{
+	struct doveadm_cmd_context *cctx = _ctx->cctx;
+	struct generate_cmd_context *ctx =
+		container_of(_ctx, struct generate_cmd_context, ctx);
+
+	if (!doveadm_cmd_param_str(cctx, "mailbox", &ctx->mailbox))
+		doveadm_mail_help_name("mailbox generate");
+	(void)doveadm_cmd_param_uint32(cctx, "count", &ctx->count);
+	(void)doveadm_cmd_param_uint32(cctx, "avg-size", &ctx->avg_size);
+	(void)doveadm_cmd_param_uint32(cctx, "mime-parts", &ctx->mime_parts);
+	(void)doveadm_cmd_param_uint32(cctx, "thread-depth", &ctx->thread_depth);
+	(void)doveadm_cmd_param_uint32(cctx, "keywords", &ctx->keywords);
+	(void)doveadm_cmd_param_uint32(cctx, "seed", &ctx->seed);
+
+	if (ctx->count == 0 || ctx->avg_size < 2 || ctx->mime_parts == 0)
+		i_fatal_status(EX_USAGE, "Invalid generate parameters");
+
+	const char *check_args[] = { ctx->mailbox, NULL };
+	doveadm_mailbox_args_check(check_args);
+
+	ctx->rand_state = ctx->seed == 0 ? 1 : ctx->seed;
+}
+
+static struct doveadm_mail_cmd_context *cmd_mailbox_generate_alloc(void)
+{
+	struct generate_cmd_context *ctx;
+
+	ctx = doveadm_mail_cmd_alloc(struct generate_cmd_context);
+	ctx->ctx.v.init = cmd_mailbox_generate_init;
+	ctx->ctx.v.run = cmd_mailbox_generate_run;
+	ctx->count = 1000;
+	ctx->avg_size = 4096;
+	ctx->mime_parts = 3;
+	ctx->thread_depth = 5;
+	ctx->keywords = 8;
+	ctx->seed = 1;
+	return &ctx->ctx;
+}
+
+struct doveadm_cmd_ver2 doveadm_cmd_mailbox_generate_ver2 = {
+	.name = "mailbox generate",
+	.mail_cmd = cmd_mailbox_generate_alloc,
+	.usage = DOVEADM_CMD_MAIL_USAGE_PREFIX
+		"[-c <count>] [-s <avg-size>] [-p <mime-parts>] "
+		"[-t <thread-depth>] [-k <keywords>] [-S <seed>] <mailbox>",
+DOVEADM_CMD_PARAMS_START
+DOVEADM_CMD_MAIL_COMMON
+DOVEADM_CMD_PARAM('c', "count", CMD_PARAM_INT64, CMD_PARAM_FLAG_UNSIGNED)
+DOVEADM_CMD_PARAM('s', "avg-size", CMD_PARAM_INT64, CMD_PARAM_FLAG_UNSIGNED)
+DOVEADM_CMD_PARAM('p', "mime-parts", CMD_PARAM_INT64, CMD_PARAM_FLAG_UNSIGNED)
+DOVEADM_CMD_PARAM('t', "thread-depth", CMD_PARAM_INT64, CMD_PARAM_FLAG_UNSIGNED)
+DOVEADM_CMD_PARAM('k', "keywords", CMD_PARAM_INT64, CMD_PARAM_FLAG_UNSIGNED)
+DOVEADM_CMD_PARAM('S', "seed", CMD_PARAM_INT64, CMD_PARAM_FLAG_UNSIGNED)
+DOVEADM_CMD_PARAM('\0', "mailbox", CMD_PARAM_STR, CMD_PARAM_FLAG_POSITIONAL)
+DOVEADM_CMD_PARAMS_END
+};
@@ -777,6 +777,7 @@ static struct doveadm_cmd_ver2 *mail_commands_ver2[] = {
 	&doveadm_cmd_mailbox_unsubscribe_ver2,
 	&doveadm_cmd_mailbox_update_ver2,
 	&doveadm_cmd_mailbox_path_ver2,
+	&doveadm_cmd_mailbox_generate_ver2,
 	&doveadm_cmd_fetch_ver2,
 	&doveadm_cmd_save_ver2,
 	&doveadm_cmd_index_ver2,
@@ -870,6 +871,15 @@ doveadm_cmdv2_wrapper_parse_common_options(struct doveadm_mail_cmd_context *mctx
 	    doveadm_settings->doveadm_worker_count == 0)
 		doveadm_settings->doveadm_worker_count = 1;
 
+	unsigned int parallel_count;
+	if (doveadm_cmd_param_uint32(cctx, "parallel", &parallel_count) &&
+	    parallel_count > 0 && !doveadm_server) {
+		/* fan the per-user commands out to the (local) doveadm
+		   server, which runs each of them in its own worker
+		   process */
+		doveadm_settings->doveadm_worker_count = parallel_count;
+	}
+
 	if (doveadm_cmd_param_istream(cctx, "file", &mctx->cmd_input))
 		i_stream_ref(mctx->cmd_input);
 
@@ -884,6 +894,7 @@ doveadm_cmdv2_wrapper_generate_full_arg(struct doveadm_mail_cmd_context *mctx,
 {
 	if (!arg->value_set ||
 	    strcmp(arg->name, "socket-path") == 0 ||
+	    strcmp(arg->name, "parallel") == 0 ||
 	    strcmp(arg->name, "trans-flags") == 0 ||
 	    strcmp(arg->name, "file") == 0 ||
 	    strcmp(arg->name, "all-users") == 0 ||
@@ -103,6 +103,7 @@ dsync_mailbox_state_remove(struct dsync_brain *brain,
 
 void dsync_brain_sync_init_box_states(struct dsync_brain *brain)
 {
+	brain->box_pending_mail_request_count = 0;
 	if (brain->backup_send) {
 		/* we have an exporter, but no importer. */
 		brain->box_send_state = DSYNC_BOX_STATE_ATTRIBUTES;
@@ -8,6 +8,13 @@
 #include "dsync-mailbox-export.h"
 #include "dsync-brain-private.h"
 
+/* With mail_requests enabled, start exporting mails once this many requests
+   have been received instead of waiting for the remote's complete request
+   list. Each window becomes a single mailbox search, so it must be large
+   enough to keep the number of separate searches low, but small enough that
+   the connection isn't left idle for a request list round-trip. */
+#define DSYNC_MAIL_REQUEST_WINDOW_COUNT 256
+
 const char *dsync_box_state_names[] = {
 	"mailbox",
 	"changes",
@@ -204,6 +211,7 @@ static bool dsync_brain_recv_mail_request(struct dsync_brain *brain)
 		return TRUE;
 	}
 	dsync_mailbox_export_want_mail(brain->box_exporter, request);
+	brain->box_pending_mail_request_count++;
 	return TRUE;
 }
 
@@ -315,20 +323,32 @@ static bool dsync_brain_recv_mail(struct dsync_brain *brain)
 static bool dsync_brain_send_mail(struct dsync_brain *brain)
 {
 	const struct dsync_mail *mail;
+	int ret;
 
 	if (brain->mail_requests &&
-	    brain->box_recv_state < DSYNC_BOX_STATE_MAILS) {
-		/* wait for mail requests to finish. we could already start
-		   exporting, but then we're going to do quite a lot of
+	    brain->box_recv_state < DSYNC_BOX_STATE_MAILS &&
+	    brain->box_pending_mail_request_count <
+			DSYNC_MAIL_REQUEST_WINDOW_COUNT) {
+		/* wait for more mail requests. we could export the pending
+		   ones already, but then we're going to do quite a lot of
 		   separate searches. especially with pipe backend we'd do
 		   a separate search for each mail. */
 		return FALSE;
 	}
 
-	while (dsync_mailbox_export_next_mail(brain->box_exporter, &mail) > 0) {
+	while ((ret = dsync_mailbox_export_next_mail(brain->box_exporter,
+						     &mail)) > 0) {
 		if (dsync_ibc_send_mail(brain->ibc, mail) == 0)
 			return TRUE;
 	}
+	if (ret == 0 && brain->mail_requests &&
+	    brain->box_recv_state < DSYNC_BOX_STATE_MAILS) {
+		/* all the requests received so far have been exported, but
+		   the remote hasn't finished its request list yet. wait for
+		   the next window of requests before searching again. */
+		brain->box_pending_mail_request_count = 0;
+		return FALSE;
+	}
 
 	if (dsync_brain_export_deinit(brain) < 0)
 		return TRUE;
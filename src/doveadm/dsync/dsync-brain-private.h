@@ -81,6 +81,9 @@ struct dsync_brain {
 	enum dsync_state state, pre_box_state;
 	enum dsync_box_state box_recv_state;
 	enum dsync_box_state box_send_state;
+	/* mail requests received since the exporter last searched for the
+	   requested mails */
+	unsigned int box_pending_mail_request_count;
 	unsigned int proctitle_update_counter;
 
 	struct dsync_transaction_log_scan *log_scan;
@@ -2,6 +2,7 @@
 
 #include "lib.h"
 #include "array.h"
+#include "hash.h"
 #include "ioloop.h"
 #include "fdpass.h"
 #include "hostpid.h"
@@ -60,6 +61,8 @@ struct imap_client {
 	struct priorityq_item item;
 
 	struct imap_client *prev, *next;
+	/* clients of the same user, linked from imap_clients_by_user */
+	struct imap_client *user_prev, *user_next;
 	pool_t pool;
 	struct event *event;
 	struct imap_client_state state;
@@ -84,6 +87,12 @@ struct imap_client {
 };
 
 static struct imap_client *imap_clients;
+/* username => the user's first client. A hibernation process is expected to
+   hold a very large number of clients, so per-user kicks can't just walk the
+   global client list. The other clients of the same user are reached via
+   user_prev/user_next, and the hash key always points to the first client's
+   username. */
+static HASH_TABLE(const char *, struct imap_client *) imap_clients_by_user;
 static struct priorityq *unhibernate_queue;
 static struct timeout *to_unhibernate;
 static const char imap_still_here_text[] = "* OK Still here\r\n";
@@ -644,6 +653,13 @@ imap_client_create(int fd, const struct imap_client_state *state)
 
 	p_array_init(&client->notifys, pool, 2);
 	DLLIST_PREPEND(&imap_clients, client);
+
+	struct imap_client *first =
+		hash_table_lookup(imap_clients_by_user, client->state.username);
+	if (first != NULL)
+		hash_table_remove(imap_clients_by_user, first->state.username);
+	DLLIST_PREPEND_FULL(&first, client, user_prev, user_next);
+	hash_table_insert(imap_clients_by_user, client->state.username, first);
 	return client;
 }
 
@@ -710,6 +726,14 @@ void imap_client_destroy(struct imap_client **_client, const char *reason)
 	}
 
 	DLLIST_REMOVE(&imap_clients, client);
+
+	struct imap_client *first =
+		hash_table_lookup(imap_clients_by_user, client->state.username);
+	hash_table_remove(imap_clients_by_user, first->state.username);
+	DLLIST_REMOVE_FULL(&first, client, user_prev, user_next);
+	if (first != NULL)
+		hash_table_insert(imap_clients_by_user, first->state.username, first);
+
 	imap_client_stop(client);
 	i_stream_destroy(&client->input);
 	o_stream_destroy(&client->output);
@@ -799,18 +823,22 @@ unsigned int imap_clients_kick(const char *user, const guid_128_t conn_guid)
 	struct imap_client *client, *next;
 	unsigned int count = 0;
 
-	for (client = imap_clients; client != NULL; client = next) {
-		next = client->next;
-		if (strcmp(client->state.username, user) == 0 &&
-		    (guid_128_is_empty(conn_guid) ||
-		     guid_128_cmp(client->state.anvil_conn_guid, conn_guid) == 0))
+	client = hash_table_lookup(imap_clients_by_user, user);
+	for (; client != NULL; client = next) {
+		next = client->user_next;
+		if (guid_128_is_empty(conn_guid) ||
+		    guid_128_cmp(client->state.anvil_conn_guid, conn_guid) == 0) {
 			imap_client_kick(client);
+			count++;
+		}
 	}
 	return count;
 }
 
 void imap_clients_init(void)
 {
+	hash_table_create(&imap_clients_by_user, default_pool, 0,
+			  str_hash, strcmp);
 	unhibernate_queue = priorityq_init(client_unhibernate_cmp, 64);
 }
 
@@ -821,4 +849,5 @@ void imap_clients_deinit(void)
 
 	timeout_remove(&to_unhibernate);
 	priorityq_deinit(&unhibernate_queue);
+	hash_table_destroy(&imap_clients_by_user);
 }
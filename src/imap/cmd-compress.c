@@ -27,11 +27,10 @@ static void client_skip_line(struct client *client)
 static void client_update_imap_parser_streams(struct client *client)
 {
 	struct client_command_context *cmd;
+	struct imap_parser *parser;
 
-	if (client->free_parser != NULL) {
-		imap_parser_set_streams(client->free_parser,
-					client->input, client->output);
-	}
+	array_foreach_elem(&client->free_parsers, parser)
+		imap_parser_set_streams(parser, client->input, client->output);
 
 	for (cmd = client->command_queue; cmd != NULL; cmd = cmd->next) {
 		imap_parser_set_streams(cmd->parser,
@@ -31,6 +31,7 @@ struct cmd_copy_context {
 	ARRAY_TYPE(seq_range) src_uids;
 	ARRAY_TYPE(seq_range) saved_uids;
 	bool hide_saved_uids;
+	bool last_batch;
 
 	const char *error_string;
 	enum mail_error mail_error;
@@ -116,6 +117,12 @@ static int fetch_and_copy(struct cmd_copy_context *copy_ctx,
 		return 0;
 	}
 
+	/* does this batch cover all the remaining mails? the final batch's
+	   source expunges can be left for the cmd_sync() that follows. */
+	copy_ctx->last_batch = copy_ctx->copy_count +
+		seq_range_count(&uid_search_args->args->value.seqset) ==
+		copy_ctx->copy_goal;
+
 	i_assert(o_stream_is_corked(client->output) ||
 		 client->output->stream_errno != 0);
 
@@ -253,10 +260,15 @@ static int fetch_and_copy(struct cmd_copy_context *copy_ctx,
 		/* move failed, don't expunge anything */
 		mailbox_transaction_rollback(&src_trans);
 	} else {
-		/* move succeeded */
+		/* move succeeded. sync the expunges between batches, so an
+		   aborted MOVE can't leave large numbers of mails duplicated
+		   in both mailboxes. for the last batch the expunges are
+		   handled by the following cmd_sync(), the same way as when
+		   moving within the selected mailbox. */
 		if (mailbox_transaction_commit(&src_trans) < 0 ||
-		    mailbox_sync(copy_ctx->srcbox,
-				 MAILBOX_SYNC_FLAG_EXPUNGE) < 0) {
+		    (!copy_ctx->last_batch &&
+		     mailbox_sync(copy_ctx->srcbox,
+				  MAILBOX_SYNC_FLAG_EXPUNGE) < 0)) {
 			copy_ctx->error_string =
 				mailbox_get_last_error(copy_ctx->srcbox, &copy_ctx->mail_error);
 			ret = -1;
@@ -140,6 +140,8 @@ struct client *client_create(int fd_in, int fd_out, bool unhibernated,
 					   set->imap_max_line_length);
 	client->output = o_stream_create_fd(fd_out, SIZE_MAX);
 	o_stream_set_no_error_handling(client->output, TRUE);
+	/* send output from pipelined commands with a single writev() */
+	o_stream_set_batch_flush(client->output, TRUE);
 	i_stream_set_name(client->input, "<imap client>");
 	o_stream_set_name(client->output, "<imap client>");
 
@@ -156,6 +158,8 @@ struct client *client_create(int fd_in, int fd_out, bool unhibernated,
 	client->notify_count_changes = TRUE;
 	client->notify_flag_changes = TRUE;
 	p_array_init(&client->enabled_features, client->pool, 8);
+	p_array_init(&client->free_parsers, client->pool,
+		     CLIENT_COMMAND_QUEUE_MAX_SIZE);
 
 	client->capability_string =
 		str_new(client->pool, sizeof(CAPABILITY_STRING)+64);
@@ -518,8 +522,10 @@ static void client_default_destroy(struct client *client, const char *reason)
 						client->anvil_conn_guid);
 	}
 
-	if (client->free_parser != NULL)
-		imap_parser_unref(&client->free_parser);
+	struct imap_parser *parser;
+	array_foreach_elem(&client->free_parsers, parser)
+		imap_parser_unref(&parser);
+	array_clear(&client->free_parsers);
 	io_remove(&client->io);
 	timeout_remove(&client->to_idle_output);
 	timeout_remove(&client->to_idle);
@@ -965,9 +971,11 @@ client_command_new(struct client *client)
 	struct client_command_context *cmd;
 
 	cmd = client_command_alloc(client);
-	if (client->free_parser != NULL) {
-		cmd->parser = client->free_parser;
-		client->free_parser = NULL;
+	if (array_count(&client->free_parsers) > 0) {
+		unsigned int idx = array_count(&client->free_parsers) - 1;
+
+		cmd->parser = array_idx_elem(&client->free_parsers, idx);
+		array_delete(&client->free_parsers, idx, 1);
 	} else {
 		cmd->parser =
 			imap_parser_create(client->input, client->output,
@@ -1031,15 +1039,31 @@ void client_command_free(struct client_command_context **_cmd)
 	event_add_int(cmd->event, "net_in_bytes", cmd->stats.bytes_in);
 	event_add_int(cmd->event, "net_out_bytes", cmd->stats.bytes_out);
 
+	if (!cmd->internal &&
+	    client->set->imap_slow_command_warn_threshold > 0) {
+		int total_msecs = timeval_diff_msecs(
+			&cmd->stats.last_run_timeval, &cmd->stats.start_time);
+		if (total_msecs >= 0 &&
+		    (unsigned int)total_msecs >=
+		    client->set->imap_slow_command_warn_threshold) {
+			string_t *str = t_str_new(128);
+			client_command_stats_append(str, &cmd->stats, "", 0);
+			e_warning(cmd->event, "Slow command: %s (%d.%03d secs total, %s)",
+				  cmd->name, total_msecs/1000,
+				  total_msecs%1000, str_c(str));
+		}
+	}
+
 	e_debug(cmd->event, "Command finished: %s %s", cmd->name,
 		cmd->human_args != NULL ? cmd->human_args : "");
 	event_unref(&cmd->event);
 	event_unref(&cmd->global_event);
 
 	if (cmd->parser != NULL) {
-		if (client->free_parser == NULL) {
+		if (array_count(&client->free_parsers) <
+		    CLIENT_COMMAND_QUEUE_MAX_SIZE) {
 			imap_parser_reset(cmd->parser);
-			client->free_parser = cmd->parser;
+			array_push_back(&client->free_parsers, &cmd->parser);
 		} else {
 			imap_parser_unref(&cmd->parser);
 		}
@@ -185,7 +185,9 @@ struct client {
 	unsigned int bad_counter;
 
 	/* one parser is kept here to be used for new commands */
-	struct imap_parser *free_parser;
+	/* recently finished commands' parsers, kept for reuse so pipelined
+	   commands don't recreate a parser (and its pool) each time */
+	ARRAY(struct imap_parser *) free_parsers;
 	/* command_pool is cleared when the command queue gets empty */
 	pool_t command_pool;
 	/* New commands are always prepended to the queue */
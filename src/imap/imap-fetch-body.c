@@ -105,7 +105,11 @@ static int fetch_stream_continue(struct imap_fetch_context *ctx)
 	uoff_t orig_input_offset = state->cur_input->v_offset;
 	enum ostream_send_istream_result res;
 
-	o_stream_set_max_buffer_size(ctx->client->output, 0);
+	/* allow buffering the literal up to the write-behind limit, so we
+	   keep reading the mail while the client's socket is blocked. with
+	   the limit at 0 nothing gets buffered beyond the blocking point. */
+	o_stream_set_max_buffer_size(ctx->client->output,
+		ctx->client->set->imap_fetch_write_behind_size);
 	res = o_stream_send_istream(ctx->client->output, state->cur_input);
 	o_stream_set_max_buffer_size(ctx->client->output, SIZE_MAX);
 
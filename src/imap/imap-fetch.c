@@ -404,6 +404,12 @@ void imap_fetch_begin(struct imap_fetch_context *ctx, struct mailbox *box,
 	ctx->state.search_ctx =
 		mailbox_search_init(ctx->state.trans, search_args, NULL,
 				    ctx->fetch_data, wanted_headers);
+	if ((ctx->fetch_data & (MAIL_FETCH_STREAM_HEADER |
+				MAIL_FETCH_STREAM_BODY)) == 0) {
+		/* metadata-only FETCH - the mail files are never read, so
+		   don't waste memory on a prefetch window. */
+		mailbox_search_set_prefetch_window(ctx->state.search_ctx, 0);
+	}
 	ctx->state.cur_str = str_new(default_pool, 8192);
 	ctx->state.fetching = TRUE;
 
@@ -525,8 +531,16 @@ static int imap_fetch_more_int(struct imap_fetch_context *ctx, bool cancel)
 		if (o_stream_get_buffer_used_size(client->output) >=
 		    CLIENT_OUTPUT_OPTIMAL_SIZE) {
 			ret = o_stream_flush(client->output);
-			if (ret <= 0)
+			if (ret < 0)
 				return ret;
+			if (ret == 0 &&
+			    o_stream_get_buffer_used_size(client->output) >=
+			    client->set->imap_fetch_write_behind_size) {
+				/* the client isn't reading fast enough and
+				   we've buffered as much write-behind data as
+				   allowed. wait for the buffer to drain. */
+				return 0;
+			}
 		}
 
 		if (state->cur_mail == NULL) {
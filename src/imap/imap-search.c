@@ -199,6 +199,31 @@ static void imap_search_result_save(struct imap_search_context *ctx)
 	ctx->fetch_ctx = NULL;
 }
 
+static void
+imap_search_send_seq_range(struct client *client, string_t *str,
+			   const ARRAY_TYPE(seq_range) *array)
+{
+	const struct seq_range *range;
+	unsigned int i, count;
+
+	/* write the ranges as they're produced instead of building the full
+	   UID set string in memory first - with millions of results it would
+	   grow to several megabytes. */
+	range = array_get(array, &count);
+	for (i = 0; i < count; i++) {
+		if (i > 0)
+			str_append_c(str, ',');
+		str_printfa(str, "%u", range[i].seq1);
+		if (range[i].seq1 != range[i].seq2)
+			str_printfa(str, ":%u", range[i].seq2);
+		if (str_len(str) >= 1024-32) {
+			o_stream_nsend(client->output,
+				       str_data(str), str_len(str));
+			str_truncate(str, 0);
+		}
+	}
+}
+
 static void imap_search_send_result_standard(struct imap_search_context *ctx)
 {
 	const struct seq_range *range;
@@ -233,7 +258,8 @@ imap_search_send_partial(struct imap_search_context *ctx, string_t *str)
 		/* no results (in range) */
 		str_append(str, "NIL");
 	} else {
-		imap_write_seq_range(str, &ctx->result);
+		imap_search_send_seq_range(ctx->cmd->client, str,
+					   &ctx->result);
 	}
 	str_append_c(str, ')');
 }
@@ -302,7 +328,7 @@ static void imap_search_send_result(struct imap_search_context *ctx)
 	if ((ctx->return_options & SEARCH_RETURN_ALL) != 0 &&
 	    array_count(&ctx->result) > 0) {
 		str_append(str, " ALL ");
-		imap_write_seq_range(str, &ctx->result);
+		imap_search_send_seq_range(client, str, &ctx->result);
 	}
 	if ((ctx->return_options & SEARCH_RETURN_RELEVANCY) != 0) {
 		str_append(str, " RELEVANCY (");
@@ -95,9 +95,11 @@ static const struct setting_define imap_setting_defines[] = {
 	DEF(STR, imap_logout_format),
 	DEF(STR, imap_id_send),
 	DEF(ENUM, imap_fetch_failure),
+	DEF(SIZE, imap_fetch_write_behind_size),
 	DEF(BOOL, imap_metadata),
 	DEF(BOOL, imap_literal_minus),
 	DEF(TIME, imap_hibernate_timeout),
+	DEF(TIME_MSECS, imap_slow_command_warn_threshold),
 
 	DEF(STR, imap_urlauth_host),
 	DEF(IN_PORT, imap_urlauth_port),
@@ -122,9 +124,11 @@ static const struct imap_settings imap_default_settings = {
 		"body_count=%{fetch_body_count} body_bytes=%{fetch_body_bytes}",
 	.imap_id_send = "name *",
 	.imap_fetch_failure = "disconnect-immediately:disconnect-after:no-after",
+	.imap_fetch_write_behind_size = 0,
 	.imap_metadata = FALSE,
 	.imap_literal_minus = FALSE,
 	.imap_hibernate_timeout = 0,
+	.imap_slow_command_warn_threshold = 0,
 
 	.imap_urlauth_host = "",
 	.imap_urlauth_port = 143
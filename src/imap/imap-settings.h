@@ -31,9 +31,11 @@ struct imap_settings {
 	const char *imap_logout_format;
 	const char *imap_id_send;
 	const char *imap_fetch_failure;
+	uoff_t imap_fetch_write_behind_size;
 	bool imap_metadata;
 	bool imap_literal_minus;
 	unsigned int imap_hibernate_timeout;
+	unsigned int imap_slow_command_warn_threshold;
 
 	/* imap urlauth: */
 	const char *imap_urlauth_host;
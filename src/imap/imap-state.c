@@ -143,39 +143,28 @@ int imap_state_import_external(struct client *client,
 
 static int
 imap_state_export_mailbox_mails(buffer_t *dest, struct mailbox *box,
-				const char **error_r)
+				const char **error_r ATTR_UNUSED)
 {
-	struct mailbox_transaction_context *trans;
-	struct mail_search_args *search_args;
-	struct mail_search_context *search_ctx;
-	struct mail *mail;
 	ARRAY_TYPE(seq_range) recent_uids;
-	uint32_t crc = 0;
-	int ret = 1;
-
-	search_args = mail_search_build_init();
-	mail_search_build_add_all(search_args);
-
-	trans = mailbox_transaction_begin(box, 0,
-				"unhibernate imap_state_export_mailbox_mails");
-	search_ctx = mailbox_search_init(trans, search_args, NULL, 0, NULL);
-	mail_search_args_unref(&search_args);
+	const struct mail_index_header *hdr;
+	uint32_t seq, uid, crc = 0;
 
+	/* this runs at the moment the hibernate decision fires, so read
+	   everything straight from the index view instead of dragging a
+	   mail object through the search machinery for every message.
+	   the UIDs and the session's \Recent set are all in memory. */
 	t_array_init(&recent_uids, 8);
-	while (mailbox_search_next(search_ctx, &mail)) {
-		crc = crc32_data_more(crc, &mail->uid, sizeof(mail->uid));
-		if ((mail_get_flags(mail) & MAIL_RECENT) != 0)
-			seq_range_array_add(&recent_uids, mail->uid);
-	}
-	if (mailbox_search_deinit(&search_ctx) < 0) {
-		*error_r = mailbox_get_last_internal_error(box, NULL);
-		ret = -1;
+	hdr = mail_index_get_header(box->view);
+	for (seq = 1; seq <= hdr->messages_count; seq++) {
+		mail_index_lookup_uid(box->view, seq, &uid);
+		crc = crc32_data_more(crc, &uid, sizeof(uid));
+		if (mailbox_recent_flags_have_uid(box, uid))
+			seq_range_array_add(&recent_uids, uid);
 	}
-	(void)mailbox_transaction_commit(&trans);
 
 	numpack_encode(dest, crc);
 	export_seq_range(dest, &recent_uids);
-	return ret;
+	return 1;
 }
 
 static uint32_t
@@ -1,7 +1,9 @@
 /* Copyright (c) 2002-2018 Dovecot authors, see the included COPYING file */
 
 #include "imap-common.h"
+#include "array.h"
 #include "ioloop.h"
+#include "lib-signals.h"
 #include "istream.h"
 #include "ostream.h"
 #include "path-util.h"
@@ -156,6 +158,56 @@ static void imap_die(void)
 	}
 }
 
+ARRAY_DEFINE_TYPE(mempool_acct_stats, struct mempool_acct_stats);
+
+static void mempool_acct_collect(const struct mempool_acct_stats *stats,
+				 void *context)
+{
+	ARRAY_TYPE(mempool_acct_stats) *pools = context;
+
+	array_push_back(pools, stats);
+}
+
+static int mempool_acct_stats_cmp(const struct mempool_acct_stats *stats1,
+				  const struct mempool_acct_stats *stats2)
+{
+	/* the largest live pools first */
+	if (stats1->live_bytes > stats2->live_bytes)
+		return -1;
+	if (stats1->live_bytes < stats2->live_bytes)
+		return 1;
+	return strcmp(stats1->name, stats2->name);
+}
+
+static void sig_mempool_stats(const siginfo_t *si ATTR_UNUSED,
+			      void *context ATTR_UNUSED)
+{
+	ARRAY_TYPE(mempool_acct_stats) pools;
+	const struct mempool_acct_stats *stats;
+	struct mempool_slab_stats slab_stats;
+	uint64_t total_live = 0, total_peak = 0;
+
+	t_array_init(&pools, 64);
+	mempool_acct_foreach(mempool_acct_collect, &pools);
+	array_sort(&pools, mempool_acct_stats_cmp);
+	array_foreach(&pools, stats) {
+		total_live += stats->live_bytes;
+		total_peak += stats->peak_bytes;
+		i_info("Memory pool %s: %"PRIu64" bytes live / "
+		       "%"PRIu64" peak, %"PRIu64" pools, "
+		       "%"PRIu64" block allocs",
+		       stats->name, stats->live_bytes, stats->peak_bytes,
+		       stats->live_pools, stats->block_allocs);
+	}
+	mempool_slab_stats_get(&slab_stats);
+	i_info("Memory pools total: %"PRIu64" bytes live, "
+	       "%"PRIu64" bytes peak sum, block cache %"PRIu64" bytes in "
+	       "%"PRIu64" blocks (%"PRIu64" hits, %"PRIu64" misses)",
+	       total_live, total_peak,
+	       slab_stats.cached_bytes, slab_stats.cached_count,
+	       slab_stats.hits, slab_stats.misses);
+}
+
 struct imap_login_request {
 	const char *tag;
 
@@ -571,6 +623,11 @@ int main(int argc, char *argv[])
 	/* NOTE: login_set.*_socket_path are now invalid due to data stack
 	   having been freed */
 
+	/* SIGUSR2 logs per-pool-name memory accounting for debugging
+	   RSS growth */
+	lib_signals_set_handler(SIGUSR2, LIBSIG_FLAGS_SAFE,
+				sig_mempool_stats, NULL);
+
 	/* fake that we're running, so we know if client was destroyed
 	   while handling its initial input */
 	io_loop_set_running(current_ioloop);
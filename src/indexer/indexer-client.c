@@ -16,7 +16,7 @@
 #define MAX_INBUF_SIZE (1024*64)
 
 #define INDEXER_CLIENT_PROTOCOL_MAJOR_VERSION 1
-#define INDEXER_CLIENT_PROTOCOL_MINOR_VERSION 0
+#define INDEXER_CLIENT_PROTOCOL_MINOR_VERSION 1
 
 struct indexer_client {
 	struct connection conn;
@@ -164,6 +164,20 @@ indexer_client_request_list_write(string_t *str,
 		str_append_c(str, 'h');
 	if (request->reindex_tail)
 		str_append_c(str, 't');
+	str_append_c(str, '\t');
+	switch (request->priority) {
+	case INDEXER_REQUEST_PRIORITY_INTERACTIVE:
+		str_append_c(str, 'i');
+		break;
+	case INDEXER_REQUEST_PRIORITY_DELIVERY:
+		str_append_c(str, 'd');
+		break;
+	case INDEXER_REQUEST_PRIORITY_BACKFILL:
+		str_append_c(str, 'b');
+		break;
+	case INDEXER_REQUEST_PRIORITY_COUNT:
+		i_unreached();
+	}
 }
 
 static int
@@ -15,7 +15,11 @@ struct indexer_queue {
 	HASH_TABLE(struct indexer_request *, struct indexer_request *) requests;
 	/* username -> indexer_request */
 	HASH_TABLE(char *, struct indexer_request *) users;
-	struct indexer_request *head, *tail;
+	/* one FIFO per priority - peeking and iterating goes through the
+	   lanes in priority order */
+	struct {
+		struct indexer_request *head, *tail;
+	} lanes[INDEXER_REQUEST_PRIORITY_COUNT];
 };
 
 struct indexer_queue_iter {
@@ -83,6 +87,27 @@ indexer_queue_lookup(struct indexer_queue *queue,
 	return hash_table_lookup(queue->requests, &lookup_request);
 }
 
+static void indexer_queue_lane_append(struct indexer_queue *queue,
+				      struct indexer_request *request)
+{
+	DLLIST2_APPEND(&queue->lanes[request->priority].head,
+		       &queue->lanes[request->priority].tail, request);
+}
+
+static void indexer_queue_lane_prepend(struct indexer_queue *queue,
+				       struct indexer_request *request)
+{
+	DLLIST2_PREPEND(&queue->lanes[request->priority].head,
+			&queue->lanes[request->priority].tail, request);
+}
+
+static void indexer_queue_lane_remove(struct indexer_queue *queue,
+				      struct indexer_request *request)
+{
+	DLLIST2_REMOVE(&queue->lanes[request->priority].head,
+		       &queue->lanes[request->priority].tail, request);
+}
+
 static void request_add_context(struct indexer_request *request, void *context)
 {
 	if (context == NULL)
@@ -95,6 +120,7 @@ static void request_add_context(struct indexer_request *request, void *context)
 
 static struct indexer_request *
 indexer_queue_append_request(struct indexer_queue *queue, bool append,
+			     enum indexer_request_priority priority,
 			     const char *username, const char *mailbox,
 			     const char *session_id,
 			     unsigned int max_recent_msgs, void *context)
@@ -113,14 +139,20 @@ indexer_queue_append_request(struct indexer_queue *queue, bool append,
 				request->reindex_tail = TRUE;
 			else
 				request->reindex_head = TRUE;
+		} else if (priority < request->priority) {
+			/* move the request to the higher priority lane */
+			indexer_queue_lane_remove(queue, request);
+			request->priority = priority;
+			if (append)
+				indexer_queue_lane_append(queue, request);
+			else
+				indexer_queue_lane_prepend(queue, request);
+		} else if (!append && priority == request->priority) {
+			/* move request to the beginning of its lane */
+			indexer_queue_lane_remove(queue, request);
+			indexer_queue_lane_prepend(queue, request);
 		} else {
-			if (append) {
-				/* keep the request in its old position */
-			} else {
-				/* move request to beginning of the queue */
-				DLLIST2_REMOVE(&queue->head, &queue->tail, request);
-				DLLIST2_PREPEND(&queue->head, &queue->tail, request);
-			}
+			/* keep the request in its old position */
 		}
 		return request;
 	}
@@ -130,6 +162,7 @@ indexer_queue_append_request(struct indexer_queue *queue, bool append,
 	request->mailbox = i_strdup(mailbox);
 	request->session_id = i_strdup(session_id);
 	request->max_recent_msgs = max_recent_msgs;
+	request->priority = priority;
 	request_add_context(request, context);
 	hash_table_insert(queue->requests, request, request);
 
@@ -144,9 +177,9 @@ indexer_queue_append_request(struct indexer_queue *queue, bool append,
 	}
 
 	if (append)
-		DLLIST2_APPEND(&queue->head, &queue->tail, request);
+		indexer_queue_lane_append(queue, request);
 	else
-		DLLIST2_PREPEND(&queue->head, &queue->tail, request);
+		indexer_queue_lane_prepend(queue, request);
 	return request;
 }
 
@@ -162,9 +195,17 @@ void indexer_queue_append(struct indexer_queue *queue, bool append,
 			  const char *session_id, unsigned int max_recent_msgs,
 			  void *context)
 {
+	enum indexer_request_priority priority;
 	struct indexer_request *request;
 
-	request = indexer_queue_append_request(queue, append, username, mailbox,
+	if (!append)
+		priority = INDEXER_REQUEST_PRIORITY_INTERACTIVE;
+	else if (max_recent_msgs > 0)
+		priority = INDEXER_REQUEST_PRIORITY_DELIVERY;
+	else
+		priority = INDEXER_REQUEST_PRIORITY_BACKFILL;
+	request = indexer_queue_append_request(queue, append, priority,
+					       username, mailbox,
 					       session_id, max_recent_msgs,
 					       context);
 	request->type = INDEXER_REQUEST_TYPE_INDEX;
@@ -177,7 +218,9 @@ void indexer_queue_append_optimize(struct indexer_queue *queue,
 {
 	struct indexer_request *request;
 
-	request = indexer_queue_append_request(queue, TRUE, username, mailbox,
+	request = indexer_queue_append_request(queue, TRUE,
+					       INDEXER_REQUEST_PRIORITY_BACKFILL,
+					       username, mailbox,
 					       NULL, 0, context);
 	request->type = INDEXER_REQUEST_TYPE_OPTIMIZE;
 	indexer_queue_append_finish(queue);
@@ -185,16 +228,35 @@ void indexer_queue_append_optimize(struct indexer_queue *queue,
 
 struct indexer_request *indexer_queue_request_peek(struct indexer_queue *queue)
 {
-	return queue->head;
+	enum indexer_request_priority priority;
+
+	for (priority = 0; priority < INDEXER_REQUEST_PRIORITY_COUNT; priority++) {
+		if (queue->lanes[priority].head != NULL)
+			return queue->lanes[priority].head;
+	}
+	return NULL;
 }
 
-void indexer_queue_request_remove(struct indexer_queue *queue)
+struct indexer_request *
+indexer_queue_request_next(struct indexer_queue *queue,
+			   struct indexer_request *request)
 {
-	struct indexer_request *request = queue->head;
-
-	i_assert(request != NULL);
+	enum indexer_request_priority priority;
+
+	if (request->next != NULL)
+		return request->next;
+	for (priority = request->priority + 1;
+	     priority < INDEXER_REQUEST_PRIORITY_COUNT; priority++) {
+		if (queue->lanes[priority].head != NULL)
+			return queue->lanes[priority].head;
+	}
+	return NULL;
+}
 
-	DLLIST2_REMOVE(&queue->head, &queue->tail, request);
+void indexer_queue_request_remove(struct indexer_queue *queue,
+				  struct indexer_request *request)
+{
+	indexer_queue_lane_remove(queue, request);
 }
 
 static void indexer_queue_request_status_int(struct indexer_queue *queue,
@@ -218,14 +280,6 @@ void indexer_queue_request_status(struct indexer_queue *queue,
 	indexer_queue_request_status_int(queue, request, status);
 }
 
-void indexer_queue_move_head_to_tail(struct indexer_queue *queue)
-{
-	struct indexer_request *request = queue->head;
-
-	indexer_queue_request_remove(queue);
-	DLLIST2_APPEND(&queue->head, &queue->tail, request);
-}
-
 void indexer_queue_request_work(struct indexer_request *request)
 {
 	request->working = TRUE;
@@ -255,9 +309,9 @@ void indexer_queue_request_finish(struct indexer_queue *queue,
 				     request->working_context_idx);
 		}
 		if (request->reindex_head)
-			DLLIST2_PREPEND(&queue->head, &queue->tail, request);
+			indexer_queue_lane_prepend(queue, request);
 		else
-			DLLIST2_APPEND(&queue->head, &queue->tail, request);
+			indexer_queue_lane_append(queue, request);
 		request->reindex_head = FALSE;
 		request->reindex_tail = FALSE;
 		return;
@@ -292,7 +346,7 @@ indexer_queue_request_cancel(struct indexer_queue *queue,
 
 	*_request = NULL;
 	request->reindex_head = request->reindex_tail = FALSE;
-	DLLIST2_REMOVE(&queue->head, &queue->tail, request);
+	indexer_queue_lane_remove(queue, request);
 	indexer_queue_request_finish(queue, &request, INDEXER_STATE_FAILED);
 }
 
@@ -346,7 +400,7 @@ void indexer_queue_cancel_all(struct indexer_queue *queue)
 
 bool indexer_queue_is_empty(struct indexer_queue *queue)
 {
-	return queue->head == NULL;
+	return indexer_queue_request_peek(queue) == NULL;
 }
 
 unsigned int indexer_queue_count(struct indexer_queue *queue)
@@ -387,7 +441,7 @@ struct indexer_request *indexer_queue_iter_next(struct indexer_queue_iter *iter)
 	}
 	request = iter->next;
 	if (request != NULL)
-		iter->next = request->next;
+		iter->next = indexer_queue_request_next(iter->queue, request);
 	return request;
 }
 
@@ -13,8 +13,20 @@ enum indexer_request_type {
 	INDEXER_REQUEST_TYPE_OPTIMIZE,
 };
 
+enum indexer_request_priority {
+	/* interactive request - somebody (e.g. an IMAP SEARCH) is waiting
+	   for the result */
+	INDEXER_REQUEST_PRIORITY_INTERACTIVE = 0,
+	/* incremental indexing of newly delivered mails */
+	INDEXER_REQUEST_PRIORITY_DELIVERY,
+	/* indexing a mailbox's full backlog, and optimization */
+	INDEXER_REQUEST_PRIORITY_BACKFILL,
+
+	INDEXER_REQUEST_PRIORITY_COUNT
+};
+
 struct indexer_request {
-	/* Linked list of all requests - highest priority first */
+	/* Linked list of the requests within the same priority lane */
 	struct indexer_request *prev, *next;
 	/* Linked list of the same username's requests */
 	struct indexer_request *user_prev, *user_next;
@@ -25,6 +37,7 @@ struct indexer_request {
 	unsigned int max_recent_msgs;
 
 	enum indexer_request_type type;
+	enum indexer_request_priority priority;
 
 	/* currently indexing this mailbox */
 	bool working:1;
@@ -48,6 +61,11 @@ void indexer_queue_deinit(struct indexer_queue **queue);
 void indexer_queue_set_listen_callback(struct indexer_queue *queue,
 				       void (*callback)(struct indexer_queue *));
 
+/* Add an indexing request to the queue. The request's priority lane is
+   derived from the parameters: append=FALSE means somebody is waiting for the
+   result (interactive), append=TRUE with max_recent_msgs>0 is incremental
+   indexing after a delivery, and append=TRUE with max_recent_msgs=0 is a
+   backfill. */
 void indexer_queue_append(struct indexer_queue *queue, bool append,
 			  const char *username, const char *mailbox,
 			  const char *session_id, unsigned int max_recent_msgs,
@@ -65,17 +83,21 @@ void indexer_queue_cancel_all(struct indexer_queue *queue);
 bool indexer_queue_is_empty(struct indexer_queue *queue);
 unsigned int indexer_queue_count(struct indexer_queue *queue);
 
-/* Return the next request from the queue, without removing it. */
+/* Return the highest priority request from the queue, without removing it. */
 struct indexer_request *indexer_queue_request_peek(struct indexer_queue *queue);
-/* Remove the next request from the queue. You must call
+/* Return the queued request following the given one, in priority order.
+   Returns NULL when the given request was the last one. */
+struct indexer_request *
+indexer_queue_request_next(struct indexer_queue *queue,
+			   struct indexer_request *request);
+/* Remove the request from the queue. You must call
    indexer_queue_request_finish() to free its memory. */
-void indexer_queue_request_remove(struct indexer_queue *queue);
+void indexer_queue_request_remove(struct indexer_queue *queue,
+				  struct indexer_request *request);
 /* Give a status update about how far the indexing is going on. */
 void indexer_queue_request_status(struct indexer_queue *queue,
 				  struct indexer_request *request,
 				  const struct indexer_status *status);
-/* Move the next request to the end of the queue. */
-void indexer_queue_move_head_to_tail(struct indexer_queue *queue);
 /* Start working on a request */
 void indexer_queue_request_work(struct indexer_request *request);
 /* Finish the request and free its memory. */
@@ -45,37 +45,28 @@ static bool worker_send_request(struct indexer_request *request)
 					 worker_status_callback,
 					 worker_avail_callback) <= 0)
 		return FALSE;
-	indexer_queue_request_remove(queue);
+	indexer_queue_request_remove(queue, request);
 	indexer_queue_request_work(request);
 	return TRUE;
 }
 
 static void queue_try_send_more(struct indexer_queue *queue)
 {
-	struct worker_connection *worker;
-	struct indexer_request *request, *first_moved_request = NULL;
+	struct indexer_request *request, *next;
 
-	while ((request = indexer_queue_request_peek(queue)) != NULL) {
-		worker = worker_connections_find_user(request->username);
-		if (worker != NULL) {
+	request = indexer_queue_request_peek(queue);
+	while (request != NULL) {
+		next = indexer_queue_request_next(queue, request);
+		if (worker_connections_find_user(request->username) != NULL) {
 			/* There is already a connection handling a request
-			 * for this user. Move the request to the back of the
-			 * queue and handle requests from other users.
-			 * Terminate if we went through all requests. */
-			if (request == first_moved_request) {
-				/* all requests are waiting for existing users
-				   to finish. */
+			   for this user. Leave the request queued in its
+			   place and try requests from other users. */
+		} else {
+			/* create a new connection to a worker */
+			if (!worker_send_request(request))
 				break;
-			}
-			if (first_moved_request == NULL)
-				first_moved_request = request;
-			indexer_queue_move_head_to_tail(queue);
-			continue;
 		}
-
-		/* create a new connection to a worker */
-		if (!worker_send_request(request))
-			break;
+		request = next;
 	}
 }
 
@@ -29,23 +29,26 @@ static void test_indexer_queue(void)
 	test_assert_strcmp(request->username, "user1");
 	test_assert_strcmp(request->mailbox, "mailbox1");
 
-	indexer_queue_move_head_to_tail(queue);
-
+	/* the requests come out in priority order - the prepended
+	   (interactive) requests first even though they were added last,
+	   then the delivery request and the backfill request last */
 	struct {
 		const char *username;
 		const char *mailbox;
+		enum indexer_request_priority priority;
 	} expected[] = {
-		{ "user2", "mailbox2" },
-		{ "user2", "mailbox3" },
-		{ "user1", "mailbox4" },
-		{ "user1", "mailbox1" },
+		{ "user1", "mailbox1", INDEXER_REQUEST_PRIORITY_INTERACTIVE },
+		{ "user2", "mailbox2", INDEXER_REQUEST_PRIORITY_INTERACTIVE },
+		{ "user2", "mailbox3", INDEXER_REQUEST_PRIORITY_DELIVERY },
+		{ "user1", "mailbox4", INDEXER_REQUEST_PRIORITY_BACKFILL },
 	};
 	for (unsigned int i = 0; i < N_ELEMENTS(expected); i++) {
 		request = indexer_queue_request_peek(queue);
 		test_assert_strcmp_idx(request->username, expected[i].username, i);
 		test_assert_strcmp_idx(request->mailbox, expected[i].mailbox, i);
+		test_assert_idx(request->priority == expected[i].priority, i);
 
-		indexer_queue_request_remove(queue);
+		indexer_queue_request_remove(queue, request);
 		indexer_queue_request_finish(queue, &request, INDEXER_STATE_COMPLETED);
 	}
 	test_assert(indexer_queue_request_peek(queue) == NULL);
@@ -54,6 +57,60 @@ static void test_indexer_queue(void)
 	test_end();
 }
 
+static void test_indexer_queue_priority_raise(void)
+{
+	struct indexer_queue *queue;
+	struct indexer_request *request;
+
+	test_begin("indexer queue priority raise");
+	queue = indexer_queue_init(indexer_queue_status_callback);
+
+	/* backfill request, and a delivery request ahead of it */
+	indexer_queue_append(queue, TRUE, "user1", "mailbox1", "session1", 0, NULL);
+	request = indexer_queue_request_peek(queue);
+	test_assert_strcmp(request->mailbox, "mailbox1");
+	test_assert(request->priority == INDEXER_REQUEST_PRIORITY_BACKFILL);
+	indexer_queue_append(queue, TRUE, "user2", "mailbox2", "session2", 50, NULL);
+	test_assert_strcmp(indexer_queue_request_peek(queue)->mailbox,
+			   "mailbox2");
+
+	/* a delivery to the backfilled mailbox raises its priority */
+	indexer_queue_append(queue, TRUE, "user1", "mailbox1", "session1", 50, NULL);
+	test_assert_cmp(indexer_queue_count(queue), ==, 2);
+	test_assert(request->priority == INDEXER_REQUEST_PRIORITY_DELIVERY);
+	/* ..but it was appended to the delivery lane, so it's not first */
+	test_assert_strcmp(indexer_queue_request_peek(queue)->mailbox,
+			   "mailbox2");
+
+	/* an interactive request raises it to the head of the queue */
+	indexer_queue_append(queue, FALSE, "user1", "mailbox1", "session1", 0, NULL);
+	test_assert(request->priority == INDEXER_REQUEST_PRIORITY_INTERACTIVE);
+	test_assert(indexer_queue_request_peek(queue) == request);
+
+	/* requeueing it as a backfill doesn't lower the priority */
+	indexer_queue_append(queue, TRUE, "user1", "mailbox1", "session1", 0, NULL);
+	test_assert(request->priority == INDEXER_REQUEST_PRIORITY_INTERACTIVE);
+	test_assert(indexer_queue_request_peek(queue) == request);
+
+	/* optimization requests go to the backfill lane */
+	indexer_queue_append_optimize(queue, "user3", "mailbox3", NULL);
+	request = indexer_queue_request_next(queue,
+		indexer_queue_request_next(queue,
+			indexer_queue_request_peek(queue)));
+	test_assert_strcmp(request->mailbox, "mailbox3");
+	test_assert(request->priority == INDEXER_REQUEST_PRIORITY_BACKFILL);
+	test_assert(request->type == INDEXER_REQUEST_TYPE_OPTIMIZE);
+
+	while ((request = indexer_queue_request_peek(queue)) != NULL) {
+		indexer_queue_request_remove(queue, request);
+		indexer_queue_request_finish(queue, &request,
+					     INDEXER_STATE_COMPLETED);
+	}
+
+	indexer_queue_deinit(&queue);
+	test_end();
+}
+
 static void test_indexer_queue_repeated_prepend(void)
 {
 	struct indexer_queue *queue;
@@ -68,7 +125,7 @@ static void test_indexer_queue_repeated_prepend(void)
 	test_assert_cmp(indexer_queue_count(queue), ==, 1);
 
 	request = indexer_queue_request_peek(queue);
-	indexer_queue_request_remove(queue);
+	indexer_queue_request_remove(queue, request);
 	indexer_queue_request_finish(queue, &request, INDEXER_STATE_COMPLETED);
 
 	test_assert(indexer_queue_request_peek(queue) == NULL);
@@ -93,7 +150,7 @@ static void test_indexer_queue_reindex(void)
 	test_assert_strcmp(request->mailbox, "mailbox1");
 
 	/* start working on the request */
-	indexer_queue_request_remove(queue);
+	indexer_queue_request_remove(queue, request);
 	indexer_queue_request_work(request);
 	test_assert(request->working);
 
@@ -108,7 +165,7 @@ static void test_indexer_queue_reindex(void)
 	test_assert(!request->working);
 
 	/* start working on the request again */
-	indexer_queue_request_remove(queue);
+	indexer_queue_request_remove(queue, request);
 	indexer_queue_request_work(request);
 	/* append another request to the same mailbox */
 	indexer_queue_append(queue, TRUE, "user1", "mailbox1", "session1", 0, NULL);
@@ -119,12 +176,12 @@ static void test_indexer_queue_reindex(void)
 
 	request = indexer_queue_request_peek(queue);
 	test_assert_strcmp(request->mailbox, "mailbox2");
-	indexer_queue_request_remove(queue);
+	indexer_queue_request_remove(queue, request);
 	indexer_queue_request_finish(queue, &request, INDEXER_STATE_COMPLETED);
 
 	request = indexer_queue_request_peek(queue);
 	test_assert_strcmp(request->mailbox, "mailbox1");
-	indexer_queue_request_remove(queue);
+	indexer_queue_request_remove(queue, request);
 	indexer_queue_request_finish(queue, &request, INDEXER_STATE_COMPLETED);
 
 	test_assert(indexer_queue_request_peek(queue) == NULL);
@@ -159,14 +216,15 @@ static void test_indexer_queue_cancel(void)
 	indexer_queue_cancel(queue, "user1", NULL);
 	request = indexer_queue_request_peek(queue);
 	test_assert_strcmp(request->mailbox, "mailbox2");
-	test_assert_strcmp(request->next->mailbox, "mailbox3");
-	test_assert(request->next->next == NULL);
+	request = indexer_queue_request_next(queue, request);
+	test_assert_strcmp(request->mailbox, "mailbox3");
+	test_assert(indexer_queue_request_next(queue, request) == NULL);
 
 	/* cancel user2's requests one by one */
 	indexer_queue_cancel(queue, "user2", "mailbox2");
 	request = indexer_queue_request_peek(queue);
 	test_assert_strcmp(request->mailbox, "mailbox3");
-	test_assert(request->next == NULL);
+	test_assert(indexer_queue_request_next(queue, request) == NULL);
 
 	indexer_queue_cancel(queue, "user2", "mailbox3");
 	test_assert(indexer_queue_request_peek(queue) == NULL);
@@ -174,7 +232,7 @@ static void test_indexer_queue_cancel(void)
 	/* cancelling a working request should just drop the reindex-flag */
 	indexer_queue_append(queue, TRUE, "user1", "mailbox1", "session1", 0, NULL);
 	request = indexer_queue_request_peek(queue);
-	indexer_queue_request_remove(queue);
+	indexer_queue_request_remove(queue, request);
 	indexer_queue_request_work(request);
 	indexer_queue_append(queue, TRUE, "user1", "mailbox1", "session1", 0, NULL);
 	test_assert(request->reindex_tail);
@@ -215,13 +273,13 @@ static void test_indexer_queue_iter(void)
 	request1 = indexer_queue_request_peek(queue);
 	test_assert_strcmp(request1->username, "user1");
 	test_assert_strcmp(request1->mailbox, "mailbox1");
-	indexer_queue_request_remove(queue);
+	indexer_queue_request_remove(queue, request1);
 	indexer_queue_request_work(request1);
 
 	request2 = indexer_queue_request_peek(queue);
 	test_assert_strcmp(request2->username, "user2");
 	test_assert_strcmp(request2->mailbox, "mailbox2");
-	indexer_queue_request_remove(queue);
+	indexer_queue_request_remove(queue, request2);
 	indexer_queue_request_work(request2);
 
 	/* Iteration shows the requests being worked on first. Their order
@@ -232,9 +290,12 @@ static void test_indexer_queue_iter(void)
 	test_assert((iter_request1 == request1 && iter_request2 == request2) ||
 		    (iter_request1 == request2 && iter_request2 == request1));
 
+	/* the queued requests follow in priority order, crossing from the
+	   delivery lane to the backfill lane */
 	request = indexer_queue_request_peek(queue);
 	test_assert(indexer_queue_iter_next(iter) == request);
-	test_assert(indexer_queue_iter_next(iter) == request->next);
+	test_assert(indexer_queue_iter_next(iter) ==
+		    indexer_queue_request_next(queue, request));
 	test_assert(indexer_queue_iter_next(iter) == NULL);
 	indexer_queue_iter_deinit(&iter);
 
@@ -262,6 +323,7 @@ int main(void)
 {
 	static void (*const test_functions[])(void) = {
 		test_indexer_queue,
+		test_indexer_queue_priority_raise,
 		test_indexer_queue_repeated_prepend,
 		test_indexer_queue_reindex,
 		test_indexer_queue_cancel,
@@ -128,8 +128,18 @@ worker_connection_input_args(struct connection *conn, const char *const *args)
 	};
 	worker_connection_call_callback(worker, &status);
 	if (worker->request == NULL) {
-		/* disconnect after each request */
-		ret = -1;
+		if (ret > 0) {
+			/* The request finished successfully. Keep the
+			   connection and let avail_callback reuse it for the
+			   next queued request, so consecutive requests don't
+			   pay a worker process restart each. */
+			i_free_and_null(worker->request_username);
+			worker->avail_callback();
+		}
+		if (worker->request == NULL) {
+			/* failed, or nothing more queued - disconnect */
+			ret = -1;
+		}
 	}
 
 	return ret;
@@ -193,6 +203,20 @@ void worker_connections_deinit(void)
 	connection_list_deinit(&worker_connections);
 }
 
+static struct worker_connection *worker_connection_find_idle(void)
+{
+	struct connection *conn;
+
+	for (conn = worker_connections->connections; conn != NULL; conn = conn->next) {
+		struct worker_connection *worker =
+			container_of(conn, struct worker_connection, conn);
+
+		if (worker->request == NULL && conn->handshake_received)
+			return worker;
+	}
+	return NULL;
+}
+
 int worker_connection_try_create(const char *socket_path,
 				 struct indexer_request *request,
 				 indexer_status_callback_t *callback,
@@ -201,6 +225,13 @@ int worker_connection_try_create(const char *socket_path,
 	struct worker_connection *conn;
 	unsigned int max_connections;
 
+	/* reuse an idle worker connection if there is one */
+	conn = worker_connection_find_idle();
+	if (conn != NULL) {
+		worker_connection_send_request(conn, request);
+		return 1;
+	}
+
 	max_connections = I_MAX(1, worker_last_process_limit);
 	if (worker_connections->connections_count >= max_connections)
 		return 0;
@@ -231,7 +262,8 @@ struct worker_connection *worker_connections_find_user(const char *username)
 		struct worker_connection *worker =
 			container_of(conn, struct worker_connection, conn);
 
-		if (strcmp(worker->request_username, username) == 0)
+		if (worker->request_username != NULL &&
+		    strcmp(worker->request_username, username) == 0)
 			return worker;
 	}
 	return NULL;
@@ -8,10 +8,11 @@ struct worker_connection;
 
 typedef void worker_available_callback_t(void);
 
-/* Try to create a new worker connection and send a new indexing request for
-   the given username+mailbox. The status callback is called as necessary.
-   Returns 1 if successful, 0 if indexer-worker service's process_limit was
-   already reached, -1 on connect error. */
+/* Send a new indexing request for the given username+mailbox, reusing an
+   idle worker connection if one exists and creating a new one otherwise.
+   The status callback is called as necessary. Returns 1 if successful,
+   0 if indexer-worker service's process_limit was already reached,
+   -1 on connect error. */
 int worker_connection_try_create(const char *socket_path,
 				 struct indexer_request *request,
 				 indexer_status_callback_t *callback,
@@ -11,6 +11,9 @@
 #include "safe-memset.h"
 #include "base64.h"
 #include "buffer.h"
+#include "hash.h"
+#include "hex-binary.h"
+#include "llist.h"
 #include "hmac.h"
 #include "hash-method.h"
 #include "sha1.h"
@@ -19,6 +22,148 @@
 #include "auth-scram.h"
 #include "password-scheme.h"
 
+/* Cache of PBKDF2-derived SCRAM keys, so that clients re-authenticating
+   against a plaintext passdb don't cost thousands of HMAC iterations every
+   time. The credential itself is never stored - entries are keyed by a
+   SHA-256 digest of the hash method, the iteration count and the plaintext.
+   Bounded LRU; disabled until scram_key_cache_init() is called. */
+
+struct scram_key_cache_entry {
+	struct scram_key_cache_entry *prev, *next;
+
+	char *cache_key;
+	unsigned int digest_size;
+
+	unsigned int iter_count;
+	char *salt;
+	unsigned char *stored_key;
+	unsigned char *server_key;
+};
+
+static HASH_TABLE(char *, struct scram_key_cache_entry *) scram_key_cache;
+static struct scram_key_cache_entry *scram_key_cache_head;
+static struct scram_key_cache_entry *scram_key_cache_tail;
+static unsigned int scram_key_cache_limit, scram_key_cache_count;
+
+static char *
+scram_key_cache_key_get(const struct hash_method *hmethod,
+			const char *plaintext, unsigned int rounds)
+{
+	struct sha256_ctx ctx;
+	unsigned char digest[SHA256_RESULTLEN];
+	const char *rounds_str = dec2str(rounds);
+
+	sha256_init(&ctx);
+	sha256_loop(&ctx, hmethod->name, strlen(hmethod->name)+1);
+	sha256_loop(&ctx, rounds_str, strlen(rounds_str)+1);
+	sha256_loop(&ctx, plaintext, strlen(plaintext));
+	sha256_result(&ctx, digest);
+	return i_strdup(binary_to_hex(digest, sizeof(digest)));
+}
+
+static void scram_key_cache_entry_free(struct scram_key_cache_entry *entry)
+{
+	hash_table_remove(scram_key_cache, entry->cache_key);
+	DLLIST2_REMOVE(&scram_key_cache_head, &scram_key_cache_tail, entry);
+	i_assert(scram_key_cache_count > 0);
+	scram_key_cache_count--;
+
+	safe_memset(entry->stored_key, 0, entry->digest_size);
+	safe_memset(entry->server_key, 0, entry->digest_size);
+	i_free(entry->stored_key);
+	i_free(entry->server_key);
+	i_free(entry->salt);
+	i_free(entry->cache_key);
+	i_free(entry);
+}
+
+static bool
+scram_key_cache_lookup(const struct hash_method *hmethod,
+		       const char *plaintext, unsigned int rounds,
+		       unsigned int *iter_count_r, const char **salt_r,
+		       unsigned char stored_key_r[],
+		       unsigned char server_key_r[])
+{
+	struct scram_key_cache_entry *entry;
+	char *cache_key;
+
+	if (!hash_table_is_created(scram_key_cache))
+		return FALSE;
+
+	cache_key = scram_key_cache_key_get(hmethod, plaintext, rounds);
+	entry = hash_table_lookup(scram_key_cache, cache_key);
+	i_free(cache_key);
+	if (entry == NULL)
+		return FALSE;
+	i_assert(entry->digest_size == hmethod->digest_size);
+
+	/* mark the entry as most recently used */
+	DLLIST2_REMOVE(&scram_key_cache_head, &scram_key_cache_tail, entry);
+	DLLIST2_PREPEND(&scram_key_cache_head, &scram_key_cache_tail, entry);
+
+	*iter_count_r = entry->iter_count;
+	*salt_r = t_strdup(entry->salt);
+	memcpy(stored_key_r, entry->stored_key, entry->digest_size);
+	memcpy(server_key_r, entry->server_key, entry->digest_size);
+	return TRUE;
+}
+
+static void
+scram_key_cache_add(const struct hash_method *hmethod,
+		    const char *plaintext, unsigned int rounds,
+		    unsigned int iter_count, const char *salt,
+		    const unsigned char stored_key[],
+		    const unsigned char server_key[])
+{
+	struct scram_key_cache_entry *entry;
+	char *cache_key;
+
+	if (!hash_table_is_created(scram_key_cache))
+		return;
+
+	cache_key = scram_key_cache_key_get(hmethod, plaintext, rounds);
+	if (hash_table_lookup(scram_key_cache, cache_key) != NULL) {
+		i_free(cache_key);
+		return;
+	}
+	while (scram_key_cache_count >= scram_key_cache_limit)
+		scram_key_cache_entry_free(scram_key_cache_tail);
+
+	entry = i_new(struct scram_key_cache_entry, 1);
+	entry->cache_key = cache_key;
+	entry->digest_size = hmethod->digest_size;
+	entry->iter_count = iter_count;
+	entry->salt = i_strdup(salt);
+	entry->stored_key = i_malloc(hmethod->digest_size);
+	memcpy(entry->stored_key, stored_key, hmethod->digest_size);
+	entry->server_key = i_malloc(hmethod->digest_size);
+	memcpy(entry->server_key, server_key, hmethod->digest_size);
+
+	hash_table_insert(scram_key_cache, entry->cache_key, entry);
+	DLLIST2_PREPEND(&scram_key_cache_head, &scram_key_cache_tail, entry);
+	scram_key_cache_count++;
+}
+
+void scram_key_cache_init(unsigned int max_entries)
+{
+	i_assert(!hash_table_is_created(scram_key_cache));
+	i_assert(max_entries > 0);
+
+	scram_key_cache_limit = max_entries;
+	hash_table_create(&scram_key_cache, default_pool, 0,
+			  str_hash, strcmp);
+}
+
+void scram_key_cache_deinit(void)
+{
+	if (!hash_table_is_created(scram_key_cache))
+		return;
+
+	while (scram_key_cache_head != NULL)
+		scram_key_cache_entry_free(scram_key_cache_head);
+	hash_table_destroy(&scram_key_cache);
+}
+
 int scram_scheme_parse(const struct hash_method *hmethod, const char *name,
 		       const unsigned char *credentials, size_t size,
 		       unsigned int *iter_count_r, const char **salt_r,
@@ -121,9 +266,14 @@ void scram_generate(const struct hash_method *hmethod, const char *plaintext,
 	unsigned char server_key[hmethod->digest_size];
 	unsigned char stored_key[hmethod->digest_size];
 
-	auth_scram_generate_key_data(hmethod, plaintext, rounds,
-				     &iter_count, &salt,
-				     stored_key, server_key);
+	if (!scram_key_cache_lookup(hmethod, plaintext, rounds, &iter_count,
+				    &salt, stored_key, server_key)) {
+		auth_scram_generate_key_data(hmethod, plaintext, rounds,
+					     &iter_count, &salt,
+					     stored_key, server_key);
+		scram_key_cache_add(hmethod, plaintext, rounds, iter_count,
+				    salt, stored_key, server_key);
+	}
 
 	str = t_str_new(strlen(salt) + 256);
 	str_printfa(str, "%d,", iter_count);
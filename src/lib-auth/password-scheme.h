@@ -104,6 +104,18 @@ int crypt_verify(const char *plaintext,
 		 const unsigned char *raw_password, size_t size,
 		 const char **error_r);
 
+/* Default size of the derived SCRAM key cache */
+#define SCRAM_KEY_CACHE_DEFAULT_MAX_ENTRIES 1000
+
+/* Enable caching of SCRAM keys derived from plaintext credentials, so
+   repeated scram_generate() calls for the same credential skip the PBKDF2
+   rounds. Intended for the auth process only - with the cache enabled the
+   same generated salt is reused for repeated authentications of the same
+   credential, which mustn't happen when generating entries to be stored in
+   a passdb. */
+void scram_key_cache_init(unsigned int max_entries);
+void scram_key_cache_deinit(void);
+
 int scram_scheme_parse(const struct hash_method *hmethod, const char *name,
 		       const unsigned char *credentials, size_t size,
 		       unsigned int *iter_count_r, const char **salt_r,
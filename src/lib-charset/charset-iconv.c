@@ -12,8 +12,80 @@
 struct charset_translation {
 	iconv_t cd;
 	normalizer_func_t *normalizer;
+	/* charset the descriptor was opened for, used as the cache key when
+	   the translation is freed. NULL when cd isn't used. */
+	char *charset;
 };
 
+/* iconv_open() is surprisingly expensive - it may open and mmap() separate
+   conversion module files - and header decoding creates a new translation
+   for every encoded word. Keep the most recently used descriptors cached
+   for reuse. Dovecot processes are single-threaded, so a process-global
+   cache is safe. */
+#define ICONV_CACHE_MAX_ENTRIES 8
+
+struct iconv_cache_entry {
+	char *charset;
+	iconv_t cd;
+};
+
+static struct iconv_cache_entry iconv_cache[ICONV_CACHE_MAX_ENTRIES];
+static unsigned int iconv_cache_count = 0;
+static bool iconv_cache_atexit_set = FALSE;
+
+static void iconv_cache_free_all(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < iconv_cache_count; i++) {
+		iconv_close(iconv_cache[i].cd);
+		i_free(iconv_cache[i].charset);
+	}
+	iconv_cache_count = 0;
+}
+
+static iconv_t iconv_cache_pop(const char *charset)
+{
+	unsigned int i;
+	iconv_t cd;
+
+	for (i = 0; i < iconv_cache_count; i++) {
+		if (strcasecmp(iconv_cache[i].charset, charset) != 0)
+			continue;
+
+		cd = iconv_cache[i].cd;
+		i_free(iconv_cache[i].charset);
+		iconv_cache_count--;
+		memmove(&iconv_cache[i], &iconv_cache[i + 1],
+			(iconv_cache_count - i) * sizeof(iconv_cache[0]));
+		/* drop any shift state left by the previous user */
+		(void)iconv(cd, NULL, NULL, NULL, NULL);
+		return cd;
+	}
+	return (iconv_t)-1;
+}
+
+static void iconv_cache_push(const char *charset, iconv_t cd)
+{
+	struct iconv_cache_entry *entry;
+
+	if (!iconv_cache_atexit_set) {
+		iconv_cache_atexit_set = TRUE;
+		lib_atexit(iconv_cache_free_all);
+	}
+	if (iconv_cache_count == ICONV_CACHE_MAX_ENTRIES) {
+		/* evict the least recently used entry */
+		iconv_close(iconv_cache[0].cd);
+		i_free(iconv_cache[0].charset);
+		iconv_cache_count--;
+		memmove(&iconv_cache[0], &iconv_cache[1],
+			iconv_cache_count * sizeof(iconv_cache[0]));
+	}
+	entry = &iconv_cache[iconv_cache_count++];
+	entry->charset = i_strdup(charset);
+	entry->cd = cd;
+}
+
 static int
 iconv_charset_to_utf8_begin(const char *charset, normalizer_func_t *normalizer,
 			    struct charset_translation **t_r)
@@ -26,14 +98,19 @@ iconv_charset_to_utf8_begin(const char *charset, normalizer_func_t *normalizer,
 	else {
 		if (strcmp(charset, "UTF-8//TEST") == 0)
 			charset = "UTF-8";
-		cd = iconv_open("UTF-8", charset);
-		if (cd == (iconv_t)-1)
-			return -1;
+		cd = iconv_cache_pop(charset);
+		if (cd == (iconv_t)-1) {
+			cd = iconv_open("UTF-8", charset);
+			if (cd == (iconv_t)-1)
+				return -1;
+		}
 	}
 
 	t = i_new(struct charset_translation, 1);
 	t->cd = cd;
 	t->normalizer = normalizer;
+	if (cd != (iconv_t)-1)
+		t->charset = i_strdup(charset);
 	*t_r = t;
 	return 0;
 }
@@ -41,7 +118,8 @@ iconv_charset_to_utf8_begin(const char *charset, normalizer_func_t *normalizer,
 static void iconv_charset_to_utf8_end(struct charset_translation *t)
 {
 	if (t->cd != (iconv_t)-1)
-		iconv_close(t->cd);
+		iconv_cache_push(t->charset, t->cd);
+	i_free(t->charset);
 	i_free(t);
 }
 
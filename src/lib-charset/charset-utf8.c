@@ -47,6 +47,34 @@ charset_utf8_to_utf8_begin(normalizer_func_t *normalizer)
 	return trans;
 }
 
+/* Returns the position where a trailing incomplete UTF-8 sequence begins,
+   or size if the input doesn't end in the middle of a sequence. Unlike
+   uni_utf8_partial_strlen_n() this looks at only the last few bytes, so
+   the cost doesn't grow with the input size. */
+static size_t charset_utf8_partial_pos(const unsigned char *src, size_t size)
+{
+	/* the longest UTF-8 sequence is 6 bytes, so an incomplete one is
+	   at most a lead byte followed by 4 continuation bytes */
+	size_t i, max_lookback = I_MIN(size, 5);
+	unsigned char c;
+
+	for (i = 1; i <= max_lookback; i++) {
+		c = src[size - i];
+		if (c < 0x80) {
+			/* ASCII can't be incomplete */
+			break;
+		}
+		if ((c & 0xc0) == 0xc0) {
+			/* lead byte of a multibyte sequence */
+			if (uni_utf8_char_bytes(c) > i)
+				return size - i;
+			break;
+		}
+		/* continuation byte - keep looking back */
+	}
+	return size;
+}
+
 enum charset_result
 charset_utf8_to_utf8(normalizer_func_t *normalizer,
 		     const unsigned char *src, size_t *src_size, buffer_t *dest)
@@ -54,7 +82,7 @@ charset_utf8_to_utf8(normalizer_func_t *normalizer,
 	enum charset_result res = CHARSET_RET_OK;
 	size_t pos;
 
-	uni_utf8_partial_strlen_n(src, *src_size, &pos);
+	pos = charset_utf8_partial_pos(src, *src_size);
 	if (pos < *src_size) {
 		i_assert(*src_size - pos <= CHARSET_MAX_PENDING_BUF_SIZE);
 		*src_size = pos;
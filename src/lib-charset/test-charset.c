@@ -26,6 +26,9 @@ static void test_charset_utf8_common(const char *input_charset)
 		enum charset_result result;
 	} tests[] = {
 		{ "p\xC3\xA4\xC3", "p\xC3\xA4", CHARSET_RET_INCOMPLETE_INPUT },
+		{ "longer ascii run 1234\xC3", "longer ascii run 1234",
+		  CHARSET_RET_INCOMPLETE_INPUT },
+		{ "p\xF0\x9F\x98", "p", CHARSET_RET_INCOMPLETE_INPUT },
 		{ "p\xC3\xA4\xC3""a", "p\xC3\xA4"UNICODE_REPLACEMENT_CHAR_UTF8"a", CHARSET_RET_INVALID_INPUT }
 	};
 	string_t *src, *str = t_str_new(256);
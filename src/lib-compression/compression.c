@@ -24,6 +24,9 @@
 #ifndef HAVE_ZSTD
 #  define i_stream_create_zstd NULL
 #  define o_stream_create_zstd NULL
+#  define i_stream_create_zstd_dict NULL
+#  define o_stream_create_zstd_dict NULL
+#  define o_stream_create_zstd_mt NULL
 #  define compression_get_min_level_zstd NULL
 #  define compression_get_default_level_zstd NULL
 #  define compression_get_max_level_zstd NULL
@@ -190,6 +193,9 @@ const struct compression_handler compression_handlers[] = {
 		.is_compressed = is_compressed_zstd,
 		.create_istream = i_stream_create_zstd,
 		.create_ostream = o_stream_create_zstd,
+		.create_istream_dict = i_stream_create_zstd_dict,
+		.create_ostream_dict = o_stream_create_zstd_dict,
+		.create_ostream_mt = o_stream_create_zstd_mt,
 		.get_min_level = compression_get_min_level_zstd,
 		.get_default_level = compression_get_default_level_zstd,
 		.get_max_level = compression_get_max_level_zstd,
@@ -13,6 +13,22 @@ struct compression_handler {
 	bool (*is_compressed)(struct istream *input);
 	struct istream *(*create_istream)(struct istream *input);
 	struct ostream *(*create_ostream)(struct ostream *output, int level);
+	/* Create streams using a trained compression dictionary. NULL if the
+	   handler doesn't support dictionaries. */
+	struct istream *(*create_istream_dict)(struct istream *input,
+					       const void *dict,
+					       size_t dict_size);
+	struct ostream *(*create_ostream_dict)(struct ostream *output,
+					       int level, const void *dict,
+					       size_t dict_size);
+	/* Like create_ostream_dict, but compress with up to the given number
+	   of worker threads (advisory - 0 or an unsupporting library
+	   compresses in the calling thread). NULL if the handler doesn't
+	   support multithreading at all. */
+	struct ostream *(*create_ostream_mt)(struct ostream *output, int level,
+					     const void *dict,
+					     size_t dict_size,
+					     unsigned int workers);
 	/* returns minimum level */
 	int (*get_min_level)(void);
 	/* the default can be -1 (e.g. gz), so the return value of this has to
@@ -1,6 +1,22 @@
 #ifndef IOSTREAM_ZSTD_PRIVATE_H
 #define IOSTREAM_ZSTD_PRIVATE_H 1
 
+/* zstd seekable format: the stream is written as independent frames,
+   followed by a seek table stored in a skippable frame, so reading can
+   start from the frame containing the wanted offset instead of
+   decompressing everything before it. Any zstd decompressor can read the
+   stream, since skippable frames are ignored. */
+#define ZSTD_SEEKABLE_MAGIC 0x8F92EAB1
+#define ZSTD_SEEKABLE_TABLE_MAGIC 0x184D2A5E
+#define ZSTD_SKIPPABLE_MAGIC_MIN 0x184D2A50
+#define ZSTD_SKIPPABLE_MAGIC_MAX 0x184D2A5F
+/* seek table footer: number of frames (LE32) + descriptor + magic (LE32) */
+#define ZSTD_SEEKABLE_FOOTER_SIZE 9
+/* descriptor bit 7 = each seek table entry has a checksum field */
+#define ZSTD_SEEKABLE_DESCRIPTOR_CHECKSUM 0x80
+/* descriptor bits 2..6 must be zero */
+#define ZSTD_SEEKABLE_DESCRIPTOR_RESERVED 0x7c
+
 /* a horrible hack to fix issues when the installed libzstd is lot
    newer than what we were compiled against. */
 static inline ZSTD_ErrorCode zstd_version_errcode(ZSTD_ErrorCode err)
@@ -6,5 +6,9 @@ struct istream *i_stream_create_deflate(struct istream *input);
 struct istream *i_stream_create_bz2(struct istream *input);
 struct istream *i_stream_create_lz4(struct istream *input);
 struct istream *i_stream_create_zstd(struct istream *input);
+/* Like i_stream_create_zstd(), but use the given trained dictionary for
+   frames whose header references its dictionary ID. */
+struct istream *i_stream_create_zstd_dict(struct istream *input,
+					  const void *dict, size_t dict_size);
 
 #endif
@@ -4,7 +4,9 @@
 
 #ifdef HAVE_ZSTD
 
+#include "array.h"
 #include "buffer.h"
+#include "byteorder.h"
 #include "istream-private.h"
 #include "istream-zlib.h"
 
@@ -12,6 +14,13 @@
 #include "zstd_errors.h"
 #include "iostream-zstd-private.h"
 
+struct zstd_istream_frame {
+	/* start of the frame, relative to parent_start_offset */
+	uoff_t comp_offset;
+	/* uncompressed offset of the frame's first byte */
+	uoff_t uncomp_offset;
+};
+
 #ifndef HAVE_ZSTD_GETERRORCODE
 ZSTD_ErrorCode ZSTD_getErrorCode(size_t functionResult)
 {
@@ -40,7 +49,15 @@ struct zstd_istream {
 	/* storage for data */
 	buffer_t *data_buffer;
 
+	/* frames parsed from the stream's seek table, if it has one */
+	ARRAY(struct zstd_istream_frame) frames;
+
+	/* trained compression dictionary, or NULL */
+	unsigned char *dict;
+	size_t dict_size;
+
 	bool hdr_read:1;
+	bool seek_table_read:1;
 	bool marked:1;
 	bool zs_closed:1;
 	/* is there data remaining */
@@ -52,7 +69,12 @@ static void i_stream_zstd_init(struct zstd_istream *zstream)
 	zstream->dstream = ZSTD_createDStream();
 	if (zstream->dstream == NULL)
 		i_fatal_status(FATAL_OUTOFMEM, "zstd: Out of memory");
-	ZSTD_initDStream(zstream->dstream);
+	if (zstream->dict != NULL) {
+		ZSTD_initDStream_usingDict(zstream->dstream, zstream->dict,
+					   zstream->dict_size);
+	} else {
+		ZSTD_initDStream(zstream->dstream);
+	}
 	zstream->input_size = ZSTD_DStreamInSize();
 	if (zstream->frame_buffer == NULL)
 		zstream->frame_buffer = buffer_create_dynamic(default_pool, ZSTD_DStreamInSize());
@@ -87,6 +109,9 @@ static void i_stream_zstd_close(struct iostream_private *stream,
 	if (!zstream->zs_closed)
 		i_stream_zstd_deinit(zstream, FALSE);
 	buffer_free(&zstream->frame_buffer);
+	if (array_is_created(&zstream->frames))
+		array_free(&zstream->frames);
+	i_free(zstream->dict);
 	if (close_parent)
 		i_stream_close(zstream->istream.parent);
 }
@@ -204,11 +229,155 @@ static void i_stream_zstd_reset(struct zstd_istream *zstream)
 	i_stream_zstd_init(zstream);
 }
 
+/* Try to read the seek table from the end of the parent stream. If there is
+   none (or it's corrupted), seeking falls back to decompressing forward from
+   the beginning. */
+static void i_stream_zstd_read_seek_table(struct zstd_istream *zstream)
+{
+	struct istream_private *stream = &zstream->istream;
+	struct istream *parent = stream->parent;
+	const unsigned char *data;
+	size_t size;
+	uoff_t psize, old_offset;
+	uint32_t i, count, magic;
+	unsigned int entry_size;
+	uint8_t descriptor;
+
+	if (zstream->seek_table_read)
+		return;
+	zstream->seek_table_read = TRUE;
+
+	if (!parent->seekable)
+		return;
+	old_offset = parent->v_offset;
+	if (i_stream_get_size(parent, TRUE, &psize) <= 0 ||
+	    psize < stream->parent_start_offset +
+		    8 + ZSTD_SEEKABLE_FOOTER_SIZE)
+		return;
+
+	/* footer: <number of frames (LE32)> <descriptor> <magic (LE32)> */
+	i_stream_seek(parent, psize - ZSTD_SEEKABLE_FOOTER_SIZE);
+	if (i_stream_read_bytes(parent, &data, &size,
+				ZSTD_SEEKABLE_FOOTER_SIZE) <= 0 ||
+	    le32_to_cpu_unaligned(data + 5) != ZSTD_SEEKABLE_MAGIC) {
+		i_stream_seek(parent, old_offset);
+		return;
+	}
+	count = le32_to_cpu_unaligned(data);
+	descriptor = data[4];
+	if ((descriptor & ZSTD_SEEKABLE_DESCRIPTOR_RESERVED) != 0) {
+		/* reserved bits set - some future version of the format */
+		i_stream_seek(parent, old_offset);
+		return;
+	}
+	entry_size = (descriptor & ZSTD_SEEKABLE_DESCRIPTOR_CHECKSUM) != 0 ?
+		12 : 8;
+
+	uoff_t table_size = 8 + (uoff_t)count * entry_size +
+		ZSTD_SEEKABLE_FOOTER_SIZE;
+	if (table_size > psize - stream->parent_start_offset) {
+		i_stream_seek(parent, old_offset);
+		return;
+	}
+	uoff_t table_offset = psize - table_size;
+
+	/* the seek table is a skippable frame:
+	   <magic (LE32)> <frame size (LE32)> <entries> <footer> */
+	i_stream_seek(parent, table_offset);
+	if (i_stream_read_bytes(parent, &data, &size, 8) <= 0) {
+		i_stream_seek(parent, old_offset);
+		return;
+	}
+	magic = le32_to_cpu_unaligned(data);
+	if (magic < ZSTD_SKIPPABLE_MAGIC_MIN ||
+	    magic > ZSTD_SKIPPABLE_MAGIC_MAX ||
+	    le32_to_cpu_unaligned(data + 4) != table_size - 8) {
+		i_stream_seek(parent, old_offset);
+		return;
+	}
+	i_stream_skip(parent, 8);
+
+	/* entries: <compressed size (LE32)> <decompressed size (LE32)>
+	   [<checksum (LE32)>] */
+	i_array_init(&zstream->frames, I_MIN(count, 1024));
+	uoff_t comp_offset = 0, uncomp_offset = 0;
+	for (i = 0; i < count; i++) {
+		struct zstd_istream_frame *frame;
+
+		if (i_stream_read_bytes(parent, &data, &size, entry_size) <= 0)
+			break;
+		frame = array_append_space(&zstream->frames);
+		frame->comp_offset = comp_offset;
+		frame->uncomp_offset = uncomp_offset;
+		comp_offset += le32_to_cpu_unaligned(data);
+		uncomp_offset += le32_to_cpu_unaligned(data + 4);
+		i_stream_skip(parent, entry_size);
+	}
+	if (i < count ||
+	    stream->parent_start_offset + comp_offset != table_offset) {
+		/* the table doesn't match the compressed data - ignore it */
+		array_free(&zstream->frames);
+	}
+	i_stream_seek(parent, old_offset);
+}
+
+/* Returns the frame containing the given uncompressed offset, or the last
+   frame if the offset is past the end. Returns NULL if there is no usable
+   seek table. */
+static const struct zstd_istream_frame *
+i_stream_zstd_frame_find(struct zstd_istream *zstream, uoff_t v_offset)
+{
+	const struct zstd_istream_frame *frame, *best = NULL;
+
+	if (!array_is_created(&zstream->frames))
+		return NULL;
+	array_foreach(&zstream->frames, frame) {
+		if (frame->uncomp_offset > v_offset)
+			break;
+		best = frame;
+	}
+	return best;
+}
+
+static void
+i_stream_zstd_reset_to_frame(struct zstd_istream *zstream,
+			     const struct zstd_istream_frame *frame)
+{
+	struct istream_private *stream = &zstream->istream;
+
+	i_stream_seek(stream->parent,
+		      stream->parent_start_offset + frame->comp_offset);
+	stream->parent_expected_offset =
+		stream->parent_start_offset + frame->comp_offset;
+	stream->skip = stream->pos = 0;
+	stream->istream.v_offset = frame->uncomp_offset;
+	stream->high_pos = 0;
+
+	i_stream_zstd_deinit(zstream, TRUE);
+	i_stream_zstd_init(zstream);
+	/* each frame starts with a full zstd header */
+	zstream->hdr_read = FALSE;
+}
+
 static void
 i_stream_zstd_seek(struct istream_private *stream, uoff_t v_offset, bool mark)
 {
 	struct zstd_istream *zstream =
 		container_of(stream, struct zstd_istream, istream);
+	const struct zstd_istream_frame *frame;
+	uoff_t start_offset = stream->istream.v_offset - stream->skip;
+
+	if (v_offset < start_offset || v_offset > start_offset + stream->pos) {
+		/* seeking outside the buffered data. if the stream has a
+		   seek table, jump to the frame containing the offset
+		   instead of decompressing everything before it. */
+		i_stream_zstd_read_seek_table(zstream);
+		frame = i_stream_zstd_frame_find(zstream, v_offset);
+		if (frame != NULL &&
+		    (v_offset < start_offset ||
+		     frame->uncomp_offset > start_offset + stream->pos))
+			i_stream_zstd_reset_to_frame(zstream, frame);
+	}
 
 	if (i_stream_nonseekable_try_seek(stream, v_offset))
 		return;
@@ -237,17 +406,25 @@ static void i_stream_zstd_sync(struct istream_private *stream)
 		}
 		zstream->last_parent_statbuf = *st;
 	}
+	/* the file changed - the seek table is no longer valid */
+	if (array_is_created(&zstream->frames))
+		array_free(&zstream->frames);
+	zstream->seek_table_read = FALSE;
 	i_stream_zstd_reset(zstream);
 }
 
 struct istream *
-i_stream_create_zstd(struct istream *input)
+i_stream_create_zstd_dict(struct istream *input,
+			  const void *dict, size_t dict_size)
 {
 	struct zstd_istream *zstream;
 
 	zstd_version_check();
 
 	zstream = i_new(struct zstd_istream, 1);
+	if (dict_size > 0)
+		zstream->dict = i_memdup(dict, dict_size);
+	zstream->dict_size = dict_size;
 
 	i_stream_zstd_init(zstream);
 
@@ -265,4 +442,10 @@ i_stream_create_zstd(struct istream *input)
 			       i_stream_get_fd(input), 0);
 }
 
+struct istream *
+i_stream_create_zstd(struct istream *input)
+{
+	return i_stream_create_zstd_dict(input, NULL, 0);
+}
+
 #endif
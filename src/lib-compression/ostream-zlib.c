@@ -9,6 +9,12 @@
 #define CHUNK_SIZE (1024*32)
 #define ZLIB_OS_CODE 0x03  /* Unix */
 
+/* after each this many input bytes, look at the achieved compression ratio
+   and adapt the compression level: incompressible data (e.g. already
+   compressed attachments) gets Z_BEST_SPEED to save CPU, and the configured
+   level is restored once the data compresses again. */
+#define ZLIB_ADAPT_SAMPLE_SIZE (256*1024)
+
 struct zlib_ostream {
 	struct ostream_private ostream;
 	z_stream zs;
@@ -19,6 +25,8 @@ struct zlib_ostream {
 	unsigned int header_bytes_left;
 
 	uint32_t crc, bytes32;
+	int level, cur_level;
+	uint64_t sample_in, sample_out;
 
 	bool gz:1;
 	bool flushed:1;
@@ -125,15 +133,44 @@ static int o_stream_zlib_send_outbuf(struct zlib_ostream *zstream)
 	return 1;
 }
 
+static void o_stream_zlib_adapt_level(struct zlib_ostream *zstream)
+{
+	int new_level;
+
+	if (zstream->sample_in < ZLIB_ADAPT_SAMPLE_SIZE ||
+	    zstream->level <= Z_BEST_SPEED)
+		return;
+
+	if (zstream->sample_out >= zstream->sample_in -
+	    zstream->sample_in / 16) {
+		/* data is (mostly) incompressible - stop wasting CPU on it */
+		new_level = Z_BEST_SPEED;
+	} else {
+		new_level = zstream->level;
+	}
+	if (new_level != zstream->cur_level) {
+		/* deflateParams() fails with Z_BUF_ERROR if there's no room
+		   for the pending output. keep the old level then and try
+		   again after the next sample. */
+		if (deflateParams(&zstream->zs, new_level,
+				  Z_DEFAULT_STRATEGY) == Z_OK)
+			zstream->cur_level = new_level;
+	}
+	zstream->sample_in = zstream->sample_out = 0;
+}
+
 static ssize_t
 o_stream_zlib_send_chunk(struct zlib_ostream *zstream,
 			 const void *data, size_t size)
 {
 	z_stream *zs = &zstream->zs;
+	size_t prev_avail_out;
 	int ret, flush;
 
 	i_assert(zstream->outbuf_used == 0);
 
+	o_stream_zlib_adapt_level(zstream);
+
 	flush = zstream->ostream.corked || zstream->gz ?
 		Z_NO_FLUSH : Z_SYNC_FLUSH;
 
@@ -160,7 +197,9 @@ o_stream_zlib_send_chunk(struct zlib_ostream *zstream,
 			}
 		}
 
+		prev_avail_out = zs->avail_out;
 		ret = deflate(zs, flush);
+		zstream->sample_out += prev_avail_out - zs->avail_out;
 		switch (ret) {
 		case Z_OK:
 		case Z_BUF_ERROR:
@@ -178,6 +217,7 @@ o_stream_zlib_send_chunk(struct zlib_ostream *zstream,
 	}
 	size -= zs->avail_in;
 
+	zstream->sample_in += size;
 	zstream->crc = crc32_data_more(zstream->crc, data, size);
 	zstream->bytes32 += size;
 	zstream->flushed = FALSE;
@@ -353,6 +393,9 @@ o_stream_create_zlib(struct ostream *output, int level, bool gz)
 	zstream->ostream.iostream.close = o_stream_zlib_close;
 	zstream->crc = 0;
 	zstream->gz = gz;
+	/* Z_DEFAULT_COMPRESSION is documented to be equivalent to level 6 */
+	zstream->level = level == Z_DEFAULT_COMPRESSION ? 6 : level;
+	zstream->cur_level = zstream->level;
 	if (gz)
 		zstream->header_bytes_left = sizeof(zstream->gz_header);
 
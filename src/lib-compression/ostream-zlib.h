@@ -6,6 +6,18 @@ struct ostream *o_stream_create_deflate(struct ostream *output, int level);
 struct ostream *o_stream_create_bz2(struct ostream *output, int level);
 struct ostream *o_stream_create_lz4(struct ostream *output, int level);
 struct ostream *o_stream_create_zstd(struct ostream *output, int level);
+/* Like o_stream_create_zstd(), but compress using the given trained
+   dictionary. The frame headers reference the dictionary's ID, so
+   decompression fails cleanly with a wrong dictionary. */
+struct ostream *o_stream_create_zstd_dict(struct ostream *output, int level,
+					  const void *dict, size_t dict_size);
+/* Like o_stream_create_zstd_dict(), but compress with up to the given number
+   of libzstd worker threads. The worker count is advisory: with 0, an old
+   libzstd or one built without multithreading, everything is compressed in
+   the calling thread. */
+struct ostream *o_stream_create_zstd_mt(struct ostream *output, int level,
+					const void *dict, size_t dict_size,
+					unsigned int workers);
 
 int compression_get_min_level_gz(void);
 int compression_get_default_level_gz(void);
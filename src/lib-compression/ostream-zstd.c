@@ -4,6 +4,8 @@
 
 #ifdef HAVE_ZSTD
 
+#include "array.h"
+#include "byteorder.h"
 #include "ostream.h"
 #include "ostream-private.h"
 #include "ostream-zlib.h"
@@ -12,6 +14,20 @@
 #include "zstd_errors.h"
 #include "iostream-zstd-private.h"
 
+/* How much uncompressed data to write per frame. Each frame can be
+   decompressed independently, so a smaller size allows seeking to an offset
+   with less decompression work at the cost of a slightly worse compression
+   ratio. */
+#define ZSTD_SEEKABLE_FRAME_SIZE (1024*1024)
+
+/* Upper bound for worker threads, matching libzstd's own limit */
+#define ZSTD_OSTREAM_WORKERS_MAX 64
+
+struct zstd_seek_entry {
+	uint32_t compressed_size;
+	uint32_t decompressed_size;
+};
+
 struct zstd_ostream {
 	struct ostream_private ostream;
 
@@ -19,10 +35,27 @@ struct zstd_ostream {
 	ZSTD_outBuffer output;
 
 	unsigned char *outbuf;
+	int level;
+	/* number of libzstd worker threads, 0 = compress in this thread */
+	unsigned int workers;
+	/* uncompressed bytes per seek table frame */
+	size_t frame_size;
+
+	/* trained compression dictionary, or NULL */
+	unsigned char *dict;
+	size_t dict_size;
+
+	/* sizes of the current (unfinished) frame */
+	uint32_t frame_comp_size, frame_uncomp_size;
+	/* finished frames, for the seek table */
+	ARRAY(struct zstd_seek_entry) seek_table;
 
 	bool flushed:1;
 	bool closed:1;
 	bool finished:1;
+	/* the current frame is full and must be ended before compressing
+	   any more input */
+	bool frame_ending:1;
 };
 
 int compression_get_min_level_zstd(void)
@@ -92,6 +125,152 @@ static ssize_t o_stream_zstd_send_outbuf(struct zstd_ostream *zstream)
 	return 1;
 }
 
+static int o_stream_zstd_init_cstream(struct zstd_ostream *zstream)
+{
+	size_t ret;
+
+#if ZSTD_VERSION_NUMBER >= 10400
+	if (zstream->workers > 0 &&
+	    ZSTD_isError(ZSTD_CCtx_setParameter(zstream->cstream,
+			ZSTD_c_nbWorkers, zstream->workers)) != 0) {
+		/* libzstd is built without multithreading support - fall back
+		   to compressing in the ostream's own thread */
+		zstream->workers = 0;
+	}
+	if (zstream->workers > 0) {
+		ret = ZSTD_CCtx_reset(zstream->cstream,
+				      ZSTD_reset_session_only);
+		if (ZSTD_isError(ret) == 0) {
+			ret = ZSTD_CCtx_setParameter(zstream->cstream,
+				ZSTD_c_compressionLevel, zstream->level);
+		}
+		if (ZSTD_isError(ret) == 0 && zstream->dict != NULL) {
+			ret = ZSTD_CCtx_loadDictionary(zstream->cstream,
+				zstream->dict, zstream->dict_size);
+		}
+		if (ZSTD_isError(ret) != 0) {
+			o_stream_zstd_write_error(zstream, ret);
+			return -1;
+		}
+		return 0;
+	}
+#endif
+	if (zstream->dict != NULL) {
+		ret = ZSTD_initCStream_usingDict(zstream->cstream,
+						 zstream->dict,
+						 zstream->dict_size,
+						 zstream->level);
+	} else {
+		ret = ZSTD_initCStream(zstream->cstream, zstream->level);
+	}
+	if (ZSTD_isError(ret) != 0) {
+		o_stream_zstd_write_error(zstream, ret);
+		return -1;
+	}
+	return 0;
+}
+
+static size_t o_stream_zstd_compress_op(struct zstd_ostream *zstream,
+					ZSTD_inBuffer *input)
+{
+#if ZSTD_VERSION_NUMBER >= 10400
+	if (zstream->workers > 0) {
+		return ZSTD_compressStream2(zstream->cstream, &zstream->output,
+					    input, ZSTD_e_continue);
+	}
+#endif
+	return ZSTD_compressStream(zstream->cstream, &zstream->output, input);
+}
+
+static size_t o_stream_zstd_flush_op(struct zstd_ostream *zstream)
+{
+#if ZSTD_VERSION_NUMBER >= 10400
+	if (zstream->workers > 0) {
+		ZSTD_inBuffer input = { NULL, 0, 0 };
+		return ZSTD_compressStream2(zstream->cstream, &zstream->output,
+					    &input, ZSTD_e_flush);
+	}
+#endif
+	return ZSTD_flushStream(zstream->cstream, &zstream->output);
+}
+
+static size_t o_stream_zstd_end_op(struct zstd_ostream *zstream)
+{
+#if ZSTD_VERSION_NUMBER >= 10400
+	if (zstream->workers > 0) {
+		ZSTD_inBuffer input = { NULL, 0, 0 };
+		return ZSTD_compressStream2(zstream->cstream, &zstream->output,
+					    &input, ZSTD_e_end);
+	}
+#endif
+	return ZSTD_endStream(zstream->cstream, &zstream->output);
+}
+
+/* Finish the current frame and add it to the seek table. Returns 1 if the
+   frame was ended, 0 if the parent stream's buffer is full (retry later),
+   -1 on error. */
+static int o_stream_zstd_end_frame(struct zstd_ostream *zstream)
+{
+	struct zstd_seek_entry *entry;
+	size_t prev_pos, ret;
+	int sret;
+
+	for (;;) {
+		prev_pos = zstream->output.pos;
+		ret = o_stream_zstd_end_op(zstream);
+		zstream->frame_comp_size += zstream->output.pos - prev_pos;
+		if (ZSTD_isError(ret) != 0) {
+			o_stream_zstd_write_error(zstream, ret);
+			return -1;
+		}
+		if (ret == 0)
+			break;
+		/* output buffer full */
+		if ((sret = o_stream_zstd_send_outbuf(zstream)) <= 0)
+			return sret;
+	}
+	entry = array_append_space(&zstream->seek_table);
+	entry->compressed_size = zstream->frame_comp_size;
+	entry->decompressed_size = zstream->frame_uncomp_size;
+	zstream->frame_comp_size = zstream->frame_uncomp_size = 0;
+	zstream->frame_ending = FALSE;
+
+	/* start the next frame */
+	if (o_stream_zstd_init_cstream(zstream) < 0)
+		return -1;
+	return 1;
+}
+
+/* Append the seek table to the output buffer, to be drained by
+   o_stream_zstd_send_outbuf(). */
+static void o_stream_zstd_append_seek_table(struct zstd_ostream *zstream)
+{
+	const struct zstd_seek_entry *entry;
+	uint32_t count = array_count(&zstream->seek_table);
+	size_t table_size = 8 + (size_t)count * 8 + ZSTD_SEEKABLE_FOOTER_SIZE;
+	unsigned char *p;
+
+	if (zstream->output.size - zstream->output.pos < table_size) {
+		zstream->outbuf = i_realloc(zstream->outbuf,
+					    zstream->output.size,
+					    zstream->output.pos + table_size);
+		zstream->output.dst = zstream->outbuf;
+		zstream->output.size = zstream->output.pos + table_size;
+	}
+	p = zstream->outbuf + zstream->output.pos;
+	cpu32_to_le_unaligned(ZSTD_SEEKABLE_TABLE_MAGIC, p); p += 4;
+	cpu32_to_le_unaligned(count * 8 + ZSTD_SEEKABLE_FOOTER_SIZE, p); p += 4;
+	array_foreach(&zstream->seek_table, entry) {
+		cpu32_to_le_unaligned(entry->compressed_size, p); p += 4;
+		cpu32_to_le_unaligned(entry->decompressed_size, p); p += 4;
+	}
+	cpu32_to_le_unaligned(count, p); p += 4;
+	*p++ = 0; /* no per-frame checksums */
+	cpu32_to_le_unaligned(ZSTD_SEEKABLE_MAGIC, p); p += 4;
+	i_assert(p == zstream->outbuf + zstream->output.pos + table_size);
+	zstream->output.pos += table_size;
+}
+
 static ssize_t
 o_stream_zstd_sendv(struct ostream_private *stream,
 		    const struct const_iovec *iov, unsigned int iov_count)
@@ -110,9 +289,26 @@ o_stream_zstd_sendv(struct ostream_private *stream,
 		};
 		bool flush_attempted = FALSE;
 		for (;;) {
+			if (zstream->frame_ending) {
+				int fret = o_stream_zstd_end_frame(zstream);
+				if (fret < 0)
+					return -1;
+				if (fret == 0) {
+					/* non-blocking output buffer full */
+					return total;
+				}
+			}
+			/* stop the frame at the seek table boundary */
+			size_t orig_size = input.size;
+			size_t frame_left = zstream->frame_size -
+				zstream->frame_uncomp_size;
+			if (input.size - input.pos > frame_left)
+				input.size = input.pos + frame_left;
 			size_t prev_pos = input.pos;
-			ret = ZSTD_compressStream(zstream->cstream, &zstream->output,
-						  &input);
+			size_t prev_out = zstream->output.pos;
+			ret = o_stream_zstd_compress_op(zstream, &input);
+			zstream->frame_comp_size += zstream->output.pos - prev_out;
+			input.size = orig_size;
 			if (ZSTD_isError(ret) != 0) {
 				o_stream_zstd_write_error(zstream, ret);
 				return -1;
@@ -122,6 +318,9 @@ o_stream_zstd_sendv(struct ostream_private *stream,
 				/* non-blocking output buffer full */
 				return total;
 			}
+			zstream->frame_uncomp_size += new_input_size;
+			if (zstream->frame_uncomp_size == zstream->frame_size)
+				zstream->frame_ending = TRUE;
 			stream->ostream.offset += new_input_size;
 			total += new_input_size;
 			if (input.pos == input.size)
@@ -149,8 +348,16 @@ static int o_stream_zstd_send_flush(struct zstd_ostream *zstream, bool final)
 	if ((ret = o_stream_flush_parent_if_needed(&zstream->ostream)) <= 0)
 		return ret;
 
-	if (zstream->output.pos == 0)
-		ZSTD_flushStream(zstream->cstream, &zstream->output);
+	if (zstream->frame_ending) {
+		if ((ret = o_stream_zstd_end_frame(zstream)) <= 0)
+			return ret;
+	}
+
+	if (zstream->output.pos == 0) {
+		size_t prev_pos = zstream->output.pos;
+		(void)o_stream_zstd_flush_op(zstream);
+		zstream->frame_comp_size += zstream->output.pos - prev_pos;
+	}
 
 	if ((ret = o_stream_zstd_send_outbuf(zstream)) <= 0)
 		return ret;
@@ -159,11 +366,15 @@ static int o_stream_zstd_send_flush(struct zstd_ostream *zstream, bool final)
 		return 1;
 
 	if (!zstream->finished) {
-		ret = ZSTD_endStream(zstream->cstream, &zstream->output);
-		if (ZSTD_isError(ret) != 0) {
-			o_stream_zstd_write_error(zstream, ret);
-			return -1;
+		if (zstream->frame_uncomp_size > 0 ||
+		    array_count(&zstream->seek_table) == 0) {
+			/* end the final frame. an empty stream still gets an
+			   empty frame, so the output is valid zstd data. */
+			zstream->frame_ending = TRUE;
+			if ((ret = o_stream_zstd_end_frame(zstream)) <= 0)
+				return ret;
 		}
+		o_stream_zstd_append_seek_table(zstream);
 		zstream->finished = TRUE;
 	}
 
@@ -204,6 +415,8 @@ static void o_stream_zstd_close(struct iostream_private *stream,
 		ZSTD_freeCStream(zstream->cstream);
 		zstream->cstream = NULL;
 	}
+	array_free(&zstream->seek_table);
+	i_free(zstream->dict);
 	i_free(zstream->outbuf);
 	i_zero(&zstream->output);
 	if (close_parent)
@@ -211,10 +424,11 @@ static void o_stream_zstd_close(struct iostream_private *stream,
 }
 
 struct ostream *
-o_stream_create_zstd(struct ostream *output, int level)
+o_stream_create_zstd_mt(struct ostream *output, int level,
+			const void *dict, size_t dict_size,
+			unsigned int workers)
 {
 	struct zstd_ostream *zstream;
-	size_t ret;
 
 	i_assert(level >= compression_get_min_level_zstd() &&
 		 level <= compression_get_max_level_zstd());
@@ -225,13 +439,24 @@ o_stream_create_zstd(struct ostream *output, int level)
 	zstream->ostream.sendv = o_stream_zstd_sendv;
 	zstream->ostream.flush = o_stream_zstd_flush;
 	zstream->ostream.iostream.close = o_stream_zstd_close;
+	zstream->level = level;
+#if ZSTD_VERSION_NUMBER >= 10400
+	zstream->workers = I_MIN(workers, ZSTD_OSTREAM_WORKERS_MAX);
+#endif
+	/* older libzstd has no multithreaded streaming API - workers stays 0
+	   and everything is compressed in this thread */
+	/* ending a seek table frame drains the worker threads, so give them
+	   proportionally larger frames to chew on */
+	zstream->frame_size = ZSTD_SEEKABLE_FRAME_SIZE *
+		I_MAX(zstream->workers, 1);
+	if (dict_size > 0)
+		zstream->dict = i_memdup(dict, dict_size);
+	zstream->dict_size = dict_size;
+	i_array_init(&zstream->seek_table, 16);
 	zstream->cstream = ZSTD_createCStream();
 	if (zstream->cstream == NULL)
 		i_fatal_status(FATAL_OUTOFMEM, "zstd: Out of memory");
-	ret = ZSTD_initCStream(zstream->cstream, level);
-	if (ZSTD_isError(ret) != 0)
-		o_stream_zstd_write_error(zstream, ret);
-	else {
+	if (o_stream_zstd_init_cstream(zstream) == 0) {
 		zstream->outbuf = i_malloc(ZSTD_CStreamOutSize());
 		zstream->output.dst = zstream->outbuf;
 		zstream->output.size = ZSTD_CStreamOutSize();
@@ -240,4 +465,17 @@ o_stream_create_zstd(struct ostream *output, int level)
 			       o_stream_get_fd(output));
 }
 
+struct ostream *
+o_stream_create_zstd_dict(struct ostream *output, int level,
+			  const void *dict, size_t dict_size)
+{
+	return o_stream_create_zstd_mt(output, level, dict, dict_size, 0);
+}
+
+struct ostream *
+o_stream_create_zstd(struct ostream *output, int level)
+{
+	return o_stream_create_zstd_mt(output, level, NULL, 0, 0);
+}
+
 #endif
@@ -252,6 +252,41 @@ static bool dcrypt_openssl_initialize(const struct dcrypt_settings *set,
 	return TRUE;
 }
 
+/* Cache recently released EVP_CIPHER_CTXs for reuse. Creating a new context
+   costs a malloc/free pair and a cipher implementation lookup for every
+   stream, which adds up when a client fetches thousands of encrypted mails
+   in one session. Dovecot processes are single-threaded, so no locking is
+   needed. */
+#define EVP_CTX_CACHE_MAX_COUNT 8
+static EVP_CIPHER_CTX *evp_ctx_cache[EVP_CTX_CACHE_MAX_COUNT];
+static unsigned int evp_ctx_cache_count = 0;
+
+static EVP_CIPHER_CTX *evp_cipher_ctx_acquire(void)
+{
+	if (evp_ctx_cache_count > 0)
+		return evp_ctx_cache[--evp_ctx_cache_count];
+	return EVP_CIPHER_CTX_new();
+}
+
+static void evp_cipher_ctx_release(EVP_CIPHER_CTX **_evp_ctx)
+{
+	EVP_CIPHER_CTX *evp_ctx = *_evp_ctx;
+
+	*_evp_ctx = NULL;
+	/* the reset also wipes any key material left in the context */
+	if (evp_ctx_cache_count < EVP_CTX_CACHE_MAX_COUNT &&
+	    EVP_CIPHER_CTX_reset(evp_ctx) == 1)
+		evp_ctx_cache[evp_ctx_cache_count++] = evp_ctx;
+	else
+		EVP_CIPHER_CTX_free(evp_ctx);
+}
+
+static void evp_cipher_ctx_cache_free(void)
+{
+	while (evp_ctx_cache_count > 0)
+		EVP_CIPHER_CTX_free(evp_ctx_cache[--evp_ctx_cache_count]);
+}
+
 static bool
 dcrypt_openssl_ctx_sym_create(const char *algorithm, enum dcrypt_sym_mode mode,
 			      struct dcrypt_context_symmetric **ctx_r,
@@ -284,7 +319,7 @@ dcrypt_openssl_ctx_sym_destroy(struct dcrypt_context_symmetric **ctx)
 	pool_t pool = (*ctx)->pool;
 
 	if ((*ctx)->ctx != NULL)
-		EVP_CIPHER_CTX_free((*ctx)->ctx);
+		evp_cipher_ctx_release(&(*ctx)->ctx);
 	pool_unref(&pool);
 	*ctx = NULL;
 }
@@ -293,30 +328,41 @@ static void
 dcrypt_openssl_ctx_sym_set_key(struct dcrypt_context_symmetric *ctx,
 			       const unsigned char *key, size_t key_len)
 {
-	p_free(ctx->pool, ctx->key);
-	ctx->key = p_malloc(ctx->pool, EVP_CIPHER_key_length(ctx->cipher));
-	memcpy(ctx->key, key, I_MIN(key_len,
-	       (size_t)EVP_CIPHER_key_length(ctx->cipher)));
+	const size_t key_size = (size_t)EVP_CIPHER_key_length(ctx->cipher);
+
+	/* the allocation size depends only on the cipher, so it can be
+	   reused when the context is re-keyed - p_free() wouldn't return
+	   the memory to an alloconly pool anyway */
+	if (ctx->key == NULL)
+		ctx->key = p_malloc(ctx->pool, key_size);
+	else
+		memset(ctx->key, 0, key_size);
+	memcpy(ctx->key, key, I_MIN(key_len, key_size));
 }
 
 static void
 dcrypt_openssl_ctx_sym_set_iv(struct dcrypt_context_symmetric *ctx,
 			      const unsigned char *iv, size_t iv_len)
 {
-	p_free(ctx->pool, ctx->iv);
-	ctx->iv = p_malloc(ctx->pool, EVP_CIPHER_iv_length(ctx->cipher));
-	memcpy(ctx->iv, iv, I_MIN(iv_len,
-	       (size_t)EVP_CIPHER_iv_length(ctx->cipher)));
+	const size_t iv_size = (size_t)EVP_CIPHER_iv_length(ctx->cipher);
+
+	if (ctx->iv == NULL)
+		ctx->iv = p_malloc(ctx->pool, iv_size);
+	else
+		memset(ctx->iv, 0, iv_size);
+	memcpy(ctx->iv, iv, I_MIN(iv_len, iv_size));
 }
 
 static void
 dcrypt_openssl_ctx_sym_set_key_iv_random(struct dcrypt_context_symmetric *ctx)
 {
-	p_free(ctx->pool, ctx->key);
-	p_free(ctx->pool, ctx->iv);
-	ctx->key = p_malloc(ctx->pool, EVP_CIPHER_key_length(ctx->cipher));
+	if (ctx->key == NULL)
+		ctx->key = p_malloc(ctx->pool,
+				    EVP_CIPHER_key_length(ctx->cipher));
 	random_fill(ctx->key, EVP_CIPHER_key_length(ctx->cipher));
-	ctx->iv = p_malloc(ctx->pool, EVP_CIPHER_iv_length(ctx->cipher));
+	if (ctx->iv == NULL)
+		ctx->iv = p_malloc(ctx->pool,
+				   EVP_CIPHER_iv_length(ctx->cipher));
 	random_fill(ctx->iv, EVP_CIPHER_iv_length(ctx->cipher));
 }
 
@@ -424,7 +470,7 @@ dcrypt_openssl_ctx_sym_init(struct dcrypt_context_symmetric *ctx,
 	i_assert(ctx->iv != NULL);
 	i_assert(ctx->ctx == NULL);
 
-	if ((ctx->ctx = EVP_CIPHER_CTX_new()) == NULL)
+	if ((ctx->ctx = evp_cipher_ctx_acquire()) == NULL)
 		dcrypt_openssl_error(error_r);
 
 	ec = EVP_CipherInit_ex(ctx->ctx, ctx->cipher, NULL,
@@ -530,8 +576,7 @@ dcrypt_openssl_ctx_sym_final(struct dcrypt_context_symmetric *ctx,
 	else if (ec < 0)
 		dcrypt_openssl_error(error_r);
 
-	EVP_CIPHER_CTX_free(ctx->ctx);
-	ctx->ctx = NULL;
+	evp_cipher_ctx_release(&ctx->ctx);
 
 	return (ec == 1);
 }
@@ -3591,6 +3636,7 @@ void dcrypt_openssl_init(struct module *module ATTR_UNUSED)
 
 void dcrypt_openssl_deinit(void)
 {
+	evp_cipher_ctx_cache_free();
 	dovecot_openssl_common_global_unref();
 }
 
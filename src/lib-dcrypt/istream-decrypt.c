@@ -17,6 +17,11 @@
 
 #include <arpa/inet.h>
 
+/* Try to collect at least this much input before decrypting. Decrypting a
+   few large batches is much cheaper than issuing a cipher call for every
+   small read. */
+#define ISTREAM_DECRYPT_INPUT_OPTIMAL_SIZE (64 * 1024)
+
 struct decrypt_istream_snapshot {
 	struct istream_snapshot snapshot;
 	struct decrypt_istream *dstream;
@@ -831,6 +836,15 @@ i_stream_decrypt_read(struct istream_private *stream)
 
 		data = i_stream_get_data(stream->parent, &size);
 
+		/* keep reading while more input is readily available, so the
+		   cipher is run on large batches instead of once per small
+		   read */
+		while (ret > 0 && size < ISTREAM_DECRYPT_INPUT_OPTIMAL_SIZE) {
+			ret = i_stream_read_memarea(stream->parent);
+			if (ret > 0)
+				data = i_stream_get_data(stream->parent, &size);
+		}
+
 		if (ret == -1 &&
 		    (size == 0 || stream->parent->stream_errno != 0)) {
 			stream->istream.stream_errno =
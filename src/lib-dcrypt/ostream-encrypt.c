@@ -31,6 +31,13 @@
 #define IO_STREAM_ENCRYPT_SEED_SIZE 32
 #define IO_STREAM_ENCRYPT_ROUNDS 2048
 
+/* Aggregate writes smaller than this before running them through the
+   cipher. Incremental saves often arrive in tiny pieces, and every cipher
+   update pays a fixed per-call cost no matter how little data it's given.
+   This doesn't change the stream format - there is only a single MAC/tag
+   at the end of the stream, so chunking only affects the call count. */
+#define IO_STREAM_ENCRYPT_CHUNK_SIZE (IO_BLOCK_SIZE / 2)
+
 struct encrypt_ostream {
 	struct ostream_private ostream;
 
@@ -45,6 +52,8 @@ struct encrypt_ostream {
 
 	buffer_t *cipher_oid;
 	buffer_t *mac_oid;
+	/* collects small writes until there's a chunk worth encrypting */
+	buffer_t *chunk_buf;
 	size_t block_size;
 
 	bool finalized;
@@ -477,12 +486,69 @@ o_stream_encrypt_keydata_create_v2(struct encrypt_ostream *stream,
 	return 0;
 }
 
+static int
+o_stream_encrypt_send_chunk(struct encrypt_ostream *estream,
+			    const unsigned char *ptr, size_t len)
+{
+	struct ostream_private *stream = &estream->ostream;
+	const char *error;
+
+	/* buffer for encrypted data */
+	unsigned char ciphertext[IO_BLOCK_SIZE];
+	buffer_t buf;
+	buffer_create_from_data(&buf, ciphertext, sizeof(ciphertext));
+
+	/* encrypt & send all blocks of data at max ciphertext buffer's
+	   length */
+	size_t bl, off = 0;
+	while(len > 0) {
+		buffer_set_used_size(&buf, 0);
+		/* update can emite twice the size of input */
+		bl = I_MIN(sizeof(ciphertext)/2, len);
+
+		if (!dcrypt_ctx_sym_update(estream->ctx_sym, ptr + off,
+					   bl, &buf, &error)) {
+			io_stream_set_error(&stream->iostream,
+					    "Encryption failure: %s",
+					    error);
+			return -1;
+		}
+		if ((estream->flags & IO_STREAM_ENC_INTEGRITY_HMAC) ==
+			IO_STREAM_ENC_INTEGRITY_HMAC) {
+			/* update mac */
+			if (!dcrypt_ctx_hmac_update(estream->ctx_mac,
+				buf.data, buf.used, &error)) {
+				io_stream_set_error(&stream->iostream,
+					"MAC failure: %s", error);
+				return -1;
+			}
+		}
+
+		/* hopefully upstream can accommodate */
+		if (o_stream_encrypt_send(estream, buf.data, buf.used) < 0) {
+			return -1;
+		}
+
+		len -= bl;
+		off += bl;
+	}
+	return 0;
+}
+
+static int o_stream_encrypt_flush_chunk_buf(struct encrypt_ostream *estream)
+{
+	if (o_stream_encrypt_send_chunk(estream, estream->chunk_buf->data,
+					estream->chunk_buf->used) < 0)
+		return -1;
+	buffer_set_used_size(estream->chunk_buf, 0);
+	return 0;
+}
+
 static ssize_t
 o_stream_encrypt_sendv(struct ostream_private *stream,
 		       const struct const_iovec *iov, unsigned int iov_count)
 {
 	struct encrypt_ostream *estream = (struct encrypt_ostream *)stream;
-	const char *error;
 	ssize_t ec,total = 0;
 
 	/* not if finalized */
@@ -502,48 +568,22 @@ o_stream_encrypt_sendv(struct ostream_private *stream,
 		}
 	}
 
-	/* buffer for encrypted data */
-	unsigned char ciphertext[IO_BLOCK_SIZE];
-	buffer_t buf;
-	buffer_create_from_data(&buf, ciphertext, sizeof(ciphertext));
-
-	/* encrypt & send all blocks of data at max ciphertext buffer's
-	   length */
 	for(unsigned int i = 0; i < iov_count; i++) {
-		size_t bl, off = 0, len = iov[i].iov_len;
+		size_t len = iov[i].iov_len;
 		const unsigned char *ptr = iov[i].iov_base;
-		while(len > 0) {
-			buffer_set_used_size(&buf, 0);
-			/* update can emite twice the size of input */
-			bl = I_MIN(sizeof(ciphertext)/2, len);
 
-			if (!dcrypt_ctx_sym_update(estream->ctx_sym, ptr + off,
-						   bl, &buf, &error)) {
-				io_stream_set_error(&stream->iostream,
-						    "Encryption failure: %s",
-						    error);
+		if (estream->chunk_buf->used > 0 ||
+		    len < IO_STREAM_ENCRYPT_CHUNK_SIZE) {
+			/* aggregate small writes into fewer cipher calls */
+			buffer_append(estream->chunk_buf, ptr, len);
+			if (estream->chunk_buf->used >=
+				IO_STREAM_ENCRYPT_CHUNK_SIZE &&
+			    o_stream_encrypt_flush_chunk_buf(estream) < 0)
 				return -1;
-			}
-			if ((estream->flags & IO_STREAM_ENC_INTEGRITY_HMAC) ==
-				IO_STREAM_ENC_INTEGRITY_HMAC) {
-				/* update mac */
-				if (!dcrypt_ctx_hmac_update(estream->ctx_mac,
-					buf.data, buf.used, &error)) {
-					io_stream_set_error(&stream->iostream,
-						"MAC failure: %s", error);
-					return -1;
-				}
-			}
-
-			/* hopefully upstream can accommodate */
-			if (o_stream_encrypt_send(estream, buf.data, buf.used) < 0) {
-				return -1;
-			}
-
-			len -= bl;
-			off += bl;
-			total += bl;
+		} else if (o_stream_encrypt_send_chunk(estream, ptr, len) < 0) {
+			return -1;
 		}
+		total += len;
 	}
 
 	stream->ostream.offset += total;
@@ -617,6 +657,11 @@ o_stream_encrypt_flush(struct ostream_private *stream)
 {
 	struct encrypt_ostream *estream = (struct encrypt_ostream *)stream;
 
+	if (estream->ctx_sym != NULL && !estream->finalized &&
+	    estream->chunk_buf->used > 0 &&
+	    o_stream_encrypt_flush_chunk_buf(estream) < 0)
+		return -1;
+
 	if (stream->finished && estream->ctx_sym != NULL &&
 	    !estream->finalized) {
 		if (o_stream_encrypt_finalize(&estream->ostream) < 0)
@@ -654,6 +699,8 @@ o_stream_encrypt_destroy(struct iostream_private *stream)
 		buffer_free(&estream->cipher_oid);
 	if (estream->mac_oid != NULL)
 		buffer_free(&estream->mac_oid);
+	if (estream->chunk_buf != NULL)
+		buffer_free(&estream->chunk_buf);
 	if (estream->pub != NULL)
 		dcrypt_key_unref_public(&estream->pub);
 	o_stream_unref(&estream->ostream.parent);
@@ -745,6 +792,8 @@ o_stream_create_encrypt_common(enum io_stream_encrypt_flags flags)
 	estream->ostream.iostream.destroy = o_stream_encrypt_destroy;
 
 	estream->flags = flags;
+	estream->chunk_buf = buffer_create_dynamic(default_pool,
+						   IO_STREAM_ENCRYPT_CHUNK_SIZE);
 
 	return estream;
 }
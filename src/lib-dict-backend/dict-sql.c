@@ -18,6 +18,10 @@
 #include <fcntl.h>
 
 #define DICT_SQL_MAX_UNUSED_CONNECTIONS 10
+/* How many rows to write with a single multi-row INSERT at maximum. This
+   limits the size of the generated query and the number of bound
+   parameters. */
+#define DICT_SQL_SET_BATCH_MAX_ROWS 100
 
 enum sql_recurse_type {
 	SQL_DICT_RECURSE_NONE,
@@ -81,6 +85,10 @@ struct sql_dict_transaction_context {
 
 	ARRAY(struct sql_dict_prev) prev_inc;
 	ARRAY(struct sql_dict_prev) prev_set;
+	/* Finished prev_set rows with identical maps, waiting to be written
+	   out with a single multi-row INSERT. */
+	ARRAY(struct sql_dict_prev) batch_set;
+	unsigned int batch_set_fields;
 
 	dict_transaction_commit_callback_t *async_callback;
 	void *async_context;
@@ -94,6 +102,7 @@ static void sql_dict_prev_inc_flush(struct sql_dict_transaction_context *ctx);
 static void sql_dict_prev_set_flush(struct sql_dict_transaction_context *ctx);
 static void sql_dict_prev_inc_free(struct sql_dict_transaction_context *ctx);
 static void sql_dict_prev_set_free(struct sql_dict_transaction_context *ctx);
+static void sql_dict_batch_set_free(struct sql_dict_transaction_context *ctx);
 
 static int
 sql_dict_init(struct dict *driver, const char *uri,
@@ -989,6 +998,8 @@ static void sql_dict_transaction_free(struct sql_dict_transaction_context *ctx)
 		sql_dict_prev_inc_free(ctx);
 	if (array_is_created(&ctx->prev_set))
 		sql_dict_prev_set_free(ctx);
+	if (array_is_created(&ctx->batch_set))
+		sql_dict_batch_set_free(ctx);
 
 	pool_unref(&ctx->inc_row_pool);
 	i_free(ctx->error);
@@ -1126,6 +1137,8 @@ struct dict_sql_build_query {
 
 static int sql_dict_set_query(struct sql_dict_transaction_context *ctx,
 			      const struct dict_sql_build_query *build,
+			      const struct sql_dict_prev *rows,
+			      unsigned int row_count,
 			      struct sql_statement **stmt_r,
 			      const char **error_r)
 {
@@ -1134,121 +1147,162 @@ static int sql_dict_set_query(struct sql_dict_transaction_context *ctx,
 	const struct dict_sql_field *pattern_fields;
 	ARRAY_TYPE(sql_dict_param) params;
 	const char *const *pattern_values;
-	unsigned int i, field_count, count, count2;
-	string_t *prefix, *suffix;
+	unsigned int i, r, field_count, count, count2;
+	string_t *query;
 	time_t expire_timestamp = 0;
 
 	fields = array_get(&build->fields, &field_count);
 	i_assert(field_count > 0);
+	i_assert(row_count > 0);
 
 	if (fields[0].map->expire_field != NULL &&
 	    ctx->ctx.set.expire_secs > 0)
 		expire_timestamp = ioloop_time + ctx->ctx.set.expire_secs;
 
 	t_array_init(&params, 4);
-	prefix = t_str_new(64);
-	suffix = t_str_new(256);
-	/* SQL table is guaranteed to be the same for all fields.
-	   Build all the SQL field names into prefix and '?' placeholders for
-	   each value into the suffix. The actual field values will be added
-	   into params[]. */
-	str_printfa(prefix, "INSERT INTO %s%s",
+	query = t_str_new(256);
+	/* SQL table is guaranteed to be the same for all fields and rows.
+	   Build all the SQL field names first, followed by a (?, ?, ...)
+	   placeholder tuple for each row. The actual field values will be
+	   added into params[]. */
+	str_printfa(query, "INSERT INTO %s%s",
 		    sql_db_table_prefix(dict->db), fields[0].map->table);
-	str_append(prefix, " (");
-	str_append(suffix, ") VALUES (");
+	str_append(query, " (");
 	for (i = 0; i < field_count; i++) {
-		if (i > 0) {
-			str_append_c(prefix, ',');
-			str_append_c(suffix, ',');
-		}
-		str_append(prefix, t_strcut(fields[i].map->value_field, ','));
-
-		enum dict_sql_type value_type =
-			fields[i].map->value_types[0];
-		str_append_c(suffix, '?');
-		if (sql_dict_value_get(fields[i].map,
-				       value_type, "value", fields[i].value,
-				       "", &params, error_r) < 0)
-			return -1;
-	}
-	if (build->add_username) {
-		struct sql_dict_param *param = array_append_space(&params);
-		str_printfa(prefix, ",%s", fields[0].map->username_field);
-		str_append(suffix, ",?");
-		param->value_type = DICT_SQL_TYPE_STRING;
-		param->value_str = ctx->ctx.set.username;
-	}
-	if (expire_timestamp != 0) {
-		struct sql_dict_param *param = array_append_space(&params);
-		str_printfa(prefix, ",%s", fields[0].map->expire_field);
-		str_append(suffix, ",?");
-		param->value_type = DICT_SQL_TYPE_UINT;
-		param->value_int64 = expire_timestamp;
+		if (i > 0)
+			str_append_c(query, ',');
+		str_append(query, t_strcut(fields[i].map->value_field, ','));
 	}
-
-	/* add the variable fields that were parsed from the path */
+	if (build->add_username)
+		str_printfa(query, ",%s", fields[0].map->username_field);
+	if (expire_timestamp != 0)
+		str_printfa(query, ",%s", fields[0].map->expire_field);
+	/* the variable fields that were parsed from the paths */
 	pattern_fields = array_get(&fields[0].map->pattern_fields, &count);
-	pattern_values = array_get(build->pattern_values, &count2);
-	i_assert(count == count2);
-	for (i = 0; i < count; i++) {
-		str_printfa(prefix, ",%s", pattern_fields[i].name);
-		str_append(suffix, ",?");
-		if (sql_dict_field_get_value(fields[0].map, &pattern_fields[i],
-					     pattern_values[i], "",
-					     &params, error_r) < 0)
-			return -1;
-	}
+	for (i = 0; i < count; i++)
+		str_printfa(query, ",%s", pattern_fields[i].name);
+	str_append(query, ") VALUES ");
+
+	for (r = 0; r < row_count; r++) {
+		ARRAY_TYPE(const_string) row_pattern_values;
+
+		if (sql_dict_find_map(dict, rows[r * field_count].key,
+				      &row_pattern_values) == NULL)
+			i_unreached(); /* this was already checked */
 
-	str_append_str(prefix, suffix);
-	str_append_c(prefix, ')');
+		if (r > 0)
+			str_append_c(query, ',');
+		str_append_c(query, '(');
+		for (i = 0; i < field_count; i++) {
+			enum dict_sql_type value_type =
+				fields[i].map->value_types[0];
+
+			if (i > 0)
+				str_append_c(query, ',');
+			str_append_c(query, '?');
+			if (sql_dict_value_get(fields[i].map, value_type,
+					       "value",
+					       rows[r * field_count + i].value.str,
+					       "", &params, error_r) < 0)
+				return -1;
+		}
+		if (build->add_username) {
+			struct sql_dict_param *param =
+				array_append_space(&params);
+			str_append(query, ",?");
+			param->value_type = DICT_SQL_TYPE_STRING;
+			param->value_str = ctx->ctx.set.username;
+		}
+		if (expire_timestamp != 0) {
+			struct sql_dict_param *param =
+				array_append_space(&params);
+			str_append(query, ",?");
+			param->value_type = DICT_SQL_TYPE_UINT;
+			param->value_int64 = expire_timestamp;
+		}
+		pattern_values = array_get(&row_pattern_values, &count2);
+		i_assert(count == count2);
+		for (i = 0; i < count; i++) {
+			str_append(query, ",?");
+			if (sql_dict_field_get_value(fields[0].map,
+						     &pattern_fields[i],
+						     pattern_values[i], "",
+						     &params, error_r) < 0)
+				return -1;
+		}
+		str_append_c(query, ')');
+	}
 
 	enum sql_db_flags flags = sql_get_flags(dict->db);
 	if ((flags & SQL_DB_FLAG_ON_DUPLICATE_KEY) != 0)
-		str_append(prefix, " ON DUPLICATE KEY UPDATE ");
+		str_append(query, " ON DUPLICATE KEY UPDATE ");
 	else if ((flags & SQL_DB_FLAG_ON_CONFLICT_DO) != 0) {
-		str_append(prefix, " ON CONFLICT (");
+		str_append(query, " ON CONFLICT (");
 		for (i = 0; i < count; i++) {
 			if (i > 0)
-				str_append_c(prefix, ',');
-			str_append(prefix, pattern_fields[i].name);
+				str_append_c(query, ',');
+			str_append(query, pattern_fields[i].name);
 		}
 		if (build->add_username) {
 			if (count > 0)
-				str_append_c(prefix, ',');
-			str_append(prefix, fields[0].map->username_field);
+				str_append_c(query, ',');
+			str_append(query, fields[0].map->username_field);
 		}
-		str_append(prefix, ") DO UPDATE SET ");
+		str_append(query, ") DO UPDATE SET ");
 	} else {
-		*stmt_r = sql_dict_transaction_stmt_init(ctx, str_c(prefix), &params);
+		*stmt_r = sql_dict_transaction_stmt_init(ctx, str_c(query), &params);
 		return 0;
 	}
 
 	/* If the row already exists, UPDATE it instead. The pattern_values
 	   don't need to be updated here, because they are expected to be part
-	   of the row's primary key. */
+	   of the row's primary key. With a multi-row INSERT the values can't
+	   be bound as parameters a second time, so refer to the values of
+	   the conflicting row instead. */
 	for (i = 0; i < field_count; i++) {
 		const char *first_value_field =
 			t_strcut(fields[i].map->value_field, ',');
 		if (i > 0)
-			str_append_c(prefix, ',');
-		str_append(prefix, first_value_field);
-		str_append_c(prefix, '=');
-
+			str_append_c(query, ',');
+		str_append(query, first_value_field);
+		str_append_c(query, '=');
+
+		if (row_count > 1) {
+			if ((flags & SQL_DB_FLAG_ON_DUPLICATE_KEY) != 0)
+				str_printfa(query, "VALUES(%s)",
+					    first_value_field);
+			else
+				str_printfa(query, "excluded.%s",
+					    first_value_field);
+			continue;
+		}
 		enum dict_sql_type value_type =
 			fields[i].map->value_types[0];
-		str_append_c(prefix, '?');
+		str_append_c(query, '?');
 		if (sql_dict_value_get(fields[i].map,
 				       value_type, "value", fields[i].value,
 				       "", &params, error_r) < 0)
 			return -1;
 	}
 	if (expire_timestamp != 0) {
-		str_printfa(prefix, ",%s=?", fields[0].map->expire_field);
-		struct sql_dict_param *param = array_append_space(&params);
-		param->value_type = DICT_SQL_TYPE_UINT;
-		param->value_int64 = expire_timestamp;
+		const char *expire_field = fields[0].map->expire_field;
+
+		if (row_count > 1) {
+			if ((flags & SQL_DB_FLAG_ON_DUPLICATE_KEY) != 0) {
+				str_printfa(query, ",%s=VALUES(%s)",
+					    expire_field, expire_field);
+			} else {
+				str_printfa(query, ",%s=excluded.%s",
+					    expire_field, expire_field);
+			}
+		} else {
+			str_printfa(query, ",%s=?", expire_field);
+			struct sql_dict_param *param = array_append_space(&params);
+			param->value_type = DICT_SQL_TYPE_UINT;
+			param->value_int64 = expire_timestamp;
+		}
 	}
-	*stmt_r = sql_dict_transaction_stmt_init(ctx, str_c(prefix), &params);
+	*stmt_r = sql_dict_transaction_stmt_init(ctx, str_c(query), &params);
 	return 0;
 }
 
@@ -1296,59 +1350,123 @@ static void sql_dict_prev_set_free(struct sql_dict_transaction_context *ctx)
 	array_free(&ctx->prev_set);
 }
 
-static void sql_dict_prev_set_flush(struct sql_dict_transaction_context *ctx)
+static void sql_dict_batch_set_free(struct sql_dict_transaction_context *ctx)
+{
+	struct sql_dict_prev *prev_set;
+
+	array_foreach_modifiable(&ctx->batch_set, prev_set) {
+		i_free(prev_set->value.str);
+		i_free(prev_set->key);
+	}
+	array_free(&ctx->batch_set);
+}
+
+static void sql_dict_batch_set_emit(struct sql_dict_transaction_context *ctx)
 {
 	struct sql_dict *dict = (struct sql_dict *)ctx->ctx.dict;
-	const struct sql_dict_prev *prev_sets;
-	unsigned int count;
+	const struct sql_dict_prev *rows;
+	unsigned int count, field_count, row_count;
 	struct sql_statement *stmt;
-	ARRAY_TYPE(const_string) pattern_values;
 	struct dict_sql_build_query build;
 	struct dict_sql_build_query_field *field;
 	const char *error;
 
-	i_assert(array_is_created(&ctx->prev_set));
-
-	if (ctx->error != NULL) {
-		sql_dict_prev_set_free(ctx);
-		return;
-	}
-
-	prev_sets = array_get(&ctx->prev_set, &count);
-	i_assert(count > 0);
-
-	/* Get the variable values from the dict path. We already verified that
-	   these are all exactly the same for everything in prev_sets. */
-	if (sql_dict_find_map(dict, prev_sets[0].key, &pattern_values) == NULL)
-		i_unreached(); /* this was already checked */
+	rows = array_get(&ctx->batch_set, &count);
+	field_count = ctx->batch_set_fields;
+	i_assert(count > 0 && count % field_count == 0);
+	row_count = count / field_count;
 
 	i_zero(&build);
 	build.dict = dict;
-	build.pattern_values = &pattern_values;
-	build.add_username = (prev_sets[0].key[0] == DICT_PATH_PRIVATE[0]);
+	build.add_username = (rows[0].key[0] == DICT_PATH_PRIVATE[0]);
 
 	/* build.fields[] is used to get the map { value_field } for the
-	   SQL field names, as well as the values for them.
+	   SQL field names. The values for each row are read from rows[]
+	   directly.
 
 	   Example: INSERT INTO ... (build.fields[0].map->value_field,
-	   ...[1], ...) VALUES (build.fields[0].value, ...[1], ...) */
-	t_array_init(&build.fields, count);
-	for (unsigned int i = 0; i < count; i++) {
+	   ...[1], ...) VALUES (rows[0].value, ...[1], ...), (...) */
+	t_array_init(&build.fields, field_count);
+	for (unsigned int i = 0; i < field_count; i++) {
 		i_assert(build.add_username ==
-			 (prev_sets[i].key[0] == DICT_PATH_PRIVATE[0]));
+			 (rows[i].key[0] == DICT_PATH_PRIVATE[0]));
 		field = array_append_space(&build.fields);
-		field->map = prev_sets[i].map;
-		field->value = prev_sets[i].value.str;
+		field->map = rows[i].map;
+		field->value = rows[i].value.str;
 	}
 
-	if (sql_dict_set_query(ctx, &build, &stmt, &error) < 0) {
+	if (sql_dict_set_query(ctx, &build, rows, row_count, &stmt, &error) < 0) {
 		ctx->error = i_strdup_printf(
 			"dict-sql: Failed to set %u fields (first %s): %s",
-			count, prev_sets[0].key, error);
+			count, rows[0].key, error);
 	} else {
 		sql_update_stmt(ctx->sql_ctx, &stmt);
 	}
+	sql_dict_batch_set_free(ctx);
+}
+
+static bool
+sql_dict_batch_set_row_mergeable(struct sql_dict_transaction_context *ctx,
+				 const struct sql_dict_prev *row,
+				 unsigned int field_count)
+{
+	const struct sql_dict_prev *first_row = array_front(&ctx->batch_set);
+
+	if (array_count(&ctx->batch_set) >=
+	    ctx->batch_set_fields * DICT_SQL_SET_BATCH_MAX_ROWS)
+		return FALSE;
+	if (field_count != ctx->batch_set_fields)
+		return FALSE;
+	/* private vs shared prefix must equal, so the username column is
+	   either added to all of the rows or to none of them */
+	if (row[0].key[0] != first_row[0].key[0])
+		return FALSE;
+	/* identical maps guarantee the same table and the same columns in
+	   the same order */
+	for (unsigned int i = 0; i < field_count; i++) {
+		if (row[i].map != first_row[i].map)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static void
+sql_dict_prev_set_finish_row(struct sql_dict_transaction_context *ctx)
+{
+	const struct sql_dict_prev *row = array_front(&ctx->prev_set);
+	unsigned int field_count = array_count(&ctx->prev_set);
+
+	if (array_is_created(&ctx->batch_set) &&
+	    !sql_dict_batch_set_row_mergeable(ctx, row, field_count)) {
+		/* can't add this row to the pending multi-row INSERT -
+		   write that out first */
+		sql_dict_batch_set_emit(ctx);
+	}
+	if (!array_is_created(&ctx->batch_set)) {
+		i_array_init(&ctx->batch_set, field_count * 4);
+		ctx->batch_set_fields = field_count;
+	}
+	/* ownership of the row's strings moves to batch_set */
+	array_append(&ctx->batch_set, row, field_count);
+	array_clear(&ctx->prev_set);
+}
+
+static void sql_dict_prev_set_flush(struct sql_dict_transaction_context *ctx)
+{
+	i_assert(array_is_created(&ctx->prev_set));
+
+	if (ctx->error != NULL) {
+		sql_dict_prev_set_free(ctx);
+		if (array_is_created(&ctx->batch_set))
+			sql_dict_batch_set_free(ctx);
+		return;
+	}
+
+	if (array_count(&ctx->prev_set) > 0)
+		sql_dict_prev_set_finish_row(ctx);
 	sql_dict_prev_set_free(ctx);
+	if (array_is_created(&ctx->batch_set))
+		sql_dict_batch_set_emit(ctx);
 }
 
 static void sql_dict_unset(struct dict_transaction_context *_ctx,
@@ -1544,8 +1662,9 @@ static void sql_dict_set(struct dict_transaction_context *_ctx,
 	if (array_is_created(&ctx->prev_set) &&
 	    !sql_dict_maps_are_mergeable(dict, array_front(&ctx->prev_set),
 					 map, key, &pattern_values)) {
-		/* couldn't merge to the previous set - flush it */
-		sql_dict_prev_set_flush(ctx);
+		/* couldn't merge to the previous set's row - finish that row
+		   and try to add it to a multi-row INSERT instead */
+		sql_dict_prev_set_finish_row(ctx);
 	}
 
 	if (!array_is_created(&ctx->prev_set))
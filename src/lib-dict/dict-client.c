@@ -84,6 +84,7 @@ struct client_dict {
 	uint64_t last_timer_switch_usecs;
 	struct timeout *to_requests;
 	struct timeout *to_idle;
+	struct timeout *to_uncork;
 	unsigned int idle_timeout_msecs;
 
 	ARRAY(struct client_dict_cmd *) cmds;
@@ -265,12 +266,27 @@ static void client_dict_input_timeout(struct client_dict *dict)
 		dict_wait_warnings(cmd)), &error);
 }
 
+static void client_dict_uncork(struct client_dict *dict)
+{
+	timeout_remove(&dict->to_uncork);
+	if (dict->conn.conn.output != NULL)
+		o_stream_uncork(dict->conn.conn.output);
+}
+
 static int
 client_dict_cmd_query_send(struct client_dict *dict, const char *query)
 {
 	struct const_iovec iov[2];
 	ssize_t ret;
 
+	if (dict->to_uncork == NULL) {
+		/* Batch all commands sent during this ioloop iteration into a
+		   single socket write. */
+		o_stream_cork(dict->conn.conn.output);
+		dict->to_uncork = timeout_add_short(0, client_dict_uncork,
+						    dict);
+	}
+
 	iov[0].iov_base = query;
 	iov[0].iov_len = strlen(query);
 	iov[1].iov_base = "\n";
@@ -623,6 +639,10 @@ static void client_dict_disconnect(struct client_dict *dict, const char *reason)
 			ctx->error = i_strdup(reason);
 	}
 
+	/* flush any output that is still being batched */
+	if (dict->to_uncork != NULL)
+		client_dict_uncork(dict);
+
 	timeout_remove(&dict->to_idle);
 	timeout_remove(&dict->to_requests);
 	connection_disconnect(&dict->conn.conn);
@@ -845,6 +865,8 @@ static bool client_dict_switch_ioloop(struct dict *_dict)
 		dict->to_idle = io_loop_move_timeout(&dict->to_idle);
 	if (dict->to_requests != NULL)
 		dict->to_requests = io_loop_move_timeout(&dict->to_requests);
+	if (dict->to_uncork != NULL)
+		dict->to_uncork = io_loop_move_timeout(&dict->to_uncork);
 	connection_switch_ioloop(&dict->conn.conn);
 	return array_count(&dict->cmds) > 0;
 }
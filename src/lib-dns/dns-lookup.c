@@ -36,6 +36,13 @@ struct dns_lookup {
 	bool ptr_lookup;
 	bool cached;
 
+	/* Concurrent identical lookups are collapsed into a single request on
+	   the dns-client socket. The lookup that sent the request keeps the
+	   others in its waiters list and shares its result with them. */
+	struct dns_lookup *wait_prev, *wait_next;
+	struct dns_lookup *waiters_head, *waiters_tail;
+	struct dns_lookup *waiting_for;
+
 	struct timeout *to;
 
 	struct timeval start_time;
@@ -293,6 +300,7 @@ static void dns_lookup_save_msecs(struct dns_lookup *lookup);
 
 static void dns_lookup_callback(struct dns_lookup *lookup)
 {
+	struct dns_lookup *waiter;
 	struct event_passthrough *e =
 		event_create_passthrough(lookup->event)->
 		set_name("dns_request_finished");
@@ -311,6 +319,19 @@ static void dns_lookup_callback(struct dns_lookup *lookup)
 		i_assert(lookup->ptr_lookup || lookup->result.ips_count > 0);
 	}
 	lookup->callback(&lookup->result, lookup->context);
+
+	/* Share the result with identical lookups waiting for this one. The
+	   result memory is owned by this lookup, but the callbacks are called
+	   before it is freed. */
+	while ((waiter = lookup->waiters_head) != NULL) {
+		DLLIST2_REMOVE_FULL(&lookup->waiters_head,
+				    &lookup->waiters_tail,
+				    waiter, wait_prev, wait_next);
+		waiter->waiting_for = NULL;
+		waiter->result = lookup->result;
+		dns_lookup_callback(waiter);
+		dns_lookup_free(&waiter);
+	}
 }
 
 static void dns_lookup_callback_cached(struct dns_lookup *lookup)
@@ -478,7 +499,44 @@ static void dns_lookup_free(struct dns_lookup **_lookup)
 
 	*_lookup = NULL;
 
-	DLLIST2_REMOVE(&client->head, &client->tail, lookup);
+	if (lookup->waiting_for != NULL) {
+		/* this lookup never went on the wire */
+		DLLIST2_REMOVE_FULL(&lookup->waiting_for->waiters_head,
+				    &lookup->waiting_for->waiters_tail,
+				    lookup, wait_prev, wait_next);
+		lookup->waiting_for = NULL;
+	} else if (lookup->waiters_head != NULL) {
+		/* The request is still on the wire and other lookups are
+		   waiting for its reply. Promote the first waiter to take
+		   this lookup's place in the request queue, so that replies
+		   still match the queue order. */
+		struct dns_lookup *waiter = lookup->waiters_head;
+
+		DLLIST2_REMOVE_FULL(&lookup->waiters_head,
+				    &lookup->waiters_tail,
+				    waiter, wait_prev, wait_next);
+		waiter->waiting_for = NULL;
+		waiter->waiters_head = lookup->waiters_head;
+		waiter->waiters_tail = lookup->waiters_tail;
+		lookup->waiters_head = lookup->waiters_tail = NULL;
+		for (struct dns_lookup *w = waiter->waiters_head;
+		     w != NULL; w = w->wait_next)
+			w->waiting_for = waiter;
+
+		waiter->prev = lookup->prev;
+		waiter->next = lookup->next;
+		if (waiter->prev != NULL)
+			waiter->prev->next = waiter;
+		else
+			client->head = waiter;
+		if (waiter->next != NULL)
+			waiter->next->prev = waiter;
+		else
+			client->tail = waiter;
+		lookup->prev = lookup->next = NULL;
+	} else {
+		DLLIST2_REMOVE(&client->head, &client->tail, lookup);
+	}
 	timeout_remove(&lookup->to);
 	if (client->deinit_client_at_free)
 		dns_client_deinit(&client);
@@ -651,6 +709,28 @@ dns_client_lookup_common(struct dns_client *client,
 		return 0;
 	}
 
+	struct dns_lookup *pending;
+	for (pending = client->head; pending != NULL; pending = pending->next) {
+		if (strcmp(pending->cache_key, lookup->cache_key) == 0)
+			break;
+	}
+	if (pending != NULL) {
+		/* An identical lookup is already pending - wait for its
+		   result instead of sending a duplicate request. */
+		e_debug(lookup->event, "Waiting for already pending lookup");
+		DLLIST2_APPEND_FULL(&pending->waiters_head,
+				    &pending->waiters_tail,
+				    lookup, wait_prev, wait_next);
+		lookup->waiting_for = pending;
+		if (client->timeout_msecs != 0) {
+			lookup->to = timeout_add_to(client->ioloop,
+						    client->timeout_msecs,
+						    dns_lookup_timeout, lookup);
+		}
+		*lookup_r = lookup;
+		return 0;
+	}
+
 	if ((ret = dns_client_send_request(client, cmd, &lookup->result.error)) <= 0) {
 		if (ret == 0) {
 			/* retry once */
@@ -701,8 +781,14 @@ void dns_client_switch_ioloop(struct dns_client *client)
 	client->to_idle = io_loop_move_timeout(&client->to_idle);
 	client->ioloop = current_ioloop;
 
-	for (lookup = client->head; lookup != NULL; lookup = lookup->next)
+	for (lookup = client->head; lookup != NULL; lookup = lookup->next) {
+		struct dns_lookup *waiter;
+
 		dns_lookup_switch_ioloop_real(lookup);
+		for (waiter = lookup->waiters_head; waiter != NULL;
+		     waiter = waiter->wait_next)
+			dns_lookup_switch_ioloop_real(waiter);
+	}
 }
 
 bool dns_client_has_pending_queries(struct dns_client *client)
@@ -383,6 +383,77 @@ static void test_dns_lookup_cached(void)
 	test_end();
 }
 
+static unsigned int singleflight_callbacks;
+
+static void
+test_callback_ips_singleflight(const struct dns_lookup_result *result,
+			       struct test_expect_result *expected)
+{
+	singleflight_callbacks++;
+	test_callback_ips(result, expected);
+}
+
+static void test_dns_lookup_singleflight(void)
+{
+	struct test_expect_result ctx;
+	struct dns_lookup *lookup1, *lookup2;
+	struct event *event = event_create(NULL);
+
+	test_begin("dns lookup (singleflight)");
+	create_dns_server(&test_server);
+	const struct dns_lookup_settings set = {
+		.dns_client_socket_path = TEST_SOCKET_NAME,
+		.ioloop = test_server.loop,
+		.timeout_msecs = 1000,
+		.event_parent = event,
+	};
+
+	struct dns_client *client = dns_client_init(&set);
+
+	ctx.result = "127.0.0.1\t::1";
+	ctx.ret = 0;
+
+	/* concurrent identical lookups must collapse to a single request */
+	test_assert(dns_client_lookup(client, "localhost", event,
+				      test_callback_ips_singleflight,
+				      &ctx, &lookup1) == 0);
+	test_assert(dns_client_lookup(client, "localhost", event,
+				      test_callback_ips_singleflight,
+				      &ctx, &lookup2) == 0);
+	io_loop_run(current_ioloop);
+	test_assert_cmp(singleflight_callbacks, ==, 2);
+	test_assert_cmp(test_server.lookup_counter, ==, 1);
+
+	/* a different name must not be collapsed */
+	ctx.result = "127.0.0.2";
+	test_assert(dns_client_lookup(client, "once-host", event,
+				      test_callback_ips_singleflight,
+				      &ctx, &lookup1) == 0);
+	io_loop_run(current_ioloop);
+	test_assert_cmp(singleflight_callbacks, ==, 3);
+	test_assert_cmp(test_server.lookup_counter, ==, 2);
+
+	/* aborting the lookup that sent the request must not affect the
+	   lookup waiting for it */
+	ctx.result = "127.0.0.1\t::1";
+	test_assert(dns_client_lookup(client, "localhost", event,
+				      test_callback_ips_singleflight,
+				      &ctx, &lookup1) == 0);
+	test_assert(dns_client_lookup(client, "localhost", event,
+				      test_callback_ips_singleflight,
+				      &ctx, &lookup2) == 0);
+	dns_lookup_abort(&lookup1);
+	io_loop_run(current_ioloop);
+	test_assert_cmp(singleflight_callbacks, ==, 4);
+	test_assert_cmp(test_server.lookup_counter, ==, 3);
+
+	dns_client_deinit(&client);
+	destroy_dns_server(&test_server);
+	event_unref(&event);
+
+	test_end();
+}
+
 int main(void)
 {
 	static void (*const test_functions[])(void) = {
@@ -390,6 +461,7 @@ int main(void)
 		test_dns_lookup_timeout,
 		test_dns_lookup_abort,
 		test_dns_lookup_cached,
+		test_dns_lookup_singleflight,
 		NULL
 	};
 
@@ -86,7 +86,19 @@ enum fs_open_flags {
 	   any additional command queueing. The caller is assumed to be the one
 	   doing any rate limiting if needed. This flag can only be used with
 	   ASYNC flag, synchronous requests are never queued. */
-	FS_OPEN_FLAG_ASYNC_NOQUEUE	= 0x80
+	FS_OPEN_FLAG_ASYNC_NOQUEUE	= 0x80,
+	/* Access hint: the caller reads the whole file sequentially from
+	   start to finish. Local filesystems can start readahead and remote
+	   backends can fetch the whole object with a single request. */
+	FS_OPEN_FLAG_READ_SEQUENTIAL	= 0x100,
+	/* Access hint: the caller reads only parts of the file, possibly in
+	   random order. Local filesystems shouldn't do readahead and remote
+	   backends should prefer ranged requests over downloading the whole
+	   object. */
+	FS_OPEN_FLAG_READ_RANDOM	= 0x200,
+	/* Access hint: the caller will read the file again soon, so it's
+	   worth keeping cached. */
+	FS_OPEN_FLAG_READ_REREAD	= 0x400
 };
 
 enum fs_iter_flags {
@@ -2,6 +2,8 @@
 
 #include "lib.h"
 #include "array.h"
+#include "hash.h"
+#include "llist.h"
 #include "str.h"
 #include "strescape.h"
 #include "istream.h"
@@ -13,9 +15,28 @@
 #include "iostream-temp.h"
 #include "fs-api-private.h"
 
+/* Maximum number of objects whose parsed metadata header is kept in a
+   per-fs LRU cache, so repeated opens of hot objects don't need to read and
+   parse the header again. Entries are validated against the object's mtime
+   before use. */
+#define METAWRAP_METADATA_CACHE_MAX_ENTRIES 100
+
+struct metawrap_metadata_cache_entry {
+	struct metawrap_metadata_cache_entry *prev, *next;
+	pool_t pool;
+	char *path;
+	time_t mtime;
+	ARRAY_TYPE(fs_metadata) metadata;
+};
+
 struct metawrap_fs {
 	struct fs fs;
 	bool wrap_metadata;
+
+	/* LRU cache of parsed metadata headers; head = most recently used */
+	HASH_TABLE(char *, struct metawrap_metadata_cache_entry *) cache;
+	struct metawrap_metadata_cache_entry *cache_head, *cache_tail;
+	unsigned int cache_count;
 };
 
 struct metawrap_fs_file {
@@ -67,15 +88,34 @@ fs_metawrap_init(struct fs *_fs, const char *args,
 	}
 	if (fs_init(parent_name, parent_args, set, &_fs->parent, error_r) < 0)
 		return -1;
-	if ((fs_get_properties(_fs->parent) & FS_PROPERTY_METADATA) == 0)
+	if ((fs_get_properties(_fs->parent) & FS_PROPERTY_METADATA) == 0) {
 		fs->wrap_metadata = TRUE;
+		hash_table_create(&fs->cache, default_pool, 0,
+				  str_hash, strcmp);
+	}
 	return 0;
 }
 
+static void
+fs_metawrap_cache_remove(struct metawrap_fs *fs,
+			 struct metawrap_metadata_cache_entry *entry)
+{
+	hash_table_remove(fs->cache, entry->path);
+	DLLIST2_REMOVE(&fs->cache_head, &fs->cache_tail, entry);
+	i_assert(fs->cache_count > 0);
+	fs->cache_count--;
+	pool_unref(&entry->pool);
+}
+
 static void fs_metawrap_free(struct fs *_fs)
 {
 	struct metawrap_fs *fs = METAWRAP_FS(_fs);
 
+	if (hash_table_is_created(fs->cache)) {
+		while (fs->cache_head != NULL)
+			fs_metawrap_cache_remove(fs, fs->cache_head);
+		hash_table_destroy(&fs->cache);
+	}
 	i_free(fs);
 }
 
@@ -165,6 +205,75 @@ fs_metawrap_set_metadata(struct fs_file *_file, const char *key,
 	}
 }
 
+static void fs_metawrap_cache_add(struct metawrap_fs_file *file)
+{
+	struct metawrap_fs *fs = file->fs;
+	struct metawrap_metadata_cache_entry *entry;
+	const struct fs_metadata *metadata;
+	struct stat st;
+	pool_t pool;
+
+	if (file->open_mode != FS_OPEN_MODE_READONLY)
+		return;
+	if (fs_stat(file->super_read, &st) < 0) {
+		/* can't get an mtime to validate the entry with later */
+		return;
+	}
+
+	entry = hash_table_lookup(fs->cache, file->file.path);
+	if (entry != NULL)
+		fs_metawrap_cache_remove(fs, entry);
+
+	pool = pool_alloconly_create("metawrap metadata cache", 512);
+	entry = p_new(pool, struct metawrap_metadata_cache_entry, 1);
+	entry->pool = pool;
+	entry->path = p_strdup(pool, file->file.path);
+	entry->mtime = st.st_mtime;
+	p_array_init(&entry->metadata, pool,
+		     array_count(&file->file.metadata));
+	array_foreach(&file->file.metadata, metadata) {
+		struct fs_metadata *copy;
+
+		if (str_begins_with(metadata->key, FS_METADATA_INTERNAL_PREFIX))
+			continue;
+		copy = array_append_space(&entry->metadata);
+		copy->key = p_strdup(pool, metadata->key);
+		copy->value = p_strdup(pool, metadata->value);
+	}
+	hash_table_insert(fs->cache, entry->path, entry);
+	DLLIST2_PREPEND(&fs->cache_head, &fs->cache_tail, entry);
+	if (++fs->cache_count > METAWRAP_METADATA_CACHE_MAX_ENTRIES)
+		fs_metawrap_cache_remove(fs, fs->cache_tail);
+}
+
+static bool fs_metawrap_cache_lookup(struct metawrap_fs_file *file)
+{
+	struct metawrap_fs *fs = file->fs;
+	struct metawrap_metadata_cache_entry *entry;
+	const struct fs_metadata *metadata;
+	struct stat st;
+
+	entry = hash_table_lookup(fs->cache, file->file.path);
+	if (entry == NULL)
+		return FALSE;
+	if (fs_stat(file->super_read, &st) < 0 ||
+	    st.st_mtime != entry->mtime) {
+		/* object changed (or is gone) - drop the stale entry */
+		fs_metawrap_cache_remove(fs, entry);
+		return FALSE;
+	}
+
+	array_foreach(&entry->metadata, metadata) {
+		fs_default_set_metadata(&file->file, metadata->key,
+					metadata->value);
+	}
+	/* mark as most recently used */
+	DLLIST2_REMOVE(&fs->cache_head, &fs->cache_tail, entry);
+	DLLIST2_PREPEND(&fs->cache_head, &fs->cache_tail, entry);
+	file->metadata_read = TRUE;
+	return TRUE;
+}
+
 static int
 fs_metawrap_get_metadata(struct fs_file *_file,
 			 enum fs_get_metadata_flags flags,
@@ -182,7 +291,10 @@ fs_metawrap_get_metadata(struct fs_file *_file,
 	} else if ((flags & FS_GET_METADATA_FLAG_LOADED_ONLY) != 0) {
 		/* use the existing metadata only */
 	} else if (file->input == NULL) {
-		if (fs_read(_file, &c, 1) < 0)
+		if (fs_metawrap_cache_lookup(file)) {
+			/* metadata served from the cache without reading
+			   the object */
+		} else if (fs_read(_file, &c, 1) < 0)
 			return -1;
 	} else {
 		/* use the existing istream to read it */
@@ -232,6 +344,7 @@ fs_metawrap_callback(const char *key, const char *value, void *context)
 
 	if (key == NULL) {
 		file->metadata_read = TRUE;
+		fs_metawrap_cache_add(file);
 		return;
 	}
 
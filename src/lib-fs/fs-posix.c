@@ -410,6 +410,37 @@ static int fs_posix_open_for_read(struct posix_fs_file *file)
 	if (file->fd == -1) {
 		if (fs_posix_open(file) < 0)
 			return -1;
+/* HAVE_POSIX_FADVISE alone isn't enough for CentOS 4.9 */
+#if defined(HAVE_POSIX_FADVISE) && defined(POSIX_FADV_WILLNEED)
+		if ((file->file.flags & FS_OPEN_FLAG_READ_SEQUENTIAL) != 0) {
+			if (posix_fadvise(file->fd, 0, 0,
+					  POSIX_FADV_SEQUENTIAL) < 0) {
+				e_error(file->file.event,
+					"posix_fadvise(%s) failed: %m",
+					file->full_path);
+			}
+		} else if ((file->file.flags & FS_OPEN_FLAG_READ_RANDOM) != 0) {
+			if (posix_fadvise(file->fd, 0, 0,
+					  POSIX_FADV_RANDOM) < 0) {
+				e_error(file->file.event,
+					"posix_fadvise(%s) failed: %m",
+					file->full_path);
+			}
+		}
+		if ((file->file.flags & FS_OPEN_FLAG_ASYNC) != 0 &&
+		    (file->file.flags & FS_OPEN_FLAG_READ_RANDOM) == 0) {
+			/* The caller wants asynchronous behavior, which we
+			   can't provide, but start readahead for the whole
+			   file right away so the following reads are less
+			   likely to block on disk I/O. */
+			if (posix_fadvise(file->fd, 0, 0,
+					  POSIX_FADV_WILLNEED) < 0) {
+				e_error(file->file.event,
+					"posix_fadvise(%s) failed: %m",
+					file->full_path);
+			}
+		}
+#endif
 	}
 	return 0;
 }
@@ -822,6 +853,11 @@ static int fs_posix_copy(struct fs_file *_src, struct fs_file *_dest)
 		ret = link(src->full_path, dest->full_path);
 		try_count++;
 	}
+	if (ret < 0 && errno == EXDEV) {
+		/* source and destination are on different filesystems -
+		   fall back to copying the data */
+		return fs_default_copy(_src, _dest);
+	}
 	if (ret < 0) {
 		fs_set_error_errno(_src->event, "link(%s, %s) failed: %m",
 				   src->full_path, dest->full_path);
@@ -223,26 +223,52 @@ static int fs_sis_write(struct fs_file *_file, const void *data, size_t size)
 
 static void fs_sis_write_stream(struct fs_file *_file)
 {
+	struct sis_fs_file *file = SIS_FILE(_file);
+
 	if (_file->parent == NULL) {
 		_file->output = o_stream_create_error_str(EINVAL, "%s",
 						fs_file_last_error(_file));
 	} else {
-		_file->output = fs_write_stream(_file->parent);
+		file->fs_output = fs_write_stream(_file->parent);
+		if (file->hash_input == NULL) {
+			_file->output = file->fs_output;
+			o_stream_ref(_file->output);
+		} else {
+			/* compare if files are equal */
+			_file->output = o_stream_create_cmp(file->fs_output,
+							    file->hash_input);
+		}
 	}
 	o_stream_set_name(_file->output, _file->path);
 }
 
 static int fs_sis_write_stream_finish(struct fs_file *_file, bool success)
 {
+	struct sis_fs_file *file = SIS_FILE(_file);
+	int ret;
 
 	if (!success) {
 		if (_file->parent != NULL)
-			fs_write_stream_abort_parent(_file, &_file->output);
+			fs_write_stream_abort_parent(_file, &file->fs_output);
+		o_stream_destroy(&_file->output);
 		return -1;
 	}
 
+	if (file->hash_input != NULL &&
+	    o_stream_cmp_equals(_file->output) &&
+	    i_stream_read_eof(file->hash_input)) {
+		/* try to use the existing file */
+		if (fs_sis_try_link(file)) {
+			fs_write_stream_abort_parent(_file, &file->fs_output);
+			o_stream_destroy(&_file->output);
+			return 1;
+		}
+	}
 
-	return fs_write_stream_finish(_file->parent, &_file->output);
+	ret = fs_write_stream_finish(_file->parent, &file->fs_output);
+	if (ret != 0)
+		o_stream_destroy(&_file->output);
+	return ret;
 }
 
 static int fs_sis_delete(struct fs_file *_file)
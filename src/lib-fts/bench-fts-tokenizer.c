@@ -0,0 +1,74 @@
+/* Copyright (c) 2026 Dovecot authors, see the included COPYING file */
+
+#include "lib.h"
+#include "str.h"
+#include "strnum.h"
+#include "time-util.h"
+#include "fts-tokenizer.h"
+
+#include <stdio.h>
+
+/* Measures generic tokenizer throughput with both word boundary
+   algorithms over a block of typical English mail text. */
+
+static const char bench_text[] =
+	"Hello, this is a fairly typical mail body for benchmarking the "
+	"tokenizer. It contains punctuation, some numbers like 3.14 and "
+	"1234567890, addresses such as user@example.com, and the usual "
+	"run of short and longer words that appear in correspondence. "
+	"Best regards, The Benchmarking Team\n";
+
+static void
+bench_fts_tokenizer(const char *algorithm, unsigned long rounds)
+{
+	const char *const settings[] = { "algorithm", algorithm, NULL };
+	struct fts_tokenizer *tok;
+	const char *token, *error;
+	uint64_t ts_0, ts_1;
+	unsigned long r, tokens = 0;
+	double secs, mb;
+	int ret;
+
+	if (fts_tokenizer_create(fts_tokenizer_generic, NULL, settings,
+				 &tok, &error) < 0)
+		i_fatal("fts_tokenizer_create(%s) failed: %s", algorithm, error);
+
+	ts_0 = i_nanoseconds();
+	for (r = 0; r < rounds; r++) {
+		const unsigned char *data = (const unsigned char *)bench_text;
+		size_t size = sizeof(bench_text)-1;
+
+		while ((ret = fts_tokenizer_next(tok, data, size,
+						 &token, &error)) > 0)
+			tokens++;
+		i_assert(ret == 0);
+		while ((ret = fts_tokenizer_final(tok, &token, &error)) > 0)
+			tokens++;
+		i_assert(ret == 0);
+	}
+	ts_1 = i_nanoseconds();
+
+	secs = (double)(ts_1 - ts_0) / 1e9;
+	mb = (double)(sizeof(bench_text)-1) * (double)rounds /
+		(1024.0 * 1024.0);
+	printf("fts_tokenizer_generic(%s): %7.02lf MB/s, %9.0lf tokens/s\n",
+	       algorithm, mb / secs, (double)tokens / secs);
+
+	fts_tokenizer_unref(&tok);
+}
+
+int main(int argc, const char *argv[])
+{
+	unsigned long rounds = 50000;
+
+	lib_init();
+
+	if (argc >= 2 && str_to_ulong(argv[1], &rounds) < 0)
+		i_fatal("Invalid round count: %s", argv[1]);
+
+	bench_fts_tokenizer("simple", rounds);
+	bench_fts_tokenizer("tr29", rounds);
+
+	lib_deinit();
+	return 0;
+}
@@ -8,9 +8,14 @@
 #include "fts-filter-private.h"
 #include "fts-language.h"
 
+#include <ctype.h>
+
 #ifdef HAVE_LIBICU
 #include "fts-icu.h"
 
+#define FTS_DEFAULT_NORMALIZER_ID \
+	"Any-Lower; NFKD; [: Nonspacing Mark :] Remove; NFC; [\\x20] Remove"
+
 struct fts_filter_normalizer_icu {
 	struct fts_filter filter;
 	pool_t pool;
@@ -19,6 +24,8 @@ struct fts_filter_normalizer_icu {
 	UTransliterator *transliterator;
 	ARRAY_TYPE(icu_utf16) utf16_token, trans_token;
 	string_t *utf8_token;
+
+	bool ascii_bypass:1;
 };
 
 static void fts_filter_normalizer_icu_destroy(struct fts_filter *filter)
@@ -40,7 +47,7 @@ fts_filter_normalizer_icu_create(const struct fts_language *lang ATTR_UNUSED,
 	struct fts_filter_normalizer_icu *np;
 	pool_t pp;
 	unsigned int i, max_length = 250;
-	const char *id = "Any-Lower; NFKD; [: Nonspacing Mark :] Remove; NFC; [\\x20] Remove";
+	const char *id = FTS_DEFAULT_NORMALIZER_ID;
 
 	for (i = 0; settings[i] != NULL; i += 2) {
 		const char *key = settings[i], *value = settings[i+1];
@@ -68,11 +75,35 @@ fts_filter_normalizer_icu_create(const struct fts_language *lang ATTR_UNUSED,
 	p_array_init(&np->utf16_token, pp, 64);
 	p_array_init(&np->trans_token, pp, 64);
 	np->utf8_token = buffer_create_dynamic(pp, 128);
+	np->ascii_bypass = strcmp(id, FTS_DEFAULT_NORMALIZER_ID) == 0;
 	np->filter.max_length = max_length;
 	*filter_r = &np->filter;
 	return 0;
 }
 
+static bool
+fts_filter_normalizer_icu_try_ascii(struct fts_filter_normalizer_icu *np,
+				    const char **token)
+{
+	const char *p;
+
+	/* The default transliterator's effect on pure-ASCII input is exactly
+	   lowercasing and removal of spaces - NFKD/NFC are identity mappings
+	   for ASCII. Most tokens in typical mail are pure ASCII, so handling
+	   them here avoids the UTF-8 -> UTF-16 -> transliterate -> UTF-8
+	   round-trip through ICU entirely. */
+	for (p = *token; *p != '\0'; p++) {
+		if ((unsigned char)*p >= 0x80)
+			return FALSE;
+	}
+	str_truncate(np->utf8_token, 0);
+	for (p = *token; *p != '\0'; p++) {
+		if (*p != ' ')
+			str_append_c(np->utf8_token, i_tolower(*p));
+	}
+	return TRUE;
+}
+
 static int
 fts_filter_normalizer_icu_filter(struct fts_filter *filter, const char **token,
 				 const char **error_r)
@@ -80,6 +111,15 @@ fts_filter_normalizer_icu_filter(struct fts_filter *filter, const char **token,
 	struct fts_filter_normalizer_icu *np =
 		(struct fts_filter_normalizer_icu *)filter;
 
+	if (np->ascii_bypass &&
+	    fts_filter_normalizer_icu_try_ascii(np, token)) {
+		if (str_len(np->utf8_token) == 0)
+			return 0;
+		fts_filter_truncate_token(np->utf8_token, np->filter.max_length);
+		*token = str_c(np->utf8_token);
+		return 1;
+	}
+
 	if (np->transliterator == NULL)
 		if (fts_icu_transliterator_create(np->transliterator_id,
 		                                  &np->transliterator,
@@ -14,14 +14,52 @@
 #define STOPWORDS_CUTCHARS "|#\t "
 #define STOPWORDS_DISALLOWED_CHARS "/\\<>.,\":()\t\n\r"
 
+/* Perfect hash tables generated from the shipped stopword lists at build
+   time by stopwords-perfect-hash.pl. The hash function below must stay
+   identical to the one in the script. */
+struct fts_stopwords_builtin {
+	const char *language;
+	/* words in slot order - the table is a minimal perfect hash, so
+	   every slot is filled */
+	const char *const *words;
+	/* per-bucket seeds of the CHD construction */
+	const uint32_t *seeds;
+	unsigned int count;
+};
+#include "stopwords-data.c"
+
 struct fts_filter_stopwords {
 	struct fts_filter filter;
 	struct fts_language *lang;
 	pool_t pool;
+	const struct fts_stopwords_builtin *builtin;
 	HASH_TABLE(const char *, const char *) stopwords;
 	const char *stopwords_dir;
 };
 
+static uint32_t fts_stopwords_hash(const char *key, uint32_t seed)
+{
+	/* 32bit FNV-1a, seeded */
+	uint32_t h = 2166136261U ^ seed;
+
+	for (; *key != '\0'; key++) {
+		h ^= (unsigned char)*key;
+		h *= 16777619;
+	}
+	return h;
+}
+
+static bool
+fts_stopwords_builtin_lookup(const struct fts_stopwords_builtin *builtin,
+			     const char *token)
+{
+	uint32_t bucket = fts_stopwords_hash(token, 0) % builtin->count;
+	uint32_t slot = fts_stopwords_hash(token, builtin->seeds[bucket]) %
+		builtin->count;
+
+	return strcmp(builtin->words[slot], token) == 0;
+}
+
 static int fts_filter_stopwords_read_list(struct fts_filter_stopwords *filter,
 					  const char **error_r)
 {
@@ -99,8 +137,18 @@ fts_filter_stopwords_create(const struct fts_language *lang,
 	sp->lang->name = p_strdup(sp->pool, lang->name);
 	if (dir != NULL)
 		sp->stopwords_dir = p_strdup(pp, dir);
-	else
+	else {
+		/* no custom list - use the compiled-in table if we ship
+		   one for this language */
+		for (i = 0; i < N_ELEMENTS(fts_stopwords_builtin); i++) {
+			if (strcmp(fts_stopwords_builtin[i].language,
+				   lang->name) == 0) {
+				sp->builtin = &fts_stopwords_builtin[i];
+				break;
+			}
+		}
 		sp->stopwords_dir = DATADIR"/stopwords";
+	}
 	*filter_r = &sp->filter;
 	return 0;
 }
@@ -112,6 +160,8 @@ fts_filter_stopwords_filter(struct fts_filter *filter, const char **token,
 	struct fts_filter_stopwords *sp =
 		(struct fts_filter_stopwords *) filter;
 
+	if (sp->builtin != NULL)
+		return fts_stopwords_builtin_lookup(sp->builtin, *token) ? 0 : 1;
 	if (!hash_table_is_created(sp->stopwords)) {
 		hash_table_create(&sp->stopwords, sp->pool, 0, str_hash, strcmp);
 		if (fts_filter_stopwords_read_list(sp, error_r) < 0)
@@ -3,6 +3,7 @@
 #include "lib.h"
 #include "array.h"
 #include "llist.h"
+#include "unichar.h"
 #include "fts-language.h"
 
 
@@ -19,6 +20,17 @@
 #endif
 
 #define DETECT_STR_MAX_LEN 200
+/* Minimum number of letters of a single script that must be seen before the
+   script fast path is trusted. Shorter inputs go through textcat, which
+   handles the "too short" case. */
+#define DETECT_SCRIPT_MIN_LETTERS 16
+
+enum fts_language_script {
+	FTS_LANGUAGE_SCRIPT_UNKNOWN = 0,
+	FTS_LANGUAGE_SCRIPT_LATIN,
+	FTS_LANGUAGE_SCRIPT_CYRILLIC,
+	FTS_LANGUAGE_SCRIPT_CJK
+};
 
 struct fts_textcat {
 	int refcount;
@@ -62,6 +74,122 @@ const struct fts_language fts_language_data = {
 	"data"
 };
 
+/* Scripts the builtin languages are written in. Languages registered with
+   fts_language_register() aren't listed here, so their script is unknown
+   and they never match the script fast path. */
+static const struct {
+	const char *name;
+	enum fts_language_script script;
+} fts_language_scripts[] = {
+	{ "da", FTS_LANGUAGE_SCRIPT_LATIN },
+	{ "de", FTS_LANGUAGE_SCRIPT_LATIN },
+	{ "en", FTS_LANGUAGE_SCRIPT_LATIN },
+	{ "es", FTS_LANGUAGE_SCRIPT_LATIN },
+	{ "fi", FTS_LANGUAGE_SCRIPT_LATIN },
+	{ "fr", FTS_LANGUAGE_SCRIPT_LATIN },
+	{ "it", FTS_LANGUAGE_SCRIPT_LATIN },
+	{ "nl", FTS_LANGUAGE_SCRIPT_LATIN },
+	{ "no", FTS_LANGUAGE_SCRIPT_LATIN },
+	{ "pt", FTS_LANGUAGE_SCRIPT_LATIN },
+	{ "ro", FTS_LANGUAGE_SCRIPT_LATIN },
+	{ "ru", FTS_LANGUAGE_SCRIPT_CYRILLIC },
+	{ "sv", FTS_LANGUAGE_SCRIPT_LATIN },
+	{ "tr", FTS_LANGUAGE_SCRIPT_LATIN },
+};
+
+static enum fts_language_script fts_language_script(const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < N_ELEMENTS(fts_language_scripts); i++) {
+		if (strcmp(fts_language_scripts[i].name, name) == 0)
+			return fts_language_scripts[i].script;
+	}
+	return FTS_LANGUAGE_SCRIPT_UNKNOWN;
+}
+
+static enum fts_language_script fts_language_script_of_char(unichar_t chr)
+{
+	if ((chr >= 'a' && chr <= 'z') || (chr >= 'A' && chr <= 'Z'))
+		return FTS_LANGUAGE_SCRIPT_LATIN;
+	if ((chr >= 0x00c0 && chr <= 0x024f) &&
+	    chr != 0x00d7 && chr != 0x00f7)
+		return FTS_LANGUAGE_SCRIPT_LATIN;
+	if (chr >= 0x0400 && chr <= 0x04ff)
+		return FTS_LANGUAGE_SCRIPT_CYRILLIC;
+	if ((chr >= 0x3040 && chr <= 0x30ff) || /* hiragana, katakana */
+	    (chr >= 0x3400 && chr <= 0x4dbf) || /* CJK extension A */
+	    (chr >= 0x4e00 && chr <= 0x9fff) || /* CJK unified ideographs */
+	    (chr >= 0xac00 && chr <= 0xd7af) || /* hangul syllables */
+	    (chr >= 0xf900 && chr <= 0xfaff))   /* CJK compat ideographs */
+		return FTS_LANGUAGE_SCRIPT_CJK;
+	return FTS_LANGUAGE_SCRIPT_UNKNOWN;
+}
+
+/* Script-based fast path: if the sample consists of letters of a single
+   script and exactly one of the wanted languages is written in that script,
+   the language is known without running the full textcat classification.
+   This makes detection practically free e.g. for plain ASCII English when
+   English is the only Latin-script language wanted, and for Russian with
+   its distinctive Cyrillic script. */
+static const struct fts_language *
+fts_language_detect_script(struct fts_language_list *list,
+			   const unsigned char *text, size_t size)
+{
+	const struct fts_language *lang, *match;
+	enum fts_language_script script = FTS_LANGUAGE_SCRIPT_UNKNOWN;
+	enum fts_language_script chr_script;
+	unsigned int letters = 0, matches = 0;
+	unichar_t chr;
+	size_t i;
+	int ret;
+
+	if (size > DETECT_STR_MAX_LEN)
+		size = DETECT_STR_MAX_LEN;
+	for (i = 0; i < size; i += ret) {
+		ret = uni_utf8_get_char_n(text + i, size - i, &chr);
+		if (ret == 0) {
+			/* incomplete trailing character - ignore it */
+			break;
+		}
+		if (ret < 0) {
+			/* invalid UTF-8 input - no shortcuts */
+			return NULL;
+		}
+		chr_script = fts_language_script_of_char(chr);
+		if (chr_script == FTS_LANGUAGE_SCRIPT_UNKNOWN) {
+			/* whitespace, digits, combining marks and punctuation
+			   (including the general punctuation block) are
+			   neutral. anything else is likely a letter of some
+			   other script, so no shortcuts. */
+			if (chr >= 0x0370 &&
+			    (chr < 0x2000 || chr > 0x20ff))
+				return NULL;
+			continue;
+		}
+		if (script == FTS_LANGUAGE_SCRIPT_UNKNOWN)
+			script = chr_script;
+		else if (script != chr_script) {
+			/* mixed scripts */
+			return NULL;
+		}
+		letters++;
+	}
+	if (script == FTS_LANGUAGE_SCRIPT_UNKNOWN ||
+	    letters < DETECT_SCRIPT_MIN_LETTERS)
+		return NULL;
+
+	match = NULL;
+	array_foreach_elem(&list->languages, lang) {
+		if (fts_language_script(lang->name) == script) {
+			match = lang;
+			matches++;
+		}
+	}
+	/* the script must identify the language unambiguously */
+	return matches == 1 ? match : NULL;
+}
+
 #ifdef HAVE_FTS_EXTTEXTCAT
 static void fts_textcat_unref(struct fts_textcat *textcat)
 {
@@ -355,6 +483,8 @@ fts_language_detect(struct fts_language_list *list,
 		    const struct fts_language **lang_r,
 		    const char **error_r)
 {
+	const struct fts_language *lang;
+
 	i_assert(array_count(&list->languages) > 0);
 
 	/* if there's only a single wanted language, return it always. */
@@ -364,5 +494,11 @@ fts_language_detect(struct fts_language_list *list,
 		*lang_r = *langp;
 		return FTS_LANGUAGE_RESULT_OK;
 	}
+
+	lang = fts_language_detect_script(list, text, size);
+	if (lang != NULL) {
+		*lang_r = lang;
+		return FTS_LANGUAGE_RESULT_OK;
+	}
 	return fts_language_detect_textcat(list, text, size, lang_r, error_r);
 }
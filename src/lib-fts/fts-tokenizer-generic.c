@@ -355,6 +355,44 @@ fts_tokenizer_generic_simple_next(struct fts_tokenizer *_tok,
 
 	start = tok->token->used > 0 ? 0 : skip_base64(data, size);
 	for (i = start; i < size; i += char_size) {
+		/* Fast path: classify runs of ASCII bytes with just the
+		   fts_ascii_word_breaks[] table. Inside a word a run of
+		   non-breaking bytes only keeps the state as-is, and outside
+		   one a run of breaking bytes is simply skipped over, so
+		   neither needs the per-character UTF-8 decoding and word
+		   break state machine. Anything that could change the state
+		   in other ways (non-ASCII, apostrophes, prefix splats) falls
+		   through to the full classifier below. */
+		if (data[i] < 0x80 && tok->prev_type == LETTER_TYPE_ALETTER &&
+		    fts_ascii_word_breaks[data[i]] == 0 && data[i] != '\'') {
+			size_t run = i + 1;
+
+			while (run < size && data[run] < 0x80 &&
+			       fts_ascii_word_breaks[data[run]] == 0 &&
+			       data[run] != '\'')
+				run++;
+			shift_prev_type(tok, LETTER_TYPE_ALETTER);
+			if (run - i > 1)
+				shift_prev_type(tok, LETTER_TYPE_ALETTER);
+			char_size = (int)(run - i);
+			continue;
+		}
+		if (data[i] < 0x80 && tok->prev_type == LETTER_TYPE_NONE &&
+		    tok->token->used == 0 && i == start &&
+		    fts_ascii_word_breaks[data[i]] != 0) {
+			size_t run = i + 1;
+
+			while (run < size && data[run] < 0x80 &&
+			       fts_ascii_word_breaks[data[run]] != 0)
+				run++;
+			shift_prev_type(tok, LETTER_TYPE_NONE);
+			if (run - i > 1)
+				shift_prev_type(tok, LETTER_TYPE_NONE);
+			char_size = (int)(run - i);
+			start = run;
+			continue;
+		}
+
 		char_size = uni_utf8_get_char_n(data + i, size - i, &c);
 		i_assert(char_size > 0);
 
@@ -0,0 +1,112 @@
+#!/usr/bin/env perl
+# Generates stopwords-data.c from the shipped stopword lists. The output
+# contains one minimal perfect hash table (CHD construction) per language,
+# so the built-in lists need no runtime parsing or hash table building.
+# The hash function below must stay identical to fts_stopwords_hash() in
+# fts-filter-stopwords.c, which #includes the generated file.
+use strict;
+use warnings;
+
+my $dir = shift(@ARGV) or die "usage: $0 <stopwords-dir>";
+
+# 32-bit FNV-1a, seeded. Must match fts_stopwords_hash().
+sub fnv1a_hash {
+    my ($key, $seed) = @_;
+    my $h = (2166136261 ^ $seed) & 0xffffffff;
+    foreach my $byte (unpack("C*", $key)) {
+	$h = (($h ^ $byte) * 16777619) & 0xffffffff;
+    }
+    return $h;
+}
+
+sub read_list {
+    my ($path) = @_;
+    my %words;
+    open(my $fh, '<', $path) or die "open $path: $!";
+    while (my $line = <$fh>) {
+	$line =~ s/\r?\n$//;
+	# same parsing rules as fts_filter_stopwords_read_list()
+	my ($word) = ($line =~ /^([^|#\t ]+)/);
+	next unless defined($word);
+	next if ($word =~ m{[/\\<>.,":()\t\n\r]});
+	$words{$word} = 1;
+    }
+    close($fh);
+    return sort keys %words;
+}
+
+# CHD: distribute keys into $n buckets with the unseeded hash, then find
+# for each bucket (largest first) a seed that maps its keys to free slots.
+sub build_mph {
+    my (@words) = @_;
+    my $n = scalar(@words);
+    my @buckets = map { [] } (1..$n);
+    foreach my $word (@words) {
+	push(@{$buckets[fnv1a_hash($word, 0) % $n]}, $word);
+    }
+    my @seeds = (0) x $n;
+    my @slots = (undef) x $n;
+    foreach my $idx (sort { scalar(@{$buckets[$b]}) <=>
+			    scalar(@{$buckets[$a]}) } (0..$n-1)) {
+	my @keys = @{$buckets[$idx]};
+	last if (scalar(@keys) == 0);
+	my $seed = 1;
+	for (;; $seed++) {
+	    die "no seed found for bucket of ".scalar(@keys)." keys"
+		if ($seed > 1000000);
+	    my %used;
+	    foreach my $key (@keys) {
+		my $slot = fnv1a_hash($key, $seed) % $n;
+		if (defined($slots[$slot]) || exists($used{$slot})) {
+		    %used = ();
+		    last;
+		}
+		$used{$slot} = $key;
+	    }
+	    next if (scalar(keys %used) != scalar(@keys));
+	    $slots[$_] = $used{$_} foreach (keys %used);
+	    $seeds[$idx] = $seed;
+	    last;
+	}
+    }
+    return (\@seeds, \@slots);
+}
+
+sub c_string {
+    my ($str) = @_;
+    $str =~ s/([\\"])/\\$1/g;
+    $str =~ s/([^\x20-\x7e])/sprintf("\\%03o", ord($1))/ge;
+    return "\"$str\"";
+}
+
+my @languages;
+foreach my $path (sort glob("$dir/stopwords_*.txt")) {
+    my ($lang) = ($path =~ m{/stopwords_(\w+)\.txt$});
+    next if ($lang eq 'malformed');
+    my @words = read_list($path);
+    die "$path: no stopwords found" if (scalar(@words) == 0);
+    push(@languages, [$lang, \@words]);
+}
+
+print "/* This file is automatically generated by stopwords-perfect-hash.pl */\n";
+foreach my $entry (@languages) {
+    my ($lang, $words) = @$entry;
+    my ($seeds, $slots) = build_mph(@$words);
+    print "\nstatic const char *const stopwords_${lang}_words[] = {\n";
+    print "\t", c_string($_), ",\n" foreach (@$slots);
+    print "};\n";
+    print "static const uint32_t stopwords_${lang}_seeds[] = {\n";
+    my @seedlist = @$seeds;
+    while (scalar(@seedlist)) {
+	print("\t", join(", ", splice(@seedlist, 0, 12)));
+	print(scalar(@seedlist) ? ",\n" : "\n");
+    }
+    print "};\n";
+}
+print "\nstatic const struct fts_stopwords_builtin fts_stopwords_builtin[] = {\n";
+foreach my $entry (@languages) {
+    my ($lang, $words) = @$entry;
+    my $n = scalar(@$words);
+    print "\t{ \"$lang\", stopwords_${lang}_words, stopwords_${lang}_seeds, $n },\n";
+}
+print "};\n";
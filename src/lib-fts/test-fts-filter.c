@@ -213,6 +213,47 @@ static void test_fts_filter_stopwords_eng(void)
 	test_end();
 }
 
+static void test_fts_filter_stopwords_builtin(void)
+{
+	static const char *const empty_settings[] = {NULL};
+	struct fts_filter *filter;
+	const char *error;
+	int ret;
+	const char *input[] = {"an", "elephant", "and", "a", "bear",
+	                       "drive", "by", "for", "no", "reason",
+	                       "they", "will", "not",  "sing", NULL};
+	const char *output[] = {NULL, "elephant", NULL, NULL, "bear",
+	                       "drive", NULL, NULL, NULL, "reason",
+	                       NULL, NULL, NULL,  "sing"};
+	const char **ip, **op;
+	const char *token;
+
+	test_begin("fts filter stopwords, built-in English list");
+	/* no stopwords_dir setting, so the compiled-in perfect hash table
+	   is used and no stopword file is read */
+	test_assert(fts_filter_create(fts_filter_stopwords, NULL, &english_language, empty_settings, &filter, &error) == 0);
+
+	ip = input;
+	op = output;
+	while (*ip != NULL) {
+		token = *ip;
+		ret = fts_filter_filter(filter, &token, &error);
+		if (ret <= 0) {
+			test_assert(ret == 0);
+			test_assert(*op == NULL);
+		} else {
+			test_assert(*op != NULL);
+			test_assert(strcmp(*ip, token)  == 0);
+		}
+		op++;
+		ip++;
+	}
+
+	fts_filter_unref(&filter);
+	test_assert(filter == NULL);
+	test_end();
+}
+
 static void test_fts_filter_stopwords_fin(void)
 {
 	const struct fts_language finnish = { .name = "fi" };
@@ -988,6 +1029,7 @@ int main(void)
 		test_fts_filter_lowercase_too_long_utf8,
 #endif
 		test_fts_filter_stopwords_eng,
+		test_fts_filter_stopwords_builtin,
 		test_fts_filter_stopwords_fin,
 		test_fts_filter_stopwords_fra,
 		test_fts_filter_stopwords_no,
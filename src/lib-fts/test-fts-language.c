@@ -278,6 +278,60 @@ static void test_fts_language_detect_unknown(void)
 	fts_language_list_deinit(&lp);
 	test_end();
 }
+/* Detect English via the script fast path: the only Latin-script language
+   wanted. Works without textcat. */
+static void test_fts_language_detect_script_english(void)
+{
+	struct fts_language_list *lp = NULL;
+	const struct fts_language *lang_r = NULL;
+	const unsigned char english[]  = "Whereas recognition of the inherent "\
+		"dignity and of the equal and inalienable rights of all members "\
+		"of the human family is the foundation of freedom, justice and "\
+		"peace in the world, ";
+
+	const char names[] = "en, ru";
+	const char *unknown, *error;
+	test_begin("fts language detect script English");
+	test_assert(fts_language_list_init(settings, &lp, &error) == 0);
+	test_assert(fts_language_list_add_names(lp, names, &unknown) == TRUE);
+	test_assert(fts_language_detect(lp, english, sizeof(english)-1, &lang_r, &error)
+	            == FTS_LANGUAGE_RESULT_OK);
+	test_assert(strcmp(lang_r->name, "en") == 0);
+	fts_language_list_deinit(&lp);
+	test_end();
+}
+
+/* Detect Russian via the script fast path: the only Cyrillic-script language
+   wanted. Works without textcat. */
+static void test_fts_language_detect_script_russian(void)
+{
+	struct fts_language_list *lp = NULL;
+	const struct fts_language *lang_r = NULL;
+	/* "Все люди рождаются свободными и равными в своем достоинстве и
+	   правах." */
+	const unsigned char russian[] =
+		"\xD0\x92\xD1\x81\xD0\xB5 \xD0\xBB\xD1\x8E\xD0\xB4\xD0\xB8 "\
+		"\xD1\x80\xD0\xBE\xD0\xB6\xD0\xB4\xD0\xB0\xD1\x8E\xD1\x82"\
+		"\xD1\x81\xD1\x8F \xD1\x81\xD0\xB2\xD0\xBE\xD0\xB1\xD0\xBE"\
+		"\xD0\xB4\xD0\xBD\xD1\x8B\xD0\xBC\xD0\xB8 \xD0\xB8 "\
+		"\xD1\x80\xD0\xB0\xD0\xB2\xD0\xBD\xD1\x8B\xD0\xBC\xD0\xB8 "\
+		"\xD0\xB2 \xD1\x81\xD0\xB2\xD0\xBE\xD0\xB5\xD0\xBC "\
+		"\xD0\xB4\xD0\xBE\xD1\x81\xD1\x82\xD0\xBE\xD0\xB8\xD0\xBD"\
+		"\xD1\x81\xD1\x82\xD0\xB2\xD0\xB5 \xD0\xB8 \xD0\xBF\xD1\x80"\
+		"\xD0\xB0\xD0\xB2\xD0\xB0\xD1\x85.";
+
+	const char names[] = "en, fi, ru";
+	const char *unknown, *error;
+	test_begin("fts language detect script Russian");
+	test_assert(fts_language_list_init(settings, &lp, &error) == 0);
+	test_assert(fts_language_list_add_names(lp, names, &unknown) == TRUE);
+	test_assert(fts_language_detect(lp, russian, sizeof(russian)-1, &lang_r, &error)
+	            == FTS_LANGUAGE_RESULT_OK);
+	test_assert(strcmp(lang_r->name, "ru") == 0);
+	fts_language_list_deinit(&lp);
+	test_end();
+}
+
 static void test_fts_language_find_builtin(void)
 {
 	const struct fts_language *lp;
@@ -312,6 +366,8 @@ int main(void)
 		test_fts_language_detect_finnish_as_english,
 		test_fts_language_detect_na,
 		test_fts_language_detect_unknown,
+		test_fts_language_detect_script_english,
+		test_fts_language_detect_script_russian,
 		test_fts_language_find_builtin,
 		test_fts_language_register,
 		NULL
@@ -897,16 +897,64 @@ static void http_client_peer_check_idle(struct http_client_peer *peer)
 		http_client_connection_check_idle(conn);
 }
 
+struct http_client_peer_conn_avail {
+	struct http_client_connection *conn;
+	unsigned int pending_requests;
+};
+ARRAY_DEFINE_TYPE(http_client_peer_conn_avail,
+		  struct http_client_peer_conn_avail);
+
+static unsigned int
+http_client_peer_fill_pipelines(
+	struct http_client_peer *peer,
+	ARRAY_TYPE(http_client_peer_conn_avail) *conns_avail,
+	unsigned int *num_pending, unsigned int num_urgent)
+{
+	struct http_client_peer_conn_avail *conn_avail_idx;
+	unsigned int pipeline_level = 0, total_handled = 0, handled;
+
+	/* Fill pipelines */
+	do {
+		handled = 0;
+		/* Fill smallest pipelines first,
+		   until all pipelines are filled to the same level */
+		array_foreach_modifiable(conns_avail, conn_avail_idx) {
+			if (conn_avail_idx->conn == NULL)
+				continue;
+			if (pipeline_level == 0) {
+				pipeline_level = conn_avail_idx->pending_requests;
+			} else if (conn_avail_idx->pending_requests > pipeline_level) {
+				pipeline_level = conn_avail_idx->pending_requests;
+				break; /* restart from least busy connection */
+			}
+			/* Pipeline it */
+			if (http_client_connection_next_request(conn_avail_idx->conn) <= 0) {
+				/* connection now unavailable */
+				conn_avail_idx->conn = NULL;
+			} else {
+				/* Successfully pipelined */
+				conn_avail_idx->pending_requests++;
+				*num_pending -= 1;
+				handled++;
+			}
+		}
+
+		total_handled += handled;
+	} while (*num_pending > num_urgent && handled > 0);
+
+	e_debug(peer->event,
+		"Pipelined %u requests "
+		"(filled pipelines up to %u requests)",
+		total_handled, pipeline_level);
+	return total_handled;
+}
+
 static void
 http_client_peer_handle_requests_real(struct http_client_peer *peer)
 {
-	struct _conn_available {
-		struct http_client_connection *conn;
-		unsigned int pending_requests;
-	};
 	struct http_client_connection *const *conn_idx;
-	ARRAY(struct _conn_available) conns_avail;
-	struct _conn_available *conn_avail_idx;
+	ARRAY_TYPE(http_client_peer_conn_avail) conns_avail;
+	struct http_client_peer_conn_avail *conn_avail_idx;
 	struct http_client_peer_shared *pshared = peer->shared;
 	unsigned int connecting, closing, idle;
 	unsigned int num_pending, num_urgent, new_connections;
@@ -968,7 +1016,7 @@ http_client_peer_handle_requests_real(struct http_client_peer *peer)
 				conn_lost = TRUE;
 				break;
 			} else if (ret > 0) {
-				struct _conn_available *conn_avail;
+				struct http_client_peer_conn_avail *conn_avail;
 				unsigned int insert_idx, pending_requests;
 
 				/* Compile sorted availability list */
@@ -1054,6 +1102,22 @@ http_client_peer_handle_requests_real(struct http_client_peer *peer)
 	i_assert(idle == 0);
 	connecting = array_count(&peer->pending_conns);
 
+	/* With prefer_pipelining, multiplex requests onto the pipelines of
+	   existing connections before considering new ones, so many
+	   concurrent requests are handled by few connections. */
+	if (peer->client->set.prefer_pipelining &&
+	    pshared->allows_pipelining &&
+	    (working_conn_count - connecting) > 0 &&
+	    http_client_peer_fill_pipelines(peer, &conns_avail,
+					    &num_pending, num_urgent) > 0) {
+		num_pending = http_client_peer_requests_pending(peer,
+								&num_urgent);
+		if (num_pending == 0) {
+			http_client_peer_check_idle(peer);
+			return;
+		}
+	}
+
 	/* Determine how many new connections we can set up */
 	if (pshared->last_failure.tv_sec > 0 && working_conn_count > 0 &&
 	    working_conn_count == connecting) {
@@ -1107,47 +1171,14 @@ http_client_peer_handle_requests_real(struct http_client_peer *peer)
 	 */
 	if ((working_conn_count - connecting) >=
 	    peer->client->set.max_parallel_connections) {
-		unsigned int pipeline_level = 0, total_handled = 0, handled;
-
 		if (!pshared->allows_pipelining) {
 			e_debug(peer->event,
 				"Will not pipeline until peer has shown support");
 			return;
 		}
 
-		/* Fill pipelines */
-		do {
-			handled = 0;
-			/* Fill smallest pipelines first,
-			   until all pipelines are filled to the same level */
-			array_foreach_modifiable(&conns_avail, conn_avail_idx) {
-				if (conn_avail_idx->conn == NULL)
-					continue;
-				if (pipeline_level == 0) {
-					pipeline_level = conn_avail_idx->pending_requests;
-				} else if (conn_avail_idx->pending_requests > pipeline_level) {
-					pipeline_level = conn_avail_idx->pending_requests;
-					break; /* restart from least busy connection */
-				}
-				/* Pipeline it */
-				if (http_client_connection_next_request(conn_avail_idx->conn) <= 0) {
-					/* connection now unavailable */
-					conn_avail_idx->conn = NULL;
-				} else {
-					/* Successfully pipelined */
-					conn_avail_idx->pending_requests++;
-					num_pending--;
-					handled++;
-				}
-			}
-
-			total_handled += handled;
-		} while (num_pending > num_urgent && handled > 0);
-
-		e_debug(peer->event,
-			"Pipelined %u requests "
-			"(filled pipelines up to %u requests)",
-			total_handled, pipeline_level);
+		(void)http_client_peer_fill_pipelines(peer, &conns_avail,
+						      &num_pending, num_urgent);
 		return;
 	}
 
@@ -9,6 +9,7 @@
 #include "llist.h"
 #include "time-util.h"
 #include "istream.h"
+#include "istream-seekable.h"
 #include "ostream.h"
 #include "file-lock.h"
 #include "dns-lookup.h"
@@ -20,6 +21,11 @@
 
 #include "http-client-private.h"
 
+/* Maximum size kept in memory when spooling a non-seekable payload for
+   http_client_request_set_payload_replayable(); larger payloads spill over
+   into a temporary file. */
+#define HTTP_CLIENT_REQUEST_PAYLOAD_SPOOL_MEMORY_MAX (128*1024)
+
 const char *http_request_state_names[] = {
 	"new",
 	"queued",
@@ -584,6 +590,49 @@ void http_client_request_set_payload(struct http_client_request *req,
 	i_stream_unref(&input);
 }
 
+void http_client_request_set_payload_replayable(struct http_client_request *req,
+						struct istream *input,
+						bool sync)
+{
+	struct istream *inputs[2];
+	const char *name;
+
+	if (input->seekable) {
+		/* replayable as-is */
+		http_client_request_set_payload(req, input, sync);
+		return;
+	}
+
+	if (req->state == HTTP_REQUEST_STATE_ABORTED)
+		return;
+
+	i_assert(req->state == HTTP_REQUEST_STATE_NEW);
+	i_assert(req->payload_input == NULL);
+	i_assert(req->client != NULL &&
+		 req->client->set.temp_path_prefix != NULL);
+
+	/* Spool the payload only as far as it has been read for sending, so
+	   that a retry can rewind it without the caller having to buffer the
+	   whole payload in memory first. The payload size is not determined
+	   up front, since that would require reading the whole stream; the
+	   payload is sent chunked instead. */
+	inputs[0] = input;
+	inputs[1] = NULL;
+	name = i_stream_get_name(input);
+	input = i_stream_create_seekable_path(
+		inputs, HTTP_CLIENT_REQUEST_PAYLOAD_SPOOL_MEMORY_MAX,
+		req->client->set.temp_path_prefix);
+	if (name != NULL && *name != '\0')
+		i_stream_set_name(input, name);
+
+	req->payload_input = input;
+	req->payload_size = 0;
+	req->payload_chunked = TRUE;
+	req->payload_offset = input->v_offset;
+	if (sync)
+		req->payload_sync = TRUE;
+}
+
 void http_client_request_set_payload_data(struct http_client_request *req,
 					  const unsigned char *data,
 					  size_t size)
@@ -1732,7 +1781,8 @@ http_client_request_reset(struct http_client_request *req, bool rewind,
 			  const char **error_r)
 {
 	/* Rewind payload stream */
-	if (rewind && req->payload_input != NULL && req->payload_size > 0) {
+	if (rewind && req->payload_input != NULL &&
+	    (req->payload_size > 0 || req->payload_chunked)) {
 		if (req->payload_input->v_offset != req->payload_offset &&
 		    !req->payload_input->seekable) {
 			*error_r = "Cannot resend payload; "
@@ -162,6 +162,10 @@ http_client_init_shared(struct http_client_context *cctx,
 			client->set.user_agent = p_strdup_empty(pool, set->user_agent);
 		if (set->rawlog_dir != NULL && *set->rawlog_dir != '\0')
 			client->set.rawlog_dir = p_strdup_empty(pool, set->rawlog_dir);
+		if (set->temp_path_prefix != NULL && *set->temp_path_prefix != '\0') {
+			client->set.temp_path_prefix =
+				p_strdup_empty(pool, set->temp_path_prefix);
+		}
 
 		if (set->ssl != NULL)
 			client->set.ssl = ssl_iostream_settings_dup(pool, set->ssl);
@@ -190,6 +194,8 @@ http_client_init_shared(struct http_client_context *cctx,
 			client->set.max_parallel_connections = set->max_parallel_connections;
 		if (set->max_pipelined_requests > 0)
 			client->set.max_pipelined_requests = set->max_pipelined_requests;
+		client->set.prefer_pipelining =
+			client->set.prefer_pipelining || set->prefer_pipelining;
 		if (set->max_attempts > 0)
 			client->set.max_attempts = set->max_attempts;
 		if (set->max_connect_attempts > 0)
@@ -461,6 +467,7 @@ http_client_context_create(const struct http_client_settings *set)
 			HTTP_CLIENT_DEFAULT_DNS_TTL_MSECS : set->dns_ttl_msecs);
 	cctx->set.user_agent = p_strdup_empty(pool, set->user_agent);
 	cctx->set.rawlog_dir = p_strdup_empty(pool, set->rawlog_dir);
+	cctx->set.temp_path_prefix = p_strdup_empty(pool, set->temp_path_prefix);
 
 	if (set->ssl != NULL)
 		cctx->set.ssl = ssl_iostream_settings_dup(pool, set->ssl);
@@ -501,6 +508,7 @@ http_client_context_create(const struct http_client_settings *set)
 		(set->connect_backoff_max_time_msecs == 0 ?
 		 HTTP_CLIENT_DEFAULT_BACKOFF_MAX_TIME_MSECS :
 		 set->connect_backoff_max_time_msecs);
+	cctx->set.prefer_pipelining = set->prefer_pipelining;
 	cctx->set.no_auto_redirect = set->no_auto_redirect;
 	cctx->set.no_auto_retry = set->no_auto_retry;
 	cctx->set.no_ssl_tunnel = set->no_ssl_tunnel;
@@ -46,6 +46,11 @@ struct http_client_settings {
 	/* Directory for writing raw log data for debugging purposes */
 	const char *rawlog_dir;
 
+	/* Prefix for temporary files used to make non-seekable request
+	   payloads replayable for retries (required for
+	   http_client_request_set_payload_replayable()) */
+	const char *temp_path_prefix;
+
 	/* Maximum time a connection will idle. if parallel connections are
 	   idle, the duplicates will end earlier based on how many idle
 	   connections exist to that same service. */
@@ -57,6 +62,14 @@ struct http_client_settings {
 	/* Maximum number of pipelined requests per connection (default = 1) */
 	unsigned int max_pipelined_requests;
 
+	/* Fill the request pipelines of existing connections (up to
+	   max_pipelined_requests) before creating new parallel connections.
+	   This multiplexes many concurrent requests over few connections,
+	   which cuts down connection and TLS handshake counts, at the cost of
+	   possible head-of-line blocking behind slow responses. Pipelining is
+	   still used only once the server has shown support for it. */
+	bool prefer_pipelining;
+
 	/* Don't automatically act upon redirect responses */
 	bool no_auto_redirect;
 
@@ -331,6 +344,17 @@ void http_client_request_set_date(struct http_client_request *req, time_t date);
    payload that can be large. */
 void http_client_request_set_payload(struct http_client_request *req,
 				     struct istream *input, bool sync);
+/* Same as http_client_request_set_payload(), but guarantee that the payload
+   can be replayed when the request is retried. A seekable input stream is
+   used as-is. A non-seekable input stream is read only as far as the request
+   has been sent and is spooled to memory or - past a small limit - to a
+   temporary file (see the temp_path_prefix setting), so the caller doesn't
+   need to buffer the whole payload in memory up front to make the request
+   retryable. The payload size is not determined up front in that case; it is
+   sent with chunked transfer encoding. */
+void http_client_request_set_payload_replayable(struct http_client_request *req,
+						struct istream *input,
+						bool sync);
 /* Assign payload data to the request. The data is copied to the request pool.
    If your data is already durably allocated during the existence of the
    request, you should consider using http_client_request_set_payload() with
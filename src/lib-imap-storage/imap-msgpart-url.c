@@ -105,6 +105,12 @@ struct mailbox *imap_msgpart_url_get_mailbox(struct imap_msgpart_url *mpurl)
 	return mpurl->box;
 }
 
+void imap_msgpart_url_set_mailbox(struct imap_msgpart_url *mpurl,
+				  struct mailbox *box)
+{
+	mpurl->selected_box = box;
+}
+
 int imap_msgpart_url_open_mailbox(struct imap_msgpart_url *mpurl,
 				  struct mailbox **box_r, enum mail_error *error_code_r,
 				  const char **client_error_r)
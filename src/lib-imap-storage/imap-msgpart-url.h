@@ -22,6 +22,11 @@ int imap_msgpart_url_open_mailbox(struct imap_msgpart_url *mpurl,
 				  struct mailbox **box_r, enum mail_error *error_code_r,
 				  const char **client_error_r);
 struct mailbox *imap_msgpart_url_get_mailbox(struct imap_msgpart_url *mpurl);
+/* Use the given already opened mailbox for the URL if it matches the URL's
+   mailbox. The mailbox isn't freed with the URL; ownership stays with the
+   caller. */
+void imap_msgpart_url_set_mailbox(struct imap_msgpart_url *mpurl,
+				  struct mailbox *box);
 int imap_msgpart_url_open_mail(struct imap_msgpart_url *mpurl,
 			       struct mail **mail_r,
 			       const char **client_error_r);
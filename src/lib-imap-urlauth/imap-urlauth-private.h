@@ -2,6 +2,12 @@
 #define IMAP_URLAUTH_PRIVATE_H
 
 #include "imap-urlauth.h"
+#include "imap-urlauth-backend.h"
+
+struct imap_urlauth_key_cache_entry {
+	char *mailbox_vname;
+	unsigned char key[IMAP_URLAUTH_KEY_LEN];
+};
 
 struct imap_urlauth_context {
 	struct mail_user *user;
@@ -14,6 +20,13 @@ struct imap_urlauth_context {
 	char *access_service;
 	const char **access_applications;
 
+	/* recently used mailbox keys, so verifying each URL in a session
+	   doesn't redo the mailbox attribute lookup */
+	ARRAY(struct imap_urlauth_key_cache_entry) key_cache;
+	/* mailbox opened by the previous fetched URL, kept open for the
+	   next URL in the session */
+	struct mailbox *cached_box;
+
 	bool access_anonymous:1;
 };
 
@@ -1,6 +1,7 @@
 /* Copyright (c) 2013-2018 Dovecot authors, see the included COPYING file */
 
 #include "lib.h"
+#include "array.h"
 #include "hostpid.h"
 #include "var-expand.h"
 #include "hmac.h"
@@ -28,6 +29,71 @@
 
 #define URL_HOST_ALLOW_ANY "*"
 
+#define IMAP_URLAUTH_KEY_CACHE_MAX_ENTRIES 8
+
+static bool
+imap_urlauth_key_cache_lookup(struct imap_urlauth_context *uctx,
+			      const char *mailbox_vname,
+			      unsigned char key_r[IMAP_URLAUTH_KEY_LEN])
+{
+	const struct imap_urlauth_key_cache_entry *entry;
+
+	if (!array_is_created(&uctx->key_cache))
+		return FALSE;
+	array_foreach(&uctx->key_cache, entry) {
+		if (strcmp(entry->mailbox_vname, mailbox_vname) == 0) {
+			memcpy(key_r, entry->key, IMAP_URLAUTH_KEY_LEN);
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static void
+imap_urlauth_key_cache_add(struct imap_urlauth_context *uctx,
+			   const char *mailbox_vname,
+			   const unsigned char key[IMAP_URLAUTH_KEY_LEN])
+{
+	struct imap_urlauth_key_cache_entry *entry;
+
+	if (!array_is_created(&uctx->key_cache)) {
+		i_array_init(&uctx->key_cache,
+			     IMAP_URLAUTH_KEY_CACHE_MAX_ENTRIES);
+	} else if (array_count(&uctx->key_cache) >=
+		   IMAP_URLAUTH_KEY_CACHE_MAX_ENTRIES) {
+		/* drop the oldest entry */
+		entry = array_front_modifiable(&uctx->key_cache);
+		safe_memset(entry->key, 0, IMAP_URLAUTH_KEY_LEN);
+		i_free(entry->mailbox_vname);
+		array_pop_front(&uctx->key_cache);
+	}
+	entry = array_append_space(&uctx->key_cache);
+	entry->mailbox_vname = i_strdup(mailbox_vname);
+	memcpy(entry->key, key, IMAP_URLAUTH_KEY_LEN);
+}
+
+/* mailbox_vname=NULL drops all the cached keys */
+static void
+imap_urlauth_key_cache_remove(struct imap_urlauth_context *uctx,
+			      const char *mailbox_vname)
+{
+	struct imap_urlauth_key_cache_entry *entry;
+	unsigned int i, count;
+
+	if (!array_is_created(&uctx->key_cache))
+		return;
+	count = array_count(&uctx->key_cache);
+	for (i = count; i > 0; i--) {
+		entry = array_idx_modifiable(&uctx->key_cache, i - 1);
+		if (mailbox_vname != NULL &&
+		    strcmp(entry->mailbox_vname, mailbox_vname) != 0)
+			continue;
+		safe_memset(entry->key, 0, IMAP_URLAUTH_KEY_LEN);
+		i_free(entry->mailbox_vname);
+		array_delete(&uctx->key_cache, i - 1, 1);
+	}
+}
+
 struct imap_urlauth_context *
 imap_urlauth_init(struct mail_user *user,
 		  const struct imap_urlauth_config *config)
@@ -74,6 +140,11 @@ void imap_urlauth_deinit(struct imap_urlauth_context **_uctx)
 
 	if (uctx->conn != NULL)
 		imap_urlauth_connection_deinit(&uctx->conn);
+	imap_urlauth_key_cache_remove(uctx, NULL);
+	if (array_is_created(&uctx->key_cache))
+		array_free(&uctx->key_cache);
+	if (uctx->cached_box != NULL)
+		mailbox_free(&uctx->cached_box);
 	i_free(uctx->url_host);
 	i_free(uctx->access_user);
 	i_free(uctx->access_service);
@@ -434,6 +505,17 @@ int imap_urlauth_fetch_parsed(struct imap_urlauth_context *uctx,
 		return -1;
 	}
 
+	/* reuse the mailbox opened by the previous URL if it's the same.
+	   sync it first, so mails appended since it was opened are visible
+	   (BURL fetches mails right after they were appended). */
+	if (uctx->cached_box != NULL &&
+	    strcmp(mailbox_get_vname(uctx->cached_box), url->mailbox) == 0) {
+		if (mailbox_sync(uctx->cached_box, 0) < 0)
+			mailbox_free(&uctx->cached_box);
+		else
+			imap_msgpart_url_set_mailbox(mpurl, uctx->cached_box);
+	}
+
 	if ((ret = imap_msgpart_url_open_mailbox(mpurl, &box, error_code_r,
 						 client_error_r)) < 0) {
 		imap_msgpart_url_free(&mpurl);
@@ -456,11 +538,20 @@ int imap_urlauth_fetch_parsed(struct imap_urlauth_context *uctx,
 	}
 
 	/* Obtain mailbox key */
-	ret = imap_urlauth_backend_get_mailbox_key(box, FALSE, mailbox_key,
-						   client_error_r, error_code_r);
-	if (ret < 0) {
-		imap_msgpart_url_free(&mpurl);
-		return -1;
+	const char *vname = mailbox_get_vname(box);
+	if (imap_urlauth_key_cache_lookup(uctx, vname, mailbox_key))
+		ret = 1;
+	else {
+		ret = imap_urlauth_backend_get_mailbox_key(box, FALSE,
+							   mailbox_key,
+							   client_error_r,
+							   error_code_r);
+		if (ret < 0) {
+			imap_msgpart_url_free(&mpurl);
+			return -1;
+		}
+		if (ret > 0)
+			imap_urlauth_key_cache_add(uctx, vname, mailbox_key);
 	}
 
 	if (ret == 0 ||
@@ -473,6 +564,15 @@ int imap_urlauth_fetch_parsed(struct imap_urlauth_context *uctx,
 		ret = 0;
 	} else {
 		ret = 1;
+		if (box != uctx->cached_box) {
+			/* keep the mailbox open for the next URL in this
+			   session - BURL submission flows fetch from the
+			   same mailbox repeatedly */
+			if (uctx->cached_box != NULL)
+				mailbox_free(&uctx->cached_box);
+			uctx->cached_box = box;
+			imap_msgpart_url_set_mailbox(mpurl, box);
+		}
 	}
 
 	safe_memset(mailbox_key, 0, sizeof(mailbox_key));
@@ -501,12 +601,14 @@ int imap_urlauth_fetch(struct imap_urlauth_context *uctx,
 }
 
 int imap_urlauth_reset_mailbox_key(
-	struct imap_urlauth_context *uctx ATTR_UNUSED, struct mailbox *box)
+	struct imap_urlauth_context *uctx, struct mailbox *box)
 {
+	imap_urlauth_key_cache_remove(uctx, mailbox_get_vname(box));
 	return imap_urlauth_backend_reset_mailbox_key(box);
 }
 
 int imap_urlauth_reset_all_keys(struct imap_urlauth_context *uctx)
 {
+	imap_urlauth_key_cache_remove(uctx, NULL);
 	return imap_urlauth_backend_reset_all_keys(uctx->user);
 }
@@ -0,0 +1,65 @@
+/* Copyright (c) 2026 Dovecot authors, see the included COPYING file */
+
+#include "lib.h"
+#include "istream.h"
+#include "strnum.h"
+#include "time-util.h"
+#include "imap-parser.h"
+
+#include <stdio.h>
+
+/* Measures imap_parser_read_args() throughput by repeatedly parsing a
+   typical client FETCH command line from an in-memory stream. */
+
+static const char bench_line[] =
+	"1:* (FLAGS INTERNALDATE RFC822.SIZE MODSEQ "
+	"BODY.PEEK[HEADER.FIELDS (FROM TO CC SUBJECT DATE MESSAGE-ID "
+	"REFERENCES IN-REPLY-TO LIST-ID)])\r\n";
+
+static void bench_imap_parser(unsigned long rounds)
+{
+	struct imap_parser *parser;
+	struct istream *input;
+	const struct imap_arg *args;
+	uint64_t ts_0, ts_1;
+	unsigned long r;
+	double secs;
+	int ret;
+
+	input = i_stream_create_from_data(bench_line, sizeof(bench_line)-1);
+	parser = imap_parser_create(input, NULL, 8192);
+
+	ts_0 = i_nanoseconds();
+	for (r = 0; r < rounds; r++) {
+		i_stream_seek(input, 0);
+		imap_parser_reset(parser);
+		ret = imap_parser_read_args(parser, 0, 0, &args);
+		i_assert(ret > 0);
+	}
+	ts_1 = i_nanoseconds();
+
+	secs = (double)(ts_1 - ts_0) / 1e9;
+	printf("imap_parser_read_args: %7.02lf lines/s, %0.02lf us/line "
+	       "(%zu byte line)\n",
+	       (double)rounds / secs,
+	       (double)(ts_1 - ts_0) / 1000.0 / (double)rounds,
+	       sizeof(bench_line)-1);
+
+	imap_parser_unref(&parser);
+	i_stream_unref(&input);
+}
+
+int main(int argc, const char *argv[])
+{
+	unsigned long rounds = 200000;
+
+	lib_init();
+
+	if (argc >= 2 && str_to_ulong(argv[1], &rounds) < 0)
+		i_fatal("Invalid round count: %s", argv[1]);
+
+	bench_imap_parser(rounds);
+
+	lib_deinit();
+	return 0;
+}
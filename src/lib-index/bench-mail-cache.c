@@ -0,0 +1,75 @@
+/* Copyright (c) 2026 Dovecot authors, see the included COPYING file */
+
+#include "lib.h"
+#include "str.h"
+#include "strnum.h"
+#include "time-util.h"
+#include "test-common.h"
+#include "test-mail-cache.h"
+
+#include <stdio.h>
+
+/* Measures mail-index append+sync and mail_cache_lookup_field() speed
+   using the same on-disk test index as the unit tests. The index is
+   created under the current directory and deleted afterwards. */
+
+static void bench_mail_cache(unsigned long mails, unsigned long rounds)
+{
+	struct test_mail_cache_ctx ctx;
+	struct mail_cache_view *cache_view;
+	string_t *str = t_str_new(64);
+	uint64_t ts_0, ts_1;
+	unsigned long r, m, lookups = 0;
+	double secs;
+
+	test_mail_cache_init(test_mail_index_init(), &ctx);
+
+	/* each append commits its own transaction and syncs the view,
+	   which matches how mails are added one at a time at delivery */
+	ts_0 = i_nanoseconds();
+	for (m = 0; m < mails; m++) {
+		test_mail_cache_add_mail(&ctx, ctx.cache_field.idx,
+					 "benchmark cache field data");
+	}
+	ts_1 = i_nanoseconds();
+	secs = (double)(ts_1 - ts_0) / 1e9;
+	printf("mail_index append+sync:  %9.0lf mails/s\n",
+	       (double)mails / secs);
+
+	cache_view = mail_cache_view_open(ctx.cache, ctx.view);
+	ts_0 = i_nanoseconds();
+	for (r = 0; r < rounds; r++) {
+		for (m = 1; m <= mails; m++) {
+			str_truncate(str, 0);
+			if (mail_cache_lookup_field(cache_view, str, m,
+						    ctx.cache_field.idx) <= 0)
+				i_unreached();
+			lookups++;
+		}
+	}
+	ts_1 = i_nanoseconds();
+	secs = (double)(ts_1 - ts_0) / 1e9;
+	printf("mail_cache_lookup_field: %9.0lf lookups/s\n",
+	       (double)lookups / secs);
+
+	mail_cache_view_close(&cache_view);
+	test_mail_cache_deinit(&ctx);
+	test_mail_index_delete();
+}
+
+int main(int argc, const char *argv[])
+{
+	unsigned long mails = 1000, rounds = 1000;
+
+	lib_init();
+
+	if (argc >= 2 && str_to_ulong(argv[1], &mails) < 0)
+		i_fatal("Invalid mail count: %s", argv[1]);
+	if (argc >= 3 && str_to_ulong(argv[2], &rounds) < 0)
+		i_fatal("Invalid round count: %s", argv[2]);
+
+	bench_mail_cache(mails, rounds);
+
+	lib_deinit();
+	return 0;
+}
@@ -151,6 +151,11 @@ struct mail_cache {
 	/* Size of the cache file as currently mapped to memory. Used for all
 	   of a), b), and c). */
 	size_t mmap_length;
+	/* Starting offset of the previous mail_cache_map() call. Used for
+	   detecting sequential access to the cache file. */
+	uoff_t prev_map_offset;
+	/* Number of consecutive mail_cache_map() calls at ascending offsets. */
+	unsigned int seq_map_count;
 	/* mail_cache_map() increases this always. Used only for asserts. */
 	unsigned int remap_counter;
 	/* Linked list of all cache views. */
@@ -556,7 +556,6 @@ mail_cache_purge_full(struct mail_cache *cache,
 	int ret;
 
 	i_assert(!cache->purging);
-	i_assert(cache->index->log_sync_locked);
 
 	if (MAIL_INDEX_IS_IN_MEMORY(cache->index) || cache->index->readonly)
 		return 0;
@@ -570,10 +569,11 @@ mail_cache_purge_full(struct mail_cache *cache,
 		cache->mmap_length = 0;
 	}
 
-	/* .log lock already prevents other processes from purging cache at
-	   the same time, but locking the cache file itself prevents other
-	   processes from doing other changes to it (header changes, adding
-	   more cached data). */
+	/* Locking the cache file prevents other processes from purging it at
+	   the same time, and also from doing other changes to it (header
+	   changes, adding more cached data). The .log sync lock isn't needed
+	   for the rewrite itself - the callers hold it only while the new
+	   cache offsets are being committed to the index. */
 	switch (mail_cache_lock(cache)) {
 	case -1:
 		/* lock timeout or some other error */
@@ -615,36 +615,50 @@ int mail_cache_purge(struct mail_cache *cache, uint32_t purge_file_seq,
 	bool lock_log;
 	int ret;
 
-	lock_log = !cache->index->log_sync_locked;
-	if (lock_log) {
-		uint32_t file_seq;
-		uoff_t file_offset;
-
-		if (mail_transaction_log_sync_lock(cache->index->log,
-						   "mail cache purge",
-						   &file_seq, &file_offset) < 0)
-			return -1;
-	}
 	/* make sure we see the latest changes in index */
 	ret = mail_index_refresh(cache->index);
 
 	view = mail_index_view_open(cache->index);
 	trans = mail_index_transaction_begin(view,
 		MAIL_INDEX_TRANSACTION_FLAG_EXTERNAL);
+	/* Write the new cache file without holding the .log sync lock. With
+	   large mailboxes the rewrite can take a long time, and holding the
+	   lock would block all concurrent index syncing (and with it normal
+	   mail access) for the whole duration. The cache file lock taken
+	   inside prevents concurrent purges. Cache records written to the
+	   old file during the rewrite are dropped by the file_seq check on
+	   the next access, the same way as with any purge. */
 	if (ret < 0)
 		;
 	else if ((ret = mail_cache_purge_full(cache, trans, purge_file_seq,
 					      reason)) < 0)
 		mail_index_transaction_rollback(&trans);
 	else {
-		if (mail_index_transaction_commit(&trans) < 0)
-			ret = -1;
+		/* Take the .log sync lock only for committing the new cache
+		   offsets, so others see at most the pause of a single
+		   transaction commit. */
+		lock_log = !cache->index->log_sync_locked;
+		if (lock_log) {
+			uint32_t file_seq;
+			uoff_t file_offset;
+
+			if (mail_transaction_log_sync_lock(cache->index->log,
+							   "mail cache purge",
+							   &file_seq, &file_offset) < 0) {
+				mail_index_transaction_rollback(&trans);
+				ret = -1;
+			}
+		}
+		if (ret == 0) {
+			if (mail_index_transaction_commit(&trans) < 0)
+				ret = -1;
+			if (lock_log) {
+				mail_transaction_log_sync_unlock(cache->index->log,
+								 "mail cache purge");
+			}
+		}
 	}
 	mail_index_view_close(&view);
-	if (lock_log) {
-		mail_transaction_log_sync_unlock(cache->index->log,
-						 "mail cache purge");
-	}
 	return ret;
 }
 
@@ -17,6 +17,13 @@
 
 #define MAIL_CACHE_MIN_HEADER_READ_SIZE 4096
 
+/* Read this much at once when the cache file is being accessed at ascending
+   offsets. */
+#define MAIL_CACHE_MAX_READAHEAD_SIZE (128*1024)
+/* Start reading ahead only after this many sequential mail_cache_map()
+   calls, so random lookups aren't slowed down by it. */
+#define MAIL_CACHE_READAHEAD_MIN_SEQ_COUNT 8
+
 static struct event_category event_category_mail_cache = {
 	.name = "mail-cache",
 };
@@ -412,6 +419,24 @@ mail_cache_map_full(struct mail_cache *cache, size_t offset, size_t size,
 	if (size == 0)
 		size = sizeof(struct mail_cache_header);
 
+	/* If the cache file is being accessed at (roughly) ascending offsets,
+	   the caller is most likely scanning through all the messages' records
+	   (e.g. FETCH of a cached field for the whole mailbox). Purging writes
+	   the records out in sequence order, so such scans can be sped up by
+	   reading the file ahead in large blocks instead of reading each
+	   record separately. */
+	if (offset >= cache->prev_map_offset &&
+	    offset - cache->prev_map_offset <= MAIL_CACHE_MAX_READAHEAD_SIZE) {
+		if (cache->seq_map_count < MAIL_CACHE_READAHEAD_MIN_SEQ_COUNT)
+			cache->seq_map_count++;
+		else if (cache->file_cache != NULL && !cache->map_with_read &&
+			 size < MAIL_CACHE_MAX_READAHEAD_SIZE)
+			size = MAIL_CACHE_MAX_READAHEAD_SIZE;
+	} else {
+		cache->seq_map_count = 1;
+	}
+	cache->prev_map_offset = offset;
+
 	/* verify offset + size before trying to allocate a huge amount of
 	   memory due to them. note that we may be prefetching more than we
 	   actually need, so don't fail too early. */
@@ -976,6 +1001,13 @@ void mail_cache_view_close(struct mail_cache_view **_view)
                 (void)mail_cache_header_fields_update(view->cache);
 
 	DLLIST_REMOVE(&view->cache->views, view);
+	if (view->cache->views == NULL && view->cache->file_cache != NULL) {
+		/* no lookups can be in progress anymore, so nothing points
+		   into the file cache's memory. if the process has more file
+		   cache memory than wanted, this cache can now be safely
+		   dropped. */
+		file_cache_mark_unused(view->cache->file_cache);
+	}
 	buffer_free(&view->cached_exists_buf);
 	i_free(view);
 }
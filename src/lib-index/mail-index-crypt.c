@@ -0,0 +1,198 @@
+/* Copyright (c) 2026 Dovecot authors, see the included COPYING file */
+
+#include "lib.h"
+#include "buffer.h"
+#include "randgen.h"
+#include "read-full.h"
+#include "safe-memset.h"
+#include "sha2.h"
+#include "mail-index-private.h"
+#include "dcrypt.h"
+
+#define MAIL_INDEX_CRYPT_VERSION 1
+#define MAIL_INDEX_CRYPT_ALGO "aes-256-gcm"
+#define MAIL_INDEX_CRYPT_IV_SIZE 12
+#define MAIL_INDEX_CRYPT_TAG_SIZE 16
+
+/* The first magic byte is deliberately not a valid major version, so readers
+   without the key (including older Dovecot versions) see the file as a major
+   version change and silently rebuild the index from the transaction log
+   instead of logging corruption errors. */
+static const uint8_t mail_index_crypt_magic[8] =
+	{ 0xfe, 'D', 'C', 'I', 'N', 'D', 'E', 'X' };
+
+/* Plaintext header in front of an encrypted dovecot.index. Everything after
+   it is the normal index image encrypted with AES-256-GCM. */
+struct mail_index_crypt_header {
+	uint8_t magic[sizeof(mail_index_crypt_magic)];
+	uint8_t version;
+	uint8_t unused[3];
+	uint8_t iv[MAIL_INDEX_CRYPT_IV_SIZE];
+	uint8_t tag[MAIL_INDEX_CRYPT_TAG_SIZE];
+};
+
+bool mail_index_crypt_header_detected(const void *data, size_t size)
+{
+	return size >= sizeof(mail_index_crypt_magic) &&
+		memcmp(data, mail_index_crypt_magic,
+		       sizeof(mail_index_crypt_magic)) == 0;
+}
+
+static int
+mail_index_crypt_ctx_create(struct mail_index *index,
+			    enum dcrypt_sym_mode mode,
+			    const uint8_t iv[MAIL_INDEX_CRYPT_IV_SIZE],
+			    struct dcrypt_context_symmetric **ctx_r,
+			    const char **error_r)
+{
+	struct dcrypt_context_symmetric *ctx;
+	unsigned char key[SHA256_RESULTLEN];
+
+	i_assert(index->set.crypt_key != NULL);
+
+	if (!dcrypt_is_initialized() &&
+	    !dcrypt_initialize(NULL, NULL, error_r))
+		return -1;
+	if (!dcrypt_ctx_sym_create(MAIL_INDEX_CRYPT_ALGO, mode, &ctx, error_r))
+		return -1;
+
+	/* the caller's key material can be of any length - derive the
+	   fixed-size cipher key from it */
+	sha256_get_digest(index->set.crypt_key, index->set.crypt_key_size, key);
+	dcrypt_ctx_sym_set_key(ctx, key, sizeof(key));
+	safe_memset(key, 0, sizeof(key));
+	dcrypt_ctx_sym_set_iv(ctx, iv, MAIL_INDEX_CRYPT_IV_SIZE);
+	*ctx_r = ctx;
+	return 0;
+}
+
+int mail_index_crypt_encrypt_image(struct mail_index *index,
+				   const buffer_t *image, buffer_t *dest,
+				   const char **error_r)
+{
+	struct dcrypt_context_symmetric *ctx;
+	struct mail_index_crypt_header hdr;
+	buffer_t *tag;
+	size_t hdr_offset;
+
+	i_zero(&hdr);
+	memcpy(hdr.magic, mail_index_crypt_magic, sizeof(hdr.magic));
+	hdr.version = MAIL_INDEX_CRYPT_VERSION;
+	random_fill(hdr.iv, sizeof(hdr.iv));
+
+	if (mail_index_crypt_ctx_create(index, DCRYPT_MODE_ENCRYPT, hdr.iv,
+					&ctx, error_r) < 0)
+		return -1;
+
+	/* the tag isn't known until the encryption has finished - write the
+	   header now and patch the tag into it afterwards */
+	hdr_offset = dest->used;
+	buffer_append(dest, &hdr, sizeof(hdr));
+	if (!dcrypt_ctx_sym_init(ctx, error_r) ||
+	    !dcrypt_ctx_sym_update(ctx, image->data, image->used,
+				   dest, error_r) ||
+	    !dcrypt_ctx_sym_final(ctx, dest, error_r)) {
+		dcrypt_ctx_sym_destroy(&ctx);
+		return -1;
+	}
+	tag = t_buffer_create(MAIL_INDEX_CRYPT_TAG_SIZE);
+	if (!dcrypt_ctx_sym_get_tag(ctx, tag) ||
+	    tag->used != MAIL_INDEX_CRYPT_TAG_SIZE) {
+		*error_r = "Getting AEAD tag failed";
+		dcrypt_ctx_sym_destroy(&ctx);
+		return -1;
+	}
+	buffer_write(dest, hdr_offset +
+		     offsetof(struct mail_index_crypt_header, tag),
+		     tag->data, tag->used);
+	dcrypt_ctx_sym_destroy(&ctx);
+	return 0;
+}
+
+int mail_index_crypt_read_file(struct mail_index *index, uoff_t file_size,
+			       buffer_t *dest, bool *retry_r, bool try_retry)
+{
+	struct mail_index_crypt_header hdr;
+	struct dcrypt_context_symmetric *ctx;
+	buffer_t *crypted;
+	const char *error;
+	void *data;
+	size_t data_size;
+	int ret;
+
+	*retry_r = FALSE;
+	i_assert(index->set.crypt_key != NULL);
+
+	if (file_size < sizeof(hdr)) {
+		mail_index_set_error(index, "Corrupted index file %s: "
+				     "File too small (%"PRIuUOFF_T")",
+				     index->filepath, file_size);
+		return 0;
+	}
+	if (file_size > SSIZE_T_MAX) {
+		mail_index_set_error(index, "Index file too large: %s",
+				     index->filepath);
+		return 0;
+	}
+
+	data_size = file_size - sizeof(hdr);
+	crypted = buffer_create_dynamic(default_pool, data_size);
+	data = buffer_append_space_unsafe(crypted, data_size);
+
+	ret = pread_full(index->fd, &hdr, sizeof(hdr), 0);
+	if (ret > 0)
+		ret = pread_full(index->fd, data, data_size, sizeof(hdr));
+	if (ret < 0) {
+		buffer_free(&crypted);
+		if (errno == ESTALE && try_retry) {
+			/* a new index file was renamed over this one. */
+			*retry_r = TRUE;
+			return 0;
+		}
+		mail_index_set_syscall_error(index, "pread_full()");
+		return -1;
+	}
+	if (ret == 0) {
+		buffer_free(&crypted);
+		mail_index_set_error(index,
+			"Corrupted index file %s: File too small",
+			index->filepath);
+		return 0;
+	}
+
+	if (!mail_index_crypt_header_detected(hdr.magic, sizeof(hdr.magic)) ||
+	    hdr.version != MAIL_INDEX_CRYPT_VERSION) {
+		/* the file was replaced after the caller detected the magic,
+		   or the header version is from a future Dovecot - handle it
+		   silently like a major version change */
+		buffer_free(&crypted);
+		return 0;
+	}
+
+	if (mail_index_crypt_ctx_create(index, DCRYPT_MODE_DECRYPT, hdr.iv,
+					&ctx, &error) < 0) {
+		mail_index_set_error(index,
+			"Decrypting index file %s failed: %s",
+			index->filepath, error);
+		buffer_free(&crypted);
+		return -1;
+	}
+	dcrypt_ctx_sym_set_tag(ctx, hdr.tag, sizeof(hdr.tag));
+	if (!dcrypt_ctx_sym_init(ctx, &error) ||
+	    !dcrypt_ctx_sym_update(ctx, crypted->data, crypted->used,
+				   dest, &error) ||
+	    !dcrypt_ctx_sym_final(ctx, dest, &error)) {
+		/* wrong key, or the ciphertext failed the tag check. Treat it
+		   like any other index corruption and rebuild from the
+		   transaction log. */
+		mail_index_set_error(index, "Corrupted index file %s: "
+				     "Decryption failed: %s",
+				     index->filepath, error);
+		dcrypt_ctx_sym_destroy(&ctx);
+		buffer_free(&crypted);
+		return 0;
+	}
+	dcrypt_ctx_sym_destroy(&ctx);
+	buffer_free(&crypted);
+	return 1;
+}
@@ -327,7 +327,7 @@ static void
 mail_index_fsck_records(struct mail_index *index, struct mail_index_map *map,
 			struct mail_index_header *hdr)
 {
-	struct mail_index_record *rec, *next_rec;
+	struct mail_index_record *rec, *dest_rec;
 	uint32_t i, last_uid;
 	bool logged_unordered_uids = FALSE, logged_zero_uids = FALSE;
 	bool records_dropped = FALSE;
@@ -339,11 +339,13 @@ mail_index_fsck_records(struct mail_index *index, struct mail_index_map *map,
 	hdr->first_unseen_uid_lowwater = 0;
 	hdr->first_deleted_uid_lowwater = 0;
 
-	rec = map->rec_map->records; last_uid = 0;
-	for (i = 0; i < map->rec_map->records_count; ) {
-		next_rec = PTR_OFFSET(rec, hdr->record_size);
+	rec = dest_rec = map->rec_map->records; last_uid = 0;
+	for (i = 0; i < map->rec_map->records_count; i++) {
 		if (rec->uid <= last_uid) {
-			/* log an error once, and skip this record */
+			/* log an error once, and skip this record. the
+			   following records are compacted over it, so a
+			   heavily corrupted index is still fsck'd with a
+			   single pass over the records. */
 			if (rec->uid == 0) {
 				if (!logged_zero_uids) {
 					mail_index_fsck_error(index,
@@ -357,16 +359,14 @@ mail_index_fsck_records(struct mail_index *index, struct mail_index_map *map,
 					logged_unordered_uids = TRUE;
 				}
 			}
-			/* not the fastest way when we're skipping lots of
-			   records, but this should happen rarely so don't
-			   bother optimizing. */
-			memmove(rec, next_rec, hdr->record_size *
-				(map->rec_map->records_count - i - 1));
-			map->rec_map->records_count--;
 			records_dropped = TRUE;
+			rec = PTR_OFFSET(rec, hdr->record_size);
 			continue;
 		}
 
+		if (records_dropped)
+			memcpy(dest_rec, rec, hdr->record_size);
+
 		hdr->messages_count++;
 		if ((rec->flags & MAIL_SEEN) != 0)
 			hdr->seen_messages_count++;
@@ -381,11 +381,12 @@ mail_index_fsck_records(struct mail_index *index, struct mail_index_map *map,
 			hdr->first_deleted_uid_lowwater = rec->uid;
 
 		last_uid = rec->uid;
-		rec = next_rec;
-		i++;
+		rec = PTR_OFFSET(rec, hdr->record_size);
+		dest_rec = PTR_OFFSET(dest_rec, hdr->record_size);
 	}
 
 	if (records_dropped) {
+		map->rec_map->records_count = hdr->messages_count;
 		/* all existing views are broken now */
 		index->inconsistency_id++;
 	}
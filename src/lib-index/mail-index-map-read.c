@@ -129,6 +129,84 @@ static int mail_index_read_header(struct mail_index *index,
 	return ret;
 }
 
+static int
+mail_index_crypt_map(struct mail_index_map *map, uoff_t file_size,
+		     bool *retry_r, bool try_retry)
+{
+	struct mail_index *index = map->index;
+	const struct mail_index_header *hdr;
+	const char *error;
+	buffer_t *image;
+	size_t records_size;
+	unsigned int records_count;
+	int ret;
+
+	image = buffer_create_dynamic(default_pool, IO_BLOCK_SIZE);
+	ret = mail_index_crypt_read_file(index, file_size, image,
+					 retry_r, try_retry);
+	if (ret <= 0) {
+		buffer_free(&image);
+		return ret;
+	}
+
+	hdr = image->data;
+	if (image->used >
+	    offsetof(struct mail_index_header, major_version) &&
+	    hdr->major_version != MAIL_INDEX_MAJOR_VERSION) {
+		/* major version change - handle silently */
+		buffer_free(&image);
+		return 0;
+	}
+	if (image->used < MAIL_INDEX_HEADER_MIN_SIZE) {
+		mail_index_set_error(index, "Corrupted index file %s: "
+				     "File too small (%zu)",
+				     index->filepath, image->used);
+		buffer_free(&image);
+		return 0;
+	}
+	if (!mail_index_check_header_compat(index, hdr, image->used, &error)) {
+		/* Can't use this file */
+		mail_index_set_error(index, "Corrupted index file %s: %s",
+				     index->filepath, error);
+		buffer_free(&image);
+		return 0;
+	}
+
+	records_size = (size_t)hdr->messages_count * hdr->record_size;
+	records_count = hdr->messages_count;
+	if (image->used - hdr->header_size < records_size ||
+	    (hdr->record_size != 0 &&
+	     records_size / hdr->record_size != hdr->messages_count)) {
+		records_count = (image->used - hdr->header_size) /
+			hdr->record_size;
+		records_size = (size_t)records_count * hdr->record_size;
+		mail_index_set_error(index, "Corrupted index file %s: "
+			"messages_count too large (%u > %u)",
+			index->filepath, hdr->messages_count, records_count);
+	}
+
+	buffer_set_used_size(map->hdr_copy_buf, 0);
+	buffer_append(map->hdr_copy_buf, image->data, hdr->header_size);
+
+	if (map->rec_map->buffer == NULL) {
+		map->rec_map->buffer =
+			buffer_create_dynamic(default_pool, records_size);
+	}
+	buffer_set_used_size(map->rec_map->buffer, 0);
+	buffer_append(map->rec_map->buffer,
+		      CONST_PTR_OFFSET(image->data, hdr->header_size),
+		      records_size);
+
+	map->rec_map->records =
+		buffer_get_modifiable_data(map->rec_map->buffer, NULL);
+	map->rec_map->records_count = records_count;
+
+	mail_index_map_copy_hdr(map, hdr);
+	i_assert(map->hdr_copy_buf->used == map->hdr.header_size);
+	buffer_free(&image);
+	return 1;
+}
+
 static int
 mail_index_try_read_map(struct mail_index_map *map,
 			uoff_t file_size, bool *retry_r, bool try_retry)
@@ -149,6 +227,16 @@ mail_index_try_read_map(struct mail_index_map *map,
 	ret = mail_index_read_header(index, read_buf, sizeof(read_buf), &pos);
 	buf = read_buf; hdr = buf;
 
+	if (mail_index_crypt_header_detected(buf, pos)) {
+		if (index->set.crypt_key == NULL) {
+			/* encrypted index, but we have no key - handle like a
+			   major version change and rebuild from the log */
+			return 0;
+		}
+		return mail_index_crypt_map(map, file_size,
+					    retry_r, try_retry);
+	}
+
 	if (pos > (ssize_t)offsetof(struct mail_index_header, major_version) &&
 	    hdr->major_version != MAIL_INDEX_MAJOR_VERSION) {
 		/* major version change - handle silently */
@@ -335,8 +423,11 @@ mail_index_map_latest_file(struct mail_index *index, const char **reason_r)
 	}
 
 	/* mmaping seems to be slower than just reading the file, so even if
-	   mmap isn't disabled don't use it unless the file is large enough */
+	   mmap isn't disabled don't use it unless the file is large enough.
+	   An encrypted index can't be mmaped, since the file contents don't
+	   match the decrypted in-memory image. */
 	use_mmap = (index->flags & MAIL_INDEX_OPEN_FLAG_MMAP_DISABLE) == 0 &&
+		index->set.crypt_key == NULL &&
 		file_size != UOFF_T_MAX && file_size > MAIL_INDEX_MMAP_MIN_SIZE;
 
 	new_map = mail_index_map_alloc(index);
@@ -13,8 +13,13 @@ struct mail_transaction_header;
 struct mail_transaction_log_view;
 struct mail_index_sync_map_ctx;
 
-/* How large index files to mmap() instead of reading to memory. */
-#define MAIL_INDEX_MMAP_MIN_SIZE (1024*64)
+/* How large index files to mmap() instead of reading to memory. Reading is
+   slightly faster for very small files, but mmap()ed pages stay clean until
+   the map is modified (syncing moves it to memory first), so the kernel
+   shares them between all processes that have the same index open. Prefer
+   that for anything larger than a page, since with one process per
+   connection the same user's indexes are typically open several times. */
+#define MAIL_INDEX_MMAP_MIN_SIZE 4096
 /* How many times to retry opening index files if read/fstat returns ESTALE.
    This happens with NFS when the file has been deleted (ie. index file was
    rewritten by another computer than us). */
@@ -190,6 +195,11 @@ struct mail_index_settings {
 	   mail_index_set_ext_init_data(). */
 	uint32_t ext_hdr_init_id;
 	void *ext_hdr_init_data;
+
+	/* Key material for encrypting the main index file. Set via
+	   mail_index_set_crypt_key(). */
+	unsigned char *crypt_key;
+	size_t crypt_key_size;
 };
 
 struct mail_index_error {
@@ -250,6 +260,16 @@ struct mail_index {
 	uint32_t fsck_log_head_file_seq;
 	uoff_t fsck_log_head_file_offset;
 
+	/* Cached result of the last view sync's expunge collection. When
+	   multiple views sync over exactly the same log range (e.g. after a
+	   mass expunge), they reuse this UID range list instead of each
+	   rescanning the transaction log. */
+	ARRAY_TYPE(seq_range) view_sync_expunge_cache;
+	uint32_t view_sync_expunge_cache_start_seq;
+	uint32_t view_sync_expunge_cache_end_seq;
+	uoff_t view_sync_expunge_cache_start_offset;
+	uoff_t view_sync_expunge_cache_end_offset;
+
 	/* syncing will update this if non-NULL */
 	struct mail_index_transaction_commit_result *sync_commit_result;
 	/* Delayed log2_rotate_time update to mail_index_header. This is set
@@ -419,6 +439,21 @@ unsigned int mail_index_map_ext_hdr_offset(unsigned int name_len);
 
 void mail_index_fsck_locked(struct mail_index *index);
 
+/* Returns TRUE if the data begins with the plaintext header of an encrypted
+   main index file. */
+bool mail_index_crypt_header_detected(const void *data, size_t size);
+/* Encrypt a full main index image into dest, prefixed by the plaintext
+   encryption header. Returns 0 if ok, -1 if error. */
+int mail_index_crypt_encrypt_image(struct mail_index *index,
+				   const buffer_t *image, buffer_t *dest,
+				   const char **error_r);
+/* Read and decrypt an encrypted main index file into dest, which is then a
+   normal index image. Returns 1 if ok, 0 if the file is unusable (rebuild
+   from the transaction log), -1 if error. ESTALE is handled the same way as
+   in mail_index_try_read_map(). */
+int mail_index_crypt_read_file(struct mail_index *index, uoff_t file_size,
+			       buffer_t *dest, bool *retry_r, bool try_retry);
+
 /* Log an error and set it as the index's current error that is available
    with mail_index_get_error_message(). */
 void mail_index_set_error(struct mail_index *index, const char *fmt, ...)
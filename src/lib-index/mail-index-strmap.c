@@ -490,7 +490,8 @@ mail_index_strmap_read_rec_next(struct mail_index_strmap_read_context *ctx,
 
 static int
 strmap_read_block_init(struct mail_index_strmap_view *view,
-		       struct mail_index_strmap_read_context *ctx)
+		       struct mail_index_strmap_read_context *ctx,
+		       uint32_t prev_uid_lookup_seq)
 {
 	struct mail_index_strmap *strmap = view->strmap;
 	const unsigned char *data;
@@ -533,12 +534,18 @@ strmap_read_block_init(struct mail_index_strmap_view *view,
 	}
 	ctx->rec.uid = view->last_read_uid + 1;
 
-	/* FIXME: when reading multiple blocks we shouldn't have to calculate
-	   this every time */
-	if (!mail_index_lookup_seq_range(view->view, ctx->rec.uid, (uint32_t)-1,
-					 &seq1, &seq2))
-		seq1 = mail_index_view_get_messages_count(view->view) + 1;
-	ctx->uid_lookup_seq = seq1;
+	if (prev_uid_lookup_seq != 0) {
+		/* we just finished reading the previous block with this same
+		   view. UIDs are ascending across blocks, so we can continue
+		   from where the previous block's UID lookups left off
+		   instead of binary searching the position again. */
+		ctx->uid_lookup_seq = prev_uid_lookup_seq;
+	} else {
+		if (!mail_index_lookup_seq_range(view->view, ctx->rec.uid,
+						 (uint32_t)-1, &seq1, &seq2))
+			seq1 = mail_index_view_get_messages_count(view->view) + 1;
+		ctx->uid_lookup_seq = seq1;
+	}
 	return 1;
 }
 
@@ -705,6 +712,7 @@ mail_index_strmap_view_sync_init(struct mail_index_strmap_view *view,
 {
 	struct mail_index_strmap_view_sync *sync;
 	struct mail_index_strmap_read_context ctx;
+	uint32_t uid_lookup_seq = 0;
 	int ret;
 
 	sync = i_new(struct mail_index_strmap_view_sync, 1);
@@ -716,11 +724,13 @@ mail_index_strmap_view_sync_init(struct mail_index_strmap_view *view,
 	} else if (view->strmap->input != NULL) {
 		i_stream_seek(view->strmap->input,
 			      view->last_read_block_offset);
-		while ((ret = strmap_read_block_init(view, &ctx)) > 0) {
+		while ((ret = strmap_read_block_init(view, &ctx,
+						     uid_lookup_seq)) > 0) {
 			if (mail_index_strmap_view_sync_block(&ctx) < 0) {
 				ret = -1;
 				break;
 			}
+			uid_lookup_seq = ctx.uid_lookup_seq;
 			if (ctx.too_large_uids)
 				break;
 		}
@@ -1092,7 +1102,7 @@ mail_index_strmap_write_append(struct mail_index_strmap_view *view)
 	const struct mail_index_strmap_rec *old_recs;
 	unsigned int i, old_count;
 	struct ostream *output;
-	uint32_t crc32, next_uid;
+	uint32_t crc32, next_uid, uid_lookup_seq = 0;
 	bool full_block;
 	int ret;
 
@@ -1130,7 +1140,7 @@ mail_index_strmap_write_append(struct mail_index_strmap_view *view)
 	i_stream_seek(view->strmap->input, view->last_read_block_offset);
 	full_block = TRUE; ret = 0;
 	while (i < old_count &&
-	       (ret = strmap_read_block_init(view, &ctx)) > 0) {
+	       (ret = strmap_read_block_init(view, &ctx, uid_lookup_seq)) > 0) {
 		while ((ret = strmap_read_block_next(&ctx, &crc32)) > 0) {
 			if (ctx.rec.uid != old_recs[i].uid ||
 			    ctx.rec.str_idx != old_recs[i].str_idx) {
@@ -1157,6 +1167,7 @@ mail_index_strmap_write_append(struct mail_index_strmap_view *view)
 			ret = -1;
 			break;
 		}
+		uid_lookup_seq = ctx.uid_lookup_seq;
 	}
 	if (ret < 0)
 		return -1;
@@ -242,20 +242,30 @@ sync_ext_resize(const struct mail_transaction_ext_intro *u,
 	struct mail_index_ext *ext;
 	struct mail_index_ext_header *ext_hdr;
 	uint32_t old_padded_hdr_size, new_padded_hdr_size, old_record_size;
+	bool record_growing, record_shrinking, hdr_growing, hdr_shrinking;
 	bool reorder = FALSE;
 
 	ext = array_idx_modifiable(&ctx->view->map->extensions, ext_map_idx);
 	old_padded_hdr_size = MAIL_INDEX_HEADER_SIZE_ALIGN(ext->hdr_size);
 	new_padded_hdr_size = MAIL_INDEX_HEADER_SIZE_ALIGN(u->hdr_size);
 
-	if (ext->record_align != u->record_align ||
-	    ext->record_size != u->record_size) {
-		/* record changed */
-	} else if (new_padded_hdr_size < old_padded_hdr_size) {
-		/* header is shrunk. do we allow? */
-		if (no_shrink)
-			return;
-	} else if (ext->hdr_size == u->hdr_size) {
+	/* Check if the intro changes anything in this map at all before
+	   cloning the map below, which copies all the records. Processes that
+	   never look up the extension still see its re-intros while syncing
+	   (e.g. POP3 sessions seeing cache extension intros), and those are
+	   commonly no-ops. */
+	record_growing = ext->record_align < u->record_align ||
+		ext->record_size < u->record_size;
+	record_shrinking = !no_shrink &&
+		(ext->record_align > u->record_align ||
+		 ext->record_size > u->record_size);
+	hdr_growing = new_padded_hdr_size > old_padded_hdr_size;
+	hdr_shrinking = new_padded_hdr_size < old_padded_hdr_size &&
+		!no_shrink;
+	if (!record_growing && !record_shrinking &&
+	    !hdr_growing && !hdr_shrinking &&
+	    (ext->hdr_size == u->hdr_size ||
+	     (new_padded_hdr_size < old_padded_hdr_size && no_shrink))) {
 		/* no changes */
 		return;
 	}
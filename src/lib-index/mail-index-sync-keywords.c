@@ -205,9 +205,8 @@ keywords_update_records(struct mail_index_sync_map_ctx *ctx,
 			uint32_t uid1, uint32_t uid2)
 {
 	struct mail_index_view *view = ctx->view;
-	struct mail_index_record *rec;
 	unsigned char *data, data_mask;
-	unsigned int data_offset;
+	unsigned int data_offset, record_size;
 	uint32_t seq1, seq2;
 
 	i_assert(keyword_idx != UINT_MAX);
@@ -226,20 +225,24 @@ keywords_update_records(struct mail_index_sync_map_ctx *ctx,
 
 	i_assert(data_offset >= MAIL_INDEX_RECORD_MIN_SIZE);
 
+	/* mass updates are common (e.g. STORE 1:* +FLAGS $label), so walk
+	   the records with a strided pointer instead of recalculating the
+	   record position for every sequence. */
+	record_size = view->map->hdr.record_size;
+	data = PTR_OFFSET(MAIL_INDEX_REC_AT_SEQ(view->map, seq1), data_offset);
+
 	switch (type) {
 	case MODIFY_ADD:
 		for (; seq1 <= seq2; seq1++) {
-			rec = MAIL_INDEX_REC_AT_SEQ(view->map, seq1);
-			data = PTR_OFFSET(rec, data_offset);
 			*data |= data_mask;
+			data = PTR_OFFSET(data, record_size);
 		}
 		break;
 	case MODIFY_REMOVE:
 		data_mask = (unsigned char)~data_mask;
 		for (; seq1 <= seq2; seq1++) {
-			rec = MAIL_INDEX_REC_AT_SEQ(view->map, seq1);
-			data = PTR_OFFSET(rec, data_offset);
 			*data &= data_mask;
+			data = PTR_OFFSET(data, record_size);
 		}
 		break;
 	default:
@@ -318,9 +321,9 @@ mail_index_sync_keywords_reset(struct mail_index_sync_map_ctx *ctx,
 			       const struct mail_transaction_keyword_reset *r)
 {
 	struct mail_index_map *map = ctx->view->map;
-	struct mail_index_record *rec;
 	const struct mail_index_ext *ext;
 	const struct mail_transaction_keyword_reset *end;
+	unsigned char *data;
 	uint32_t ext_map_idx, seq1, seq2;
 
 	if (!mail_index_map_lookup_ext(map, MAIL_INDEX_EXT_KEYWORDS,
@@ -337,10 +340,11 @@ mail_index_sync_keywords_reset(struct mail_index_sync_map_ctx *ctx,
 			continue;
 
 		mail_index_modseq_reset_keywords(ctx->modseq_ctx, seq1, seq2);
+		data = PTR_OFFSET(MAIL_INDEX_REC_AT_SEQ(map, seq1),
+				  ext->record_offset);
 		for (; seq1 <= seq2; seq1++) {
-			rec = MAIL_INDEX_REC_AT_SEQ(map, seq1);
-			memset(PTR_OFFSET(rec, ext->record_offset),
-			       0, ext->record_size);
+			memset(data, 0, ext->record_size);
+			data = PTR_OFFSET(data, map->hdr.record_size);
 		}
 	}
 	return 1;
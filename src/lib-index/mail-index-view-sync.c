@@ -171,10 +171,31 @@ view_sync_get_expunges(struct mail_index_view_sync_ctx *ctx,
 		       unsigned int *expunge_count_r)
 {
 	struct mail_index_view *view = ctx->view;
+	struct mail_index *index = view->index;
 	const struct mail_transaction_header *hdr;
 	const void *data;
+	uint32_t start_seq, end_seq;
+	uoff_t start_offset, end_offset;
 	int ret;
 
+	mail_transaction_log_view_get_prev_pos(view->log_view,
+					       &start_seq, &start_offset);
+	end_seq = index->map->hdr.log_file_seq;
+	end_offset = index->map->hdr.log_file_head_offset;
+
+	if (array_is_created(&index->view_sync_expunge_cache) &&
+	    index->view_sync_expunge_cache_start_seq == start_seq &&
+	    index->view_sync_expunge_cache_start_offset == start_offset &&
+	    index->view_sync_expunge_cache_end_seq == end_seq &&
+	    index->view_sync_expunge_cache_end_offset == end_offset) {
+		/* another view of this index already collected the expunges
+		   for this same log range - reuse them. */
+		array_append_array(&ctx->expunges,
+				   &index->view_sync_expunge_cache);
+		*expunge_count_r = view_sync_expunges2seqs(ctx);
+		return 0;
+	}
+
 	/* get a list of expunge transactions. there may be some that we have
 	   already synced, but it doesn't matter because they'll get dropped
 	   out when converting to sequences. the uid ranges' validity has
@@ -196,6 +217,21 @@ view_sync_get_expunges(struct mail_index_view_sync_ctx *ctx,
 	}
 	mail_transaction_log_view_rewind(view->log_view);
 
+	if (ret == 0) {
+		/* remember the result while it's still in UIDs, so other
+		   views syncing the same range don't rescan the log. */
+		if (!array_is_created(&index->view_sync_expunge_cache))
+			i_array_init(&index->view_sync_expunge_cache, 64);
+		else
+			array_clear(&index->view_sync_expunge_cache);
+		array_append_array(&index->view_sync_expunge_cache,
+				   &ctx->expunges);
+		index->view_sync_expunge_cache_start_seq = start_seq;
+		index->view_sync_expunge_cache_start_offset = start_offset;
+		index->view_sync_expunge_cache_end_seq = end_seq;
+		index->view_sync_expunge_cache_end_offset = end_offset;
+	}
+
 	*expunge_count_r = view_sync_expunges2seqs(ctx);
 	return ret;
 }
@@ -81,12 +81,39 @@ static int mail_index_recreate(struct mail_index *index)
 	hdr.log_file_tail_offset = hdr.log_file_head_offset;
 
 	base_size = I_MIN(hdr.base_header_size, sizeof(hdr));
-	o_stream_nsend(output, &hdr, base_size);
-	o_stream_nsend(output, MAIL_INDEX_MAP_HDR_OFFSET(map, base_size),
-		       hdr.header_size - base_size);
-	o_stream_nsend(output, map->rec_map->records,
-		       map->rec_map->records_count * hdr.record_size);
-	if (o_stream_finish(output) < 0) {
+	if (index->set.crypt_key == NULL) {
+		o_stream_nsend(output, &hdr, base_size);
+		o_stream_nsend(output, MAIL_INDEX_MAP_HDR_OFFSET(map, base_size),
+			       hdr.header_size - base_size);
+		o_stream_nsend(output, map->rec_map->records,
+			       map->rec_map->records_count * hdr.record_size);
+	} else T_BEGIN {
+		/* build the index image in memory and write it encrypted */
+		buffer_t *image, *crypted;
+		const char *error;
+
+		image = buffer_create_dynamic(default_pool,
+			hdr.header_size +
+			map->rec_map->records_count * hdr.record_size);
+		buffer_append(image, &hdr, base_size);
+		buffer_append(image, MAIL_INDEX_MAP_HDR_OFFSET(map, base_size),
+			      hdr.header_size - base_size);
+		buffer_append(image, map->rec_map->records,
+			      map->rec_map->records_count * hdr.record_size);
+		crypted = buffer_create_dynamic(default_pool, image->used);
+		if (mail_index_crypt_encrypt_image(index, image, crypted,
+						   &error) < 0) {
+			mail_index_set_error(index,
+				"Encrypting index file %s failed: %s",
+				index->filepath, error);
+			ret = -1;
+		} else {
+			o_stream_nsend(output, crypted->data, crypted->used);
+		}
+		buffer_free(&image);
+		buffer_free(&crypted);
+	} T_END;
+	if (o_stream_finish(output) < 0 && ret == 0) {
 		mail_index_file_set_syscall_error(index, path, "write()");
 		ret = -1;
 	}
@@ -164,6 +191,10 @@ void mail_index_write(struct mail_index *index, bool want_rotate,
 	if (index->readonly)
 		return;
 
+	/* the main index points to the log offsets, so make sure any delayed
+	   log fdatasync() is finished before the index is written */
+	mail_transaction_log_file_flush_fsync(index->log->head);
+
 	/* rotate the .log before writing index, so the index will point to
 	   the latest log. Note that it's the caller's responsibility to make
 	   sure that the .log can be safely rotated (i.e. everything has been
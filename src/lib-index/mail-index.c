@@ -9,6 +9,7 @@
 #include "str-sanitize.h"
 #include "mmap-util.h"
 #include "nfs-workarounds.h"
+#include "safe-memset.h"
 #include "read-full.h"
 #include "write-full.h"
 #include "mail-index-alloc-cache.h"
@@ -107,8 +108,14 @@ void mail_index_free(struct mail_index **_index)
 
 	array_free(&index->keywords);
 	array_free(&index->module_contexts);
+	if (array_is_created(&index->view_sync_expunge_cache))
+		array_free(&index->view_sync_expunge_cache);
 
 	event_unref(&index->event);
+	if (index->set.crypt_key != NULL) {
+		safe_memset(index->set.crypt_key, 0, index->set.crypt_key_size);
+		i_free(index->set.crypt_key);
+	}
 	i_free(index->set.cache_dir);
 	i_free(index->set.ext_hdr_init_data);
 	i_free(index->set.gid_origin);
@@ -125,6 +132,21 @@ void mail_index_set_cache_dir(struct mail_index *index, const char *dir)
 	index->set.cache_dir = i_strdup(dir);
 }
 
+void mail_index_set_crypt_key(struct mail_index *index,
+			      const unsigned char *key, size_t key_size)
+{
+	if (index->set.crypt_key != NULL) {
+		safe_memset(index->set.crypt_key, 0, index->set.crypt_key_size);
+		i_free(index->set.crypt_key);
+		index->set.crypt_key_size = 0;
+	}
+	if (key != NULL) {
+		index->set.crypt_key = i_malloc(key_size);
+		memcpy(index->set.crypt_key, key, key_size);
+		index->set.crypt_key_size = key_size;
+	}
+}
+
 void mail_index_set_fsync_mode(struct mail_index *index,
 			       enum fsync_mode mode,
 			       enum mail_index_fsync_mask mask)
@@ -393,6 +393,15 @@ void mail_index_set_optimization_settings(struct mail_index *index,
    extension header data immediately to it. */
 void mail_index_set_ext_init_data(struct mail_index *index, uint32_t ext_id,
 				  const void *data, size_t size);
+/* Encrypt the main index file (dovecot.index) with the given key material.
+   Must be called before mail_index_open(). The key can be of any length -
+   the cipher key is derived from it. An existing plaintext index is still
+   read normally and becomes encrypted when it's next rewritten. If the file
+   is encrypted but the key is missing or wrong, the index is rebuilt from
+   the transaction log. The transaction log and cache file stay plaintext.
+   NULL clears a previously set key. */
+void mail_index_set_crypt_key(struct mail_index *index,
+			      const unsigned char *key, size_t key_size);
 
 /* Open index. Returns 1 if ok, 0 if index doesn't exist and CREATE flags
    wasn't given, -1 if error. */
@@ -87,11 +87,21 @@ static int log_buffer_write(struct mail_transaction_log_append_ctx *ctx)
 	if ((ctx->want_fsync &&
 	     file->log->index->set.fsync_mode != FSYNC_MODE_NEVER) ||
 	    file->log->index->set.fsync_mode == FSYNC_MODE_ALWAYS) {
-		if (fdatasync(file->fd) < 0) {
+		if (ctx->log->index->log_sync_locked) {
+			/* Group commit: the caller keeps the log sync locked
+			   over multiple transaction appends (e.g. mailbox
+			   syncing writing the sync transaction, cache updates
+			   and the tail offset). Delay the fdatasync() until
+			   the sync lock is released, so the whole batch gets
+			   flushed to disk with a single fdatasync(). */
+			file->fsync_pending = TRUE;
+		} else if (fdatasync(file->fd) < 0) {
 			mail_index_file_set_syscall_error(ctx->log->index,
 							  file->filepath,
 							  "fdatasync()");
 			return log_buffer_move_to_memory(ctx);
+		} else {
+			file->fsync_pending = FALSE;
 		}
 	}
 
@@ -434,6 +434,19 @@ void mail_transaction_log_file_unlock(struct mail_transaction_log_file *file,
 	file_unlock(&file->file_lock);
 }
 
+void mail_transaction_log_file_flush_fsync(struct mail_transaction_log_file *file)
+{
+	if (!file->fsync_pending)
+		return;
+	file->fsync_pending = FALSE;
+
+	if (MAIL_TRANSACTION_LOG_FILE_IN_MEMORY(file))
+		return;
+
+	if (fdatasync(file->fd) < 0)
+		log_file_set_syscall_error(file, "fdatasync()");
+}
+
 static ssize_t
 mail_transaction_log_file_read_header(struct mail_transaction_log_file *file)
 {
@@ -5,6 +5,25 @@
 #include "mail-index-modseq.h"
 #include "mail-transaction-log-private.h"
 
+/* While scanning a long range of the log, add a sparse checkpoint to the
+   cache every this many bytes. The checkpoints bound the cost of later
+   lookups for nearby modseqs (e.g. different QRESYNC clients resyncing
+   against different old modseqs), which would otherwise have to restart
+   their scan from the beginning of the file. */
+#define MODSEQ_CACHE_CHECKPOINT_INTERVAL (32*1024)
+
+static void
+modseq_cache_insert(struct mail_transaction_log_file *file,
+		    uoff_t offset, uint64_t highest_modseq)
+{
+	/* @UNSAFE */
+	memmove(file->modseq_cache + 1, file->modseq_cache,
+		sizeof(*file->modseq_cache) *
+		(N_ELEMENTS(file->modseq_cache) - 1));
+	file->modseq_cache[0].offset = offset;
+	file->modseq_cache[0].highest_modseq = highest_modseq;
+}
+
 static struct modseq_cache *
 modseq_cache_hit(struct mail_transaction_log_file *file, unsigned int idx)
 {
@@ -109,7 +128,7 @@ int mail_transaction_log_file_get_highest_modseq_at(
 {
 	const struct mail_transaction_header *hdr;
 	struct modseq_cache *cache;
-	uoff_t cur_offset;
+	uoff_t cur_offset, checkpoint_offset;
 	uint64_t cur_modseq;
 	const char *reason;
 	int ret;
@@ -160,19 +179,20 @@ int mail_transaction_log_file_get_highest_modseq_at(
 
 	i_assert(cur_offset >= file->buffer_offset);
 	i_assert(cur_offset + file->buffer->used >= offset);
+	checkpoint_offset = cur_offset;
 	while (cur_offset < offset) {
 		if (log_get_synced_record(file, &cur_offset, &hdr, error_r) < 0)
 			return 0;
 		mail_transaction_update_modseq(hdr, hdr + 1, &cur_modseq,
 			MAIL_TRANSACTION_LOG_HDR_VERSION(&file->hdr));
+		if (cur_offset - checkpoint_offset >=
+		    MODSEQ_CACHE_CHECKPOINT_INTERVAL && cur_offset < offset) {
+			modseq_cache_insert(file, cur_offset, cur_modseq);
+			checkpoint_offset = cur_offset;
+		}
 	}
 
-	/* @UNSAFE: cache the value */
-	memmove(file->modseq_cache + 1, file->modseq_cache,
-		sizeof(*file->modseq_cache) *
-		(N_ELEMENTS(file->modseq_cache) - 1));
-	file->modseq_cache[0].offset = cur_offset;
-	file->modseq_cache[0].highest_modseq = cur_modseq;
+	modseq_cache_insert(file, cur_offset, cur_modseq);
 
 	*highest_modseq_r = cur_modseq;
 	return 1;
@@ -186,6 +206,7 @@ get_modseq_next_offset_at(struct mail_transaction_log_file *file,
 {
 	const struct mail_transaction_header *hdr;
 	const char *reason;
+	uoff_t checkpoint_offset;
 	int ret;
 
 	/* make sure we've read until end of file. this is especially important
@@ -207,6 +228,7 @@ get_modseq_next_offset_at(struct mail_transaction_log_file *file,
 	}
 
 	i_assert(*cur_offset >= file->buffer_offset);
+	checkpoint_offset = *cur_offset;
 	while (*cur_offset < file->sync_offset) {
 		if (log_get_synced_record(file, cur_offset, &hdr, &reason) < 0) {
 			mail_index_set_error(file->log->index,
@@ -217,6 +239,11 @@ get_modseq_next_offset_at(struct mail_transaction_log_file *file,
 			MAIL_TRANSACTION_LOG_HDR_VERSION(&file->hdr));
 		if (*cur_modseq >= modseq)
 			break;
+		if (*cur_offset - checkpoint_offset >=
+		    MODSEQ_CACHE_CHECKPOINT_INTERVAL) {
+			modseq_cache_insert(file, *cur_offset, *cur_modseq);
+			checkpoint_offset = *cur_offset;
+		}
 	}
 	return 1;
 }
@@ -286,12 +313,7 @@ int mail_transaction_log_file_get_modseq_next_offset(
 		memset(file->modseq_cache, 0, sizeof(file->modseq_cache));
 	}
 
-	/* @UNSAFE: cache the value */
-	memmove(file->modseq_cache + 1, file->modseq_cache,
-		sizeof(*file->modseq_cache) *
-		(N_ELEMENTS(file->modseq_cache) - 1));
-	file->modseq_cache[0].offset = cur_offset;
-	file->modseq_cache[0].highest_modseq = cur_modseq;
+	modseq_cache_insert(file, cur_offset, cur_modseq);
 
 	*next_offset_r = cur_offset;
 	return 0;
@@ -13,7 +13,7 @@ struct dotlock_settings;
 
 #define MAIL_TRANSACTION_LOG_FILE_IN_MEMORY(file) ((file)->fd == -1)
 
-#define LOG_FILE_MODSEQ_CACHE_SIZE 10
+#define LOG_FILE_MODSEQ_CACHE_SIZE 32
 
 struct modseq_cache {
 	uoff_t offset;
@@ -94,6 +94,12 @@ struct mail_transaction_log_file {
 
 	/* Log is currently locked. */
 	bool locked:1;
+	/* An fdatasync() is still needed for the written transactions. Set
+	   instead of fsyncing immediately when a transaction is appended
+	   while the caller holds the .log sync lock, so that all the
+	   transactions written within the same locked section get flushed
+	   with a single fdatasync() when the lock is released. */
+	bool fsync_pending:1;
 	/* TRUE if sync_offset has already been updated while this log was
 	   locked. This can be used to optimize away unnecessary checks to see
 	   whether there's more data written to log after sync_offset. */
@@ -182,6 +188,9 @@ int mail_transaction_log_lock_head(struct mail_transaction_log *log,
 				   const char *lock_reason);
 void mail_transaction_log_file_unlock(struct mail_transaction_log_file *file,
 				      const char *lock_reason);
+/* fdatasync() the log file if a transaction written within the current
+   sync-locked section still requires it. */
+void mail_transaction_log_file_flush_fsync(struct mail_transaction_log_file *file);
 
 void mail_transaction_update_modseq(const struct mail_transaction_header *hdr,
 				    const void *data, uint64_t *cur_modseq,
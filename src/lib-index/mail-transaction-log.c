@@ -333,6 +333,10 @@ int mail_transaction_log_rotate(struct mail_transaction_log *log, bool reset)
 	e_debug(log->index->event, "Rotated transaction log %s (seq=%u, reset=%s)",
 		file->filepath, file->hdr.file_seq, reset ? "yes" : "no");
 
+	/* make sure the old head is flushed to disk before abandoning it -
+	   the new log file's header already points to it */
+	mail_transaction_log_file_flush_fsync(old_head);
+
 	/* the newly created log file is already locked */
 	mail_transaction_log_file_unlock(old_head,
 		!log->index->log_sync_locked ? "rotating" :
@@ -609,6 +613,10 @@ void mail_transaction_log_sync_unlock(struct mail_transaction_log *log,
 {
 	i_assert(log->index->log_sync_locked);
 
+	/* flush transactions whose fdatasync() was delayed while we kept the
+	   log locked */
+	mail_transaction_log_file_flush_fsync(log->head);
+
 	log->index->log_sync_locked = FALSE;
 	mail_transaction_log_file_unlock(log->head, lock_reason);
 }
@@ -806,6 +806,32 @@ static void test_mail_cache_duplicate_fields(void)
 	test_end();
 }
 
+static void test_mail_cache_lookup_bench(void)
+{
+	struct test_mail_cache_ctx ctx;
+	struct mail_cache_view *cache_view;
+	string_t *str = t_str_new(16);
+
+	test_begin_bench("mail cache lookup bench");
+	test_mail_cache_init(test_mail_index_init(), &ctx);
+	test_mail_cache_add_mail(&ctx, ctx.cache_field.idx, "cached data");
+
+	cache_view = mail_cache_view_open(ctx.cache, ctx.view);
+	while (test_bench_loop()) {
+		str_truncate(str, 0);
+		if (mail_cache_lookup_field(cache_view, str, 1,
+					    ctx.cache_field.idx) <= 0)
+			i_unreached();
+	}
+	/* a committed lookup walks the record chain in the mapped cache
+	   file - the limit has plenty of headroom on top of that */
+	test_assert_faster_than(2000);
+	mail_cache_view_close(&cache_view);
+	test_mail_cache_deinit(&ctx);
+	test_mail_index_delete();
+	test_end();
+}
+
 int main(void)
 {
 	static void (*const test_functions[])(void) = {
@@ -820,6 +846,7 @@ int main(void)
 		test_mail_cache_in_memory,
 		test_mail_cache_size_corruption,
 		test_mail_cache_duplicate_fields,
+		test_mail_cache_lookup_bench,
 		NULL
 	};
 	return test_run(test_functions);
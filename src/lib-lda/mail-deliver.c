@@ -327,7 +327,13 @@ void mail_deliver_init(struct mail_deliver_context *ctx,
 	ctx->event = event_create(input->event_parent);
 	event_add_category(ctx->event, &event_category_mail_delivery);
 
-	mail_deliver_fields_update(&ctx->fields, ctx->pool, ctx->src_mail);
+	/* Parse the source mail's log fields only once per session. With
+	   multiple recipients the source mail may point to the first
+	   recipient's already saved mail, which would otherwise have to be
+	   read and parsed again for each of the remaining recipients. */
+	mail_deliver_fields_update(&ctx->session->src_mail_fields,
+				   ctx->pool, ctx->src_mail);
+	ctx->fields = ctx->session->src_mail_fields;
 	mail_deliver_update_event(ctx);
 
 	if (ctx->rcpt_to != NULL) {
@@ -26,11 +26,28 @@ enum mail_deliver_error {
 	MAIL_DELIVER_ERROR_INTERNAL,
 };
 
+struct mail_deliver_fields {
+	const char *message_id;
+	const char *subject;
+	const char *from;
+	const char *from_envelope;
+	const char *storage_id;
+
+	uoff_t psize, vsize;
+
+	bool filled:1;
+};
+
 struct mail_deliver_session {
 	pool_t pool;
 
 	/* List of INBOX GUIDs where this mail has already been saved to */
 	ARRAY(guid_128_t) inbox_guids;
+
+	/* Log fields of the source mail. They are parsed only once per
+	   session, even when the same mail is delivered to multiple
+	   recipients. */
+	struct mail_deliver_fields src_mail_fields;
 };
 
 struct mail_deliver_input {
@@ -65,18 +82,6 @@ struct mail_deliver_input {
 	bool save_dest_mail:1;
 };
 
-struct mail_deliver_fields {
-	const char *message_id;
-	const char *subject;
-	const char *from;
-	const char *from_envelope;
-	const char *storage_id;
-
-	uoff_t psize, vsize;
-
-	bool filled:1;
-};
-
 struct mail_deliver_context {
 	pool_t pool;
 	const struct lda_settings *set;
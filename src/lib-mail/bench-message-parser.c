@@ -0,0 +1,104 @@
+/* Copyright (c) 2026 Dovecot authors, see the included COPYING file */
+
+#include "lib.h"
+#include "str.h"
+#include "istream.h"
+#include "strnum.h"
+#include "time-util.h"
+#include "message-parser.h"
+
+#include <stdio.h>
+
+/* Measures message_parser throughput by repeatedly parsing a synthetic
+   multipart message. The message is built once; each round parses it from
+   an in-memory stream, so the numbers reflect the parser itself and not
+   storage I/O. */
+
+static string_t *build_test_msg(unsigned int body_blocks)
+{
+	string_t *msg = str_new(default_pool, body_blocks * 100);
+	unsigned int i;
+
+	str_append(msg,
+		"Return-Path: <bench@example.org>\n"
+		"From: Bench User <bench@example.org>\n"
+		"To: Another User <bench2@example.org>\n"
+		"Subject: benchmark message\n"
+		"Message-Id: <1.2.3.4@example>\n"
+		"Mime-Version: 1.0\n"
+		"Date: Sun, 23 May 2007 04:58:08 +0300\n"
+		"Content-Type: multipart/mixed; boundary=\"bench-boundary\"\n"
+		"\n"
+		"--bench-boundary\n"
+		"Content-Type: text/plain\n"
+		"\n");
+	for (i = 0; i < body_blocks; i++) {
+		str_printfa(msg, "line %u of filler text for the first "
+			    "body part to make it look like a real mail\n", i);
+	}
+	str_append(msg,
+		"--bench-boundary\n"
+		"Content-Type: application/octet-stream\n"
+		"Content-Transfer-Encoding: base64\n"
+		"\n");
+	for (i = 0; i < body_blocks; i++)
+		str_append(msg, "VGhpcyBpcyBiZW5jaG1hcmsgZmlsbGVyIGRhdGEK\n");
+	str_append(msg, "--bench-boundary--\n");
+	return msg;
+}
+
+static void bench_message_parser(unsigned int body_blocks, unsigned long rounds)
+{
+	const struct message_parser_settings set = { .flags = 0 };
+	struct message_parser_ctx *parser;
+	struct message_part *parts;
+	struct message_block block;
+	struct istream *input;
+	string_t *msg;
+	uint64_t ts_0, ts_1;
+	unsigned long r;
+	double mb, secs;
+	int ret;
+
+	msg = build_test_msg(body_blocks);
+	size_t msg_len = str_len(msg);
+	mb = (double)msg_len * (double)rounds / (1024.0 * 1024.0);
+
+	ts_0 = i_nanoseconds();
+	for (r = 0; r < rounds; r++) T_BEGIN {
+		pool_t pool = pool_alloconly_create("bench parts", 1024);
+
+		input = i_stream_create_from_data(str_data(msg), str_len(msg));
+		parser = message_parser_init(pool, input, &set);
+		while ((ret = message_parser_parse_next_block(parser, &block)) > 0)
+			;
+		i_assert(ret == -1 && input->stream_errno == 0);
+		message_parser_deinit(&parser, &parts);
+		i_stream_unref(&input);
+		pool_unref(&pool);
+	} T_END;
+	ts_1 = i_nanoseconds();
+
+	secs = (double)(ts_1 - ts_0) / 1e9;
+	printf("message_parser: %7.02lf MB/s, %7.02lf msgs/s "
+	       "(%zu byte message)\n",
+	       mb / secs, (double)rounds / secs, str_len(msg));
+	str_free(&msg);
+}
+
+int main(int argc, const char *argv[])
+{
+	unsigned long body_blocks = 200, rounds = 10000;
+
+	lib_init();
+
+	if (argc >= 2 && str_to_ulong(argv[1], &body_blocks) < 0)
+		i_fatal("Invalid body block count: %s", argv[1]);
+	if (argc >= 3 && str_to_ulong(argv[2], &rounds) < 0)
+		i_fatal("Invalid round count: %s", argv[2]);
+
+	bench_message_parser(body_blocks, rounds);
+
+	lib_deinit();
+	return 0;
+}
@@ -0,0 +1,200 @@
+/* Copyright (c) 2023 Dovecot authors, see the included COPYING file */
+
+#include "lib.h"
+#include "hash-method.h"
+#include "istream-private.h"
+#include "istream-dkim-body-hash.h"
+
+struct dkim_body_hash_istream {
+	struct istream_private istream;
+
+	const struct hash_method *method;
+	void *hash_context;
+	enum dkim_body_canonicalization canon;
+	uoff_t high_offset;
+
+	/* Line breaks seen in the body that haven't been hashed yet. They are
+	   hashed only when more body content follows, so that empty lines at
+	   the end of the body get ignored as the canonicalization requires. */
+	uoff_t pending_newlines;
+
+	bool in_body:1;
+	bool header_line_empty:1;
+	bool pending_cr:1;
+	bool pending_wsp:1;
+	bool body_has_content:1;
+};
+
+static void
+i_stream_dkim_body_hash_content(struct dkim_body_hash_istream *hstream,
+				unsigned char c)
+{
+	const struct hash_method *method = hstream->method;
+
+	if (hstream->canon == DKIM_BODY_CANONICALIZATION_RELAXED &&
+	    (c == ' ' || c == '\t')) {
+		/* WSP sequences are reduced to a single SP, which is hashed
+		   only if more content follows on this line */
+		hstream->pending_wsp = TRUE;
+		return;
+	}
+
+	for (; hstream->pending_newlines > 0; hstream->pending_newlines--)
+		method->loop(hstream->hash_context, "\r\n", 2);
+	if (hstream->pending_wsp) {
+		method->loop(hstream->hash_context, " ", 1);
+		hstream->pending_wsp = FALSE;
+	}
+	method->loop(hstream->hash_context, &c, 1);
+	hstream->body_has_content = TRUE;
+}
+
+static void
+i_stream_dkim_body_hash_data(struct dkim_body_hash_istream *hstream,
+			     const unsigned char *data, size_t size)
+{
+	size_t i;
+
+	for (i = 0; i < size; i++) {
+		unsigned char c = data[i];
+
+		if (!hstream->in_body) {
+			/* Look for the empty line that ends the header block.
+			   A CR doesn't change the emptiness of a line, so
+			   both CRLF and bare LF line endings are handled. */
+			if (c == '\n') {
+				if (hstream->header_line_empty)
+					hstream->in_body = TRUE;
+				hstream->header_line_empty = TRUE;
+			} else if (c != '\r') {
+				hstream->header_line_empty = FALSE;
+			}
+			continue;
+		}
+
+		if (hstream->pending_cr) {
+			hstream->pending_cr = FALSE;
+			if (c != '\n') {
+				/* A lone CR is treated as line content */
+				i_stream_dkim_body_hash_content(hstream, '\r');
+			}
+		}
+		if (c == '\r') {
+			hstream->pending_cr = TRUE;
+			continue;
+		}
+		if (c == '\n') {
+			/* Ignore whitespace at the end of the line */
+			hstream->pending_wsp = FALSE;
+			hstream->pending_newlines++;
+			continue;
+		}
+		i_stream_dkim_body_hash_content(hstream, c);
+	}
+}
+
+static void
+i_stream_dkim_body_hash_finish(struct dkim_body_hash_istream *hstream)
+{
+	if (hstream->pending_cr) {
+		hstream->pending_cr = FALSE;
+		i_stream_dkim_body_hash_content(hstream, '\r');
+	}
+	hstream->pending_wsp = FALSE;
+	hstream->pending_newlines = 0;
+
+	switch (hstream->canon) {
+	case DKIM_BODY_CANONICALIZATION_SIMPLE:
+		/* Empty lines at the end of the body are replaced with a
+		   single CRLF, a missing final CRLF is added and an empty
+		   body becomes a single CRLF. */
+		hstream->method->loop(hstream->hash_context, "\r\n", 2);
+		break;
+	case DKIM_BODY_CANONICALIZATION_RELAXED:
+		/* The same, except that an empty body stays empty. */
+		if (hstream->body_has_content) {
+			hstream->method->loop(hstream->hash_context,
+					      "\r\n", 2);
+		}
+		break;
+	}
+}
+
+static ssize_t
+i_stream_dkim_body_hash_read(struct istream_private *stream)
+{
+	struct dkim_body_hash_istream *hstream =
+		container_of(stream, struct dkim_body_hash_istream, istream);
+	const unsigned char *data;
+	size_t size;
+	uoff_t skip;
+	ssize_t ret;
+
+	i_stream_seek(stream->parent, stream->parent_start_offset +
+		      stream->istream.v_offset);
+
+	ret = i_stream_read_copy_from_parent(&stream->istream);
+	if (ret > 0 && hstream->hash_context != NULL) {
+		data = i_stream_get_data(&stream->istream, &size);
+		i_assert((size_t)ret <= size);
+
+		i_assert(stream->istream.v_offset <= hstream->high_offset);
+		skip = hstream->high_offset - stream->istream.v_offset;
+		if (skip < (size_t)size) {
+			hstream->high_offset += (size-skip);
+			i_stream_dkim_body_hash_data(hstream, data+skip,
+						     size-skip);
+		}
+	} else if (ret < 0 && hstream->hash_context != NULL) {
+		if (stream->istream.stream_errno == 0)
+			i_stream_dkim_body_hash_finish(hstream);
+		/* we finished hashing it. don't access it anymore, because
+		   the memory pointed by the hash may be freed before the
+		   istream itself */
+		hstream->hash_context = NULL;
+	}
+	return ret;
+}
+
+static void
+i_stream_dkim_body_hash_seek(struct istream_private *stream,
+			     uoff_t v_offset, bool mark ATTR_UNUSED)
+{
+	struct dkim_body_hash_istream *hstream =
+		container_of(stream, struct dkim_body_hash_istream, istream);
+
+	if (hstream->hash_context != NULL) {
+		io_stream_set_error(&stream->iostream,
+			"Seeking not supported before hashing is finished");
+		stream->istream.stream_errno = ESPIPE;
+	}
+	stream->istream.v_offset = v_offset;
+	stream->skip = stream->pos = 0;
+}
+
+struct istream *
+i_stream_create_dkim_body_hash(struct istream *input,
+			       const struct hash_method *method,
+			       void *hash_context,
+			       enum dkim_body_canonicalization canon)
+{
+	struct dkim_body_hash_istream *hstream;
+
+	hstream = i_new(struct dkim_body_hash_istream, 1);
+	hstream->istream.max_buffer_size = input->real_stream->max_buffer_size;
+	hstream->istream.stream_size_passthrough = TRUE;
+
+	hstream->istream.read = i_stream_dkim_body_hash_read;
+	hstream->istream.seek = i_stream_dkim_body_hash_seek;
+
+	hstream->istream.istream.readable_fd = input->readable_fd;
+	hstream->istream.istream.blocking = input->blocking;
+	hstream->istream.istream.seekable = input->seekable;
+
+	hstream->method = method;
+	hstream->hash_context = hash_context;
+	hstream->canon = canon;
+	hstream->header_line_empty = TRUE;
+	return i_stream_create(&hstream->istream, input,
+			       i_stream_get_fd(input), 0);
+}
@@ -0,0 +1,26 @@
+#ifndef ISTREAM_DKIM_BODY_HASH_H
+#define ISTREAM_DKIM_BODY_HASH_H
+
+struct hash_method;
+
+enum dkim_body_canonicalization {
+	/* "simple" body canonicalization (RFC 6376, Section 3.4.3) */
+	DKIM_BODY_CANONICALIZATION_SIMPLE,
+	/* "relaxed" body canonicalization (RFC 6376, Section 3.4.4) */
+	DKIM_BODY_CANONICALIZATION_RELAXED,
+};
+
+/* hash_context must be allocated and initialized by the caller. All data
+   passes through this istream unchanged, while the message body is
+   canonicalized according to the requested DKIM canonicalization algorithm
+   and fed to method->loop() in the same pass. Line endings are normalized to
+   CRLF for the hash, so the input may use either CRLF or LF. Once the stream
+   has been read to EOF, the caller gets the DKIM body hash (the bh= value,
+   before base64 encoding) from hash_context with method->result(). */
+struct istream *
+i_stream_create_dkim_body_hash(struct istream *input,
+			       const struct hash_method *method,
+			       void *hash_context,
+			       enum dkim_body_canonicalization canon);
+
+#endif
@@ -202,7 +202,22 @@ static ssize_t i_stream_dot_read(struct istream_private *stream)
 				dstream->state = 2;
 				dstream->state_no_cr = TRUE;
 			} else {
-				stream->w_buffer[dest++] = data[i];
+				/* bulk-copy the rest of the line, which is
+				   passed through unchanged */
+				const unsigned char *p;
+				size_t run;
+
+				run = I_MIN(size - i,
+					    stream->buffer_size - dest);
+				p = memchr(data + i, '\r', run);
+				if (p != NULL)
+					run = p - (data + i);
+				p = memchr(data + i, '\n', run);
+				if (p != NULL)
+					run = p - (data + i);
+				memcpy(stream->w_buffer + dest, data + i, run);
+				dest += run;
+				i += run - 1;
 			}
 		}
 	}
@@ -240,11 +240,115 @@ message_date_parser_tokens(struct message_date_parser_context *ctx,
 	return TRUE;
 }
 
+static int month_parse_fixed(const unsigned char *m)
+{
+	/* one comparison per month instead of up to 12 i_memcasecmp()s.
+	   exact case only - anything else takes the lenient parser. */
+	switch ((uint32_t)m[0] << 16 | (uint32_t)m[1] << 8 | m[2]) {
+	case ((uint32_t)'J' << 16) | ('a' << 8) | 'n': return 0;
+	case ((uint32_t)'F' << 16) | ('e' << 8) | 'b': return 1;
+	case ((uint32_t)'M' << 16) | ('a' << 8) | 'r': return 2;
+	case ((uint32_t)'A' << 16) | ('p' << 8) | 'r': return 3;
+	case ((uint32_t)'M' << 16) | ('a' << 8) | 'y': return 4;
+	case ((uint32_t)'J' << 16) | ('u' << 8) | 'n': return 5;
+	case ((uint32_t)'J' << 16) | ('u' << 8) | 'l': return 6;
+	case ((uint32_t)'A' << 16) | ('u' << 8) | 'g': return 7;
+	case ((uint32_t)'S' << 16) | ('e' << 8) | 'p': return 8;
+	case ((uint32_t)'O' << 16) | ('c' << 8) | 't': return 9;
+	case ((uint32_t)'N' << 16) | ('o' << 8) | 'v': return 10;
+	case ((uint32_t)'D' << 16) | ('e' << 8) | 'c': return 11;
+	}
+	return -1;
+}
+
+/* Parse the exact fixed format nearly all mails use:
+   "Mon, 02 Jan 2006 15:04:05 -0700". Any deviation - single digit day,
+   missing weekday or seconds, timezone names, comments, unusual casing -
+   returns FALSE and the lenient tokenizing parser handles it. */
+static bool
+message_date_parse_fixed(const unsigned char *data, size_t size,
+			 time_t *timestamp_r, int *timezone_offset_r)
+{
+	struct tm tm;
+	unsigned int year;
+	int month, offset;
+
+	while (size > 0 && (data[0] == ' ' || data[0] == '\t')) {
+		data++;
+		size--;
+	}
+	if (size < 31)
+		return FALSE;
+	if (size > 31) {
+		/* make sure the timezone token really ends at the 4 digits,
+		   so the result can't differ from the lenient parser's */
+		switch (data[31]) {
+		case ' ':
+		case '\t':
+		case '\r':
+		case '\n':
+		case '(':
+			break;
+		default:
+			return FALSE;
+		}
+	}
+
+	if (!i_isalpha(data[0]) || !i_isalpha(data[1]) || !i_isalpha(data[2]) ||
+	    data[3] != ',' || data[4] != ' ')
+		return FALSE;
+	if (!i_isdigit(data[5]) || !i_isdigit(data[6]) || data[7] != ' ')
+		return FALSE;
+	month = month_parse_fixed(data + 8);
+	if (month < 0 || data[11] != ' ')
+		return FALSE;
+	if (!i_isdigit(data[12]) || !i_isdigit(data[13]) ||
+	    !i_isdigit(data[14]) || !i_isdigit(data[15]) || data[16] != ' ')
+		return FALSE;
+	if (!i_isdigit(data[17]) || !i_isdigit(data[18]) || data[19] != ':' ||
+	    !i_isdigit(data[20]) || !i_isdigit(data[21]) || data[22] != ':' ||
+	    !i_isdigit(data[23]) || !i_isdigit(data[24]) || data[25] != ' ')
+		return FALSE;
+	if ((data[26] != '+' && data[26] != '-') ||
+	    !i_isdigit(data[27]) || !i_isdigit(data[28]) ||
+	    !i_isdigit(data[29]) || !i_isdigit(data[30]))
+		return FALSE;
+
+	year = (data[12]-'0') * 1000 + (data[13]-'0') * 100 +
+		(data[14]-'0') * 10 + (data[15]-'0');
+	if (year < 1900)
+		return FALSE;
+
+	i_zero(&tm);
+	tm.tm_mday = (data[5]-'0') * 10 + (data[6]-'0');
+	tm.tm_mon = month;
+	tm.tm_year = year - 1900;
+	tm.tm_hour = (data[17]-'0') * 10 + (data[18]-'0');
+	tm.tm_min = (data[20]-'0') * 10 + (data[21]-'0');
+	tm.tm_sec = (data[23]-'0') * 10 + (data[24]-'0');
+	tm.tm_isdst = -1;
+
+	offset = ((data[27]-'0') * 10 + (data[28]-'0')) * 60 +
+		(data[29]-'0') * 10 + (data[30]-'0');
+	if (data[26] == '-')
+		offset = -offset;
+
+	*timestamp_r = utc_mktime(&tm);
+	if (*timestamp_r == (time_t)-1)
+		return FALSE;
+	*timestamp_r -= offset * 60;
+	*timezone_offset_r = offset;
+	return TRUE;
+}
+
 bool message_date_parse(const unsigned char *data, size_t size,
 			time_t *timestamp_r, int *timezone_offset_r)
 {
 	bool success;
 
+	if (message_date_parse_fixed(data, size, timestamp_r,
+				     timezone_offset_r))
+		return TRUE;
 	T_BEGIN {
 		struct message_date_parser_context ctx;
 
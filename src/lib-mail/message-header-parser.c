@@ -167,38 +167,40 @@ int message_parse_header_next(struct message_header_parser_ctx *ctx,
 			break;
 		}
 
-		/* find ':' */
+		/* find ':' up to the end of the line */
 		if (colon_pos == UINT_MAX) {
-			for (i = startpos; i < parse_size; i++) {
-				if (msg[i] > ':')
-					continue;
-
-				if (msg[i] == ':' && !ctx->skip_line) {
-					colon_pos = i;
-					line->full_value_offset =
-						ctx->input->v_offset + i + 1;
-					break;
-				}
-				if (msg[i] == '\n') {
-					/* end of headers, or error */
-					break;
-				}
-
-				if (msg[i] == '\0')
-					ctx->has_nuls = TRUE;
+			const unsigned char *colon, *lf;
+
+			lf = memchr(msg + startpos, '\n',
+				    parse_size - startpos);
+			i = lf == NULL ? parse_size : (size_t)(lf - msg);
+			colon = ctx->skip_line ? NULL :
+				memchr(msg + startpos, ':', i - startpos);
+			if (colon != NULL) {
+				colon_pos = colon - msg;
+				line->full_value_offset =
+					ctx->input->v_offset + colon_pos + 1;
+				i = colon_pos;
 			}
+			if (!ctx->has_nuls &&
+			    memchr(msg + startpos, '\0', i - startpos) != NULL)
+				ctx->has_nuls = TRUE;
 		} else {
 			i = startpos;
 		}
 
 		/* find '\n' */
-		for (; i < parse_size; i++) {
-			if (msg[i] <= '\n') {
-				if (msg[i] == '\n')
-					break;
-				if (msg[i] == '\0')
+		if (i < parse_size) {
+			const unsigned char *lf;
+
+			lf = memchr(msg + i, '\n', parse_size - i);
+			if (!ctx->has_nuls) {
+				size_t scan_size = (lf == NULL ? parse_size :
+						    (size_t)(lf - msg)) - i;
+				if (memchr(msg + i, '\0', scan_size) != NULL)
 					ctx->has_nuls = TRUE;
 			}
+			i = lf == NULL ? parse_size : (size_t)(lf - msg);
 		}
 
 		if (i < parse_size && i+1 == size && ret == -2) {
@@ -61,7 +61,8 @@ static void parse_body_add_block(struct message_parser_ctx *ctx,
 	block->hdr = NULL;
 
 	/* check if we have NULs */
-	if (memchr(data, '\0', block->size) != NULL)
+	if ((ctx->part->flags & MESSAGE_PART_FLAG_HAS_NULS) == 0 &&
+	    memchr(data, '\0', block->size) != NULL)
 		ctx->part->flags |= MESSAGE_PART_FLAG_HAS_NULS;
 
 	/* count number of lines and missing CRs */
@@ -434,6 +435,10 @@ static int parse_next_body_to_boundary(struct message_parser_ctx *ctx,
 			full = FALSE;
 		}
 
+		if (end - cur >= 2 && (cur[0] != '-' || cur[1] != '-')) {
+			/* quickly skip lines that can't begin a boundary */
+			continue;
+		}
 		ret = boundary_line_find(ctx, cur, end - cur, full, &boundary);
 		if (ret >= 0) {
 			/* found / need more data */
@@ -34,6 +34,14 @@ struct snippet_context {
 	buffer_t *plain_output;
 };
 
+struct message_snippet_context {
+	pool_t pool;
+	struct snippet_context ctx;
+	struct message_decoder_context *decoder;
+	struct message_part *skip_part;
+	bool done;
+};
+
 static void snippet_add_content(struct snippet_context *ctx,
 				struct snippet_data *target,
 				const unsigned char *data, size_t size,
@@ -133,6 +141,91 @@ static void snippet_copy(const char *src, string_t *dst)
 	str_append(dst, src);
 }
 
+struct message_snippet_context *
+message_snippet_parse_init(unsigned int max_snippet_chars)
+{
+	struct message_snippet_context *sctx;
+	pool_t pool;
+
+	pool = pool_alloconly_create("message snippet", 2048);
+	sctx = p_new(pool, struct message_snippet_context, 1);
+	sctx->pool = pool;
+	sctx->ctx.snippet.snippet = str_new(pool, max_snippet_chars);
+	sctx->ctx.snippet.chars_left = max_snippet_chars;
+	sctx->ctx.quoted_snippet.snippet = str_new(pool, max_snippet_chars);
+	sctx->ctx.quoted_snippet.chars_left = max_snippet_chars - 1; /* -1 for '>' */
+	sctx->decoder = message_decoder_init(NULL, 0);
+	return sctx;
+}
+
+bool message_snippet_parse_more(struct message_snippet_context *sctx,
+				struct message_block *raw_block)
+{
+	struct message_block block;
+
+	if (sctx->done)
+		return FALSE;
+	if (raw_block->part == sctx->skip_part)
+		return TRUE;
+	if (!message_decoder_decode_next_block(sctx->decoder, raw_block, &block))
+		return TRUE;
+	if (block.size == 0) {
+		const char *ct;
+
+		if (block.hdr != NULL)
+			return TRUE;
+
+		/* We already have a snippet, don't look for more in
+		   subsequent parts. */
+		if (sctx->ctx.snippet.snippet->used != 0 ||
+		    sctx->ctx.quoted_snippet.snippet->used != 0) {
+			sctx->done = TRUE;
+			return FALSE;
+		}
+
+		sctx->skip_part = NULL;
+
+		/* end of headers - verify that we can use this
+		   Content-Type. we get here only once, because we
+		   always handle only one non-multipart MIME part. */
+		ct = message_decoder_current_content_type(sctx->decoder);
+		if (ct == NULL)
+			/* text/plain */ ;
+		else if (mail_html2text_content_type_match(ct)) {
+			mail_html2text_deinit(&sctx->ctx.html2text);
+			sctx->ctx.html2text = mail_html2text_init(0);
+			if (sctx->ctx.plain_output == NULL) {
+				sctx->ctx.plain_output =
+					buffer_create_dynamic(sctx->pool, 1024);
+			}
+		} else if (!str_begins_icase_with(ct, "text/"))
+			sctx->skip_part = raw_block->part;
+	} else if (!snippet_generate(&sctx->ctx, block.data, block.size)) {
+		sctx->done = TRUE;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+void message_snippet_parse_deinit(struct message_snippet_context **_sctx,
+				  string_t *snippet)
+{
+	struct message_snippet_context *sctx = *_sctx;
+
+	*_sctx = NULL;
+	message_decoder_deinit(&sctx->decoder);
+	mail_html2text_deinit(&sctx->ctx.html2text);
+	if (snippet == NULL)
+		;
+	else if (sctx->ctx.snippet.snippet->used != 0)
+		snippet_copy(str_c(sctx->ctx.snippet.snippet), snippet);
+	else if (sctx->ctx.quoted_snippet.snippet->used != 0) {
+		str_append_c(snippet, '>');
+		snippet_copy(str_c(sctx->ctx.quoted_snippet.snippet), snippet);
+	}
+	pool_unref(&sctx->pool);
+}
+
 int message_snippet_generate(struct istream *input,
 			     unsigned int max_snippet_chars,
 			     string_t *snippet)
@@ -140,68 +233,18 @@ int message_snippet_generate(struct istream *input,
 	const struct message_parser_settings parser_set = { .flags = 0 };
 	struct message_parser_ctx *parser;
 	struct message_part *parts;
-	struct message_part *skip_part = NULL;
-	struct message_decoder_context *decoder;
-	struct message_block raw_block, block;
-	struct snippet_context ctx;
-	pool_t pool;
+	struct message_snippet_context *sctx;
+	struct message_block raw_block;
 	int ret;
 
-	i_zero(&ctx);
-	pool = pool_alloconly_create("message snippet", 2048);
-	ctx.snippet.snippet = str_new(pool, max_snippet_chars);
-	ctx.snippet.chars_left = max_snippet_chars;
-	ctx.quoted_snippet.snippet = str_new(pool, max_snippet_chars);
-	ctx.quoted_snippet.chars_left = max_snippet_chars - 1; /* -1 for '>' */
+	sctx = message_snippet_parse_init(max_snippet_chars);
 	parser = message_parser_init(pool_datastack_create(), input, &parser_set);
-	decoder = message_decoder_init(NULL, 0);
 	while ((ret = message_parser_parse_next_block(parser, &raw_block)) > 0) {
-		if (raw_block.part == skip_part)
-			continue;
-		if (!message_decoder_decode_next_block(decoder, &raw_block, &block))
-			continue;
-		if (block.size == 0) {
-			const char *ct;
-
-			if (block.hdr != NULL)
-				continue;
-
-			/* We already have a snippet, don't look for more in
-			   subsequent parts. */
-			if (ctx.snippet.snippet->used != 0 ||
-			    ctx.quoted_snippet.snippet->used != 0)
-				break;
-
-			skip_part = NULL;
-
-			/* end of headers - verify that we can use this
-			   Content-Type. we get here only once, because we
-			   always handle only one non-multipart MIME part. */
-			ct = message_decoder_current_content_type(decoder);
-			if (ct == NULL)
-				/* text/plain */ ;
-			else if (mail_html2text_content_type_match(ct)) {
-				mail_html2text_deinit(&ctx.html2text);
-				ctx.html2text = mail_html2text_init(0);
-				if (ctx.plain_output == NULL) {
-					ctx.plain_output =
-						buffer_create_dynamic(pool, 1024);
-				}
-			} else if (!str_begins_icase_with(ct, "text/"))
-				skip_part = raw_block.part;
-		} else if (!snippet_generate(&ctx, block.data, block.size))
+		if (!message_snippet_parse_more(sctx, &raw_block))
 			break;
 	}
 	i_assert(ret != 0);
-	message_decoder_deinit(&decoder);
+	message_snippet_parse_deinit(&sctx, snippet);
 	message_parser_deinit(&parser, &parts);
-	mail_html2text_deinit(&ctx.html2text);
-	if (ctx.snippet.snippet->used != 0)
-		snippet_copy(str_c(ctx.snippet.snippet), snippet);
-	else if (ctx.quoted_snippet.snippet->used != 0) {
-		str_append_c(snippet, '>');
-		snippet_copy(str_c(ctx.quoted_snippet.snippet), snippet);
-	}
-	pool_unref(&pool);
 	return input->stream_errno == 0 ? 0 : -1;
 }
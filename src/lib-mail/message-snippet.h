@@ -1,6 +1,9 @@
 #ifndef MESSAGE_SNIPPET_H
 #define MESSAGE_SNIPPET_H
 
+struct message_block;
+struct message_snippet_context;
+
 /* Generate UTF-8 text snippet from the beginning of the given mail input
    stream. The stream is expected to start at the MIME part's headers whose
    snippet is being generated. Returns 0 if ok, -1 if I/O error.
@@ -11,4 +14,18 @@ int message_snippet_generate(struct istream *input,
 			     unsigned int max_snippet_chars,
 			     string_t *snippet);
 
+/* Incremental snippet generation from raw message parser blocks. This allows
+   generating the snippet while the message is already being parsed for other
+   reasons (e.g. while it's being saved), without reading it again. */
+struct message_snippet_context *
+message_snippet_parse_init(unsigned int max_snippet_chars);
+/* Feed the next raw block from a message parser. Returns FALSE when the
+   snippet is finished and feeding more blocks is unnecessary. */
+bool message_snippet_parse_more(struct message_snippet_context *ctx,
+				struct message_block *raw_block);
+/* Append the generated snippet to the given string and free the context.
+   snippet may be NULL if the result is no longer wanted. */
+void message_snippet_parse_deinit(struct message_snippet_context **_ctx,
+				  string_t *snippet);
+
 #endif
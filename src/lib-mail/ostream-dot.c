@@ -120,6 +120,20 @@ o_stream_dot_sendv(struct ostream_private *stream,
 				case '\r':
 					dstream->state = STREAM_STATE_CR;
 					break;
+				default: {
+					/* bulk-skip the rest of the line,
+					   which is passed through unchanged */
+					const char *q, *lfp;
+
+					q = memchr(p, '\r', pend - p);
+					if (q == NULL)
+						q = pend;
+					lfp = memchr(p, '\n', q - p);
+					if (lfp != NULL)
+						q = lfp;
+					p = q - 1;
+					break;
+				}
 				}
 				break;
 			/* got CR */
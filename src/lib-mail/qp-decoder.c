@@ -48,6 +48,16 @@ void qp_decoder_deinit(struct qp_decoder **_qp)
 	i_free(qp);
 }
 
+/* characters that end a run of plain text: '=' starts an escape, CR and LF
+   end the line and whitespace may turn out to be trailing whitespace that
+   must be buffered. everything else is copied through as-is. */
+static const unsigned char qp_text_delim[256] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 1, 0, 0, // 00
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 10
+	1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 20
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, // 30
+};
+
 static size_t
 qp_decoder_more_text(struct qp_decoder *qp, const unsigned char *src,
 		     size_t src_size)
@@ -55,7 +65,7 @@ qp_decoder_more_text(struct qp_decoder *qp, const unsigned char *src,
 	size_t i, start = 0, ret = src_size;
 
 	for (i = 0; i < src_size; i++) {
-		if (src[i] > '=') {
+		if (qp_text_delim[src[i]] == 0) {
 			/* fast path */
 			continue;
 		}
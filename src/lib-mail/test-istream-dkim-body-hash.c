@@ -0,0 +1,113 @@
+/* Copyright (c) 2023 Dovecot authors, see the included COPYING file */
+
+#include "lib.h"
+#include "buffer.h"
+#include "str.h"
+#include "hash-method.h"
+#include "istream.h"
+#include "test-common.h"
+#include "istream-dkim-body-hash.h"
+
+static const struct {
+	const char *input;
+	const char *canon_simple;
+	const char *canon_relaxed;
+} tests[] = {
+	/* example from RFC 6376, Section 3.4.5 */
+	{ "From: a\r\nTo: b\r\n\r\n C \r\nD \t E\r\n\r\n\r\n",
+	  " C \r\nD \t E\r\n",
+	  " C\r\nD E\r\n" },
+	/* no body at all */
+	{ "From: a\r\n", "\r\n", "" },
+	/* empty body */
+	{ "From: a\r\n\r\n", "\r\n", "" },
+	/* body with only empty lines */
+	{ "From: a\r\n\r\n\r\n\r\n", "\r\n", "" },
+	/* bare LF line endings, no final newline */
+	{ "From: a\nTo: b\n\nline1\nline2",
+	  "line1\r\nline2\r\n",
+	  "line1\r\nline2\r\n" },
+	/* trailing and repeated whitespace */
+	{ "A: b\n\nx  \t y \t\nz\n\n",
+	  "x  \t y \t\r\nz\r\n",
+	  "x y\r\nz\r\n" },
+	/* whitespace-only line in the middle */
+	{ "A: b\n\nx\n \t\ny\n",
+	  "x\r\n \t\r\ny\r\n",
+	  "x\r\n\r\ny\r\n" },
+	/* whitespace-only line at the end */
+	{ "A: b\n\nx\n \n", "x\r\n \r\n", "x\r\n" },
+	/* lone CR is line content */
+	{ "A: b\n\nx\ry\n", "x\ry\r\n", "x\ry\r\n" },
+};
+
+static void
+test_istream_dkim_body_hash_one(const char *input,
+				enum dkim_body_canonicalization canon,
+				const char *canonical,
+				size_t max_buffer_size)
+{
+	const struct hash_method *method = hash_method_lookup("sha256");
+	unsigned char *ctx, digest_exp[32], digest[32];
+	struct istream *is_input, *is_hash;
+	const unsigned char *data;
+	string_t *output;
+	size_t size;
+	int ret;
+
+	ctx = t_malloc0(method->context_size);
+	method->init(ctx);
+	method->loop(ctx, canonical, strlen(canonical));
+	method->result(ctx, digest_exp);
+
+	method->init(ctx);
+	is_input = test_istream_create(input);
+	is_hash = i_stream_create_dkim_body_hash(is_input, method, ctx, canon);
+	if (max_buffer_size != 0)
+		i_stream_set_max_buffer_size(is_hash, max_buffer_size);
+
+	output = t_str_new(256);
+	while ((ret = i_stream_read_more(is_hash, &data, &size)) > 0) {
+		str_append_data(output, data, size);
+		i_stream_skip(is_hash, size);
+	}
+	test_assert(ret == -1 && is_hash->stream_errno == 0);
+	/* the data must pass through unchanged */
+	test_assert(strcmp(str_c(output), input) == 0);
+
+	method->result(ctx, digest);
+	test_assert(memcmp(digest, digest_exp, sizeof(digest)) == 0);
+
+	i_stream_unref(&is_hash);
+	i_stream_unref(&is_input);
+}
+
+static void test_istream_dkim_body_hash(void)
+{
+	static const size_t max_buffer_sizes[] = { 0, 1, 3 };
+	unsigned int i, j;
+
+	test_begin("istream dkim body hash");
+	for (i = 0; i < N_ELEMENTS(tests); i++) T_BEGIN {
+		for (j = 0; j < N_ELEMENTS(max_buffer_sizes); j++) {
+			test_istream_dkim_body_hash_one(
+				tests[i].input,
+				DKIM_BODY_CANONICALIZATION_SIMPLE,
+				tests[i].canon_simple, max_buffer_sizes[j]);
+			test_istream_dkim_body_hash_one(
+				tests[i].input,
+				DKIM_BODY_CANONICALIZATION_RELAXED,
+				tests[i].canon_relaxed, max_buffer_sizes[j]);
+		}
+	} T_END;
+	test_end();
+}
+
+int main(void)
+{
+	static void (*const test_functions[])(void) = {
+		test_istream_dkim_body_hash,
+		NULL
+	};
+	return test_run(test_functions);
+}
@@ -41,6 +41,11 @@ struct master_service {
 	ARRAY_TYPE(const_string) config_overrides;
 	void *config_mmap_base;
 	size_t config_mmap_size;
+	/* Event filters from the mmaped config, parsed on the first read and
+	   indexed by the filter's position in the file. The mmaped config
+	   never changes (a reload maps a new one), so repeated settings reads
+	   can reuse them. */
+	ARRAY(struct event_filter *) config_mmap_filters;
 	int syslog_facility;
 	data_stack_frame_t datastack_frame_id;
 
@@ -108,6 +113,7 @@ struct master_service {
 
 void master_service_io_listeners_add(struct master_service *service);
 void master_status_update(struct master_service *service);
+void master_service_config_filters_free(struct master_service *service);
 
 void master_service_io_listeners_remove(struct master_service *service);
 void master_service_ssl_io_listeners_remove(struct master_service *service);
@@ -54,6 +54,7 @@ static const struct setting_define master_service_setting_defines[] = {
 	DEF(BOOL, version_ignore),
 	DEF(BOOL, shutdown_clients),
 	DEF(BOOL, verbose_proctitle),
+	DEF(BOOL, log_overflow_drop),
 
 	DEF(STR, haproxy_trusted_networks),
 	DEF(TIME, haproxy_timeout),
@@ -92,6 +93,7 @@ static const struct master_service_settings master_service_default_settings = {
 	.version_ignore = FALSE,
 	.shutdown_clients = TRUE,
 	.verbose_proctitle = FALSE,
+	.log_overflow_drop = FALSE,
 
 	.haproxy_trusted_networks = "",
 	.haproxy_timeout = 3
@@ -407,8 +409,22 @@ filter_string_parse_protocol(const char *filter_string,
 	array_push_back(protocols, &protocol);
 }
 
+void master_service_config_filters_free(struct master_service *service)
+{
+	struct event_filter *filter;
+
+	if (!array_is_created(&service->config_mmap_filters))
+		return;
+	array_foreach_elem(&service->config_mmap_filters, filter) {
+		if (filter != NULL)
+			event_filter_unref(&filter);
+	}
+	array_free(&service->config_mmap_filters);
+}
+
 static int
-master_service_settings_read_mmap(struct setting_parser_context *parser,
+master_service_settings_read_mmap(struct master_service *service,
+				  struct setting_parser_context *parser,
 				  struct event *event,
 				  const unsigned char *mmap_base,
 				  size_t mmap_size,
@@ -456,8 +472,12 @@ master_service_settings_read_mmap(struct setting_parser_context *parser,
 		return -1;
 	}
 
+	if (!array_is_created(&service->config_mmap_filters))
+		i_array_init(&service->config_mmap_filters, 16);
+
 	size_t start_offset = eol - mmap_base + 1;
 	uoff_t offset = start_offset;
+	unsigned int filter_idx = 0;
 	do {
 		/* <blob size> */
 		uint64_t blob_size;
@@ -491,20 +511,29 @@ master_service_settings_read_mmap(struct setting_parser_context *parser,
 				return -1;
 			}
 
-			struct event_filter *filter = event_filter_create();
 			const char *error;
 			filter_string_parse_protocol(filter_string, &protocols);
-			if (event_filter_parse(filter_string, filter, &error) < 0) {
-				*error_r = t_strdup_printf(
-					"Received invalid filter '%s': %s",
-					filter_string, error);
-				event_filter_unref(&filter);
-				return -1;
+			/* the filters are the same on every read of the same
+			   mmaped config - parse each only once */
+			struct event_filter **cached_filter =
+				array_idx_get_space(&service->config_mmap_filters,
+						    filter_idx++);
+			if (*cached_filter == NULL) {
+				struct event_filter *filter =
+					event_filter_create();
+				if (event_filter_parse(filter_string, filter,
+						       &error) < 0) {
+					*error_r = t_strdup_printf(
+						"Received invalid filter '%s': %s",
+						filter_string, error);
+					event_filter_unref(&filter);
+					return -1;
+				}
+				*cached_filter = filter;
 			}
 			bool match = filter_string[0] == '\0' ||
-				event_filter_match(filter, event,
+				event_filter_match(*cached_filter, event,
 						   &failure_ctx);
-			event_filter_unref(&filter);
 			if (!match) {
 				/* Filter didn't match. Jump to the next one. */
 				offset = end_offset;
@@ -582,6 +611,8 @@ int master_service_settings_read(struct master_service *service,
 			if (munmap(service->config_mmap_base,
 				   service->config_mmap_size) < 0)
 				i_error("munmap(<config>) failed: %m");
+			/* the cached filters belong to the old config */
+			master_service_config_filters_free(service);
 		}
 
 		service->config_mmap_base =
@@ -636,7 +667,7 @@ int master_service_settings_read(struct master_service *service,
 	/* config_mmap_base is NULL only if
 	   MASTER_SERVICE_FLAG_NO_CONFIG_SETTINGS is used */
 	if (service->config_mmap_base != NULL) {
-		ret = master_service_settings_read_mmap(parser, event,
+		ret = master_service_settings_read_mmap(service, parser, event,
 			service->config_mmap_base, service->config_mmap_size,
 			output_r, error_r);
 
@@ -689,6 +720,8 @@ int master_service_settings_read(struct master_service *service,
 	if (service->set->shutdown_clients)
 		master_service_set_die_with_master(master_service, TRUE);
 
+	i_set_failure_internal_drop_overflow(service->set->log_overflow_drop);
+
 	/* if we change any settings afterwards, they're in expanded form.
 	   especially all settings from userdb are already expanded. */
 	settings_parse_set_expanded(service->set_parser, TRUE);
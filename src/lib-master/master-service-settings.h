@@ -27,6 +27,7 @@ struct master_service_settings {
 	bool version_ignore;
 	bool shutdown_clients;
 	bool verbose_proctitle;
+	bool log_overflow_drop;
 
 	const char *haproxy_trusted_networks;
 	unsigned int haproxy_timeout;
@@ -1580,6 +1580,7 @@ static void master_service_deinit_real(struct master_service **_service)
 			   service->config_mmap_size) < 0)
 			i_error("munmap(<config>) failed: %m");
 	}
+	master_service_config_filters_free(service);
 	i_free(master_service_category_name);
 	master_service_category.name = NULL;
 	event_unregister_callback(master_service_event_callback);
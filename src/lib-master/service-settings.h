@@ -56,6 +56,17 @@ struct service_settings {
 	const char *chroot;
 
 	bool drop_priv_before_exec;
+	/* Pin each process to a single CPU, round-robining new processes
+	   over the online CPUs. Requires sched_setaffinity() support. */
+	bool cpu_affinity;
+	/* Restrict the service's processes to the given CPUs, e.g.
+	   "0-7,16-23". With cpu_affinity=yes each process is pinned to a
+	   single CPU picked round-robin from this list, otherwise each
+	   process is allowed to run on any of them. Binding a service to
+	   one socket's CPUs also keeps its memory on that socket's NUMA
+	   node, since the kernel allocates memory local to the running
+	   CPU by default. */
+	const char *cpu_affinity_cpus;
 
 	unsigned int process_min_avail;
 	unsigned int process_limit;
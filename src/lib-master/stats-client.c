@@ -12,6 +12,11 @@
 
 #define STATS_CLIENT_TIMEOUT_MSECS (5*1000)
 #define STATS_CLIENT_RECONNECT_INTERVAL_MSECS (10*1000)
+/* If the stats process isn't reading events fast enough and this much is
+   buffered, drop new events instead of buffering more. Stats must never
+   block or bloat the process that generates them. */
+#define STATS_CLIENT_MAX_OUTPUT_BUFFER_SIZE (1024*1024)
+#define STATS_CLIENT_DROP_WARN_INTERVAL_SECS 60
 
 struct stats_client {
 	struct connection conn;
@@ -19,6 +24,7 @@ struct stats_client {
 	struct ioloop *ioloop;
 	struct timeout *to_reconnect;
 	struct timeval wait_started;
+	time_t last_drop_warning;
 	bool handshaked;
 	bool handshake_received_at_least_once;
 	bool silent_notfound_errors;
@@ -201,10 +207,24 @@ stats_client_send_event(struct stats_client *client, struct event *event,
 	if (!event_filter_match(client->filter, event, ctx))
 		return;
 
+	if (o_stream_get_buffer_used_size(client->conn.output) >=
+	    STATS_CLIENT_MAX_OUTPUT_BUFFER_SIZE) {
+		/* The stats process isn't keeping up. Drop the event before
+		   anything about it is written, so the BEGINs of its parents
+		   aren't sent either and a later event resends them. */
+		if (client->last_drop_warning +
+		    STATS_CLIENT_DROP_WARN_INTERVAL_SECS <= ioloop_time) {
+			client->last_drop_warning = ioloop_time;
+			e_warning(client->conn.event,
+				  "stats process is too slow, dropping events");
+		}
+		return;
+	}
+
 	/* Need to send the event for stats and/or export */
 	string_t *str = t_str_new(256);
 
-	if (++recursion == 0)
+	if (recursion++ == 0)
 		o_stream_cork(client->conn.output);
 	struct event *global_event = event_get_global();
 	if (global_event != NULL)
@@ -343,6 +363,9 @@ static void stats_client_send_registered_categories(struct stats_client *client)
 static void stats_client_connect(struct stats_client *client)
 {
 	if (connection_client_connect(&client->conn) == 0) {
+		/* delay the uncork flushes so a burst of events generated
+		   during a single ioloop iteration is sent with one write() */
+		o_stream_set_batch_flush(client->conn.output, TRUE);
 		/* read the handshake so the global debug filter is updated */
 		stats_client_send_registered_categories(client);
 		if (!client->handshake_received_at_least_once)
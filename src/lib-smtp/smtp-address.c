@@ -6,6 +6,8 @@
 #include "smtp-parser.h"
 #include "smtp-address.h"
 
+#include <ctype.h>
+
 /* From RFC 5321:
 
    Reverse-path     = Path / "<>"
@@ -381,6 +383,92 @@ smtp_address_parse_path_broken(struct smtp_address_parser *aparser,
 	return 0;
 }
 
+static bool
+smtp_address_parse_path_fast(pool_t pool, const char *path,
+			     enum smtp_address_parse_flags flags,
+			     struct smtp_address **address_r,
+			     const char **endp_r)
+{
+	const unsigned char *p = (const unsigned char *)path;
+	const unsigned char *lp_begin, *lp_end, *dom_begin, *dom_end;
+	struct smtp_address *address;
+	bool bracketed = FALSE;
+
+	/* Handle the dominant Dot-string "@" Domain form with a single
+	   table-driven scan, allocating the result directly from the target
+	   pool. Everything else - quoted strings, source routes, address
+	   literals, localpart-only and broken addresses - falls back to the
+	   full parser. */
+
+	if (*p == '<') {
+		bracketed = TRUE;
+		p++;
+	} else if ((flags & SMTP_ADDRESS_PARSE_FLAG_BRACKETS_OPTIONAL) == 0) {
+		return FALSE;
+	}
+
+	/* Dot-string (with the same deviation as
+	   smtp_parser_parse_dot_string()) */
+	lp_begin = p;
+	while (smtp_char_is_atext(*p) || *p == '.')
+		p++;
+	if (p == lp_begin || *p != '@')
+		return FALSE;
+	lp_end = p;
+	p++;
+
+	/* Domain, with the same leniency as smtp_parser_parse_domain():
+	   '-' and '_' are allowed anywhere in a sub-domain */
+	dom_begin = p;
+	for (;;) {
+		const unsigned char *label = p;
+
+		while (i_isalnum(*p) || *p == '-' || *p == '_')
+			p++;
+		if (p == label)
+			return FALSE;
+		if (*p != '.')
+			break;
+		p++;
+	}
+	dom_end = p;
+
+	if (bracketed) {
+		if (*p != '>')
+			return FALSE;
+		p++;
+	}
+	if (*p != '\0') {
+		/* Trailing data is accepted only when the caller wants to
+		   know where the path ended; ignore-broken parsing of a
+		   non-space suffix needs the full parser */
+		if (endp_r == NULL)
+			return FALSE;
+		if (*p != ' ' &&
+		    HAS_ALL_BITS(flags, SMTP_ADDRESS_PARSE_FLAG_IGNORE_BROKEN))
+			return FALSE;
+	}
+
+	if (address_r != NULL) {
+		address = p_new(pool, struct smtp_address, 1);
+		address->localpart = p_strdup_until(pool, lp_begin, lp_end);
+		address->domain = p_strdup_until(pool, dom_begin, dom_end);
+		if (HAS_ALL_BITS(flags, SMTP_ADDRESS_PARSE_FLAG_PRESERVE_RAW)) {
+			if (bracketed) {
+				address->raw = p_strdup_until(
+					pool, path + 1, (const char *)p - 1);
+			} else {
+				address->raw = p_strdup_until(
+					pool, path, (const char *)p);
+			}
+		}
+		*address_r = address;
+	}
+	if (endp_r != NULL)
+		*endp_r = (const char *)p;
+	return TRUE;
+}
+
 int smtp_address_parse_path_full(pool_t pool, const char *path,
 				 enum smtp_address_parse_flags flags,
 				 struct smtp_address **address_r,
@@ -410,6 +498,10 @@ int smtp_address_parse_path_full(pool_t pool, const char *path,
 		return 0;
 	}
 
+	/* Try the fast path for the dominant address form first */
+	if (smtp_address_parse_path_fast(pool, path, flags, address_r, endp_r))
+		return 0;
+
 	i_zero(&aparser);
 	smtp_parser_init(&aparser.parser, pool_datastack_create(), path);
 	aparser.address_end = (endp_r != NULL ? NULL : aparser.parser.end);
@@ -719,6 +719,27 @@ void smtp_server_connection_trigger_output(struct smtp_server_connection *conn)
 	}
 }
 
+void smtp_server_connection_flush_replies(struct smtp_server_connection *conn)
+{
+	if (conn->disconnected || conn->conn.output == NULL ||
+	    conn->conn.output->closed)
+		return;
+
+	e_debug(conn->event, "Sending replies early");
+
+	/* Write errors are not handled here, since that would tear down the
+	   connection in the middle of the caller's command processing. They
+	   are detected and handled by the normal flush callback once the
+	   ioloop runs again. */
+	smtp_server_connection_ref(conn);
+	o_stream_cork(conn->conn.output);
+	if (o_stream_flush(conn->conn.output) > 0)
+		smtp_server_connection_send_replies(conn);
+	if (!conn->corked && conn->conn.output != NULL)
+		(void)o_stream_uncork_flush(conn->conn.output);
+	smtp_server_connection_unref(&conn);
+}
+
 /*
  *
  */
@@ -464,6 +464,12 @@ void smtp_server_connection_resume(struct smtp_server_connection *conn);
 void smtp_server_connection_input_lock(struct smtp_server_connection *conn);
 void smtp_server_connection_input_unlock(struct smtp_server_connection *conn);
 
+/* Try to send all submitted, but unsent replies to the connection output.
+   Normally replies are sent from the ioloop. This can be used to send them
+   earlier when a command callback keeps processing for a long time without
+   returning to the ioloop. */
+void smtp_server_connection_flush_replies(struct smtp_server_connection *conn);
+
 void smtp_server_connection_set_streams(struct smtp_server_connection *conn,
 					struct istream *input,
 					struct ostream *output);
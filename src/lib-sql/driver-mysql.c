@@ -43,9 +43,36 @@ struct mysql_db {
 	MYSQL *mysql;
 	unsigned int next_query_connection;
 
+#ifdef MYSQL_OPT_NONBLOCK
+	/* currently running non-blocking query */
+	struct mysql_query *cur_query;
+	struct io *io;
+	struct timeout *to;
+	enum io_condition io_cond;
+	/* MYSQL_WAIT_* events the current query is waiting for */
+	int wait_status;
+#endif
+
 	bool ssl_set:1;
+	bool nonblocking:1;
 };
 
+#ifdef MYSQL_OPT_NONBLOCK
+struct mysql_query {
+	struct mysql_db *db;
+	char *query;
+	struct event *event;
+
+	sql_query_callback_t *callback;
+	void *context;
+
+	MYSQL_RES *result;
+	int error;
+	/* the query itself has finished, mysql_store_result() is running */
+	bool storing:1;
+};
+#endif
+
 struct mysql_result {
 	struct sql_result api;
 
@@ -78,6 +105,10 @@ static struct event_category event_category_mysql = {
 	.name = "mysql"
 };
 
+#ifdef MYSQL_OPT_NONBLOCK
+static void driver_mysql_async_done(struct mysql_db *db, bool failed);
+#endif
+
 static int driver_mysql_connect(struct sql_db *_db)
 {
 	struct mysql_db *db = (struct mysql_db *)_db;
@@ -120,6 +151,12 @@ static int driver_mysql_connect(struct sql_db *_db)
 	mysql_options(db->mysql, MYSQL_OPT_CONNECT_TIMEOUT, &db->connect_timeout);
 	mysql_options(db->mysql, MYSQL_OPT_READ_TIMEOUT, &db->read_timeout);
 	mysql_options(db->mysql, MYSQL_OPT_WRITE_TIMEOUT, &db->write_timeout);
+#ifdef MYSQL_OPT_NONBLOCK
+	/* Enable the client library's non-blocking API for sql_query().
+	   The blocking functions still work with it - they just run the
+	   same state machine internally. */
+	mysql_options(db->mysql, MYSQL_OPT_NONBLOCK, NULL);
+#endif
 	mysql_options(db->mysql, MYSQL_READ_DEFAULT_GROUP,
 		      db->option_group != NULL ? db->option_group : "client");
 
@@ -177,6 +214,13 @@ static int driver_mysql_connect(struct sql_db *_db)
 static void driver_mysql_disconnect(struct sql_db *_db)
 {
 	struct mysql_db *db = (struct mysql_db *)_db;
+
+#ifdef MYSQL_OPT_NONBLOCK
+	if (db->cur_query != NULL) {
+		/* abort the running non-blocking query */
+		driver_mysql_async_done(db, TRUE);
+	}
+#endif
 	if (db->mysql != NULL)
 		mysql_close(db->mysql);
 	db->mysql = NULL;
@@ -306,6 +350,10 @@ static int driver_mysql_init_full_v(const struct sql_settings *set,
 		return ret;
 	}
 
+#ifdef MYSQL_OPT_NONBLOCK
+	db->nonblocking = TRUE;
+#endif
+
 	*db_r = &db->api;
 	return 0;
 }
@@ -317,6 +365,12 @@ static void driver_mysql_deinit_v(struct sql_db *_db)
 	_db->no_reconnect = TRUE;
 	sql_db_set_state(&db->api, SQL_DB_STATE_DISCONNECTED);
 
+#ifdef MYSQL_OPT_NONBLOCK
+	if (db->cur_query != NULL) {
+		/* abort the running non-blocking query */
+		driver_mysql_async_done(db, TRUE);
+	}
+#endif
 	if (db->mysql != NULL)
 		mysql_close(db->mysql);
 	db->mysql = NULL;
@@ -391,6 +445,197 @@ driver_mysql_escape_string(struct sql_db *_db, const char *string)
 	return to;
 }
 
+#ifdef MYSQL_OPT_NONBLOCK
+static void driver_mysql_async_step(struct mysql_db *db, int events);
+
+static void driver_mysql_async_io(struct mysql_db *db)
+{
+	driver_mysql_async_step(db, db->wait_status &
+				(MYSQL_WAIT_READ | MYSQL_WAIT_WRITE));
+}
+
+static void driver_mysql_async_timeout(struct mysql_db *db)
+{
+	driver_mysql_async_step(db, MYSQL_WAIT_TIMEOUT);
+}
+
+static void driver_mysql_async_wait(struct mysql_db *db, int status)
+{
+	enum io_condition cond = 0;
+
+	db->wait_status = status;
+	if ((status & MYSQL_WAIT_READ) != 0)
+		cond |= IO_READ;
+	if ((status & MYSQL_WAIT_WRITE) != 0)
+		cond |= IO_WRITE;
+	if (db->io != NULL && db->io_cond != cond)
+		io_remove(&db->io);
+	if (db->io == NULL && cond != 0) {
+		db->io = io_add(mysql_get_socket(db->mysql), cond,
+				driver_mysql_async_io, db);
+		db->io_cond = cond;
+	}
+	if ((status & MYSQL_WAIT_TIMEOUT) != 0) {
+		db->to = timeout_add(mysql_get_timeout_value_ms(db->mysql),
+				     driver_mysql_async_timeout, db);
+	}
+}
+
+static void driver_mysql_async_done(struct mysql_db *db, bool failed)
+{
+	struct mysql_query *query = db->cur_query;
+	struct mysql_result *result;
+
+	db->cur_query = NULL;
+	io_remove(&db->io);
+	timeout_remove(&db->to);
+
+	result = i_new(struct mysql_result, 1);
+	result->api = failed ? driver_mysql_error_result : driver_mysql_result;
+	if (!failed) {
+		result->affected_rows = mysql_affected_rows(db->mysql);
+		result->result = query->result;
+		db->last_success = ioloop_time;
+	} else if (query->result != NULL) {
+		mysql_free_result(query->result);
+	}
+	result->api.db = &db->api;
+	result->api.refcount = 1;
+	result->api.event = query->event;
+
+	if (db->api.state == SQL_DB_STATE_BUSY)
+		sql_db_set_state(&db->api, SQL_DB_STATE_IDLE);
+
+	result->api.callback = TRUE;
+	query->callback(&result->api, query->context);
+	result->api.callback = FALSE;
+	sql_result_unref(&result->api);
+
+	i_free(query->query);
+	i_free(query);
+}
+
+static void driver_mysql_async_query_sent(struct mysql_db *db)
+{
+	struct mysql_query *query = db->cur_query;
+	struct event_passthrough *e;
+	int diff;
+
+	io_loop_time_refresh();
+	e = sql_query_finished_event(&db->api, query->event, query->query,
+				     query->error == 0, &diff);
+	if (query->error == 0) {
+		e_debug(e->event(), SQL_QUERY_FINISHED_FMT, query->query, diff);
+		return;
+	}
+
+	e->add_int("error_code", mysql_errno(db->mysql));
+	e->add_str("error", mysql_error(db->mysql));
+	e_debug(e->event(), SQL_QUERY_FINISHED_FMT": %s", query->query,
+		diff, mysql_error(db->mysql));
+
+	switch (mysql_errno(db->mysql)) {
+	case CR_SERVER_GONE_ERROR:
+	case CR_SERVER_LOST:
+		sql_db_set_state(&db->api, SQL_DB_STATE_DISCONNECTED);
+		break;
+	default:
+		break;
+	}
+}
+
+static void driver_mysql_async_store_finished(struct mysql_db *db)
+{
+	struct mysql_query *query = db->cur_query;
+	int ret;
+
+#ifdef CLIENT_MULTI_RESULTS
+	/* Because we've enabled CLIENT_MULTI_RESULTS, we need to read
+	   (ignore) extra results - there should not be any, so the blocking
+	   calls return immediately.
+	   ret is: -1 = done, >0 = error, 0 = more results. */
+	while ((ret = mysql_next_result(db->mysql)) == 0) ;
+#else
+	ret = -1;
+#endif
+	if (ret < 0 &&
+	    (query->result != NULL || mysql_errno(db->mysql) == 0))
+		driver_mysql_async_done(db, FALSE);
+	else
+		driver_mysql_async_done(db, TRUE);
+}
+
+static void driver_mysql_async_query_finished(struct mysql_db *db)
+{
+	struct mysql_query *query = db->cur_query;
+	int status;
+
+	driver_mysql_async_query_sent(db);
+	if (query->error != 0) {
+		driver_mysql_async_done(db, TRUE);
+		return;
+	}
+
+	query->storing = TRUE;
+	status = mysql_store_result_start(&query->result, db->mysql);
+	if (status != 0)
+		driver_mysql_async_wait(db, status);
+	else
+		driver_mysql_async_store_finished(db);
+}
+
+static void driver_mysql_async_step(struct mysql_db *db, int events)
+{
+	struct mysql_query *query = db->cur_query;
+	int status;
+
+	i_assert(query != NULL);
+
+	timeout_remove(&db->to);
+	if (!query->storing) {
+		status = mysql_real_query_cont(&query->error, db->mysql,
+					       events);
+		if (status != 0)
+			driver_mysql_async_wait(db, status);
+		else
+			driver_mysql_async_query_finished(db);
+	} else {
+		status = mysql_store_result_cont(&query->result, db->mysql,
+						 events);
+		if (status != 0)
+			driver_mysql_async_wait(db, status);
+		else
+			driver_mysql_async_store_finished(db);
+	}
+}
+
+static void driver_mysql_query_async(struct mysql_db *db, const char *query,
+				     sql_query_callback_t *callback,
+				     void *context)
+{
+	struct mysql_query *mquery;
+	int status;
+
+	i_assert(db->cur_query == NULL);
+
+	mquery = i_new(struct mysql_query, 1);
+	mquery->db = db;
+	mquery->query = i_strdup(query);
+	mquery->event = event_create(db->api.event);
+	mquery->callback = callback;
+	mquery->context = context;
+	db->cur_query = mquery;
+
+	sql_db_set_state(&db->api, SQL_DB_STATE_BUSY);
+	status = mysql_real_query_start(&mquery->error, db->mysql,
+					mquery->query, strlen(mquery->query));
+	if (status != 0)
+		driver_mysql_async_wait(db, status);
+	else
+		driver_mysql_async_query_finished(db);
+}
+#endif
+
 static void driver_mysql_exec(struct sql_db *_db, const char *query)
 {
 	struct mysql_db *db = (struct mysql_db *)_db;
@@ -406,6 +651,16 @@ static void driver_mysql_query(struct sql_db *db, const char *query,
 {
 	struct sql_result *result;
 
+#ifdef MYSQL_OPT_NONBLOCK
+	struct mysql_db *mdb = (struct mysql_db *)db;
+
+	if (mdb->nonblocking && SQL_DB_IS_READY(db)) {
+		driver_mysql_query_async(mdb, query, callback, context);
+		return;
+	}
+	/* not connected yet (or non-blocking API disabled) - fallback to
+	   the blocking query */
+#endif
 	result = sql_query_s(db, query);
 	result->callback = TRUE;
 	callback(result, context);
@@ -752,6 +1007,18 @@ driver_mysql_update(struct sql_transaction_context *_ctx, const char *query,
 				  query, affected_rows);
 }
 
+static enum sql_db_flags driver_mysql_get_flags(struct sql_db *_db)
+{
+	struct mysql_db *db = (struct mysql_db *)_db;
+
+	if (db->nonblocking) {
+		/* sql_query() is non-blocking, so the callers don't need to
+		   delegate the queries to worker processes */
+		return _db->flags & ENUM_NEGATE(SQL_DB_FLAG_BLOCKING);
+	}
+	return _db->flags;
+}
+
 static const char *
 driver_mysql_escape_blob(struct sql_db *_db ATTR_UNUSED,
 			 const unsigned char *data, size_t size)
@@ -772,6 +1039,7 @@ const struct sql_db driver_mysql_db = {
 	.v = {
 		.init_full = driver_mysql_init_full_v,
 		.deinit = driver_mysql_deinit_v,
+		.get_flags = driver_mysql_get_flags,
 		.connect = driver_mysql_connect,
 		.disconnect = driver_mysql_disconnect,
 		.escape_string = driver_mysql_escape_string,
@@ -2,7 +2,10 @@
 
 #include "lib.h"
 #include "str.h"
+#include "hash.h"
 #include "hex-binary.h"
+#include "hmac.h"
+#include "sha2.h"
 #include "safe-memset.h"
 #include "iostream-openssl.h"
 #include "dovecot-openssl-common.h"
@@ -15,7 +18,14 @@
 #include <openssl/pem.h>
 #include <openssl/ssl.h>
 #include <openssl/err.h>
+#include <openssl/rand.h>
+#ifdef HAVE_SSL_CTX_set_tlsext_ticket_key_evp_cb
+#  include <openssl/params.h>
+#  include <openssl/core_names.h>
+#endif
 #include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #ifndef HAVE_EVP_PKEY_get0_DH
 #  define EVP_PKEY_get0_DH(x) ((x)->pkey.dh)
@@ -750,6 +760,32 @@ ssl_iostream_context_init_common(struct ssl_iostream_context *ctx,
 	return ssl_iostream_context_set(ctx, set, error_r);
 }
 
+static int openssl_iostream_new_session_callback(SSL *ssl, SSL_SESSION *session)
+{
+	struct ssl_iostream *ssl_io =
+		SSL_get_ex_data(ssl, dovecot_ssl_extdata_index);
+	struct ssl_iostream_context *ctx = ssl_io->ctx;
+	char *key;
+	SSL_SESSION *old_session;
+
+	if (ssl_io->connected_host == NULL)
+		return 0;
+
+	/* TLSv1.3 servers send (multiple) single-use tickets - each new one
+	   replaces whatever was cached for the host earlier. */
+	if (hash_table_lookup_full(ctx->client_sessions,
+				   ssl_io->connected_host,
+				   &key, &old_session)) {
+		SSL_SESSION_free(old_session);
+		hash_table_update(ctx->client_sessions, key, session);
+	} else {
+		hash_table_insert(ctx->client_sessions,
+				  i_strdup(ssl_io->connected_host), session);
+	}
+	/* returning 1 means we now own the session reference */
+	return 1;
+}
+
 int openssl_iostream_context_init_client(const struct ssl_iostream_settings *set,
 					 struct ssl_iostream_context **ctx_r,
 					 const char **error_r)
@@ -763,11 +799,20 @@ int openssl_iostream_context_init_client(const struct ssl_iostream_settings *set
 		return -1;
 	}
 	SSL_CTX_set_mode(ssl_ctx, SSL_MODE_ENABLE_PARTIAL_WRITE);
+	/* Cache sessions ourselves, keyed by host, so reconnections to the
+	   same host can use an abbreviated handshake. OpenSSL's internal
+	   client cache isn't usable, since it can be looked up only by
+	   session ID, which the client doesn't know in advance. */
+	SSL_CTX_set_session_cache_mode(ssl_ctx, SSL_SESS_CACHE_CLIENT |
+				       SSL_SESS_CACHE_NO_INTERNAL);
+	SSL_CTX_sess_set_new_cb(ssl_ctx, openssl_iostream_new_session_callback);
 
 	ctx = i_new(struct ssl_iostream_context, 1);
 	ctx->refcount = 1;
 	ctx->ssl_ctx = ssl_ctx;
 	ctx->client_ctx = TRUE;
+	hash_table_create(&ctx->client_sessions, default_pool, 0,
+			  str_hash, strcmp);
 	if (ssl_iostream_context_init_common(ctx, set, error_r) < 0) {
 		ssl_iostream_context_unref(&ctx);
 		return -1;
@@ -776,6 +821,194 @@ int openssl_iostream_context_init_client(const struct ssl_iostream_settings *set
 	return 0;
 }
 
+#if defined(HAVE_SSL_CTX_set_tlsext_ticket_key_evp_cb) || \
+	defined(SSL_CTX_set_tlsext_ticket_key_cb)
+
+/* Session ticket keys are derived from the master secret and the current
+   time interval, so every process (and host) sharing the same
+   ticket_key_file accepts each others' tickets and rotates the keys in
+   lockstep without any IPC. Tickets encrypted with the previous interval's
+   key are still accepted, but get renewed with the current key. */
+#define SSL_TICKET_KEY_ROTATION_SECS (4*60*60)
+/* refuse to derive keys from trivially short secrets */
+#define SSL_TICKET_KEY_FILE_MIN_SIZE 32
+
+struct openssl_ticket_key {
+	unsigned char name[16];
+	unsigned char aes_key[32];
+	unsigned char hmac_key[32];
+};
+
+static void
+openssl_iostream_ticket_key_part(const struct ssl_iostream_context *ctx,
+				 uint64_t interval, const char *label,
+				 unsigned char *part, size_t part_size)
+{
+	struct hmac_context hmac;
+	unsigned char num[8], digest[SHA256_RESULTLEN];
+	unsigned int i;
+
+	i_assert(part_size <= sizeof(digest));
+
+	/* big-endian interval so derived keys match across hosts regardless
+	   of their endianness */
+	for (i = 0; i < sizeof(num); i++)
+		num[i] = (interval >> (56 - i*8)) & 0xff;
+
+	hmac_init(&hmac, ctx->ticket_master_key,
+		  sizeof(ctx->ticket_master_key), &hash_method_sha256);
+	hmac_update(&hmac, label, strlen(label));
+	hmac_update(&hmac, num, sizeof(num));
+	hmac_final(&hmac, digest);
+	memcpy(part, digest, part_size);
+	safe_memset(digest, 0, sizeof(digest));
+}
+
+static void
+openssl_iostream_ticket_key_get(const struct ssl_iostream_context *ctx,
+				uint64_t interval,
+				struct openssl_ticket_key *key_r)
+{
+	openssl_iostream_ticket_key_part(ctx, interval, "name",
+					 key_r->name, sizeof(key_r->name));
+	openssl_iostream_ticket_key_part(ctx, interval, "aes",
+					 key_r->aes_key,
+					 sizeof(key_r->aes_key));
+	openssl_iostream_ticket_key_part(ctx, interval, "hmac",
+					 key_r->hmac_key,
+					 sizeof(key_r->hmac_key));
+}
+
+/* Returns 1 if key_r is the current key, 2 if it's the previous one (the
+   ticket works, but should be renewed), 0 if key_name is unknown. With
+   enc=1 key_name is ignored and the current key is returned. */
+static int
+openssl_iostream_ticket_key_lookup(const struct ssl_iostream_context *ctx,
+				   int enc, const unsigned char key_name[16],
+				   struct openssl_ticket_key *key_r)
+{
+	uint64_t interval = (uint64_t)time(NULL) / SSL_TICKET_KEY_ROTATION_SECS;
+
+	openssl_iostream_ticket_key_get(ctx, interval, key_r);
+	if (enc != 0)
+		return 1;
+	if (memcmp(key_name, key_r->name, sizeof(key_r->name)) == 0)
+		return 1;
+	openssl_iostream_ticket_key_get(ctx, interval - 1, key_r);
+	if (memcmp(key_name, key_r->name, sizeof(key_r->name)) == 0)
+		return 2;
+	safe_memset(key_r, 0, sizeof(*key_r));
+	return 0;
+}
+
+#ifdef HAVE_SSL_CTX_set_tlsext_ticket_key_evp_cb
+static int
+openssl_iostream_ticket_key_callback(SSL *ssl, unsigned char key_name[16],
+				     unsigned char iv[EVP_MAX_IV_LENGTH],
+				     EVP_CIPHER_CTX *ectx, EVP_MAC_CTX *hctx,
+				     int enc)
+#else
+static int
+openssl_iostream_ticket_key_callback(SSL *ssl, unsigned char key_name[16],
+				     unsigned char iv[EVP_MAX_IV_LENGTH],
+				     EVP_CIPHER_CTX *ectx, HMAC_CTX *hctx,
+				     int enc)
+#endif
+{
+	struct ssl_iostream *ssl_io =
+		SSL_get_ex_data(ssl, dovecot_ssl_extdata_index);
+	const struct ssl_iostream_context *ctx = ssl_io->ctx;
+	struct openssl_ticket_key key;
+	int ret;
+
+	ret = openssl_iostream_ticket_key_lookup(ctx, enc, key_name, &key);
+	if (ret == 0)
+		return 0;
+
+	if (enc != 0) {
+		memcpy(key_name, key.name, sizeof(key.name));
+		if (RAND_bytes(iv, EVP_MAX_IV_LENGTH) != 1 ||
+		    EVP_EncryptInit_ex(ectx, EVP_aes_256_cbc(), NULL,
+				       key.aes_key, iv) != 1)
+			ret = -1;
+	} else {
+		if (EVP_DecryptInit_ex(ectx, EVP_aes_256_cbc(), NULL,
+				       key.aes_key, iv) != 1)
+			ret = -1;
+	}
+	if (ret > 0) {
+#ifdef HAVE_SSL_CTX_set_tlsext_ticket_key_evp_cb
+		OSSL_PARAM params[3];
+
+		params[0] = OSSL_PARAM_construct_octet_string(
+			OSSL_MAC_PARAM_KEY, key.hmac_key,
+			sizeof(key.hmac_key));
+		params[1] = OSSL_PARAM_construct_utf8_string(
+			OSSL_MAC_PARAM_DIGEST, "sha256", 0);
+		params[2] = OSSL_PARAM_construct_end();
+		if (EVP_MAC_CTX_set_params(hctx, params) != 1)
+			ret = -1;
+#else
+		if (HMAC_Init_ex(hctx, key.hmac_key, sizeof(key.hmac_key),
+				 EVP_sha256(), NULL) != 1)
+			ret = -1;
+#endif
+	}
+	safe_memset(&key, 0, sizeof(key));
+	return ret;
+}
+
+static int
+openssl_iostream_ticket_keys_init(struct ssl_iostream_context *ctx,
+				  const struct ssl_iostream_settings *set,
+				  const char **error_r)
+{
+	unsigned char buf[1024];
+	ssize_t ret;
+	int fd;
+
+	fd = open(set->ticket_key_file, O_RDONLY);
+	if (fd == -1) {
+		*error_r = t_strdup_printf("open(%s) failed: %m",
+					   set->ticket_key_file);
+		return -1;
+	}
+	ret = read(fd, buf, sizeof(buf));
+	if (ret < 0) {
+		*error_r = t_strdup_printf("read(%s) failed: %m",
+					   set->ticket_key_file);
+		i_close_fd(&fd);
+		return -1;
+	}
+	i_close_fd(&fd);
+	if (ret < SSL_TICKET_KEY_FILE_MIN_SIZE) {
+		*error_r = t_strdup_printf(
+			"%s is too short to be used as a ticket key secret "
+			"(%zd bytes, at least %u needed)",
+			set->ticket_key_file, ret,
+			SSL_TICKET_KEY_FILE_MIN_SIZE);
+		return -1;
+	}
+	/* hash the contents, so the file's format doesn't matter */
+	sha256_get_digest(buf, (size_t)ret, ctx->ticket_master_key);
+	safe_memset(buf, 0, sizeof(buf));
+
+#ifdef HAVE_SSL_CTX_set_tlsext_ticket_key_evp_cb
+	if (SSL_CTX_set_tlsext_ticket_key_evp_cb(
+		ctx->ssl_ctx, openssl_iostream_ticket_key_callback) != 1) {
+#else
+	if (SSL_CTX_set_tlsext_ticket_key_cb(
+		ctx->ssl_ctx, openssl_iostream_ticket_key_callback) != 1) {
+#endif
+		*error_r = t_strdup_printf(
+			"Can't set session ticket key callback: %s",
+			openssl_iostream_error());
+		return -1;
+	}
+	return 0;
+}
+#endif
+
 int openssl_iostream_context_init_server(const struct ssl_iostream_settings *set,
 					 struct ssl_iostream_context **ctx_r,
 					 const char **error_r)
@@ -788,6 +1021,12 @@ int openssl_iostream_context_init_server(const struct ssl_iostream_settings *set
 					   openssl_iostream_error());
 		return -1;
 	}
+	/* Set a session ID context. Without it OpenSSL refuses to resume
+	   sessions for which a client certificate was requested, forcing
+	   such clients into a full handshake on every reconnection. */
+	static const unsigned char session_id_context[] = "dovecot";
+	SSL_CTX_set_session_id_context(ssl_ctx, session_id_context,
+				       sizeof(session_id_context) - 1);
 
 	ctx = i_new(struct ssl_iostream_context, 1);
 	ctx->refcount = 1;
@@ -796,6 +1035,17 @@ int openssl_iostream_context_init_server(const struct ssl_iostream_settings *set
 		ssl_iostream_context_unref(&ctx);
 		return -1;
 	}
+#if defined(HAVE_SSL_CTX_set_tlsext_ticket_key_evp_cb) || \
+	defined(SSL_CTX_set_tlsext_ticket_key_cb)
+	if (ctx->set.tickets && ctx->set.ticket_key_file != NULL &&
+	    *ctx->set.ticket_key_file != '\0') {
+		if (openssl_iostream_ticket_keys_init(ctx, &ctx->set,
+						      error_r) < 0) {
+			ssl_iostream_context_unref(&ctx);
+			return -1;
+		}
+	}
+#endif
 	*ctx_r = ctx;
 	return 0;
 }
@@ -812,7 +1062,22 @@ void openssl_iostream_context_unref(struct ssl_iostream_context *ctx)
 	if (--ctx->refcount > 0)
 		return;
 
+	if (hash_table_is_created(ctx->client_sessions)) {
+		struct hash_iterate_context *iter;
+		char *key;
+		SSL_SESSION *session;
+
+		iter = hash_table_iterate_init(ctx->client_sessions);
+		while (hash_table_iterate(iter, ctx->client_sessions,
+					  &key, &session)) {
+			SSL_SESSION_free(session);
+			i_free(key);
+		}
+		hash_table_iterate_deinit(&iter);
+		hash_table_destroy(&ctx->client_sessions);
+	}
 	SSL_CTX_free(ctx->ssl_ctx);
+	safe_memset(ctx->ticket_master_key, 0, sizeof(ctx->ticket_master_key));
 	pool_unref(&ctx->pool);
 	i_free(ctx);
 }
@@ -1,6 +1,7 @@
 /* Copyright (c) 2009-2018 Dovecot authors, see the included COPYING file */
 
 #include "lib.h"
+#include "hash.h"
 #include "istream-private.h"
 #include "ostream-private.h"
 #include "iostream-openssl.h"
@@ -329,6 +330,17 @@ openssl_iostream_create(struct ssl_iostream_context *ctx,
         SSL_set_ex_data(ssl_io->ssl, dovecot_ssl_extdata_index, ssl_io);
 	SSL_set_tlsext_host_name(ssl_io->ssl, host);
 
+	if (client && host != NULL &&
+	    hash_table_is_created(ctx->client_sessions)) {
+		/* Try to resume an earlier session to the same host. If the
+		   server doesn't accept it, the handshake transparently falls
+		   back to a full one. */
+		SSL_SESSION *session =
+			hash_table_lookup(ctx->client_sessions, host);
+		if (session != NULL)
+			(void)SSL_set_session(ssl_io->ssl, session);
+	}
+
 	if (openssl_iostream_set(ssl_io, set, error_r) < 0) {
 		openssl_iostream_free(ssl_io);
 		return -1;
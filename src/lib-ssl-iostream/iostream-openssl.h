@@ -23,6 +23,14 @@ struct ssl_iostream_context {
 	pool_t pool;
 	struct ssl_iostream_settings set;
 
+	/* SSL clients: sessions cached for resumption, keyed by the host
+	   that was connected to */
+	HASH_TABLE(char *, SSL_SESSION *) client_sessions;
+
+	/* SSL servers: SHA256 of ticket_key_file contents, used for deriving
+	   the rotating session ticket keys */
+	unsigned char ticket_master_key[32];
+
 	int username_nid;
 
 	bool client_ctx:1;
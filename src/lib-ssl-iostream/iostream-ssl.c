@@ -22,6 +22,7 @@ static const size_t ssl_iostream_settings_string_offsets[] = {
 	OFFSET(dh),
 	OFFSET(cert_username_field),
 	OFFSET(crypto_device),
+	OFFSET(ticket_key_file),
 };
 
 static bool ssl_module_loaded = FALSE;
@@ -26,6 +26,12 @@ struct ssl_iostream_settings {
 	const char *dh; /* context-only */
 	const char *cert_username_field; /* both */
 	const char *crypto_device; /* context-only */
+	/* Path to a file containing secret material for deriving TLS session
+	   ticket keys. When all server processes (even on different hosts)
+	   point to the same file, they accept each others' tickets and
+	   rotate the keys in lockstep, so session resumption works no matter
+	   which process the client's reconnection lands on. */
+	const char *ticket_key_file; /* server context-only */
 
 	bool verbose, verbose_invalid_cert; /* stream-only */
 	bool skip_crl_check; /* context-only */
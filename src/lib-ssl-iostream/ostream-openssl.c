@@ -145,6 +145,59 @@ static int o_stream_ssl_flush_buffer(struct ssl_ostream *sstream)
 	return ret <= 0 ? ret : 1;
 }
 
+static ssize_t
+o_stream_ssl_send_direct(struct ssl_ostream *sstream,
+			 const struct const_iovec *iov,
+			 unsigned int iov_count)
+{
+	struct ssl_iostream *ssl_io = sstream->ssl_io;
+	size_t pos, sent = 0;
+	unsigned int i;
+	int ret = 1;
+
+	for (i = 0; i < iov_count && ret > 0; i++) {
+		pos = 0;
+		while (pos < iov[i].iov_len) {
+			ret = SSL_write(ssl_io->ssl,
+					CONST_PTR_OFFSET(iov[i].iov_base, pos),
+					iov[i].iov_len - pos);
+			if (ret <= 0) {
+				ret = openssl_iostream_handle_error(
+					ssl_io, ret,
+					OPENSSL_IOSTREAM_SYNC_TYPE_WRITE,
+					"SSL_write");
+				if (ret < 0) {
+					io_stream_set_error(
+						&sstream->ostream.iostream,
+						"%s", ssl_io->last_error);
+					sstream->ostream.ostream.stream_errno =
+						errno;
+					return -1;
+				}
+				if (ret == 0)
+					break;
+			} else {
+				pos += ret;
+				sent += ret;
+				ret = openssl_iostream_bio_sync(
+					ssl_io, OPENSSL_IOSTREAM_SYNC_TYPE_WRITE);
+				if (ret < 0) {
+					i_assert(ssl_io->plain_stream_errstr != NULL &&
+						 ssl_io->plain_stream_errno != 0);
+					io_stream_set_error(
+						&sstream->ostream.iostream,
+						"%s", ssl_io->plain_stream_errstr);
+					sstream->ostream.ostream.stream_errno =
+						ssl_io->plain_stream_errno;
+					return -1;
+				}
+				ret = 1;
+			}
+		}
+	}
+	return sent;
+}
+
 static int o_stream_ssl_flush(struct ostream_private *stream)
 {
 	struct ssl_ostream *sstream = (struct ssl_ostream *)stream;
@@ -214,9 +267,21 @@ o_stream_ssl_sendv(struct ostream_private *stream,
 {
 	struct ssl_ostream *sstream = (struct ssl_ostream *)stream;
 	size_t bytes_sent = 0;
+	ssize_t sent;
 
 	i_assert(!sstream->shutdown);
 
+	if (sstream->ssl_io->handshaked &&
+	    (sstream->buffer == NULL || sstream->buffer->used == 0)) {
+		/* nothing is buffered - encrypt directly from the caller's
+		   iovecs instead of copying everything through our buffer
+		   first. whatever can't be written right now gets buffered
+		   below. */
+		sent = o_stream_ssl_send_direct(sstream, iov, iov_count);
+		if (sent < 0)
+			return -1;
+		bytes_sent = sent;
+	}
 	bytes_sent = o_stream_ssl_buffer(sstream, iov, iov_count, bytes_sent);
 	if (sstream->ssl_io->handshaked &&
 	    sstream->buffer->used == bytes_sent) {
@@ -130,6 +130,9 @@ struct dbox_file_append_context {
 
 	uoff_t first_append_offset, last_checkpoint_offset, last_flush_offset;
 	struct ostream *output;
+
+	/* fsyncing is done later in one batch by the caller */
+	bool no_fsync:1;
 };
 
 #define dbox_file_is_open(file) ((file)->fd != -1)
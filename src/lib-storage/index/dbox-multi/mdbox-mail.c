@@ -226,6 +226,54 @@ mdbox_mail_get_special(struct mail *_mail, enum mail_fetch_field field,
 	return dbox_mail_get_special(_mail, field, value_r);
 }
 
+static bool mdbox_mail_prefetch(struct mail *_mail)
+{
+	struct index_mail *mail = INDEX_MAIL(_mail);
+/* HAVE_POSIX_FADVISE alone isn't enough for CentOS 4.9 */
+#if defined(HAVE_POSIX_FADVISE) && defined(POSIX_FADV_WILLNEED)
+	struct istream *input;
+	uoff_t offset, size;
+	off_t len;
+	int fd;
+
+	if (mail->data.access_part == 0) {
+		/* everything we need is cached */
+		return TRUE;
+	}
+
+	if (mail->data.stream == NULL) {
+		(void)mail_get_stream_because(_mail, NULL, NULL, "prefetch", &input);
+		if (mail->data.stream == NULL)
+			return TRUE;
+	}
+
+	/* unlike with file-per-msg storages multiple mails live in the same
+	   storage file, so tell the OS to read in only this mail's byte
+	   range. the stream is a limit stream covering exactly the mail. */
+	fd = i_stream_get_fd(mail->data.stream);
+	if (fd != -1) {
+		offset = i_stream_get_absolute_offset(mail->data.stream) -
+			mail->data.stream->v_offset;
+		if ((mail->data.access_part & (READ_BODY | PARSE_BODY)) != 0) {
+			if (i_stream_get_size(mail->data.stream,
+					      FALSE, &size) > 0)
+				len = size;
+			else
+				len = MAIL_READ_FULL_BLOCK_SIZE;
+		} else {
+			len = MAIL_READ_HDR_BLOCK_SIZE;
+		}
+		if (posix_fadvise(fd, offset, len, POSIX_FADV_WILLNEED) < 0) {
+			e_error(mail_event(_mail),
+				"posix_fadvise(%s) failed: %m",
+				i_stream_get_name(mail->data.stream));
+		}
+		mail->data.prefetch_sent = TRUE;
+	}
+#endif
+	return !mail->data.prefetch_sent;
+}
+
 static void
 mdbox_mail_update_flags(struct mail *mail, enum modify_type modify_type,
 			enum mail_flags flags)
@@ -246,7 +294,7 @@ struct mail_vfuncs mdbox_mail_vfuncs = {
 	index_mail_set_seq,
 	index_mail_set_uid,
 	index_mail_set_uid_cache_updates,
-	index_mail_prefetch,
+	mdbox_mail_prefetch,
 	index_mail_precache,
 	index_mail_add_temp_wanted_fields,
 
@@ -424,6 +424,81 @@ int mdbox_map_get_file_msgs(struct mdbox_map *map, uint32_t file_id,
 	return 0;
 }
 
+struct mdbox_map_file_usage {
+	uoff_t total_size;
+	uoff_t deleted_size;
+	bool have_zero_refs;
+};
+
+static void
+mdbox_map_get_deleted_percentage_files(struct mdbox_map *map,
+				       ARRAY_TYPE(seq_range) *file_ids_r,
+				       unsigned int min_percentage)
+{
+	const struct mail_index_header *hdr;
+	const struct mdbox_map_mail_index_record *rec;
+	struct mdbox_map_file_usage *usage;
+	HASH_TABLE(void *, struct mdbox_map_file_usage *) file_usage;
+	struct hash_iterate_context *iter;
+	const uint16_t *ref16_p;
+	const void *data;
+	void *key;
+	uint32_t seq;
+	bool expunged;
+	pool_t pool;
+
+	pool = pool_alloconly_create("mdbox map file usage", 4096);
+	hash_table_create_direct(&file_usage, pool, 0);
+
+	/* count the total and deleted mail bytes in each file */
+	hdr = mail_index_get_header(map->view);
+	for (seq = 1; seq <= hdr->messages_count; seq++) {
+		mail_index_lookup_ext(map->view, seq, map->map_ext_id,
+				      &data, &expunged);
+		if (data == NULL || expunged)
+			continue;
+		rec = data;
+
+		key = POINTER_CAST(rec->file_id);
+		usage = hash_table_lookup(file_usage, key);
+		if (usage == NULL) {
+			usage = p_new(pool, struct mdbox_map_file_usage, 1);
+			hash_table_insert(file_usage, key, usage);
+		}
+		usage->total_size += rec->size;
+
+		mail_index_lookup_ext(map->view, seq, map->ref_ext_id,
+				      &data, &expunged);
+		if (data != NULL && !expunged) {
+			ref16_p = data;
+			if (*ref16_p != 0)
+				continue;
+		}
+		usage->deleted_size += rec->size;
+		usage->have_zero_refs = TRUE;
+	}
+
+	iter = hash_table_iterate_init(file_usage);
+	while (hash_table_iterate(iter, file_usage, &key, &usage)) {
+		if (!usage->have_zero_refs)
+			continue;
+		if (usage->deleted_size == usage->total_size) {
+			/* fully deleted - the file can be unlinked without
+			   copying anything, so ignore the threshold */
+		} else if (usage->deleted_size * 100 <
+			   usage->total_size * min_percentage) {
+			/* not enough deleted space yet to be worth
+			   rewriting the file */
+			continue;
+		}
+		seq_range_array_add(file_ids_r,
+				    POINTER_CAST_TO(key, uint32_t));
+	}
+	hash_table_iterate_deinit(&iter);
+	hash_table_destroy(&file_usage);
+	pool_unref(&pool);
+}
+
 int mdbox_map_get_zero_ref_files(struct mdbox_map *map,
 				 ARRAY_TYPE(seq_range) *file_ids_r)
 {
@@ -442,6 +517,14 @@ int mdbox_map_get_zero_ref_files(struct mdbox_map *map,
 	if (mdbox_map_refresh(map) < 0)
 		return -1;
 
+	if (map->set->mdbox_purge_min_percentage > 0) {
+		/* rewrite a file only after enough of it consists of
+		   deleted mails */
+		mdbox_map_get_deleted_percentage_files(map, file_ids_r,
+			map->set->mdbox_purge_min_percentage);
+		return 0;
+	}
+
 	hdr = mail_index_get_header(map->view);
 	for (seq = 1; seq <= hdr->messages_count; seq++) {
 		mail_index_lookup_ext(map->view, seq, map->ref_ext_id,
@@ -1220,6 +1303,16 @@ mdbox_map_assign_file_ids(struct mdbox_map_append_context *ctx,
 	struct mdbox_map_mail_index_header hdr;
 	uint32_t first_file_id, file_id, existing_id;
 
+	/* flush the mail data writes (and fsync with fsync=optimized) while
+	   the map is still unlocked. the callers have typically flushed
+	   already, making this a no-op, but if not we don't want to be
+	   holding the map lock during the writes. */
+	file_appends = array_get(&ctx->file_appends, &count);
+	for (i = 0; i < count; i++) {
+		if (dbox_file_append_flush(file_appends[i]) < 0)
+			return -1;
+	}
+
 	/* start the syncing. we'll need it even if there are no file ids to
 	   be assigned. */
 	if (mdbox_map_atomic_lock(ctx->atomic, reason) < 0)
@@ -1241,14 +1334,10 @@ mdbox_map_assign_file_ids(struct mdbox_map_append_context *ctx,
 
 	/* assign file_ids for newly created files */
 	first_file_id = file_id;
-	file_appends = array_get(&ctx->file_appends, &count);
 	for (i = 0; i < count; i++) {
 		struct mdbox_file *mfile =
 			(struct mdbox_file *)file_appends[i]->file;
 
-		if (dbox_file_append_flush(file_appends[i]) < 0)
-			return -1;
-
 		if (mfile->file_id == 0) {
 			if (mdbox_file_assign_file_id(mfile, file_id++) < 0)
 				return -1;
@@ -3,6 +3,7 @@
 #include "lib.h"
 #include "array.h"
 #include "fdatasync-path.h"
+#include "file-set-size.h"
 #include "hex-binary.h"
 #include "hex-dec.h"
 #include "str.h"
@@ -98,6 +99,38 @@ void sdbox_save_add_file(struct mail_save_context *_ctx, struct dbox_file *file)
 	array_push_back(&ctx->files, &file);
 }
 
+static void
+sdbox_save_preallocate(struct sdbox_save_context *ctx, struct dbox_file *file,
+		       struct istream *input)
+{
+	struct sdbox_storage *storage = ctx->mbox->storage;
+	uoff_t size;
+	int ret;
+
+	if (i_stream_get_size(input, FALSE, &size) <= 0 || size == 0)
+		return;
+
+	/* the final file also has the file/message headers and metadata,
+	   but for preallocation purposes the mail size is close enough. */
+	ret = file_preallocate(file->fd, size);
+	if (ret < 0) {
+		switch (errno) {
+		case ENOSPC:
+		case EDQUOT:
+			/* ignore */
+			break;
+		default:
+			e_error(storage->storage.storage.event,
+				"file_preallocate(%s) failed: %m",
+				file->cur_path);
+			break;
+		}
+	} else if (ret == 0) {
+		/* not supported by filesystem, disable. */
+		storage->preallocate_space = FALSE;
+	}
+}
+
 int sdbox_save_begin(struct mail_save_context *_ctx, struct istream *input)
 {
 	struct sdbox_save_context *ctx = SDBOX_SAVECTX(_ctx);
@@ -106,6 +139,10 @@ int sdbox_save_begin(struct mail_save_context *_ctx, struct istream *input)
 
 	file = sdbox_file_create(ctx->mbox);
 	ctx->append_ctx = dbox_file_append_init(file);
+	/* all the files written by this transaction are fsynced in one batch
+	   in commit_pre(), so e.g. MULTIAPPEND doesn't wait for the disk
+	   after each message. */
+	ctx->append_ctx->no_fsync = TRUE;
 	ret = dbox_file_get_append_stream(ctx->append_ctx,
 					  &ctx->ctx.dbox_output);
 	if (ret <= 0) {
@@ -115,6 +152,8 @@ int sdbox_save_begin(struct mail_save_context *_ctx, struct istream *input)
 		ctx->ctx.failed = TRUE;
 		return -1;
 	}
+	if (ctx->mbox->storage->preallocate_space)
+		sdbox_save_preallocate(ctx, file, input);
 	ctx->cur_file = file;
 	dbox_save_begin(&ctx->ctx, input);
 
@@ -291,6 +330,25 @@ int sdbox_transaction_save_commit_pre(struct mail_save_context *_ctx)
 		return 0;
 	}
 
+	if (ctx->mbox->box.storage->set->parsed_fsync_mode !=
+	    FSYNC_MODE_NEVER) {
+		/* the per-message fsyncs were skipped while saving. flush
+		   everything now in one batch, before the index starts
+		   referring to the mails, so the disk can order the writes
+		   itself. */
+		struct dbox_file *file;
+
+		array_foreach_elem(&ctx->files, file) {
+			if (fdatasync_path(file->cur_path) < 0) {
+				mail_set_critical(_ctx->dest_mail,
+					"fdatasync_path(%s) failed: %m",
+					file->cur_path);
+				sdbox_transaction_save_rollback(_ctx);
+				return -1;
+			}
+		}
+	}
+
 	if (sdbox_sync_begin(ctx->mbox, SDBOX_SYNC_FLAG_FORCE |
 			     SDBOX_SYNC_FLAG_FSYNC, &ctx->sync_ctx) < 0) {
 		sdbox_transaction_save_rollback(_ctx);
@@ -0,0 +1,39 @@
+/* Copyright (c) 2006-2018 Dovecot authors, see the included COPYING file */
+
+#include "lib.h"
+#include "settings-parser.h"
+#include "mail-storage-settings.h"
+#include "sdbox-settings.h"
+
+#include <stddef.h>
+
+#undef DEF
+#define DEF(type, name) \
+	SETTING_DEFINE_STRUCT_##type(#name, name, struct sdbox_settings)
+
+static const struct setting_define sdbox_setting_defines[] = {
+	DEF(BOOL, sdbox_preallocate_space),
+
+	SETTING_DEFINE_LIST_END
+};
+
+static const struct sdbox_settings sdbox_default_settings = {
+	.sdbox_preallocate_space = FALSE
+};
+
+static const struct setting_parser_info sdbox_setting_parser_info = {
+	.module_name = "sdbox",
+	.defines = sdbox_setting_defines,
+	.defaults = &sdbox_default_settings,
+
+	.type_offset = SIZE_MAX,
+	.struct_size = sizeof(struct sdbox_settings),
+
+	.parent_offset = SIZE_MAX,
+	.parent = &mail_user_setting_parser_info
+};
+
+const struct setting_parser_info *sdbox_get_setting_parser_info(void)
+{
+	return &sdbox_setting_parser_info;
+}
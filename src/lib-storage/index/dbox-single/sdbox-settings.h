@@ -0,0 +1,10 @@
+#ifndef SDBOX_SETTINGS_H
+#define SDBOX_SETTINGS_H
+
+struct sdbox_settings {
+	bool sdbox_preallocate_space;
+};
+
+const struct setting_parser_info *sdbox_get_setting_parser_info(void);
+
+#endif
@@ -3,6 +3,7 @@
 #include "lib.h"
 #include "fs-api.h"
 #include "master-service.h"
+#include "settings-parser.h"
 #include "mail-index-modseq.h"
 #include "mail-search-build.h"
 #include "mailbox-list-private.h"
@@ -39,9 +40,14 @@ static int sdbox_storage_create(struct mail_storage *_storage,
 				struct mail_namespace *ns,
 				const char **error_r)
 {
+	struct sdbox_storage *sstorage = SDBOX_STORAGE(_storage);
 	struct dbox_storage *storage = DBOX_STORAGE(_storage);
 	enum fs_properties props;
 
+	sstorage->set = settings_parser_get_root_set(_storage->user->set_parser,
+		sdbox_get_setting_parser_info());
+	sstorage->preallocate_space = sstorage->set->sdbox_preallocate_space;
+
 	if (dbox_storage_create(_storage, ns, error_r) < 0)
 		return -1;
 
@@ -447,7 +453,7 @@ struct mail_storage sdbox_storage = {
 	.event_category = &event_category_sdbox,
 
 	.v = {
-                NULL,
+                sdbox_get_setting_parser_info,
 		sdbox_storage_alloc,
 		sdbox_storage_create,
 		dbox_storage_destroy,
@@ -466,7 +472,7 @@ struct mail_storage dbox_storage = {
 	.event_category = &event_category_sdbox,
 
 	.v = {
-		NULL,
+		sdbox_get_setting_parser_info,
 		sdbox_storage_alloc,
 		sdbox_storage_create,
 		dbox_storage_destroy,
@@ -3,6 +3,7 @@
 
 #include "index-storage.h"
 #include "dbox-storage.h"
+#include "sdbox-settings.h"
 
 #define SDBOX_STORAGE_NAME "sdbox"
 #define SDBOX_MAIL_FILE_PREFIX "u."
@@ -19,6 +20,10 @@ struct sdbox_index_header {
 
 struct sdbox_storage {
 	struct dbox_storage storage;
+	const struct sdbox_settings *set;
+
+	/* if saving a mail with a known size, preallocate the file */
+	bool preallocate_space:1;
 };
 
 struct sdbox_mailbox {
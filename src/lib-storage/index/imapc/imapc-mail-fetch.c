@@ -168,6 +168,11 @@ static void
 imapc_mail_delayed_send_or_merge(struct imapc_mail *mail, string_t *str)
 {
 	struct imapc_mailbox *mbox = IMAPC_MAILBOX(mail->imail.mail.mail.box);
+	unsigned int prefetch_count =
+		mbox->box.storage->set->mail_prefetch_count;
+
+	if (prefetch_count == 0)
+		prefetch_count = mbox->box.storage->default_mail_prefetch_count;
 
 	if (mbox->pending_fetch_request != NULL &&
 	    !imapc_mail_try_merge_fetch(mbox, str)) {
@@ -184,8 +189,7 @@ imapc_mail_delayed_send_or_merge(struct imapc_mail *mail, string_t *str)
 	array_push_back(&mbox->pending_fetch_request->mails, &mail);
 
 	if (mbox->to_pending_fetch_send == NULL &&
-	    array_count(&mbox->pending_fetch_request->mails) >
-	    			mbox->box.storage->set->mail_prefetch_count) {
+	    array_count(&mbox->pending_fetch_request->mails) > prefetch_count) {
 		/* we're now prefetching the maximum number of mails. this
 		   most likely means that we need to flush out the command now
 		   before sending anything else. delay it a little bit though
@@ -1279,6 +1279,7 @@ struct mail_storage imapc_storage = {
 	.class_flags = MAIL_STORAGE_CLASS_FLAG_NO_ROOT |
 		       MAIL_STORAGE_CLASS_FLAG_UNIQUE_ROOT |
 		       MAIL_STORAGE_CLASS_FLAG_SECONDARY_INDEX,
+	.default_mail_prefetch_count = IMAPC_DEFAULT_PREFETCH_COUNT,
 	.event_category = &event_category_imapc,
 
 	.v = {
@@ -6,6 +6,10 @@
 #include "imapc-client.h"
 
 #define IMAPC_STORAGE_NAME "imapc"
+/* Lookahead used for searches when mail_prefetch_count is 0. Each prefetched
+   mail's fields get merged into a single pipelined UID FETCH, so this mostly
+   determines how many mails one round trip to the remote server covers. */
+#define IMAPC_DEFAULT_PREFETCH_COUNT 32
 /* storage_name separator */
 #define IMAPC_LIST_STORAGE_NAME_ESCAPE_CHAR '%'
 /* fs_name separator */
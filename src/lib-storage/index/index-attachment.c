@@ -421,8 +421,11 @@ int index_attachment_stream_get(struct fs *fs, const char *attachment_dir,
 	array_foreach(&extrefs_arr, extref) {
 		path = t_strdup_printf("%s/%s%s", attachment_dir,
 				       extref->path, path_suffix);
+		/* attachments are streamed back inline into the message
+		   body, i.e. read sequentially in full */
 		file = fs_file_init(fs, path, FS_OPEN_MODE_READONLY |
-				    FS_OPEN_FLAG_SEEKABLE);
+				    FS_OPEN_FLAG_SEEKABLE |
+				    FS_OPEN_FLAG_READ_SEQUENTIAL);
 		uoff_t raw_size;
 		if (extref->base64_blocks_per_line > 0) {
 			/* extref->size is base64 encoded size, convert into raw size */
@@ -360,22 +360,78 @@ blocks_count_lines(struct binary_ctx *ctx, struct istream *full_input)
 	return 0;
 }
 
+static struct mail_binary_cache_entry *
+binary_cache_lookup(struct mail *mail, const struct message_part *part,
+		    bool include_hdr)
+{
+	struct mail_binary_cache *cache = &mail->box->storage->binary_cache;
+	struct mail_binary_cache_entry *entries = cache->entries;
+	struct mail_binary_cache_entry tmp;
+	unsigned int i;
+
+	for (i = 0; i < MAIL_BINARY_CACHE_MAX_ENTRIES; i++) {
+		if (entries[i].box == NULL)
+			break;
+		if (entries[i].box == mail->box &&
+		    entries[i].uid == mail->uid &&
+		    entries[i].orig_physical_pos == part->physical_pos &&
+		    entries[i].include_hdr == include_hdr) {
+			/* move to the front of the LRU */
+			tmp = entries[i];
+			memmove(entries + 1, entries, sizeof(entries[0]) * i);
+			entries[0] = tmp;
+			timeout_reset(cache->to);
+			return &entries[0];
+		}
+	}
+	return NULL;
+}
+
+static void
+binary_cache_add(struct mail *mail, const struct message_part *part,
+		 bool include_hdr, struct istream *input, uoff_t size)
+{
+	struct mail_binary_cache *cache = &mail->box->storage->binary_cache;
+	struct mail_binary_cache_entry *entries = cache->entries;
+	const unsigned int last = MAIL_BINARY_CACHE_MAX_ENTRIES - 1;
+
+	if (entries[last].box != NULL)
+		i_stream_destroy(&entries[last].input);
+	memmove(entries + 1, entries, sizeof(entries[0]) * last);
+	i_zero(&entries[0]);
+	entries[0].box = mail->box;
+	entries[0].uid = mail->uid;
+	entries[0].orig_physical_pos = part->physical_pos;
+	entries[0].include_hdr = include_hdr;
+	entries[0].input = input;
+	entries[0].size = size;
+	i_stream_ref(input);
+
+	if (cache->to == NULL) {
+		cache->to = timeout_add(MAIL_BINARY_CACHE_EXPIRE_MSECS,
+					mail_storage_free_binary_cache,
+					mail->box->storage);
+	} else {
+		timeout_reset(cache->to);
+	}
+}
+
 static int
 index_mail_read_binary_to_cache(struct mail *_mail,
 				const struct message_part *part,
 				bool include_hdr, const char *reason,
+				uoff_t *size_r, struct istream **input_r,
 				bool *binary_r, bool *converted_r)
 {
 	struct index_mail *mail = INDEX_MAIL(_mail);
-	struct mail_binary_cache *cache = &_mail->box->storage->binary_cache;
 	struct binary_ctx ctx;
 	struct istream *is;
+	uoff_t size;
 
 	i_zero(&ctx);
 	ctx.mail = _mail;
 	t_array_init(&ctx.blocks, 8);
 
-	mail_storage_free_binary_cache(_mail->box->storage);
 	if (mail_get_stream_because(_mail, NULL, NULL, reason, &ctx.input) < 0)
 		return -1;
 
@@ -410,21 +466,16 @@ index_mail_read_binary_to_cache(struct mail *_mail,
 		return -1;
 	}
 
-	if (_mail->uid > 0) {
-		cache->to = timeout_add(MAIL_BINARY_CACHE_EXPIRE_MSECS,
-					mail_storage_free_binary_cache,
-					_mail->box->storage);
-		cache->box = _mail->box;
-		cache->uid = _mail->uid;
-		cache->orig_physical_pos = part->physical_pos;
-		cache->include_hdr = include_hdr;
-		cache->input = is;
-	}
-
 	i_assert(!i_stream_have_bytes_left(is));
-	cache->size = is->v_offset;
+	size = is->v_offset;
 	i_stream_seek(is, 0);
 
+	if (_mail->uid > 0 && ctx.converted) {
+		/* keep the converted payload around for a while, so repeated
+		   and alternating BINARY fetches don't redo the conversion */
+		binary_cache_add(_mail, part, include_hdr, is, size);
+	}
+
 	if (part->parent == NULL && include_hdr &&
 	    mail->data.bin_parts == NULL) {
 		binary_parts_update(&ctx, part, &mail->data.bin_parts);
@@ -433,6 +484,12 @@ index_mail_read_binary_to_cache(struct mail *_mail,
 	}
 	binary_streams_free(&ctx);
 
+	if (size_r != NULL)
+		*size_r = size;
+	if (input_r != NULL)
+		*input_r = is;
+	else
+		i_stream_unref(&is);
 	*binary_r = ctx.converted ? TRUE : ctx.has_nuls;
 	*converted_r = ctx.converted;
 	return 0;
@@ -497,7 +554,8 @@ index_mail_get_binary_size(struct mail *_mail,
 	if (!get_cached_binary_parts(mail)) {
 		/* not found. parse the whole message */
 		if (index_mail_read_binary_to_cache(_mail, all_parts, TRUE,
-						    "binary.size", &binary, &converted) < 0)
+						    "binary.size", NULL, NULL,
+						    &binary, &converted) < 0)
 			return -1;
 	}
 
@@ -551,8 +609,8 @@ int index_mail_get_binary_stream(struct mail *_mail,
 				 struct istream **stream_r)
 {
 	struct index_mail *mail = INDEX_MAIL(_mail);
-	struct mail_binary_cache *cache = &_mail->box->storage->binary_cache;
-	struct istream *input;
+	struct mail_binary_cache_entry *entry;
+	struct istream *input, *binary_input;
 	bool binary, converted;
 
 	if (stream_r == NULL) {
@@ -564,25 +622,27 @@ int index_mail_get_binary_stream(struct mail *_mail,
 	i_assert(lines_r == NULL);
 
 	/* FIXME: always put the header to temp file. skip it when needed. */
-	if (cache->box == _mail->box && cache->uid == _mail->uid &&
-	    cache->orig_physical_pos == part->physical_pos &&
-	    cache->include_hdr == include_hdr) {
+	entry = binary_cache_lookup(_mail, part, include_hdr);
+	if (entry != NULL) {
 		/* we have this cached already */
-		i_stream_seek(cache->input, 0);
-		timeout_reset(cache->to);
-		binary = TRUE;
-		converted = TRUE;
-	} else {
-		if (index_mail_read_binary_to_cache(_mail, part, include_hdr,
-						    "binary stream", &binary, &converted) < 0)
-			return -1;
-		mail->data.cache_fetch_fields |= MAIL_FETCH_STREAM_BINARY;
+		i_stream_seek(entry->input, 0);
+		i_stream_ref(entry->input);
+		*size_r = entry->size;
+		*binary_r = TRUE;
+		*stream_r = entry->input;
+		return 0;
 	}
-	*size_r = cache->size;
+	if (index_mail_read_binary_to_cache(_mail, part, include_hdr,
+					    "binary stream", size_r,
+					    &binary_input,
+					    &binary, &converted) < 0)
+		return -1;
+	mail->data.cache_fetch_fields |= MAIL_FETCH_STREAM_BINARY;
 	*binary_r = binary;
 	if (!converted) {
 		/* don't keep this cached. it's exactly the same as
 		   the original stream */
+		i_stream_unref(&binary_input);
 		i_assert(mail->data.stream != NULL);
 		i_stream_seek(mail->data.stream, part->physical_pos +
 			      (include_hdr ? 0 :
@@ -590,10 +650,8 @@ int index_mail_get_binary_stream(struct mail *_mail,
 		input = i_stream_create_crlf(mail->data.stream);
 		*stream_r = i_stream_create_limit(input, *size_r);
 		i_stream_unref(&input);
-		mail_storage_free_binary_cache(_mail->box->storage);
 	} else {
-		*stream_r = cache->input;
-		i_stream_ref(cache->input);
+		*stream_r = binary_input;
 	}
 	return 0;
 }
@@ -23,9 +23,6 @@
 
 #include <fcntl.h>
 
-#define BODY_SNIPPET_ALGO_V1 "1"
-#define BODY_SNIPPET_MAX_CHARS 200
-
 static struct mail_cache_field global_cache_fields[] = {
 	{ .name = "flags",
 	  .type = MAIL_CACHE_FIELD_BITMASK,
@@ -984,6 +981,16 @@ bool index_mail_want_cache(struct index_mail *mail, enum index_cache_field field
 
 static void index_mail_save_finish_make_snippet(struct index_mail *mail)
 {
+	if (mail->data.snippet_ctx != NULL) {
+		/* the snippet was generated while the message streamed
+		   through the save parser - no need to read it again */
+		string_t *str = str_new(mail->mail.data_pool, 128);
+
+		str_append(str, BODY_SNIPPET_ALGO_V1);
+		message_snippet_parse_deinit(&mail->data.snippet_ctx, str);
+		mail->data.body_snippet = str_c(str);
+		mail->data.save_body_snippet = FALSE;
+	}
 	if (mail->data.save_body_snippet) {
 		if (index_mail_write_body_snippet(mail) < 0)
 			return;
@@ -1831,6 +1838,8 @@ static void index_mail_close_streams_full(struct index_mail *mail, bool closing)
 		if (mail->data.save_bodystructure_body)
 			mail->data.save_bodystructure_header = TRUE;
 	}
+	if (data->snippet_ctx != NULL)
+		message_snippet_parse_deinit(&data->snippet_ctx, NULL);
 	i_stream_unref(&data->filter_stream);
 	if (data->stream != NULL) {
 		struct istream *orig_stream = data->stream;
@@ -2325,6 +2334,10 @@ void index_mail_cache_parse_continue(struct mail *_mail)
 
 	while (message_parser_parse_next_block(mail->data.parser_ctx,
 					       &block) > 0) {
+		if (mail->data.snippet_ctx != NULL) {
+			(void)message_snippet_parse_more(mail->data.snippet_ctx,
+							 &block);
+		}
 		if (block.size != 0)
 			continue;
 
@@ -31,6 +31,11 @@ enum index_cache_field {
 #define IMAP_BODY_PLAIN_7BIT_ASCII \
 	"\"text\" \"plain\" (\"charset\" \"us-ascii\") NIL NIL \"7bit\""
 
+#define BODY_SNIPPET_ALGO_V1 "1"
+#define BODY_SNIPPET_MAX_CHARS 200
+
+struct message_snippet_context;
+
 enum mail_cache_record_flag {
 	/* If binary flags are set, it's not checked whether mail is
 	   missing CRs. So this flag may be set as an optimization for
@@ -102,6 +107,7 @@ struct index_mail_data {
 	struct message_size hdr_size, body_size;
 	struct istream *parser_input;
 	struct message_parser_ctx *parser_ctx;
+	struct message_snippet_context *snippet_ctx;
 	int parsing_count;
 	ARRAY_TYPE(keywords) keywords;
 	ARRAY_TYPE(keyword_indexes) keyword_indexes;
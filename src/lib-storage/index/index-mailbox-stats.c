@@ -0,0 +1,216 @@
+/* Copyright (c) 2002-2018 Dovecot authors, see the included COPYING file */
+
+#include "lib.h"
+#include "mail-search-build.h"
+#include "index-storage.h"
+#include "index-mailbox-stats.h"
+
+static void stats_header_read(struct mailbox *box,
+			      struct mailbox_index_stats *hdr)
+{
+	const void *data;
+	size_t size;
+
+	mail_index_get_header_ext(box->view, box->stats_hdr_ext_id,
+				  &data, &size);
+	if (size == sizeof(*hdr))
+		memcpy(hdr, data, sizeof(*hdr));
+	else {
+		if (size != 0) {
+			mailbox_set_critical(box,
+				"stats-hdr has invalid size: %zu", size);
+		}
+		i_zero(hdr);
+	}
+}
+
+static void stats_header_write(struct mailbox *box,
+			       const struct mailbox_index_stats *hdr)
+{
+	struct mail_index_transaction *trans;
+
+	trans = mail_index_transaction_begin(box->view,
+				MAIL_INDEX_TRANSACTION_FLAG_EXTERNAL);
+	mail_index_update_header_ext(trans, box->stats_hdr_ext_id,
+				     0, hdr, sizeof(*hdr));
+	(void)mail_index_transaction_commit(&trans);
+}
+
+static void stats_check_rebuild(struct mailbox *box,
+				struct mailbox_index_stats *hdr)
+{
+	uint32_t seq1, seq2;
+
+	if (hdr->highest_uid == 0)
+		return;
+	if (!mail_index_lookup_seq_range(box->view, 1, hdr->highest_uid,
+					 &seq1, &seq2))
+		seq2 = 0;
+	if (hdr->message_count != seq2) {
+		/* mails have been expunged (or the header is broken) -
+		   recalculate everything */
+		i_zero(hdr);
+	}
+}
+
+static void stats_add_mail(struct mailbox_index_stats *hdr,
+			   time_t rdate, uoff_t vsize)
+{
+	uint32_t day, base_day, idx, shift, i;
+
+	if (rdate < 0)
+		rdate = 0;
+	day = rdate / MAILBOX_STATS_RDATE_BUCKET_WIDTH;
+	base_day = hdr->rdate_base / MAILBOX_STATS_RDATE_BUCKET_WIDTH;
+
+	if (hdr->message_count == 0) {
+		/* the first mail anchors the window */
+		base_day = day;
+		hdr->rdate_base = day * MAILBOX_STATS_RDATE_BUCKET_WIDTH;
+	}
+	if (day >= base_day + MAILBOX_STATS_RDATE_BUCKET_COUNT) {
+		/* newer than the window - slide it forwards, moving the
+		   dropped buckets into the older-count */
+		shift = day - (base_day + MAILBOX_STATS_RDATE_BUCKET_COUNT - 1);
+		if (shift >= MAILBOX_STATS_RDATE_BUCKET_COUNT) {
+			for (i = 0; i < MAILBOX_STATS_RDATE_BUCKET_COUNT; i++) {
+				hdr->rdate_older_count += hdr->rdate_buckets[i];
+				hdr->rdate_buckets[i] = 0;
+			}
+		} else {
+			for (i = 0; i < shift; i++)
+				hdr->rdate_older_count += hdr->rdate_buckets[i];
+			memmove(hdr->rdate_buckets, hdr->rdate_buckets + shift,
+				(MAILBOX_STATS_RDATE_BUCKET_COUNT - shift) *
+				sizeof(hdr->rdate_buckets[0]));
+			memset(hdr->rdate_buckets +
+			       MAILBOX_STATS_RDATE_BUCKET_COUNT - shift, 0,
+			       shift * sizeof(hdr->rdate_buckets[0]));
+		}
+		base_day += shift;
+		hdr->rdate_base = base_day * MAILBOX_STATS_RDATE_BUCKET_WIDTH;
+	}
+	if (day < base_day)
+		hdr->rdate_older_count++;
+	else
+		hdr->rdate_buckets[day - base_day]++;
+
+	idx = 0;
+	while (vsize > 1 && idx < MAILBOX_STATS_SIZE_BUCKET_COUNT - 1) {
+		vsize >>= 1;
+		idx++;
+	}
+	hdr->size_buckets[idx]++;
+	hdr->message_count++;
+}
+
+static int index_mailbox_stats_add_missing(struct mailbox *box,
+					   struct mailbox_index_stats *hdr,
+					   bool cached_only)
+{
+	struct mailbox_transaction_context *trans;
+	struct mail_search_context *search_ctx;
+	struct mail_search_args *search_args;
+	struct mailbox_status status;
+	struct mail *mail;
+	uint32_t seq1, seq2;
+	time_t rdate;
+	uoff_t vsize;
+	int ret = 0;
+
+	mailbox_get_open_status(box, STATUS_UIDNEXT, &status);
+	if (hdr->highest_uid + 1 >= status.uidnext) {
+		/* nothing to do */
+		return 0;
+	}
+	if (!mail_index_lookup_seq_range(box->view, hdr->highest_uid + 1,
+					 status.uidnext - 1, &seq1, &seq2)) {
+		/* nothing existed, but update uidnext */
+		hdr->highest_uid = status.uidnext - 1;
+		return 0;
+	}
+	search_args = mail_search_build_init();
+	mail_search_build_add_seqset(search_args, seq1, seq2);
+
+	trans = mailbox_transaction_begin(box, 0, "stats update");
+	search_ctx = mailbox_search_init(trans, search_args, NULL,
+					 MAIL_FETCH_RECEIVED_DATE |
+					 MAIL_FETCH_VIRTUAL_SIZE, NULL);
+	mail_search_args_unref(&search_args);
+
+	while (mailbox_search_next(search_ctx, &mail)) {
+		if (cached_only)
+			mail->lookup_abort = MAIL_LOOKUP_ABORT_NOT_IN_CACHE;
+		ret = mail_get_received_date(mail, &rdate);
+		if (ret == 0)
+			ret = mail_get_virtual_size(mail, &vsize);
+		mail->lookup_abort = MAIL_LOOKUP_ABORT_NEVER;
+
+		if (ret < 0) {
+			if (cached_only &&
+			    mailbox_get_last_mail_error(box) ==
+					MAIL_ERROR_LOOKUP_ABORTED) {
+				/* leave the rest for the next full lookup */
+				break;
+			}
+			if (mail->expunged) {
+				/* the expunge gets detected later and causes
+				   a recalculation */
+				ret = 0;
+				continue;
+			}
+			break;
+		}
+		stats_add_mail(hdr, rdate, vsize);
+		hdr->highest_uid = mail->uid;
+	}
+	if (mailbox_search_deinit(&search_ctx) < 0)
+		ret = -1;
+	if (ret == 0 && !cached_only)
+		hdr->highest_uid = status.uidnext - 1;
+	(void)mailbox_transaction_commit(&trans);
+	return ret;
+}
+
+int index_mailbox_stats_get(struct mailbox *box,
+			    struct mailbox_index_stats *stats_r)
+{
+	struct mailbox_index_stats hdr, orig_hdr;
+	struct event_reason *reason;
+	int ret;
+
+	i_assert(box->opened);
+
+	stats_header_read(box, &hdr);
+	stats_check_rebuild(box, &hdr);
+	orig_hdr = hdr;
+
+	reason = event_reason_begin("mailbox:stats");
+	ret = index_mailbox_stats_add_missing(box, &hdr, FALSE);
+	event_reason_end(&reason);
+
+	if (memcmp(&orig_hdr, &hdr, sizeof(hdr)) != 0)
+		stats_header_write(box, &hdr);
+	*stats_r = hdr;
+	return ret;
+}
+
+void index_mailbox_stats_update_appends(struct mailbox *box)
+{
+	struct mailbox_index_stats hdr, orig_hdr;
+
+	stats_header_read(box, &hdr);
+	if (hdr.highest_uid == 0) {
+		/* stats have never been wanted for this mailbox */
+		return;
+	}
+	stats_check_rebuild(box, &hdr);
+	if (hdr.highest_uid == 0) {
+		/* expunges - leave the recalculation to the next lookup */
+		return;
+	}
+	orig_hdr = hdr;
+	(void)index_mailbox_stats_add_missing(box, &hdr, TRUE);
+	if (memcmp(&orig_hdr, &hdr, sizeof(hdr)) != 0)
+		stats_header_write(box, &hdr);
+}
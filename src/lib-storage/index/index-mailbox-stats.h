@@ -0,0 +1,44 @@
+#ifndef INDEX_MAILBOX_STATS_H
+#define INDEX_MAILBOX_STATS_H
+
+struct mailbox;
+
+/* received-date histogram: one bucket per day */
+#define MAILBOX_STATS_RDATE_BUCKET_WIDTH (24*60*60)
+#define MAILBOX_STATS_RDATE_BUCKET_COUNT 32
+/* virtual size histogram: bucket n counts mails with vsize < 2^(n+1) */
+#define MAILBOX_STATS_SIZE_BUCKET_COUNT 32
+
+/* "hdr-stats" index header extension. Updated incrementally from newly
+   appended mails once the stats have been wanted for the mailbox at least
+   once. Expunges are detected from a message count mismatch and cause a full
+   recalculation on the next lookup. There's no locking - concurrent updates
+   may lose a little work, but the header always stays self-consistent. */
+struct mailbox_index_stats {
+	/* UID of the last mail included. 0 = stats never calculated. */
+	uint32_t highest_uid;
+	/* number of mails included, used for detecting expunges */
+	uint32_t message_count;
+	/* start time of rdate_buckets[0], aligned to a bucket boundary */
+	uint32_t rdate_base;
+	/* mails received before rdate_base */
+	uint32_t rdate_older_count;
+	/* mails received within bucket-width starting at rdate_base +
+	   bucket index days. the window slides forward as newer mails are
+	   added, moving the dropped buckets into rdate_older_count. */
+	uint32_t rdate_buckets[MAILBOX_STATS_RDATE_BUCKET_COUNT];
+	/* log2 virtual size counts */
+	uint32_t size_buckets[MAILBOX_STATS_SIZE_BUCKET_COUNT];
+};
+
+/* Return up-to-date stats for the mailbox, calculating them for any mails
+   that aren't included yet (or for all mails after expunges). Returns 0 if
+   ok, -1 if some lookups failed (stats_r is still filled as far as it got). */
+int index_mailbox_stats_get(struct mailbox *box,
+			    struct mailbox_index_stats *stats_r);
+/* Add newly appended mails to the stats header, if it exists. Uses only
+   cached fields - mails whose fields aren't cached are left for the next
+   index_mailbox_stats_get() call. */
+void index_mailbox_stats_update_appends(struct mailbox *box);
+
+#endif
@@ -541,8 +541,23 @@ static int search_arg_match_mimepart(struct search_mimepart_context *mpctx,
 		p_array_init(&mpctx->stack, mpctx->pool, 16);
 	}
 	if (mpctx->mime_parts == NULL) {
-		/* FIXME: could the mail object already have message_part tree with
-		   data? */
+		struct mail *mail = ctx->cur_mail;
+		enum mail_lookup_abort orig_lookup_abort = mail->lookup_abort;
+		struct message_part *parts;
+		int ret;
+
+		/* the mail object may already have a message_part tree with
+		   the MIME data attached (e.g. the message was just parsed
+		   for another search arg). use it as-is then instead of
+		   re-parsing the BODYSTRUCTURE string. the lookup_abort
+		   makes sure we don't trigger any message parsing here. */
+		mail->lookup_abort = MAIL_LOOKUP_ABORT_NOT_IN_CACHE;
+		ret = mail_get_parts(mail, &parts);
+		mail->lookup_abort = orig_lookup_abort;
+		if (ret == 0 && parts->data != NULL)
+			mpctx->mime_parts = parts;
+	}
+	if (mpctx->mime_parts == NULL) {
 		if (mail_get_special(ctx->cur_mail,
 			MAIL_FETCH_IMAP_BODYSTRUCTURE, &bodystructure) < 0)
 			return -1;
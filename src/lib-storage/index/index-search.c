@@ -817,10 +817,19 @@ static int search_arg_match_text(struct mail_search_arg *args,
 			   index_mail_parse_header() must have a non-NULL part
 			   parameter. That's not easily possible at this point
 			   without larger code changes, so for now we'll just
-			   disable this optimization for that case. */
+			   disable this optimization for that case.
+
+			   If the search names specific headers, parse them
+			   into the cache file as well. The cache-only branch
+			   above already does this via the header filter
+			   stream, so doing it here too means repeated header
+			   searches are answered from dovecot.index.cache
+			   regardless of whether the first search also had to
+			   read the bodies. */
 			hdr_ctx.parse_headers =
 				!hdr_ctx.imail->data.save_bodystructure_header &&
-				index_mail_want_parse_headers(hdr_ctx.imail);
+				(headers_ctx != NULL ||
+				 index_mail_want_parse_headers(hdr_ctx.imail));
 			if (hdr_ctx.parse_headers) {
 				index_mail_parse_header_init(hdr_ctx.imail,
 							     headers_ctx);
@@ -1306,6 +1315,116 @@ wanted_sort_fields_get(struct mailbox *box,
 	}
 }
 
+/* Rough evaluation cost classes for reordering AND/OR branches before the
+   search starts. Evaluation short-circuits in argument order, so putting the
+   cheap lookups first lets e.g. a non-matching SINCE prevent a BODY arg from
+   ever streaming the message. */
+enum search_arg_cost {
+	/* answered directly from the index records */
+	SEARCH_ARG_COST_INDEX = 0,
+	/* usually answered from dovecot.index.cache */
+	SEARCH_ARG_COST_CACHE,
+	/* needs the message headers */
+	SEARCH_ARG_COST_HEADERS,
+	/* needs the message body */
+	SEARCH_ARG_COST_BODY,
+
+	SEARCH_ARG_COST_COUNT
+};
+
+static enum search_arg_cost
+search_arg_cost(const struct mail_search_arg *arg)
+{
+	const struct mail_search_arg *subarg;
+	enum search_arg_cost cost, max_cost = SEARCH_ARG_COST_INDEX;
+
+	switch (arg->type) {
+	case SEARCH_OR:
+	case SEARCH_SUB:
+		/* the cost is the most expensive subarg, since evaluating the
+		   result may require evaluating all of them */
+		subarg = arg->value.subargs;
+		for (; subarg != NULL; subarg = subarg->next) {
+			cost = search_arg_cost(subarg);
+			if (max_cost < cost)
+				max_cost = cost;
+		}
+		return max_cost;
+	case SEARCH_ALL:
+	case SEARCH_SEQSET:
+	case SEARCH_UIDSET:
+	case SEARCH_FLAGS:
+	case SEARCH_KEYWORDS:
+	case SEARCH_MODSEQ:
+	case SEARCH_MAILBOX:
+	case SEARCH_MAILBOX_GUID:
+	case SEARCH_MAILBOX_GLOB:
+	case SEARCH_SAVEDATESUPPORTED:
+	case SEARCH_REAL_UID:
+		return SEARCH_ARG_COST_INDEX;
+	case SEARCH_BEFORE:
+	case SEARCH_ON:
+	case SEARCH_SINCE:
+		if (arg->value.date_type == MAIL_SEARCH_DATE_TYPE_SENT) {
+			/* sent date may have to be parsed from the header */
+			return SEARCH_ARG_COST_HEADERS;
+		}
+		return SEARCH_ARG_COST_CACHE;
+	case SEARCH_SMALLER:
+	case SEARCH_LARGER:
+	case SEARCH_GUID:
+		return SEARCH_ARG_COST_CACHE;
+	case SEARCH_HEADER:
+	case SEARCH_HEADER_ADDRESS:
+	case SEARCH_HEADER_COMPRESS_LWSP:
+		return SEARCH_ARG_COST_HEADERS;
+	case SEARCH_BODY:
+	case SEARCH_TEXT:
+	case SEARCH_INTHREAD:
+	case SEARCH_MIMEPART:
+		return SEARCH_ARG_COST_BODY;
+	}
+	return SEARCH_ARG_COST_BODY;
+}
+
+static void search_args_sort_costs(struct mail_search_arg **argp)
+{
+	struct mail_search_arg *arg = *argp;
+	struct mail_search_arg *heads[SEARCH_ARG_COST_COUNT];
+	struct mail_search_arg **tailp[SEARCH_ARG_COST_COUNT];
+	enum search_arg_cost cost;
+	unsigned int i;
+
+	for (i = 0; i < SEARCH_ARG_COST_COUNT; i++) {
+		heads[i] = NULL;
+		tailp[i] = &heads[i];
+	}
+
+	/* distribute the args into cost buckets. this keeps the written order
+	   within each bucket, so it's a stable sort. */
+	while (arg != NULL) {
+		struct mail_search_arg *next = arg->next;
+
+		if (arg->type == SEARCH_OR || arg->type == SEARCH_SUB)
+			search_args_sort_costs(&arg->value.subargs);
+
+		cost = search_arg_cost(arg);
+		arg->next = NULL;
+		*tailp[cost] = arg;
+		tailp[cost] = &arg->next;
+		arg = next;
+	}
+
+	/* concatenate the buckets back, cheapest first */
+	*argp = NULL;
+	for (i = SEARCH_ARG_COST_COUNT; i > 0; i--) {
+		if (heads[i-1] != NULL) {
+			*tailp[i-1] = *argp;
+			*argp = heads[i-1];
+		}
+	}
+}
+
 struct mail_search_context *
 index_storage_search_init(struct mailbox_transaction_context *t,
 			  struct mail_search_args *args,
@@ -1315,6 +1434,7 @@ index_storage_search_init(struct mailbox_transaction_context *t,
 {
 	struct index_search_context *ctx;
 	struct mailbox_status status;
+	unsigned int prefetch_count;
 
 	ctx = i_new(struct index_search_context, 1);
 	ctx->mail_ctx.transaction = t;
@@ -1324,7 +1444,10 @@ index_storage_search_init(struct mailbox_transaction_context *t,
 	ctx->mail_ctx.args = args;
 	ctx->mail_ctx.sort_program = index_sort_program_init(t, sort_program);
 
-	ctx->mail_ctx.max_mails = t->box->storage->set->mail_prefetch_count + 1;
+	prefetch_count = t->box->storage->set->mail_prefetch_count;
+	if (prefetch_count == 0)
+		prefetch_count = t->box->storage->default_mail_prefetch_count;
+	ctx->mail_ctx.max_mails = prefetch_count + 1;
 	if (ctx->mail_ctx.max_mails == 0)
 		ctx->mail_ctx.max_mails = UINT_MAX;
 	ctx->next_time_check_cost = SEARCH_INITIAL_MAX_COST;
@@ -1339,6 +1462,9 @@ index_storage_search_init(struct mailbox_transaction_context *t,
 	i_array_init(&ctx->mail_ctx.mails, ctx->mail_ctx.max_mails);
 
 	mail_search_args_reset(ctx->mail_ctx.args->args, TRUE);
+	/* evaluate the cheap args first, so their non-matches can prevent
+	   the expensive lookups from running at all */
+	search_args_sort_costs(&args->args);
 	if (args->have_inthreads) {
 		if (mail_thread_init(t->box, NULL, &ctx->thread_ctx) < 0)
 			search_set_failed(ctx);
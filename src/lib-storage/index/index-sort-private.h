@@ -14,6 +14,9 @@ struct mail_search_sort_program {
 	void (*sort_list_finish)(struct mail_search_sort_program *program);
 	void *context;
 
+	/* for MAIL_SORT_DATE: per-record extension caching the sort dates */
+	uint32_t date_ext_id;
+
 	ARRAY_TYPE(uint32_t) seqs;
 	unsigned int iter_idx;
 
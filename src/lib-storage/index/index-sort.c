@@ -90,15 +90,41 @@ index_sort_list_add_date(struct mail_search_sort_program *program,
 {
 	ARRAY_TYPE(mail_sort_node_date) *nodes = program->context;
 	struct mail_sort_node_date *node;
+	const void *data;
+	uint32_t date32;
+	bool expunged;
 	int tz;
 
 	node = array_append_space(nodes);
 	node->seq = mail->seq;
-	if (mail_get_date(mail, &node->date, &tz) < 0)
+
+	/* the sort date never changes once it's known, so a previously
+	   written extension record can be used as-is. like with the string
+	   sorts' sort IDs, this makes repeated sorting O(new mails). */
+	mail_index_lookup_ext(program->t->view, mail->seq,
+			      program->date_ext_id, &data, &expunged);
+	if (data != NULL) {
+		memcpy(&date32, data, sizeof(date32));
+		if (date32 != 0) {
+			node->date = date32;
+			return;
+		}
+	}
+
+	if (mail_get_date(mail, &node->date, &tz) < 0) {
 		node->date = index_sort_program_set_date_failed(program, mail);
-	else if (node->date == 0) {
-		if (mail_get_received_date(mail, &node->date) < 0)
+		return;
+	}
+	if (node->date == 0) {
+		if (mail_get_received_date(mail, &node->date) < 0) {
 			node->date = index_sort_program_set_date_failed(program, mail);
+			return;
+		}
+	}
+	if (node->date > 0 && node->date <= (time_t)0xffffffffU) {
+		date32 = node->date;
+		mail_index_update_ext(program->t->itrans, mail->seq,
+				      program->date_ext_id, &date32, NULL);
 	}
 }
 
@@ -414,8 +440,15 @@ index_sort_program_init(struct mailbox_transaction_context *t,
 		if ((program->sort_program[0] &
 		     MAIL_SORT_MASK) == MAIL_SORT_ARRIVAL)
 			program->sort_list_add = index_sort_list_add_arrival;
-		else
+		else {
+			/* cache the looked up dates in the index, like the
+			   string sorts cache their sort IDs */
+			program->date_ext_id =
+				mail_index_ext_register(t->box->index,
+					"sort-d", 0, sizeof(uint32_t),
+					sizeof(uint32_t));
 			program->sort_list_add = index_sort_list_add_date;
+		}
 		program->sort_list_finish = index_sort_list_finish_date;
 		program->context = nodes;
 		break;
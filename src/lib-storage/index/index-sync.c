@@ -5,6 +5,7 @@
 #include "ioloop.h"
 #include "array.h"
 #include "index-mailbox-size.h"
+#include "index-mailbox-stats.h"
 #include "index-sync-private.h"
 #include "mailbox-recent-flags.h"
 
@@ -354,6 +355,8 @@ int index_mailbox_sync_deinit(struct mailbox_sync_context *_ctx,
 	index_sync_search_results_update(ctx);
 	/* update vsize header if wanted */
 	index_mailbox_vsize_update_appends(_ctx->box);
+	/* update stats header if it exists */
+	index_mailbox_stats_update_appends(_ctx->box);
 
 	if (ret == 0 && mail_index_view_is_inconsistent(_ctx->box->view)) {
 		/* we probably had MAILBOX_SYNC_FLAG_FIX_INCONSISTENT set,
@@ -507,6 +507,7 @@ static void mail_thread_cache_sync_add(struct mail_thread_mailbox *tbox,
 	struct mail *mail;
 	const struct mail_index_strmap_rec *msgid_map;
 	unsigned int i, count;
+	uint32_t highest_idx;
 
 	mail_thread_cache_fix_invalid_indexes(tbox);
 
@@ -517,12 +518,17 @@ static void mail_thread_cache_sync_add(struct mail_thread_mailbox *tbox,
 		return;
 	}
 
+	highest_idx = mail_index_strmap_view_get_highest_idx(tbox->strmap_view);
 	cache->last_uid = 0;
 	cache->first_invalid_msgid_str_idx = cache->next_invalid_msgid_str_idx =
-		mail_index_strmap_view_get_highest_idx(tbox->strmap_view) + 1 +
-		THREAD_INVALID_MSGID_STR_IDX_SKIP_COUNT;
+		highest_idx + 1 + THREAD_INVALID_MSGID_STR_IDX_SKIP_COUNT;
 	array_clear(&cache->thread_nodes);
 
+	/* optimization: allocate all nodes initially, so building a large
+	   tree doesn't keep growing (and copying) the array */
+	if (highest_idx > 0)
+		(void)array_idx_modifiable(&cache->thread_nodes, highest_idx);
+
 	cache->search_result =
 		mailbox_search_result_save(search_ctx,
 			MAILBOX_SEARCH_RESULT_FLAG_UPDATE |
@@ -466,6 +466,15 @@ maildir_scan_dir(struct maildir_sync_context *ctx, bool new_dir, bool final,
 	src = t_str_new(1024);
 	dest = t_str_new(1024);
 
+	/* build the directory prefixes once - with large maildirs this loop
+	   runs hundreds of thousands of times */
+	str_append(src, ctx->new_dir);
+	str_append_c(src, '/');
+	str_append(dest, ctx->cur_dir);
+	str_append_c(dest, '/');
+	size_t src_prefix_len = str_len(src);
+	size_t dest_prefix_len = str_len(dest);
+
 	move_new = new_dir && ctx->locked &&
 		((ctx->mbox->box.flags & MAILBOX_FLAG_DROP_RECENT) != 0 ||
 		 ctx->mbox->storage->set->maildir_empty_new);
@@ -487,10 +496,10 @@ maildir_scan_dir(struct maildir_sync_context *ctx, bool new_dir, bool final,
 		if (move_new) {
 			i_assert(dp->d_name[0] != '\0');
 
-			str_truncate(src, 0);
-			str_truncate(dest, 0);
-			str_printfa(src, "%s/%s", ctx->new_dir, dp->d_name);
-			str_printfa(dest, "%s/%s", ctx->cur_dir, dp->d_name);
+			str_truncate(src, src_prefix_len);
+			str_truncate(dest, dest_prefix_len);
+			str_append(src, dp->d_name);
+			str_append(dest, dp->d_name);
 			if (strchr(dp->d_name, MAILDIR_INFO_SEP) == NULL) {
 				str_append(dest, MAILDIR_FLAGS_FULL_SEP);
 			}
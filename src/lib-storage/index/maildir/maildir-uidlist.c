@@ -315,6 +315,12 @@ static void maildir_uidlist_reset(struct maildir_uidlist *uidlist)
 
 	hash_table_clear(uidlist->files, FALSE);
 	array_clear(&uidlist->records);
+	/* all records are gone now, so drop the old generation's memory
+	   before the following full re-read allocates a new one. otherwise
+	   each time another process recreates the file, the old records stay
+	   allocated in the pool until the next locked sync replaces it. */
+	if (uidlist->record_pool != NULL)
+		p_clear(uidlist->record_pool);
 }
 
 void maildir_uidlist_deinit(struct maildir_uidlist **_uidlist)
@@ -165,6 +165,7 @@ int mbox_file_seek(struct mbox_mailbox *mbox, struct mail_index_view *view,
 		   uint32_t seq, bool *deleted_r)
 {
 	uoff_t offset;
+	uint32_t uid;
 	int ret;
 
 	ret = mbox_file_lookup_offset(mbox, view, seq, &offset);
@@ -196,11 +197,20 @@ int mbox_file_seek(struct mbox_mailbox *mbox, struct mail_index_view *view,
 
 	if (mbox->mbox_hdr.dirty_flag != 0) {
 		/* we're dirty - make sure this is the correct mail */
+		mail_index_lookup_uid(view, seq, &uid);
+		if (uid == mbox->mbox_verified_uid &&
+		    offset == mbox->mbox_verified_offset) {
+			/* already verified this mail's offset and the file
+			   can't have changed while we've kept it locked */
+			return 1;
+		}
 		if (!mbox_sync_parse_match_mail(mbox, view, seq))
 			return 0;
 
 		ret = istream_raw_mbox_seek(mbox->mbox_stream, offset);
 		i_assert(ret == 0);
+		mbox->mbox_verified_uid = uid;
+		mbox->mbox_verified_offset = offset;
 	}
 
 	return 1;
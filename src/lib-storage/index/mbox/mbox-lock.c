@@ -865,6 +865,11 @@ int mbox_unlock(struct mbox_mailbox *mbox, unsigned int lock_id)
 	if (mbox->mbox_stream != NULL)
 		istream_raw_mbox_set_unlocked(mbox->mbox_stream);
 
+	/* another process may now modify the file, so the cached offsets
+	   have to be verified again the next time they're used */
+	mbox->mbox_verified_uid = 0;
+	mbox->mbox_verified_offset = 0;
+
 	i_zero(&ctx);
 	ctx.mbox = mbox;
 
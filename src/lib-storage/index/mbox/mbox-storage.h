@@ -57,6 +57,11 @@ struct mbox_mailbox {
 	struct mbox_index_header mbox_hdr;
 	const struct mailbox_update *sync_hdr_update;
 
+	/* while the mbox is marked dirty, the mail that was last verified to
+	   be at its indexed offset. valid only until the mbox is unlocked. */
+	uint32_t mbox_verified_uid;
+	uoff_t mbox_verified_offset;
+
 	struct mbox_md5_vfuncs md5_v;
 
 	bool no_mbox_file:1;
@@ -9,6 +9,8 @@
 #include "mail-storage.h"
 #include "mailbox-list-index-sync.h"
 
+#include <sys/stat.h>
+
 static void
 node_lookup_guid(struct mailbox_list_index_sync_context *ctx,
 		 const struct mailbox_list_index_node *node, guid_128_t guid_r)
@@ -289,6 +291,29 @@ retry:
 	return 0;
 }
 
+static void
+mailbox_list_index_sync_root_stat(struct mailbox_list_index_sync_context *sync_ctx)
+{
+	struct mailbox_list *list = sync_ctx->list;
+	const char *root_dir;
+	struct stat st;
+
+	/* remember the root directory's mtime before scanning it, so the
+	   next process can skip the scan if nothing has changed. only
+	   maildir++ can rely on the root's mtime - see
+	   mailbox_list_index_root_unchanged(). */
+	if (strcmp(list->name, MAILBOX_LIST_NAME_MAILDIRPLUSPLUS) != 0 ||
+	    list->set.iter_from_index_dir)
+		return;
+	if (!mailbox_list_get_root_path(list, MAILBOX_LIST_PATH_TYPE_MAILBOX,
+					&root_dir))
+		return;
+	if (stat(root_dir, &st) < 0)
+		return;
+	sync_ctx->root_hdr.root_mtime = (uint32_t)st.st_mtime;
+	sync_ctx->root_hdr.sync_stamp = ioloop_time32;
+}
+
 static int
 mailbox_list_index_sync_list(struct mailbox_list_index_sync_context *sync_ctx)
 {
@@ -306,6 +331,8 @@ mailbox_list_index_sync_list(struct mailbox_list_index_sync_context *sync_ctx)
 	/* don't include autocreated mailboxes in index until they're
 	   actually created. this index may be used by multiple users, so
 	   we also want to ignore ACLs here. */
+	mailbox_list_index_sync_root_stat(sync_ctx);
+
 	patterns[0] = "*"; patterns[1] = NULL;
 	iter = sync_ctx->ilist->module_ctx.super.
 		iter_init(sync_ctx->list, patterns,
@@ -436,6 +463,12 @@ int mailbox_list_index_sync_end(struct mailbox_list_index_sync_context **_sync_c
 	if (success) {
 		mailbox_list_index_sync_update_corrupted(sync_ctx);
 		mailbox_list_index_sync_update_hdr(sync_ctx);
+		if (sync_ctx->root_hdr.sync_stamp != 0) {
+			mail_index_update_header_ext(sync_ctx->trans,
+				sync_ctx->ilist->root_ext_id, 0,
+				&sync_ctx->root_hdr,
+				sizeof(sync_ctx->root_hdr));
+		}
 	}
 	mail_index_view_close(&sync_ctx->view);
 
@@ -14,6 +14,10 @@ struct mailbox_list_index_sync_context {
 	struct mail_index_view *view;
 	struct mail_index_transaction *trans;
 
+	/* root directory's state at the time the backing store scan started.
+	   sync_stamp=0 if it wasn't looked up. */
+	struct mailbox_list_index_root_header root_hdr;
+
 	bool syncing_list:1;
 };
 
@@ -2,6 +2,7 @@
 
 #include "lib.h"
 #include "ioloop.h"
+#include "time-util.h"
 #include "hash.h"
 #include "str.h"
 #include "mail-index-view-private.h"
@@ -10,6 +11,8 @@
 #include "mailbox-list-index-storage.h"
 #include "mailbox-list-index-sync.h"
 
+#include <sys/stat.h>
+
 #define MAILBOX_LIST_INDEX_REFRESH_DELAY_MSECS 1000
 
 /* dovecot.list.index.log doesn't have to be kept for that long. */
@@ -603,6 +606,43 @@ bool mailbox_list_index_need_refresh(struct mailbox_list_index *ilist,
 	return hdr != NULL && hdr->refresh_flag != 0;
 }
 
+static bool
+mailbox_list_index_root_unchanged(struct mailbox_list *list,
+				  struct mail_index_view *view)
+{
+	struct mailbox_list_index *ilist = INDEX_LIST_CONTEXT_REQUIRE(list);
+	const struct mailbox_list_index_root_header *hdr;
+	const void *data;
+	size_t size;
+	const char *root_dir;
+	struct stat st;
+
+	/* only maildir++ can do this check: every mailbox is a direct child
+	   of the root directory, so any mailbox create/delete/rename updates
+	   the root's mtime, while mail deliveries only touch the cur/new/tmp
+	   subdirectories. */
+	if (strcmp(list->name, MAILBOX_LIST_NAME_MAILDIRPLUSPLUS) != 0 ||
+	    list->set.iter_from_index_dir)
+		return FALSE;
+	if (!mailbox_list_get_root_path(list, MAILBOX_LIST_PATH_TYPE_MAILBOX,
+					&root_dir))
+		return FALSE;
+
+	mail_index_get_header_ext(view, ilist->root_ext_id, &data, &size);
+	if (size < sizeof(*hdr))
+		return FALSE;
+	hdr = data;
+	if (hdr->sync_stamp == 0 || hdr->root_mtime >= hdr->sync_stamp) {
+		/* the root was changing at the time of the last sync - a
+		   later change within the same second wouldn't be visible
+		   in the mtime. */
+		return FALSE;
+	}
+	if (stat(root_dir, &st) < 0)
+		return FALSE;
+	return (uint32_t)st.st_mtime == hdr->root_mtime;
+}
+
 int mailbox_list_index_refresh(struct mailbox_list *list)
 {
 	struct mailbox_list_index *ilist = INDEX_LIST_CONTEXT_REQUIRE(list);
@@ -617,6 +657,19 @@ int mailbox_list_index_refresh(struct mailbox_list *list)
 		   index every single time. */
 		return ilist->last_refresh_success ? 0 : -1;
 	}
+	if (ilist->last_refresh_success &&
+	    list->mail_set->mailbox_list_index_refresh_interval != 0 &&
+	    timeval_diff_msecs(&ioloop_timeval, &ilist->last_refresh_timeval) <
+	    (long long)list->mail_set->mailbox_list_index_refresh_interval) {
+		/* refreshed recently enough. this matters especially for
+		   clients that send a STATUS for each of their mailboxes as
+		   separate commands - without this each command would stat
+		   and possibly re-read the list index. an explicit change
+		   notification still forces a refresh, since
+		   mailbox_list_index_refresh_later() clears
+		   last_refresh_timeval. */
+		return 0;
+	}
 
 	return mailbox_list_index_refresh_force(list);
 }
@@ -640,8 +693,16 @@ int mailbox_list_index_refresh_force(struct mailbox_list *list)
 	view = mail_index_view_open(ilist->index);
 	if ((refresh = mailbox_list_index_need_refresh(ilist, view)) ||
 	    ilist->mailbox_tree == NULL) {
-		/* refresh list of mailboxes */
-		ret = mailbox_list_index_sync(list, refresh);
+		if (!refresh && ilist->mailbox_tree == NULL &&
+		    mailbox_list_index_root_unchanged(list, view)) {
+			/* first refresh for this process, but the backing
+			   store hasn't changed since the index was last
+			   synced - read the index without a directory walk */
+			ret = mailbox_list_index_parse(list, view, FALSE);
+		} else {
+			/* refresh list of mailboxes */
+			ret = mailbox_list_index_sync(list, refresh);
+		}
 		if (ret < 0) {
 			/* I/O failure - don't try to handle corruption,
 			   since we don't have the latest state. */
@@ -1155,6 +1216,9 @@ static void mailbox_list_index_init_finish(struct mailbox_list *list)
 	ilist->subs_hdr_ext_id = mail_index_ext_register(ilist->index, "subs",
 							 sizeof(uint32_t), 0,
 							 sizeof(uint32_t));
+	ilist->root_ext_id = mail_index_ext_register(ilist->index, "list-root",
+				sizeof(struct mailbox_list_index_root_header),
+				0, 0);
 	mailbox_list_index_init_pool(ilist);
 
 	mailbox_list_index_status_init_finish(list);
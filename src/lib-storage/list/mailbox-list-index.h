@@ -62,6 +62,19 @@ struct mailbox_list_index_header {
 	/* array of { uint32_t id; char name[]; } */
 };
 
+/* Stored in the "list-root" extension header. With maildir++ all mailboxes
+   are direct children of the root directory, so any mailbox create/delete/
+   rename updates the root directory's mtime. If the mtime hasn't changed
+   since the last sync, a newly started process can trust the list index
+   without walking the backing store directories. */
+struct mailbox_list_index_root_header {
+	/* root directory's st_mtime when the last sync scanned it */
+	uint32_t root_mtime;
+	/* wall clock time when the last sync scanned the root directory.
+	   zero if the root state is unknown. */
+	uint32_t sync_stamp;
+};
+
 struct mailbox_list_index_record {
 	/* points to given id in header */
 	uint32_t name_id;
@@ -102,6 +115,7 @@ struct mailbox_list_index {
 	const char *path;
 	struct mail_index *index;
 	uint32_t ext_id, msgs_ext_id, hmodseq_ext_id, subs_hdr_ext_id;
+	uint32_t root_ext_id;
 	uint32_t vsize_ext_id, first_saved_ext_id;
 	struct timeval last_refresh_timeval;
 
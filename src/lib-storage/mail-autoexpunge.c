@@ -2,6 +2,7 @@
 
 #include "lib.h"
 #include "ioloop.h"
+#include "time-util.h"
 #include "mailbox-list-iter.h"
 #include "mail-storage-private.h"
 #include "mail-namespace.h"
@@ -10,13 +11,25 @@
 
 #define AUTOEXPUNGE_LOCK_FNAME "dovecot.autoexpunge.lock"
 
+struct mail_autoexpunge_context {
+	struct mail_user *user;
+	struct file_lock *lock;
+	unsigned int expunged_count;
+
+	/* mail_autoexpunge_max_run_time deadline.
+	   unused if deadline.tv_sec == 0. */
+	struct timeval deadline;
+	bool deadline_reached:1;
+};
+
 static bool
-mailbox_autoexpunge_lock(struct mail_user *user, struct file_lock **lock)
+mailbox_autoexpunge_lock(struct mail_autoexpunge_context *ctx)
 {
+	struct mail_user *user = ctx->user;
 	const char *error;
 	int ret;
 
-	if (*lock != NULL)
+	if (ctx->lock != NULL)
 		return TRUE;
 
 	/* Try to lock the autoexpunging. If the lock already exists, another
@@ -28,7 +41,7 @@ mailbox_autoexpunge_lock(struct mail_user *user, struct file_lock **lock)
 	   and 2) it helps to avoid duplicate mails being added with
 	   lazy_expunge. */
 	ret = mail_user_lock_file_create(user, AUTOEXPUNGE_LOCK_FNAME,
-					 0, lock, &error);
+					 0, &ctx->lock, &error);
 	if (ret < 0) {
 		e_error(user->event, "autoexpunge: Couldn't create %s lock: %s",
 			AUTOEXPUNGE_LOCK_FNAME, error);
@@ -42,13 +55,31 @@ mailbox_autoexpunge_lock(struct mail_user *user, struct file_lock **lock)
 	}
 }
 
+static bool
+mailbox_autoexpunge_deadline_reached(struct mail_autoexpunge_context *ctx)
+{
+	if (ctx->deadline.tv_sec == 0 || ctx->deadline_reached)
+		return ctx->deadline_reached;
+
+	io_loop_time_refresh();
+	if (timeval_cmp(&ioloop_timeval, &ctx->deadline) < 0)
+		return FALSE;
+	ctx->deadline_reached = TRUE;
+	e_debug(ctx->user->event,
+		"autoexpunge: Stopping after expunging %u mails - "
+		"mail_autoexpunge_max_run_time reached. "
+		"The remaining mails are expunged by the following sessions.",
+		ctx->expunged_count);
+	return TRUE;
+}
+
 /* returns -1 on error, 0 when done, and 1 when there is more to do */
 static int
 mailbox_autoexpunge_batch(struct mailbox *box,
 			  const unsigned int interval_time,
 			  const unsigned int max_mails,
 			  const time_t expire_time,
-			  unsigned int *expunged_count)
+			  struct mail_autoexpunge_context *ctx)
 {
 	struct mailbox_transaction_context *t;
 	struct mail *mail;
@@ -112,7 +143,7 @@ mailbox_autoexpunge_batch(struct mailbox *box,
 	else if (count > 0 || expunges_found) {
 		if (mailbox_sync(box, 0) < 0)
 			ret = -1;
-		*expunged_count += count;
+		ctx->expunged_count += count;
 	}
 
 	if (ret < 0)
@@ -122,7 +153,8 @@ mailbox_autoexpunge_batch(struct mailbox *box,
 
 static int
 mailbox_autoexpunge(struct mailbox *box, unsigned int interval_time,
-		    unsigned int max_mails, unsigned int *expunged_count)
+		    unsigned int max_mails,
+		    struct mail_autoexpunge_context *ctx)
 {
 	struct mailbox_metadata metadata;
 	struct mailbox_status status;
@@ -160,8 +192,8 @@ mailbox_autoexpunge(struct mailbox *box, unsigned int interval_time,
 
 	do {
 		ret = mailbox_autoexpunge_batch(box, interval_time, max_mails,
-						expire_time, expunged_count);
-	} while (ret > 0);
+						expire_time, ctx);
+	} while (ret > 0 && !mailbox_autoexpunge_deadline_reached(ctx));
 
 	return ret;
 }
@@ -170,7 +202,7 @@ static void
 mailbox_autoexpunge_set(struct mail_namespace *ns, const char *vname,
 			unsigned int autoexpunge,
 			unsigned int autoexpunge_max_mails,
-			unsigned int *expunged_count)
+			struct mail_autoexpunge_context *ctx)
 {
 	struct mailbox *box;
 
@@ -179,7 +211,7 @@ mailbox_autoexpunge_set(struct mail_namespace *ns, const char *vname,
 	   the mailbox. */
 	box = mailbox_alloc(ns->list, vname, MAILBOX_FLAG_IGNORE_ACLS);
 	if (mailbox_autoexpunge(box, autoexpunge, autoexpunge_max_mails,
-				expunged_count) < 0) {
+				ctx) < 0) {
 		e_error(box->event, "Failed to autoexpunge: %s",
 			mailbox_get_last_internal_error(box, NULL));
 	}
@@ -189,7 +221,7 @@ mailbox_autoexpunge_set(struct mail_namespace *ns, const char *vname,
 static void
 mailbox_autoexpunge_wildcards(struct mail_namespace *ns,
 			      const struct mailbox_settings *set,
-			      unsigned int *expunged_count)
+			      struct mail_autoexpunge_context *ctx)
 {
 	struct mailbox_list_iterate_context *iter;
 	const struct mailbox_info *info;
@@ -200,10 +232,10 @@ mailbox_autoexpunge_wildcards(struct mail_namespace *ns,
 				      MAILBOX_LIST_ITER_NO_AUTO_BOXES |
 				      MAILBOX_LIST_ITER_SKIP_ALIASES |
 				      MAILBOX_LIST_ITER_RETURN_NO_FLAGS);
-	while ((info = mailbox_list_iter_next(iter)) != NULL) T_BEGIN {
+	while (!ctx->deadline_reached &&
+	       (info = mailbox_list_iter_next(iter)) != NULL) T_BEGIN {
 		mailbox_autoexpunge_set(ns, info->vname, set->autoexpunge,
-					set->autoexpunge_max_mails,
-					expunged_count);
+					set->autoexpunge_max_mails, ctx);
 	} T_END;
 	if (mailbox_list_iter_deinit(&iter) < 0) {
 		e_error(ns->user->event,
@@ -215,12 +247,12 @@ mailbox_autoexpunge_wildcards(struct mail_namespace *ns,
 static void
 mailbox_autoexpunge_name(struct mail_namespace *ns,
 			 struct mailbox_settings *box_set,
-			 unsigned int *expunged_count)
+			 struct mail_autoexpunge_context *ctx)
 {
 	const char *vname;
 
 	if (strpbrk(box_set->name, "*?") != NULL)
-		mailbox_autoexpunge_wildcards(ns, box_set, expunged_count);
+		mailbox_autoexpunge_wildcards(ns, box_set, ctx);
 	else {
 		if (box_set->name[0] == '\0' && ns->prefix_len > 0 &&
 		    ns->prefix[ns->prefix_len-1] == mail_namespace_get_sep(ns))
@@ -228,14 +260,13 @@ mailbox_autoexpunge_name(struct mail_namespace *ns,
 		else
 			vname = t_strconcat(ns->prefix, box_set->name, NULL);
 		mailbox_autoexpunge_set(ns, vname, box_set->autoexpunge,
-					box_set->autoexpunge_max_mails,
-					expunged_count);
+					box_set->autoexpunge_max_mails, ctx);
 	}
 }
 
 static bool
-mail_namespace_autoexpunge(struct mail_namespace *ns, struct file_lock **lock,
-			   unsigned int *expunged_count)
+mail_namespace_autoexpunge(struct mail_namespace *ns,
+			   struct mail_autoexpunge_context *ctx)
 {
 	struct mailbox_settings *box_set;
 
@@ -246,12 +277,14 @@ mail_namespace_autoexpunge(struct mail_namespace *ns, struct file_lock **lock,
 		if (box_set->autoexpunge == 0 &&
 		    box_set->autoexpunge_max_mails == 0)
 			continue;
+		if (mailbox_autoexpunge_deadline_reached(ctx))
+			break;
 
-		if (!mailbox_autoexpunge_lock(ns->user, lock))
+		if (!mailbox_autoexpunge_lock(ctx))
 			return FALSE;
 
 		T_BEGIN {
-			mailbox_autoexpunge_name(ns, box_set, expunged_count);
+			mailbox_autoexpunge_name(ns, box_set, ctx);
 		} T_END;
 	}
 	return TRUE;
@@ -259,19 +292,32 @@ mail_namespace_autoexpunge(struct mail_namespace *ns, struct file_lock **lock,
 
 unsigned int mail_user_autoexpunge(struct mail_user *user)
 {
-	struct file_lock *lock = NULL;
+	const struct mail_storage_settings *mail_set =
+		mail_user_set_get_storage_set(user);
+	struct mail_autoexpunge_context ctx;
 	struct mail_namespace *ns;
-	unsigned int expunged_count = 0;
 	struct event_reason *reason =
 		event_reason_begin("storage:autoexpunge");
 
+	i_zero(&ctx);
+	ctx.user = user;
+	if (mail_set->mail_autoexpunge_max_run_time != 0) {
+		/* expunging goes oldest-first and commits in batches, so
+		   whatever is left undone when the deadline is reached is
+		   simply continued by the next session's autoexpunge run. */
+		io_loop_time_refresh();
+		ctx.deadline = ioloop_timeval;
+		timeval_add_msecs(&ctx.deadline,
+				  mail_set->mail_autoexpunge_max_run_time);
+	}
+
 	for (ns = user->namespaces; ns != NULL; ns = ns->next) {
 		if (ns->alias_for == NULL) {
-			if (!mail_namespace_autoexpunge(ns, &lock, &expunged_count))
+			if (!mail_namespace_autoexpunge(ns, &ctx))
 				break;
 		}
 	}
 	event_reason_end(&reason);
-	file_lock_free(&lock);
-	return expunged_count;
+	file_lock_free(&ctx.lock);
+	return ctx.expunged_count;
 }
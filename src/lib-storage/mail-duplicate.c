@@ -2,6 +2,7 @@
 
 #include "lib.h"
 #include "ioloop.h"
+#include "buffer.h"
 #include "hex-binary.h"
 #include "mkdir-parents.h"
 #include "istream.h"
@@ -10,6 +11,7 @@
 #include "home-expand.h"
 #include "file-create-locked.h"
 #include "file-dotlock.h"
+#include "write-full.h"
 #include "md5.h"
 #include "hash.h"
 #include "mail-user.h"
@@ -75,8 +77,10 @@ struct mail_duplicate_transaction {
 	HASH_TABLE(struct mail_duplicate *, struct mail_duplicate *) hash;
 	const char *path;
 	unsigned int id_lock_count;
+	uoff_t db_size;
 
 	bool changed:1;
+	bool compress:1;
 };
 
 struct mail_duplicate_db {
@@ -287,9 +291,13 @@ mail_duplicate_read_records(struct mail_duplicate_transaction *trans,
 
 		if (i_stream_read_bytes(input, &data, &size,
 					hdr.id_size + hdr.user_size) <= 0) {
-			e_error(trans->event,
-				"unexpected end of file in %s", trans->path);
-			return -1;
+			/* Another process may be appending this record right
+			   now; ignore the partial tail. It gets dropped by
+			   the next compression. */
+			e_debug(trans->event,
+				"unexpected end of file in %s "
+				"(partially written record?)", trans->path);
+			return 0;
 		}
 
 		struct mail_duplicate dup_q, *dup;
@@ -325,9 +333,12 @@ mail_duplicate_read_records(struct mail_duplicate_transaction *trans,
 		i_stream_skip(input, hdr.id_size + hdr.user_size);
 	}
 
-	if (hash_table_count(trans->hash) *
-	    COMPRESS_PERCENTAGE / 100 > change_count)
-		trans->changed = TRUE;
+	if (change_count > 0 &&
+	    change_count * 100 >= (hash_table_count(trans->hash) +
+				   change_count) * COMPRESS_PERCENTAGE) {
+		/* enough expired records - rewrite the file at commit */
+		trans->compress = TRUE;
+	}
 	return 0;
 }
 
@@ -347,6 +358,7 @@ mail_duplicate_read_db_from_fd(struct mail_duplicate_transaction *trans, int fd)
 		return -1;
 	}
 	trans->db_ino = st.st_ino;
+	trans->db_size = (uoff_t)st.st_size;
 
 	/* <timestamp> <id_size> <user_size> <id> <user> */
 	input = i_stream_create_fd(fd, DUPLICATE_BUFSIZE);
@@ -355,6 +367,8 @@ mail_duplicate_read_db_from_fd(struct mail_duplicate_transaction *trans, int fd)
 		if (hdr.version == 0 || hdr.version > DUPLICATE_VERSION + 10) {
 			/* FIXME: backwards compatibility with v1.0 */
 			record_size = sizeof(time_t) + sizeof(uint32_t)*2;
+			/* can't append to the old format - rewrite */
+			trans->compress = TRUE;
 		} else if (hdr.version == DUPLICATE_VERSION) {
 			record_size = sizeof(struct mail_duplicate_record_header);
 			i_stream_skip(input, sizeof(hdr));
@@ -398,26 +412,12 @@ static int mail_duplicate_read_db_file(struct mail_duplicate_transaction *trans)
 
 static void mail_duplicate_read(struct mail_duplicate_transaction *trans)
 {
-	struct mail_duplicate_db *db = trans->db;
-	int new_fd;
-	struct dotlock *dotlock;
-
-	new_fd = file_dotlock_open(&db->dotlock_set, trans->path, 0, &dotlock);
-	if (new_fd != -1)
-		;
-	else if (errno != EAGAIN) {
-		e_error(trans->event,
-			"file_dotlock_open(%s) failed: %m", trans->path);
-	} else {
-		e_error(trans->event,
-			"Creating lock file for %s timed out in %u secs",
-			trans->path, db->dotlock_set.timeout);
-	}
-
+	/* Readers don't need the dotlock: writers either append whole records
+	   with a single write() or replace the file atomically when
+	   compressing it, so the worst a concurrent writer can cause is a
+	   partially written record at the end of the file, which is
+	   ignored. */
 	(void)mail_duplicate_read_db_file(trans);
-
-	if (dotlock != NULL)
-		file_dotlock_delete(&dotlock);
 }
 
 static void mail_duplicate_update(struct mail_duplicate_transaction *trans)
@@ -431,7 +431,8 @@ static void mail_duplicate_update(struct mail_duplicate_transaction *trans)
 			e_error(trans->event,
 				"stat(%s) failed: %m", trans->path);
 		}
-	} else if (trans->db_ino == st.st_ino) {
+	} else if (trans->db_ino == st.st_ino &&
+		   trans->db_size == (uoff_t)st.st_size) {
 		e_debug(trans->event, "DB file not changed");
 	} else {
 		e_debug(trans->event, "DB file changed: "
@@ -599,37 +600,91 @@ void mail_duplicate_mark(struct mail_duplicate_transaction *trans,
 	trans->changed = TRUE;
 }
 
-void mail_duplicate_transaction_commit(
-	struct mail_duplicate_transaction **_trans)
+static void
+mail_duplicate_record_append(buffer_t *buf, const struct mail_duplicate *d)
 {
-	struct mail_duplicate_transaction *trans = *_trans;
-	struct mail_duplicate_file_header hdr;
 	struct mail_duplicate_record_header rec;
-	struct ostream *output;
-        struct hash_iterate_context *iter;
+
+	i_zero(&rec);
+	rec.stamp = time_to_uint32_trunc(d->time);
+	rec.id_size = d->id_size;
+	rec.user_size = strlen(d->user);
+
+	buffer_append(buf, &rec, sizeof(rec));
+	buffer_append(buf, d->id, rec.id_size);
+	buffer_append(buf, d->user, rec.user_size);
+}
+
+static void
+mail_duplicate_transaction_append(struct mail_duplicate_transaction *trans)
+{
+	struct mail_duplicate_db *db = trans->db;
+	struct mail_duplicate_file_header hdr;
+	struct hash_iterate_context *iter;
 	struct mail_duplicate *d;
-	int new_fd;
 	struct dotlock *dotlock;
+	struct stat st;
+	buffer_t *buf;
+	int fd;
 
-	if (trans == NULL)
+	/* The dotlock serializes only the writers. The file is opened only
+	   after the dotlock is acquired, so a concurrent compression can't
+	   rename it away below us. */
+	if (file_dotlock_create(&db->dotlock_set, trans->path, 0,
+				&dotlock) <= 0) {
+		if (errno != EAGAIN) {
+			e_error(trans->event,
+				"file_dotlock_create(%s) failed: %m",
+				trans->path);
+		} else {
+			e_error(trans->event,
+				"Creating lock file for %s timed out in %u secs",
+				trans->path, db->dotlock_set.timeout);
+		}
 		return;
-	*_trans = NULL;
+	}
 
-	if (trans->path == NULL) {
-		e_debug(trans->event, "Commit (dummy)");
-		mail_duplicate_transaction_free(&trans);
+	fd = open(trans->path, O_WRONLY | O_APPEND | O_CREAT, 0600);
+	if (fd == -1) {
+		e_error(trans->event, "open(%s) failed: %m", trans->path);
+		file_dotlock_delete(&dotlock);
 		return;
 	}
-	if (!trans->changed) {
-		e_debug(trans->event, "Commit; no changes");
-		mail_duplicate_transaction_free(&trans);
-		return;
+
+	buf = t_buffer_create(256);
+	if (fstat(fd, &st) < 0)
+		e_error(trans->event, "fstat(%s) failed: %m", trans->path);
+	else if (st.st_size == 0) {
+		i_zero(&hdr);
+		hdr.version = DUPLICATE_VERSION;
+		buffer_append(buf, &hdr, sizeof(hdr));
 	}
 
-	struct mail_duplicate_db *db = trans->db;
+	iter = hash_table_iterate_init(trans->hash);
+	while (hash_table_iterate(iter, trans->hash, &d, &d)) {
+		if (d->marked && d->changed)
+			mail_duplicate_record_append(buf, d);
+	}
+	hash_table_iterate_deinit(&iter);
 
-	i_assert(trans->path != NULL);
-	e_debug(trans->event, "Commit; overwrite %s", trans->path);
+	/* Write everything with a single write(), so that lockless readers
+	   never see a record written only partially. */
+	if (write_full(fd, buf->data, buf->used) < 0)
+		e_error(trans->event, "write(%s) failed: %m", trans->path);
+	i_close_fd(&fd);
+	file_dotlock_delete(&dotlock);
+}
+
+static void
+mail_duplicate_transaction_compress(struct mail_duplicate_transaction *trans)
+{
+	struct mail_duplicate_db *db = trans->db;
+	struct mail_duplicate_file_header hdr;
+	struct ostream *output;
+	struct hash_iterate_context *iter;
+	struct mail_duplicate *d;
+	int new_fd;
+	struct dotlock *dotlock;
 
 	new_fd = file_dotlock_open(&db->dotlock_set, trans->path, 0, &dotlock);
 	if (new_fd != -1)
@@ -638,13 +693,11 @@ void mail_duplicate_transaction_commit(
 		e_error(trans->event,
 			"file_dotlock_open(%s) failed: %m",
 			trans->path);
-		mail_duplicate_transaction_free(&trans);
 		return;
 	} else {
 		e_error(trans->event,
 			"Creating lock file for %s timed out in %u secs",
 			trans->path, db->dotlock_set.timeout);
-		mail_duplicate_transaction_free(&trans);
 		return;
 	}
 
@@ -655,10 +708,12 @@ void mail_duplicate_transaction_commit(
 	o_stream_cork(output);
 	o_stream_nsend(output, &hdr, sizeof(hdr));
 
-	i_zero(&rec);
 	iter = hash_table_iterate_init(trans->hash);
 	while (hash_table_iterate(iter, trans->hash, &d, &d)) {
 		if (d->marked) {
+			struct mail_duplicate_record_header rec;
+
+			i_zero(&rec);
 			rec.stamp = time_to_uint32_trunc(d->time);
 			rec.id_size = d->id_size;
 			rec.user_size = strlen(d->user);
@@ -674,7 +729,7 @@ void mail_duplicate_transaction_commit(
 		e_error(trans->event, "write(%s) failed: %s",
 			trans->path, o_stream_get_error(output));
 		o_stream_unref(&output);
-		mail_duplicate_transaction_free(&trans);
+		file_dotlock_delete(&dotlock);
 		return;
 	}
 	o_stream_unref(&output);
@@ -683,6 +738,46 @@ void mail_duplicate_transaction_commit(
 		e_error(trans->event,
 			"file_dotlock_replace(%s) failed: %m", trans->path);
 	}
+}
+
+void mail_duplicate_transaction_commit(
+	struct mail_duplicate_transaction **_trans)
+{
+	struct mail_duplicate_transaction *trans = *_trans;
+        struct hash_iterate_context *iter;
+	struct mail_duplicate *d;
+
+	if (trans == NULL)
+		return;
+	*_trans = NULL;
+
+	if (trans->path == NULL) {
+		e_debug(trans->event, "Commit (dummy)");
+		mail_duplicate_transaction_free(&trans);
+		return;
+	}
+	if (!trans->changed && !trans->compress) {
+		e_debug(trans->event, "Commit; no changes");
+		mail_duplicate_transaction_free(&trans);
+		return;
+	}
+
+	i_assert(trans->path != NULL);
+
+	if (trans->compress) {
+		/* Enough expired records have accumulated - drop them by
+		   rewriting the whole file. */
+		e_debug(trans->event, "Commit; compress and overwrite %s",
+			trans->path);
+		mail_duplicate_transaction_compress(trans);
+	} else if (trans->changed) {
+		/* The common case: just append the new records. Records
+		   later in the file override earlier ones, and the IDs
+		   being written are locked, so concurrent transactions for
+		   other IDs can append in any order. */
+		e_debug(trans->event, "Commit; append to %s", trans->path);
+		mail_duplicate_transaction_append(trans);
+	}
 
 	iter = hash_table_iterate_init(trans->hash);
 	while (hash_table_iterate(iter, trans->hash, &d, &d))
@@ -114,8 +114,7 @@ enum mail_storage_class_flags {
 	MAIL_STORAGE_CLASS_FLAG_SECONDARY_INDEX	= 0x800,
 };
 
-struct mail_binary_cache {
-	struct timeout *to;
+struct mail_binary_cache_entry {
 	struct mailbox *box;
 	uint32_t uid;
 
@@ -125,6 +124,17 @@ struct mail_binary_cache {
 	uoff_t size;
 };
 
+/* Keep this many recently converted BINARY payloads around, so clients
+   alternating between parts of the same (or a few) messages don't redo the
+   decode+encode on every fetch. */
+#define MAIL_BINARY_CACHE_MAX_ENTRIES 4
+
+struct mail_binary_cache {
+	struct timeout *to;
+	/* most recently used entry first. unused entries have box=NULL. */
+	struct mail_binary_cache_entry entries[MAIL_BINARY_CACHE_MAX_ENTRIES];
+};
+
 struct mail_storage_error {
 	char *error_string;
 	enum mail_error error;
@@ -145,6 +155,11 @@ struct mail_storage {
 	   MAIL_FETCH_IMAP_BODYSTRUCTURE from the remote server. Adding fields
 	   here avoids adding them to index_mail_data.access_part. */
 	enum mail_fetch_field nonbody_access_fields;
+	/* How many mails ahead searches prefetch when the
+	   mail_prefetch_count setting is 0. Remote storage backends
+	   (e.g. imapc) set this to pipeline their lookups instead of
+	   spending a network round trip on each mail. */
+	unsigned int default_mail_prefetch_count;
 	struct event_category *event_category;
 
         struct mail_storage_vfuncs v, *vlast;
@@ -437,6 +452,7 @@ struct mailbox {
 	enum mailbox_feature enabled_features;
 	struct mail_msgpart_partial_cache partial_cache;
 	uint32_t vsize_hdr_ext_id;
+	uint32_t stats_hdr_ext_id;
 	uint32_t pop3_uidl_hdr_ext_id;
 	uint32_t box_name_hdr_ext_id;
 	uint32_t box_last_rename_stamp_ext_id;
@@ -3,6 +3,7 @@
 #include "lib.h"
 #include "ioloop.h"
 #include "array.h"
+#include "llist.h"
 #include "base64.h"
 #include "hostpid.h"
 #include "module-dir.h"
@@ -39,6 +40,10 @@
 #define MAX_TIME_BACKWARDS_SLEEP_MSECS  (5*1000)
 #define MAX_NOWARN_FORWARD_MSECS        (10*1000)
 
+/* How long cached user lookups are reused before the userdb lookup and
+   settings are refreshed. */
+#define MAIL_STORAGE_SERVICE_USER_CACHE_TTL_SECS 60
+
 struct mail_storage_service_privileges {
 	uid_t uid;
 	gid_t gid;
@@ -61,6 +66,11 @@ struct mail_storage_service_ctx {
 	pool_t userdb_next_pool;
 	const char *const **userdb_next_fieldsp;
 
+	/* LRU of cached user lookups, most recently used first. See
+	   mail_storage_service_set_user_cache_size(). */
+	struct mail_storage_service_user *user_cache_head, *user_cache_tail;
+	unsigned int user_cache_count, user_cache_max;
+
 	bool debug:1;
 	bool log_initialized:1;
 	bool config_permission_denied:1;
@@ -79,6 +89,12 @@ struct mail_storage_service_user {
 	struct ioloop_context *ioloop_ctx;
 	const char *log_prefix, *auth_mech, *auth_token, *auth_user;
 
+	/* linkage in service_ctx->user_cache_head/tail */
+	struct mail_storage_service_user *cache_prev, *cache_next;
+	time_t cache_created;
+	/* replaces input.session_id when a cached lookup is reused */
+	char *session_id_override;
+
 	const char *system_groups_user, *uid_source, *gid_source;
 	const char *chdir_path;
 	const struct mail_user_settings *user_set;
@@ -91,6 +107,7 @@ struct mail_storage_service_user {
 	bool admin:1;
 	bool master_service_user_set:1;
 	bool home_from_userdb:1;
+	bool cached:1;
 };
 
 struct module *mail_storage_service_modules = NULL;
@@ -1221,6 +1238,143 @@ mail_storage_service_generate_session_id(pool_t pool, const char *prefix)
 
 }
 
+static void
+mail_storage_service_user_cache_remove(struct mail_storage_service_ctx *ctx,
+				       struct mail_storage_service_user *user)
+{
+	i_assert(user->cached);
+
+	DLLIST2_REMOVE_FULL(&ctx->user_cache_head, &ctx->user_cache_tail,
+			    user, cache_prev, cache_next);
+	i_assert(ctx->user_cache_count > 0);
+	ctx->user_cache_count--;
+	user->cached = FALSE;
+	mail_storage_service_user_unref(&user);
+}
+
+static bool
+mail_storage_service_user_cache_match(struct mail_storage_service_user *user,
+				      const struct mail_storage_service_input *input,
+				      enum mail_storage_service_flags flags)
+{
+	const struct mail_storage_service_input *cached = &user->input;
+
+	return user->flags == flags &&
+		strcmp(cached->username, input->username) == 0 &&
+		null_strcmp(cached->service, input->service) == 0 &&
+		net_ip_compare(&cached->local_ip, &input->local_ip) &&
+		net_ip_compare(&cached->remote_ip, &input->remote_ip) &&
+		cached->local_port == input->local_port &&
+		cached->remote_port == input->remote_port &&
+		cached->debug == input->debug &&
+		cached->end_client_tls_secured == input->end_client_tls_secured &&
+		cached->autocreated == input->autocreated;
+}
+
+static void
+mail_storage_service_user_cache_refresh(struct mail_storage_service_ctx *ctx,
+					struct mail_storage_service_user *user,
+					const struct mail_storage_service_input *input)
+{
+	/* the cached lookup is being reused for a new session - refresh the
+	   session-specific state. */
+	i_free(user->session_id_override);
+	if (input->session_id != NULL)
+		user->session_id_override = i_strdup(input->session_id);
+	else T_BEGIN {
+		user->session_id_override = i_strdup(
+			mail_storage_service_generate_session_id(
+				unsafe_data_stack_pool,
+				input->session_id_prefix));
+	} T_END;
+	user->input.session_id = user->session_id_override;
+	user->input.session_create_time = input->session_create_time;
+	user->input.event_parent = input->event_parent;
+	user->input.no_free_init_failure = input->no_free_init_failure;
+	user->session_id_counter = 0;
+
+	event_unref(&user->event);
+	user->event = event_create(input->event_parent);
+	event_set_forced_debug(user->event, ctx->debug ||
+		(user->flags & MAIL_STORAGE_SERVICE_FLAG_DEBUG) != 0);
+	event_add_fields(user->event, (const struct event_add_field []){
+		{ .key = "user", .value = user->input.username },
+		{ .key = "session", .value = user->input.session_id },
+		{ .key = "service", .value = input->service != NULL ?
+			input->service : ctx->service->name },
+		{ .key = NULL }
+	});
+}
+
+static struct mail_storage_service_user *
+mail_storage_service_user_cache_lookup(struct mail_storage_service_ctx *ctx,
+				       const struct mail_storage_service_input *input,
+				       enum mail_storage_service_flags flags)
+{
+	struct mail_storage_service_user *user, *next;
+
+	for (user = ctx->user_cache_head; user != NULL; user = next) {
+		next = user->cache_next;
+		if (ioloop_time - user->cache_created >
+		    MAIL_STORAGE_SERVICE_USER_CACHE_TTL_SECS) {
+			/* expired - make sure userdb and config changes
+			   become visible. everything after this entry is
+			   older, so drop it as well. */
+			do {
+				next = user->cache_next;
+				mail_storage_service_user_cache_remove(ctx, user);
+				user = next;
+			} while (user != NULL);
+			break;
+		}
+		if (mail_storage_service_user_cache_match(user, input, flags)) {
+			if (user != ctx->user_cache_head) {
+				DLLIST2_REMOVE_FULL(&ctx->user_cache_head,
+						    &ctx->user_cache_tail,
+						    user, cache_prev, cache_next);
+				DLLIST2_PREPEND_FULL(&ctx->user_cache_head,
+						     &ctx->user_cache_tail,
+						     user, cache_prev, cache_next);
+			}
+			mail_storage_service_user_cache_refresh(ctx, user, input);
+			return user;
+		}
+	}
+	return NULL;
+}
+
+static void
+mail_storage_service_user_cache_add(struct mail_storage_service_ctx *ctx,
+				    struct mail_storage_service_user *user,
+				    const struct mail_storage_service_input *input)
+{
+	if (strcmp(user->input.username, input->username) != 0) {
+		/* userdb changed the username. keep the cache keyed on the
+		   requested username only. */
+		return;
+	}
+
+	/* the input's service string may not live as long as the cached
+	   user does. */
+	user->input.service = p_strdup(user->pool, user->input.service);
+
+	mail_storage_service_user_ref(user);
+	user->cached = TRUE;
+	user->cache_created = ioloop_time;
+	DLLIST2_PREPEND_FULL(&ctx->user_cache_head, &ctx->user_cache_tail,
+			     user, cache_prev, cache_next);
+	if (++ctx->user_cache_count > ctx->user_cache_max)
+		mail_storage_service_user_cache_remove(ctx, ctx->user_cache_tail);
+}
+
+void mail_storage_service_set_user_cache_size(struct mail_storage_service_ctx *ctx,
+					      unsigned int max_count)
+{
+	ctx->user_cache_max = max_count;
+	while (ctx->user_cache_count > ctx->user_cache_max)
+		mail_storage_service_user_cache_remove(ctx, ctx->user_cache_tail);
+}
+
 static int
 mail_storage_service_lookup_real(struct mail_storage_service_ctx *ctx,
 				 const struct mail_storage_service_input *input,
@@ -1237,9 +1391,27 @@ mail_storage_service_lookup_real(struct mail_storage_service_ctx *ctx,
 	pool_t user_pool, temp_pool;
 	int ret = 1;
 
-	user_pool = pool_alloconly_create(MEMPOOL_GROWING"mail storage service user", 1024*6);
 	flags = mail_storage_service_input_get_flags(ctx, input);
 
+	/* lookups with caller-provided settings or userdb fields, or whose
+	   userdb fields the caller wants back, can't be shared. */
+	bool cacheable = ctx->user_cache_max > 0 &&
+		ctx->userdb_next_pool == NULL &&
+		input->userdb_fields == NULL &&
+		input->forward_fields == NULL &&
+		input->unexpanded_set_parser == NULL;
+	if (cacheable) {
+		struct mail_storage_service_user *cached_user =
+			mail_storage_service_user_cache_lookup(ctx, input, flags);
+		if (cached_user != NULL) {
+			mail_storage_service_user_ref(cached_user);
+			*user_r = cached_user;
+			return 1;
+		}
+	}
+
+	user_pool = pool_alloconly_create(MEMPOOL_GROWING"mail storage service user", 1024*6);
+
 	if ((flags & MAIL_STORAGE_SERVICE_FLAG_TEMP_PRIV_DROP) != 0 &&
 	    geteuid() != 0 &&
 	    (flags & MAIL_STORAGE_SERVICE_FLAG_NO_RESTRICT_ACCESS) == 0) {
@@ -1404,6 +1576,8 @@ mail_storage_service_lookup_real(struct mail_storage_service_ctx *ctx,
 
 	if (ret < 0)
 		mail_storage_service_user_unref(&user);
+	else if (cacheable)
+		mail_storage_service_user_cache_add(ctx, user, input);
 	*user_r = user;
 	return ret;
 }
@@ -1663,6 +1837,7 @@ void mail_storage_service_user_unref(struct mail_storage_service_user **_user)
 
 	settings_parser_unref(&user->set_parser);
 	event_unref(&user->event);
+	i_free(user->session_id_override);
 	pool_unref(&user->pool);
 }
 
@@ -1733,6 +1908,8 @@ void mail_storage_service_deinit(struct mail_storage_service_ctx **_ctx)
 
 	*_ctx = NULL;
 	(void)mail_storage_service_all_iter_deinit(ctx);
+	while (ctx->user_cache_head != NULL)
+		mail_storage_service_user_cache_remove(ctx, ctx->user_cache_head);
 	if (ctx->conn != NULL) {
 		if (mail_user_auth_master_conn == ctx->conn)
 			mail_user_auth_master_conn = NULL;
@@ -99,6 +99,15 @@ int mail_storage_service_read_settings(struct mail_storage_service_ctx *ctx,
 void mail_storage_service_init_settings(struct mail_storage_service_ctx *ctx,
 					const struct mail_storage_service_input *input)
 	ATTR_NULL(2);
+/* Cache the results of the last max_count user lookups, so repeated lookups
+   of the same user skip the userdb lookup and settings post-processing.
+   Cached results expire after 60 seconds, so userdb and configuration
+   changes aren't delayed for long. This is meant for long-running processes
+   that serve the same users repeatedly, such as lmtp. The cached lookups are
+   returned as-is, so the cache must not be enabled if the caller modifies
+   the settings of the returned users. max_count=0 disables the cache. */
+void mail_storage_service_set_user_cache_size(struct mail_storage_service_ctx *ctx,
+					      unsigned int max_count);
 /* Returns 1 if ok, 0 if user wasn't found, -1 if fatal error,
    -2 if error is user-specific (e.g. invalid settings). */
 int mail_storage_service_lookup(struct mail_storage_service_ctx *ctx,
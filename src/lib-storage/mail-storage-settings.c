@@ -64,6 +64,7 @@ static const struct setting_define mail_storage_setting_defines[] = {
 	DEF(UINT, mail_max_keyword_length),
 	DEF(TIME, mail_max_lock_timeout),
 	DEF(TIME, mail_temp_scan_interval),
+	DEF(TIME_MSECS, mail_autoexpunge_max_run_time),
 	DEF(UINT, mail_vsize_bg_after_count),
 	DEF(UINT, mail_sort_max_read_count),
 	DEF(BOOL, mail_save_crlf),
@@ -75,6 +76,7 @@ static const struct setting_define mail_storage_setting_defines[] = {
 	DEF(BOOL, mailbox_list_index),
 	DEF(BOOL, mailbox_list_index_very_dirty_syncs),
 	DEF(BOOL, mailbox_list_index_include_inbox),
+	DEF(TIME_MSECS, mailbox_list_index_refresh_interval),
 	DEF(BOOL, mail_debug),
 	DEF(BOOL, mail_full_filesystem_access),
 	DEF(BOOL, maildir_stat_dirs),
@@ -122,6 +124,7 @@ const struct mail_storage_settings mail_storage_default_settings = {
 	.mail_max_keyword_length = 50,
 	.mail_max_lock_timeout = 0,
 	.mail_temp_scan_interval = 7*24*60*60,
+	.mail_autoexpunge_max_run_time = 0,
 	.mail_vsize_bg_after_count = 0,
 	.mail_sort_max_read_count = 0,
 	.mail_save_crlf = FALSE,
@@ -133,6 +136,7 @@ const struct mail_storage_settings mail_storage_default_settings = {
 	.mailbox_list_index = TRUE,
 	.mailbox_list_index_very_dirty_syncs = FALSE,
 	.mailbox_list_index_include_inbox = FALSE,
+	.mailbox_list_index_refresh_interval = 0,
 	.mail_debug = FALSE,
 	.mail_full_filesystem_access = FALSE,
 	.maildir_stat_dirs = FALSE,
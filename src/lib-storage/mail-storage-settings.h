@@ -44,6 +44,7 @@ struct mail_storage_settings {
 	unsigned int mail_max_keyword_length;
 	unsigned int mail_max_lock_timeout;
 	unsigned int mail_temp_scan_interval;
+	unsigned int mail_autoexpunge_max_run_time;
 	unsigned int mail_vsize_bg_after_count;
 	unsigned int mail_sort_max_read_count;
 	bool mail_save_crlf;
@@ -55,6 +56,7 @@ struct mail_storage_settings {
 	bool mailbox_list_index;
 	bool mailbox_list_index_very_dirty_syncs;
 	bool mailbox_list_index_include_inbox;
+	unsigned int mailbox_list_index_refresh_interval;
 	bool mail_debug;
 	bool mail_full_filesystem_access;
 	bool maildir_stat_dirs;
@@ -137,14 +137,27 @@ static struct mail_storage *
 mail_storage_autodetect(const struct mail_namespace *ns,
 			struct mailbox_list_settings *set)
 {
+	struct mail_storage *prev_class = ns->user->autodetected_class;
 	struct mail_storage *const *classes;
 	unsigned int i, count;
 
+	/* the user's namespaces usually share the same driverless
+	   mail_location, so the class detected for the previous namespace is
+	   very likely the right one here too. trying it first avoids
+	   repeating the other classes' filesystem checks for every
+	   namespace. */
+	if (prev_class != NULL && prev_class->v.autodetect(ns, set))
+		return prev_class;
+
 	classes = array_get(&mail_storage_classes, &count);
 	for (i = 0; i < count; i++) {
+		if (classes[i] == prev_class)
+			continue;
 		if (classes[i]->v.autodetect != NULL) {
-			if (classes[i]->v.autodetect(ns, set))
+			if (classes[i]->v.autodetect(ns, set)) {
+				ns->user->autodetected_class = classes[i];
 				return classes[i];
+			}
 		}
 	}
 	return NULL;
@@ -1768,12 +1781,39 @@ enum mailbox_feature mailbox_get_enabled_features(struct mailbox *box)
 
 void mail_storage_free_binary_cache(struct mail_storage *storage)
 {
-	if (storage->binary_cache.box == NULL)
+	struct mail_binary_cache *cache = &storage->binary_cache;
+	unsigned int i;
+
+	if (cache->entries[0].box == NULL)
 		return;
 
-	timeout_remove(&storage->binary_cache.to);
-	i_stream_destroy(&storage->binary_cache.input);
-	i_zero(&storage->binary_cache);
+	timeout_remove(&cache->to);
+	for (i = 0; i < MAIL_BINARY_CACHE_MAX_ENTRIES; i++) {
+		if (cache->entries[i].box != NULL)
+			i_stream_destroy(&cache->entries[i].input);
+	}
+	i_zero(cache);
+}
+
+static void mail_storage_binary_cache_drop_box(struct mailbox *box)
+{
+	struct mail_binary_cache *cache = &box->storage->binary_cache;
+	struct mail_binary_cache_entry *entries = cache->entries;
+	unsigned int i, j;
+
+	for (i = j = 0; i < MAIL_BINARY_CACHE_MAX_ENTRIES; i++) {
+		if (entries[i].box == NULL)
+			break;
+		if (entries[i].box == box) {
+			i_stream_destroy(&entries[i].input);
+			continue;
+		}
+		entries[j++] = entries[i];
+	}
+	for (; j < MAIL_BINARY_CACHE_MAX_ENTRIES; j++)
+		i_zero(&entries[j]);
+	if (entries[0].box == NULL)
+		timeout_remove(&cache->to);
 }
 
 void mailbox_close(struct mailbox *box)
@@ -1789,8 +1829,7 @@ void mailbox_close(struct mailbox *box)
 		box->v.close(box);
 	} T_END;
 
-	if (box->storage->binary_cache.box == box)
-		mail_storage_free_binary_cache(box->storage);
+	mail_storage_binary_cache_drop_box(box);
 	box->opened = FALSE;
 	box->mailbox_deleted = FALSE;
 	array_clear(&box->search_results);
@@ -1903,7 +1942,10 @@ int mailbox_create(struct mailbox *box, const struct mailbox_update *update,
 	mailbox_list_unlock(box->list);
 
 	if (ret == 0) {
-		box->list->guid_cache_updated = TRUE;
+		if (directory)
+			box->list->guid_cache_updated = TRUE;
+		else
+			mailbox_guid_cache_add(box);
 		if (!box->inbox_any) T_BEGIN {
 			mailbox_copy_cache_decisions_from_inbox(box);
 		} T_END;
@@ -2543,6 +2585,16 @@ mailbox_search_set_progress_hidden(struct mail_search_context *ctx, bool hidden)
 	ctx->progress_hidden = hidden;
 }
 
+void mailbox_search_set_prefetch_window(struct mail_search_context *ctx,
+					unsigned int count)
+{
+	i_assert(array_count(&ctx->mails) == 0);
+
+	ctx->max_mails = count + 1;
+	if (ctx->max_mails == 0)
+		ctx->max_mails = UINT_MAX;
+}
+
 void mailbox_search_notify(struct mailbox *box, struct mail_search_context *ctx)
 {
 	if (ctx->search_start_time.tv_sec == 0) {
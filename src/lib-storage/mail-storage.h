@@ -730,6 +730,13 @@ bool mailbox_get_expunges(struct mailbox *box, uint64_t prev_modseq,
 bool mailbox_get_expunged_uids(struct mailbox *box, uint64_t prev_modseq,
 			       const ARRAY_TYPE(seq_range) *uids_filter,
 			       ARRAY_TYPE(seq_range) *expunged_uids);
+/* Get list of messages whose flags, keywords or modseqs have been changed
+   after prev_modseq, as seen from the transaction log. The result may also
+   include UIDs of already expunged messages. Returns TRUE if ok, FALSE if
+   modseq is lower than we can check for (the caller should fall back to
+   looking up all the messages' modseqs). */
+bool mailbox_get_flag_update_uids(struct mailbox *box, uint64_t prev_modseq,
+				  ARRAY_TYPE(seq_range) *uids_r);
 
 /* Initialize header lookup for given headers. */
 struct mailbox_header_lookup_ctx *
@@ -754,6 +761,14 @@ int mailbox_search_deinit(struct mail_search_context **ctx);
 void mailbox_search_set_progress_hidden(struct mail_search_context *ctx,
 					bool hidden);
 void mailbox_search_reset_progress_start(struct mail_search_context *ctx);
+/* Declare how many mails ahead of the currently accessed mail the backend
+   may prefetch with mail_prefetch() during this search. This overrides the
+   mail_prefetch_count setting for the search. count=0 disables prefetching,
+   which avoids allocating the extra mails for the prefetch window when the
+   caller knows it won't read the mails' contents. Must be called before
+   searching the first mail. */
+void mailbox_search_set_prefetch_window(struct mail_search_context *ctx,
+					unsigned int count);
 /* Search the next message. Returns TRUE if found, FALSE if not. */
 bool mailbox_search_next(struct mail_search_context *ctx, struct mail **mail_r);
 /* Like mailbox_search_next(), but don't spend too much time searching.
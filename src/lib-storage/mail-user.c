@@ -321,11 +321,20 @@ void mail_user_set_vars(struct mail_user *user, const char *service,
 
 	user->service = p_strdup(user->pool, service);
 	mail_user_connection_init_from(&user->conn, user->pool, conn);
+	/* the cached %variable expansion table refers to the old values */
+	user->var_expand_table = NULL;
 }
 
 const struct var_expand_table *
 mail_user_var_expand_table(struct mail_user *user)
 {
+	/* use a cached table, unless it hasn't been generated yet or
+	   mail_user_set_vars() invalidated it. all the values are allocated
+	   from user->pool, so regenerating the table on every settings
+	   expansion would just leak the old copies until the user is freed. */
+	if (user->var_expand_table != NULL)
+		return user->var_expand_table;
+
 	const char *username =
 		p_strdup(user->pool, t_strcut(user->username, '@'));
 	const char *domain = i_strchr_to_next(user->username, '@');
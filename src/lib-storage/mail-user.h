@@ -69,6 +69,11 @@ struct mail_user {
 	normalizer_func_t *default_normalizer;
 	/* Filled lazily by mailbox_attribute_*() when accessing attributes. */
 	struct dict *_attr_dict;
+	/* The storage class that mail location autodetection found for the
+	   previous namespace, if any. Namespaces commonly share a driverless
+	   mail_location, so try this class first and avoid repeating the
+	   other classes' filesystem checks for every namespace. */
+	struct mail_storage *autodetected_class;
 
 	/* Module-specific contexts. See mail_storage_module_id. */
 	ARRAY(union mail_user_module_context *) module_contexts;
@@ -150,7 +155,8 @@ struct mail_user *mail_user_find(struct mail_user *user, const char *name);
 /* Specify mail location %variable expansion data. */
 void mail_user_set_vars(struct mail_user *user, const char *service,
 			const struct mail_user_connection_data *conn);
-/* Return %variable expansion table for the user. */
+/* Return %variable expansion table for the user. The table is generated on
+   the first call and cached; mail_user_set_vars() invalidates the cache. */
 const struct var_expand_table *
 mail_user_var_expand_table(struct mail_user *user);
 /* Expand %variables for the user. The settings values may be allocated from
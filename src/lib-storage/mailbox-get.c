@@ -237,3 +237,97 @@ bool mailbox_get_expunged_uids(struct mailbox *box, uint64_t prev_modseq,
 	return mailbox_get_expunges_full(box, prev_modseq,
 					 uids_filter, expunged_uids, NULL);
 }
+
+static void
+add_flag_update_uids(ARRAY_TYPE(seq_range) *uids,
+		     const struct mail_transaction_flag_update *src,
+		     size_t src_size)
+{
+	const struct mail_transaction_flag_update *end;
+
+	end = CONST_PTR_OFFSET(src, src_size);
+	for (; src != end; src++)
+		seq_range_array_add_range(uids, src->uid1, src->uid2);
+}
+
+static void
+add_keyword_update_uids(ARRAY_TYPE(seq_range) *uids,
+			const struct mail_transaction_keyword_update *rec,
+			size_t src_size)
+{
+	const uint32_t *rec_uids, *end;
+	unsigned int uids_offset;
+
+	uids_offset = sizeof(*rec) + rec->name_size;
+	if ((uids_offset % 4) != 0)
+		uids_offset += 4 - (uids_offset % 4);
+
+	rec_uids = CONST_PTR_OFFSET(rec, uids_offset);
+	end = CONST_PTR_OFFSET(rec, src_size);
+	for (; rec_uids + 2 <= end; rec_uids += 2)
+		seq_range_array_add_range(uids, rec_uids[0], rec_uids[1]);
+}
+
+static void
+add_keyword_reset_uids(ARRAY_TYPE(seq_range) *uids,
+		       const struct mail_transaction_keyword_reset *src,
+		       size_t src_size)
+{
+	const struct mail_transaction_keyword_reset *end;
+
+	end = CONST_PTR_OFFSET(src, src_size);
+	for (; src != end; src++)
+		seq_range_array_add_range(uids, src->uid1, src->uid2);
+}
+
+static void
+add_modseq_update_uids(ARRAY_TYPE(seq_range) *uids,
+		       const struct mail_transaction_modseq_update *src,
+		       size_t src_size)
+{
+	const struct mail_transaction_modseq_update *end;
+
+	end = CONST_PTR_OFFSET(src, src_size);
+	for (; src != end; src++)
+		seq_range_array_add(uids, src->uid);
+}
+
+bool mailbox_get_flag_update_uids(struct mailbox *box, uint64_t prev_modseq,
+				  ARRAY_TYPE(seq_range) *uids_r)
+{
+	struct mail_transaction_log_view *log_view;
+	const struct mail_transaction_header *thdr;
+	const void *tdata;
+	bool modseq_too_old;
+	int ret;
+
+	ret = mailbox_get_expunges_init(box, prev_modseq, &log_view,
+					&modseq_too_old);
+	if (ret != 0)
+		return ret > 0;
+	if (modseq_too_old) {
+		/* we can't see all the changes since prev_modseq */
+		mail_transaction_log_view_close(&log_view);
+		return FALSE;
+	}
+
+	while ((ret = mail_transaction_log_view_next(log_view,
+						     &thdr, &tdata)) > 0) {
+		switch (thdr->type & MAIL_TRANSACTION_TYPE_MASK) {
+		case MAIL_TRANSACTION_FLAG_UPDATE:
+			add_flag_update_uids(uids_r, tdata, thdr->size);
+			break;
+		case MAIL_TRANSACTION_KEYWORD_UPDATE:
+			add_keyword_update_uids(uids_r, tdata, thdr->size);
+			break;
+		case MAIL_TRANSACTION_KEYWORD_RESET:
+			add_keyword_reset_uids(uids_r, tdata, thdr->size);
+			break;
+		case MAIL_TRANSACTION_MODSEQ_UPDATE:
+			add_modseq_update_uids(uids_r, tdata, thdr->size);
+			break;
+		}
+	}
+	mail_transaction_log_view_close(&log_view);
+	return ret == 0;
+}
@@ -37,13 +37,31 @@ int mailbox_guid_cache_find(struct mailbox_list *list,
 	return 0;
 }
 
+static void mailbox_guid_cache_insert(struct mailbox_list *list,
+				      const guid_128_t guid, const char *vname)
+{
+	struct mailbox_guid_cache_rec *rec;
+	uint8_t *guid_p;
+
+	rec = hash_table_lookup(list->guid_cache, (const uint8_t *)guid);
+	if (rec != NULL) {
+		e_warning(list->ns->user->event,
+			  "Mailbox %s has duplicate GUID with %s: %s",
+			  vname, rec->vname, guid_128_to_string(guid));
+		return;
+	}
+	rec = p_new(list->guid_cache_pool, struct mailbox_guid_cache_rec, 1);
+	memcpy(rec->guid, guid, sizeof(rec->guid));
+	rec->vname = p_strdup(list->guid_cache_pool, vname);
+	guid_p = rec->guid;
+	hash_table_insert(list->guid_cache, guid_p, rec);
+}
+
 static void mailbox_guid_cache_add_mailbox(struct mailbox_list *list,
 					   const struct mailbox_info *info)
 {
 	struct mailbox *box;
 	struct mailbox_metadata metadata;
-	struct mailbox_guid_cache_rec *rec;
-	uint8_t *guid_p;
 
 	box = mailbox_alloc(list, info->vname, 0);
 	if (mailbox_get_metadata(box, MAILBOX_METADATA_GUID,
@@ -51,23 +69,34 @@ static void mailbox_guid_cache_add_mailbox(struct mailbox_list *list,
 		e_error(box->event, "Couldn't get mailbox GUID: %s",
 			mailbox_get_last_internal_error(box, NULL));
 		list->guid_cache_errors = TRUE;
-	} else if ((rec = hash_table_lookup(list->guid_cache,
-			(const uint8_t *)metadata.guid)) != NULL) {
-		e_warning(list->ns->user->event,
-			  "Mailbox %s has duplicate GUID with %s: %s",
-			  info->vname, rec->vname,
-			  guid_128_to_string(metadata.guid));
 	} else {
-		rec = p_new(list->guid_cache_pool,
-			    struct mailbox_guid_cache_rec, 1);
-		memcpy(rec->guid, metadata.guid, sizeof(rec->guid));
-		rec->vname = p_strdup(list->guid_cache_pool, info->vname);
-		guid_p = rec->guid;
-		hash_table_insert(list->guid_cache, guid_p, rec);
+		mailbox_guid_cache_insert(list, metadata.guid, info->vname);
 	}
 	mailbox_free(&box);
 }
 
+void mailbox_guid_cache_add(struct mailbox *box)
+{
+	struct mailbox_list *list = box->list;
+	struct mailbox_metadata metadata;
+
+	if (!hash_table_is_created(list->guid_cache) ||
+	    list->guid_cache_invalidated) {
+		/* the cache hasn't been built, or it's going to be rebuilt
+		   on the next lookup anyway. */
+		list->guid_cache_updated = TRUE;
+		return;
+	}
+	if (mailbox_get_metadata(box, MAILBOX_METADATA_GUID, &metadata) < 0 ||
+	    guid_128_is_empty(metadata.guid)) {
+		/* fall back to rebuilding the cache on the next miss */
+		list->guid_cache_updated = TRUE;
+		return;
+	}
+	mailbox_guid_cache_insert(list, metadata.guid,
+				  mailbox_get_vname(box));
+}
+
 void mailbox_guid_cache_refresh(struct mailbox_list *list)
 {
 	struct mailbox_list_iterate_context *ctx;
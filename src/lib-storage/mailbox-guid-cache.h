@@ -1,8 +1,14 @@
 #ifndef MAILBOX_GUID_CACHE_H
 #define MAILBOX_GUID_CACHE_H
 
+struct mailbox;
+
 int mailbox_guid_cache_find(struct mailbox_list *list, const guid_128_t guid,
 			    const char **vname_r);
+/* Add a newly created mailbox to an already built GUID cache, so the next
+   lookup doesn't have to rebuild the whole cache. If the cache hasn't been
+   built (or the GUID can't be looked up), just mark the cache updated. */
+void mailbox_guid_cache_add(struct mailbox *box);
 void mailbox_guid_cache_refresh(struct mailbox_list *list);
 
 #endif
@@ -10,6 +10,9 @@
 #include <sys/stat.h>
 
 #define NOTIFY_DELAY_MSECS 500
+/* when all the watched files have working filesystem notifications, the
+   polling is only a safety net and can run this much less often. */
+#define NOTIFY_BACKUP_POLL_MULTIPLIER 10
 
 struct mailbox_notify_file {
 	struct mailbox_notify_file *next;
@@ -54,12 +57,24 @@ static void notify_callback(struct mailbox *box)
 	}
 }
 
+static bool mailbox_watch_have_all_notifies(struct mailbox *box)
+{
+	struct mailbox_notify_file *file;
+
+	for (file = box->notify_files; file != NULL; file = file->next) {
+		if (file->io_notify == NULL)
+			return FALSE;
+	}
+	return TRUE;
+}
+
 void mailbox_watch_add(struct mailbox *box, const char *path)
 {
 	const struct mail_storage_settings *set = box->storage->set;
 	struct mailbox_notify_file *file;
 	struct stat st;
 	struct io *io = NULL;
+	unsigned int msecs;
 
 	i_assert(set->mailbox_idle_check_interval > 0);
 
@@ -74,14 +89,16 @@ void mailbox_watch_add(struct mailbox *box, const char *path)
 	file->next = box->notify_files;
 	box->notify_files = file;
 
-	/* we still add a timeout if we don't have one already,
-	 * because we don't know what happens with [di]notify
-	 * when the filesystem is remote (NFS, ...) */
-	if (box->to_notify == NULL) {
-		box->to_notify =
-			timeout_add(set->mailbox_idle_check_interval * 1000,
-				    notify_timeout, box);
-	}
+	/* we still add a timeout, because we don't know what happens
+	 * with [di]notify when the filesystem is remote (NFS, ...).
+	 * with notifications working on local storage it's just a
+	 * safety net, so poll much less often to avoid a stat() storm
+	 * when many clients IDLE on the same hot mailboxes. */
+	msecs = set->mailbox_idle_check_interval * 1000;
+	if (mailbox_watch_have_all_notifies(box) && !set->mail_nfs_storage)
+		msecs *= NOTIFY_BACKUP_POLL_MULTIPLIER;
+	timeout_remove(&box->to_notify);
+	box->to_notify = timeout_add(msecs, notify_timeout, box);
 }
 
 void mailbox_watch_remove_all(struct mailbox *box)
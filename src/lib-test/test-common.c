@@ -1,6 +1,7 @@
 /* Copyright (c) 2007-2018 Dovecot authors, see the included COPYING file */
 
 #include "lib.h"
+#include "time-util.h"
 #include "test-common.h"
 
 #include <stdio.h>
@@ -39,6 +40,112 @@ bool test_has_failed(void)
 	return !test_success;
 }
 
+/* run each benchmark loop for at least this long */
+#define TEST_BENCH_MIN_RUN_NSECS (100ULL * 1000000)
+/* What the calibration loop takes on the nominal machine that the
+   test_assert_faster_than() limits are written against (roughly a 3 GHz
+   x86-64). A machine where the loop takes twice this long gets twice the
+   limit. */
+#define TEST_BENCH_CALIBRATION_NOMINAL_NSECS 2000000ULL
+#define TEST_BENCH_CALIBRATION_ROUNDS 1000000
+
+static uint64_t bench_calibration_nsecs;
+static uint64_t bench_start_nsecs;
+static uint64_t bench_iterations, bench_check_mask;
+static uint64_t bench_ns_per_op;
+static bool bench_skipped;
+static volatile uint64_t bench_calibration_sink;
+
+static void test_bench_calibrate(void)
+{
+	unsigned int tries, i;
+	uint64_t x = 123456789, start, elapsed;
+
+	if (bench_calibration_nsecs != 0)
+		return;
+
+	bench_calibration_nsecs = UINT64_MAX;
+	for (tries = 0; tries < 3; tries++) {
+		start = i_nanoseconds();
+		for (i = 0; i < TEST_BENCH_CALIBRATION_ROUNDS; i++) {
+			/* xorshift64 */
+			x ^= x << 13;
+			x ^= x >> 7;
+			x ^= x << 17;
+		}
+		elapsed = i_nanoseconds() - start;
+		bench_calibration_nsecs =
+			I_MIN(bench_calibration_nsecs, elapsed);
+	}
+	/* keep the loop from being optimized away */
+	bench_calibration_sink = x;
+	bench_calibration_nsecs = I_MAX(bench_calibration_nsecs, 1);
+}
+
+void test_begin_bench(const char *name)
+{
+	test_begin(name);
+	bench_iterations = 0;
+	bench_check_mask = 0;
+	bench_ns_per_op = 0;
+	bench_skipped = ON_VALGRIND ||
+		null_strcmp(getenv("DOVECOT_TEST_BENCH"), "0") == 0;
+	if (!bench_skipped)
+		test_bench_calibrate();
+}
+
+bool test_bench_loop(void)
+{
+	uint64_t elapsed;
+
+	if (bench_skipped)
+		return FALSE;
+	if (bench_iterations == 0)
+		bench_start_nsecs = i_nanoseconds();
+	else if ((bench_iterations & bench_check_mask) == 0) {
+		elapsed = i_nanoseconds() - bench_start_nsecs;
+		if (elapsed >= TEST_BENCH_MIN_RUN_NSECS) {
+			bench_ns_per_op = elapsed / bench_iterations;
+			/* reset, so another loop in the same test starts
+			   cleanly */
+			bench_iterations = 0;
+			bench_check_mask = 0;
+			return FALSE;
+		}
+		if (elapsed < TEST_BENCH_MIN_RUN_NSECS / 8) {
+			/* cheap operation - look at the clock less often, so
+			   the timing overhead doesn't dominate the result */
+			bench_check_mask = (bench_check_mask << 1) | 1;
+		}
+	}
+	bench_iterations++;
+	return TRUE;
+}
+
+uint64_t test_bench_ns_per_op(void)
+{
+	return bench_ns_per_op;
+}
+
+void test_bench_assert_faster_than(uint64_t max_ns_per_op,
+				   const char *file, unsigned int line)
+{
+	uint64_t limit;
+
+	if (bench_skipped)
+		return;
+	/* scale the nominal limit to this machine's measured speed */
+	limit = max_ns_per_op * bench_calibration_nsecs /
+		TEST_BENCH_CALIBRATION_NOMINAL_NSECS;
+	if (bench_ns_per_op <= limit)
+		return;
+	printf("%s:%u: Bench assert failed: measured %"PRIu64" ns/op, "
+	       "limit %"PRIu64" ns/op (%"PRIu64" ns/op nominal)\n",
+	       file, line, bench_ns_per_op, limit, max_ns_per_op);
+	fflush(stdout);
+	test_success = FALSE;
+}
+
 void test_assert_failed(const char *code, const char *file, unsigned int line)
 {
 	printf("%s:%u: Assert failed: %s\n", file, line, code);
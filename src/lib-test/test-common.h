@@ -79,6 +79,27 @@ void test_begin(const char *name);
 				#_op, _idx); \
 	} STMT_END
 
+/* Performance assertions. test_begin_bench() starts a test just like
+   test_begin(). Run the measured operation inside a
+   while (test_bench_loop()) loop; the loop driver does the timing and
+   decides how many iterations to run. Follow the loop with
+   test_assert_faster_than(), which fails the test when one operation took
+   longer than max_ns_per_op nanoseconds on the nominal machine. The limit
+   is scaled by a calibration loop run once per test binary, so slower or
+   faster hardware doesn't need its own limits - set them with enough
+   headroom that only a large regression trips them. The benchmark is
+   skipped, and the assert always passes, when running under valgrind or
+   when the DOVECOT_TEST_BENCH=0 environment variable is set. */
+void test_begin_bench(const char *name);
+bool test_bench_loop(void);
+/* Returns the raw (unscaled) nanoseconds per operation measured by the last
+   finished test_bench_loop() run, or 0 if the benchmark was skipped. */
+uint64_t test_bench_ns_per_op(void);
+#define test_assert_faster_than(max_ns_per_op) \
+	test_bench_assert_faster_than(max_ns_per_op, __FILE__, __LINE__)
+void test_bench_assert_faster_than(uint64_t max_ns_per_op,
+				   const char *file, unsigned int line);
+
 #ifdef STATIC_CHECKER
 #  define ATTR_STATIC_CHECKER_NORETURN ATTR_NORETURN
 #else
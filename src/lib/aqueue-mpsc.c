@@ -0,0 +1,175 @@
+/* Copyright (c) 2002-2018 Dovecot authors, see the included COPYING file */
+
+#include "lib.h"
+#include "fd-util.h"
+#include "aqueue-mpsc.h"
+
+#include <poll.h>
+#include <unistd.h>
+
+/* The implementation is the classic bounded MPMC ring of Dmitry Vyukov,
+   restricted to a single consumer. Each slot carries a sequence number that
+   tells whether it's free for the producer at a given position or filled
+   for the consumer, so producers only contend on one atomic counter. */
+
+struct aqueue_mpsc_slot {
+	unsigned int seq;
+	void *data;
+};
+
+struct aqueue_mpsc {
+	struct aqueue_mpsc_slot *slots;
+	unsigned int size, mask;
+
+	/* written only with atomics by producers */
+	unsigned int write_pos;
+	/* accessed by the single consumer only */
+	unsigned int read_pos;
+
+	/* wakeup pipe: producers write one byte per append, consumer
+	   drains it */
+	int wait_fds[2];
+};
+
+struct aqueue_mpsc *aqueue_mpsc_init(unsigned int max_count)
+{
+	struct aqueue_mpsc *queue;
+	unsigned int i;
+
+	i_assert(max_count > 0 && max_count <= INT_MAX/2);
+
+	queue = i_new(struct aqueue_mpsc, 1);
+	queue->size = nearest_power(max_count);
+	queue->mask = queue->size - 1;
+	queue->slots = i_new(struct aqueue_mpsc_slot, queue->size);
+	for (i = 0; i < queue->size; i++)
+		queue->slots[i].seq = i;
+
+	if (pipe(queue->wait_fds) < 0)
+		i_fatal("pipe() failed: %m");
+	fd_set_nonblock(queue->wait_fds[0], TRUE);
+	fd_set_nonblock(queue->wait_fds[1], TRUE);
+	fd_close_on_exec(queue->wait_fds[0], TRUE);
+	fd_close_on_exec(queue->wait_fds[1], TRUE);
+	return queue;
+}
+
+void aqueue_mpsc_deinit(struct aqueue_mpsc **_queue)
+{
+	struct aqueue_mpsc *queue = *_queue;
+
+	if (queue == NULL)
+		return;
+	*_queue = NULL;
+
+	i_close_fd(&queue->wait_fds[0]);
+	i_close_fd(&queue->wait_fds[1]);
+	i_free(queue->slots);
+	i_free(queue);
+}
+
+bool aqueue_mpsc_append(struct aqueue_mpsc *queue, void *item)
+{
+	struct aqueue_mpsc_slot *slot;
+	unsigned int pos, seq;
+	unsigned char wakeup_byte = 0;
+
+	i_assert(item != NULL);
+
+	pos = __atomic_load_n(&queue->write_pos, __ATOMIC_RELAXED);
+	for (;;) {
+		slot = &queue->slots[pos & queue->mask];
+		seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+
+		if (seq == pos) {
+			/* slot free for this position - try to claim it */
+			if (__atomic_compare_exchange_n(&queue->write_pos,
+							&pos, pos + 1, TRUE,
+							__ATOMIC_RELAXED,
+							__ATOMIC_RELAXED))
+				break;
+			/* lost the race, pos was updated by the CAS */
+		} else if ((int)(seq - pos) < 0) {
+			/* slot still holds an unconsumed item */
+			return FALSE;
+		} else {
+			/* another producer claimed this position */
+			pos = __atomic_load_n(&queue->write_pos,
+					      __ATOMIC_RELAXED);
+		}
+	}
+	slot->data = item;
+	__atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+	if (write(queue->wait_fds[1], &wakeup_byte, 1) < 0) {
+		/* EAGAIN just means the pipe is already full of wakeups,
+		   which is fine - the consumer will drain it */
+		if (errno != EAGAIN && errno != EINTR)
+			i_error("write(aqueue_mpsc wakeup) failed: %m");
+	}
+	return TRUE;
+}
+
+static void aqueue_mpsc_drain(struct aqueue_mpsc *queue)
+{
+	unsigned char buf[256];
+	ssize_t ret;
+
+	do {
+		ret = read(queue->wait_fds[0], buf, sizeof(buf));
+	} while (ret == (ssize_t)sizeof(buf));
+}
+
+static bool aqueue_mpsc_try_pop(struct aqueue_mpsc *queue, void **item_r)
+{
+	struct aqueue_mpsc_slot *slot;
+	unsigned int seq;
+
+	slot = &queue->slots[queue->read_pos & queue->mask];
+	seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+	if ((int)(seq - (queue->read_pos + 1)) < 0) {
+		/* empty */
+		return FALSE;
+	}
+	*item_r = slot->data;
+	/* mark the slot free for the producer that wraps around to it */
+	__atomic_store_n(&slot->seq, queue->read_pos + queue->size,
+			 __ATOMIC_RELEASE);
+	queue->read_pos++;
+	return TRUE;
+}
+
+bool aqueue_mpsc_pop(struct aqueue_mpsc *queue, void **item_r)
+{
+	if (aqueue_mpsc_try_pop(queue, item_r))
+		return TRUE;
+	/* Drain the wakeup pipe before reporting empty. A wakeup byte is
+	   written only after its item is published, so retrying after the
+	   drain is guaranteed to see every item whose byte was consumed -
+	   items appended later write new bytes and keep the fd readable. */
+	aqueue_mpsc_drain(queue);
+	return aqueue_mpsc_try_pop(queue, item_r);
+}
+
+void *aqueue_mpsc_pop_wait(struct aqueue_mpsc *queue)
+{
+	struct pollfd pfd;
+	void *item;
+	int ret;
+
+	for (;;) {
+		if (aqueue_mpsc_pop(queue, &item))
+			return item;
+
+		pfd.fd = queue->wait_fds[0];
+		pfd.events = POLLIN;
+		ret = poll(&pfd, 1, -1);
+		if (ret < 0 && errno != EINTR)
+			i_fatal("poll(aqueue_mpsc wakeup) failed: %m");
+	}
+}
+
+int aqueue_mpsc_get_wait_fd(struct aqueue_mpsc *queue)
+{
+	return queue->wait_fds[0];
+}
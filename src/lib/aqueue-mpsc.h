@@ -0,0 +1,35 @@
+#ifndef AQUEUE_MPSC_H
+#define AQUEUE_MPSC_H
+
+/* Bounded lock-free multi-producer/single-consumer queue of pointers.
+   Unlike aqueue this is safe to append to from helper threads while one
+   consumer thread (usually the main ioloop thread) pops items.
+
+   The consumer can either poll with aqueue_mpsc_pop(), or add the fd from
+   aqueue_mpsc_get_wait_fd() to its ioloop and pop when it turns readable.
+   Each successful append makes the fd readable. */
+
+struct aqueue_mpsc;
+
+/* Create a queue holding at most max_count items (rounded up to the next
+   power of two). */
+struct aqueue_mpsc *aqueue_mpsc_init(unsigned int max_count);
+void aqueue_mpsc_deinit(struct aqueue_mpsc **_queue);
+
+/* Append an item. Returns TRUE if appended, FALSE if the queue is full.
+   Safe to call from any thread. item must not be NULL. */
+bool aqueue_mpsc_append(struct aqueue_mpsc *queue, void *item);
+
+/* Pop the oldest item. Returns TRUE and sets *item_r if an item was
+   available, FALSE if the queue was empty. Must be called from the single
+   consumer thread only. */
+bool aqueue_mpsc_pop(struct aqueue_mpsc *queue, void **item_r);
+
+/* Like aqueue_mpsc_pop(), but block until an item is available. */
+void *aqueue_mpsc_pop_wait(struct aqueue_mpsc *queue);
+
+/* fd that turns readable when the queue has items. Intended to be watched
+   with io_add(). The fd is drained by the pop functions. */
+int aqueue_mpsc_get_wait_fd(struct aqueue_mpsc *queue);
+
+#endif
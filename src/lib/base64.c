@@ -306,15 +306,19 @@ base64_encode_more_data(struct base64_encoder *enc,
 		return;
 	}
 
-	/* Convert the bulk */
+	/* Convert the bulk. The 3 input bytes are combined into one word, so
+	   the encode map indexing needs only shifts and masks, which the
+	   compiler can unroll and vectorize. */
 	for (; src_size - src_pos > 2 && &ptr[3] < end;
 	     src_pos += 3, ptr += 4) {
-		ptr[0] = b64enc[src_c[src_pos] >> 2];
-		ptr[1] = b64enc[((src_c[src_pos] & 0x03) << 4) |
-				(src_c[src_pos+1] >> 4)];
-		ptr[2] = b64enc[((src_c[src_pos+1] & 0x0f) << 2) |
-				((src_c[src_pos+2] & 0xc0) >> 6)];
-		ptr[3] = b64enc[src_c[src_pos+2] & 0x3f];
+		uint32_t val = ((uint32_t)src_c[src_pos] << 16) |
+			((uint32_t)src_c[src_pos+1] << 8) |
+			src_c[src_pos+2];
+
+		ptr[0] = b64enc[(val >> 18) & 0x3f];
+		ptr[1] = b64enc[(val >> 12) & 0x3f];
+		ptr[2] = b64enc[(val >> 6) & 0x3f];
+		ptr[3] = b64enc[val & 0x3f];
 	}
 
 	/* Convert the bytes beyond the last 3-byte boundary and update state
@@ -660,6 +664,41 @@ int base64_decode_more(struct base64_decoder *dec,
 		return 1;
 	}
 
+	/* Bulk fast path: decode aligned groups of 4 valid base64 characters
+	   straight into the destination buffer without going through the
+	   per-character state machine. Any whitespace, padding or invalid
+	   input makes this drop to the generic loop below, which continues
+	   from where the fast path stopped. */
+	if (!dec->seen_padding && dec->sub_pos == 0 &&
+	    src_size - src_pos >= 4 && dst_avail >= 3) {
+		size_t max_groups = I_MIN((src_size - src_pos) / 4,
+					  dst_avail / 3);
+		unsigned char *dst =
+			buffer_append_space_unsafe(dest, max_groups * 3);
+		size_t groups;
+
+		for (groups = 0; groups < max_groups; groups++) {
+			uint32_t dm0 = b64->decmap[src_c[src_pos]];
+			uint32_t dm1 = b64->decmap[src_c[src_pos+1]];
+			uint32_t dm2 = b64->decmap[src_c[src_pos+2]];
+			uint32_t dm3 = b64->decmap[src_c[src_pos+3]];
+			uint32_t val;
+
+			/* valid mappings are 0x00..0x3f */
+			if (((dm0 | dm1 | dm2 | dm3) & 0xc0) != 0)
+				break;
+			val = (dm0 << 18) | (dm1 << 12) | (dm2 << 6) | dm3;
+			dst[0] = (unsigned char)(val >> 16);
+			dst[1] = (unsigned char)(val >> 8);
+			dst[2] = (unsigned char)val;
+			dst += 3;
+			src_pos += 4;
+		}
+		/* return the space reserved for groups we didn't decode */
+		buffer_set_used_size(dest, dest->used - (max_groups - groups) * 3);
+		dst_avail -= groups * 3;
+	}
+
 	for (; !dec->seen_padding && src_pos < src_size; src_pos++) {
 		unsigned char in = src_c[src_pos];
 		unsigned char dm = b64->decmap[in];
@@ -0,0 +1,76 @@
+/* Copyright (c) 2026 Dovecot authors, see the included COPYING file */
+
+#include "lib.h"
+#include "buffer.h"
+#include "base64.h"
+#include "randgen.h"
+#include "strnum.h"
+#include "time-util.h"
+
+#include <stdio.h>
+
+/* Measures base64 encoding and decoding throughput with random binary
+   blocks, roughly matching the attachment sizes seen when saving mails. */
+
+static void bench_base64(size_t block_size, unsigned long rounds)
+{
+	unsigned char *block = i_malloc(block_size);
+	buffer_t *encoded, *decoded;
+	uint64_t ts_0, ts_1;
+	unsigned long r;
+	double mb;
+
+	random_fill(block, block_size);
+	encoded = buffer_create_dynamic(default_pool,
+					MAX_BASE64_ENCODED_SIZE(block_size));
+	decoded = buffer_create_dynamic(default_pool, block_size);
+
+	/* warmup round, also verifies that the data survives */
+	base64_encode(block, block_size, encoded);
+	i_assert(base64_decode(encoded->data, encoded->used, decoded) >= 0);
+	i_assert(decoded->used == block_size &&
+		 memcmp(decoded->data, block, block_size) == 0);
+
+	mb = (double)block_size * (double)rounds / (1024.0 * 1024.0);
+
+	ts_0 = i_nanoseconds();
+	for (r = 0; r < rounds; r++) {
+		buffer_set_used_size(encoded, 0);
+		base64_encode(block, block_size, encoded);
+	}
+	ts_1 = i_nanoseconds();
+	printf("base64_encode: %7.02lf MB/s (%zu byte blocks)\n",
+	       mb / ((double)(ts_1 - ts_0) / 1e9), block_size);
+
+	base64_encode(block, block_size, encoded);
+	ts_0 = i_nanoseconds();
+	for (r = 0; r < rounds; r++) {
+		buffer_set_used_size(decoded, 0);
+		if (base64_decode(encoded->data, encoded->used, decoded) < 0)
+			i_unreached();
+	}
+	ts_1 = i_nanoseconds();
+	printf("base64_decode: %7.02lf MB/s (%zu byte blocks)\n",
+	       mb / ((double)(ts_1 - ts_0) / 1e9), block_size);
+
+	buffer_free(&encoded);
+	buffer_free(&decoded);
+	i_free(block);
+}
+
+int main(int argc, const char *argv[])
+{
+	unsigned long block_size = 8192, rounds = 20000;
+
+	lib_init();
+
+	if (argc >= 2 && str_to_ulong(argv[1], &block_size) < 0)
+		i_fatal("Invalid block size: %s", argv[1]);
+	if (argc >= 3 && str_to_ulong(argv[2], &rounds) < 0)
+		i_fatal("Invalid round count: %s", argv[2]);
+
+	bench_base64(block_size, rounds);
+
+	lib_deinit();
+	return 0;
+}
@@ -38,6 +38,40 @@ bool bsearch_insert_pos(const void *key, const void *base, unsigned int nmemb,
 	return FALSE;
 }
 
+bool bsearch_insert_pos_uint32(uint32_t key, const uint32_t *base,
+			       unsigned int nmemb, unsigned int *idx_r)
+{
+	const uint32_t *low = base;
+	unsigned int half, n = nmemb, idx;
+
+	i_assert(nmemb < INT_MAX);
+
+	if (nmemb == 0) {
+		*idx_r = 0;
+		return FALSE;
+	}
+	while (n > 1) {
+		half = n / 2;
+		/* branchless: compilers emit a conditional move here, so
+		   lookups in large arrays don't depend on the branch
+		   predictor guessing the comparison result right */
+		low += low[half - 1] < key ? half : 0;
+		n -= half;
+	}
+	idx = (low - base) + (*low < key ? 1 : 0);
+	*idx_r = idx;
+	return idx < nmemb && base[idx] == key;
+}
+
+bool array_bsearch_insert_pos_uint32(const ARRAY_TYPE(uint32_t) *array,
+				     uint32_t key, unsigned int *idx_r)
+{
+	unsigned int count;
+	const uint32_t *data = array_get(array, &count);
+
+	return bsearch_insert_pos_uint32(key, data, count, idx_r);
+}
+
 bool array_bsearch_insert_pos_i(const struct array *array, const void *key,
 				int (*cmp)(const void *, const void *),
 				unsigned int *idx_r)
@@ -39,6 +39,18 @@ bsearch_insert_pos(const void *key, const void *base, unsigned int nmemb,
 						typeof(const typeof(*base) *))), \
 		(int (*)(const void *, const void *))cmp, idx_r)
 
+/* Type-specialized variant for sorted uint32_t arrays (UID lists and
+   similar). The comparisons are inlined and branch-free, so hot lookup
+   paths don't pay for the indirect comparator call or its branch
+   mispredictions. Return value and idx_r work like bsearch_insert_pos(). */
+bool ATTR_NOWARN_UNUSED_RESULT
+bsearch_insert_pos_uint32(uint32_t key, const uint32_t *base,
+			  unsigned int nmemb, unsigned int *idx_r);
+
+bool ATTR_NOWARN_UNUSED_RESULT
+array_bsearch_insert_pos_uint32(const ARRAY_TYPE(uint32_t) *array,
+				uint32_t key, unsigned int *idx_r);
+
 bool ATTR_NOWARN_UNUSED_RESULT
 array_bsearch_insert_pos_i(const struct array *array, const void *key,
 			   int (*cmp)(const void *, const void *),
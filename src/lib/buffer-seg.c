@@ -0,0 +1,174 @@
+/* Copyright (c) 2002-2018 Dovecot authors, see the included COPYING file */
+
+#include "lib.h"
+#include "buffer-seg.h"
+
+#define SEG_BUFFER_DEFAULT_CHUNK_SIZE (8192)
+
+struct seg_buffer_chunk {
+	struct seg_buffer_chunk *next;
+	/* amount of data in this chunk. Only the last chunk may be
+	   partially filled. */
+	size_t used;
+	unsigned char data[FLEXIBLE_ARRAY_MEMBER];
+};
+
+struct seg_buffer {
+	pool_t pool;
+	size_t chunk_size;
+
+	/* chunks form a singly linked list from head to tail. head_skip
+	   bytes at the beginning of the head chunk are already consumed. */
+	struct seg_buffer_chunk *head, *tail;
+	/* fully consumed chunks kept for reuse */
+	struct seg_buffer_chunk *free_chunks;
+	size_t head_skip;
+	size_t used;
+	unsigned int chunk_count;
+};
+
+struct seg_buffer *seg_buffer_create(pool_t pool, size_t chunk_size)
+{
+	struct seg_buffer *buf;
+
+	if (chunk_size == 0)
+		chunk_size = SEG_BUFFER_DEFAULT_CHUNK_SIZE;
+
+	pool_ref(pool);
+	buf = p_new(pool, struct seg_buffer, 1);
+	buf->pool = pool;
+	buf->chunk_size = chunk_size;
+	return buf;
+}
+
+void seg_buffer_destroy(struct seg_buffer **_buf)
+{
+	struct seg_buffer *buf = *_buf;
+	struct seg_buffer_chunk *chunk, *next;
+	pool_t pool;
+
+	if (buf == NULL)
+		return;
+	*_buf = NULL;
+
+	pool = buf->pool;
+	if (!pool->alloconly_pool) {
+		for (chunk = buf->head; chunk != NULL; chunk = next) {
+			next = chunk->next;
+			p_free(pool, chunk);
+		}
+		for (chunk = buf->free_chunks; chunk != NULL; chunk = next) {
+			next = chunk->next;
+			p_free(pool, chunk);
+		}
+		p_free(pool, buf);
+	}
+	pool_unref(&pool);
+}
+
+static struct seg_buffer_chunk *seg_buffer_chunk_get(struct seg_buffer *buf)
+{
+	struct seg_buffer_chunk *chunk;
+
+	if (buf->free_chunks != NULL) {
+		chunk = buf->free_chunks;
+		buf->free_chunks = chunk->next;
+	} else {
+		chunk = p_malloc(buf->pool, sizeof(struct seg_buffer_chunk) +
+				 buf->chunk_size);
+	}
+	chunk->next = NULL;
+	chunk->used = 0;
+
+	if (buf->tail == NULL)
+		buf->head = chunk;
+	else
+		buf->tail->next = chunk;
+	buf->tail = chunk;
+	buf->chunk_count++;
+	return chunk;
+}
+
+void seg_buffer_append(struct seg_buffer *buf, const void *data, size_t size)
+{
+	const unsigned char *p = data;
+	struct seg_buffer_chunk *chunk = buf->tail;
+	size_t space, copy_size;
+
+	buf->used += size;
+	while (size > 0) {
+		if (chunk == NULL || chunk->used == buf->chunk_size)
+			chunk = seg_buffer_chunk_get(buf);
+
+		space = buf->chunk_size - chunk->used;
+		copy_size = I_MIN(size, space);
+		memcpy(chunk->data + chunk->used, p, copy_size);
+		chunk->used += copy_size;
+		p += copy_size;
+		size -= copy_size;
+	}
+}
+
+void seg_buffer_append_c(struct seg_buffer *buf, unsigned char chr)
+{
+	seg_buffer_append(buf, &chr, 1);
+}
+
+size_t seg_buffer_get_used_size(const struct seg_buffer *buf)
+{
+	return buf->used;
+}
+
+unsigned int seg_buffer_get_iovecs(struct seg_buffer *buf,
+				   const struct const_iovec **iov_r)
+{
+	struct const_iovec *iov;
+	struct seg_buffer_chunk *chunk;
+	unsigned int count = 0;
+
+	if (buf->used == 0) {
+		*iov_r = NULL;
+		return 0;
+	}
+
+	iov = t_new(struct const_iovec, buf->chunk_count);
+	for (chunk = buf->head; chunk != NULL; chunk = chunk->next) {
+		size_t skip = (chunk == buf->head ? buf->head_skip : 0);
+
+		if (chunk->used == skip)
+			continue;
+		iov[count].iov_base = chunk->data + skip;
+		iov[count].iov_len = chunk->used - skip;
+		count++;
+	}
+	*iov_r = iov;
+	return count;
+}
+
+void seg_buffer_skip(struct seg_buffer *buf, size_t size)
+{
+	struct seg_buffer_chunk *chunk;
+	size_t left;
+
+	i_assert(size <= buf->used);
+
+	buf->used -= size;
+	while (size > 0) {
+		chunk = buf->head;
+		left = chunk->used - buf->head_skip;
+		if (size < left) {
+			buf->head_skip += size;
+			break;
+		}
+		size -= left;
+		buf->head_skip = 0;
+
+		/* chunk fully consumed - move it to the free list */
+		buf->head = chunk->next;
+		if (buf->head == NULL)
+			buf->tail = NULL;
+		buf->chunk_count--;
+		chunk->next = buf->free_chunks;
+		buf->free_chunks = chunk;
+	}
+}
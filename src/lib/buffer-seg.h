@@ -0,0 +1,39 @@
+#ifndef BUFFER_SEG_H
+#define BUFFER_SEG_H
+
+/* Segmented append buffer: a rope of fixed-size chunks. Unlike buffer_t,
+   growing never reallocates or memmoves already written data - a new chunk
+   is simply linked to the end. The contents can be exported as an iovec
+   array so ostreams can writev() the chunks directly, and consumed data can
+   be dropped from the front without shifting the rest.
+
+   This is meant for assembling large responses (e.g. FETCH replies) where
+   the O(n) copies from buffer doubling and the flat reallocations become
+   measurable. For small transient data a flat buffer_t is still the better
+   choice: until the first chunk fills up a seg-buffer behaves like one. */
+
+struct seg_buffer;
+
+/* Create a segmented buffer. chunk_size specifies the fixed size of each
+   chunk; 0 uses a default (8 kB). */
+struct seg_buffer *seg_buffer_create(pool_t pool, size_t chunk_size);
+void seg_buffer_destroy(struct seg_buffer **_buf);
+
+void seg_buffer_append(struct seg_buffer *buf, const void *data, size_t size);
+void seg_buffer_append_c(struct seg_buffer *buf, unsigned char chr);
+
+/* Returns the number of bytes currently stored. */
+size_t seg_buffer_get_used_size(const struct seg_buffer *buf);
+
+/* Returns an iovec array covering all stored data, valid until the buffer
+   is modified. The iovec count is returned; *iov_r is set to a data stack
+   allocated array. */
+unsigned int seg_buffer_get_iovecs(struct seg_buffer *buf,
+				   const struct const_iovec **iov_r);
+
+/* Drop size bytes from the beginning of the buffer, e.g. after they have
+   been written out with writev(). Fully consumed chunks are recycled to the
+   end of the rope. */
+void seg_buffer_skip(struct seg_buffer *buf, size_t size);
+
+#endif
@@ -1,6 +1,7 @@
 /* Copyright (c) 2013-2018 Dovecot authors, see the included COPYING file */
 
 #include "lib.h"
+#include "array.h"
 #include "str.h"
 #include "ioloop.h"
 #include "istream.h"
@@ -16,6 +17,9 @@
 
 #include <unistd.h>
 
+/* Default for connection_settings.input_lines_batch_max */
+#define CONNECTION_DEFAULT_INPUT_LINES_BATCH_MAX 32
+
 static void connection_handshake_ready(struct connection *conn)
 {
 	conn->handshake_received = TRUE;
@@ -40,6 +44,29 @@ static void connection_connect_timeout(struct connection *conn)
 	connection_closed(conn, CONNECTION_DISCONNECT_CONNECT_TIMEOUT);
 }
 
+static int
+connection_input_parse_lines_batch(struct connection *conn,
+				   struct istream *input, bool *have_lines_r)
+{
+	unsigned int max_lines = conn->list->set.input_lines_batch_max;
+	ARRAY_TYPE(const_string) lines;
+	const char *line;
+
+	if (max_lines == 0)
+		max_lines = CONNECTION_DEFAULT_INPUT_LINES_BATCH_MAX;
+
+	t_array_init(&lines, I_MIN(max_lines, 32));
+	while (array_count(&lines) < max_lines &&
+	       (line = i_stream_next_line(input)) != NULL)
+		array_push_back(&lines, &line);
+
+	*have_lines_r = array_count(&lines) > 0;
+	if (!*have_lines_r)
+		return 0;
+	return conn->v.input_lines_batch(conn, array_front(&lines),
+					 array_count(&lines));
+}
+
 static int connection_input_parse_lines(struct connection *conn)
 {
 	const char *line;
@@ -54,23 +81,37 @@ static int connection_input_parse_lines(struct connection *conn)
 		o_stream_ref(output);
 		o_stream_cork(output);
 	}
-	while (!input->closed && (line = i_stream_next_line(input)) != NULL) {
-		T_BEGIN {
-			if (!conn->handshake_received &&
-			    conn->v.handshake_line != NULL) {
-				ret = conn->v.handshake_line(conn, line);
-				if (ret > 0)
-					connection_handshake_ready(conn);
-				else if (ret == 0)
-					/* continue reading */
-					ret = 1;
-				else
-					conn->disconnect_reason =
-						CONNECTION_DISCONNECT_HANDSHAKE_FAILED;
-			} else {
-				ret = conn->v.input_line(conn, line);
-			}
-		} T_END;
+	while (!input->closed) {
+		if (conn->v.input_lines_batch != NULL &&
+		    conn->handshake_received) {
+			bool have_lines;
+
+			T_BEGIN {
+				ret = connection_input_parse_lines_batch(
+					conn, input, &have_lines);
+			} T_END;
+			if (!have_lines)
+				break;
+		} else {
+			if ((line = i_stream_next_line(input)) == NULL)
+				break;
+			T_BEGIN {
+				if (!conn->handshake_received &&
+				    conn->v.handshake_line != NULL) {
+					ret = conn->v.handshake_line(conn, line);
+					if (ret > 0)
+						connection_handshake_ready(conn);
+					else if (ret == 0)
+						/* continue reading */
+						ret = 1;
+					else
+						conn->disconnect_reason =
+							CONNECTION_DISCONNECT_HANDSHAKE_FAILED;
+				} else {
+					ret = conn->v.input_line(conn, line);
+				}
+			} T_END;
+		}
 		if (ret <= 0)
 			break;
 		if (conn->input != input) {
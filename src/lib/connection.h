@@ -46,6 +46,17 @@ struct connection_vfuncs {
 	void (*input)(struct connection *conn);
 	int (*input_line)(struct connection *conn, const char *line);
 	int (*input_args)(struct connection *conn, const char *const *args);
+	/* Optional batched alternative to input_line(): once the handshake
+	   has finished, all already buffered lines (up to
+	   input_lines_batch_max) are handed over with a single call, which
+	   avoids the per-line dispatch overhead when clients pipeline
+	   commands. The lines have already been consumed from the input
+	   stream, so the handler must process every one of them even if it
+	   returns 0 to stop further input processing. Returning -1
+	   disconnects the client and drops any remaining lines. */
+	int (*input_lines_batch)(struct connection *conn,
+				 const char *const *lines,
+				 unsigned int count);
 
 	/* handshake functions. Defaults to version checking.
 	   must return 1 when handshake is completed, otherwise return 0.
@@ -83,6 +94,10 @@ struct connection_settings {
 	size_t output_max_size;
 	enum connection_behavior input_full_behavior;
 
+	/* Maximum number of lines passed to a single input_lines_batch()
+	   call. 0 = use the default. */
+	unsigned int input_lines_batch_max;
+
 	/* Set to TRUE if this is a client */
 	bool client;
 
@@ -7,4 +7,8 @@ uint32_t crc32_str(const char *str) ATTR_PURE;
 uint32_t crc32_data_more(uint32_t crc, const void *data, size_t size) ATTR_PURE;
 uint32_t crc32_str_more(uint32_t crc, const char *str) ATTR_PURE;
 
+/* Checksum all the given blocks as if they were one contiguous buffer. */
+uint32_t crc32_data_multi(const struct const_iovec *iov,
+			  unsigned int iov_count) ATTR_PURE;
+
 #endif
@@ -4,6 +4,7 @@
 
 #include "lib.h"
 #include "backtrace-string.h"
+#include "mmap-util.h"
 #include "str.h"
 #include "data-stack.h"
 
@@ -44,6 +45,18 @@ struct stack_block {
 	unsigned char data[FLEXIBLE_ARRAY_MEMBER];
 };
 
+/* If this environment variable is set to a size in bytes, a single anonymous
+   mmap()ed arena of that size is reserved at data_stack_init() time and stack
+   blocks are carved out of it with a simple bump pointer. This avoids the
+   malloc()/free() calls in the grow/shrink path entirely for processes whose
+   data stack usage fits in the arena. On Linux the arena is additionally
+   marked MADV_HUGEPAGE. If the arena runs out, the normal malloc()ed block
+   path is used as fallback. */
+#define DATA_STACK_ARENA_ENV "DOVECOT_DATA_STACK_ARENA_SIZE"
+/* Don't bother with arenas that can't hold even a couple of initial-sized
+   blocks. */
+#define DATA_STACK_ARENA_MIN_SIZE (INITIAL_STACK_SIZE * 4)
+
 #define SIZEOF_MEMBLOCK MEM_ALIGN(sizeof(struct stack_block))
 
 #define STACK_BLOCK_DATA(block) \
@@ -99,7 +112,14 @@ static union {
 	unsigned char data[512];
 } outofmem_area;
 
+/* Arena used when DATA_STACK_ARENA_ENV is set. Blocks between arena_base and
+   arena_base+arena_used are in use (or waiting for the bump pointer to rewind
+   past them). */
+static unsigned char *arena_base = NULL;
+static size_t arena_size = 0, arena_used = 0;
+
 static struct stack_block *mem_block_alloc(size_t min_size);
+static void mem_block_reset(struct stack_block *block);
 
 static inline
 unsigned char *data_stack_after_last_alloc(struct stack_block *block)
@@ -211,6 +231,42 @@ static void block_canary_check(struct stack_block *block)
 }
 #endif
 
+static bool mem_block_is_arena(const struct stack_block *block)
+{
+	return arena_base != NULL &&
+		(const unsigned char *)block >= arena_base &&
+		(const unsigned char *)block < arena_base + arena_size;
+}
+
+static struct stack_block *arena_block_alloc(size_t alloc_size)
+{
+	struct stack_block *block;
+
+	if (arena_base == NULL ||
+	    arena_size - arena_used < SIZEOF_MEMBLOCK + alloc_size)
+		return NULL;
+
+	block = (struct stack_block *)(arena_base + arena_used);
+	arena_used += SIZEOF_MEMBLOCK + alloc_size;
+	block->size = alloc_size;
+	block->canary = BLOCK_CANARY;
+	mem_block_reset(block);
+#ifdef DEBUG
+	memset(STACK_BLOCK_DATA(block), CLEAR_CHR, alloc_size);
+#endif
+	return block;
+}
+
+static void arena_block_free(struct stack_block *block)
+{
+	/* Blocks are carved out with a bump pointer and freed in allocation
+	   order when a frame is popped, so usually the bump pointer can simply
+	   be rewound here. A block freed out of order just stays reserved
+	   until the arena rewinds past it. */
+	if ((unsigned char *)block < arena_base + arena_used)
+		arena_used = (size_t)((unsigned char *)block - arena_base);
+}
+
 static void free_blocks(struct stack_block *block)
 {
 	struct stack_block *next;
@@ -227,6 +283,8 @@ static void free_blocks(struct stack_block *block)
 
 		if (block == &outofmem_area.block)
 			;
+		else if (mem_block_is_arena(block))
+			arena_block_free(block);
 		else if (unused_block == NULL ||
 			 block->size > unused_block->size) {
 			free(unused_block);
@@ -375,6 +433,10 @@ static struct stack_block *mem_block_alloc(size_t min_size)
 
 	/* nearest_power() returns 2^n values, so alloc_size can't be
 	   anywhere close to SIZE_MAX */
+	block = arena_block_alloc(alloc_size);
+	if (block != NULL)
+		return block;
+
 	block = malloc(SIZEOF_MEMBLOCK + alloc_size);
 	if (unlikely(block == NULL)) {
 		if (outofmem) {
@@ -738,6 +800,33 @@ void data_stack_free_unused(void)
 	unused_block = NULL;
 }
 
+static void data_stack_arena_init(void)
+{
+	const char *value = getenv(DATA_STACK_ARENA_ENV);
+	unsigned long long size;
+	char *endp;
+
+	if (value == NULL)
+		return;
+	size = strtoull(value, &endp, 10);
+	if (*endp != '\0' || size < DATA_STACK_ARENA_MIN_SIZE ||
+	    size > SSIZE_T_MAX) {
+		/* Can't log anything this early - just fall back to the
+		   malloc()ed blocks. */
+		return;
+	}
+	arena_base = mmap_anon(size);
+	if (arena_base == MAP_FAILED) {
+		arena_base = NULL;
+		return;
+	}
+	arena_size = size;
+	arena_used = 0;
+#ifdef MADV_HUGEPAGE
+	(void)madvise(arena_base, arena_size, MADV_HUGEPAGE);
+#endif
+}
+
 void data_stack_init(void)
 {
 	if (data_stack_initialized) {
@@ -748,6 +837,8 @@ void data_stack_init(void)
 	data_stack_initialized = TRUE;
 	data_stack_frame_id = 1;
 
+	data_stack_arena_init();
+
 	outofmem_area.block.size = outofmem_area.block.left =
 		sizeof(outofmem_area) - sizeof(outofmem_area.block);
 	outofmem_area.block.canary = BLOCK_CANARY;
@@ -773,7 +864,17 @@ void data_stack_deinit(void)
 	    current_frame != NULL)
 		i_panic("Missing t_pop() call");
 
-	free(current_block);
+	if (mem_block_is_arena(current_block))
+		arena_block_free(current_block);
+	else
+		free(current_block);
 	current_block = NULL;
 	data_stack_free_unused();
+
+	if (arena_base != NULL) {
+		if (munmap_anon(arena_base, arena_size) < 0)
+			i_error("munmap_anon(data stack arena) failed: %m");
+		arena_base = NULL;
+		arena_size = arena_used = 0;
+	}
 }
@@ -24,6 +24,10 @@ struct event_filter {
 	int refcount;
 	ARRAY(struct event_filter_query_internal) queries;
 
+	/* evaluation cost counters - see event_filter_get_stats() */
+	uint64_t match_count;
+	uint64_t fast_reject_count;
+
 	bool fragment;
 	bool named_queries_only;
 };
@@ -34,6 +34,10 @@ static_assert_array_size(event_filter_log_type_map, LOG_TYPE_COUNT);
 struct event_filter_query_internal {
 	struct event_filter_node *expr;
 	void *context;
+
+	/* Category bloom bits that an event must have for this query to be
+	   able to match. See filter_node_required_bloom(). */
+	uint64_t required_bloom;
 };
 
 static struct event_filter *event_filters = NULL;
@@ -152,6 +156,32 @@ static bool filter_node_requires_event_name(struct event_filter_node *node)
 	}
 }
 
+/* Return the category bloom bits that an event must have for this expression
+   to be able to match. Only categories that are required no matter how the
+   rest of the expression evaluates are counted, so a missing bit proves that
+   the event can't match, while a present bit proves nothing. */
+static uint64_t filter_node_required_bloom(const struct event_filter_node *node)
+{
+	if (node == NULL)
+		return 0;
+
+	switch (node->op) {
+	case EVENT_FILTER_OP_NOT:
+		return 0;
+	case EVENT_FILTER_OP_AND:
+		return filter_node_required_bloom(node->children[0]) |
+			filter_node_required_bloom(node->children[1]);
+	case EVENT_FILTER_OP_OR:
+		return filter_node_required_bloom(node->children[0]) &
+			filter_node_required_bloom(node->children[1]);
+	default:
+		if (node->type == EVENT_FILTER_NODE_TYPE_EVENT_CATEGORY &&
+		    node->category.name != NULL && node->category.ptr != NULL)
+			return event_category_get_bloom_bits(node->category.ptr);
+		return 0;
+	}
+}
+
 static int
 event_filter_parse_real(const char *str, struct event_filter *filter,
 			const char **error_r)
@@ -181,6 +211,8 @@ event_filter_parse_real(const char *str, struct event_filter *filter,
 
 		add_node(filter->pool, &int_query->expr, state.output,
 			 EVENT_FILTER_OP_OR);
+		int_query->required_bloom =
+			filter_node_required_bloom(int_query->expr);
 
 		filter->named_queries_only = filter->named_queries_only &&
 			filter_node_requires_event_name(state.output);
@@ -283,6 +315,7 @@ event_filter_merge_with_context_internal(struct event_filter *dest,
 		add_node(dest->pool, &new->expr,
 			 clone_expr(dest->pool, int_query->expr),
 			 EVENT_FILTER_OP_OR);
+		new->required_bloom = filter_node_required_bloom(new->expr);
 	} T_END;
 }
 
@@ -898,25 +931,56 @@ bool event_filter_match_source(struct event_filter *filter, struct event *event,
 			       const struct failure_context *ctx)
 {
 	const struct event_filter_query_internal *query;
+	uint64_t event_bloom = 0;
+	bool event_bloom_set = FALSE, evaluated = FALSE;
 
 	i_assert(!filter->fragment);
 
-	if (!event_filter_match_fastpath(filter, event))
+	filter->match_count++;
+	if (!event_filter_match_fastpath(filter, event)) {
+		filter->fast_reject_count++;
 		return FALSE;
+	}
 
 	array_foreach(&filter->queries, query) {
+		if (query->required_bloom != 0) {
+			if (!event_bloom_set) {
+				event_bloom = event_get_category_bloom(event);
+				event_bloom_set = TRUE;
+			}
+			if ((event_bloom & query->required_bloom) !=
+			    query->required_bloom) {
+				/* event can't have all the categories this
+				   query requires */
+				continue;
+			}
+		}
+		evaluated = TRUE;
 		if (event_filter_query_match(query, event, source_filename,
 					     source_linenum, ctx))
 			return TRUE;
 	}
+	if (!evaluated)
+		filter->fast_reject_count++;
 	return FALSE;
 }
 
+void event_filter_get_stats(struct event_filter *filter,
+			    struct event_filter_stats *stats_r)
+{
+	i_zero(stats_r);
+	stats_r->match_count = filter->match_count;
+	stats_r->fast_reject_count = filter->fast_reject_count;
+}
+
 struct event_filter_match_iter {
 	struct event_filter *filter;
 	struct event *event;
 	const struct failure_context *failure_ctx;
 	unsigned int idx;
+
+	uint64_t event_bloom;
+	bool event_bloom_set;
 };
 
 struct event_filter_match_iter *
@@ -931,8 +995,11 @@ event_filter_match_iter_init(struct event_filter *filter, struct event *event,
 	iter->filter = filter;
 	iter->event = event;
 	iter->failure_ctx = ctx;
-	if (!event_filter_match_fastpath(filter, event))
+	filter->match_count++;
+	if (!event_filter_match_fastpath(filter, event)) {
+		filter->fast_reject_count++;
 		iter->idx = UINT_MAX;
+	}
 	return iter;
 }
 
@@ -947,8 +1014,19 @@ void *event_filter_match_iter_next(struct event_filter_match_iter *iter)
 			&queries[iter->idx];
 
 		iter->idx++;
-		if (query->context != NULL &&
-		    event_filter_query_match(query, iter->event,
+		if (query->context == NULL)
+			continue;
+		if (query->required_bloom != 0) {
+			if (!iter->event_bloom_set) {
+				iter->event_bloom =
+					event_get_category_bloom(iter->event);
+				iter->event_bloom_set = TRUE;
+			}
+			if ((iter->event_bloom & query->required_bloom) !=
+			    query->required_bloom)
+				continue;
+		}
+		if (event_filter_query_match(query, iter->event,
 					     iter->event->source_filename,
 					     iter->event->source_linenum,
 					     iter->failure_ctx))
@@ -1014,6 +1092,8 @@ static void event_filter_category_registered(struct event_category *category)
 		array_foreach_modifiable(&filter->queries, query) {
 			event_filter_query_update_category(query, query->expr,
 							   category, add);
+			query->required_bloom =
+				filter_node_required_bloom(query->expr);
 		}
 	}
 }
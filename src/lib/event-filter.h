@@ -8,6 +8,14 @@ struct event_filter_field {
 	const char *value;
 };
 
+struct event_filter_stats {
+	/* Number of times the filter was checked against an event. */
+	uint64_t match_count;
+	/* Number of checks that were rejected cheaply, without evaluating
+	   any of the parsed queries. */
+	uint64_t fast_reject_count;
+};
+
 struct event_filter *event_filter_create(void);
 struct event_filter *event_filter_create_fragment(pool_t pool);
 void event_filter_ref(struct event_filter *filter);
@@ -49,6 +57,10 @@ bool event_filter_match_source(struct event_filter *filter, struct event *event,
 			       unsigned int source_linenum,
 			       const struct failure_context *ctx);
 
+/* Return counters describing how much work this filter has done. */
+void event_filter_get_stats(struct event_filter *filter,
+			    struct event_filter_stats *stats_r);
+
 /* Iterate through all queries with non-NULL context that match the event. */
 struct event_filter_match_iter *
 event_filter_match_iter_init(struct event_filter *filter, struct event *event,
@@ -60,6 +60,8 @@ static char *log_prefix = NULL;
 static char *log_stamp_format = NULL, *log_stamp_format_suffix = NULL;
 static bool failure_ignore_errors = FALSE, log_prefix_sent = FALSE;
 static bool coredump_on_error = FALSE;
+static bool log_internal_drop_overflow = FALSE;
+static unsigned int log_dropped_debugs = 0, log_dropped_infos = 0;
 static void log_timestamp_add(const struct failure_context *ctx, string_t *str);
 static void log_prefix_add(const struct failure_context *ctx, string_t *str);
 static int i_failure_send_option_forced(const char *key, const char *value);
@@ -211,10 +213,63 @@ static string_t * ATTR_FORMAT(3, 0) internal_format(const struct failure_context
 	return str;
 }
 
-static int internal_write(enum log_type type ATTR_UNUSED, string_t *data, size_t prefix_len)
+static int log_fd_write_try(int fd, const unsigned char *data, size_t len)
 {
+	ssize_t ret;
+
+	do {
+		ret = write(fd, data, len);
+	} while (ret < 0 && errno == EINTR);
+
+	if (ret == (ssize_t)len)
+		return 1;
+	if (ret < 0 && errno == EAGAIN)
+		return 0;
+	if (ret >= 0) {
+		/* pipe writes of at most PIPE_BUF bytes are atomic, so a
+		   partial write means the log fd isn't a pipe after all */
+		errno = ENOSPC;
+	}
+	return -1;
+}
+
+static void internal_write_dropped_notice(void)
+{
+	string_t *str = t_str_new(128);
+
+	str_printfa(str, "\001%c%s ", LOG_TYPE_WARNING + 1, my_pid);
+	str_printfa(str, "Dropped %u debug and %u info messages - "
+		    "log process couldn't keep up reading them\n",
+		    log_dropped_debugs, log_dropped_infos);
+	if (log_fd_write_try(STDERR_FILENO, str_data(str), str_len(str)) > 0)
+		log_dropped_debugs = log_dropped_infos = 0;
+}
+
+static int internal_write(enum log_type type, string_t *data, size_t prefix_len)
+{
+	if (log_dropped_debugs != 0 || log_dropped_infos != 0) {
+		/* tell the log process about the dropped messages before
+		   writing anything newer */
+		internal_write_dropped_notice();
+	}
 	if (str_len(data)+1 <= PIPE_BUF) {
 		str_append_c(data, '\n');
+		if (log_internal_drop_overflow &&
+		    (type == LOG_TYPE_DEBUG || type == LOG_TYPE_INFO)) {
+			/* Never pause the process because of debug/info
+			   logging volume. If the log pipe is full, count the
+			   message as dropped instead of waiting. */
+			int ret = log_fd_write_try(STDERR_FILENO,
+						   str_data(data),
+						   str_len(data));
+			if (ret == 0) {
+				if (type == LOG_TYPE_DEBUG)
+					log_dropped_debugs++;
+				else
+					log_dropped_infos++;
+			}
+			return ret < 0 ? -1 : 0;
+		}
 		return log_fd_write(STDERR_FILENO,
 				    str_data(data), str_len(data));
 	}
@@ -909,6 +964,11 @@ void i_set_failure_ignore_errors(bool ignore)
 	failure_ignore_errors = ignore;
 }
 
+void i_set_failure_internal_drop_overflow(bool drop)
+{
+	log_internal_drop_overflow = drop;
+}
+
 void i_set_info_file(const char *path)
 {
 	if (log_info_fd == log_fd)
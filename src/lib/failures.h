@@ -121,6 +121,11 @@ bool i_failure_handler_is_internal(failure_callback_t *const callback);
 /* If writing to log fails, ignore it instead of existing with
    FATAL_LOGWRITE or FATAL_LOGERROR. */
 void i_set_failure_ignore_errors(bool ignore);
+/* With the internal error protocol, drop debug and info messages instead of
+   blocking when the log process can't keep up reading the log pipe. Dropped
+   messages are counted and a warning about them is written once the pipe has
+   room again. Warnings and more severe messages always wait. */
+void i_set_failure_internal_drop_overflow(bool drop);
 
 /* Send informational messages to specified log file. i_set_failure_*()
    functions modify the info file too, so call this function after them. */
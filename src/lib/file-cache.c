@@ -2,6 +2,7 @@
 
 #include "lib.h"
 #include "buffer.h"
+#include "llist.h"
 #include "mmap-util.h"
 #include "file-cache.h"
 
@@ -15,8 +16,81 @@ struct file_cache {
 	void *mmap_base;
 	size_t mmap_length;
 	size_t read_highwater;
+
+	/* Linked into the process-wide LRU list. The most recently used
+	   cache is at the head. */
+	struct file_cache *prev, *next;
+	/* The owner has promised with file_cache_mark_unused() that no
+	   pointers into the cached memory are held. Cleared by the next
+	   access. Only unused caches may be evicted - invalidating a cache
+	   under its user would turn memory it's still reading into zeroes. */
+	bool unused;
 };
 
+static struct file_cache *file_caches_head = NULL;
+static struct file_cache *file_caches_tail = NULL;
+/* Sum of read_highwater over all caches. This is an upper bound estimate of
+   the cached bytes - partially invalidated pages below the highwater aren't
+   subtracted. */
+static size_t file_cache_total_cached_size = 0;
+static size_t file_cache_total_size_limit =
+	FILE_CACHE_DEFAULT_TOTAL_SIZE_LIMIT;
+
+static void
+file_cache_set_read_highwater(struct file_cache *cache, size_t read_highwater)
+{
+	file_cache_total_cached_size -= cache->read_highwater;
+	file_cache_total_cached_size += read_highwater;
+	cache->read_highwater = read_highwater;
+}
+
+static void file_cache_lru_touch(struct file_cache *cache)
+{
+	cache->unused = FALSE;
+	if (file_caches_head == cache)
+		return;
+	DLLIST2_REMOVE(&file_caches_head, &file_caches_tail, cache);
+	DLLIST2_PREPEND(&file_caches_head, &file_caches_tail, cache);
+}
+
+static void file_cache_evict_unused(void)
+{
+	struct file_cache *cache, *prev;
+
+	/* drop the least recently used unused caches until we're below the
+	   limit again. an evicted cache simply reads its pages back from the
+	   file on the next access. */
+	for (cache = file_caches_tail;
+	     cache != NULL &&
+	     file_cache_total_cached_size > file_cache_total_size_limit;
+	     cache = prev) {
+		prev = cache->prev;
+		if (!cache->unused)
+			continue;
+		file_cache_invalidate(cache, 0, cache->read_highwater);
+	}
+}
+
+void file_cache_mark_unused(struct file_cache *cache)
+{
+	cache->unused = TRUE;
+	if (file_cache_total_size_limit != 0 &&
+	    file_cache_total_cached_size > file_cache_total_size_limit)
+		file_cache_evict_unused();
+}
+
+void file_cache_set_total_size_limit(size_t limit)
+{
+	file_cache_total_size_limit = limit;
+	if (limit != 0 && file_cache_total_cached_size > limit)
+		file_cache_evict_unused();
+}
+
+size_t file_cache_get_total_cached_size(void)
+{
+	return file_cache_total_cached_size;
+}
+
 struct file_cache *file_cache_new(int fd)
 {
 	return file_cache_new_path(fd, "");
@@ -30,6 +104,7 @@ struct file_cache *file_cache_new_path(int fd, const char *path)
 	cache->fd = fd;
 	cache->path = i_strdup(path);
 	cache->page_bitmask = buffer_create_dynamic(default_pool, 128);
+	DLLIST2_PREPEND(&file_caches_head, &file_caches_tail, cache);
 	return cache;
 }
 
@@ -39,6 +114,9 @@ void file_cache_free(struct file_cache **_cache)
 
 	*_cache = NULL;
 
+	DLLIST2_REMOVE(&file_caches_head, &file_caches_tail, cache);
+	file_cache_total_cached_size -= cache->read_highwater;
+
 	if (cache->mmap_base != NULL) {
 		if (munmap_anon(cache->mmap_base, cache->mmap_length) < 0)
 			i_error("munmap_anon(%s) failed: %m", cache->path);
@@ -110,6 +188,8 @@ ssize_t file_cache_read(struct file_cache *cache, uoff_t offset, size_t size)
 
 	i_assert(page_size > 0);
 
+	file_cache_lru_touch(cache);
+
 	if (size > SSIZE_T_MAX) {
 		/* make sure our calculations won't overflow. most likely
 		   we'll be reading less data, but allow it anyway so caller
@@ -210,7 +290,7 @@ ssize_t file_cache_read(struct file_cache *cache, uoff_t offset, size_t size)
 			   we have it cached */
 			bits[high_poffset / CHAR_BIT] &=
 				~(1 << (high_poffset % CHAR_BIT));
-			cache->read_highwater = dest_offset;
+			file_cache_set_read_highwater(cache, dest_offset);
 		}
 
 		if ((size_t)ret != dest_size) {
@@ -229,6 +309,7 @@ ssize_t file_cache_read(struct file_cache *cache, uoff_t offset, size_t size)
 
 const void *file_cache_get_map(struct file_cache *cache, size_t *size_r)
 {
+	file_cache_lru_touch(cache);
 	*size_r = cache->read_highwater;
 	return cache->mmap_base;
 }
@@ -244,6 +325,8 @@ void file_cache_write(struct file_cache *cache, const void *data, size_t size,
 	i_assert(page_size > 0);
 	i_assert(UOFF_T_MAX - offset > size);
 
+	file_cache_lru_touch(cache);
+
 	if (file_cache_set_size(cache, offset + size) < 0) {
 		/* couldn't grow mapping. just make sure the written memory
 		   area is invalidated then. */
@@ -259,7 +342,7 @@ void file_cache_write(struct file_cache *cache, const void *data, size_t size,
 		bits = buffer_get_space_unsafe(cache->page_bitmask,
 					       page / CHAR_BIT, 1);
 		*bits &= ~(1 << (page % CHAR_BIT));
-		cache->read_highwater = offset + size;
+		file_cache_set_read_highwater(cache, offset + size);
 	}
 
 	/* mark fully written pages cached */
@@ -296,7 +379,7 @@ void file_cache_invalidate(struct file_cache *cache, uoff_t offset, uoff_t size)
 	if (size >= cache->read_highwater) {
 		/* we're invalidating everything up to read highwater.
 		   drop the highwater position. */
-		cache->read_highwater = offset & ~(page_size-1);
+		file_cache_set_read_highwater(cache, offset & ~(page_size-1));
 	}
 
 	size = (offset + size + page_size-1) / page_size;
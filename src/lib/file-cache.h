@@ -34,4 +34,26 @@ void file_cache_write(struct file_cache *cache, const void *data, size_t size,
 void file_cache_invalidate(struct file_cache *cache,
 			   uoff_t offset, uoff_t size);
 
+/* Process-wide limit for the number of bytes cached by all the file caches,
+   unless changed with file_cache_set_total_size_limit(). */
+#define FILE_CACHE_DEFAULT_TOTAL_SIZE_LIMIT (1024*1024*64)
+
+/* Promise that no pointers returned by file_cache_get_map() for this cache
+   are held anymore. While the promise holds (i.e. until the cache is accessed
+   again), the cache may be evicted to get the process back under the total
+   size limit: the least recently used unused caches are invalidated until the
+   usage drops below the limit. Eviction releases the cached pages, so any
+   pointer into them could otherwise start reading back zeroes - caches that
+   haven't been marked unused are never evicted. An evicted cache simply reads
+   its pages back from the file on the next access. */
+void file_cache_mark_unused(struct file_cache *cache);
+
+/* Change the process-wide limit for the number of bytes cached by all the
+   file caches. The limit is enforced only when a cache is marked unused with
+   file_cache_mark_unused() - a cache that is never marked isn't bounded by
+   it. 0 = no limit. */
+void file_cache_set_total_size_limit(size_t limit);
+/* Returns the number of bytes currently cached by all the file caches. */
+size_t file_cache_get_total_cached_size(void);
+
 #endif
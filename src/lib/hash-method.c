@@ -61,6 +61,42 @@ void hash_method_get_digest(const struct hash_method *meth,
 	meth->result(ctx, result_r);
 }
 
+void hash_method_get_digest_multi(const struct hash_method *meth,
+				  const struct const_iovec *iov,
+				  unsigned int iov_count,
+				  unsigned char *result_r)
+{
+	i_assert(meth != NULL);
+	unsigned char ctx[meth->context_size];
+	unsigned int i;
+
+	meth->init(ctx);
+	for (i = 0; i < iov_count; i++)
+		meth->loop(ctx, iov[i].iov_base, iov[i].iov_len);
+	meth->result(ctx, result_r);
+}
+
+void hash_method_get_digests(const struct hash_method *meth,
+			     const struct const_iovec *iov,
+			     unsigned int iov_count,
+			     unsigned char *const *results)
+{
+	i_assert(meth != NULL);
+	unsigned char ctx[meth->context_size];
+	unsigned int i;
+
+	/* The streams are independent, so an implementation is free to
+	   interleave several of them. For now they're simply hashed one
+	   after the other. */
+	for (i = 0; i < iov_count; i++) {
+		i_assert(iov[i].iov_len == 0 || iov[i].iov_base != NULL);
+		meth->init(ctx);
+		meth->loop(ctx, iov[i].iov_base == NULL ? "" : iov[i].iov_base,
+			   iov[i].iov_len);
+		meth->result(ctx, results[i]);
+	}
+}
+
 buffer_t *t_hash_data(const struct hash_method *meth,
 		      const void *data, size_t data_len)
 {
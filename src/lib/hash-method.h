@@ -25,6 +25,21 @@ extern const struct hash_method *hash_methods[];
 void hash_method_get_digest(const struct hash_method *meth,
 			    const void *data, size_t data_len,
 			    unsigned char *result_r);
+/* Digest all the given blocks as if they were one contiguous buffer,
+   with a single init/result round. */
+void hash_method_get_digest_multi(const struct hash_method *meth,
+				  const struct const_iovec *iov,
+				  unsigned int iov_count,
+				  unsigned char *result_r);
+/* Digest many independent buffers in one call: results[i] receives the
+   digest of iov[i]. Bulk verification should prefer this over calling
+   hash_method_get_digest() in a loop, so the hashing of the independent
+   streams can be interleaved by an optimized implementation without
+   changing the callers. */
+void hash_method_get_digests(const struct hash_method *meth,
+			     const struct const_iovec *iov,
+			     unsigned int iov_count,
+			     unsigned char *const *results);
 
 /** Simple datastack helpers for digesting (hashing)
 
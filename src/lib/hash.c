@@ -11,6 +11,7 @@
 #define HASH_TABLE_MIN_SIZE 67
 
 #undef hash_table_create
+#undef hash_table_create_open
 #undef hash_table_create_direct
 #undef hash_table_destroy
 #undef hash_table_clear
@@ -32,6 +33,22 @@ struct hash_node {
 	void *value;
 };
 
+/* Slot states for open-addressing tables. A tombstone keeps the probe
+   sequence intact after a removal; tombstones are cleaned up by rebuilding
+   the table. */
+enum hash_open_state {
+	HASH_OPEN_STATE_EMPTY = 0,
+	HASH_OPEN_STATE_USED,
+	HASH_OPEN_STATE_TOMBSTONE
+};
+
+struct hash_open_node {
+	void *key;
+	void *value;
+	unsigned int hash;
+	unsigned char state;
+};
+
 struct hash_table {
 	pool_t node_pool;
 
@@ -41,9 +58,12 @@ struct hash_table {
 	unsigned int size;
 	struct hash_node *nodes;
 	struct hash_node *free_nodes;
+	/* flat slot array used instead of nodes when open=TRUE */
+	struct hash_open_node *open_nodes;
 
 	hash_callback_t *hash_cb;
 	hash_cmp_callback_t *key_compare_cb;
+	bool open;
 };
 
 struct hash_iterate_context {
@@ -80,6 +100,27 @@ void hash_table_create(struct hash_table **table_r, pool_t node_pool,
 	*table_r = table;
 }
 
+void hash_table_create_open(struct hash_table **table_r, pool_t node_pool,
+			    unsigned int initial_size, hash_callback_t *hash_cb,
+			    hash_cmp_callback_t *key_compare_cb)
+{
+	struct hash_table *table;
+
+	pool_ref(node_pool);
+	table = i_new(struct hash_table, 1);
+	table->node_pool = node_pool;
+	table->initial_size =
+		I_MAX(primes_closest(initial_size), HASH_TABLE_MIN_SIZE);
+
+	table->hash_cb = hash_cb;
+	table->key_compare_cb = key_compare_cb;
+	table->open = TRUE;
+
+	table->size = table->initial_size;
+	table->open_nodes = i_new(struct hash_open_node, table->size);
+	*table_r = table;
+}
+
 static unsigned int direct_hash(const void *p)
 {
 	/* NOTE: may truncate the value, but that doesn't matter. */
@@ -139,13 +180,14 @@ void hash_table_destroy(struct hash_table **_table)
 
 	i_assert(table->frozen == 0);
 
-	if (!table->node_pool->alloconly_pool) {
+	if (!table->open && !table->node_pool->alloconly_pool) {
 		hash_table_destroy_nodes(table);
 		destroy_node_list(table, table->free_nodes);
 	}
 
 	pool_unref(&table->node_pool);
 	i_free(table->nodes);
+	i_free(table->open_nodes);
 	i_free(table);
 }
 
@@ -153,6 +195,14 @@ void hash_table_clear(struct hash_table *table, bool free_nodes)
 {
 	i_assert(table->frozen == 0);
 
+	if (table->open) {
+		memset(table->open_nodes, 0,
+		       sizeof(struct hash_open_node) * table->size);
+		table->nodes_count = 0;
+		table->removed_count = 0;
+		return;
+	}
+
 	if (!table->node_pool->alloconly_pool)
 		hash_table_destroy_nodes(table);
 
@@ -187,8 +237,138 @@ hash_table_lookup_node(const struct hash_table *table,
 	return NULL;
 }
 
+static struct hash_open_node *
+hash_table_open_lookup_node(const struct hash_table *table,
+			    const void *key, unsigned int hash)
+{
+	unsigned int i = hash % table->size;
+
+	/* the insert path guarantees there is always at least one empty
+	   slot, so the probing is guaranteed to terminate */
+	for (;;) {
+		struct hash_open_node *node = &table->open_nodes[i];
+
+		if (node->state == HASH_OPEN_STATE_EMPTY)
+			return NULL;
+		if (node->state == HASH_OPEN_STATE_USED &&
+		    node->hash == hash &&
+		    table->key_compare_cb(node->key, key) == 0)
+			return node;
+		if (++i == table->size)
+			i = 0;
+	}
+}
+
+static void
+hash_table_open_insert_at(struct hash_table *table, void *key, void *value,
+			  unsigned int hash)
+{
+	unsigned int i = hash % table->size;
+	struct hash_open_node *node;
+
+	while ((node = &table->open_nodes[i])->state == HASH_OPEN_STATE_USED) {
+		if (++i == table->size)
+			i = 0;
+	}
+	if (node->state == HASH_OPEN_STATE_TOMBSTONE)
+		table->removed_count--;
+	node->key = key;
+	node->value = value;
+	node->hash = hash;
+	node->state = HASH_OPEN_STATE_USED;
+	table->nodes_count++;
+}
+
+static void hash_table_open_rebuild(struct hash_table *table,
+				    unsigned int next_size)
+{
+	struct hash_open_node *old_nodes = table->open_nodes;
+	unsigned int i, old_size = table->size;
+
+	table->size = I_MAX(I_MAX(next_size, table->initial_size),
+			    HASH_TABLE_MIN_SIZE);
+	table->open_nodes = i_new(struct hash_open_node, table->size);
+	table->nodes_count = 0;
+	table->removed_count = 0;
+
+	for (i = 0; i < old_size; i++) {
+		if (old_nodes[i].state == HASH_OPEN_STATE_USED) {
+			hash_table_open_insert_at(table, old_nodes[i].key,
+						  old_nodes[i].value,
+						  old_nodes[i].hash);
+		}
+	}
+	i_free(old_nodes);
+}
+
+static void
+hash_table_open_insert_node(struct hash_table *table, void *key, void *value,
+			    enum hash_table_operation opcode)
+{
+	unsigned int hash;
+
+	i_assert(table->nodes_count < UINT_MAX);
+	i_assert(key != NULL);
+
+	hash = table->hash_cb(key);
+	if (opcode != HASH_TABLE_OP_RESIZE) {
+		struct hash_open_node *node =
+			hash_table_open_lookup_node(table, key, hash);
+		if (node != NULL) {
+			i_assert(opcode == HASH_TABLE_OP_UPDATE);
+			node->value = value;
+			return;
+		}
+	}
+
+	/* grow when the table becomes 3/4 full of used+tombstone slots.
+	   While frozen the table is normally left alone, but if not even one
+	   empty slot would remain, a rebuild is forced anyway - lookups
+	   depend on empty slots terminating the probe sequences. */
+	if ((table->nodes_count + table->removed_count + 1) >=
+	    table->size / 4 * 3) {
+		if (table->frozen == 0 ||
+		    table->nodes_count + table->removed_count + 1 >=
+		    table->size) {
+			hash_table_open_rebuild(table,
+				primes_closest(table->nodes_count * 2 + 1));
+		}
+	}
+	hash_table_open_insert_at(table, key, value, hash);
+}
+
+static bool hash_table_open_try_remove(struct hash_table *table,
+				       const void *key)
+{
+	struct hash_open_node *node;
+
+	node = hash_table_open_lookup_node(table, key, table->hash_cb(key));
+	if (unlikely(node == NULL))
+		return FALSE;
+
+	node->key = NULL;
+	node->value = NULL;
+	node->state = HASH_OPEN_STATE_TOMBSTONE;
+	table->nodes_count--;
+	table->removed_count++;
+
+	/* rebuild when tombstones pile up, so probe sequences stay short */
+	if (table->frozen == 0 && table->removed_count >= table->size / 4) {
+		hash_table_open_rebuild(table,
+			primes_closest(table->nodes_count * 2 + 1));
+	}
+	return TRUE;
+}
+
 void *hash_table_lookup(const struct hash_table *table, const void *key)
 {
+	if (table->open) {
+		struct hash_open_node *node =
+			hash_table_open_lookup_node(table, key,
+						    table->hash_cb(key));
+		return node != NULL ? node->value : NULL;
+	}
+
 	struct hash_node *node;
 
 	node = hash_table_lookup_node(table, key, table->hash_cb(key));
@@ -199,6 +379,17 @@ bool hash_table_lookup_full(const struct hash_table *table,
 			    const void *lookup_key,
 			    void **orig_key, void **value)
 {
+	if (table->open) {
+		struct hash_open_node *node =
+			hash_table_open_lookup_node(table, lookup_key,
+						    table->hash_cb(lookup_key));
+		if (node == NULL)
+			return FALSE;
+		*orig_key = node->key;
+		*value = node->value;
+		return TRUE;
+	}
+
 	struct hash_node *node;
 
 	node = hash_table_lookup_node(table, lookup_key,
@@ -297,12 +488,20 @@ hash_table_insert_node(struct hash_table *table, void *key, void *value,
 
 void hash_table_insert(struct hash_table *table, void *key, void *value)
 {
-	hash_table_insert_node(table, key, value, HASH_TABLE_OP_INSERT);
+	if (table->open)
+		hash_table_open_insert_node(table, key, value,
+					    HASH_TABLE_OP_INSERT);
+	else
+		hash_table_insert_node(table, key, value, HASH_TABLE_OP_INSERT);
 }
 
 void hash_table_update(struct hash_table *table, void *key, void *value)
 {
-	hash_table_insert_node(table, key, value, HASH_TABLE_OP_UPDATE);
+	if (table->open)
+		hash_table_open_insert_node(table, key, value,
+					    HASH_TABLE_OP_UPDATE);
+	else
+		hash_table_insert_node(table, key, value, HASH_TABLE_OP_UPDATE);
 }
 
 static void
@@ -347,6 +546,9 @@ bool hash_table_try_remove(struct hash_table *table, const void *key)
 	struct hash_node *node;
 	unsigned int hash;
 
+	if (table->open)
+		return hash_table_open_try_remove(table, key);
+
 	hash = table->hash_cb(key);
 
 	node = hash_table_lookup_node(table, key, hash);
@@ -376,7 +578,7 @@ struct hash_iterate_context *hash_table_iterate_init(struct hash_table *table)
 
 	ctx = i_new(struct hash_iterate_context, 1);
 	ctx->table = table;
-	ctx->next = &table->nodes[0];
+	ctx->next = table->open ? NULL : &table->nodes[0];
 	return ctx;
 }
 
@@ -403,6 +605,23 @@ bool hash_table_iterate(struct hash_iterate_context *ctx,
 {
 	struct hash_node *node;
 
+	if (ctx->table->open) {
+		const struct hash_table *table = ctx->table;
+
+		while (ctx->pos < table->size) {
+			const struct hash_open_node *onode =
+				&table->open_nodes[ctx->pos++];
+
+			if (onode->state == HASH_OPEN_STATE_USED) {
+				*key_r = onode->key;
+				*value_r = onode->value;
+				return TRUE;
+			}
+		}
+		*key_r = *value_r = NULL;
+		return FALSE;
+	}
+
 	node = ctx->next;
 	if (node != NULL && node->key == NULL)
 		node = hash_table_iterate_next(ctx, node);
@@ -442,7 +661,10 @@ void hash_table_thaw(struct hash_table *table)
 		return;
 
 	if (table->removed_count > 0) {
-		if (!hash_table_resize(table, FALSE))
+		if (table->open) {
+			hash_table_open_rebuild(table,
+				primes_closest(table->nodes_count * 2 + 1));
+		} else if (!hash_table_resize(table, FALSE))
 			hash_table_compress_removed(table);
 	}
 }
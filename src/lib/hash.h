@@ -41,6 +41,36 @@ void hash_table_create(struct hash_table **table_r, pool_t node_pool,
 		(hash_callback_t *)hash_cb, \
 		(hash_cmp_callback_t *)key_cmp_cb))
 
+/* Like hash_table_create(), but use an open-addressing table (flat slot
+   array with linear probing) instead of chained nodes. Lookups touch one or
+   two cache lines instead of chasing per-node pointers, so this is the
+   better choice for large tables with cheap POD keys (pointers, uint32s,
+   GUIDs). Keys and values must still be pointer-sized; node_pool is only
+   referenced for API symmetry. Iteration and hash_table_copy() semantics are
+   the same as with chained tables. */
+void hash_table_create_open(struct hash_table **table_r, pool_t node_pool,
+			    unsigned int initial_size,
+			    hash_callback_t *hash_cb,
+			    hash_cmp_callback_t *key_compare_cb);
+#define hash_table_create_open(table, pool, size, hash_cb, key_cmp_cb) \
+	TYPE_CHECKS(void, \
+	COMPILE_ERROR_IF_TRUE( \
+		sizeof((*table)._key) != sizeof(void *) || \
+		sizeof((*table)._value) != sizeof(void *)) || \
+	COMPILE_ERROR_IF_TRUE( \
+               !__builtin_types_compatible_p(typeof(&key_cmp_cb), \
+                       int (*)(typeof((*table)._key), typeof((*table)._key))) && \
+               !__builtin_types_compatible_p(typeof(&key_cmp_cb), \
+                       int (*)(typeof((*table)._const_key), typeof((*table)._const_key)))) || \
+	COMPILE_ERROR_IF_TRUE( \
+		!__builtin_types_compatible_p(typeof(&hash_cb), \
+			unsigned int (*)(typeof((*table)._key))) && \
+		!__builtin_types_compatible_p(typeof(&hash_cb), \
+		unsigned int (*)(typeof((*table)._const_key)))), \
+	hash_table_create_open(&(*table)._table, pool, size, \
+		(hash_callback_t *)hash_cb, \
+		(hash_cmp_callback_t *)key_cmp_cb))
+
 /* Create hash table where comparisons are done directly with the pointers. */
 void hash_table_create_direct(struct hash_table **table_r, pool_t node_pool,
 			      unsigned int initial_size);
@@ -0,0 +1,387 @@
+/* Copyright (c) 2004-2018 Dovecot authors, see the included COPYING file */
+
+#include "lib.h"
+#include "array.h"
+#include "sleep.h"
+#include "ioloop-private.h"
+#include "ioloop-iolist.h"
+
+#ifdef IOLOOP_URING
+
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <poll.h>
+#include <unistd.h>
+
+/* Poll-mode io_uring backend. Each watched fd has one outstanding oneshot
+   IORING_OP_POLL_ADD, which is re-armed after its completion is handled.
+   Compared to epoll this batches all (re)arming into the single
+   io_uring_enter() per loop iteration, and it's also the base the async
+   file read submissions can be built on later. */
+
+#define URING_CQ_ENTRIES 256
+
+/* user_data values below this are special (not uring_fd pointers) */
+#define URING_UDATA_TIMEOUT 1
+#define URING_UDATA_CANCEL 2
+#define URING_UDATA_SPECIAL_MAX 16
+
+struct uring_fd {
+	struct io_list list;
+	int fd;
+	/* number of POLL_ADDs still in flight. normally 0 or 1, goes higher
+	   momentarily when an old poll is being canceled. */
+	unsigned int pending_polls;
+	/* events of the most recently submitted POLL_ADD */
+	uint32_t armed_events;
+};
+
+struct ioloop_handler_context {
+	int ring_fd;
+
+	void *sq_ring, *cq_ring;
+	size_t sq_ring_size, cq_ring_size;
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+
+	unsigned int *sq_head, *sq_tail, *sq_ring_mask, *sq_array;
+	unsigned int *cq_head, *cq_tail, *cq_ring_mask;
+	struct io_uring_cqe *cqes;
+	unsigned int sq_entries;
+	unsigned int to_submit;
+
+	unsigned int deleted_count;
+	ARRAY(struct uring_fd *) fd_index;
+};
+
+static int sys_io_uring_setup(unsigned int entries, struct io_uring_params *p)
+{
+	return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned int to_submit,
+			      unsigned int min_complete, unsigned int flags)
+{
+	return syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+		       flags, NULL, 0);
+}
+
+void io_loop_handler_init(struct ioloop *ioloop, unsigned int initial_fd_count)
+{
+	struct ioloop_handler_context *ctx;
+	struct io_uring_params params;
+
+	ioloop->handler_context = ctx =
+		i_new(struct ioloop_handler_context, 1);
+
+	i_array_init(&ctx->fd_index, initial_fd_count);
+
+	i_zero(&params);
+	ctx->ring_fd = sys_io_uring_setup(URING_CQ_ENTRIES, &params);
+	if (ctx->ring_fd < 0)
+		i_fatal("io_uring_setup() failed: %m");
+	fd_close_on_exec(ctx->ring_fd, TRUE);
+
+#ifdef IORING_FEAT_NODROP
+	if ((params.features & IORING_FEAT_NODROP) == 0)
+		i_fatal("io_uring: kernel is missing IORING_FEAT_NODROP");
+#endif
+
+	ctx->sq_entries = params.sq_entries;
+	ctx->sq_ring_size = params.sq_off.array +
+		params.sq_entries * sizeof(unsigned int);
+	ctx->sq_ring = mmap(NULL, ctx->sq_ring_size, PROT_READ | PROT_WRITE,
+			    MAP_SHARED | MAP_POPULATE, ctx->ring_fd,
+			    IORING_OFF_SQ_RING);
+	if (ctx->sq_ring == MAP_FAILED)
+		i_fatal("mmap(io_uring sq ring) failed: %m");
+
+	ctx->cq_ring_size = params.cq_off.cqes +
+		params.cq_entries * sizeof(struct io_uring_cqe);
+	ctx->cq_ring = mmap(NULL, ctx->cq_ring_size, PROT_READ | PROT_WRITE,
+			    MAP_SHARED | MAP_POPULATE, ctx->ring_fd,
+			    IORING_OFF_CQ_RING);
+	if (ctx->cq_ring == MAP_FAILED)
+		i_fatal("mmap(io_uring cq ring) failed: %m");
+
+	ctx->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	ctx->sqes = mmap(NULL, ctx->sqes_size, PROT_READ | PROT_WRITE,
+			 MAP_SHARED | MAP_POPULATE, ctx->ring_fd,
+			 IORING_OFF_SQES);
+	if (ctx->sqes == MAP_FAILED)
+		i_fatal("mmap(io_uring sqes) failed: %m");
+
+	ctx->sq_head = PTR_OFFSET(ctx->sq_ring, params.sq_off.head);
+	ctx->sq_tail = PTR_OFFSET(ctx->sq_ring, params.sq_off.tail);
+	ctx->sq_ring_mask = PTR_OFFSET(ctx->sq_ring, params.sq_off.ring_mask);
+	ctx->sq_array = PTR_OFFSET(ctx->sq_ring, params.sq_off.array);
+	ctx->cq_head = PTR_OFFSET(ctx->cq_ring, params.cq_off.head);
+	ctx->cq_tail = PTR_OFFSET(ctx->cq_ring, params.cq_off.tail);
+	ctx->cq_ring_mask = PTR_OFFSET(ctx->cq_ring, params.cq_off.ring_mask);
+	ctx->cqes = PTR_OFFSET(ctx->cq_ring, params.cq_off.cqes);
+}
+
+void io_loop_handler_deinit(struct ioloop *ioloop)
+{
+	struct ioloop_handler_context *ctx = ioloop->handler_context;
+	struct uring_fd **urfds;
+	unsigned int i, count;
+
+	urfds = array_get_modifiable(&ctx->fd_index, &count);
+	for (i = 0; i < count; i++)
+		i_free(urfds[i]);
+
+	if (munmap(ctx->sqes, ctx->sqes_size) < 0)
+		i_error("munmap(io_uring sqes) failed: %m");
+	if (munmap(ctx->cq_ring, ctx->cq_ring_size) < 0)
+		i_error("munmap(io_uring cq ring) failed: %m");
+	if (munmap(ctx->sq_ring, ctx->sq_ring_size) < 0)
+		i_error("munmap(io_uring sq ring) failed: %m");
+	if (close(ctx->ring_fd) < 0)
+		i_error("close(io_uring) failed: %m");
+	array_free(&ctx->fd_index);
+	i_free(ioloop->handler_context);
+}
+
+static void uring_submit_pending(struct ioloop_handler_context *ctx)
+{
+	int ret;
+
+	while (ctx->to_submit > 0) {
+		ret = sys_io_uring_enter(ctx->ring_fd, ctx->to_submit, 0, 0);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			i_fatal("io_uring_enter() failed: %m");
+		}
+		ctx->to_submit -= ret;
+	}
+}
+
+static struct io_uring_sqe *
+uring_get_sqe(struct ioloop_handler_context *ctx)
+{
+	struct io_uring_sqe *sqe;
+	unsigned int tail, head, idx;
+
+	tail = *ctx->sq_tail;
+	head = __atomic_load_n(ctx->sq_head, __ATOMIC_ACQUIRE);
+	if (tail - head >= ctx->sq_entries) {
+		/* submission ring is full - flush it */
+		uring_submit_pending(ctx);
+	}
+
+	idx = tail & *ctx->sq_ring_mask;
+	sqe = &ctx->sqes[idx];
+	i_zero(sqe);
+	ctx->sq_array[idx] = idx;
+	__atomic_store_n(ctx->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	ctx->to_submit++;
+	return sqe;
+}
+
+static uint32_t uring_poll_events(struct io_list *list)
+{
+	uint32_t events = 0;
+	struct io_file *io;
+	int i;
+
+	for (i = 0; i < IOLOOP_IOLIST_IOS_PER_FD; i++) {
+		io = list->ios[i];
+
+		if (io == NULL)
+			continue;
+
+		if ((io->io.condition & IO_READ) != 0)
+			events |= POLLIN | POLLPRI | POLLERR | POLLHUP;
+		if ((io->io.condition & IO_WRITE) != 0)
+			events |= POLLOUT | POLLERR | POLLHUP;
+		if ((io->io.condition & IO_ERROR) != 0)
+			events |= POLLERR | POLLHUP;
+	}
+
+	return events;
+}
+
+static void
+uring_poll_arm(struct ioloop_handler_context *ctx, struct uring_fd *urfd,
+	       uint32_t events)
+{
+	struct io_uring_sqe *sqe;
+
+	sqe = uring_get_sqe(ctx);
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = urfd->fd;
+	sqe->poll_events = events;
+	sqe->user_data = (uintptr_t)urfd;
+	urfd->pending_polls++;
+	urfd->armed_events = events;
+}
+
+static void
+uring_poll_cancel(struct ioloop_handler_context *ctx, struct uring_fd *urfd)
+{
+	struct io_uring_sqe *sqe;
+
+	sqe = uring_get_sqe(ctx);
+	sqe->opcode = IORING_OP_POLL_REMOVE;
+	sqe->addr = (uintptr_t)urfd;
+	sqe->user_data = URING_UDATA_CANCEL;
+	urfd->armed_events = 0;
+}
+
+static void
+uring_poll_update(struct ioloop_handler_context *ctx, struct uring_fd *urfd)
+{
+	uint32_t events = uring_poll_events(&urfd->list);
+
+	if (urfd->pending_polls > 0) {
+		if (events == urfd->armed_events)
+			return;
+		/* the in-flight poll is watching the wrong events. cancel it
+		   and arm a new one once the cancel has completed. */
+		uring_poll_cancel(ctx, urfd);
+	} else if (events != 0) {
+		uring_poll_arm(ctx, urfd, events);
+	}
+}
+
+void io_loop_handle_add(struct io_file *io)
+{
+	struct ioloop_handler_context *ctx = io->io.ioloop->handler_context;
+	struct uring_fd **urfd;
+
+	urfd = array_idx_get_space(&ctx->fd_index, io->fd);
+	if (*urfd == NULL) {
+		*urfd = i_new(struct uring_fd, 1);
+		(*urfd)->fd = io->fd;
+	}
+
+	(void)ioloop_iolist_add(&(*urfd)->list, io);
+	uring_poll_update(ctx, *urfd);
+}
+
+void io_loop_handle_remove(struct io_file *io, bool closed)
+{
+	struct ioloop_handler_context *ctx = io->io.ioloop->handler_context;
+	struct uring_fd **urfd;
+
+	urfd = array_idx_modifiable(&ctx->fd_index, io->fd);
+	(void)ioloop_iolist_del(&(*urfd)->list, io);
+	if (!closed)
+		uring_poll_update(ctx, *urfd);
+	else if ((*urfd)->pending_polls > 0) {
+		/* an in-flight poll holds a reference to the file, so it has
+		   to be canceled explicitly or the close gets delayed */
+		uring_poll_cancel(ctx, *urfd);
+	}
+	i_free(io);
+}
+
+static void
+uring_handle_cqe(struct ioloop *ioloop, const struct io_uring_cqe *cqe)
+{
+	struct ioloop_handler_context *ctx = ioloop->handler_context;
+	struct uring_fd *urfd;
+	struct io_file *io;
+	uint32_t revents;
+	int i;
+	bool call;
+
+	if (cqe->user_data < URING_UDATA_SPECIAL_MAX) {
+		/* timeout or cancel completion */
+		return;
+	}
+	urfd = (struct uring_fd *)(uintptr_t)cqe->user_data;
+	i_assert(urfd->pending_polls > 0);
+	urfd->pending_polls--;
+
+	if (urfd->pending_polls > 0) {
+		/* completion of a poll that was already canceled */
+		return;
+	}
+	if (cqe->res < 0) {
+		/* canceled (or the fd was closed) - re-arm if ios remain */
+		uring_poll_update(ctx, urfd);
+		return;
+	}
+
+	revents = (uint32_t)cqe->res;
+	for (i = 0; i < IOLOOP_IOLIST_IOS_PER_FD; i++) {
+		io = urfd->list.ios[i];
+		if (io == NULL)
+			continue;
+
+		call = FALSE;
+		if ((revents & (POLLHUP | POLLERR)) != 0)
+			call = TRUE;
+		else if ((io->io.condition & IO_READ) != 0)
+			call = (revents & POLLIN) != 0;
+		else if ((io->io.condition & IO_WRITE) != 0)
+			call = (revents & POLLOUT) != 0;
+		else if ((io->io.condition & IO_ERROR) != 0)
+			call = (revents & (POLLERR | POLLHUP)) != 0;
+
+		if (call)
+			io_loop_call_io(&io->io);
+		if (!ioloop->running)
+			break;
+	}
+	/* oneshot poll was consumed - arm the next one */
+	uring_poll_update(ctx, urfd);
+}
+
+void io_loop_handler_run_internal(struct ioloop *ioloop)
+{
+	struct ioloop_handler_context *ctx = ioloop->handler_context;
+	struct io_uring_sqe *sqe;
+	struct __kernel_timespec ts;
+	struct timeval tv;
+	unsigned int head, tail;
+	int msecs, ret;
+
+	i_assert(ctx != NULL);
+
+	/* get the time left for next timeout task */
+	msecs = io_loop_run_get_wait_time(ioloop, &tv);
+
+	if (msecs >= 0) {
+		ts.tv_sec = tv.tv_sec;
+		ts.tv_nsec = tv.tv_usec * 1000;
+		sqe = uring_get_sqe(ctx);
+		sqe->opcode = IORING_OP_TIMEOUT;
+		sqe->fd = -1;
+		sqe->addr = (uintptr_t)&ts;
+		sqe->len = 1;
+		/* also complete after the first event, so expired timeouts
+		   don't pile up in the completion ring */
+		sqe->off = 1;
+		sqe->user_data = URING_UDATA_TIMEOUT;
+	}
+
+	while ((ret = sys_io_uring_enter(ctx->ring_fd, ctx->to_submit, 1,
+					 IORING_ENTER_GETEVENTS)) < 0) {
+		if (errno == EINTR)
+			break;
+		i_fatal("io_uring_enter(wait) failed: %m");
+	}
+	if (ret > 0)
+		ctx->to_submit -= ret;
+
+	/* execute timeout handlers */
+	io_loop_handle_timeouts(ioloop);
+
+	head = *ctx->cq_head;
+	tail = __atomic_load_n(ctx->cq_tail, __ATOMIC_ACQUIRE);
+	for (; head != tail; head++) {
+		if (!ioloop->running)
+			break;
+		uring_handle_cqe(ioloop,
+				 &ctx->cqes[head & *ctx->cq_ring_mask]);
+	}
+	__atomic_store_n(ctx->cq_head, head, __ATOMIC_RELEASE);
+}
+
+#endif	/* IOLOOP_URING */
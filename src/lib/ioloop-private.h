@@ -18,6 +18,14 @@ struct ioloop {
 	struct io_file *next_io_file;
 	struct priorityq *timeouts;
 	ARRAY(struct timeout *) timeouts_new;
+	/* Timer wheel for coarse periodic timeouts (idle/keepalive class),
+	   keyed by next_run seconds. timeout_reset() on these is O(1)
+	   instead of a priorityq reposition. Allocated lazily on first use.
+	   Expired entries are moved into the priorityq, which keeps the
+	   callback ordering and time-moved handling in one place. */
+	struct timeout **timer_wheel;
+	unsigned int timer_wheel_count;
+	time_t timer_wheel_next_sec;
 	struct io_wait_timer *wait_timers;
 
         struct ioloop_handler_context *handler_context;
@@ -69,6 +77,8 @@ struct io_file {
 
 struct timeout {
 	struct priorityq_item item;
+	/* linkage within the ioloop's timer wheel slot */
+	struct timeout *wheel_prev, *wheel_next;
 	const char *source_filename;
 	unsigned int source_linenum;
 
@@ -82,6 +92,7 @@ struct timeout {
 	struct ioloop_context *ctx;
 
 	bool one_shot:1;
+	bool in_wheel:1;
 };
 
 struct io_wait_timer {
@@ -19,6 +19,16 @@
    logging many warnings about this, use a rather high value. */
 #define IOLOOP_TIME_MOVED_FORWARDS_MIN_USECS (100000)
 
+/* Periodic timeouts at least this long are tracked in a timer wheel keyed by
+   their next run second instead of the priorityq, making timeout_reset() for
+   them O(1). The longest such timeout must fit within one wheel lap, so the
+   wheel slot scan can always stop at the first non-empty slot. */
+#define IOLOOP_TIMER_WHEEL_BITS 11
+#define IOLOOP_TIMER_WHEEL_SLOTS (1U << IOLOOP_TIMER_WHEEL_BITS)
+#define IOLOOP_TIMER_WHEEL_MIN_MSECS 2000
+#define IOLOOP_TIMER_WHEEL_MAX_MSECS \
+	((IOLOOP_TIMER_WHEEL_SLOTS - 2) * 1000)
+
 time_t ioloop_time = 0;
 struct timeval ioloop_timeval;
 struct ioloop *current_ioloop = NULL;
@@ -254,6 +264,132 @@ static void timeout_update_next(struct timeout *timeout, struct timeval *tv_now)
 	}
 }
 
+static bool timeout_is_wheel_eligible(const struct timeout *timeout)
+{
+	return !timeout->one_shot &&
+		timeout->msecs >= IOLOOP_TIMER_WHEEL_MIN_MSECS &&
+		timeout->msecs <= IOLOOP_TIMER_WHEEL_MAX_MSECS;
+}
+
+static unsigned int timer_wheel_slot(time_t sec)
+{
+	return (unsigned int)sec & (IOLOOP_TIMER_WHEEL_SLOTS - 1);
+}
+
+static void
+io_loop_timer_wheel_link(struct ioloop *ioloop, struct timeout *timeout)
+{
+	unsigned int slot = timer_wheel_slot(timeout->next_run.tv_sec);
+
+	if (ioloop->timer_wheel == NULL) {
+		ioloop->timer_wheel =
+			i_new(struct timeout *, IOLOOP_TIMER_WHEEL_SLOTS);
+		ioloop->timer_wheel_next_sec = timeout->next_run.tv_sec;
+	}
+	/* make sure slots before this timeout's second aren't skipped */
+	if (timeout->next_run.tv_sec < ioloop->timer_wheel_next_sec)
+		ioloop->timer_wheel_next_sec = timeout->next_run.tv_sec;
+
+	DLLIST_PREPEND_FULL(&ioloop->timer_wheel[slot], timeout,
+			    wheel_prev, wheel_next);
+	timeout->in_wheel = TRUE;
+	ioloop->timer_wheel_count++;
+}
+
+static void io_loop_timer_wheel_unlink(struct timeout *timeout)
+{
+	struct ioloop *ioloop = timeout->ioloop;
+	unsigned int slot = timer_wheel_slot(timeout->next_run.tv_sec);
+
+	i_assert(ioloop->timer_wheel_count > 0);
+
+	DLLIST_REMOVE_FULL(&ioloop->timer_wheel[slot], timeout,
+			   wheel_prev, wheel_next);
+	timeout->in_wheel = FALSE;
+	ioloop->timer_wheel_count--;
+}
+
+static void
+io_loop_timer_wheel_expire(struct ioloop *ioloop, const struct timeval *tv_call)
+{
+	struct timeout *timeout, *next;
+	time_t sec, last_sec;
+
+	if (ioloop->timer_wheel_count == 0) {
+		ioloop->timer_wheel_next_sec = tv_call->tv_sec;
+		return;
+	}
+
+	sec = ioloop->timer_wheel_next_sec;
+	last_sec = tv_call->tv_sec;
+	if (last_sec - sec >= (time_t)IOLOOP_TIMER_WHEEL_SLOTS) {
+		/* time jumped far enough that every slot needs a look */
+		last_sec = sec + IOLOOP_TIMER_WHEEL_SLOTS - 1;
+	}
+	for (; sec <= last_sec; sec++) {
+		timeout = ioloop->timer_wheel[timer_wheel_slot(sec)];
+		for (; timeout != NULL; timeout = next) {
+			next = timeout->wheel_next;
+			/* entries a full wheel lap ahead share the slot -
+			   leave them to wait for their own lap */
+			if (timeval_cmp(&timeout->next_run, tv_call) > 0)
+				continue;
+			io_loop_timer_wheel_unlink(timeout);
+			priorityq_add(ioloop->timeouts, &timeout->item);
+		}
+	}
+	ioloop->timer_wheel_next_sec = tv_call->tv_sec;
+}
+
+static bool
+io_loop_timer_wheel_get_next(struct ioloop *ioloop, struct timeval *tv_next_r,
+			     struct timeval *tv_now)
+{
+	const struct timeout *timeout;
+	time_t sec;
+	unsigned int i;
+	bool found;
+
+	if (ioloop->timer_wheel_count == 0)
+		return FALSE;
+	if (tv_now->tv_sec == 0)
+		i_gettimeofday(tv_now);
+
+	sec = ioloop->timer_wheel_next_sec;
+	for (i = 0; i < IOLOOP_TIMER_WHEEL_SLOTS; i++, sec++) {
+		timeout = ioloop->timer_wheel[timer_wheel_slot(sec)];
+		if (timeout == NULL)
+			continue;
+		if (sec > tv_now->tv_sec) {
+			/* the earliest entry in this slot can't run before
+			   the start of its second - a good enough lower
+			   bound, the exact time gets computed once the
+			   second is reached */
+			tv_next_r->tv_sec = sec;
+			tv_next_r->tv_usec = 0;
+			return TRUE;
+		}
+		/* entries in this slot may already be due - find the
+		   earliest one on the current lap */
+		found = FALSE;
+		for (; timeout != NULL; timeout = timeout->wheel_next) {
+			if (timeout->next_run.tv_sec > sec)
+				continue;
+			if (!found ||
+			    timeval_cmp(&timeout->next_run, tv_next_r) < 0) {
+				*tv_next_r = timeout->next_run;
+				found = TRUE;
+			}
+		}
+		if (found)
+			return TRUE;
+	}
+	/* all entries are further than a full lap away - shouldn't normally
+	   happen, but make sure we don't oversleep */
+	*tv_next_r = *tv_now;
+	return TRUE;
+}
+
 static struct timeout *
 timeout_add_common(struct ioloop *ioloop, const char *source_filename,
 		   unsigned int source_linenum,
@@ -377,7 +513,9 @@ timeout_copy(const struct timeout *old_to, struct ioloop *ioloop)
 	new_to->msecs = old_to->msecs;
 	new_to->next_run = old_to->next_run;
 
-	if (old_to->item.idx != UINT_MAX)
+	if (old_to->in_wheel)
+		io_loop_timer_wheel_link(new_to->ioloop, new_to);
+	else if (old_to->item.idx != UINT_MAX)
 		priorityq_add(new_to->ioloop->timeouts, &new_to->item);
 	else if (!new_to->one_shot) {
 		i_assert(new_to->msecs > 0);
@@ -405,7 +543,9 @@ void timeout_remove(struct timeout **_timeout)
 	ioloop = timeout->ioloop;
 
 	*_timeout = NULL;
-	if (timeout->item.idx != UINT_MAX)
+	if (timeout->in_wheel)
+		io_loop_timer_wheel_unlink(timeout);
+	else if (timeout->item.idx != UINT_MAX)
 		priorityq_remove(timeout->ioloop->timeouts, &timeout->item);
 	else if (!timeout->one_shot && timeout->msecs > 0) {
 		struct timeout *const *to_idx;
@@ -423,8 +563,14 @@ void timeout_remove(struct timeout **_timeout)
 static void ATTR_NULL(2)
 timeout_reset_timeval(struct timeout *timeout, struct timeval *tv_now)
 {
-	if (timeout->item.idx == UINT_MAX)
+	if (timeout->in_wheel) {
+		/* unlink before next_run changes - the wheel slot is
+		   derived from it */
+		io_loop_timer_wheel_unlink(timeout);
+	} else if (timeout->item.idx == UINT_MAX)
 		return;
+	else
+		priorityq_remove(timeout->ioloop->timeouts, &timeout->item);
 
 	timeout_update_next(timeout, tv_now);
 	/* If we came here from io_loop_handle_timeouts_real(), next_run must
@@ -440,8 +586,10 @@ timeout_reset_timeval(struct timeout *timeout, struct timeval *tv_now)
 		timeout->next_run = *tv_now;
 		timeval_add_usecs(&timeout->next_run, 1);
 	}
-	priorityq_remove(timeout->ioloop->timeouts, &timeout->item);
-	priorityq_add(timeout->ioloop->timeouts, &timeout->item);
+	if (timeout_is_wheel_eligible(timeout))
+		io_loop_timer_wheel_link(timeout->ioloop, timeout);
+	else
+		priorityq_add(timeout->ioloop->timeouts, &timeout->item);
 }
 
 void timeout_reset(struct timeout *timeout)
@@ -450,8 +598,9 @@ void timeout_reset(struct timeout *timeout)
 	timeout_reset_timeval(timeout, NULL);
 }
 
-static int timeout_get_wait_time(struct timeout *timeout, struct timeval *tv_r,
-				 struct timeval *tv_now, bool in_timeout_loop)
+static int timeout_timeval_get_wait_time(const struct timeval *next_run,
+					 struct timeval *tv_r,
+					 struct timeval *tv_now)
 {
 	int ret;
 
@@ -461,10 +610,10 @@ static int timeout_get_wait_time(struct timeout *timeout, struct timeval *tv_r,
 	tv_r->tv_usec = tv_now->tv_usec;
 
 	i_assert(tv_r->tv_sec > 0);
-	i_assert(timeout->next_run.tv_sec > 0);
+	i_assert(next_run->tv_sec > 0);
 
-	tv_r->tv_sec = timeout->next_run.tv_sec - tv_r->tv_sec;
-	tv_r->tv_usec = timeout->next_run.tv_usec - tv_r->tv_usec;
+	tv_r->tv_sec = next_run->tv_sec - tv_r->tv_sec;
+	tv_r->tv_usec = next_run->tv_usec - tv_r->tv_usec;
 	if (tv_r->tv_usec < 0) {
 		tv_r->tv_sec--;
 		tv_r->tv_usec += 1000000;
@@ -476,12 +625,6 @@ static int timeout_get_wait_time(struct timeout *timeout, struct timeval *tv_r,
 		tv_r->tv_usec = 0;
 		return 0;
 	}
-	if (tv_r->tv_sec == 0 && tv_r->tv_usec == 1 && !in_timeout_loop) {
-		/* Possibly 0 ms timeout. Don't wait for a full millisecond
-		   for it to trigger. */
-		tv_r->tv_usec = 0;
-		return 0;
-	}
 	if (tv_r->tv_sec > INT_MAX/1000-1)
 		tv_r->tv_sec = INT_MAX/1000-1;
 
@@ -491,11 +634,28 @@ static int timeout_get_wait_time(struct timeout *timeout, struct timeval *tv_r,
 	return ret;
 }
 
+static int timeout_get_wait_time(struct timeout *timeout, struct timeval *tv_r,
+				 struct timeval *tv_now, bool in_timeout_loop)
+{
+	int ret;
+
+	ret = timeout_timeval_get_wait_time(&timeout->next_run, tv_r, tv_now);
+	if (ret > 0 && tv_r->tv_sec == 0 && tv_r->tv_usec == 1 &&
+	    !in_timeout_loop) {
+		/* Possibly 0 ms timeout. Don't wait for a full millisecond
+		   for it to trigger. */
+		tv_r->tv_usec = 0;
+		return 0;
+	}
+	return ret;
+}
+
 static int io_loop_get_wait_time(struct ioloop *ioloop, struct timeval *tv_r)
 {
-	struct timeval tv_now;
+	struct timeval tv_now, tv_wheel;
 	struct priorityq_item *item;
 	struct timeout *timeout;
+	bool have_wheel;
 	int msecs;
 
 	item = priorityq_peek(ioloop->timeouts);
@@ -504,7 +664,8 @@ static int io_loop_get_wait_time(struct ioloop *ioloop, struct timeval *tv_r)
 	/* we need to see if there are pending IO waiting,
 	   if there is, we set msecs = 0 to ensure they are
 	   processed without delay */
-	if (timeout == NULL && ioloop->io_pending_count == 0) {
+	if (timeout == NULL && ioloop->timer_wheel_count == 0 &&
+	    ioloop->io_pending_count == 0) {
 		/* no timeouts. use INT_MAX msecs for timeval and
 		   return -1 for poll/epoll infinity. */
 		tv_r->tv_sec = INT_MAX / 1000;
@@ -521,7 +682,16 @@ static int io_loop_get_wait_time(struct ioloop *ioloop, struct timeval *tv_r)
 		tv_r->tv_usec = 0;
 	} else {
 		tv_now.tv_sec = 0;
-		msecs = timeout_get_wait_time(timeout, tv_r, &tv_now, FALSE);
+		have_wheel = io_loop_timer_wheel_get_next(ioloop, &tv_wheel,
+							  &tv_now);
+		msecs = timeout == NULL ? -1 :
+			timeout_get_wait_time(timeout, tv_r, &tv_now, FALSE);
+		if (have_wheel &&
+		    (timeout == NULL ||
+		     timeval_cmp(&tv_wheel, &timeout->next_run) < 0)) {
+			msecs = timeout_timeval_get_wait_time(&tv_wheel, tv_r,
+							      &tv_now);
+		}
 	}
 	ioloop->next_max_time = tv_now;
 	timeval_add_msecs(&ioloop->next_max_time, msecs);
@@ -531,7 +701,8 @@ static int io_loop_get_wait_time(struct ioloop *ioloop, struct timeval *tv_r)
 	   ioloop and after that we update ioloop_timeval immediately again. */
 	ioloop_timeval = tv_now;
 	ioloop_time = tv_now.tv_sec;
-	i_assert(msecs == 0 || timeout->msecs > 0 || timeout->one_shot);
+	i_assert(msecs == 0 || timeout == NULL ||
+		 timeout->msecs > 0 || timeout->one_shot);
 	return msecs;
 }
 
@@ -587,11 +758,44 @@ static void io_loop_timeouts_start_new(struct ioloop *ioloop)
 		i_assert(!timeout->one_shot);
 		i_assert(timeout->msecs > 0);
 		timeout_update_next(timeout, &ioloop_timeval);
-		priorityq_add(ioloop->timeouts, &timeout->item);
+		if (timeout_is_wheel_eligible(timeout))
+			io_loop_timer_wheel_link(ioloop, timeout);
+		else
+			priorityq_add(ioloop->timeouts, &timeout->item);
 	}
 	array_clear(&ioloop->timeouts_new);
 }
 
+static void
+io_loop_timer_wheel_timeouts_update(struct ioloop *ioloop, long long diff_usecs)
+{
+	struct timeout *timeouts = NULL, *to, *next;
+	unsigned int i;
+
+	if (ioloop->timer_wheel_count == 0)
+		return;
+
+	/* the wheel slot is derived from next_run, so every entry has to be
+	   unlinked and relinked with the updated time */
+	for (i = 0; i < IOLOOP_TIMER_WHEEL_SLOTS; i++) {
+		for (to = ioloop->timer_wheel[i]; to != NULL; to = next) {
+			next = to->wheel_next;
+			to->wheel_next = timeouts;
+			timeouts = to;
+		}
+		ioloop->timer_wheel[i] = NULL;
+	}
+	ioloop->timer_wheel_count = 0;
+	for (to = timeouts; to != NULL; to = next) {
+		next = to->wheel_next;
+		if (diff_usecs > 0)
+			timeval_add_usecs(&to->next_run, diff_usecs);
+		else
+			timeval_sub_usecs(&to->next_run, -diff_usecs);
+		io_loop_timer_wheel_link(ioloop, to);
+	}
+}
+
 static void io_loop_timeouts_update(struct ioloop *ioloop, long long diff_usecs)
 {
 	struct priorityq_item *const *items;
@@ -607,6 +811,7 @@ static void io_loop_timeouts_update(struct ioloop *ioloop, long long diff_usecs)
 		else
 			timeval_sub_usecs(&to->next_run, -diff_usecs);
 	}
+	io_loop_timer_wheel_timeouts_update(ioloop, diff_usecs);
 }
 
 static void io_loops_timeouts_update(long long diff_usecs)
@@ -669,6 +874,10 @@ static void io_loop_handle_timeouts_real(struct ioloop *ioloop)
 	ioloop_time = ioloop_timeval.tv_sec;
 	tv_call = ioloop_timeval;
 
+	/* move expired timer wheel entries into the priorityq, so they get
+	   called in next_run order together with the other timeouts */
+	io_loop_timer_wheel_expire(ioloop, &tv_call);
+
 	while (ioloop->running &&
 	       (item = priorityq_peek(ioloop->timeouts)) != NULL) {
 		struct timeout *timeout = (struct timeout *)item;
@@ -908,6 +1117,30 @@ void io_loop_destroy(struct ioloop **_ioloop)
 	}
 	array_free(&ioloop->timeouts_new);
 
+	if (ioloop->timer_wheel != NULL) {
+		unsigned int i;
+
+		for (i = 0; i < IOLOOP_TIMER_WHEEL_SLOTS; i++) {
+			while ((to = ioloop->timer_wheel[i]) != NULL) {
+				const char *error = t_strdup_printf(
+					"Timeout leak: %p (%s:%u)",
+					(void *)to->callback,
+					to->source_filename,
+					to->source_linenum);
+
+				if (panic_on_leak)
+					i_panic("%s", error);
+				else
+					i_warning("%s", error);
+				io_loop_timer_wheel_unlink(to);
+				timeout_free(to);
+				leaks = TRUE;
+			}
+		}
+		i_assert(ioloop->timer_wheel_count == 0);
+		i_free(ioloop->timer_wheel);
+	}
+
 	while ((item = priorityq_pop(ioloop->timeouts)) != NULL) {
 		struct timeout *to = (struct timeout *)item;
 		const char *error = t_strdup_printf(
@@ -1303,6 +1536,7 @@ bool io_loop_is_empty(struct ioloop *ioloop)
 {
 	return ioloop->io_files == NULL &&
 		priorityq_count(ioloop->timeouts) == 0 &&
+		ioloop->timer_wheel_count == 0 &&
 		array_count(&ioloop->timeouts_new) == 0;
 }
 
@@ -153,6 +153,12 @@ void iostream_proxy_stop(struct iostream_proxy *proxy)
 	iostream_pump_stop(proxy->rtl);
 }
 
+void iostream_proxy_set_try_splice(struct iostream_proxy *proxy, bool set)
+{
+	iostream_pump_set_try_splice(proxy->ltr, set);
+	iostream_pump_set_try_splice(proxy->rtl, set);
+}
+
 bool iostream_proxy_is_waiting_output(struct iostream_proxy *proxy,
 				      enum iostream_proxy_side side)
 {
@@ -68,6 +68,12 @@ struct ostream *iostream_proxy_get_ostream(struct iostream_proxy *proxy, enum io
 void iostream_proxy_start(struct iostream_proxy *proxy);
 void iostream_proxy_stop(struct iostream_proxy *proxy);
 
+/* Enable the splice() fast path for both directions - see
+   iostream_pump_set_try_splice(). Each direction checks at runtime that its
+   streams really read/write their fds directly, so this is safe to enable
+   even when one or both sides turn out to have a TLS layer in between. */
+void iostream_proxy_set_try_splice(struct iostream_proxy *proxy, bool set);
+
 /* See iostream_pump_is_waiting_output() */
 bool iostream_proxy_is_waiting_output(struct iostream_proxy *proxy,
 				      enum iostream_proxy_side side);
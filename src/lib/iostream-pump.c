@@ -1,12 +1,19 @@
 /* Copyright (c) 2002-2018 Dovecot authors, see the included COPYING file */
 
+/* for splice() */
+#define _GNU_SOURCE
+
 #include "lib.h"
 #include "buffer.h"
 #include "str.h"
+#include "fd-util.h"
 #include "iostream-pump.h"
 #include "istream.h"
 #include "ostream.h"
 #include <unistd.h>
+#ifdef HAVE_SPLICE
+#  include <fcntl.h>
+#endif
 
 #undef iostream_pump_set_completion_callback
 
@@ -21,15 +28,125 @@ struct iostream_pump {
 	iostream_pump_callback_t *callback;
 	void *context;
 
+	/* internal pipe for the splice() fast path */
+	int pipe_fds[2];
+	size_t pipe_data;
+	uint64_t spliced_bytes;
+
 	bool waiting_output;
 	bool completed;
+	bool try_splice;
+	bool splice_failed;
 };
 
+#ifdef HAVE_SPLICE
+
+#define IOSTREAM_PUMP_MAX_SPLICE_CHUNK (256 * 1024)
+
+static bool iostream_pump_splice_pipe_init(struct iostream_pump *pump)
+{
+	if (pump->pipe_fds[0] != -1)
+		return TRUE;
+	if (pipe(pump->pipe_fds) < 0) {
+		pump->splice_failed = TRUE;
+		return FALSE;
+	}
+	fd_close_on_exec(pump->pipe_fds[0], TRUE);
+	fd_close_on_exec(pump->pipe_fds[1], TRUE);
+	return TRUE;
+}
+
+/* Move data from the input fd to the output fd through an internal pipe
+   without copying it to userspace. Returns TRUE if the normal copying should
+   run (fast path isn't usable right now, input saw EOF, or an input error
+   should be reported through the normal read path), FALSE if everything that
+   can be done for now was done. */
+static bool iostream_pump_splice(struct iostream_pump *pump)
+{
+	int in_fd = i_stream_get_fd(pump->input);
+	int out_fd = o_stream_get_fd(pump->output);
+	ssize_t ret;
+
+	/* the fds must be the streams' actual data path - a TLS or other
+	   wrapper stream still returns the raw socket fd, and splicing
+	   through it would bypass the wrapper entirely */
+	if (in_fd == -1 || out_fd == -1 ||
+	    !pump->input->readable_fd || !pump->output->writable_fd ||
+	    pump->input->blocking || pump->output->blocking) {
+		pump->splice_failed = TRUE;
+		return TRUE;
+	}
+
+	for (;;) {
+		if (pump->pipe_data == 0) {
+			if (i_stream_get_data_size(pump->input) > 0 ||
+			    o_stream_get_buffer_used_size(pump->output) > 0) {
+				/* previously buffered data has to be written
+				   out in order before anything gets spliced
+				   past it */
+				return TRUE;
+			}
+			if (!iostream_pump_splice_pipe_init(pump))
+				return TRUE;
+			ret = splice(in_fd, NULL, pump->pipe_fds[1], NULL,
+				     IOSTREAM_PUMP_MAX_SPLICE_CHUNK,
+				     SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+			if (ret < 0) {
+				if (errno == EAGAIN) {
+					/* wait for more input */
+					return FALSE;
+				}
+				/* fd doesn't support splicing, or the input
+				   failed - either way let the normal copying
+				   handle it so the error shows up in the
+				   istream */
+				pump->splice_failed = TRUE;
+				return TRUE;
+			}
+			if (ret == 0) {
+				/* EOF - the normal copying sees it too and
+				   runs the completion logic */
+				return TRUE;
+			}
+			pump->pipe_data = ret;
+		}
+		ret = splice(pump->pipe_fds[0], NULL, out_fd, NULL,
+			     pump->pipe_data,
+			     SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+		if (ret < 0) {
+			if (errno != EAGAIN) {
+				/* the output is dead and the bytes in the
+				   pipe are lost, so there's no falling back
+				   to the copying path anymore */
+				io_remove(&pump->io);
+				pump->callback(IOSTREAM_PUMP_STATUS_OUTPUT_ERROR,
+					       pump->context);
+				return FALSE;
+			}
+			/* wait until the output fd is writable again */
+			pump->waiting_output = TRUE;
+			io_remove(&pump->io);
+			o_stream_set_flush_pending(pump->output, TRUE);
+			return FALSE;
+		}
+		pump->pipe_data -= ret;
+		pump->spliced_bytes += ret;
+	}
+}
+#endif
+
 static void iostream_pump_copy(struct iostream_pump *pump)
 {
 	enum ostream_send_istream_result res;
 	size_t old_size;
 
+#ifdef HAVE_SPLICE
+	if (pump->try_splice && !pump->splice_failed) {
+		if (!iostream_pump_splice(pump))
+			return;
+	}
+#endif
+
 	o_stream_cork(pump->output);
 	old_size = o_stream_get_max_buffer_size(pump->output);
 	o_stream_set_max_buffer_size(pump->output,
@@ -127,10 +244,21 @@ iostream_pump_create(struct istream *input, struct ostream *output)
 	pump->refcount = 1;
 	pump->input = input;
 	pump->output = output;
+	pump->pipe_fds[0] = pump->pipe_fds[1] = -1;
 
 	return pump;
 }
 
+void iostream_pump_set_try_splice(struct iostream_pump *pump, bool set)
+{
+	pump->try_splice = set;
+}
+
+uint64_t iostream_pump_get_spliced_bytes(struct iostream_pump *pump)
+{
+	return pump->spliced_bytes;
+}
+
 void iostream_pump_start(struct iostream_pump *pump)
 {
 	i_assert(pump != NULL);
@@ -198,6 +326,10 @@ void iostream_pump_unref(struct iostream_pump **_pump)
 
 	iostream_pump_stop(pump);
 
+	if (pump->pipe_fds[0] != -1) {
+		i_close_fd(&pump->pipe_fds[0]);
+		i_close_fd(&pump->pipe_fds[1]);
+	}
 	o_stream_unref(&pump->output);
 	i_stream_unref(&pump->input);
 	i_free(pump);
@@ -56,6 +56,17 @@ void iostream_pump_set_completion_callback(struct iostream_pump *pump,
 		CALLBACK_TYPECHECK(callback, \
 			void (*)(enum iostream_pump_status, typeof(context))))
 
+/* Try to move data with splice() through an internal pipe instead of copying
+   it through userspace. The fast path engages only while both streams read
+   and write their fds directly (readable_fd/writable_fd - e.g. a TLS stream
+   returns the raw socket fd but doesn't qualify), are non-blocking and have
+   no buffered data; anything else falls back transparently to the normal
+   copying, as do splice() failures. Ignored on systems without splice().
+   Note that spliced bytes don't show up in the streams' offsets. */
+void iostream_pump_set_try_splice(struct iostream_pump *pump, bool set);
+/* Returns the number of bytes moved with splice(). */
+uint64_t iostream_pump_get_spliced_bytes(struct iostream_pump *pump);
+
 /* Returns TRUE if the pump is currently only writing to the ostream. The input
    listener has been removed either because the ostream buffer is full or
    because the istream already returned EOF. This function can also be called
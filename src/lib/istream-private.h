@@ -6,6 +6,10 @@
 
 #define I_STREAM_MIN_SIZE IO_BLOCK_SIZE
 
+/* If more than half of a stream's allocated read buffer hasn't been needed
+   for this many seconds, the buffer is shrunk back on the next read. */
+#define I_STREAM_SHRINK_IDLE_SECS 30
+
 struct io;
 
 struct istream_private {
@@ -39,6 +43,9 @@ struct istream_private {
 
 	size_t buffer_size, max_buffer_size, init_buffer_size, data_limit;
 	size_t skip, pos;
+	/* ioloop time when more than half of the allocated buffer was last
+	   needed. Used for shrinking idle read buffers. */
+	time_t last_high_usage_time;
 	/* If seeking backwards within the buffer, the next read() will
 	   return again pos..high_pos */
 	size_t high_pos;
@@ -1,5 +1,8 @@
 /* Copyright (c) 2005-2018 Dovecot authors, see the included COPYING file */
 
+/* for O_TMPFILE */
+#define _GNU_SOURCE
+
 #include "lib.h"
 #include "buffer.h"
 #include "str.h"
@@ -12,6 +15,11 @@
 #include "istream-seekable.h"
 
 #include <unistd.h>
+#include <fcntl.h>
+
+/* How much of the temp file to ask the kernel to read ahead when seeking
+   backwards into already-written data. */
+#define ISTREAM_SEEKABLE_READAHEAD_SIZE (1024*1024)
 
 struct seekable_istream {
 	struct istream_private istream;
@@ -396,6 +404,20 @@ static void i_stream_seekable_seek(struct istream_private *stream,
 {
 	if (v_offset <= stream->istream.v_offset) {
 		/* seeking backwards */
+#ifdef HAVE_POSIX_FADVISE
+		struct seekable_istream *sstream =
+			container_of(stream, struct seekable_istream, istream);
+
+		if (sstream->fd != -1 && v_offset < sstream->write_peak) {
+			/* the data is re-read from the temp file - start
+			   reading it ahead, so the following preads don't
+			   block on disk one buffer at a time */
+			size_t len = I_MIN(sstream->write_peak - v_offset,
+					   ISTREAM_SEEKABLE_READAHEAD_SIZE);
+			(void)posix_fadvise(sstream->fd, v_offset, len,
+					    POSIX_FADV_WILLNEED);
+		}
+#endif
 		stream->istream.v_offset = v_offset;
 		stream->skip = stream->pos = 0;
 	} else {
@@ -513,6 +535,22 @@ static int seekable_fd_callback(const char **path_r, void *context)
 	string_t *path;
 	int fd;
 
+#ifdef O_TMPFILE
+	/* an unnamed temp file avoids the create+unlink syscalls and the
+	   directory churn of mkstemp */
+	const char *p = strrchr(temp_path_prefix, '/');
+	const char *dir = p == NULL ? "." :
+		t_strdup_until(temp_path_prefix, p);
+
+	fd = open(dir, O_TMPFILE | O_RDWR, 0600);
+	if (fd != -1) {
+		*path_r = t_strconcat(dir, "/(O_TMPFILE)", NULL);
+		return fd;
+	}
+	/* fall back to a named temp file (old kernel or filesystem without
+	   O_TMPFILE support) */
+#endif
+
 	path = t_str_new(128);
 	str_append(path, temp_path_prefix);
 	fd = safe_mkstemp(path, 0600, (uid_t)-1, (gid_t)-1);
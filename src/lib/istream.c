@@ -8,6 +8,16 @@
 #include "istream-private.h"
 
 static bool i_stream_is_buffer_invalid(const struct istream_private *stream);
+static void i_stream_try_shrink_buffer(struct istream_private *stream);
+
+/* Total number of bytes currently allocated for the w_buffers of all
+   istreams in this process. */
+static size_t istream_total_buffer_usage = 0;
+
+size_t i_stream_get_total_buffer_usage(void)
+{
+	return istream_total_buffer_usage;
+}
 
 void i_stream_set_name(struct istream *stream, const char *name)
 {
@@ -341,6 +351,9 @@ ssize_t i_stream_read_memarea(struct istream *stream)
 	if (_stream->parent != NULL)
 		i_stream_seek(_stream->parent, _stream->parent_expected_offset);
 
+	if (_stream->skip == _stream->pos)
+		i_stream_try_shrink_buffer(_stream);
+
 	old_size = _stream->pos - _stream->skip;
 	if (_stream->pos < _stream->high_pos) {
 		/* we're here because we seeked back within the read buffer. */
@@ -375,6 +388,9 @@ ssize_t i_stream_read_memarea(struct istream *stream)
 		i_assert(_stream->skip < _stream->pos);
 		i_assert((size_t)ret+old_size == _stream->pos - _stream->skip);
 		_stream->last_read_timeval = ioloop_timeval;
+		if (_stream->buffer == _stream->w_buffer &&
+		    _stream->pos * 2 >= _stream->buffer_size)
+			_stream->last_high_usage_time = ioloop_time;
 		break;
 	}
 
@@ -450,6 +466,7 @@ void i_stream_free_buffer(struct istream_private *stream)
 	if (stream->memarea != NULL) {
 		memarea_unref(&stream->memarea);
 		stream->w_buffer = NULL;
+		istream_total_buffer_usage -= stream->buffer_size;
 	} else if (stream->w_buffer != NULL) {
 		i_free_and_null(stream->w_buffer);
 	} else {
@@ -875,6 +892,8 @@ i_stream_w_buffer_realloc(struct istream_private *stream, size_t old_size)
 
 	stream->memarea = memarea_init(stream->w_buffer, stream->buffer_size,
 				       i_stream_w_buffer_free, new_buffer);
+	istream_total_buffer_usage = istream_total_buffer_usage -
+		old_size + stream->buffer_size;
 }
 
 void i_stream_grow_buffer(struct istream_private *stream, size_t bytes)
@@ -896,8 +915,36 @@ void i_stream_grow_buffer(struct istream_private *stream, size_t bytes)
 
 	if (stream->buffer_size <= old_size)
 		stream->buffer_size = old_size;
-	else
+	else {
 		i_stream_w_buffer_realloc(stream, old_size);
+		stream->last_high_usage_time = ioloop_time;
+	}
+}
+
+static void i_stream_try_shrink_buffer(struct istream_private *stream)
+{
+	size_t old_size, new_size;
+
+	if (stream->buffer_size <= stream->init_buffer_size)
+		return;
+	if (stream->skip != stream->pos || stream->high_pos != 0)
+		return;
+	if (stream->memarea == NULL || stream->buffer != stream->w_buffer ||
+	    memarea_get_refcount(stream->memarea) > 1)
+		return;
+	if (ioloop_time - stream->last_high_usage_time <
+	    I_STREAM_SHRINK_IDLE_SECS)
+		return;
+
+	/* The buffer is empty and most of it hasn't been needed for a
+	   while. Return the extra memory back above the initial size. */
+	new_size = I_MAX(stream->init_buffer_size, I_STREAM_MIN_SIZE);
+	if (new_size >= stream->buffer_size)
+		return;
+	stream->skip = stream->pos = 0;
+	old_size = stream->buffer_size;
+	stream->buffer_size = new_size;
+	i_stream_w_buffer_realloc(stream, old_size);
 }
 
 bool i_stream_try_alloc(struct istream_private *stream,
@@ -976,6 +1023,7 @@ void i_stream_memarea_detach(struct istream_private *stream)
 		/* Don't overwrite data in a snapshot. Allocate a new
 		   buffer instead. */
 		memarea_unref(&stream->memarea);
+		istream_total_buffer_usage -= stream->buffer_size;
 		stream->buffer_size = 0;
 		stream->buffer = NULL;
 		stream->w_buffer = NULL;
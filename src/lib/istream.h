@@ -136,6 +136,11 @@ void i_stream_set_max_buffer_size(struct istream *stream, size_t max_size);
    buffer size. This is needed because some streams (e.g. istream-chain) change
    their max buffer size dynamically. */
 size_t i_stream_get_max_buffer_size(struct istream *stream);
+/* Returns the total number of bytes currently allocated for the read buffers
+   of all the istreams in this process. Idle streams' buffers are shrunk back
+   towards their initial size automatically, so this mainly shows the
+   buffer memory of recently active streams. */
+size_t i_stream_get_total_buffer_usage(void);
 /* Enable/disable i_stream[_read]_next_line() returning the last line if it
    doesn't end with LF. */
 void i_stream_set_return_partial_line(struct istream *stream, bool set);
@@ -173,9 +173,38 @@ static bool json_parse_whitespace(struct json_parser *parser)
 	return FALSE;
 }
 
+/* Word-at-a-time scanning for the bytes that need special handling inside
+   a JSON string: the terminating '"', the '\' starting an escape sequence
+   and NUL. Everything in between is passed through unmodified, so there's
+   no need to look at it byte by byte. */
+#define JSON_SCAN_ONES ((size_t)-1 / 0xff)
+#define JSON_SCAN_HIGH_BITS (JSON_SCAN_ONES * 0x80)
+#define json_scan_word_has_zero(w) \
+	((((w) - JSON_SCAN_ONES) & ~(w) & JSON_SCAN_HIGH_BITS) != 0)
+#define json_scan_word_has_byte(w, b) \
+	json_scan_word_has_zero((w) ^ (JSON_SCAN_ONES * (b)))
+
+static const unsigned char *
+json_scan_string_run(const unsigned char *data, const unsigned char *end)
+{
+	size_t w;
+
+	while ((size_t)(end - data) >= sizeof(w)) {
+		memcpy(&w, data, sizeof(w));
+		if (json_scan_word_has_zero(w) ||
+		    json_scan_word_has_byte(w, '"') ||
+		    json_scan_word_has_byte(w, '\\'))
+			break;
+		data += sizeof(w);
+	}
+	while (data != end && *data != '"' && *data != '\\' && *data != '\0')
+		data++;
+	return data;
+}
+
 static int json_skip_string(struct json_parser *parser)
 {
-	for (; parser->data != parser->end; parser->data++) {
+	while (parser->data != parser->end) {
 		if (*parser->data == '"') {
 			parser->data++;
 			json_parser_update_input_pos(parser);
@@ -206,6 +235,12 @@ static int json_skip_string(struct json_parser *parser)
 				parser->error = "Invalid escape string";
 				return -1;
 			}
+			parser->data++;
+		} else if (*parser->data == '\0') {
+			parser->data++;
+		} else {
+			parser->data = json_scan_string_run(parser->data,
+							    parser->end);
 		}
 	}
 	json_parser_update_input_pos(parser);
@@ -301,7 +336,7 @@ static int json_parse_string(struct json_parser *parser, bool allow_skip,
 	}
 
 	str_truncate(parser->value, 0);
-	for (; parser->data != parser->end; parser->data++) {
+	while (parser->data != parser->end) {
 		if (*parser->data == '"') {
 			parser->data++;
 			*value_r = str_c(parser->value);
@@ -340,14 +375,21 @@ static int json_parse_string(struct json_parser *parser, bool allow_skip,
 				parser->error = "Invalid escape string";
 				return -1;
 			}
+			parser->data++;
 			break;
 		case '\0':
 			parser->error = "NULs not supported in strings";
 			return -1;
-		default:
-			str_append_c(parser->value, *parser->data);
+		default: {
+			/* append the whole run of ordinary bytes at once */
+			const unsigned char *p =
+				json_scan_string_run(parser->data, parser->end);
+			str_append_data(parser->value, parser->data,
+					p - parser->data);
+			parser->data = p;
 			break;
 		}
+		}
 	}
 	return 0;
 }
@@ -61,6 +61,11 @@ struct event {
 	   after the event is sent. */
 	char *sending_name;
 
+	/* Union of the bloom filter bits of the categories in the array
+	   below. Derived data, not exported. Used by event filters for
+	   fast rejection. */
+	uint64_t category_bloom;
+
 	ARRAY(struct event_category *) categories;
 	ARRAY(struct event_field) fields;
 };
@@ -97,6 +102,14 @@ struct event_category *event_category_find_registered(const char *name);
 struct event_category *const *
 event_get_registered_categories(unsigned int *count_r);
 
+/* Return the bloom filter bits of a registered category, including the bits
+   of its parent categories. Returns 0 if the category isn't registered. */
+uint64_t event_category_get_bloom_bits(const struct event_category *category);
+/* Return the union of the bloom filter bits of all the categories that
+   event_has_category() would see for this event, i.e. including the parent
+   events and the global event with its parents. */
+uint64_t event_get_category_bloom(struct event *event);
+
 /* Register callback to be called for event's different states. */
 void event_register_callback(event_callback_t *callback);
 void event_unregister_callback(event_callback_t *callback);
@@ -4,6 +4,7 @@
 #include "lib-event-private.h"
 #include "event-filter.h"
 #include "array.h"
+#include "hash.h"
 #include "llist.h"
 #include "time-util.h"
 #include "str.h"
@@ -56,6 +57,10 @@ struct event_internal_category {
 	struct event_internal_category *parent;
 	char *name;
 	int refcount;
+
+	/* Bloom filter bits for this category and all of its parents.
+	   Used by event filters for fast rejection. */
+	uint64_t bloom_bits;
 };
 
 struct event_reason {
@@ -852,6 +857,10 @@ event_category_register(struct event_category *category)
 			internal->parent = category->parent->internal;
 		internal->name = i_strdup(category->name);
 		internal->refcount = 1;
+		internal->bloom_bits =
+			(uint64_t)1 << (str_hash(internal->name) % 64);
+		if (internal->parent != NULL)
+			internal->bloom_bits |= internal->parent->bloom_bits;
 		internal->representative.name = internal->name;
 		internal->representative.parent = category->parent;
 		internal->representative.internal = internal;
@@ -922,8 +931,13 @@ event_add_categories(struct event *event,
 
 	for (unsigned int i = 0; categories[i] != NULL; i++) {
 		representative = event_category_register(categories[i]);
-		if (!event_find_category(event, representative))
+		if (!event_find_category(event, representative)) {
+			struct event_internal_category *internal =
+				representative->internal;
+
 			array_push_back(&event->categories, &representative);
+			event->category_bloom |= internal->bloom_bits;
+		}
 	}
 	event_set_changed(event);
 	event_recalculate_debug_level(event);
@@ -937,6 +951,25 @@ event_add_category(struct event *event, struct event_category *category)
 	return event_add_categories(event, categories);
 }
 
+uint64_t event_category_get_bloom_bits(const struct event_category *category)
+{
+	const struct event_internal_category *internal = category->internal;
+
+	return internal == NULL ? 0 : internal->bloom_bits;
+}
+
+uint64_t event_get_category_bloom(struct event *event)
+{
+	uint64_t bloom = 0;
+
+	for (; event != NULL; event = event_get_parent(event))
+		bloom |= event->category_bloom;
+	for (event = event_get_global(); event != NULL;
+	     event = event_get_parent(event))
+		bloom |= event->category_bloom;
+	return bloom;
+}
+
 struct event_field *
 event_find_field_nonrecursive(const struct event *event, const char *key)
 {
@@ -1067,6 +1100,16 @@ event_add_str(struct event *event, const char *key, const char *value)
 		value = "";
 	}
 
+	field = event_find_field_nonrecursive(event, key);
+	if (field != NULL &&
+	    field->value_type == EVENT_FIELD_VALUE_TYPE_STR &&
+	    null_strcmp(field->value.str, value) == 0) {
+		/* setting the same value - avoid copying the string again
+		   and marking the event changed, which would cause it to be
+		   sent to stats again */
+		return event;
+	}
+
 	field = event_get_field(event, key, TRUE);
 	field->value_type = EVENT_FIELD_VALUE_TYPE_STR;
 	field->value.str = p_strdup(event->pool, value);
@@ -1124,6 +1167,14 @@ event_add_int(struct event *event, const char *key, intmax_t num)
 {
 	struct event_field *field;
 
+	field = event_find_field_nonrecursive(event, key);
+	if (field != NULL &&
+	    field->value_type == EVENT_FIELD_VALUE_TYPE_INTMAX &&
+	    field->value.intmax == num) {
+		/* setting the same value - avoid marking the event changed */
+		return event;
+	}
+
 	field = event_get_field(event, key, TRUE);
 	field->value_type = EVENT_FIELD_VALUE_TYPE_INTMAX;
 	field->value.intmax = num;
@@ -1589,6 +1640,7 @@ bool event_import_unescaped(struct event *event, const char *const *args,
 	   though, so clear it out. */
 	if (array_is_created(&event->categories))
 		array_clear(&event->categories);
+	event->category_bloom = 0;
 
 	/* required fields: */
 	if (args[0] == NULL) {
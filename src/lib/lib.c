@@ -198,6 +198,7 @@ void lib_deinit(void)
 	restrict_access_deinit();
 	i_close_fd(&dev_null_fd);
 	data_stack_deinit();
+	mempool_slab_cache_free_unused();
 	failures_deinit();
 	process_title_deinit();
 	random_deinit();
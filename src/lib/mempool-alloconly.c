@@ -125,6 +125,7 @@ struct alloconly_pool {
 	int refcount;
 
 	struct pool_block *block;
+	struct pool_acct *acct;
 #ifdef DEBUG
 	const char *name;
 	size_t base_size;
@@ -157,6 +158,161 @@ struct pool_block {
 #  define CLEAR_CHR 0
 #endif
 
+/* Freed blocks whose full size is an exact power of two within
+   [2^POOL_SLAB_MIN_BITS, 2^POOL_SLAB_MAX_BITS] are kept in per-size-class
+   free lists instead of being free()d, so pools that are created and
+   destroyed rapidly (e.g. once per IMAP command) reuse the same memory
+   instead of hitting malloc() each time. Blocks are zeroed when cached,
+   since allocations rely on blocks being zero-filled (see calloc() in
+   block_alloc()). */
+#define POOL_SLAB_MIN_BITS 9
+#define POOL_SLAB_MAX_BITS 18
+#define POOL_SLAB_MAX_BLOCK_COUNT 32
+
+struct slab_cached_block {
+	struct slab_cached_block *next;
+};
+
+static struct slab_cached_block *slab_cache[POOL_SLAB_MAX_BITS + 1];
+static unsigned int slab_cache_counts[POOL_SLAB_MAX_BITS + 1];
+static struct mempool_slab_stats slab_stats;
+
+static unsigned int slab_class_bits(size_t full_size)
+{
+	unsigned int bits = bits_required64(full_size) - 1;
+
+	/* cache only exact power-of-two blocks, so the size class alone
+	   identifies the block's size */
+	if (full_size != (size_t)1 << bits)
+		return 0;
+	if (bits < POOL_SLAB_MIN_BITS || bits > POOL_SLAB_MAX_BITS)
+		return 0;
+	return bits;
+}
+
+static struct pool_block *slab_cache_pop(size_t full_size)
+{
+	unsigned int bits = slab_class_bits(full_size);
+	struct slab_cached_block *cached;
+
+	if (bits == 0 || slab_cache[bits] == NULL)
+		return NULL;
+
+	cached = slab_cache[bits];
+	slab_cache[bits] = cached->next;
+	slab_cache_counts[bits]--;
+	slab_stats.cached_count--;
+	slab_stats.cached_bytes -= full_size;
+	/* everything except the list pointer was zeroed already when the
+	   block was cached */
+	memset(cached, 0, sizeof(*cached));
+	return (struct pool_block *)cached;
+}
+
+static bool slab_cache_add(struct pool_block *block, size_t full_size)
+{
+	unsigned int bits = slab_class_bits(full_size);
+	struct slab_cached_block *cached;
+
+	if (bits == 0 || slab_cache_counts[bits] >= POOL_SLAB_MAX_BLOCK_COUNT)
+		return FALSE;
+
+	memset(block, 0, full_size);
+	cached = (struct slab_cached_block *)block;
+	cached->next = slab_cache[bits];
+	slab_cache[bits] = cached;
+	slab_cache_counts[bits]++;
+	slab_stats.cached_count++;
+	slab_stats.cached_bytes += full_size;
+	return TRUE;
+}
+
+/* Live block bytes are accounted per pool name, so RSS growth can be
+   attributed to its pool without heap dumps. Pools are created rarely
+   compared to allocations made from them, so a linear scan of a small table
+   at pool creation time is cheap enough to keep always enabled. Pools with
+   generated names that no longer fit the table are merged into "(other)". */
+#define POOL_ACCT_MAX_ENTRIES 64
+
+struct pool_acct {
+	struct pool_acct *next;
+	struct mempool_acct_stats stats;
+};
+
+static struct pool_acct *pool_accts = NULL;
+static unsigned int pool_acct_count = 0;
+
+static struct pool_acct *pool_acct_get(const char *name)
+{
+	struct pool_acct *acct;
+
+	(void)str_begins(name, MEMPOOL_GROWING, &name);
+
+	for (acct = pool_accts; acct != NULL; acct = acct->next) {
+		if (strcmp(acct->stats.name, name) == 0)
+			return acct;
+	}
+	if (pool_acct_count == POOL_ACCT_MAX_ENTRIES) {
+		/* the table is full - merge the rest into a single entry */
+		return pool_acct_get("(other)");
+	}
+	/* use malloc() directly like block_alloc(), since this runs inside
+	   the pool implementation itself */
+	acct = calloc(1, sizeof(*acct));
+	if (unlikely(acct == NULL)) {
+		i_fatal_status(FATAL_OUTOFMEM,
+			       "pool_acct_get(): Out of memory");
+	}
+	acct->stats.name = strdup(name);
+	if (unlikely(acct->stats.name == NULL)) {
+		i_fatal_status(FATAL_OUTOFMEM,
+			       "pool_acct_get(): Out of memory");
+	}
+	acct->next = pool_accts;
+	pool_accts = acct;
+	pool_acct_count++;
+	return acct;
+}
+
+static void pool_acct_add_block(struct pool_acct *acct, size_t full_size)
+{
+	acct->stats.live_bytes += full_size;
+	if (acct->stats.live_bytes > acct->stats.peak_bytes)
+		acct->stats.peak_bytes = acct->stats.live_bytes;
+	acct->stats.block_allocs++;
+}
+
+void mempool_acct_foreach(void (*callback)(const struct mempool_acct_stats *stats,
+					   void *context), void *context)
+{
+	const struct pool_acct *acct;
+
+	for (acct = pool_accts; acct != NULL; acct = acct->next)
+		callback(&acct->stats, context);
+}
+
+void mempool_slab_stats_get(struct mempool_slab_stats *stats_r)
+{
+	*stats_r = slab_stats;
+}
+
+void mempool_slab_cache_free_unused(void)
+{
+	struct slab_cached_block *cached, *next;
+	unsigned int bits;
+
+	for (bits = POOL_SLAB_MIN_BITS; bits <= POOL_SLAB_MAX_BITS; bits++) {
+		for (cached = slab_cache[bits]; cached != NULL; cached = next) {
+			next = cached->next;
+			free(cached);
+		}
+		slab_cache[bits] = NULL;
+		slab_cache_counts[bits] = 0;
+	}
+	slab_stats.cached_count = 0;
+	slab_stats.cached_bytes = 0;
+}
+
 static const char *pool_alloconly_get_name(pool_t pool);
 static void pool_alloconly_ref(pool_t pool);
 static void pool_alloconly_unref(pool_t *pool);
@@ -225,7 +381,7 @@ static void check_sentries(struct pool_block *block)
 }
 #endif
 
-pool_t pool_alloconly_create(const char *name ATTR_UNUSED, size_t size)
+pool_t pool_alloconly_create(const char *name, size_t size)
 {
 	struct alloconly_pool apool, *new_apool;
 	size_t min_alloc = SIZEOF_POOLBLOCK +
@@ -251,6 +407,12 @@ pool_t pool_alloconly_create(const char *name ATTR_UNUSED, size_t size)
 	/* now allocate the actual alloconly_pool from the created block */
 	new_apool = p_new(&apool.pool, struct alloconly_pool, 1);
 	*new_apool = apool;
+	new_apool->acct = pool_acct_get(name);
+	new_apool->acct->stats.live_pools++;
+	/* the first block was allocated before the accounting entry was
+	   attached, so add it here */
+	pool_acct_add_block(new_apool->acct,
+			    SIZEOF_POOLBLOCK + new_apool->block->size);
 #ifdef DEBUG
 	if (str_begins(name, MEMPOOL_GROWING, &name) ||
 	    getenv("DEBUG_SILENT") != NULL)
@@ -278,17 +440,24 @@ pool_t pool_alloconly_create_clean(const char *name, size_t size)
 	return pool;
 }
 
-static void pool_alloconly_free_block(struct alloconly_pool *apool ATTR_UNUSED,
+static void pool_alloconly_free_block(struct alloconly_pool *apool,
 				      struct pool_block *block)
 {
+	size_t full_size = SIZEOF_POOLBLOCK + block->size;
+	/* the last freed block contains the alloconly_pool itself, so read
+	   the accounting pointer before the block's memory is cleared */
+	struct pool_acct *acct = apool->acct;
+
 #ifdef DEBUG
-	safe_memset(block, CLEAR_CHR, SIZEOF_POOLBLOCK + block->size);
+	safe_memset(block, CLEAR_CHR, full_size);
 #else
-	if (apool->clean_frees) {
-		safe_memset(block, CLEAR_CHR,
-			    SIZEOF_POOLBLOCK + block->size);
-	}
+	if (apool->clean_frees)
+		safe_memset(block, CLEAR_CHR, full_size);
 #endif
+	if (acct != NULL)
+		acct->stats.live_bytes -= full_size;
+	if (slab_cache_add(block, full_size))
+		return;
 	free(block);
 }
 
@@ -309,11 +478,16 @@ pool_alloconly_free_blocks_until_last(struct alloconly_pool *apool)
 
 static void pool_alloconly_destroy(struct alloconly_pool *apool)
 {
+	struct pool_acct *acct = apool->acct;
+
 	/* destroy all but the last block */
 	pool_alloconly_free_blocks_until_last(apool);
 
 	/* destroy the last block */
 	pool_alloconly_free_block(apool, apool->block);
+
+	if (acct != NULL)
+		acct->stats.live_pools--;
 }
 
 static const char *pool_alloconly_get_name(pool_t pool ATTR_UNUSED)
@@ -380,16 +554,27 @@ static void block_alloc(struct alloconly_pool *apool, size_t size)
 #endif
 	}
 
-	block = calloc(size, 1);
-	if (unlikely(block == NULL)) {
-		i_fatal_status(FATAL_OUTOFMEM, "block_alloc(%zu"
-			       "): Out of memory", size);
+	block = slab_cache_pop(size);
+	if (block == NULL) {
+		slab_stats.misses++;
+		block = calloc(size, 1);
+		if (unlikely(block == NULL)) {
+			i_fatal_status(FATAL_OUTOFMEM, "block_alloc(%zu"
+				       "): Out of memory", size);
+		}
+	} else {
+		slab_stats.hits++;
 	}
 	block->prev = apool->block;
 	apool->block = block;
 
 	block->size = size - SIZEOF_POOLBLOCK;
 	block->left = block->size;
+
+	/* NULL only while creating the pool, when the first block is
+	   accounted by pool_alloconly_create() afterwards */
+	if (apool->acct != NULL)
+		pool_acct_add_block(apool->acct, size);
 }
 
 static void *pool_alloconly_malloc(pool_t pool, size_t size)
@@ -161,6 +161,39 @@ static inline void pool_unref(pool_t *pool)
 		(*pool)->v->unref(pool);
 }
 
+/* Statistics for the global size-classed cache that recycles blocks of
+   destroyed alloconly pools. */
+struct mempool_slab_stats {
+	/* blocks and bytes currently sitting in the cache */
+	uint64_t cached_count;
+	uint64_t cached_bytes;
+	/* block allocations served from the cache / fallen back to malloc() */
+	uint64_t hits;
+	uint64_t misses;
+};
+void mempool_slab_stats_get(struct mempool_slab_stats *stats_r);
+/* Free all the blocks currently held by the recycling cache. */
+void mempool_slab_cache_free_unused(void);
+
+/* Per-pool-name accounting of the memory blocks backing alloconly pools.
+   Counters are updated at block granularity, so they track the memory
+   actually requested from the system, not individual p_malloc() calls. */
+struct mempool_acct_stats {
+	const char *name;
+	/* block bytes currently allocated for pools with this name */
+	uint64_t live_bytes;
+	/* highest live_bytes seen */
+	uint64_t peak_bytes;
+	/* pools with this name currently alive */
+	uint64_t live_pools;
+	/* cumulative number of block allocations */
+	uint64_t block_allocs;
+};
+/* Call callback once for each tracked pool name. Names seen after the
+   accounting table is full are merged into a single "(other)" entry. */
+void mempool_acct_foreach(void (*callback)(const struct mempool_acct_stats *stats,
+					   void *context), void *context);
+
 /* These functions are only for pools created with pool_alloconly_create(): */
 
 /* Returns how much memory has been allocated from this pool. */
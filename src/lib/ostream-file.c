@@ -379,9 +379,18 @@ static void o_stream_file_cork(struct ostream_private *stream, bool set)
 		if (set && fstream->io != NULL)
 			io_remove(&fstream->io);
 		else if (!set) {
-			/* buffer flushing might close the stream */
-			ret = buffer_flush(fstream);
-			stream->last_errors_not_checked = TRUE;
+			if (stream->batch_flush && fstream->fd != -1 &&
+			    file_buffer_get_used_size(fstream) > 0) {
+				/* delay the write until the fd polls
+				   writable, so output from further uncorks
+				   during this ioloop iteration gets sent
+				   with the same writev() */
+				ret = 0;
+			} else {
+				/* buffer flushing might close the stream */
+				ret = buffer_flush(fstream);
+				stream->last_errors_not_checked = TRUE;
+			}
 			if (fstream->io == NULL &&
 			    (ret == 0 || fstream->flush_pending) &&
 			    !stream->ostream.closed) {
@@ -1043,6 +1052,7 @@ o_stream_create_file_common(struct file_ostream *fstream,
 
 	fstream->ostream.max_buffer_size = max_buffer_size;
 	ostream = o_stream_create(&fstream->ostream, NULL, fd);
+	ostream->writable_fd = TRUE;
 
 	if (max_buffer_size == 0)
 		fstream->ostream.max_buffer_size = fstream->optimal_block_size;
@@ -42,6 +42,7 @@ struct ostream_private {
 	void *context;
 
 	bool corked:1;
+	bool batch_flush:1;
 	bool finished:1;
 	bool closing:1;
 	bool last_errors_not_checked:1;
@@ -185,6 +185,13 @@ bool o_stream_is_corked(struct ostream *stream)
 	return _stream->corked;
 }
 
+void o_stream_set_batch_flush(struct ostream *stream, bool set)
+{
+	struct ostream_private *_stream = stream->real_stream;
+
+	_stream->batch_flush = set;
+}
+
 int o_stream_flush(struct ostream *stream)
 {
 	struct ostream_private *_stream = stream->real_stream;
@@ -44,6 +44,8 @@ struct ostream {
 	/* o_stream_send() writes all the data or returns failure */
 	bool blocking:1;
 	bool closed:1;
+	/* fd can be written to directly if necessary (for splice()) */
+	bool writable_fd:1;
 
 	struct ostream_private *real_stream;
 };
@@ -156,6 +158,12 @@ void o_stream_cork(struct ostream *stream);
    ignores errors. */
 void o_stream_uncork(struct ostream *stream);
 bool o_stream_is_corked(struct ostream *stream);
+/* When set, o_stream_uncork() doesn't write out the buffered data
+   immediately. Instead the write is delayed until the fd polls writable, so
+   output produced by multiple uncorks during a single ioloop iteration (e.g.
+   pipelined commands) is sent with one writev() syscall. Only effective for
+   fd-based streams. */
+void o_stream_set_batch_flush(struct ostream *stream, bool set);
 /* Try to flush the output stream. If o_stream_nsend*() had been used and
    the stream had overflown, return error. Returns 1 if all data is sent,
    0 there's still buffered data, -1 if error. */
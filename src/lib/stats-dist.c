@@ -8,6 +8,17 @@
    more than 20 in your subsample. */
 #define TIMING_DEFAULT_SUBSAMPLING_BUFFER (20*24) /* 20*24 fits in a page */
 
+/* Every value is also counted into a power-of-two bucket that is split
+   into STATS_DIST_BUCKET_SUB_COUNT linear sub-buckets, HDR-histogram
+   style. Once more values have been added than fit into the subsampling
+   buffer, percentiles are read from these buckets instead of the random
+   subsample, so tail percentiles have a bounded relative error (one
+   sub-bucket width, 12.5%) instead of a sampling error. */
+#define STATS_DIST_BUCKET_SUB_BITS 2
+#define STATS_DIST_BUCKET_SUB_COUNT (1U << STATS_DIST_BUCKET_SUB_BITS)
+#define STATS_DIST_BUCKET_COUNT \
+	((64 - STATS_DIST_BUCKET_SUB_BITS + 1) * STATS_DIST_BUCKET_SUB_COUNT)
+
 struct stats_dist {
 	unsigned int sample_count;
 	unsigned int count;
@@ -15,9 +26,36 @@ struct stats_dist {
 	uint64_t min;
 	uint64_t max;
 	uint64_t sum;
+	uint32_t buckets[STATS_DIST_BUCKET_COUNT];
 	uint64_t samples[];
 };
 
+static unsigned int stats_dist_bucket_index(uint64_t value)
+{
+	if (value < 2 * STATS_DIST_BUCKET_SUB_COUNT)
+		return value;
+
+	unsigned int shift = bits_required64(value) -
+		STATS_DIST_BUCKET_SUB_BITS - 1;
+	unsigned int sub = (value >> shift) & (STATS_DIST_BUCKET_SUB_COUNT - 1);
+	return (shift + 1) * STATS_DIST_BUCKET_SUB_COUNT + sub;
+}
+
+static void
+stats_dist_bucket_range(unsigned int idx, uint64_t *start_r, uint64_t *width_r)
+{
+	if (idx < 2 * STATS_DIST_BUCKET_SUB_COUNT) {
+		*start_r = idx;
+		*width_r = 1;
+		return;
+	}
+
+	unsigned int shift = idx / STATS_DIST_BUCKET_SUB_COUNT - 1;
+	uint64_t sub = idx % STATS_DIST_BUCKET_SUB_COUNT;
+	*start_r = (STATS_DIST_BUCKET_SUB_COUNT + sub) << shift;
+	*width_r = (uint64_t)1 << shift;
+}
+
 struct stats_dist *stats_dist_init(void)
 {
 	return stats_dist_init_with_size(TIMING_DEFAULT_SUBSAMPLING_BUFFER);
@@ -58,6 +96,8 @@ void stats_dist_add(struct stats_dist *stats, uint64_t value)
 			stats->samples[idx] = value;
 	}
 
+	stats->buckets[stats_dist_bucket_index(value)]++;
+
 	stats->count++;
 	stats->sum += value;
 	if (stats->max < value)
@@ -161,15 +201,47 @@ static unsigned int stats_dist_get_index(unsigned int range, double fraction)
 	return idx;
 }
 
+static uint64_t
+stats_dist_get_bucket_percentile(const struct stats_dist *stats,
+				 double fraction)
+{
+	uint64_t cum = 0, start, width, value;
+	unsigned int i, idx;
+
+	idx = stats_dist_get_index(stats->count, fraction);
+	for (i = 0; i < STATS_DIST_BUCKET_COUNT; i++) {
+		cum += stats->buckets[i];
+		if (cum > idx)
+			break;
+	}
+	i_assert(i < STATS_DIST_BUCKET_COUNT);
+
+	/* interpolate linearly inside the bucket */
+	stats_dist_bucket_range(i, &start, &width);
+	uint64_t pos = idx - (cum - stats->buckets[i]);
+	value = start + (uint64_t)((double)width * pos / stats->buckets[i]);
+
+	/* min/max are tracked exactly - don't return values outside them */
+	if (value < stats->min)
+		value = stats->min;
+	if (value > stats->max)
+		value = stats->max;
+	return value;
+}
+
 uint64_t stats_dist_get_percentile(struct stats_dist *stats, double fraction)
 {
 	if (stats->count == 0)
 		return 0;
+	if (stats->count > stats->sample_count) {
+		/* The sample buffer holds only a random subsample by now.
+		   The bucket counters have seen every value, so percentiles
+		   from them have a bounded error instead of a sampling
+		   error. */
+		return stats_dist_get_bucket_percentile(stats, fraction);
+	}
 	stats_dist_ensure_sorted(stats);
-	unsigned int count = (stats->count < stats->sample_count)
-		? stats->count
-		: stats->sample_count;
-	unsigned int idx = stats_dist_get_index(count, fraction);
+	unsigned int idx = stats_dist_get_index(stats->count, fraction);
 	return stats->samples[idx];
 }
 
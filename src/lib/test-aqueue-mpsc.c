@@ -0,0 +1,48 @@
+/* Copyright (c) 2002-2018 Dovecot authors, see the included COPYING file */
+
+#include "test-lib.h"
+#include "aqueue-mpsc.h"
+
+void test_aqueue_mpsc(void)
+{
+	struct aqueue_mpsc *queue;
+	void *item;
+	unsigned int i, round;
+
+	test_begin("aqueue_mpsc");
+	queue = aqueue_mpsc_init(4);
+	test_assert(aqueue_mpsc_get_wait_fd(queue) >= 0);
+	test_assert(!aqueue_mpsc_pop(queue, &item));
+
+	/* fill up (capacity is rounded to 4) */
+	for (i = 1; i <= 4; i++)
+		test_assert_idx(aqueue_mpsc_append(queue, POINTER_CAST(i)), i);
+	test_assert(!aqueue_mpsc_append(queue, POINTER_CAST(5)));
+
+	/* FIFO order */
+	for (i = 1; i <= 4; i++) {
+		test_assert_idx(aqueue_mpsc_pop(queue, &item) &&
+				item == POINTER_CAST(i), i);
+	}
+	test_assert(!aqueue_mpsc_pop(queue, &item));
+
+	/* wraparound over several rounds */
+	for (round = 0; round < 100; round++) {
+		for (i = 1; i <= 3; i++) {
+			test_assert_idx(aqueue_mpsc_append(queue,
+				POINTER_CAST(round * 10 + i)), round);
+		}
+		test_assert_idx(aqueue_mpsc_pop_wait(queue) ==
+				POINTER_CAST(round * 10 + 1), round);
+		for (i = 2; i <= 3; i++) {
+			test_assert_idx(aqueue_mpsc_pop(queue, &item) &&
+					item == POINTER_CAST(round * 10 + i),
+					round);
+		}
+		test_assert_idx(!aqueue_mpsc_pop(queue, &item), round);
+	}
+
+	aqueue_mpsc_deinit(&queue);
+	test_assert(queue == NULL);
+	test_end();
+}
@@ -1302,11 +1302,38 @@ static void test_base64_encode_lines(void)
 	test_end();
 }
 
+static void test_base64_bulk_random(void)
+{
+	string_t *str, *dest;
+	unsigned char buf[4096];
+	unsigned int i, j, max;
+
+	str = t_str_new(MAX_BASE64_ENCODED_SIZE(sizeof(buf)));
+	dest = t_str_new(sizeof(buf));
+
+	test_begin("base64 encode/decode bulk path with random input");
+	for (i = 0; i < 10; i++) {
+		max = i_rand_limit(sizeof(buf));
+		for (j = 0; j < max; j++)
+			buf[j] = i_rand_uchar();
+
+		str_truncate(str, 0);
+		str_truncate(dest, 0);
+		base64_encode(buf, max, str);
+		test_assert_idx(base64_decode(str_data(str), str_len(str),
+					      dest) >= 0, i);
+		test_assert_idx(str_len(dest) == max &&
+				memcmp(buf, str_data(dest), max) == 0, i);
+	}
+	test_end();
+}
+
 void test_base64(void)
 {
 	test_base64_encode();
 	test_base64_decode();
 	test_base64_random();
+	test_base64_bulk_random();
 	test_base64url_encode();
 	test_base64url_decode();
 	test_base64url_random();
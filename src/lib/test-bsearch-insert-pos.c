@@ -43,4 +43,27 @@ void test_bsearch_insert_pos(void)
 		test_out(t_strdup_printf("bsearch_insert_pos(%d,%d)", i, key),
 			 success);
 	}
+
+	/* the branch-free uint32 variant must agree with the generic one
+	   for every key and array length */
+	test_begin("bsearch_insert_pos_uint32");
+	for (len = 0; len <= 32; len++) {
+		uint32_t arr[32];
+		unsigned int gen_key, idx2;
+		bool found, found2;
+
+		for (i = 0; i < len; i++)
+			arr[i] = i * 2 + 1;
+		for (gen_key = 0; gen_key <= len * 2 + 2; gen_key++) {
+			uint32_t key32 = gen_key;
+
+			found = bsearch_insert_pos(&gen_key, (const unsigned int *)arr,
+						   len, sizeof(arr[0]),
+						   cmp_uint, &idx);
+			found2 = bsearch_insert_pos_uint32(key32, arr, len, &idx2);
+			test_assert_idx(found == found2 && idx == idx2,
+					len * 1000 + gen_key);
+		}
+	}
+	test_end();
 }
@@ -0,0 +1,69 @@
+/* Copyright (c) 2002-2018 Dovecot authors, see the included COPYING file */
+
+#include "test-lib.h"
+#include "buffer.h"
+#include "buffer-seg.h"
+
+static void test_buffer_seg_flatten(struct seg_buffer *buf, buffer_t *dest)
+{
+	const struct const_iovec *iov;
+	unsigned int i, count;
+
+	buffer_set_used_size(dest, 0);
+	count = seg_buffer_get_iovecs(buf, &iov);
+	for (i = 0; i < count; i++)
+		buffer_append(dest, iov[i].iov_base, iov[i].iov_len);
+}
+
+void test_buffer_seg(void)
+{
+	struct seg_buffer *buf;
+	buffer_t *ref, *flat;
+	unsigned char data[777];
+	unsigned int i;
+	size_t skip;
+
+	test_begin("seg-buffer");
+	buf = seg_buffer_create(default_pool, 512);
+	ref = t_buffer_create(64 * 1024);
+	flat = t_buffer_create(64 * 1024);
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i_rand_uchar();
+
+	/* appends crossing chunk boundaries */
+	for (i = 0; i < 50; i++) {
+		seg_buffer_append(buf, data, sizeof(data));
+		buffer_append(ref, data, sizeof(data));
+	}
+	test_assert(seg_buffer_get_used_size(buf) == ref->used);
+
+	test_buffer_seg_flatten(buf, flat);
+	test_assert(flat->used == ref->used &&
+		    memcmp(flat->data, ref->data, ref->used) == 0);
+
+	/* consume from the front in odd sized steps, appending more in
+	   between so chunks get recycled */
+	while (seg_buffer_get_used_size(buf) > 0) {
+		skip = I_MIN(seg_buffer_get_used_size(buf), 1000);
+		seg_buffer_skip(buf, skip);
+		buffer_delete(ref, 0, skip);
+
+		if (ref->used < 4096) {
+			seg_buffer_append(buf, data, 100);
+			buffer_append(ref, data, 100);
+			skip = I_MIN(seg_buffer_get_used_size(buf), 5000);
+			seg_buffer_skip(buf, skip);
+			buffer_delete(ref, 0, skip);
+		}
+
+		test_buffer_seg_flatten(buf, flat);
+		test_assert(flat->used == ref->used &&
+			    memcmp(flat->data, ref->data, ref->used) == 0);
+	}
+	test_assert(seg_buffer_get_used_size(buf) == 0);
+
+	seg_buffer_destroy(&buf);
+	test_assert(buf == NULL);
+	test_end();
+}
@@ -327,6 +327,23 @@ static void test_buffer_replace(void)
 	test_end();
 }
 
+static void test_buffer_append_bench(void)
+{
+	buffer_t *buf = buffer_create_dynamic(default_pool, 1024);
+
+	test_begin_bench("buffer_append bench");
+	while (test_bench_loop()) {
+		if (buf->used >= 1024*1024)
+			buffer_set_used_size(buf, 0);
+		buffer_append(buf, "0123456789abcdef", 16);
+	}
+	/* a small append is just a bounds check and a memcpy - getting
+	   anywhere near this limit means something went badly wrong */
+	test_assert_faster_than(100);
+	buffer_free(&buf);
+	test_end();
+}
+
 void test_buffer(void)
 {
 	test_buffer_random();
@@ -334,6 +351,7 @@ void test_buffer(void)
 	test_buffer_set_used_size();
 	test_buffer_truncate_bits();
 	test_buffer_replace();
+	test_buffer_append_bench();
 }
 
 static void fatal_buffer_free(buffer_t *buf)
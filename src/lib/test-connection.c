@@ -444,6 +444,66 @@ static void test_connection_resume_pipelined(void)
 	test_end();
 }
 
+/* BEGIN LINES BATCH TEST */
+
+static unsigned int lines_batch_largest = 0;
+
+static void
+test_connection_lines_batch_client_connected(struct connection *conn,
+					     bool success)
+{
+	test_assert(success);
+	if (conn->list->set.client)
+		o_stream_nsend_str(conn->output, "PING\nPING\nPING\nQUIT\n");
+}
+
+static int
+test_connection_lines_batch_input(struct connection *conn,
+				  const char *const *lines, unsigned int count)
+{
+	lines_batch_largest = I_MAX(lines_batch_largest, count);
+	for (unsigned int i = 0; i < count; i++) {
+		if (strcmp(lines[i], "PING") == 0)
+			received_count++;
+		else if (strcmp(lines[i], "QUIT") == 0) {
+			received_quit = TRUE;
+			connection_disconnect(conn);
+			return 0;
+		} else {
+			i_error("invalid input");
+			return -1;
+		}
+	}
+	return 1;
+}
+
+static const struct connection_vfuncs lines_batch_v =
+{
+	.client_connected = test_connection_lines_batch_client_connected,
+	.input_lines_batch = test_connection_lines_batch_input,
+	.destroy = test_connection_simple_destroy,
+};
+
+static void test_connection_lines_batch(void)
+{
+	test_begin("connection input lines batch");
+
+	received_count = 0;
+	received_quit = FALSE;
+	lines_batch_largest = 0;
+	test_connection_run(&server_set, &client_set,
+			    &lines_batch_v, &lines_batch_v, 1);
+
+	test_assert(received_count == 3);
+	test_assert(received_quit);
+	/* the pipelined lines are delivered with a single call */
+	test_assert(lines_batch_largest > 1);
+	received_count = 0;
+	received_quit = FALSE;
+
+	test_end();
+}
+
 /* BEGIN IDLE KILL TEST */
 
 static void
@@ -734,6 +794,7 @@ void test_connection(void)
 	test_connection_input_full();
 	test_connection_resume();
 	test_connection_resume_pipelined();
+	test_connection_lines_batch();
 	test_connection_idle_kill();
 	test_connection_handshake_failed_version();
 	test_connection_handshake_failed_args();
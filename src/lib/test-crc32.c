@@ -6,9 +6,28 @@
 void test_crc32(void)
 {
 	const char str[] = "foo\0bar";
+	const char *long_str = "The quick brown fox jumps over the lazy dog";
+	size_t long_len = strlen(long_str);
+	struct const_iovec iov[2];
+	size_t i;
 
 	test_begin("crc32");
 	test_assert(crc32_str(str) == 0x8c736521);
 	test_assert(crc32_data(str, sizeof(str)) == 0x32c9723d);
+
+	/* long enough to use the slicing-by-8 bulk path */
+	test_assert(crc32_data(long_str, long_len) == 0x414fa339);
+	/* all split points must give the same result as one call */
+	for (i = 0; i <= long_len; i++) {
+		test_assert_idx(crc32_data_more(
+			crc32_data_more(0, long_str, i),
+			long_str + i, long_len - i) == 0x414fa339, i);
+	}
+
+	iov[0].iov_base = long_str;
+	iov[0].iov_len = 20;
+	iov[1].iov_base = long_str + 20;
+	iov[1].iov_len = long_len - 20;
+	test_assert(crc32_data_multi(iov, 2) == 0x414fa339);
 	test_end();
 }
@@ -332,6 +332,50 @@ static void test_event_filter_parent_category_match(void)
 	test_end();
 }
 
+static void test_event_filter_category_bloom(void)
+{
+	static struct event_category parent_category = {
+		.name = "bloom_parent",
+	};
+	static struct event_category child_category = {
+		.parent = &parent_category,
+		.name = "bloom_child",
+	};
+	struct event_filter *filter;
+	struct event_filter_stats stats;
+	const char *error;
+	const struct failure_context failure_ctx = {
+		.type = LOG_TYPE_DEBUG
+	};
+
+	test_begin("event filter: category bloom fast rejection");
+
+	struct event *e_match = event_create(NULL);
+	event_add_category(e_match, &child_category);
+	struct event *e_nomatch = event_create(NULL);
+
+	filter = event_filter_create();
+	test_assert(event_filter_parse("category=bloom_parent", filter, &error) == 0);
+
+	/* an event without any categories is rejected without evaluating
+	   the query */
+	test_assert(!event_filter_match(filter, e_nomatch, &failure_ctx));
+	event_filter_get_stats(filter, &stats);
+	test_assert(stats.match_count == 1);
+	test_assert(stats.fast_reject_count == 1);
+
+	/* the child category's bloom bits include the parent's bits */
+	test_assert(event_filter_match(filter, e_match, &failure_ctx));
+	event_filter_get_stats(filter, &stats);
+	test_assert(stats.match_count == 2);
+	test_assert(stats.fast_reject_count == 1);
+
+	event_filter_unref(&filter);
+	event_unref(&e_match);
+	event_unref(&e_nomatch);
+	test_end();
+}
+
 static void test_event_filter_strlist(void)
 {
 	struct event_filter *filter;
@@ -1123,6 +1167,7 @@ void test_event_filter(void)
 	test_event_filter_clear_global_fields();
 	test_event_filter_inc_int();
 	test_event_filter_parent_category_match();
+	test_event_filter_category_bloom();
 	test_event_filter_strlist();
 	test_event_filter_strlist_recursive();
 	test_event_filter_strlist_global_events();
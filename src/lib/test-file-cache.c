@@ -14,6 +14,7 @@
 #include <sys/mman.h>
 
 #define TEST_FILENAME ".test_file_cache"
+#define TEST_FILENAME2 ".test_file_cache2"
 
 static void test_file_cache_read(void)
 {
@@ -233,6 +234,80 @@ static void test_file_cache_switch_fd(void)
 	test_end();
 }
 
+static void test_file_cache_total_size_limit(void)
+{
+	test_begin("file_cache_total_size_limit");
+
+	/* create two files */
+	struct ostream *os = o_stream_create_file(TEST_FILENAME, 0, 0600, 0);
+	o_stream_nsend_str(os, "initial data\n");
+	test_assert(o_stream_finish(os) == 1);
+	o_stream_destroy(&os);
+	os = o_stream_create_file(TEST_FILENAME2, 0, 0600, 0);
+	o_stream_nsend_str(os, "second data!\n");
+	test_assert(o_stream_finish(os) == 1);
+	o_stream_destroy(&os);
+
+	int fd = open(TEST_FILENAME, O_RDONLY);
+	i_assert(fd > -1);
+	int fd2 = open(TEST_FILENAME2, O_RDONLY);
+	i_assert(fd2 > -1);
+	struct file_cache *cache = file_cache_new_path(fd, TEST_FILENAME);
+	struct file_cache *cache2 = file_cache_new_path(fd2, TEST_FILENAME2);
+
+	test_assert(file_cache_get_total_cached_size() == 0);
+	file_cache_set_total_size_limit(16);
+
+	test_assert(file_cache_read(cache, 0, 13) == 13);
+	test_assert(file_cache_get_total_cached_size() == 13);
+
+	/* crossing the limit doesn't evict anything by itself - neither
+	   cache has been marked unused */
+	test_assert(file_cache_read(cache2, 0, 13) == 13);
+	test_assert(file_cache_get_total_cached_size() == 26);
+
+	/* marking the first cache unused allows evicting it */
+	file_cache_mark_unused(cache);
+	test_assert(file_cache_get_total_cached_size() == 13);
+
+	size_t size;
+	const unsigned char *map = file_cache_get_map(cache, &size);
+	test_assert(size == 0);
+	map = file_cache_get_map(cache2, &size);
+	test_assert(map != NULL && size == 13 &&
+		    memcmp(map, "second data!\n", 13) == 0);
+
+	/* the evicted cache is still usable. reading it back crosses the
+	   limit again, but the second cache is in use and stays cached. */
+	test_assert(file_cache_read(cache, 0, 13) == 13);
+	test_assert(file_cache_get_total_cached_size() == 26);
+	map = file_cache_get_map(cache, &size);
+	test_assert(map != NULL && size == 13 &&
+		    memcmp(map, "initial data\n", 13) == 0);
+
+	file_cache_mark_unused(cache2);
+	test_assert(file_cache_get_total_cached_size() == 13);
+	map = file_cache_get_map(cache2, &size);
+	test_assert(size == 0);
+
+	/* with the limit disabled both fit even when unused */
+	file_cache_set_total_size_limit(0);
+	test_assert(file_cache_read(cache2, 0, 13) == 13);
+	file_cache_mark_unused(cache);
+	file_cache_mark_unused(cache2);
+	test_assert(file_cache_get_total_cached_size() == 26);
+	file_cache_set_total_size_limit(FILE_CACHE_DEFAULT_TOTAL_SIZE_LIMIT);
+
+	file_cache_free(&cache);
+	file_cache_free(&cache2);
+	test_assert(file_cache_get_total_cached_size() == 0);
+	i_close_fd(&fd);
+	i_close_fd(&fd2);
+	i_unlink(TEST_FILENAME);
+	i_unlink(TEST_FILENAME2);
+	test_end();
+}
+
 static void test_file_cache_errors(void)
 {
 	test_begin("file_cache_errors");
@@ -291,5 +366,6 @@ void test_file_cache(void)
 	test_file_cache_multipage();
 	test_file_cache_anon();
 	test_file_cache_switch_fd();
+	test_file_cache_total_size_limit();
 	test_file_cache_errors();
 }
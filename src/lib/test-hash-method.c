@@ -453,8 +453,45 @@ static void test_hash_methods_fips() {
 	test_end();
 }
 
+static void test_hash_method_get_digests(void)
+{
+	static const char *inputs[] = {
+		"", "a", "hello world",
+		"a somewhat longer input that spans more than one block when "
+		"hashed with the smaller block size hash methods, to make "
+		"sure multi-block inputs work through the batch API too"
+	};
+	struct const_iovec iov[N_ELEMENTS(inputs)];
+	unsigned int i, j;
+
+	test_begin("hash method get_digests");
+	for (i = 0; i < N_ELEMENTS(inputs); i++) {
+		iov[i].iov_base = inputs[i];
+		iov[i].iov_len = strlen(inputs[i]);
+	}
+	for (i = 0; hash_methods[i] != NULL; i++) {
+		const struct hash_method *method = hash_methods[i];
+		unsigned char digests[N_ELEMENTS(inputs)][method->digest_size];
+		unsigned char *results[N_ELEMENTS(inputs)];
+		unsigned char expected[method->digest_size];
+
+		for (j = 0; j < N_ELEMENTS(inputs); j++)
+			results[j] = digests[j];
+		hash_method_get_digests(method, iov, N_ELEMENTS(inputs),
+					results);
+		for (j = 0; j < N_ELEMENTS(inputs); j++) {
+			hash_method_get_digest(method, iov[j].iov_base,
+					       iov[j].iov_len, expected);
+			test_assert_idx(memcmp(digests[j], expected,
+					       method->digest_size) == 0, j);
+		}
+	}
+	test_end();
+}
+
 void test_hash_method(void)
 {
 	test_hash_method_boundary();
 	test_hash_methods_fips();
+	test_hash_method_get_digests();
 }
@@ -35,6 +35,65 @@ static void test_hash_random_pool(pool_t pool)
 	i_free(keys);
 }
 
+static unsigned int test_open_hash(const void *p)
+{
+	return POINTER_CAST_TO(p, unsigned int);
+}
+
+static int test_open_cmp(const void *p1, const void *p2)
+{
+	return p1 == p2 ? 0 : 1;
+}
+
+static void test_hash_open_random(void)
+{
+	HASH_TABLE(void *, void *) hash;
+	struct hash_iterate_context *iter;
+	unsigned int *keys;
+	unsigned int i, key, keyidx, delidx, count;
+	void *iter_key, *iter_value;
+
+	keys = i_new(unsigned int, KEYMAX); keyidx = 0;
+	hash_table_create_open(&hash, default_pool, 0,
+			       test_open_hash, test_open_cmp);
+	for (i = 0; i < KEYMAX; i++) {
+		key = (i_rand_limit(KEYMAX)) + 1;
+		if (i_rand_limit(5) > 0) {
+			if (hash_table_lookup(hash, POINTER_CAST(key)) == NULL) {
+				hash_table_insert(hash, POINTER_CAST(key),
+						  POINTER_CAST(key));
+				keys[keyidx++] = key;
+			}
+		} else if (keyidx > 0) {
+			delidx = i_rand_limit(keyidx);
+			hash_table_remove(hash, POINTER_CAST(keys[delidx]));
+			memmove(&keys[delidx], &keys[delidx+1],
+				(keyidx-delidx-1) * sizeof(*keys));
+			keyidx--;
+		}
+	}
+	test_assert(hash_table_count(hash) == keyidx);
+	for (i = 0; i < keyidx; i++) {
+		test_assert(hash_table_lookup(hash, POINTER_CAST(keys[i])) ==
+			    POINTER_CAST(keys[i]));
+	}
+
+	count = 0;
+	iter = hash_table_iterate_init(hash);
+	while (hash_table_iterate(iter, hash, &iter_key, &iter_value)) {
+		test_assert(iter_key == iter_value);
+		count++;
+	}
+	hash_table_iterate_deinit(&iter);
+	test_assert(count == keyidx);
+
+	for (i = 0; i < keyidx; i++)
+		hash_table_remove(hash, POINTER_CAST(keys[i]));
+	test_assert(hash_table_count(hash) == 0);
+	hash_table_destroy(&hash);
+	i_free(keys);
+}
+
 void test_hash(void)
 {
 	pool_t pool;
@@ -44,4 +103,6 @@ void test_hash(void)
 	pool = pool_alloconly_create("test hash", 1024);
 	test_hash_random_pool(pool);
 	pool_unref(&pool);
+
+	test_hash_open_random();
 }
@@ -132,6 +132,51 @@ static void test_ioloop_timeout(void)
 	test_end();
 }
 
+struct wheel_test_ctx {
+	struct timeout *to_wheel, *to_short;
+	struct timeval tv_reset, tv_fired;
+};
+
+static void wheel_fired_callback(struct wheel_test_ctx *ctx)
+{
+	i_gettimeofday(&ctx->tv_fired);
+	io_loop_stop(current_ioloop);
+}
+
+static void wheel_reset_callback(struct wheel_test_ctx *ctx)
+{
+	/* to_wheel has been started by now, so it's in the timer wheel -
+	   resetting it must relink it there with a new run time */
+	i_gettimeofday(&ctx->tv_reset);
+	timeout_reset(ctx->to_wheel);
+	timeout_remove(&ctx->to_short);
+}
+
+static void test_ioloop_timeout_wheel(void)
+{
+	struct ioloop *ioloop;
+	struct wheel_test_ctx ctx;
+
+	test_begin("ioloop timeout wheel");
+
+	i_zero(&ctx);
+	ioloop = io_loop_create();
+
+	/* multi-second periodic timeouts are kept in the timer wheel
+	   instead of the priorityq */
+	ctx.to_wheel = timeout_add(2000, wheel_fired_callback, &ctx);
+	ctx.to_short = timeout_add_short(100, wheel_reset_callback, &ctx);
+	io_loop_run(ioloop);
+
+	test_assert(ctx.to_short == NULL);
+	test_assert(timeval_diff_msecs(&ctx.tv_fired, &ctx.tv_reset) >= 1500);
+	timeout_remove(&ctx.to_wheel);
+	test_assert(io_loop_is_empty(ioloop));
+	io_loop_destroy(&ioloop);
+
+	test_end();
+}
+
 static void zero_timeout_callback(unsigned int *counter)
 {
 	*counter += 1;
@@ -394,6 +439,7 @@ static void test_ioloop_context_events(void)
 void test_ioloop(void)
 {
 	test_ioloop_timeout();
+	test_ioloop_timeout_wheel();
 	test_ioloop_zero_timeout();
 	test_ioloop_zero_timeout_recreate();
 	test_ioloop_find_fd_conditions();
@@ -5,6 +5,7 @@
 #include "ostream.h"
 #include "buffer.h"
 #include "str.h"
+#include "fd-util.h"
 #include "ioloop.h"
 #include "iostream-pump.h"
 #include "istream-failure-at.h"
@@ -300,6 +301,56 @@ test_iostream_pump_failure_end_write(bool in_block, bool out_block)
 	test_end();
 }
 
+#ifdef HAVE_SPLICE
+static void test_iostream_pump_splice(void)
+{
+	struct iostream_pump *pump;
+	struct ioloop *ioloop;
+	struct istream *in;
+	struct ostream *out;
+	unsigned char wbuf[1024], rbuf[sizeof(wbuf)];
+	int input_fds[2], output_fds[2], counter;
+	unsigned int i;
+
+	test_begin("iostream_pump splice");
+
+	if (pipe(input_fds) < 0 || pipe(output_fds) < 0)
+		i_fatal("pipe() failed: %m");
+	for (i = 0; i < sizeof(wbuf); i++)
+		wbuf[i] = i & 0xff;
+	test_assert(write(input_fds[1], wbuf, sizeof(wbuf)) ==
+		    (ssize_t)sizeof(wbuf));
+	/* closing the write side makes the input see EOF after the data */
+	i_close_fd(&input_fds[1]);
+	fd_set_nonblock(input_fds[0], TRUE);
+	fd_set_nonblock(output_fds[1], TRUE);
+
+	ioloop = io_loop_create();
+	in = i_stream_create_fd(input_fds[0], 1024);
+	out = o_stream_create_fd(output_fds[1], 0);
+	pump = iostream_pump_create(in, out);
+	iostream_pump_set_try_splice(pump, TRUE);
+	counter = 1;
+	iostream_pump_set_completion_callback(pump, completed, &counter);
+	iostream_pump_start(pump);
+	io_loop_run(ioloop);
+	test_assert(counter == 0);
+	test_assert(iostream_pump_get_spliced_bytes(pump) == sizeof(wbuf));
+	iostream_pump_destroy(&pump);
+	o_stream_unref(&out);
+	i_stream_unref(&in);
+	io_loop_destroy(&ioloop);
+
+	test_assert(read(output_fds[0], rbuf, sizeof(rbuf)) ==
+		    (ssize_t)sizeof(rbuf));
+	test_assert(memcmp(rbuf, wbuf, sizeof(wbuf)) == 0);
+	i_close_fd(&input_fds[0]);
+	i_close_fd(&output_fds[0]);
+	i_close_fd(&output_fds[1]);
+	test_end();
+}
+#endif
+
 static void
 test_iostream_pump_real(void)
 {
@@ -315,6 +366,9 @@ test_iostream_pump_real(void)
 		test_iostream_pump_failure_mid_write(in_block, out_block);
 		test_iostream_pump_failure_end_write(in_block, out_block);
 	}
+#ifdef HAVE_SPLICE
+	test_iostream_pump_splice();
+#endif
 }
 
 void test_iostream_pump(void)
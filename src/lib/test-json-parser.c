@@ -32,7 +32,9 @@ static const char json_input[] =
 	"\"key12\": [ \"foo\" , 5.24,[true],{\"aobj\":[]}],"
 	"\"key13\": \"\\ud801\\udc37\","
 	"\"key14\": \"\xd8\xb3\xd9\x84\xd8\xa7\xd9\x85\","
-	"\"key15\": \"\\u10000\""
+	"\"key15\": \"\\u10000\","
+	"\"key16\": \"this is a long string without any escaped characters\","
+	"\"key17\": \"long prefix before the first escape \\t and a long tail after it\""
 	"}\n";
 
 static const struct {
@@ -96,6 +98,10 @@ static const struct {
 	{ JSON_TYPE_STRING, "\xd8\xb3\xd9\x84\xd8\xa7\xd9\x85" },
 	{ JSON_TYPE_OBJECT_KEY, "key15" },
 	{ JSON_TYPE_STRING, "\xe1\x80\x80""0" },
+	{ JSON_TYPE_OBJECT_KEY, "key16" },
+	{ JSON_TYPE_STRING, "this is a long string without any escaped characters" },
+	{ JSON_TYPE_OBJECT_KEY, "key17" },
+	{ JSON_TYPE_STRING, "long prefix before the first escape \t and a long tail after it" },
 };
 
 static int
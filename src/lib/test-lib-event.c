@@ -50,6 +50,16 @@ static void test_event_fields(void)
 	test_assert(field != NULL && field->value_type == EVENT_FIELD_VALUE_TYPE_STR &&
 		    field->value.str[0] == '\0');
 
+	/* adding an identical value again is a no-op that keeps the
+	   previously allocated string */
+	event_add_str(event, "samekey", "samevalue");
+	field = event_find_field_nonrecursive(event, "samekey");
+	test_assert(field != NULL);
+	const char *orig_str = field->value.str;
+	event_add_str(event, "samekey", "samevalue");
+	field = event_find_field_nonrecursive(event, "samekey");
+	test_assert(field != NULL && field->value.str == orig_str);
+
 	event_strlist_append(event, "key", "strlist1");
 	field = event_find_field_nonrecursive(event, "key");
 	test_assert(field != NULL && field->value_type == EVENT_FIELD_VALUE_TYPE_STRLIST &&
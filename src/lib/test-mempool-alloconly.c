@@ -53,6 +53,34 @@ void test_mempool_alloconly(void)
 	test_end();
 }
 
+void test_mempool_alloconly_slab_reuse(void)
+{
+	struct mempool_slab_stats stats_before, stats;
+	pool_t pool;
+
+	test_begin("mempool_alloconly slab reuse");
+	/* 1024 bytes is an exact power-of-two block, so it's cacheable */
+	pool = pool_alloconly_create("slab test", 1024);
+	mempool_slab_stats_get(&stats_before);
+	pool_unref(&pool);
+
+	mempool_slab_stats_get(&stats);
+	test_assert(stats.cached_count == stats_before.cached_count + 1);
+	test_assert(stats.cached_bytes == stats_before.cached_bytes + 1024);
+
+	/* the new pool's block must come from the cache, zeroed */
+	pool = pool_alloconly_create("slab test2", 1024);
+	mempool_slab_stats_get(&stats);
+	test_assert(stats.cached_count == stats_before.cached_count);
+	test_assert(mem_has_bytes(p_malloc(pool, 64), 64, 0));
+	pool_unref(&pool);
+
+	mempool_slab_cache_free_unused();
+	mempool_slab_stats_get(&stats);
+	test_assert(stats.cached_count == 0 && stats.cached_bytes == 0);
+	test_end();
+}
+
 enum fatal_test_state fatal_mempool_alloconly(unsigned int stage)
 {
 	static pool_t pool;
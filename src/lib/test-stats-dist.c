@@ -128,5 +128,21 @@ void test_stats_dist(void)
 	stats_dist_deinit(&t);
 	test_end();
 
+	test_begin("stats_dists bucketed percentiles");
+	t = stats_dist_init_with_size(100);
+	for (i = 1; i <= 100000; i++)
+		stats_dist_add(t, i);
+	/* The subsampling buffer overflowed long ago, so the percentiles
+	   come from the log-bucketed counters. Their relative error is
+	   bounded by one sub-bucket width (1/8). */
+	uint64_t p95 = stats_dist_get_95th(t);
+	test_assert(p95 >= 95000 - 95000/8 && p95 <= 95000 + 95000/8);
+	uint64_t p999 = stats_dist_get_percentile(t, 0.999);
+	test_assert(p999 >= 99900 - 99900/8 && p999 <= 99900 + 99900/8);
+	test_assert(stats_dist_get_percentile(t, 1) == 100000);
+	test_assert(stats_dist_get_percentile(t, 0) == 1);
+	stats_dist_deinit(&t);
+	test_end();
+
 	test_stats_dist_get_variance();
 }
@@ -6,6 +6,7 @@
 #include "hostpid.h"
 #include "var-expand.h"
 #include "var-expand-private.h"
+#include "var-expand-program.h"
 
 struct var_expand_test {
 	const char *in;
@@ -475,6 +476,56 @@ static void test_var_expand_merge_tables(void)
 	test_end();
 }
 
+static void test_var_expand_program(void)
+{
+	static const char *tests[] = {
+		"",
+		"no variables at all",
+		"%u",
+		"literal %u literal %{long} tail",
+		"%{long}%u%%",
+		"mixed %2.5Mu and %{nonexistent} keys",
+		"trailing percent %",
+		"%{unclosed brace",
+		"%0.-1u pad %05u",
+	};
+	static const struct var_expand_table table[] = {
+		{ 'u', "user1234", "long" },
+		{ '\0', NULL, NULL }
+	};
+	string_t *str1 = t_str_new(128);
+	string_t *str2 = t_str_new(128);
+	struct var_expand_program *prog;
+	const char *error1, *error2;
+	unsigned int i;
+	pool_t pool;
+	int ret1, ret2;
+
+	test_begin("var_expand_program");
+	pool = pool_alloconly_create("var expand program", 1024);
+	for (i = 0; i < N_ELEMENTS(tests); i++) {
+		p_clear(pool);
+		prog = var_expand_program_compile(pool, tests[i]);
+		test_assert_idx(strcmp(var_expand_program_get_source(prog),
+				       tests[i]) == 0, i);
+
+		str_truncate(str1, 0);
+		str_truncate(str2, 0);
+		ret1 = var_expand(str1, tests[i], table, &error1);
+		ret2 = var_expand_program_execute(str2, prog, table, NULL,
+						  NULL, &error2);
+		test_assert_idx(ret1 == ret2, i);
+		test_assert_idx(strcmp(str_c(str1), str_c(str2)) == 0, i);
+	}
+
+	prog = var_expand_program_compile(pool, "static");
+	test_assert(!var_expand_program_has_variables(prog));
+	prog = var_expand_program_compile(pool, "not %u static");
+	test_assert(var_expand_program_has_variables(prog));
+	pool_unref(&pool);
+	test_end();
+}
+
 void test_var_expand(void)
 {
 	test_var_expand_ranges();
@@ -486,4 +537,5 @@ void test_var_expand(void)
 	test_var_expand_extensions();
 	test_var_expand_if();
 	test_var_expand_merge_tables();
+	test_var_expand_program();
 }
@@ -371,9 +371,19 @@ static int uni_utf8_find_invalid_pos(const unsigned char *input, size_t size,
 
 	/* find the first invalid utf8 sequence */
 	for (i = 0; i < size;) {
-		if (input[i] < 0x80)
+		if (input[i] < 0x80) {
 			i++;
-		else {
+			/* skip ASCII-only stretches a word at a time -
+			   mostly-ASCII input is the common case */
+			while (i + sizeof(uint64_t) <= size) {
+				uint64_t w;
+
+				memcpy(&w, input + i, sizeof(w));
+				if ((w & 0x8080808080808080ULL) != 0)
+					break;
+				i += sizeof(w);
+			}
+		} else {
 			len = is_valid_utf8_seq(input + i, size-i);
 			if (unlikely(len == 0)) {
 				*pos_r = i;
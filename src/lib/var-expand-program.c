@@ -0,0 +1,112 @@
+/* Copyright (c) 2003-2018 Dovecot authors, see the included COPYING file */
+
+#include "lib.h"
+#include "array.h"
+#include "str.h"
+#include "var-expand.h"
+#include "var-expand-program.h"
+
+struct var_expand_program_part {
+	/* literal run, or NULL for a variable part */
+	const char *literal;
+	size_t literal_len;
+	/* variable specification starting with '%', NUL-terminated */
+	const char *var_spec;
+};
+
+struct var_expand_program {
+	const char *source;
+	ARRAY(struct var_expand_program_part) parts;
+	bool has_variables;
+};
+
+struct var_expand_program *
+var_expand_program_compile(pool_t pool, const char *str)
+{
+	struct var_expand_program *prog;
+	struct var_expand_program_part *part;
+	const char *p = str, *start;
+
+	prog = p_new(pool, struct var_expand_program, 1);
+	prog->source = p_strdup(pool, str);
+	p_array_init(&prog->parts, pool, 8);
+
+	while (*p != '\0') {
+		if (*p != '%') {
+			/* literal run up to the next '%' */
+			start = p;
+			while (*p != '\0' && *p != '%')
+				p++;
+			part = array_append_space(&prog->parts);
+			part->literal = p_strndup(pool, start, p - start);
+			part->literal_len = p - start;
+		} else {
+			/* variable specification: '%' followed by optional
+			   offset/width/modifiers and a short or long key.
+			   var_get_key_range() consumes the same prefix as
+			   the expander itself. */
+			unsigned int idx, size;
+			size_t spec_len;
+
+			start = p++;
+			var_get_key_range(p, &idx, &size);
+			if (size == 0) {
+				/* '%' at the end of string - the expander
+				   ignores it */
+				spec_len = (p - start) + idx;
+			} else if (idx > 0 && p[idx-1] == '{') {
+				/* long key: idx points inside the braces,
+				   which var_get_key_range() doesn't
+				   include */
+				spec_len = (p - start) + idx + size;
+				if (p[idx + size] == '}')
+					spec_len++;
+			} else {
+				spec_len = (p - start) + idx + size;
+			}
+			part = array_append_space(&prog->parts);
+			part->var_spec = p_strndup(pool, start, spec_len);
+			prog->has_variables = TRUE;
+			p = start + spec_len;
+		}
+	}
+	return prog;
+}
+
+int var_expand_program_execute(string_t *dest,
+			       const struct var_expand_program *prog,
+			       const struct var_expand_table *table,
+			       const struct var_expand_func_table *func_table,
+			       void *func_context, const char **error_r)
+{
+	const struct var_expand_program_part *part;
+	const char *error;
+	int ret, final_ret = 1;
+
+	*error_r = NULL;
+	array_foreach(&prog->parts, part) {
+		if (part->var_spec == NULL) {
+			str_append_data(dest, part->literal,
+					part->literal_len);
+			continue;
+		}
+		ret = var_expand_with_funcs(dest, part->var_spec, table,
+					    func_table, func_context, &error);
+		if (final_ret > ret) {
+			final_ret = ret;
+			*error_r = error;
+		}
+	}
+	return final_ret;
+}
+
+const char *
+var_expand_program_get_source(const struct var_expand_program *prog)
+{
+	return prog->source;
+}
+
+bool var_expand_program_has_variables(const struct var_expand_program *prog)
+{
+	return prog->has_variables;
+}
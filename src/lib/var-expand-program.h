@@ -0,0 +1,36 @@
+#ifndef VAR_EXPAND_PROGRAM_H
+#define VAR_EXPAND_PROGRAM_H
+
+#include "var-expand.h"
+
+/* Precompiled %variable format string. Compiling splits the format string
+   once into literal runs and variable specifications, so repeated
+   expansions (e.g. a log format applied per mail) no longer re-scan the
+   literal text character by character. The expansion semantics are exactly
+   the same as with var_expand_with_funcs(). */
+
+struct var_expand_program;
+
+/* Compile str into a program allocated from pool. The string is copied;
+   str doesn't need to stay valid. */
+struct var_expand_program *
+var_expand_program_compile(pool_t pool, const char *str);
+
+/* Expand the compiled program, appending the result to dest. The return
+   values match var_expand_with_funcs(). */
+int var_expand_program_execute(string_t *dest,
+			       const struct var_expand_program *prog,
+			       const struct var_expand_table *table,
+			       const struct var_expand_func_table *func_table,
+			       void *func_context, const char **error_r)
+	ATTR_NULL(4, 5, 6);
+
+/* Returns the original format string the program was compiled from. */
+const char *
+var_expand_program_get_source(const struct var_expand_program *prog);
+
+/* Returns TRUE if the program contains any %variables at all. Callers can
+   skip building the variable table entirely for static strings. */
+bool var_expand_program_has_variables(const struct var_expand_program *prog);
+
+#endif
@@ -670,6 +670,14 @@ lmtp_local_deliver_to_rcpts(struct lmtp_local *local,
 		} else if (local->rcpt_user != NULL) {
 			mail_storage_service_io_deactivate_user(local->rcpt_user->service_user);
 		}
+
+		if (i + 1 < count) {
+			/* Send the replies submitted so far to the client
+			   already, so that a slow delivery for one recipient
+			   doesn't delay the replies for the recipients that
+			   were already handled. */
+			smtp_server_connection_flush_replies(client->conn);
+		}
 	}
 	return first_uid;
 }
@@ -430,7 +430,7 @@ void client_destroy(struct client *client, const char *reason)
 					   client->master_tag);
 		client->refcount--;
 	} else if (client->auth_request != NULL ||
-		   client->anvil_query != NULL ||
+		   client->anvil_request != NULL ||
 		   client->final_response) {
 		i_assert(client->authenticating);
 		sasl_server_auth_abort(client);
@@ -438,6 +438,7 @@ void client_destroy(struct client *client, const char *reason)
 	i_assert(!client->authenticating);
 	i_assert(client->auth_request == NULL);
 	i_assert(client->anvil_query == NULL);
+	i_assert(client->anvil_request == NULL);
 
 	if (client->reauth_request != NULL) {
 		struct auth_client_request *reauth_request =
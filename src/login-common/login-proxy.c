@@ -991,6 +991,9 @@ void login_proxy_detach(struct login_proxy *proxy)
 	proxy->iostream_proxy =
 		iostream_proxy_create(proxy->client_input, proxy->client_output,
 				      proxy->server_input, proxy->server_output);
+	/* each direction falls back to normal copying on its own when its
+	   streams don't read/write the fds directly (TLS on either side) */
+	iostream_proxy_set_try_splice(proxy->iostream_proxy, TRUE);
 	iostream_proxy_set_completion_callback(proxy->iostream_proxy,
 					       login_proxy_finished, proxy);
 	iostream_proxy_start(proxy->iostream_proxy);
@@ -454,6 +454,7 @@ static void main_deinit(void)
 		anvil_client_deinit(&anvil);
 	timeout_remove(&auth_client_to);
 	client_common_deinit();
+	sasl_server_deinit();
 	dsasl_clients_deinit();
 }
 
@@ -7,6 +7,7 @@
 #include "str.h"
 #include "base64.h"
 #include "buffer.h"
+#include "hash.h"
 #include "hex-binary.h"
 #include "ioloop.h"
 #include "istream.h"
@@ -33,8 +34,22 @@ struct anvil_request {
 	struct client *client;
 	unsigned int auth_pid;
 	unsigned char cookie[LOGIN_REQUEST_COOKIE_SIZE];
+	/* non-NULL while this request is part of a shared anvil lookup */
+	struct anvil_lookup_pending *pending;
 };
 
+/* Anvil lookups currently in flight, keyed by the LOOKUP query. During
+   connection storms many logins for the same user+IP finish authentication
+   in parallel - they all share a single anvil round trip instead of each
+   sending their own query to the single anvil process. */
+struct anvil_lookup_pending {
+	char *query;
+	/* requests waiting for the lookup sent by the first request */
+	ARRAY(struct anvil_request *) waiters;
+};
+
+static HASH_TABLE(char *, struct anvil_lookup_pending *) anvil_pending_lookups;
+
 static bool
 sasl_server_filter_mech(struct client *client, struct auth_mech_desc *mech)
 {
@@ -217,7 +232,8 @@ static int master_send_request(struct anvil_request *anvil_request)
 }
 
 static void ATTR_NULL(1)
-anvil_lookup_callback(const char *reply, struct anvil_request *req)
+anvil_lookup_finish(const char *reply, struct anvil_request *req,
+		    unsigned int extra_count)
 {
 	struct client *client = req->client;
 	const struct login_settings *set = client->set;
@@ -234,7 +250,8 @@ anvil_lookup_callback(const char *reply, struct anvil_request *req)
 
 	/* reply=NULL if we didn't need to do anvil lookup,
 	   or if the anvil lookup failed. allow failed anvil lookups in. */
-	if (reply == NULL || conn_count < set->mail_max_userip_connections) {
+	if (reply == NULL ||
+	    conn_count + extra_count < set->mail_max_userip_connections) {
 		ret = master_send_request(req);
 		errmsg = NULL; /* client will see internal error */
 	} else {
@@ -251,11 +268,88 @@ anvil_lookup_callback(const char *reply, struct anvil_request *req)
 	i_free(req);
 }
 
+static void ATTR_NULL(1)
+anvil_lookup_callback(const char *reply, struct anvil_request *req)
+{
+	struct anvil_lookup_pending *pending = req->pending;
+	struct anvil_request *waiter;
+	unsigned int extra_count = 0;
+
+	if (pending == NULL) {
+		anvil_lookup_finish(reply, req, 0);
+		return;
+	}
+	/* remove the pending record first - the callbacks below may start
+	   new lookups for the same user+IP */
+	hash_table_remove(anvil_pending_lookups, pending->query);
+	req->pending = NULL;
+	anvil_lookup_finish(reply, req, extra_count++);
+	array_foreach_elem(&pending->waiters, waiter) {
+		/* each request processed before this one counts towards the
+		   connection limit */
+		waiter->pending = NULL;
+		anvil_lookup_finish(reply, waiter, extra_count++);
+	}
+	array_free(&pending->waiters);
+	i_free(pending->query);
+	i_free(pending);
+}
+
+static void anvil_lookup_abort(struct client *client)
+{
+	struct anvil_request *req = client->anvil_request;
+	struct anvil_lookup_pending *pending = req->pending;
+
+	if (client->anvil_query != NULL) {
+		anvil_client_query_abort(anvil, &client->anvil_query);
+		if (pending != NULL) {
+			struct anvil_request *const *waiters;
+			unsigned int count;
+
+			waiters = array_get(&pending->waiters, &count);
+			if (count == 0) {
+				hash_table_remove(anvil_pending_lookups,
+						  pending->query);
+				array_free(&pending->waiters);
+				i_free(pending->query);
+				i_free(pending);
+			} else {
+				/* this request's query carried waiters -
+				   promote the first waiter to send the
+				   query again */
+				struct anvil_request *owner = waiters[0];
+
+				array_pop_front(&pending->waiters);
+				owner->client->anvil_query =
+					anvil_client_query(anvil,
+						pending->query,
+						ANVIL_DEFAULT_LOOKUP_TIMEOUT_MSECS,
+						anvil_lookup_callback, owner);
+			}
+		}
+	} else if (pending != NULL) {
+		/* waiting for another request's lookup */
+		struct anvil_request *const *waiters;
+		unsigned int i, count;
+
+		waiters = array_get(&pending->waiters, &count);
+		for (i = 0; i < count; i++) {
+			if (waiters[i] == req) {
+				array_delete(&pending->waiters, i, 1);
+				break;
+			}
+		}
+	}
+	i_free(req);
+	client->anvil_request = NULL;
+}
+
 static void
 anvil_check_too_many_connections(struct client *client,
 				 struct auth_client_request *request)
 {
 	struct anvil_request *req;
+	struct anvil_lookup_pending *pending;
 	const char *query, *cookie;
 	buffer_t buf;
 
@@ -279,6 +373,24 @@ anvil_check_too_many_connections(struct client *client,
 			    login_binary->protocol, "\t",
 			    net_ip2addr(&client->ip), NULL);
 	client->anvil_request = req;
+
+	if (!hash_table_is_created(anvil_pending_lookups)) {
+		hash_table_create(&anvil_pending_lookups, default_pool, 0,
+				  str_hash, strcmp);
+	}
+	pending = hash_table_lookup(anvil_pending_lookups, query);
+	if (pending != NULL) {
+		/* an identical lookup is already in flight -
+		   wait for its reply */
+		req->pending = pending;
+		array_push_back(&pending->waiters, &req);
+		return;
+	}
+	pending = i_new(struct anvil_lookup_pending, 1);
+	pending->query = i_strdup(query);
+	i_array_init(&pending->waiters, 4);
+	hash_table_insert(anvil_pending_lookups, pending->query, pending);
+	req->pending = pending;
 	client->anvil_query =
 		anvil_client_query(anvil, query,
 				   ANVIL_DEFAULT_LOOKUP_TIMEOUT_MSECS,
@@ -610,14 +722,20 @@ void sasl_server_auth_failed(struct client *client, const char *reason,
 void sasl_server_auth_abort(struct client *client)
 {
 	client->auth_aborted_by_client = TRUE;
-	if (client->anvil_query != NULL) {
-		anvil_client_query_abort(anvil, &client->anvil_query);
-		i_free(client->anvil_request);
-	}
+	if (client->anvil_request != NULL)
+		anvil_lookup_abort(client);
 	sasl_server_auth_cancel(client, "Aborted", NULL,
 				SASL_SERVER_REPLY_AUTH_ABORTED);
 }
 
+void sasl_server_deinit(void)
+{
+	if (!hash_table_is_created(anvil_pending_lookups))
+		return;
+	i_assert(hash_table_count(anvil_pending_lookups) == 0);
+	hash_table_destroy(&anvil_pending_lookups);
+}
+
 void sasl_server_auth_delayed_final(struct client *client)
 {
 	client->final_response = FALSE;
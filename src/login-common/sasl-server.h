@@ -44,4 +44,6 @@ void sasl_server_auth_failed(struct client *client, const char *reason,
    "*" line. */
 void sasl_server_auth_abort(struct client *client);
 
+void sasl_server_deinit(void);
+
 #endif
@@ -113,6 +113,8 @@ static const struct setting_define service_setting_defines[] = {
 	DEF(STR, chroot),
 
 	DEF(BOOL, drop_priv_before_exec),
+	DEF(BOOL, cpu_affinity),
+	DEF(STR, cpu_affinity_cpus),
 
 	DEF(UINT, process_min_avail),
 	DEF(UINT, process_limit),
@@ -143,6 +145,8 @@ static const struct service_settings service_default_settings = {
 	.chroot = "",
 
 	.drop_priv_before_exec = FALSE,
+	.cpu_affinity = FALSE,
+	.cpu_affinity_cpus = "",
 
 	.process_min_avail = 0,
 	.process_limit = 0,
@@ -29,12 +29,22 @@
 #define SERVICE_MAX_EXIT_FAILURES_IN_SEC 10
 #define SERVICE_MIN_SUCCESSFUL_AGE_SECS 10
 #define SERVICE_PREFORK_MAX_AT_ONCE 10
+#define SERVICE_PREFORK_BOOST_MAX 32
 
 static void service_monitor_start_extra_avail(struct service *service);
+static void service_monitor_prefork_timeout(struct service *service);
 static void service_status_more(struct service_process *process,
 				const struct master_status *status);
 static void service_monitor_listen_start_force(struct service *service);
 
+static unsigned int service_process_min_avail(const struct service *service)
+{
+	unsigned int min_avail = service->set->process_min_avail +
+		service->process_min_avail_extra;
+
+	return I_MIN(min_avail, service->process_limit);
+}
+
 static void service_process_idle_kill_timeout(struct service_process *process)
 {
 	struct master_status status;
@@ -57,14 +67,22 @@ static void service_kill_idle(struct service *service)
 		service->process_idling_lowwater_since_kills;
 	service->process_idling_lowwater_since_kills = service->process_idling;
 
+	/* if no forks have been triggered by accept since the last round,
+	   the connection burst is over - let the raised prefork floor
+	   drift back down */
+	if (service->process_min_avail_extra > 0 &&
+	    ioloop_time - service->accept_fork_time >=
+		(time_t)service->idle_kill)
+		service->process_min_avail_extra /= 2;
+
 	/* Always try to leave process_min_avail processes */
 	i_assert(processes_to_kill <= service->process_avail);
-	if (processes_to_kill <= service->set->process_min_avail) {
+	if (processes_to_kill <= service_process_min_avail(service)) {
 		if (service->process_idling == 0)
 			timeout_remove(&service->to_idle);
 		return;
 	}
-	processes_to_kill -= service->set->process_min_avail;
+	processes_to_kill -= service_process_min_avail(service);
 
 	/* Now, kill the processes with the oldest idle_start time.
 
@@ -160,10 +178,12 @@ static void service_check_idle(struct service_process *process)
 		       &service->idle_processes_tail, process);
 	process->idle_start = ioloop_time;
 
-	if (service->process_avail > service->set->process_min_avail &&
+	if ((service->process_avail > service_process_min_avail(service) ||
+	     service->process_min_avail_extra > 0) &&
 	    service->to_idle == NULL &&
 	    service->idle_kill != UINT_MAX) {
-		/* We have more processes than we really need. Start a timer
+		/* We have more processes than we really need, or the prefork
+		   floor is raised and may need lowering later. Start a timer
 		   to trigger idle_kill. */
 		service->to_idle =
 			timeout_add(service->idle_kill * 1000,
@@ -375,9 +395,26 @@ static void service_drop_connections(struct service_listener *l)
 	}
 }
 
+static void service_accept_count_fork(struct service *service)
+{
+	if (service->accept_fork_time != ioloop_time) {
+		service->accept_fork_time = ioloop_time;
+		service->accept_fork_count = 0;
+	}
+	service->accept_fork_count++;
+
+	/* Forks triggered by accept mean clients had to wait for a process
+	   to start up. If they keep outpacing the prefork floor, raise the
+	   floor so the next burst finds idling processes waiting. */
+	if (service->accept_fork_count > service_process_min_avail(service) &&
+	    service->process_min_avail_extra < SERVICE_PREFORK_BOOST_MAX)
+		service->process_min_avail_extra++;
+}
+
 static void service_accept(struct service_listener *l)
 {
 	struct service *service = l->service;
+	unsigned int i, count;
 
 	i_assert(service->process_avail == 0);
 
@@ -388,11 +425,36 @@ static void service_accept(struct service_listener *l)
 		return;
 	}
 
-	/* create a child process and let it accept() this connection */
-	if (service_process_create(service) == NULL)
-		service_monitor_throttle(service);
-	else
+	service_accept_count_fork(service);
+
+	/* Create child processes and let them accept() the pending
+	   connections. We can't see how many connections are queued in the
+	   listen backlog, but during a connection storm one fork per ioloop
+	   wakeup drains it too slowly, so scale the batch up with the
+	   accept-driven fork rate within the current second. Processes that
+	   find the backlog already empty just start idling. */
+	count = I_MIN(service->accept_fork_count, SERVICE_PREFORK_MAX_AT_ONCE);
+	count = I_MIN(count, service->process_limit - service->process_count);
+	for (i = 0; i < count; i++) {
+		if (service_process_create(service) == NULL) {
+			if (i == 0)
+				service_monitor_throttle(service);
+			break;
+		}
+	}
+	if (i > 0) {
 		service_monitor_listen_stop(service);
+		/* prefork more in the background if the floor was raised.
+		   the timeout handler makes sure the master isn't too busy
+		   forking more important processes. */
+		if (service->process_min_avail_extra > 0 &&
+		    service->to_prefork == NULL) {
+			service->to_prefork =
+				timeout_add_short(0,
+					service_monitor_prefork_timeout,
+					service);
+		}
+	}
 }
 
 static bool
@@ -400,9 +462,9 @@ service_monitor_start_count(struct service *service, unsigned int limit)
 {
 	unsigned int i, count;
 
-	i_assert(service->set->process_min_avail >= service->process_avail);
+	i_assert(service_process_min_avail(service) >= service->process_avail);
 
-	count = service->set->process_min_avail - service->process_avail;
+	count = service_process_min_avail(service) - service->process_avail;
 	if (service->process_count + count > service->process_limit)
 		count = service->process_limit - service->process_count;
 	if (count > limit)
@@ -430,9 +492,9 @@ static void service_monitor_prefork_timeout(struct service *service)
 		service->prefork_counter = service->list->fork_counter;
 		return;
 	}
-	if (service->process_avail < service->set->process_min_avail) {
+	if (service->process_avail < service_process_min_avail(service)) {
 		if (service_monitor_start_count(service, SERVICE_PREFORK_MAX_AT_ONCE) &&
-		    service->process_avail < service->set->process_min_avail) {
+		    service->process_avail < service_process_min_avail(service)) {
 			/* All SERVICE_PREFORK_MAX_AT_ONCE were created, but
 			   it still wasn't enough. Launch more in the next
 			   timeout. */
@@ -444,7 +506,7 @@ static void service_monitor_prefork_timeout(struct service *service)
 
 static void service_monitor_start_extra_avail(struct service *service)
 {
-	if (service->process_avail >= service->set->process_min_avail ||
+	if (service->process_avail >= service_process_min_avail(service) ||
 	    service->process_count >= service->process_limit ||
 	    service->list->destroying)
 		return;
@@ -453,7 +515,7 @@ static void service_monitor_start_extra_avail(struct service *service)
 		/* quickly start one process now */
 		if (!service_monitor_start_count(service, 1))
 			return;
-		if (service->process_avail >= service->set->process_min_avail)
+		if (service->process_avail >= service_process_min_avail(service))
 			return;
 	}
 	if (service->to_prefork == NULL) {
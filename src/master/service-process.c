@@ -1,5 +1,8 @@
 /* Copyright (c) 2005-2018 Dovecot authors, see the included COPYING file */
 
+/* for sched_setaffinity() and CPU_SET() in sched.h */
+#define _GNU_SOURCE
+
 #include "common.h"
 #include "array.h"
 #include "aqueue.h"
@@ -33,6 +36,86 @@
 #include <syslog.h>
 #include <signal.h>
 #include <sys/wait.h>
+#ifdef HAVE_SCHED_SETAFFINITY
+#  include <sched.h>
+#endif
+
+static int service_cpu_affinity_next(struct service *service)
+{
+#if defined(HAVE_SCHED_SETAFFINITY) && defined(CPU_SETSIZE)
+	static long ncpus = 0;
+
+	if (array_is_created(&service->cpu_affinity_cpus)) {
+		const unsigned int *cpus;
+		unsigned int count;
+
+		cpus = array_get(&service->cpu_affinity_cpus, &count);
+		return (int)cpus[service->cpu_affinity_next++ % count];
+	}
+	if (ncpus == 0)
+		ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (ncpus <= 0)
+		return -1;
+	return (int)(service->cpu_affinity_next++ % ncpus);
+#else
+	if (service->cpu_affinity_next++ == 0) {
+		e_error(service->event,
+			"cpu_affinity is enabled, but sched_setaffinity() "
+			"isn't supported on this system");
+	}
+	return -1;
+#endif
+}
+
+static void
+service_process_set_cpu_affinity(struct service *service ATTR_UNUSED,
+				 int cpu ATTR_UNUSED)
+{
+#if defined(HAVE_SCHED_SETAFFINITY) && defined(CPU_SETSIZE)
+	cpu_set_t cpus;
+
+	if (cpu >= CPU_SETSIZE) {
+		/* the list values are bounded at config parsing, but the
+		   round-robin over online CPUs isn't */
+		return;
+	}
+	CPU_ZERO(&cpus);
+	CPU_SET(cpu, &cpus);
+	if (sched_setaffinity(0, sizeof(cpus), &cpus) < 0) {
+		e_error(service->event,
+			"sched_setaffinity(cpu=%d) failed: %m", cpu);
+	}
+#endif
+}
+
+/* Allow the process to run on any of the service's configured CPUs. The
+   affinity mask is inherited over fork() and exec(), so it also covers
+   anything this process spawns. */
+static void
+service_process_set_cpu_affinity_set(struct service *service ATTR_UNUSED)
+{
+#if defined(HAVE_SCHED_SETAFFINITY) && defined(CPU_SETSIZE)
+	cpu_set_t cpus;
+	const unsigned int *cpu;
+
+	CPU_ZERO(&cpus);
+	array_foreach(&service->cpu_affinity_cpus, cpu) {
+		if (*cpu < CPU_SETSIZE)
+			CPU_SET(*cpu, &cpus);
+		else {
+			e_error(service->event,
+				"cpu_affinity_cpus: CPU %u is larger than "
+				"the maximum supported %u - ignoring",
+				*cpu, CPU_SETSIZE - 1);
+		}
+	}
+	if (sched_setaffinity(0, sizeof(cpus), &cpus) < 0) {
+		e_error(service->event,
+			"sched_setaffinity(cpu_affinity_cpus=%s) failed: %m",
+			service->set->cpu_affinity_cpus);
+	}
+#endif
+}
 
 static void service_reopen_inet_listeners(struct service *service)
 {
@@ -218,11 +301,21 @@ service_dup_fds(struct service *service)
 		i_set_failure_internal();
 	}
 
-	if (service->type == SERVICE_TYPE_LOG) {
-		/* Pass our config fd to the log process, so it won't depend
-		   on config process. Note that we don't want to do this for
-		   other processes, since it prevents config reload. */
+	if (service->type == SERVICE_TYPE_LOG)
 		i_assert(global_config_fd != -1);
+	if (service->type != SERVICE_TYPE_CONFIG && global_config_fd != -1) {
+		/* Pass our config fd to the process, so it can mmap the
+		   already-parsed config instead of requesting it from the
+		   config process at startup. This keeps the log process from
+		   depending on the config process at all, and keeps the
+		   config process out of the fork path when a burst of new
+		   connections starts many processes at once.
+
+		   Config reloads still work: the settings reader drops
+		   DOVECOT_CONFIG_FD_ENV after the first read so an explicit
+		   re-read goes through the config socket, and SIGHUP
+		   replaces global_config_fd so processes forked after a
+		   reload see the new config. */
 		if (lseek(global_config_fd, 0, SEEK_SET) < 0)
 			i_fatal("lseek(config fd, 0) failed: %m");
 		dup2_append(&dups, global_config_fd, MASTER_CONFIG_FD);
@@ -364,6 +457,7 @@ struct service_process *service_process_create(struct service *service)
 	unsigned int uid = ++uid_counter;
 	const char *hostdomain;
 	pid_t pid;
+	int cpu = -1;
 	bool process_forked;
 
 	i_assert(service->status_fd[0] != -1);
@@ -381,6 +475,19 @@ struct service_process *service_process_create(struct service *service)
 	   future lookups. */
 	hostdomain = my_hostdomain();
 
+	/* pick the CPU in the parent, since the round-robin counter must
+	   advance across all of the service's processes */
+	if (service->set->cpu_affinity)
+		cpu = service_cpu_affinity_next(service);
+#if !defined(HAVE_SCHED_SETAFFINITY) || !defined(CPU_SETSIZE)
+	else if (array_is_created(&service->cpu_affinity_cpus) &&
+		 service->cpu_affinity_next++ == 0) {
+		e_error(service->event,
+			"cpu_affinity_cpus is set, but sched_setaffinity() "
+			"isn't supported on this system");
+	}
+#endif
+
 	if (service->type == SERVICE_TYPE_ANVIL &&
 	    service_anvil_global->pid != 0) {
 		pid = service_anvil_global->pid;
@@ -408,6 +515,10 @@ struct service_process *service_process_create(struct service *service)
 	}
 	if (pid == 0) {
 		/* child */
+		if (cpu != -1)
+			service_process_set_cpu_affinity(service, cpu);
+		else if (array_is_created(&service->cpu_affinity_cpus))
+			service_process_set_cpu_affinity_set(service);
 		service_process_setup_environment(service, uid, hostdomain);
 		service_reopen_inet_listeners(service);
 		service_dup_fds(service);
@@ -1,5 +1,8 @@
 /* Copyright (c) 2005-2018 Dovecot authors, see the included COPYING file */
 
+/* for CPU_SETSIZE in sched.h */
+#define _GNU_SOURCE
+
 #include "common.h"
 #include "ioloop.h"
 #include "array.h"
@@ -16,6 +19,18 @@
 
 #include <unistd.h>
 #include <signal.h>
+#ifdef HAVE_SCHED_SETAFFINITY
+#  include <sched.h>
+#endif
+
+/* Upper bound for cpu_affinity_cpus values - CPU_SETSIZE when sched.h
+   provides it. The fallback only keeps broken ranges from exploding the
+   CPU list on platforms where the setting is unusable anyway. */
+#ifdef CPU_SETSIZE
+#  define SERVICE_CPU_AFFINITY_MAX CPU_SETSIZE
+#else
+#  define SERVICE_CPU_AFFINITY_MAX 1024
+#endif
 
 #define SERVICE_DIE_TIMEOUT_MSECS (1000*6)
 #define SERVICE_LOGIN_NOTIFY_MIN_INTERVAL_SECS 2
@@ -186,6 +201,49 @@ static int service_get_groups(const char *groups, pool_t pool,
 	return 0;
 }
 
+static int
+service_parse_cpu_affinity(struct service *service, pool_t pool,
+			   const char **error_r)
+{
+	const char *const *tmp, *p;
+	unsigned int cpu, cpu_last;
+
+	if (*service->set->cpu_affinity_cpus == '\0')
+		return 0;
+
+	p_array_init(&service->cpu_affinity_cpus, pool, 8);
+	for (tmp = t_strsplit_spaces(service->set->cpu_affinity_cpus, ", ");
+	     *tmp != NULL; tmp++) {
+		p = strchr(*tmp, '-');
+		if (p == NULL) {
+			if (str_to_uint(*tmp, &cpu) < 0) {
+				*error_r = t_strdup_printf(
+					"Invalid CPU number: %s", *tmp);
+				return -1;
+			}
+			cpu_last = cpu;
+		} else if (str_to_uint(t_strdup_until(*tmp, p), &cpu) < 0 ||
+			   str_to_uint(p + 1, &cpu_last) < 0 ||
+			   cpu_last < cpu) {
+			*error_r = t_strdup_printf(
+				"Invalid CPU range: %s", *tmp);
+			return -1;
+		}
+		if (cpu_last >= SERVICE_CPU_AFFINITY_MAX) {
+			/* also guarantees the loop below terminates -
+			   cpu <= UINT_MAX would never become FALSE */
+			*error_r = t_strdup_printf(
+				"Invalid CPU number %u: "
+				"the maximum supported is %u",
+				cpu_last, SERVICE_CPU_AFFINITY_MAX - 1);
+			return -1;
+		}
+		for (; cpu <= cpu_last; cpu++)
+			array_push_back(&service->cpu_affinity_cpus, &cpu);
+	}
+	return 0;
+}
+
 static struct service *
 service_create_real(pool_t pool, struct event *event,
 		    const struct service_settings *set,
@@ -269,6 +327,13 @@ service_create_real(pool_t pool, struct event *event,
 		}
 	}
 
+	if (service_parse_cpu_affinity(service, pool, error_r) < 0) {
+		*error_r = t_strdup_printf(
+			"%s (See service %s { cpu_affinity_cpus } setting)",
+			*error_r, set->name);
+		return NULL;
+	}
+
 	/* set these later, so if something fails we don't have to worry about
 	   closing them */
 	service->log_fd[0] = -1;
@@ -81,6 +81,11 @@ struct service {
 	unsigned int process_limit;
 	/* Total number of processes ever created */
 	uint64_t process_count_total;
+	/* next CPU to pin a new process to when set->cpu_affinity=yes */
+	unsigned int cpu_affinity_next;
+	/* CPUs parsed from set->cpu_affinity_cpus. Not created when all
+	   online CPUs are allowed. */
+	ARRAY(unsigned int) cpu_affinity_cpus;
 
 	/* Maximum number of client connections a process can handle. */
 	unsigned int client_limit;
@@ -126,6 +131,16 @@ struct service {
 	struct timeout *to_prefork;
 	unsigned int prefork_counter;
 
+	/* Dynamically raised prefork floor: the effective minimum of
+	   available processes is process_min_avail + this. Raised when
+	   connections keep arriving faster than the preforked processes can
+	   cover, lowered again when the demand subsides. */
+	unsigned int process_min_avail_extra;
+	/* number of forks triggered directly by accept during the current
+	   one second measurement window, and the window's start time */
+	unsigned int accept_fork_count;
+	time_t accept_fork_time;
+
 	/* Last time a "dropping client connections" warning was logged */
 	time_t last_drop_warning;
 
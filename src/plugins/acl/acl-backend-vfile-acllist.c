@@ -2,6 +2,7 @@
 
 #include "lib.h"
 #include "array.h"
+#include "hash.h"
 #include "str.h"
 #include "safe-mkstemp.h"
 #include "istream.h"
@@ -32,12 +33,26 @@ acllist_clear(struct acl_backend_vfile *backend, uoff_t file_size)
 			pool_alloconly_create("vfile acllist",
 					      I_MAX(file_size / 2, 128));
 		i_array_init(&backend->acllist, I_MAX(16, file_size / 60));
+		hash_table_create(&backend->acllist_index, default_pool, 0,
+				  str_hash, strcmp);
 	} else {
 		p_clear(backend->acllist_pool);
 		array_clear(&backend->acllist);
+		hash_table_clear(backend->acllist_index, FALSE);
 	}
 }
 
+static void
+acllist_index_append(struct acl_backend_vfile *backend,
+		     const struct acl_backend_vfile_acllist *acllist)
+{
+	/* the entry was just added to the array. use update instead of
+	   insert, so a duplicated name in the file doesn't crash - the
+	   newer entry wins. */
+	hash_table_update(backend->acllist_index, acllist->name,
+			  POINTER_CAST(array_count(&backend->acllist)));
+}
+
 static bool acl_list_get_root_dir(struct acl_backend_vfile *backend,
 				  const char **root_dir_r,
 				  enum mailbox_list_path_type *type_r)
@@ -146,6 +161,7 @@ static int acl_backend_vfile_acllist_read(struct acl_backend_vfile *backend)
 		}
 		acllist.name = p_strdup(backend->acllist_pool, p + 1);
 		array_push_back(&backend->acllist, &acllist);
+		acllist_index_append(backend, &acllist);
 	}
 	if (input->stream_errno != 0)
 		ret = -1;
@@ -199,6 +215,7 @@ acllist_append(struct acl_backend_vfile *backend, struct ostream *output,
 	if (ret > 0) {
 		acllist.name = p_strdup(backend->acllist_pool, name);
 		array_push_back(&backend->acllist, &acllist);
+		acllist_index_append(backend, &acllist);
 
 		o_stream_nsend_str(output, t_strdup_printf(
 			"%s %s\n", dec2str(acllist.mtime), name));
@@ -338,13 +355,14 @@ static const struct acl_backend_vfile_acllist *
 acl_backend_vfile_acllist_find(struct acl_backend_vfile *backend,
 			       const char *name)
 {
-	const struct acl_backend_vfile_acllist *acllist;
-
-	array_foreach(&backend->acllist, acllist) {
-		if (strcmp(acllist->name, name) == 0)
-			return acllist;
-	}
-	return NULL;
+	void *value;
+
+	if (!hash_table_is_created(backend->acllist_index))
+		return NULL;
+	value = hash_table_lookup(backend->acllist_index, name);
+	if (value == NULL)
+		return NULL;
+	return array_idx(&backend->acllist, POINTER_CAST_TO(value, unsigned int) - 1);
 }
 
 void acl_backend_vfile_acllist_verify(struct acl_backend_vfile *backend,
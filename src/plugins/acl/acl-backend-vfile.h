@@ -38,6 +38,9 @@ struct acl_backend_vfile {
 
 	pool_t acllist_pool;
 	ARRAY(struct acl_backend_vfile_acllist) acllist;
+	/* name => index+1 to acllist. The keys point to the entries' names,
+	   so they live in acllist_pool. */
+	HASH_TABLE(const char *, void *) acllist_index;
 
 	time_t acllist_last_check;
 	time_t acllist_mtime;
@@ -10,10 +10,31 @@
 #include "compression.h"
 #include "fs-api-private.h"
 
+/* Objects at most this many bytes are compressed with the "small" handler
+   by default, when one is configured */
+#define COMPRESS_FS_DEFAULT_SMALL_LIMIT (32*1024)
+
+/* Minimum number of sampled bytes before attempting to detect
+   incompressible content */
+#define COMPRESS_FS_SAMPLE_MIN_SIZE 1024
+/* Upper bound for the sampled byte collision probability before content is
+   considered incompressible. sum(p^2) equals 2^-H2, where H2 is the Renyi
+   entropy of the sample: uniformly random (i.e. already compressed or
+   encrypted) data approaches 1/256, while even mildly compressible data
+   stays clearly above this. 0.0055 corresponds to about 7.5 bits of entropy
+   per byte. */
+#define COMPRESS_FS_INCOMPRESSIBLE_COLLISION_PROB 0.0055
+
 struct compress_fs {
 	struct fs fs;
 	const struct compression_handler *compress_handler;
 	int compress_level;
+
+	/* cheaper algorithm for small objects, when configured */
+	const struct compression_handler *small_handler;
+	int small_level;
+	uoff_t small_limit;
+
 	bool try_plain;
 };
 
@@ -47,8 +68,9 @@ fs_compress_init(struct fs *_fs, const char *args,
 		 const struct fs_settings *set, const char **error_r)
 {
 	struct compress_fs *fs = COMPRESS_FS(_fs);
-	const char *p, *compression_name, *level_str;
+	const char *p, *compression_name, *level_str, *value;
 	const char *parent_name, *parent_args;
+	const char *const *fields;
 	int ret;
 
 	/* get compression handler name */
@@ -72,6 +94,58 @@ fs_compress_init(struct fs *_fs, const char *args,
 
 	level_str = t_strdup_until(args, p++);
 	args = p;
+
+	/* the level may be followed by comma-separated parameters */
+	fields = t_strsplit(level_str, ",");
+	level_str = fields[0];
+	for (fields++; *fields != NULL; fields++) {
+		if (str_begins(*fields, "small=", &value)) {
+			ret = compression_lookup_handler(value,
+							 &fs->small_handler);
+			if (ret <= 0) {
+				*error_r = t_strdup_printf(
+					"Compression method '%s' %s.", value,
+					ret == 0 ? "not supported" : "unknown");
+				return -1;
+			}
+		} else if (str_begins(*fields, "small_level=", &value)) {
+			if (str_to_int(value, &fs->small_level) < 0) {
+				*error_r = t_strdup_printf(
+					"Invalid small_level '%s'", value);
+				return -1;
+			}
+		} else if (str_begins(*fields, "small_limit=", &value)) {
+			if (str_to_uoff(value, &fs->small_limit) < 0) {
+				*error_r = t_strdup_printf(
+					"Invalid small_limit '%s'", value);
+				return -1;
+			}
+		} else {
+			*error_r = t_strdup_printf(
+				"Unknown parameter '%s'", *fields);
+			return -1;
+		}
+	}
+	if (fs->small_handler != NULL) {
+		if (fs->small_limit == 0)
+			fs->small_limit = COMPRESS_FS_DEFAULT_SMALL_LIMIT;
+		if (fs->small_level == 0)
+			fs->small_level =
+				fs->small_handler->get_default_level();
+		else if (fs->small_level < fs->small_handler->get_min_level() ||
+			 fs->small_level > fs->small_handler->get_max_level()) {
+			*error_r = t_strdup_printf(
+				"Invalid small_level: "
+				"Level must be between %d..%d",
+				fs->small_handler->get_min_level(),
+				fs->small_handler->get_max_level());
+			return -1;
+		}
+	} else if (fs->small_limit != 0 || fs->small_level != 0) {
+		*error_r = "small_level/small_limit requires small= parameter";
+		return -1;
+	}
+
 	ret = compression_lookup_handler(compression_name, &fs->compress_handler);
 	if (ret <= 0) {
 		*error_r = t_strdup_printf("Compression method '%s' %s.",
@@ -193,12 +267,47 @@ static void fs_compress_write_stream(struct fs_file *_file)
 
 	i_assert(_file->output == NULL);
 
+	/* Buffer the plain object first, so the compression decisions can be
+	   made at finish time, when the full size and a content sample are
+	   known. */
 	file->temp_output =
 		iostream_temp_create_named(_file->fs->temp_path_prefix,
 					   IOSTREAM_TEMP_FLAG_TRY_FD_DUP,
 					   fs_file_path(_file));
-	_file->output = file->fs->compress_handler->
-		create_ostream(file->temp_output, file->fs->compress_level);
+	_file->output = file->temp_output;
+	o_stream_ref(_file->output);
+}
+
+static bool fs_compress_input_is_incompressible(struct istream *input)
+{
+	const unsigned char *data;
+	unsigned int counts[256];
+	size_t size, i;
+	uint64_t sum2 = 0;
+
+	/* peek at the first block */
+	(void)i_stream_read_bytes(input, &data, &size, IO_BLOCK_SIZE);
+	if (size < COMPRESS_FS_SAMPLE_MIN_SIZE) {
+		/* too small of a sample - the per-object overhead dominates
+		   anyway, just use the configured algorithm */
+		return FALSE;
+	}
+	if (size > IO_BLOCK_SIZE)
+		size = IO_BLOCK_SIZE;
+
+	if (compression_detect_handler(input) != NULL) {
+		/* begins with a known compression header */
+		return TRUE;
+	}
+
+	memset(counts, 0, sizeof(counts));
+	for (i = 0; i < size; i++)
+		counts[data[i]]++;
+	for (i = 0; i < N_ELEMENTS(counts); i++)
+		sum2 += (uint64_t)counts[i] * counts[i];
+
+	return (double)sum2 / ((double)size * (double)size) <=
+		COMPRESS_FS_INCOMPRESSIBLE_COLLISION_PROB;
 }
 
 static int fs_compress_write_stream_finish(struct fs_file *_file, bool success)
@@ -235,9 +344,44 @@ static int fs_compress_write_stream_finish(struct fs_file *_file, bool success)
 		return fs_write_stream_finish(_file->parent, &file->temp_output);
 	}
 	/* finish writing the temporary file */
+	uoff_t plain_size = file->temp_output->offset;
 	input = iostream_temp_finish(&file->temp_output, IO_BLOCK_SIZE);
+
+	const struct compression_handler *handler = file->fs->compress_handler;
+	int level = file->fs->compress_level;
+
+	if (file->fs->small_handler != NULL &&
+	    plain_size <= file->fs->small_limit) {
+		/* small object - use the cheaper algorithm */
+		handler = file->fs->small_handler;
+		level = file->fs->small_level;
+	}
+	if (file->fs->try_plain && fs_compress_input_is_incompressible(input)) {
+		/* Already compressed (or encrypted) content - store it plain.
+		   Reads see the missing compression header and return the
+		   object as passthrough, because of the "maybe-" prefix. */
+		handler = NULL;
+	}
+
 	file->super_output = fs_write_stream(_file->parent);
-	o_stream_nsend_istream(file->super_output, input);
+	if (handler == NULL)
+		o_stream_nsend_istream(file->super_output, input);
+	else {
+		struct ostream *output =
+			handler->create_ostream(file->super_output, level);
+		o_stream_nsend_istream(output, input);
+		if (o_stream_finish(output) < 0) {
+			fs_set_error(_file->event, output->stream_errno,
+				     "write(%s) failed: %s",
+				     fs_file_path(_file),
+				     o_stream_get_error(output));
+			o_stream_unref(&output);
+			fs_write_stream_abort_parent(_file, &file->super_output);
+			i_stream_unref(&input);
+			return -1;
+		}
+		o_stream_unref(&output);
+	}
 	ret = fs_write_stream_finish(_file->parent, &file->super_output);
 	i_stream_unref(&input);
 	return ret;
@@ -244,6 +244,8 @@ void fts_flatcurve_xapian_deinit(struct flatcurve_fts_backend *backend)
 			str_append(backend->boxname, (const char *)key);
 			str_append(backend->db_path, (const char *)val);
 
+			if (fts_flatcurve_backend_queue_optimize(backend))
+				continue;
 			if (fts_flatcurve_xapian_optimize_box(
 				backend, &error) < 0)
 				e_error(backend->event, "%s", error);
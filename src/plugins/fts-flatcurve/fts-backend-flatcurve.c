@@ -7,9 +7,12 @@
 #include "mail-storage-private.h"
 #include "mail-search-build.h"
 #include "mailbox-list-iter.h"
+#include "net.h"
 #include "str.h"
+#include "strescape.h"
 #include "time-util.h"
 #include "unlink-directory.h"
+#include "write-full.h"
 #include "fts-backend-flatcurve.h"
 #include "fts-backend-flatcurve-xapian.h"
 
@@ -539,6 +542,48 @@ fts_backend_flatcurve_iterate_ns(struct fts_backend *_backend,
 	return failed ? -1 : 0;
 }
 
+bool fts_flatcurve_backend_queue_optimize(struct flatcurve_fts_backend *backend)
+{
+	struct mail_user *user = backend->backend.ns->user;
+	const char *path;
+	string_t *str;
+	int fd;
+
+	/* The indexer-worker is the background process meant for this kind
+	   of work, and doveadm means an admin asked for it explicitly -
+	   compact inline in those. Everywhere else (especially lmtp and
+	   imap) hand the compaction to the indexer service, so deliveries
+	   aren't stalled behind a full Xapian merge. */
+	if (user->service == NULL ||
+	    strcmp(user->service, "indexer-worker") == 0 ||
+	    str_begins_with(user->service, "doveadm"))
+		return FALSE;
+
+	path = t_strconcat(user->set->base_dir, "/indexer", NULL);
+	fd = net_connect_unix(path);
+	if (fd == -1) {
+		e_debug(backend->event, "net_connect_unix(%s) failed: %m - "
+			"optimizing inline", path);
+		return FALSE;
+	}
+	str = t_str_new(128);
+	str_append(str, "VERSION\tindexer-client\t1\t0\n");
+	str_append(str, "OPTIMIZE\t0\t");
+	str_append_tabescaped(str, user->username);
+	str_append_c(str, '\t');
+	str_append_tabescaped(str, str_c(backend->boxname));
+	str_append_c(str, '\n');
+	if (write_full(fd, str_data(str), str_len(str)) < 0) {
+		e_error(backend->event, "write(%s) failed: %m", path);
+		i_close_fd(&fd);
+		return FALSE;
+	}
+	i_close_fd(&fd);
+	e_debug(backend->event, "Queued optimize of %s to indexer",
+		str_c(backend->boxname));
+	return TRUE;
+}
+
 static int fts_backend_flatcurve_optimize(struct fts_backend *backend)
 {
 	return fts_backend_flatcurve_iterate_ns(backend,
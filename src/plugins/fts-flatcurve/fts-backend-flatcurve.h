@@ -63,6 +63,11 @@ int
 fts_backend_flatcurve_close_mailbox(struct flatcurve_fts_backend *backend,
 				    const char **error_r);
 
+/* Try to hand the pending optimize of the current mailbox to the indexer
+   service instead of compacting inline. Returns TRUE if it was queued,
+   FALSE if the caller should compact inline. */
+bool fts_flatcurve_backend_queue_optimize(struct flatcurve_fts_backend *backend);
+
 /* Returns: 0 if FTS directory doesn't exist, 1 on deletion, -1 on error */
 int fts_backend_flatcurve_delete_dir(const char *path, const char **error_r);
 
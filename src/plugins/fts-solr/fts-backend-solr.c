@@ -19,6 +19,9 @@
 
 #define SOLR_CMDBUF_SIZE (1024*64)
 #define SOLR_CMDBUF_FLUSH_SIZE (SOLR_CMDBUF_SIZE-128)
+/* Maximum number of bytes buffered into a single update POST before it's
+   flushed regardless of batch_size. */
+#define SOLR_POST_MAX_PAYLOAD_SIZE (1024*1024*8)
 #define SOLR_MAX_MULTI_ROWS 100000
 
 /* If header is larger than this, truncate it. */
@@ -403,11 +406,17 @@ fts_backend_solr_update_deinit(struct fts_backend_update_context *_ctx)
 {
 	struct solr_fts_backend_update_context *ctx =
 		(struct solr_fts_backend_update_context *)_ctx;
+	struct solr_fts_backend *backend =
+		(struct solr_fts_backend *)_ctx->backend;
 	struct solr_fts_field *field;
 	int ret = _ctx->failed ? -1 : 0;
 
 	if (fts_backed_solr_build_flush(ctx) < 0)
 		ret = -1;
+	/* wait for any still in-flight update POSTs before expunges and
+	   commit, so they can't overtake the document additions */
+	if (solr_connection_post_flush(backend->solr_conn) < 0)
+		ret = -1;
 
 	if (ctx->expunges) {
 		fts_backend_solr_expunge_flush(ctx);
@@ -432,14 +441,18 @@ fts_backend_solr_update_set_mailbox(struct fts_backend_update_context *_ctx,
 {
 	struct solr_fts_backend_update_context *ctx =
 		(struct solr_fts_backend_update_context *)_ctx;
+	struct solr_fts_backend *backend =
+		(struct solr_fts_backend *)_ctx->backend;
 	const char *box_guid;
 
 	if (ctx->prev_uid != 0) {
 		i_assert(ctx->cur_box != NULL);
 
 		/* flush solr between mailboxes, so we don't wrongly update
-		   last_uid before we know it has succeeded */
-		if (fts_backed_solr_build_flush(ctx) < 0)
+		   last_uid before we know it has succeeded. This includes
+		   waiting for any still in-flight update POSTs. */
+		if (fts_backed_solr_build_flush(ctx) < 0 ||
+		    solr_connection_post_flush(backend->solr_conn) < 0)
 			_ctx->failed = TRUE;
 		else if (!_ctx->failed) {
 			if (fts_backend_solr_commit(ctx) < 0)
@@ -506,7 +519,9 @@ fts_backend_solr_uid_changed(struct solr_fts_backend_update_context *ctx,
 	struct fts_solr_user *fuser =
 		FTS_SOLR_USER_CONTEXT_REQUIRE(ctx->ctx.backend->ns->user);
 
-	if (ctx->mails_since_flush >= fuser->set.batch_size) {
+	if (ctx->mails_since_flush >= fuser->set.batch_size ||
+	    (ctx->post != NULL &&
+	     solr_connection_post_size(ctx->post) >= SOLR_POST_MAX_PAYLOAD_SIZE)) {
 		if (fts_backed_solr_build_flush(ctx) < 0)
 			ctx->ctx.failed = TRUE;
 	}
@@ -10,6 +10,7 @@
 #include "fts-solr-plugin.h"
 
 #define DEFAULT_SOLR_BATCH_SIZE 1000
+#define DEFAULT_SOLR_BULK_POSTS 1
 
 const char *fts_solr_plugin_version = DOVECOT_ABI_VERSION;
 struct http_client *solr_http_client = NULL;
@@ -27,6 +28,7 @@ fts_solr_plugin_init_settings(struct mail_user *user,
 		str = "";
 
 	set->batch_size = DEFAULT_SOLR_BATCH_SIZE;
+	set->bulk_posts = DEFAULT_SOLR_BULK_POSTS;
 	set->soft_commit = TRUE;
 
 	for (tmp = t_strsplit_spaces(str, " "); *tmp != NULL; tmp++) {
@@ -47,6 +49,13 @@ fts_solr_plugin_init_settings(struct mail_user *user,
 					"fts-solr: batch_size must be a positive integer");
 					return -1;
 			}
+		} else if (str_begins(*tmp, "bulk_posts=", &value)) {
+			if (str_to_uint(value, &set->bulk_posts) < 0 ||
+			    set->bulk_posts == 0) {
+				e_error(user->event,
+					"fts-solr: bulk_posts must be a positive integer");
+					return -1;
+			}
 		} else if (str_begins(*tmp, "soft_commit=", &value)) {
 			if (strcmp(value, "yes") == 0) {
 				set->soft_commit = TRUE;
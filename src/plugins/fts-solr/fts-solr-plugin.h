@@ -13,6 +13,7 @@
 struct fts_solr_settings {
 	const char *url, *default_ns_prefix, *rawlog_dir;
 	unsigned int batch_size;
+	unsigned int bulk_posts;
 	bool use_libfts;
 	bool debug;
 	bool soft_commit;
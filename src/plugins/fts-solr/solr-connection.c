@@ -29,6 +29,7 @@ struct solr_lookup_context {
 struct solr_connection_post {
 	struct solr_connection *conn;
 
+	string_t *cmd;
 	struct http_client_request *http_req;
 	int request_status;
 
@@ -44,6 +45,11 @@ struct solr_connection {
 	char *http_user;
 	char *http_password;
 
+	/* max numbers of update POSTs in flight at the same time */
+	unsigned int bulk_posts;
+	unsigned int pending_posts;
+	unsigned int post_error_count;
+
 	bool debug:1;
 	bool posting:1;
 	bool http_ssl:1;
@@ -94,11 +100,12 @@ int solr_connection_init(const struct fts_solr_settings *solr_set,
 	}
 
 	conn->debug = solr_set->debug;
+	conn->bulk_posts = I_MAX(1, solr_set->bulk_posts);
 
 	if (solr_http_client == NULL) {
 		i_zero(&http_set);
 		http_set.max_idle_time_msecs = 5*1000;
-		http_set.max_parallel_connections = 1;
+		http_set.max_parallel_connections = conn->bulk_posts;
 		http_set.max_pipelined_requests = 1;
 		http_set.max_redirects = 1;
 		http_set.max_attempts = 3;
@@ -263,7 +270,7 @@ solr_connection_post_begin(struct solr_connection *conn)
 
 	post = i_new(struct solr_connection_post, 1);
 	post->conn = conn;
-	post->http_req = solr_connection_post_request(post);
+	post->cmd = str_new(default_pool, 1024);
 	return post;
 }
 
@@ -272,48 +279,90 @@ void solr_connection_post_more(struct solr_connection_post *post,
 {
 	i_assert(post->conn->posting);
 
-	if (post->failed)
-		return;
+	if (!post->failed)
+		str_append_data(post->cmd, data, size);
+}
 
-	if (post->request_status == 0) {
-		(void)http_client_request_send_payload(
-			&post->http_req, data, size);
-	}
+size_t solr_connection_post_size(struct solr_connection_post *post)
+{
+	return str_len(post->cmd);
+}
+
+static void
+solr_connection_post_destroyed(struct solr_connection_post *post)
+{
+	struct solr_connection *conn = post->conn;
+
+	i_assert(conn->pending_posts > 0);
+	conn->pending_posts--;
 	if (post->request_status < 0)
-		post->failed = TRUE;
+		conn->post_error_count++;
+	str_free(&post->cmd);
+	i_free(post);
+}
+
+int solr_connection_post_flush(struct solr_connection *conn)
+{
+	if (conn->pending_posts > 0)
+		http_client_wait(solr_http_client);
+	i_assert(conn->pending_posts == 0);
+	if (conn->post_error_count > 0) {
+		conn->post_error_count = 0;
+		return -1;
+	}
+	return 0;
 }
 
 int solr_connection_post_end(struct solr_connection_post **_post)
 {
 	struct solr_connection_post *post = *_post;
 	struct solr_connection *conn = post->conn;
-	int ret = post->failed ? -1 : 0;
+	struct istream *post_payload;
 
 	i_assert(conn->posting);
 
 	*_post = NULL;
+	conn->posting = FALSE;
 
-	if (!post->failed) {
-		if (http_client_request_finish_payload(&post->http_req) < 0 ||
-		    post->request_status < 0) {
-			ret = -1;
-		}
-	} else {
-		http_client_request_abort(&post->http_req);
+	if (post->failed) {
+		str_free(&post->cmd);
+		i_free(post);
+		return -1;
 	}
-	i_free(post);
 
-	conn->posting = FALSE;
-	return ret;
+	/* Submit the request without waiting for the response, so the next
+	   batch can be built while this one is on the wire. The payload
+	   buffer stays alive until the request's destroy callback frees it. */
+	post->http_req = solr_connection_post_request(post);
+	post_payload = i_stream_create_from_data(str_data(post->cmd),
+						 str_len(post->cmd));
+	http_client_request_set_payload(post->http_req, post_payload, FALSE);
+	i_stream_unref(&post_payload);
+	http_client_request_set_destroy_callback(
+		post->http_req, solr_connection_post_destroyed, post);
+	http_client_request_submit(post->http_req);
+	conn->pending_posts++;
+
+	/* backpressure: never more than bulk_posts update requests
+	   in flight */
+	if (conn->pending_posts >= conn->bulk_posts)
+		return solr_connection_post_flush(conn);
+	return 0;
 }
 
 int solr_connection_post(struct solr_connection *conn, const char *cmd)
 {
 	struct istream *post_payload;
 	struct solr_connection_post post;
+	int ret;
 
 	i_assert(!conn->posting);
 
+	/* make sure previously submitted updates are finished first, so e.g.
+	   a <commit/> or <delete> can't overtake them on a parallel
+	   connection */
+	ret = solr_connection_post_flush(conn);
+
 	i_zero(&post);
 	post.conn = conn;
 
@@ -326,5 +375,5 @@ int solr_connection_post(struct solr_connection *conn, const char *cmd)
 	post.request_status = 0;
 	http_client_wait(solr_http_client);
 
-	return post.request_status;
+	return post.request_status < 0 ? -1 : ret;
 }
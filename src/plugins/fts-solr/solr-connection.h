@@ -21,6 +21,11 @@ struct solr_connection_post *
 solr_connection_post_begin(struct solr_connection *conn);
 void solr_connection_post_more(struct solr_connection_post *post,
 			       const unsigned char *data, size_t size);
+/* Returns the number of bytes buffered into the post so far. */
+size_t solr_connection_post_size(struct solr_connection_post *post);
 int solr_connection_post_end(struct solr_connection_post **post);
+/* Wait for all submitted update POSTs to finish. Returns 0 if they all
+   succeeded, -1 if any of them failed. */
+int solr_connection_post_flush(struct solr_connection *conn);
 
 #endif
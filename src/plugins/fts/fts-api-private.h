@@ -88,6 +88,8 @@ struct fts_backend {
 	struct event *event;
 	struct mail_namespace *ns;
 	struct fts_header_filters header_filters;
+	/* recently used lookup results - see fts_backend_lookup() */
+	ARRAY(struct fts_lookup_cache_entry *) lookup_cache;
 
 	bool updating:1;
 };
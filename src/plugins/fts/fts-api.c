@@ -2,6 +2,7 @@
 
 #include "lib.h"
 #include "array.h"
+#include "str.h"
 #include "hex-binary.h"
 #include "mail-index.h"
 #include "mail-namespace.h"
@@ -14,6 +15,29 @@ struct event_category event_category_fts = {
 	.name = "fts",
 };
 
+/* Maximum number of cached lookup results per backend. The cache exists to
+   make repeated identical searches (e.g. webmail refreshing the same search
+   while paginating) nearly free, so it doesn't need to be large. */
+#define FTS_LOOKUP_CACHE_MAX_ENTRIES 10
+
+struct fts_lookup_cache_entry {
+	pool_t pool;
+
+	const char *box_vname;
+	/* IMAP representation of the search args */
+	const char *query;
+	enum fts_lookup_flags flags;
+
+	/* the entry is valid only as long as neither of these changes */
+	uint64_t highest_modseq;
+	uint32_t last_indexed_uid;
+
+	ARRAY_TYPE(seq_range) definite_uids, maybe_uids;
+	ARRAY_TYPE(fts_score_map) scores;
+	/* match_always of each top-level search arg after the lookup */
+	ARRAY(bool) match_always;
+};
+
 static ARRAY(const struct fts_backend *) backends;
 
 void fts_backend_register(const struct fts_backend *backend)
@@ -104,11 +128,32 @@ int fts_backend_init(const char *backend_name, struct mail_namespace *ns,
 	return 0;
 }
 
+static void
+fts_lookup_cache_entry_free(struct fts_lookup_cache_entry **_entry)
+{
+	struct fts_lookup_cache_entry *entry = *_entry;
+
+	*_entry = NULL;
+	pool_unref(&entry->pool);
+}
+
+static void fts_lookup_cache_clear(struct fts_backend *backend)
+{
+	struct fts_lookup_cache_entry *entry;
+
+	if (!array_is_created(&backend->lookup_cache))
+		return;
+	array_foreach_elem(&backend->lookup_cache, entry)
+		fts_lookup_cache_entry_free(&entry);
+	array_free(&backend->lookup_cache);
+}
+
 void fts_backend_deinit(struct fts_backend **_backend)
 {
 	struct fts_backend *backend = *_backend;
 	*_backend = NULL;
 
+	fts_lookup_cache_clear(backend);
 	fts_header_filters_deinit(backend);
 	event_unref(&backend->event);
 	backend->v.deinit(backend);
@@ -400,23 +445,183 @@ static int fts_score_map_sort(const struct fts_score_map *m1,
 	return 0;
 }
 
+static bool
+fts_lookup_cache_get_state(struct mailbox *box, uint64_t *highest_modseq_r,
+			   uint32_t *last_indexed_uid_r)
+{
+	struct mailbox_status status;
+	struct fts_index_header hdr;
+
+	if (mailbox_get_status(box, STATUS_HIGHESTMODSEQ, &status) < 0)
+		return FALSE;
+	if (status.highest_modseq == 0)
+		return FALSE;
+	*highest_modseq_r = status.highest_modseq;
+	/* mails can become indexed without the mailbox changing (e.g. the
+	   background indexer catching up), so the last indexed UID is part of
+	   the validity check as well. */
+	if (!fts_index_get_header(box, &hdr))
+		*last_indexed_uid_r = 0;
+	else
+		*last_indexed_uid_r = hdr.last_indexed_uid;
+	return TRUE;
+}
+
+static bool
+fts_lookup_cache_hit(struct fts_backend *backend, struct mailbox *box,
+		     struct mail_search_arg *args, enum fts_lookup_flags flags,
+		     const char *query, uint64_t highest_modseq,
+		     uint32_t last_indexed_uid, struct fts_result *result)
+{
+	struct fts_lookup_cache_entry *const *entries, *entry;
+	struct mail_search_arg *arg;
+	const bool *match_always;
+	unsigned int i, count, args_count;
+
+	if (!array_is_created(&backend->lookup_cache))
+		return FALSE;
+
+	entries = array_get(&backend->lookup_cache, &count);
+	for (i = 0; i < count; i++) {
+		entry = entries[i];
+		if (entry->flags != flags ||
+		    strcmp(entry->box_vname, box->vname) != 0 ||
+		    strcmp(entry->query, query) != 0)
+			continue;
+		if (entry->highest_modseq != highest_modseq ||
+		    entry->last_indexed_uid != last_indexed_uid) {
+			/* mailbox changed - drop the stale entry */
+			array_delete(&backend->lookup_cache, i, 1);
+			fts_lookup_cache_entry_free(&entry);
+			return FALSE;
+		}
+		break;
+	}
+	if (i == count)
+		return FALSE;
+
+	args_count = 0;
+	for (arg = args; arg != NULL; arg = arg->next)
+		args_count++;
+	if (args_count != array_count(&entry->match_always)) {
+		/* shouldn't happen with an identical query string */
+		return FALSE;
+	}
+
+	array_append_array(&result->definite_uids, &entry->definite_uids);
+	array_append_array(&result->maybe_uids, &entry->maybe_uids);
+	array_append_array(&result->scores, &entry->scores);
+	result->scores_sorted = TRUE;
+
+	i = 0;
+	for (arg = args; arg != NULL; arg = arg->next) {
+		match_always = array_idx(&entry->match_always, i++);
+		arg->match_always = *match_always;
+	}
+	return TRUE;
+}
+
+static void
+fts_lookup_cache_add(struct fts_backend *backend, struct mailbox *box,
+		     const struct mail_search_arg *args,
+		     enum fts_lookup_flags flags, const char *query,
+		     uint64_t highest_modseq, uint32_t last_indexed_uid,
+		     const struct fts_result *result)
+{
+	struct fts_lookup_cache_entry *entry;
+	const struct mail_search_arg *arg;
+	pool_t pool;
+
+	if (!array_is_created(&backend->lookup_cache))
+		i_array_init(&backend->lookup_cache, FTS_LOOKUP_CACHE_MAX_ENTRIES);
+	else if (array_count(&backend->lookup_cache) >=
+		 FTS_LOOKUP_CACHE_MAX_ENTRIES) {
+		/* drop the oldest entry */
+		struct fts_lookup_cache_entry *const *oldest =
+			array_front(&backend->lookup_cache);
+		entry = *oldest;
+		array_pop_front(&backend->lookup_cache);
+		fts_lookup_cache_entry_free(&entry);
+	}
+
+	pool = pool_alloconly_create(MEMPOOL_GROWING"fts lookup cache entry",
+				     1024);
+	entry = p_new(pool, struct fts_lookup_cache_entry, 1);
+	entry->pool = pool;
+	entry->box_vname = p_strdup(pool, box->vname);
+	entry->query = p_strdup(pool, query);
+	entry->flags = flags;
+	entry->highest_modseq = highest_modseq;
+	entry->last_indexed_uid = last_indexed_uid;
+
+	p_array_init(&entry->definite_uids, pool,
+		     array_count(&result->definite_uids));
+	array_append_array(&entry->definite_uids, &result->definite_uids);
+	p_array_init(&entry->maybe_uids, pool,
+		     array_count(&result->maybe_uids));
+	array_append_array(&entry->maybe_uids, &result->maybe_uids);
+	p_array_init(&entry->scores, pool, array_count(&result->scores));
+	array_append_array(&entry->scores, &result->scores);
+
+	p_array_init(&entry->match_always, pool, 4);
+	for (arg = args; arg != NULL; arg = arg->next) {
+		bool match_always = arg->match_always;
+		array_push_back(&entry->match_always, &match_always);
+	}
+	array_push_back(&backend->lookup_cache, &entry);
+}
+
 int fts_backend_lookup(struct fts_backend *backend, struct mailbox *box,
 		       struct mail_search_arg *args,
 		       enum fts_lookup_flags flags,
 		       struct fts_result *result)
 {
+	const char *query = NULL;
+	uint64_t highest_modseq = 0;
+	uint32_t last_indexed_uid = 0;
+	bool cacheable = FALSE;
+	int ret = 0;
+
 	array_clear(&result->definite_uids);
 	array_clear(&result->maybe_uids);
 	array_clear(&result->scores);
 
-	if (backend->v.lookup(backend, box, args, flags, result) < 0)
-		return -1;
-
-	if (!result->scores_sorted && array_is_created(&result->scores)) {
-		array_sort(&result->scores, fts_score_map_sort);
-		result->scores_sorted = TRUE;
-	}
-	return 0;
+	/* Repeated identical lookups (e.g. webmail refreshing the same search
+	   while paginating through the results) are answered from a small
+	   cache, as long as the mailbox hasn't changed in between. */
+	T_BEGIN {
+		string_t *str = t_str_new(128);
+		const char *error;
+
+		if (mail_search_args_to_imap(str, args, &error) &&
+		    fts_lookup_cache_get_state(box, &highest_modseq,
+					       &last_indexed_uid)) {
+			cacheable = TRUE;
+			query = str_c(str);
+		}
+		if (cacheable &&
+		    fts_lookup_cache_hit(backend, box, args, flags, query,
+					 highest_modseq, last_indexed_uid,
+					 result)) {
+			/* served from cache */
+		} else if (backend->v.lookup(backend, box, args, flags,
+					     result) < 0)
+			ret = -1;
+		else {
+			if (!result->scores_sorted &&
+			    array_is_created(&result->scores)) {
+				array_sort(&result->scores,
+					   fts_score_map_sort);
+				result->scores_sorted = TRUE;
+			}
+			if (cacheable) {
+				fts_lookup_cache_add(backend, box, args, flags,
+						     query, highest_modseq,
+						     last_indexed_uid, result);
+			}
+		}
+	} T_END;
+	return ret;
 }
 
 int fts_backend_lookup_multi(struct fts_backend *backend,
@@ -34,6 +34,9 @@ struct fts_mail_build_context {
 
 	buffer_t *word_buf, *pending_input;
 	struct fts_user_language *cur_user_lang;
+
+	char *sender;
+	bool sender_checked:1;
 };
 
 static int fts_build_data(struct fts_mail_build_context *ctx,
@@ -293,6 +296,28 @@ fts_build_add_tokens_with_filter(struct fts_mail_build_context *ctx,
 	return ret;
 }
 
+static const char *
+fts_build_mail_get_sender(struct fts_mail_build_context *ctx)
+{
+	const char *value;
+
+	if (!ctx->sender_checked) {
+		ctx->sender_checked = TRUE;
+		if (mail_get_first_header(ctx->mail, "From", &value) > 0) T_BEGIN {
+			const struct message_address *addr =
+				message_address_parse(pool_datastack_create(),
+					(const unsigned char *)value,
+					strlen(value), 1, 0);
+			if (addr != NULL && addr->mailbox != NULL &&
+			    addr->domain != NULL) {
+				ctx->sender = i_strdup_printf("%s@%s",
+					addr->mailbox, addr->domain);
+			}
+		} T_END;
+	}
+	return ctx->sender;
+}
+
 static int
 fts_detect_language(struct fts_mail_build_context *ctx,
 		    const unsigned char *data, size_t size, bool last,
@@ -301,7 +326,19 @@ fts_detect_language(struct fts_mail_build_context *ctx,
 	struct mail_user *user = ctx->update_ctx->backend->ns->user;
 	struct fts_language_list *lang_list = fts_user_get_language_list(user);
 	const struct fts_language *lang;
-	const char *error;
+	const char *sender, *error;
+
+	/* sender language is usually stable, so once a language has been
+	   detected for a sender, further mails from the same sender skip
+	   detection entirely. */
+	sender = fts_build_mail_get_sender(ctx);
+	if (sender != NULL) {
+		lang = fts_user_sender_language_get(user, sender);
+		if (lang != NULL) {
+			*lang_r = lang;
+			return 1;
+		}
+	}
 
 	switch (fts_language_detect(lang_list, data, size, &lang, &error)) {
 	case FTS_LANGUAGE_RESULT_SHORT:
@@ -318,6 +355,8 @@ fts_detect_language(struct fts_mail_build_context *ctx,
 		*lang_r = fts_language_list_get_first(lang_list);
 		return 1;
 	case FTS_LANGUAGE_RESULT_OK:
+		if (sender != NULL)
+			fts_user_sender_language_set(user, sender, lang);
 		*lang_r = lang;
 		return 1;
 	case FTS_LANGUAGE_RESULT_ERROR:
@@ -698,6 +737,7 @@ fts_build_mail_real(struct fts_backend_update_context *update_ctx,
 	message_decoder_deinit(&decoder);
 	i_free(ctx.content_type);
 	i_free(ctx.content_disposition);
+	i_free(ctx.sender);
 	buffer_free(&ctx.word_buf);
 	buffer_free(&ctx.pending_input);
 	pool_unref(&parts_pool);
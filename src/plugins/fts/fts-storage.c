@@ -50,6 +50,26 @@ struct fts_mailbox {
 	bool fts_mailbox_excluded;
 };
 
+/* fts_index_during_save: the message body is parsed and tokenized while it's
+   still in memory at save time, but UIDs are assigned only at commit. So the
+   build key/data stream that fts_build_mail() would send to the backend is
+   captured into per-transaction memory and replayed into the real backend
+   after commit, once the saved UIDs are known. */
+struct fts_saved_build_part {
+	enum fts_backend_build_key_type type;
+	const char *hdr_name;
+	const char *body_content_type, *body_content_disposition;
+	buffer_t *data;
+};
+
+struct fts_saved_mail {
+	ARRAY(struct fts_saved_build_part) parts;
+	/* capture failed, or the mail was copied without reading it -
+	   the mail is left for autoindex/precache */
+	bool failed:1;
+};
+ARRAY_DEFINE_TYPE(fts_saved_mail, struct fts_saved_mail);
+
 struct fts_transaction_context {
 	union mailbox_transaction_module_context module_ctx;
 
@@ -58,6 +78,12 @@ struct fts_transaction_context {
 	uint32_t highest_virtual_uid;
 	unsigned int precache_extra_count;
 
+	pool_t capture_pool;
+	struct fts_backend_update_context *capture_ctx;
+	ARRAY_TYPE(fts_saved_mail) captured_mails;
+	struct fts_saved_mail *cur_saved_mail;
+	struct fts_saved_build_part *cur_part;
+
 	bool indexing:1;
 	bool precached:1;
 	bool mails_saved:1;
@@ -660,6 +686,10 @@ static int fts_transaction_end(struct mailbox_transaction_context *t, const char
 		}
 	}
 	event_reason_end(&reason);
+	if (ft->capture_ctx != NULL)
+		(void)fts_backend_update_deinit(&ft->capture_ctx);
+	if (ft->capture_pool != NULL)
+		pool_unref(&ft->capture_pool);
 	i_free(ft);
 	return ret;
 }
@@ -706,21 +736,114 @@ static void fts_queue_index(struct mailbox *box)
 	i_close_fd(&fd);
 }
 
+/* Replay the captured build streams into the real backend with the UIDs
+   assigned at commit. Returns 1 if all saved mails were indexed, 0 if some
+   or all of them were left for autoindex, -1 on error. */
+static int
+fts_transaction_index_captured(struct mailbox *box,
+			       const ARRAY_TYPE(fts_saved_mail) *mails,
+			       const struct mail_transaction_commit_changes *changes)
+{
+	struct fts_mailbox_list *flist = FTS_LIST_CONTEXT_REQUIRE(box->list);
+	struct fts_backend_update_context *update_ctx;
+	struct fts_backend_build_key key;
+	const struct fts_saved_mail *smail;
+	const struct fts_saved_build_part *part;
+	struct seq_range_iter iter;
+	uint32_t uid, first_uid, last_indexed_uid;
+	unsigned int n = 0;
+	int ret;
+
+	/* if the storage didn't assign UIDs at commit, we can't tell which
+	   captured stream belongs to which mail */
+	if (seq_range_count(&changes->saved_uids) != array_count(mails))
+		return 0;
+
+	seq_range_array_iter_init(&iter, &changes->saved_uids);
+	if (!seq_range_array_iter_nth(&iter, 0, &first_uid))
+		return 0;
+
+	/* only index at save time if everything up to the newly saved mails
+	   was already indexed. otherwise we'd leave a hole that neither the
+	   indexer nor precaching would ever go back to fill. */
+	ret = fts_search_get_first_missing_uid(flist->backend, box,
+					       &last_indexed_uid);
+	if (ret < 0)
+		return -1;
+	if (ret == 0 && last_indexed_uid + 1 < first_uid)
+		return 0;
+
+	if (flist->update_ctx == NULL)
+		update_ctx = fts_backend_update_init(flist->backend);
+	else
+		update_ctx = flist->update_ctx;
+	fts_backend_update_set_mailbox(update_ctx, box);
+
+	ret = 1;
+	array_foreach(mails, smail) {
+		if (!seq_range_array_iter_nth(&iter, n++, &uid))
+			i_unreached();
+		if (smail->failed) {
+			/* capture failed, or the mail was a copy */
+			if (ret > 0)
+				ret = 0;
+			continue;
+		}
+		array_foreach(&smail->parts, part) {
+			i_zero(&key);
+			key.uid = uid;
+			key.type = part->type;
+			key.hdr_name = part->hdr_name;
+			key.body_content_type = part->body_content_type;
+			key.body_content_disposition =
+				part->body_content_disposition;
+			if (!fts_backend_update_set_build_key(update_ctx, &key))
+				continue;
+			if (fts_backend_update_build_more(update_ctx,
+					part->data->data,
+					part->data->used) < 0)
+				ret = -1;
+			fts_backend_update_unset_build_key(update_ctx);
+			if (ret < 0)
+				break;
+		}
+		if (ret < 0)
+			break;
+	}
+	fts_backend_update_set_mailbox(update_ctx, NULL);
+	if (flist->update_ctx == NULL) {
+		if (fts_backend_update_deinit(&update_ctx) < 0)
+			ret = -1;
+	}
+	return ret;
+}
+
 static int
 fts_transaction_commit(struct mailbox_transaction_context *t,
 		       struct mail_transaction_commit_changes *changes_r)
 {
 	struct fts_transaction_context *ft = FTS_CONTEXT_REQUIRE(t);
 	struct fts_mailbox *fbox = FTS_CONTEXT_REQUIRE(t->box);
+	struct fts_mailbox_list *flist = FTS_LIST_CONTEXT_REQUIRE(t->box->list);
 	struct mailbox *box = t->box;
+	pool_t capture_pool = NULL;
+	ARRAY_TYPE(fts_saved_mail) captured_mails = ARRAY_INIT;
 	bool autoindex;
-	int ret = 0;
+	int ret = 0, index_ret = 0;
 	const char *error;
 
 	autoindex = ft->mails_saved && !fbox->fts_mailbox_excluded &&
 		mail_user_plugin_getenv_bool(box->storage->user,
 					"fts_autoindex");
 
+	if (ft->capture_pool != NULL) {
+		/* keep the captured build streams alive past
+		   fts_transaction_end(), which frees ft */
+		capture_pool = ft->capture_pool;
+		captured_mails = ft->captured_mails;
+		ft->capture_pool = NULL;
+	}
+
 	if (fts_transaction_end(t, &error) < 0) {
 		mail_storage_set_error(t->box->storage, MAIL_ERROR_TEMP,
 				       t_strdup_printf("FTS transaction commit failed: %s",
@@ -729,10 +852,25 @@ fts_transaction_commit(struct mailbox_transaction_context *t,
 	}
 	if (fbox->module_ctx.super.transaction_commit(t, changes_r) < 0)
 		ret = -1;
-	if (ret < 0)
+	if (ret < 0) {
+		if (capture_pool != NULL)
+			pool_unref(&capture_pool);
 		return -1;
+	}
 
-	if (autoindex)
+	if (capture_pool != NULL) {
+		struct event_reason *reason = event_reason_begin("fts:index");
+		index_ret = fts_transaction_index_captured(box, &captured_mails,
+							   changes_r);
+		event_reason_end(&reason);
+		if (index_ret < 0) {
+			e_error(flist->backend->event,
+				"Indexing saved mails failed in %s - "
+				"leaving them to the indexer", box->vname);
+		}
+		pool_unref(&capture_pool);
+	}
+	if (autoindex && index_ret <= 0)
 		fts_queue_index(box);
 	return 0;
 }
@@ -792,6 +930,170 @@ static int fts_sync_deinit(struct mailbox_sync_context *ctx,
 	return ret;
 }
 
+struct fts_capture_backend {
+	struct fts_backend backend;
+	struct fts_transaction_context *ft;
+};
+
+struct fts_capture_update_context {
+	struct fts_backend_update_context ctx;
+	struct fts_transaction_context *ft;
+};
+
+static struct fts_backend_update_context *
+fts_capture_update_init(struct fts_backend *backend)
+{
+	struct fts_capture_backend *fcb =
+		container_of(backend, struct fts_capture_backend, backend);
+	struct fts_capture_update_context *ctx;
+
+	ctx = i_new(struct fts_capture_update_context, 1);
+	ctx->ctx.backend = backend;
+	ctx->ft = fcb->ft;
+	return &ctx->ctx;
+}
+
+static int fts_capture_update_deinit(struct fts_backend_update_context *_ctx)
+{
+	struct fts_capture_update_context *ctx =
+		container_of(_ctx, struct fts_capture_update_context, ctx);
+
+	i_free(ctx);
+	return 0;
+}
+
+static void
+fts_capture_update_set_mailbox(struct fts_backend_update_context *ctx ATTR_UNUSED,
+			       struct mailbox *box ATTR_UNUSED)
+{
+}
+
+static void
+fts_capture_update_expunge(struct fts_backend_update_context *ctx ATTR_UNUSED,
+			   uint32_t uid ATTR_UNUSED)
+{
+}
+
+static bool
+fts_capture_update_set_build_key(struct fts_backend_update_context *_ctx,
+				 const struct fts_backend_build_key *key)
+{
+	struct fts_capture_update_context *ctx =
+		container_of(_ctx, struct fts_capture_update_context, ctx);
+	struct fts_transaction_context *ft = ctx->ft;
+	struct fts_saved_build_part *part;
+	pool_t pool = ft->capture_pool;
+
+	part = array_append_space(&ft->cur_saved_mail->parts);
+	part->type = key->type;
+	part->hdr_name = p_strdup(pool, key->hdr_name);
+	part->body_content_type = p_strdup(pool, key->body_content_type);
+	part->body_content_disposition =
+		p_strdup(pool, key->body_content_disposition);
+	part->data = buffer_create_dynamic(pool, 1024);
+	ft->cur_part = part;
+	return TRUE;
+}
+
+static void
+fts_capture_update_unset_build_key(struct fts_backend_update_context *_ctx)
+{
+	struct fts_capture_update_context *ctx =
+		container_of(_ctx, struct fts_capture_update_context, ctx);
+
+	ctx->ft->cur_part = NULL;
+}
+
+static int
+fts_capture_update_build_more(struct fts_backend_update_context *_ctx,
+			      const unsigned char *data, size_t size)
+{
+	struct fts_capture_update_context *ctx =
+		container_of(_ctx, struct fts_capture_update_context, ctx);
+
+	buffer_append(ctx->ft->cur_part->data, data, size);
+	return 0;
+}
+
+static bool fts_want_index_during_save(struct mailbox *box)
+{
+	struct fts_mailbox *fbox = FTS_CONTEXT_REQUIRE(box);
+
+	return !fbox->fts_mailbox_excluded &&
+		mail_user_plugin_getenv_bool(box->storage->user,
+					     "fts_index_during_save");
+}
+
+static struct fts_saved_mail *
+fts_save_capture_begin(struct fts_transaction_context *ft,
+		       struct mailbox *box)
+{
+	struct fts_mailbox_list *flist = FTS_LIST_CONTEXT_REQUIRE(box->list);
+	struct fts_saved_mail *smail;
+
+	if (ft->capture_pool == NULL) {
+		struct fts_capture_backend *fcb;
+		pool_t pool;
+
+		pool = pool_alloconly_create(
+			MEMPOOL_GROWING"fts capture", 4096);
+		fcb = p_new(pool, struct fts_capture_backend, 1);
+		/* copy the real backend so fts_build_mail() sees the same
+		   flags, namespace and name, but capture all the update
+		   calls. The header filters are reinitialized so that lazy
+		   loading doesn't modify the real backend's arrays. */
+		fcb->backend = *flist->backend;
+		i_zero(&fcb->backend.v);
+		fcb->backend.v.update_init = fts_capture_update_init;
+		fcb->backend.v.update_deinit = fts_capture_update_deinit;
+		fcb->backend.v.update_set_mailbox = fts_capture_update_set_mailbox;
+		fcb->backend.v.update_expunge = fts_capture_update_expunge;
+		fcb->backend.v.update_set_build_key = fts_capture_update_set_build_key;
+		fcb->backend.v.update_unset_build_key = fts_capture_update_unset_build_key;
+		fcb->backend.v.update_build_more = fts_capture_update_build_more;
+		fcb->backend.updating = FALSE;
+		i_zero(&fcb->backend.header_filters);
+		fcb->backend.header_filters.pool = pool;
+		p_array_init(&fcb->backend.header_filters.includes, pool, 8);
+		p_array_init(&fcb->backend.header_filters.excludes, pool, 8);
+		fcb->ft = ft;
+
+		ft->capture_pool = pool;
+		p_array_init(&ft->captured_mails, pool, 8);
+		ft->capture_ctx = fts_backend_update_init(&fcb->backend);
+	}
+	smail = array_append_space(&ft->captured_mails);
+	p_array_init(&smail->parts, ft->capture_pool, 16);
+	return smail;
+}
+
+static void fts_save_capture_mail(struct mail_save_context *ctx)
+{
+	struct fts_transaction_context *ft = FTS_CONTEXT_REQUIRE(ctx->transaction);
+	struct mailbox *box = ctx->transaction->box;
+	struct fts_saved_mail *smail;
+
+	smail = fts_save_capture_begin(ft, box);
+	if (ctx->dest_mail == NULL) {
+		smail->failed = TRUE;
+		return;
+	}
+	T_BEGIN {
+		struct event_reason *reason =
+			event_reason_begin("fts:index");
+		fts_backend_update_set_mailbox(ft->capture_ctx, box);
+		ft->cur_saved_mail = smail;
+		if (fts_build_mail(ft->capture_ctx, ctx->dest_mail) < 0) {
+			/* the mail couldn't be read back at save time -
+			   leave it for autoindex/precache */
+			smail->failed = TRUE;
+		}
+		fts_backend_update_unset_build_key(ft->capture_ctx);
+		ft->cur_saved_mail = NULL;
+		event_reason_end(&reason);
+	} T_END;
+}
+
 static int fts_save_finish(struct mail_save_context *ctx)
 {
 	struct fts_transaction_context *ft = FTS_CONTEXT_REQUIRE(ctx->transaction);
@@ -800,6 +1102,8 @@ static int fts_save_finish(struct mail_save_context *ctx)
 	if (fbox->module_ctx.super.save_finish(ctx) < 0)
 		return -1;
 	ft->mails_saved = TRUE;
+	if (fts_want_index_during_save(ctx->transaction->box))
+		fts_save_capture_mail(ctx);
 	return 0;
 }
 
@@ -811,6 +1115,13 @@ static int fts_copy(struct mail_save_context *ctx, struct mail *mail)
 	if (fbox->module_ctx.super.copy(ctx, mail) < 0)
 		return -1;
 	ft->mails_saved = TRUE;
+	if (fts_want_index_during_save(ctx->transaction->box)) {
+		/* keep the saved UID <-> captured mail mapping aligned;
+		   copies aren't parsed, they're left for autoindex */
+		struct fts_saved_mail *smail =
+			fts_save_capture_begin(ft, ctx->transaction->box);
+		smail->failed = TRUE;
+	}
 	return 0;
 }
 
@@ -1,6 +1,7 @@
 /* Copyright (c) 2015-2018 Dovecot authors, see the included COPYING file */
 
 #include "lib.h"
+#include "hash.h"
 #include "module-context.h"
 #include "mail-user.h"
 #include "mail-storage-private.h"
@@ -15,6 +16,9 @@
 #define FTS_USER_CONTEXT_REQUIRE(obj) \
 	MODULE_CONTEXT_REQUIRE(obj, fts_user_module)
 
+/* Sender language cache isn't allowed to grow beyond this many senders. */
+#define FTS_SENDER_LANGS_MAX_COUNT 1000
+
 struct fts_user {
 	union mail_user_module_context module_ctx;
 	int refcount;
@@ -22,6 +26,7 @@ struct fts_user {
 	struct fts_language_list *lang_list;
 	struct fts_user_language *data_lang;
 	ARRAY_TYPE(fts_user_language) languages, data_languages;
+	HASH_TABLE(char *, const struct fts_language *) sender_langs;
 
 	struct mailbox_match_plugin *autoindex_exclude;
 };
@@ -342,6 +347,33 @@ struct fts_user_language *fts_user_get_data_lang(struct mail_user *user)
 	return fuser->data_lang;
 }
 
+const struct fts_language *
+fts_user_sender_language_get(struct mail_user *user, const char *sender)
+{
+	struct fts_user *fuser = FTS_USER_CONTEXT_REQUIRE(user);
+
+	if (!hash_table_is_created(fuser->sender_langs))
+		return NULL;
+	return hash_table_lookup(fuser->sender_langs, sender);
+}
+
+void fts_user_sender_language_set(struct mail_user *user, const char *sender,
+				  const struct fts_language *lang)
+{
+	struct fts_user *fuser = FTS_USER_CONTEXT_REQUIRE(user);
+
+	if (!hash_table_is_created(fuser->sender_langs)) {
+		hash_table_create(&fuser->sender_langs, user->pool, 0,
+				  str_hash, strcmp);
+	}
+	if (hash_table_lookup(fuser->sender_langs, sender) != NULL)
+		return;
+	if (hash_table_count(fuser->sender_langs) >= FTS_SENDER_LANGS_MAX_COUNT)
+		return;
+	hash_table_insert(fuser->sender_langs,
+			  p_strdup(user->pool, sender), lang);
+}
+
 bool fts_user_autoindex_exclude(struct mailbox *box)
 {
 	struct fts_user *fuser = FTS_USER_CONTEXT_REQUIRE(box->storage->user);
@@ -370,6 +402,8 @@ static void fts_user_free(struct fts_user *fuser)
 		array_foreach_elem(&fuser->languages, user_lang)
 			fts_user_language_free(user_lang);
 	}
+	if (hash_table_is_created(fuser->sender_langs))
+		hash_table_destroy(&fuser->sender_langs);
 	mailbox_match_plugin_deinit(&fuser->autoindex_exclude);
 }
 
@@ -18,6 +18,13 @@ struct fts_user_language *fts_user_get_data_lang(struct mail_user *user);
 const ARRAY_TYPE(fts_user_language) *
 fts_user_get_data_languages(struct mail_user *user);
 
+/* Cache of the detected language per sender address. Sender language is
+   normally stable, so repeated senders can skip language detection. */
+const struct fts_language *
+fts_user_sender_language_get(struct mail_user *user, const char *sender);
+void fts_user_sender_language_set(struct mail_user *user, const char *sender,
+				  const struct fts_language *lang);
+
 bool fts_user_autoindex_exclude(struct mailbox *box);
 
 int fts_mail_user_init(struct mail_user *user, bool initialize_libfts,
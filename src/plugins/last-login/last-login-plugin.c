@@ -2,6 +2,8 @@
 
 #include "lib.h"
 #include "ioloop.h"
+#include "hash.h"
+#include "str-parse.h"
 #include "dict.h"
 #include "mail-user.h"
 #include "mail-namespace.h"
@@ -25,6 +27,11 @@ const char *last_login_plugin_version = DOVECOT_ABI_VERSION;
 static MODULE_CONTEXT_DEFINE_INIT(last_login_user_module,
 				  &mail_user_module_register);
 
+/* username => time of the last dict write done by this process. Used with
+   last_login_min_interval to suppress repeated writes when the same process
+   handles many logins of the same user (e.g. LMTP deliveries). */
+static HASH_TABLE(char *, void *) last_login_times;
+
 static void last_login_dict_deinit(struct mail_user *user)
 {
 	struct last_login_user *luser = LAST_LOGIN_USER_CONTEXT(user);
@@ -79,7 +86,8 @@ static void last_login_mail_user_created(struct mail_user *user)
 	struct dict *dict;
 	struct dict_settings set;
 	struct dict_transaction_context *trans;
-	const char *dict_value, *key_name, *precision, *error;
+	const char *dict_value, *key_name, *precision, *value, *error;
+	unsigned int min_interval = 0;
 
 	if (user->autocreated) {
 		/* we want to handle only logged in users,
@@ -95,6 +103,28 @@ static void last_login_mail_user_created(struct mail_user *user)
 	if (dict_value == NULL || dict_value[0] == '\0')
 		return;
 
+	value = mail_user_plugin_getenv(user, "last_login_min_interval");
+	if (value != NULL &&
+	    str_parse_get_interval(value, &min_interval, &error) < 0) {
+		e_error(user->event,
+			"last_login_dict: Invalid last_login_min_interval '%s': %s",
+			value, error);
+		min_interval = 0;
+	}
+	if (min_interval > 0 && hash_table_is_created(last_login_times)) {
+		void *last_write =
+			hash_table_lookup(last_login_times, user->username);
+		if (last_write != NULL &&
+		    ioloop_time - (time_t)POINTER_CAST_TO(last_write, unsigned long) <
+			(time_t)min_interval) {
+			e_debug(user->event,
+				"last_login_dict: Skipping write - "
+				"last write was less than %u secs ago",
+				min_interval);
+			return;
+		}
+	}
+
 	i_zero(&set);
 	set.base_dir = user->set->base_dir;
 	set.event_parent = user->event;
@@ -145,6 +175,25 @@ static void last_login_mail_user_created(struct mail_user *user)
 			precision);
 	}
 	dict_transaction_commit_async(&trans, last_login_dict_commit, user);
+
+	if (min_interval > 0) {
+		char *orig_username;
+		void *old_value;
+
+		if (!hash_table_is_created(last_login_times)) {
+			hash_table_create(&last_login_times, default_pool, 0,
+					  str_hash, strcmp);
+		}
+		if (hash_table_lookup_full(last_login_times, user->username,
+					   &orig_username, &old_value)) {
+			hash_table_update(last_login_times, orig_username,
+					  POINTER_CAST(ioloop_time));
+		} else {
+			hash_table_insert(last_login_times,
+					  i_strdup(user->username),
+					  POINTER_CAST(ioloop_time));
+		}
+	}
 }
 
 static struct mail_storage_hooks last_login_mail_storage_hooks = {
@@ -159,4 +208,17 @@ void last_login_plugin_init(struct module *module)
 void last_login_plugin_deinit(void)
 {
 	mail_storage_hooks_remove(&last_login_mail_storage_hooks);
+
+	if (hash_table_is_created(last_login_times)) {
+		struct hash_iterate_context *iter;
+		char *username;
+		void *value;
+
+		iter = hash_table_iterate_init(last_login_times);
+		while (hash_table_iterate(iter, last_login_times,
+					  &username, &value))
+			i_free(username);
+		hash_table_iterate_deinit(&iter);
+		hash_table_destroy(&last_login_times);
+	}
 }
@@ -47,6 +47,9 @@ struct lazy_expunge_mail_user {
 	struct mailbox_match_plugin *excludes;
 	const char *lazy_mailbox_vname;
 	const char *env;
+	/* expunge mailbox cached between transactions, so repeated expunges
+	   don't have to open and sync it over and over again */
+	struct mailbox *cached_dest_box;
 	bool copy_only_last_instance;
 };
 
@@ -308,21 +311,36 @@ static void lazy_expunge_mail_expunge_move(struct mail *_mail)
 	const char *error;
 
 	if (lt->dest_box == NULL) {
-		lt->dest_box = mailbox_open_or_create(luser->lazy_ns->list,
-						      _mail->box, &error);
-		if (lt->dest_box == NULL) {
-			mail_set_critical(_mail,
-				"lazy_expunge: Couldn't open expunge mailbox: "
-				"%s", error);
-			lazy_expunge_set_error(lt, _mail->box->storage);
-			return;
-		}
-		if (mailbox_sync(lt->dest_box, 0) < 0) {
-			mail_set_critical(_mail,
-				"lazy_expunge: Couldn't sync expunge mailbox");
-			lazy_expunge_set_error(lt, lt->dest_box->storage);
-			mailbox_free(&lt->dest_box);
-			return;
+		const char *name =
+			get_dest_vname(luser->lazy_ns->list, _mail->box);
+
+		if (luser->cached_dest_box != NULL &&
+		    strcmp(mailbox_get_vname(luser->cached_dest_box),
+			   name) == 0) {
+			/* reuse the mailbox opened and synced by an earlier
+			   expunge transaction */
+			lt->dest_box = luser->cached_dest_box;
+			luser->cached_dest_box = NULL;
+		} else {
+			if (luser->cached_dest_box != NULL)
+				mailbox_free(&luser->cached_dest_box);
+			lt->dest_box =
+				mailbox_open_or_create(luser->lazy_ns->list,
+						       _mail->box, &error);
+			if (lt->dest_box == NULL) {
+				mail_set_critical(_mail,
+					"lazy_expunge: Couldn't open expunge mailbox: "
+					"%s", error);
+				lazy_expunge_set_error(lt, _mail->box->storage);
+				return;
+			}
+			if (mailbox_sync(lt->dest_box, 0) < 0) {
+				mail_set_critical(_mail,
+					"lazy_expunge: Couldn't sync expunge mailbox");
+				lazy_expunge_set_error(lt, lt->dest_box->storage);
+				mailbox_free(&lt->dest_box);
+				return;
+			}
 		}
 
 		lt->dest_trans = mailbox_transaction_begin(lt->dest_box,
@@ -435,8 +453,22 @@ static void lazy_expunge_transaction_free(struct lazy_expunge_transaction *lt)
 {
 	if (lt->dest_trans != NULL)
 		mailbox_transaction_rollback(&lt->dest_trans);
-	if (lt->dest_box != NULL)
-		mailbox_free(&lt->dest_box);
+	if (lt->dest_box != NULL) {
+		struct lazy_expunge_mail_user *luser =
+			LAZY_EXPUNGE_USER_CONTEXT_REQUIRE(
+				lt->dest_box->list->ns->user);
+
+		if (lt->delayed_error == MAIL_ERROR_NONE &&
+		    luser->cached_dest_box == NULL) {
+			/* cache the mailbox for the next transaction. if
+			   anything failed, reopen it the next time to be
+			   safe. */
+			luser->cached_dest_box = lt->dest_box;
+			lt->dest_box = NULL;
+		} else {
+			mailbox_free(&lt->dest_box);
+		}
+	}
 	hash_table_destroy(&lt->guids);
 	pool_unref(&lt->pool);
 	i_free(lt->delayed_errstr);
@@ -605,6 +637,8 @@ static void lazy_expunge_user_deinit(struct mail_user *user)
 {
 	struct lazy_expunge_mail_user *luser = LAZY_EXPUNGE_USER_CONTEXT_REQUIRE(user);
 
+	if (luser->cached_dest_box != NULL)
+		mailbox_free(&luser->cached_dest_box);
 	/* mail_namespaces_created hook isn't necessarily ever called */
 	if (luser->lazy_ns != NULL)
 		mail_namespace_unref(&luser->lazy_ns);
@@ -0,0 +1,249 @@
+/* Copyright (c) 2024 Dovecot authors, see the included COPYING file */
+
+#include "lib.h"
+#include "array.h"
+#include "buffer.h"
+#include "istream.h"
+#include "write-full.h"
+#include "mail-storage.h"
+#include "mail-search.h"
+#include "doveadm-mail.h"
+#include "doveadm-mailbox-list-iter.h"
+#include "doveadm-mail-iter.h"
+#include "doveadm-print.h"
+#include "mail-compress-plugin.h"
+
+#ifdef HAVE_ZSTD
+#  include "zstd.h"
+#  include "zdict.h"
+#endif
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sysexits.h>
+
+/* Same default maximum dictionary size as the zstd CLI uses */
+#define MAIL_COMPRESS_DICT_MAX_SIZE (110*1024)
+/* Only mails up to this size are used as training samples - the dictionary
+   is meant to help with small mails, which compress poorly on their own. */
+#define MAIL_COMPRESS_DICT_SAMPLE_MAX_SIZE (32*1024)
+/* Stop collecting samples after these limits are reached */
+#define MAIL_COMPRESS_DICT_SAMPLES_MAX 100000
+#define MAIL_COMPRESS_DICT_CORPUS_MAX_SIZE (64*1024*1024ULL)
+
+void doveadm_mail_compress_plugin_init(struct module *mod);
+void doveadm_mail_compress_plugin_deinit(void);
+
+struct compress_dict_cmd_context {
+	struct doveadm_mail_cmd_context ctx;
+
+	const char *dict_path;
+
+	/* training samples concatenated together, and their sizes */
+	buffer_t *corpus;
+	ARRAY(size_t) sample_sizes;
+};
+
+static bool
+cmd_compress_dict_train_have_space(struct compress_dict_cmd_context *ctx)
+{
+	return array_count(&ctx->sample_sizes) <
+		MAIL_COMPRESS_DICT_SAMPLES_MAX &&
+		ctx->corpus->used < MAIL_COMPRESS_DICT_CORPUS_MAX_SIZE;
+}
+
+static int
+cmd_compress_dict_train_box(struct compress_dict_cmd_context *ctx,
+			    const struct mailbox_info *info)
+{
+	struct doveadm_mail_iter *iter;
+	struct mail *mail;
+	struct istream *input;
+	const unsigned char *data;
+	size_t size, sample_size;
+	uoff_t psize;
+	int ret;
+
+	ret = doveadm_mail_iter_init(&ctx->ctx, info, ctx->ctx.search_args,
+				     0, NULL, DOVEADM_MAIL_ITER_FLAG_READONLY,
+				     &iter);
+	if (ret <= 0)
+		return ret;
+
+	while (doveadm_mail_iter_next(iter, &mail)) {
+		if (!cmd_compress_dict_train_have_space(ctx))
+			break;
+		if (mail_get_physical_size(mail, &psize) < 0) {
+			doveadm_mail_failed_mailbox(&ctx->ctx, mail->box);
+			continue;
+		}
+		if (psize == 0 || psize > MAIL_COMPRESS_DICT_SAMPLE_MAX_SIZE)
+			continue;
+		if (mail_get_stream(mail, NULL, NULL, &input) < 0) {
+			doveadm_mail_failed_mailbox(&ctx->ctx, mail->box);
+			continue;
+		}
+		size_t start = ctx->corpus->used;
+		while (i_stream_read_more(input, &data, &size) > 0) {
+			buffer_append(ctx->corpus, data, size);
+			i_stream_skip(input, size);
+		}
+		if (input->stream_errno != 0) {
+			buffer_set_used_size(ctx->corpus, start);
+			doveadm_mail_failed_mailbox(&ctx->ctx, mail->box);
+			continue;
+		}
+		sample_size = ctx->corpus->used - start;
+		if (sample_size == 0)
+			buffer_set_used_size(ctx->corpus, start);
+		else
+			array_push_back(&ctx->sample_sizes, &sample_size);
+	}
+	return doveadm_mail_iter_deinit_sync(&iter);
+}
+
+#ifdef HAVE_ZSTD
+static int
+cmd_compress_dict_train_write(struct compress_dict_cmd_context *ctx,
+			      const void *dict, size_t dict_size)
+{
+	int fd;
+
+	fd = open(ctx->dict_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (fd == -1) {
+		e_error(ctx->ctx.cctx->event, "creat(%s) failed: %m",
+			ctx->dict_path);
+		return -1;
+	}
+	if (write_full(fd, dict, dict_size) < 0) {
+		e_error(ctx->ctx.cctx->event, "write(%s) failed: %m",
+			ctx->dict_path);
+		i_close_fd(&fd);
+		i_unlink(ctx->dict_path);
+		return -1;
+	}
+	if (close(fd) < 0) {
+		e_error(ctx->ctx.cctx->event, "close(%s) failed: %m",
+			ctx->dict_path);
+		return -1;
+	}
+	return 0;
+}
+#endif
+
+static int
+cmd_compress_dict_train_run(struct doveadm_mail_cmd_context *_ctx,
+			    struct mail_user *user)
+{
+	struct compress_dict_cmd_context *ctx =
+		container_of(_ctx, struct compress_dict_cmd_context, ctx);
+	const enum mailbox_list_iter_flags iter_flags =
+		MAILBOX_LIST_ITER_NO_AUTO_BOXES |
+		MAILBOX_LIST_ITER_RETURN_NO_FLAGS;
+	struct doveadm_mailbox_list_iter *iter;
+	const struct mailbox_info *info;
+	int ret = 0;
+
+	ctx->corpus = buffer_create_dynamic(default_pool, 1024*1024);
+
+	iter = doveadm_mailbox_list_iter_init(_ctx, user, _ctx->search_args,
+					      iter_flags);
+	while ((info = doveadm_mailbox_list_iter_next(iter)) != NULL) T_BEGIN {
+		if (cmd_compress_dict_train_box(ctx, info) < 0)
+			ret = -1;
+	} T_END;
+	if (doveadm_mailbox_list_iter_deinit(&iter) < 0)
+		ret = -1;
+	if (ret < 0) {
+		buffer_free(&ctx->corpus);
+		return -1;
+	}
+
+#ifdef HAVE_ZSTD
+	unsigned int samples = array_count(&ctx->sample_sizes);
+
+	if (samples < 10) {
+		e_error(_ctx->cctx->event,
+			"Not enough sample mails for training a dictionary "
+			"(found %u, need at least 10)", samples);
+		_ctx->exit_code = EX_DATAERR;
+		buffer_free(&ctx->corpus);
+		return -1;
+	}
+
+	void *dict = i_malloc(MAIL_COMPRESS_DICT_MAX_SIZE);
+	size_t dict_size = ZDICT_trainFromBuffer(dict,
+			MAIL_COMPRESS_DICT_MAX_SIZE,
+			ctx->corpus->data, array_front(&ctx->sample_sizes),
+			samples);
+	if (ZDICT_isError(dict_size) != 0) {
+		e_error(_ctx->cctx->event, "Training dictionary failed: %s",
+			ZDICT_getErrorName(dict_size));
+		_ctx->exit_code = EX_DATAERR;
+		ret = -1;
+	} else if (cmd_compress_dict_train_write(ctx, dict, dict_size) < 0) {
+		_ctx->exit_code = EX_TEMPFAIL;
+		ret = -1;
+	} else {
+		doveadm_print(dec2str(samples));
+		doveadm_print(dec2str(dict_size));
+	}
+	i_free(dict);
+#else
+	e_error(_ctx->cctx->event, "zstd support not compiled in");
+	_ctx->exit_code = EX_UNAVAILABLE;
+	ret = -1;
+#endif
+	buffer_free(&ctx->corpus);
+	return ret;
+}
+
+static void cmd_compress_dict_train_init(struct doveadm_mail_cmd_context *_ctx)
+{
+	struct doveadm_cmd_context *cctx = _ctx->cctx;
+	struct compress_dict_cmd_context *ctx =
+		container_of(_ctx, struct compress_dict_cmd_context, ctx);
+	const char *const *query;
+
+	if (!doveadm_cmd_param_str(cctx, "dict-path", &ctx->dict_path))
+		doveadm_mail_help_name("compress dict-train");
+	if (!doveadm_cmd_param_array(cctx, "query", &query))
+		doveadm_mail_help_name("compress dict-train");
+
+	_ctx->search_args = doveadm_mail_build_search_args(query);
+	p_array_init(&ctx->sample_sizes, _ctx->pool, 1024);
+
+	doveadm_print_header_simple("samples");
+	doveadm_print_header_simple("dict_size");
+}
+
+static struct doveadm_mail_cmd_context *cmd_compress_dict_train_alloc(void)
+{
+	struct compress_dict_cmd_context *ctx;
+
+	ctx = doveadm_mail_cmd_alloc(struct compress_dict_cmd_context);
+	ctx->ctx.v.init = cmd_compress_dict_train_init;
+	ctx->ctx.v.run = cmd_compress_dict_train_run;
+	doveadm_print_init(DOVEADM_PRINT_TYPE_FLOW);
+	return &ctx->ctx;
+}
+
+static struct doveadm_cmd_ver2 doveadm_cmd_compress_dict_train = {
+	.name = "compress dict-train",
+	.mail_cmd = cmd_compress_dict_train_alloc,
+	.usage = DOVEADM_CMD_MAIL_USAGE_PREFIX "<dict path> <search query>",
+DOVEADM_CMD_PARAMS_START
+DOVEADM_CMD_MAIL_COMMON
+DOVEADM_CMD_PARAM('\0', "dict-path", CMD_PARAM_STR, CMD_PARAM_FLAG_POSITIONAL)
+DOVEADM_CMD_PARAM('\0', "query", CMD_PARAM_ARRAY, CMD_PARAM_FLAG_POSITIONAL)
+DOVEADM_CMD_PARAMS_END
+};
+
+void doveadm_mail_compress_plugin_init(struct module *mod ATTR_UNUSED)
+{
+	doveadm_cmd_register_ver2(&doveadm_cmd_compress_dict_train);
+}
+
+void doveadm_mail_compress_plugin_deinit(void)
+{
+}
@@ -44,6 +44,10 @@ struct mail_compress_user {
 
 	const struct compression_handler *save_handler;
 	int save_level;
+	unsigned int save_workers;
+
+	/* trained compression dictionary from mail_compress_dict, or NULL */
+	buffer_t *dict;
 };
 
 const char *mail_compress_plugin_version = DOVECOT_ABI_VERSION;
@@ -149,7 +153,12 @@ static int mail_compress_istream_opened(struct mail *_mail, struct istream **str
 		}
 
 		input = *stream;
-		*stream = handler->create_istream(input);
+		if (zuser->dict != NULL && handler->create_istream_dict != NULL) {
+			*stream = handler->create_istream_dict(input,
+				zuser->dict->data, zuser->dict->used);
+		} else {
+			*stream = handler->create_istream(input);
+		}
 		i_stream_unref(&input);
 		/* dont cache the stream if _mail->uid is 0 */
 		*stream = mail_compress_mail_cache_open(zuser, _mail, *stream,
@@ -233,8 +242,22 @@ mail_compress_mail_save_compress_begin(struct mail_save_context *ctx,
 	if (zbox->super.save_begin(ctx, input) < 0)
 		return -1;
 
-	output = zuser->save_handler->create_ostream(ctx->data.output,
-						     zuser->save_level);
+	if (zuser->save_workers > 0 &&
+	    zuser->save_handler->create_ostream_mt != NULL) {
+		output = zuser->save_handler->create_ostream_mt(
+			ctx->data.output, zuser->save_level,
+			zuser->dict == NULL ? NULL : zuser->dict->data,
+			zuser->dict == NULL ? 0 : zuser->dict->used,
+			zuser->save_workers);
+	} else if (zuser->dict != NULL &&
+		   zuser->save_handler->create_ostream_dict != NULL) {
+		output = zuser->save_handler->create_ostream_dict(
+			ctx->data.output, zuser->save_level,
+			zuser->dict->data, zuser->dict->used);
+	} else {
+		output = zuser->save_handler->create_ostream(ctx->data.output,
+							     zuser->save_level);
+	}
 	o_stream_unref(&ctx->data.output);
 	ctx->data.output = output;
 	o_stream_cork(ctx->data.output);
@@ -255,6 +278,7 @@ mail_compress_permail_alloc_init(struct mailbox *box, struct mailbox_vfuncs *v)
 
 static void mail_compress_mailbox_open_input(struct mailbox *box)
 {
+	struct mail_compress_user *zuser = MAIL_COMPRESS_USER_CONTEXT(box->storage->user);
 	const struct compression_handler *handler;
 	struct istream *input;
 	struct stat st;
@@ -280,7 +304,12 @@ static void mail_compress_mailbox_open_input(struct mailbox *box)
 		}
 		input = i_stream_create_fd_autoclose(&fd, MAX_INBUF_SIZE);
 		i_stream_set_name(input, box_path);
-		box->input = handler->create_istream(input);
+		if (zuser->dict != NULL && handler->create_istream_dict != NULL) {
+			box->input = handler->create_istream_dict(input,
+				zuser->dict->data, zuser->dict->used);
+		} else {
+			box->input = handler->create_istream(input);
+		}
 		i_stream_unref(&input);
 		box->flags |= MAILBOX_FLAG_READONLY;
 	}
@@ -330,9 +359,43 @@ static void mail_compress_mail_user_deinit(struct mail_user *user)
 	struct mail_compress_user *zuser = MAIL_COMPRESS_USER_CONTEXT(user);
 
 	mail_compress_mail_cache_close(zuser);
+	buffer_free(&zuser->dict);
 	zuser->module_ctx.super.deinit(user);
 }
 
+static int
+mail_compress_dict_read(struct mail_user *user, const char *path,
+			buffer_t **dict_r)
+{
+	struct istream *input;
+	const unsigned char *data;
+	size_t size;
+	buffer_t *dict;
+	int ret = 0;
+
+	input = i_stream_create_file(path, MAX_INBUF_SIZE);
+	dict = buffer_create_dynamic(default_pool, 16384);
+	while (i_stream_read_more(input, &data, &size) > 0) {
+		buffer_append(dict, data, size);
+		i_stream_skip(input, size);
+	}
+	if (input->stream_errno != 0) {
+		e_error(user->event, "mail_compress_dict: read(%s) failed: %s",
+			path, i_stream_get_error(input));
+		ret = -1;
+	} else if (dict->used == 0) {
+		e_error(user->event, "mail_compress_dict: %s is empty", path);
+		ret = -1;
+	}
+	i_stream_unref(&input);
+	if (ret < 0) {
+		buffer_free(&dict);
+		return -1;
+	}
+	*dict_r = dict;
+	return 0;
+}
+
 static void mail_compress_mail_user_created(struct mail_user *user)
 {
 	struct mail_user_vfuncs *v = user->vlast;
@@ -372,6 +435,22 @@ static void mail_compress_mail_user_created(struct mail_user *user)
 	} else if (zuser->save_handler != NULL) {
 		zuser->save_level = zuser->save_handler->get_default_level();
 	}
+	name = zuser->save_handler == NULL ? NULL :
+		mail_user_plugin_getenv(user, "mail_compress_save_workers");
+	if (name != NULL && name[0] != '\0') {
+		if (str_to_uint(name, &zuser->save_workers) < 0) {
+			e_error(user->event,
+				"mail_compress_save_workers: Invalid number: %s",
+				name);
+			zuser->save_workers = 0;
+		}
+	}
+	name = mail_user_plugin_getenv(user, "mail_compress_dict");
+	if (name != NULL && *name != '\0') {
+		/* errors are logged, but the dictionary is optional - mails
+		   saved without it are still readable. */
+		(void)mail_compress_dict_read(user, name, &zuser->dict);
+	}
 	MODULE_CONTEXT_SET(user, mail_compress_user_module, zuser);
 }
 
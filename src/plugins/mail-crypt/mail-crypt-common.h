@@ -21,6 +21,12 @@
         MAILBOX_ATTRIBUTE_PREFIX_DOVECOT_PVT_SERVER \
         MAILBOX_ATTRIBUTE_PREFIX_DOVECOT_PVT"crypt/"
 
+/* User-level LRU of mailboxes whose folder keys were used recently. It's
+   used for pre-warming the unwrapped key cache at session open when
+   mail_crypt_prewarm_keys is enabled. */
+#define MAIL_CRYPT_RECENT_BOXES_ATTRIBUTE USER_CRYPT_PREFIX"recent_boxes"
+#define MAIL_CRYPT_RECENT_BOXES_MAX 8
+
 #define MAIL_CRYPT_USERENV_PASSWORD "mail_crypt_private_password"
 #define MAIL_CRYPT_USERENV_KEY "mail_crypt_private_key"
 #define MAIL_CRYPT_USERENV_CURVE "mail_crypt_curve"
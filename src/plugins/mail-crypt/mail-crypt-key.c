@@ -292,6 +292,40 @@ int mail_crypt_decrypt_private_key(struct mailbox *box, const char *pubid,
 	return 1;
 }
 
+static void
+mail_crypt_note_recent_box(struct mail_crypt_user *muser, struct mailbox *box)
+{
+	struct mail_user *user =
+		mail_storage_get_user(mailbox_get_storage(box));
+	const char *vname = mailbox_get_vname(box);
+	char *const *names;
+	unsigned int i, count;
+	char *name;
+
+	if (!array_is_created(&muser->recent_boxes))
+		return;
+
+	names = array_get(&muser->recent_boxes, &count);
+	for (i = 0; i < count; i++) {
+		if (strcmp(names[i], vname) == 0)
+			break;
+	}
+	if (i == 0 && count > 0) {
+		/* already the most recent */
+		return;
+	}
+	if (i < count) {
+		name = names[i];
+		array_delete(&muser->recent_boxes, i, 1);
+	} else {
+		name = p_strdup(user->pool, vname);
+		if (count >= MAIL_CRYPT_RECENT_BOXES_MAX)
+			array_delete(&muser->recent_boxes, count - 1, 1);
+	}
+	array_insert(&muser->recent_boxes, 0, &name, 1);
+	muser->recent_boxes_changed = TRUE;
+}
+
 int mail_crypt_get_private_key(struct mailbox *box, const char *pubid,
 				bool user_key, bool shared,
 				struct dcrypt_private_key **key_r,
@@ -302,6 +336,8 @@ int mail_crypt_get_private_key(struct mailbox *box, const char *pubid,
 
 	/* check cache */
 	if (mail_crypt_get_key_cache(muser->key_cache, pubid, key_r, NULL) > 0) {
+		if (!user_key)
+			mail_crypt_note_recent_box(muser, box);
 		return 1;
 	}
 
@@ -332,6 +368,8 @@ int mail_crypt_get_private_key(struct mailbox *box, const char *pubid,
 	i_assert(key != NULL);
 
 	mail_crypt_put_key_cache(&muser->key_cache, pubid, key, NULL);
+	if (!user_key)
+		mail_crypt_note_recent_box(muser, box);
 
 	*key_r = key;
 
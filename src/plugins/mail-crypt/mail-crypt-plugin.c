@@ -5,6 +5,7 @@
    one cache. */
 
 #include "lib.h"
+#include "array.h"
 #include "ioloop.h"
 #include "randgen.h"
 #include "module-dir.h"
@@ -16,6 +17,8 @@
 #include "ostream.h"
 #include "ostream-encrypt.h"
 #include "mail-user.h"
+#include "mail-namespace.h"
+#include "mailbox-attribute.h"
 #include "mail-copy.h"
 #include "index-storage.h"
 #include "index-mail.h"
@@ -386,10 +389,157 @@ static void mail_crypt_mailbox_allocated(struct mailbox *box)
 	}
 }
 
+static void mail_crypt_prewarm_box(struct mail_user *user, const char *vname)
+{
+	struct mail_namespace *ns;
+	struct mailbox *box;
+	struct mail_attribute_value value;
+	struct dcrypt_private_key *key;
+	const char *error;
+	int ret;
+
+	ns = mail_namespace_find(user->namespaces, vname);
+	box = mailbox_alloc(ns->list, vname, MAILBOX_FLAG_READONLY);
+	if (mailbox_open(box) < 0) {
+		e_debug(user->event, "mail_crypt_plugin: "
+			"Pre-warm: mailbox_open(%s) failed: %s", vname,
+			mailbox_get_last_internal_error(box, NULL));
+		mailbox_free(&box);
+		return;
+	}
+	if (mailbox_attribute_get(box, MAIL_ATTRIBUTE_TYPE_SHARED,
+				  BOX_CRYPT_PREFIX ACTIVE_KEY_NAME,
+				  &value) <= 0) {
+		/* no folder key (anymore) */
+		mailbox_free(&box);
+		return;
+	}
+	if ((ret = mail_crypt_get_private_key(box, value.value, FALSE, FALSE,
+					      &key, &error)) < 0) {
+		e_debug(user->event, "mail_crypt_plugin: "
+			"Pre-warm: get_private_key(%s) failed: %s",
+			vname, error);
+	} else if (ret > 0) {
+		/* the key is now in the user's key cache */
+		dcrypt_key_unref_private(&key);
+	}
+	mailbox_free(&box);
+}
+
+static void
+mail_crypt_mail_namespaces_created(struct mail_namespace *namespaces)
+{
+	struct mail_user *user = namespaces->user;
+	struct mail_crypt_user *muser = MAIL_CRYPT_USER_CONTEXT(user);
+	struct mail_namespace *ns;
+	struct mailbox *box;
+	struct mail_attribute_value value;
+	unsigned int i, count;
+
+	if (muser == NULL || user->error != NULL ||
+	    !mail_user_plugin_getenv_bool(user, "mail_crypt_prewarm_keys"))
+		return;
+
+	p_array_init(&muser->recent_boxes, user->pool,
+		     MAIL_CRYPT_RECENT_BOXES_MAX);
+
+	ns = mail_namespace_find_inbox(namespaces);
+	box = mailbox_alloc(ns->list, "INBOX", MAILBOX_FLAG_READONLY);
+	if (mailbox_open(box) < 0) {
+		e_debug(user->event, "mail_crypt_plugin: "
+			"Pre-warm: mailbox_open(INBOX) failed: %s",
+			mailbox_get_last_internal_error(box, NULL));
+		mailbox_free(&box);
+		return;
+	}
+	if (mailbox_attribute_get(box, MAIL_ATTRIBUTE_TYPE_PRIVATE,
+				  MAIL_CRYPT_RECENT_BOXES_ATTRIBUTE,
+				  &value) > 0) {
+		const char *const *names = t_strsplit(value.value, "\t");
+
+		for (i = 0; names[i] != NULL &&
+			    i < MAIL_CRYPT_RECENT_BOXES_MAX; i++) {
+			char *name = p_strdup(user->pool, names[i]);
+			array_push_back(&muser->recent_boxes, &name);
+		}
+	}
+	mailbox_free(&box);
+
+	count = array_count(&muser->recent_boxes);
+	if (count == 0)
+		return;
+
+	const char **prewarm = t_new(const char *, count);
+	for (i = 0; i < count; i++)
+		prewarm[i] = t_strdup(array_idx_elem(&muser->recent_boxes, i));
+	/* Walk oldest-first: fetching a key moves the mailbox to the front
+	   of the LRU, so this preserves the stored order. */
+	for (i = count; i > 0; i--) T_BEGIN {
+		mail_crypt_prewarm_box(user, prewarm[i-1]);
+	} T_END;
+	/* the LRU still matches what was read from the attribute */
+	muser->recent_boxes_changed = FALSE;
+}
+
+static void
+mail_crypt_recent_boxes_save(struct mail_user *user,
+			     struct mail_crypt_user *muser)
+{
+	struct mail_namespace *ns;
+	struct mailbox *box;
+	struct mailbox_transaction_context *t;
+	struct mail_attribute_value value;
+	string_t *str;
+	char *const *namep;
+	int ret;
+
+	if (!array_is_created(&muser->recent_boxes) ||
+	    !muser->recent_boxes_changed)
+		return;
+	muser->recent_boxes_changed = FALSE;
+
+	str = t_str_new(128);
+	array_foreach(&muser->recent_boxes, namep) {
+		if (str_len(str) > 0)
+			str_append_c(str, '\t');
+		str_append(str, *namep);
+	}
+
+	ns = mail_namespace_find_inbox(user->namespaces);
+	box = mailbox_alloc(ns->list, "INBOX", 0);
+	if (mailbox_open(box) < 0) {
+		e_debug(user->event, "mail_crypt_plugin: "
+			"Saving recent mailbox list failed: "
+			"mailbox_open(INBOX) failed: %s",
+			mailbox_get_last_internal_error(box, NULL));
+		mailbox_free(&box);
+		return;
+	}
+
+	t = mailbox_transaction_begin(box, 0, __func__);
+	i_zero(&value);
+	value.value = str_c(str);
+	ret = mailbox_attribute_set(t, MAIL_ATTRIBUTE_TYPE_PRIVATE,
+				    MAIL_CRYPT_RECENT_BOXES_ATTRIBUTE, &value);
+	if (ret < 0)
+		mailbox_transaction_rollback(&t);
+	else
+		ret = mailbox_transaction_commit(&t);
+	if (ret < 0) {
+		e_debug(user->event, "mail_crypt_plugin: "
+			"Saving recent mailbox list failed: %s",
+			mailbox_get_last_internal_error(box, NULL));
+	}
+	mailbox_free(&box);
+}
+
 static void mail_crypt_mail_user_deinit(struct mail_user *user)
 {
 	struct mail_crypt_user *muser = MAIL_CRYPT_USER_CONTEXT_REQUIRE(user);
 
+	T_BEGIN {
+		mail_crypt_recent_boxes_save(user, muser);
+	} T_END;
 	mail_crypt_key_cache_destroy(&muser->key_cache);
 	mail_crypt_global_keys_free(&muser->global_keys);
 	mail_crypt_cache_close(muser);
@@ -452,6 +602,7 @@ static void mail_crypt_mail_user_created(struct mail_user *user)
 
 static struct mail_storage_hooks mail_crypt_mail_storage_hooks = {
 	.mail_user_created = mail_crypt_mail_user_created,
+	.mail_namespaces_created = mail_crypt_mail_namespaces_created,
 	.mail_allocated = mail_crypt_mail_allocated
 };
 
@@ -20,6 +20,11 @@ struct mail_crypt_user {
 	struct mail_crypt_key_cache_entry *key_cache;
 	const char *curve;
 	int save_version;
+
+	/* LRU of mailboxes whose folder keys were used, most recent first.
+	   Created only when mail_crypt_prewarm_keys is enabled. */
+	ARRAY(char *) recent_boxes;
+	bool recent_boxes_changed;
 };
 
 void mail_crypt_plugin_init(struct module *module);
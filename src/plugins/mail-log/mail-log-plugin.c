@@ -93,6 +93,11 @@ struct mail_log_message {
 struct mail_log_mail_txn_context {
 	pool_t pool;
 	struct event *event;
+	/* wanted fields/headers are the same for all the transaction's mails,
+	   so they're initialized once for the first logged mail. */
+	enum mail_fetch_field wanted_fields;
+	struct mailbox_header_lookup_ctx *wanted_headers;
+	bool wanted_fields_set;
 	struct mail_log_message *messages, *messages_tail;
 };
 
@@ -208,32 +213,36 @@ mail_log_append_uid(struct mail_log_mail_txn_context *ctx,
 }
 
 static void
-mail_log_update_wanted_fields(struct mail *mail, enum mail_log_field fields)
+mail_log_update_wanted_fields(struct mail_log_mail_txn_context *ctx,
+			      struct mail *mail, enum mail_log_field fields)
 {
-	enum mail_fetch_field wanted_fields = 0;
-	struct mailbox_header_lookup_ctx *wanted_headers = NULL;
 	const char *headers[4];
 	unsigned int hdr_idx = 0;
 
-	if ((fields & MAIL_LOG_FIELD_MSGID) != 0)
-		headers[hdr_idx++] = "Message-ID";
-	if ((fields & MAIL_LOG_FIELD_FROM) != 0)
-		headers[hdr_idx++] = "From";
-	if ((fields & MAIL_LOG_FIELD_SUBJECT) != 0)
-		headers[hdr_idx++] = "Subject";
-	if (hdr_idx > 0) {
-		i_assert(hdr_idx < N_ELEMENTS(headers));
-		headers[hdr_idx] = NULL;
-		wanted_headers = mailbox_header_lookup_init(mail->box, headers);
-	}
+	if (!ctx->wanted_fields_set) {
+		ctx->wanted_fields_set = TRUE;
+
+		if ((fields & MAIL_LOG_FIELD_MSGID) != 0)
+			headers[hdr_idx++] = "Message-ID";
+		if ((fields & MAIL_LOG_FIELD_FROM) != 0)
+			headers[hdr_idx++] = "From";
+		if ((fields & MAIL_LOG_FIELD_SUBJECT) != 0)
+			headers[hdr_idx++] = "Subject";
+		if (hdr_idx > 0) {
+			i_assert(hdr_idx < N_ELEMENTS(headers));
+			headers[hdr_idx] = NULL;
+			ctx->wanted_headers =
+				mailbox_header_lookup_init(mail->box, headers);
+		}
 
-	if ((fields & MAIL_LOG_FIELD_PSIZE) != 0)
-		wanted_fields |= MAIL_FETCH_PHYSICAL_SIZE;
-	if ((fields & MAIL_LOG_FIELD_VSIZE) != 0)
-		wanted_fields |= MAIL_FETCH_VIRTUAL_SIZE;
+		if ((fields & MAIL_LOG_FIELD_PSIZE) != 0)
+			ctx->wanted_fields |= MAIL_FETCH_PHYSICAL_SIZE;
+		if ((fields & MAIL_LOG_FIELD_VSIZE) != 0)
+			ctx->wanted_fields |= MAIL_FETCH_VIRTUAL_SIZE;
+	}
 
-	mail_add_temp_wanted_fields(mail, wanted_fields, wanted_headers);
-	mailbox_header_lookup_unref(&wanted_headers);
+	mail_add_temp_wanted_fields(mail, ctx->wanted_fields,
+				    ctx->wanted_headers);
 }
 
 static void
@@ -250,7 +259,7 @@ mail_log_append_mail_message_real(struct mail_log_mail_txn_context *ctx,
 	msg = p_new(ctx->pool, struct mail_log_message, 1);
 
 	/* avoid parsing through the message multiple times */
-	mail_log_update_wanted_fields(mail, muser->fields);
+	mail_log_update_wanted_fields(ctx, mail, muser->fields);
 
 	text = t_str_new(128);
 	str_append(text, desc);
@@ -467,6 +476,7 @@ mail_log_mail_transaction_commit(void *txn,
 	}
 	i_assert(!seq_range_array_iter_nth(&iter, n, &uid));
 
+	mailbox_header_lookup_unref(&ctx->wanted_headers);
 	event_unref(&ctx->event);
 	pool_unref(&ctx->pool);
 }
@@ -476,6 +486,7 @@ static void mail_log_mail_transaction_rollback(void *txn)
 	struct mail_log_mail_txn_context *ctx =
 		(struct mail_log_mail_txn_context *)txn;
 
+	mailbox_header_lookup_unref(&ctx->wanted_headers);
 	event_unref(&ctx->event);
 	pool_unref(&ctx->pool);
 }
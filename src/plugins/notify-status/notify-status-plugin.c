@@ -2,8 +2,10 @@
 
 #include "lib.h"
 #include "array.h"
+#include "ioloop.h"
 #include "json-parser.h"
 #include "str.h"
+#include "str-parse.h"
 #include "var-expand.h"
 #include "mail-user.h"
 #include "mail-storage.h"
@@ -17,6 +19,7 @@
 #define NOTIFY_STATUS_SETTING_DICT_URI "notify_status_dict"
 #define NOTIFY_STATUS_SETTING_MAILBOX_PREFIX "notify_status_mailbox"
 #define NOTIFY_STATUS_SETTING_VALUE_TEMPLATE "notify_status_value"
+#define NOTIFY_STATUS_SETTING_FLUSH_DELAY "notify_status_flush_delay"
 #define NOTIFY_STATUS_SETTING_VALUE_TEMPLATE_DEFAULT "{\"messages\":%{messages},\"unseen\":%{unseen}}"
 #define NOTIFY_STATUS_KEY "priv/status/%s"
 
@@ -46,6 +49,13 @@ struct notify_status_user {
 	struct dict *dict;
 	const char *value_template;
 	struct notify_context *context;
+
+	/* With notify_status_flush_delay, mailboxes changed by transactions
+	   are only marked dirty here and all their statuses are written in
+	   one dict transaction when the delay elapses. */
+	unsigned int flush_delay_msecs;
+	ARRAY(char *) dirty_boxes;
+	struct timeout *to_flush;
 };
 
 static int notify_status_dict_init(struct mail_user *user, const char *uri,
@@ -125,18 +135,15 @@ static void notify_update_callback(const struct dict_commit_result *result,
 			       STATUS_UIDVALIDITY|\
 			       STATUS_HIGHESTMODSEQ|STATUS_FIRST_RECENT_UID|\
 			       STATUS_HIGHESTPVTMODSEQ)
-static void notify_update_mailbox_status(struct mailbox *box)
+static bool
+notify_update_mailbox_status_trans(struct dict_transaction_context *t,
+				   struct mailbox *box)
 {
 	struct mail_user *user = mail_storage_get_user(mailbox_get_storage(box));
 	struct notify_status_user *nuser = NOTIFY_STATUS_USER_CONTEXT(user);
 	i_assert(nuser != NULL);
-	struct dict_transaction_context *t;
 	struct mailbox_status status;
-
-	e_debug(box->event, "notify-status: Updating mailbox status");
-
-	box = mailbox_alloc(mailbox_get_namespace(box)->list,
-			   mailbox_get_vname(box), MAILBOX_FLAG_READONLY);
+	bool updated = FALSE;
 
 	if (mailbox_open(box) < 0) {
 		e_error(box->event, "notify-status: mailbox_open() failed: %s",
@@ -175,17 +182,114 @@ static void notify_update_mailbox_status(struct mailbox *box)
 			e_error(box->event, "notify-status: var_expand(%s) failed: %s",
 				nuser->value_template, error);
 		} else {
-			const struct dict_op_settings *set = mail_user_get_dict_op_settings(user);
-			t = dict_transaction_begin(nuser->dict, set);
 			dict_set(t, key, str_c(dest));
-			dict_transaction_commit_async(&t, notify_update_callback,
-						      event_create(box->event));
+			updated = TRUE;
 		}
 	}
+	return updated;
+}
+
+static void notify_update_mailbox_status(struct mailbox *box)
+{
+	struct mail_user *user = mail_storage_get_user(mailbox_get_storage(box));
+	struct notify_status_user *nuser = NOTIFY_STATUS_USER_CONTEXT(user);
+	i_assert(nuser != NULL);
+	struct dict_transaction_context *t;
+
+	e_debug(box->event, "notify-status: Updating mailbox status");
+
+	box = mailbox_alloc(mailbox_get_namespace(box)->list,
+			   mailbox_get_vname(box), MAILBOX_FLAG_READONLY);
+
+	const struct dict_op_settings *set = mail_user_get_dict_op_settings(user);
+	t = dict_transaction_begin(nuser->dict, set);
+	if (notify_update_mailbox_status_trans(t, box)) {
+		dict_transaction_commit_async(&t, notify_update_callback,
+					      event_create(box->event));
+	} else {
+		dict_transaction_rollback(&t);
+	}
 
 	mailbox_free(&box);
 }
 
+static void notify_status_flush(struct mail_user *user)
+{
+	struct notify_status_user *nuser = NOTIFY_STATUS_USER_CONTEXT(user);
+	i_assert(nuser != NULL);
+	struct dict_transaction_context *t;
+	bool updated = FALSE;
+	char *vname;
+
+	timeout_remove(&nuser->to_flush);
+
+	const struct dict_op_settings *set = mail_user_get_dict_op_settings(user);
+	t = dict_transaction_begin(nuser->dict, set);
+	array_foreach_elem(&nuser->dirty_boxes, vname) T_BEGIN {
+		struct mail_namespace *ns =
+			mail_namespace_find(user->namespaces, vname);
+		struct mailbox *box =
+			mailbox_alloc(ns->list, vname, MAILBOX_FLAG_READONLY);
+
+		e_debug(box->event, "notify-status: Updating mailbox status");
+		if (notify_update_mailbox_status_trans(t, box))
+			updated = TRUE;
+		mailbox_free(&box);
+		i_free(vname);
+	} T_END;
+	array_clear(&nuser->dirty_boxes);
+
+	if (updated) {
+		dict_transaction_commit_async(&t, notify_update_callback,
+					      event_create(user->event));
+	} else {
+		dict_transaction_rollback(&t);
+	}
+}
+
+static void notify_status_mailbox_changed(struct mailbox *box)
+{
+	struct mail_user *user = mail_storage_get_user(mailbox_get_storage(box));
+	struct notify_status_user *nuser = NOTIFY_STATUS_USER_CONTEXT(user);
+	i_assert(nuser != NULL);
+	const char *vname = mailbox_get_vname(box);
+	char *dirty_vname;
+
+	if (nuser->flush_delay_msecs == 0) {
+		notify_update_mailbox_status(box);
+		return;
+	}
+
+	array_foreach_elem(&nuser->dirty_boxes, dirty_vname) {
+		if (strcmp(dirty_vname, vname) == 0)
+			return;
+	}
+	dirty_vname = i_strdup(vname);
+	array_push_back(&nuser->dirty_boxes, &dirty_vname);
+	if (nuser->to_flush == NULL) {
+		nuser->to_flush = timeout_add(nuser->flush_delay_msecs,
+					      notify_status_flush, user);
+	}
+}
+
+static void
+notify_status_drop_dirty(struct notify_status_user *nuser, const char *vname)
+{
+	char **vnames;
+	unsigned int i, count;
+
+	vnames = array_get_modifiable(&nuser->dirty_boxes, &count);
+	for (i = 0; i < count; i++) {
+		if (strcmp(vnames[i], vname) == 0) {
+			i_free(vnames[i]);
+			array_delete(&nuser->dirty_boxes, i, 1);
+			break;
+		}
+	}
+	if (array_count(&nuser->dirty_boxes) == 0)
+		timeout_remove(&nuser->to_flush);
+}
+
 static void notify_remove_mailbox_status(struct mailbox *box)
 {
 	struct mail_user *user = mail_storage_get_user(mailbox_get_storage(box));
@@ -195,6 +299,9 @@ static void notify_remove_mailbox_status(struct mailbox *box)
 
 	e_debug(box->event, "notify-status: Removing mailbox status");
 
+	/* don't let a pending flush recreate the status afterwards */
+	notify_status_drop_dirty(nuser, mailbox_get_vname(box));
+
 	const char *key =
 		t_strdup_printf(NOTIFY_STATUS_KEY, mailbox_get_vname(box));
 
@@ -218,7 +325,7 @@ notify_status_mail_transaction_commit(void *t,
 {
 	struct notify_status_mail_txn *txn = (struct notify_status_mail_txn *)t;
 	if (txn->changed && notify_status_mailbox_enabled(txn->box))
-		notify_update_mailbox_status(txn->box);
+		notify_status_mailbox_changed(txn->box);
 	i_free(txn);
 }
 
@@ -293,6 +400,8 @@ static void notify_status_mail_user_deinit(struct mail_user *user)
 	struct notify_status_user *nuser = NOTIFY_STATUS_USER_CONTEXT(user);
 	i_assert(nuser != NULL);
 
+	if (nuser->to_flush != NULL)
+		notify_status_flush(user);
 	dict_wait(nuser->dict);
 	dict_deinit(&nuser->dict);
 	notify_unregister(&nuser->context);
@@ -307,6 +416,8 @@ static void notify_status_mail_user_created(struct mail_user *user)
 	const char *error;
 	const char *template = mail_user_plugin_getenv(user, NOTIFY_STATUS_SETTING_VALUE_TEMPLATE);
 	const char *uri = mail_user_plugin_getenv(user, NOTIFY_STATUS_SETTING_DICT_URI);
+	const char *delay_value = mail_user_plugin_getenv(user, NOTIFY_STATUS_SETTING_FLUSH_DELAY);
+	unsigned int flush_delay_msecs = 0;
 
 	if (user->autocreated)
 		return;
@@ -320,6 +431,15 @@ static void notify_status_mail_user_created(struct mail_user *user)
 	if (template == NULL || *template == '\0')
 		template = NOTIFY_STATUS_SETTING_VALUE_TEMPLATE_DEFAULT;
 
+	if (delay_value != NULL &&
+	    str_parse_get_interval_msecs(delay_value, &flush_delay_msecs,
+					 &error) < 0) {
+		e_error(user->event, "notify-status: Invalid "
+			NOTIFY_STATUS_SETTING_FLUSH_DELAY" '%s': %s",
+			delay_value, error);
+		flush_delay_msecs = 0;
+	}
+
 	if (notify_status_dict_init(user, uri, &dict, &error) < 0) {
 		e_error(user->event, "notify-status: %s", error);
 		return;
@@ -332,6 +452,8 @@ static void notify_status_mail_user_created(struct mail_user *user)
 	v->deinit = notify_status_mail_user_deinit;
 	/* either static value or lifetime is user object's lifetime */
 	nuser->value_template = template;
+	nuser->flush_delay_msecs = flush_delay_msecs;
+	p_array_init(&nuser->dirty_boxes, user->pool, 4);
 
 	MODULE_CONTEXT_SET(user, notify_status_user_module, nuser);
 }
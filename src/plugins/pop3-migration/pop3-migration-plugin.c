@@ -27,6 +27,9 @@ struct msg_map_common {
 	/* sha1(header) - set only when needed */
 	unsigned char hdr_sha1[SHA1_RESULTLEN];
 	bool hdr_sha1_set:1;
+	/* the mail was already matched by cached UIDL or size, so its
+	   header hash isn't needed */
+	bool matched:1;
 };
 
 struct pop3_uidl_map {
@@ -381,9 +384,11 @@ static int pop3_map_read(struct mail_storage *storage, struct mailbox *pop3_box)
 	int ret = 0;
 
 	if (array_is_created(&mstorage->pop3_uidl_map)) {
-		/* already read these, just reset the imap_uids */
-		array_foreach_modifiable(&mstorage->pop3_uidl_map, map)
+		/* already read these, just reset the matches */
+		array_foreach_modifiable(&mstorage->pop3_uidl_map, map) {
 			map->imap_uid = 0;
+			map->common.matched = FALSE;
+		}
 		return 0;
 	}
 	i_array_init(&mstorage->pop3_uidl_map, 128);
@@ -466,6 +471,8 @@ pop3_map_read_cached_hdr_hashes(struct mailbox_transaction_context *t,
 	while (mailbox_search_next(ctx, &mail)) {
 		map = array_idx_modifiable_i(msg_map, mail->seq-1);
 
+		if (map->matched)
+			continue;
 		if (get_cached_hdr_sha1(mail, cache_buf, map->hdr_sha1))
 			map->hdr_sha1_set = TRUE;
 	}
@@ -487,7 +494,7 @@ static void map_remove_found_seqs(struct mail_search_arg *search_arg,
 
 	for (seq = seq1; seq <= count; seq++) {
 		map = array_idx_i(msg_map, seq-1);
-		if (map->hdr_sha1_set)
+		if (map->hdr_sha1_set || map->matched)
 			seq_range_array_remove(&search_arg->value.seqset, seq);
 	}
 }
@@ -539,7 +546,7 @@ map_read_hdr_hashes(struct mailbox *box, struct array *msg_map, uint32_t seq1)
 
 static int
 pop3_map_read_hdr_hashes(struct mail_storage *storage, struct mailbox *pop3_box,
-			 unsigned int first_seq)
+			 unsigned int first_seq, bool have_matched)
 {
 	struct pop3_migration_mail_storage *mstorage =
 		POP3_MIGRATION_CONTEXT_REQUIRE(storage);
@@ -556,7 +563,9 @@ pop3_map_read_hdr_hashes(struct mail_storage *storage, struct mailbox *pop3_box,
 				first_seq) < 0)
 		return -1;
 
-	if (first_seq == 1)
+	/* if some mails were already matched, their hashes were skipped
+	   and not all of them are set now */
+	if (first_seq == 1 && !have_matched)
 		mstorage->pop3_all_hdr_sha1_set = TRUE;
 	return 0;
 }
@@ -728,10 +737,31 @@ pop3_uidl_assign_by_hdr_hash(struct mailbox *box, struct mailbox *pop3_box)
 	unsigned int pop3_idx, imap_idx, pop3_count, imap_count;
 	unsigned int first_seq, missing_uids_count;
 	uint32_t first_missing_idx = 0, first_missing_seq = (uint32_t)-1;
+	bool have_matched = FALSE;
 	int ret;
 
+	/* mails that were already matched by cached UIDLs or sizes are
+	   skipped in the matching loop below, so don't waste time reading
+	   their header hashes. with all_mailboxes the POP3 hashes may still
+	   be needed for matching the other mailboxes, so read them all. */
+	pop3_map = array_get_modifiable(&mstorage->pop3_uidl_map, &pop3_count);
+	imap_map = array_get_modifiable(&mbox->imap_msg_map, &imap_count);
+	if (!mstorage->all_mailboxes) {
+		for (pop3_idx = 0; pop3_idx < pop3_count; pop3_idx++) {
+			if (pop3_map[pop3_idx].imap_uid != 0) {
+				pop3_map[pop3_idx].common.matched = TRUE;
+				have_matched = TRUE;
+			}
+		}
+	}
+	for (imap_idx = 0; imap_idx < imap_count; imap_idx++) {
+		if (imap_map[imap_idx].pop3_uidl != NULL)
+			imap_map[imap_idx].common.matched = TRUE;
+	}
+
 	first_seq = mbox->first_unfound_idx+1;
-	if (pop3_map_read_hdr_hashes(box->storage, pop3_box, first_seq) < 0 ||
+	if (pop3_map_read_hdr_hashes(box->storage, pop3_box, first_seq,
+				     have_matched) < 0 ||
 	    imap_map_read_hdr_hashes(box) < 0)
 		return -1;
 
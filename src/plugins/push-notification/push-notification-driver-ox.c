@@ -54,6 +54,14 @@ struct push_notification_driver_ox_config {
 /* This is data specific to an OX driver transaction. */
 struct push_notification_driver_ox_txn {
 	const char *unsafe_user;
+
+	/* Mailbox status shared by all the messages in this transaction.
+	   It's looked up only for the first message, since the lookup syncs
+	   a new instance of the mailbox and therefore already sees all the
+	   mails saved within this transaction. */
+	struct mailbox_status box_status;
+	bool box_status_looked_up;
+	bool box_status_success;
 };
 
 static void
@@ -369,18 +377,18 @@ push_notification_driver_ox_process_msg(
 	struct push_notification_driver_ox_txn *txn =
 		(struct push_notification_driver_ox_txn *)dtxn->context;
 	struct mail_user *user = dtxn->ptxn->muser;
-	struct mailbox_status box_status;
-	bool status_success = TRUE;
-
-	if (push_notification_driver_ox_get_mailbox_status(
-		dtxn, &box_status) < 0) {
-		status_success = FALSE;
-	}
 
 	messagenew = push_notification_txn_msg_get_eventdata(msg, "MessageNew");
 	if (messagenew == NULL)
 		return;
 
+	if (!txn->box_status_looked_up) {
+		txn->box_status_looked_up = TRUE;
+		txn->box_status_success =
+			push_notification_driver_ox_get_mailbox_status(
+				dtxn, &txn->box_status) == 0;
+	}
+
 	push_notification_driver_ox_init_global(user, dconfig);
 
 	http_req = http_client_request_url(
@@ -413,8 +421,8 @@ push_notification_driver_ox_process_msg(
 		json_append_escaped(str, messagenew->snippet);
 		str_append(str, "\"");
 	}
-	if (status_success) {
-		str_printfa(str, ",\"unseen\":%u", box_status.unseen);
+	if (txn->box_status_success) {
+		str_printfa(str, ",\"unseen\":%u", txn->box_status.unseen);
 	}
 	str_append(str, "}");
 
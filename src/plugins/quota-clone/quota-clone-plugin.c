@@ -2,6 +2,7 @@
 
 #include "lib.h"
 #include "module-context.h"
+#include "str-parse.h"
 #include "ioloop.h"
 #include "dict.h"
 #include "mail-storage-private.h"
@@ -9,7 +10,7 @@
 #include "quota-clone-plugin.h"
 
 /* If mailbox is kept open for this many milliseconds after quota update,
-   flush quota-clone. */
+   flush quota-clone. This is the default for quota_clone_flush_delay. */
 #define QUOTA_CLONE_FLUSH_DELAY_MSECS (10*1000)
 
 #define DICT_QUOTA_CLONE_PATH DICT_PATH_PRIVATE"quota/"
@@ -31,6 +32,7 @@ static MODULE_CONTEXT_DEFINE_INIT(quota_clone_storage_module,
 struct quota_clone_user {
 	union mail_user_module_context module_ctx;
 	struct dict *dict;
+	unsigned int flush_delay_msecs;
 	struct timeout *to_quota_flush;
 	bool quota_changed;
 	bool quota_flushing;
@@ -178,7 +180,7 @@ static void quota_clone_changed(struct mailbox *box)
 
 	quser->quota_changed = TRUE;
 	if (quser->to_quota_flush == NULL) {
-		quser->to_quota_flush = timeout_add(QUOTA_CLONE_FLUSH_DELAY_MSECS,
+		quser->to_quota_flush = timeout_add(quser->flush_delay_msecs,
 						    quota_clone_flush, user);
 	}
 }
@@ -272,7 +274,8 @@ static void quota_clone_mail_user_created(struct mail_user *user)
 	struct mail_user_vfuncs *v = user->vlast;
 	struct dict_settings dict_set;
 	struct dict *dict;
-	const char *uri, *error;
+	unsigned int flush_delay_msecs = QUOTA_CLONE_FLUSH_DELAY_MSECS;
+	const char *uri, *value, *error;
 
 	uri = mail_user_plugin_getenv(user, "quota_clone_dict");
 	if (uri == NULL || uri[0] == '\0') {
@@ -280,6 +283,15 @@ static void quota_clone_mail_user_created(struct mail_user *user)
 		return;
 	}
 
+	value = mail_user_plugin_getenv(user, "quota_clone_flush_delay");
+	if (value != NULL &&
+	    str_parse_get_interval_msecs(value, &flush_delay_msecs, &error) < 0) {
+		e_error(user->event,
+			"quota_clone_flush_delay: Invalid value '%s': %s - "
+			"using default", value, error);
+		flush_delay_msecs = QUOTA_CLONE_FLUSH_DELAY_MSECS;
+	}
+
 	i_zero(&dict_set);
 	dict_set.base_dir = user->set->base_dir;
 	dict_set.event_parent = user->event;
@@ -295,6 +307,7 @@ static void quota_clone_mail_user_created(struct mail_user *user)
 	v->deinit_pre = quota_clone_mail_user_deinit_pre;
 	v->deinit = quota_clone_mail_user_deinit;
 	quser->dict = dict;
+	quser->flush_delay_msecs = flush_delay_msecs;
 	quser->unset = mail_user_plugin_getenv_bool(user, "quota_clone_unset");
 	MODULE_CONTEXT_SET(user, quota_clone_user_module, quser);
 }
@@ -8,6 +8,11 @@
 struct count_quota_root {
 	struct quota_root root;
 
+	const char *cache_secs_str;
+	/* reuse the counted totals for this many seconds. in between, quota
+	   updates are applied directly to the cached values. */
+	unsigned int cache_secs;
+
 	struct timeval cache_timeval;
 	uint64_t cached_bytes, cached_count;
 };
@@ -199,6 +204,21 @@ int quota_count(struct quota_root *root, uint64_t *bytes_r, uint64_t *count_r,
 	return ret;
 }
 
+static bool quota_count_cache_is_valid(struct count_quota_root *root)
+{
+	if (root->cache_timeval.tv_sec == 0)
+		return FALSE;
+	if (root->cache_timeval.tv_usec == ioloop_timeval.tv_usec &&
+	    root->cache_timeval.tv_sec == ioloop_timeval.tv_sec)
+		return TRUE;
+	/* with cache_secs the counted totals are revalidated only lazily.
+	   our own changes are applied to the cached values by update(), so
+	   the revalidation is needed only to catch changes made by other
+	   processes. */
+	return ioloop_timeval.tv_sec - root->cache_timeval.tv_sec <
+		(time_t)root->cache_secs;
+}
+
 static enum quota_get_result
 quota_count_cached(struct count_quota_root *root,
 		   uint64_t *bytes_r, uint64_t *count_r,
@@ -206,9 +226,7 @@ quota_count_cached(struct count_quota_root *root,
 {
 	int ret;
 
-	if (root->cache_timeval.tv_usec == ioloop_timeval.tv_usec &&
-	    root->cache_timeval.tv_sec == ioloop_timeval.tv_sec &&
-	    ioloop_timeval.tv_sec != 0) {
+	if (quota_count_cache_is_valid(root)) {
 		*bytes_r = root->cached_bytes;
 		*count_r = root->cached_count;
 		return QUOTA_GET_RESULT_LIMITED;
@@ -234,13 +252,40 @@ static struct quota_root *count_quota_alloc(void)
 	return &root->root;
 }
 
+static void count_cache_secs_param_handler(struct quota_root *_root,
+					   const char *param_value)
+{
+	struct count_quota_root *root = (struct count_quota_root *)_root;
+
+	root->cache_secs_str = p_strdup(_root->pool, param_value);
+}
+
 static int count_quota_init(struct quota_root *root, const char *args,
 			    const char **error_r)
 {
+	struct count_quota_root *croot = (struct count_quota_root *)root;
+	const struct quota_param_parser count_params[] = {
+		{.param_name = "cache_secs=",
+		 .param_handler = count_cache_secs_param_handler},
+		quota_param_hidden,
+		quota_param_ignoreunlimited,
+		quota_param_noenforcing,
+		quota_param_ns,
+		{.param_name = NULL}
+	};
+
 	event_set_append_log_prefix(root->backend.event, "quota-count: ");
 
 	root->auto_updating = TRUE;
-	return quota_root_default_init(root, args, error_r);
+	if (quota_parse_parameters(root, &args, error_r, count_params, TRUE) < 0)
+		return -1;
+	if (croot->cache_secs_str != NULL &&
+	    str_to_uint(croot->cache_secs_str, &croot->cache_secs) < 0) {
+		*error_r = t_strdup_printf("Invalid cache_secs value: %s",
+					   croot->cache_secs_str);
+		return -1;
+	}
+	return 0;
 }
 
 static void count_quota_deinit(struct quota_root *_root)
@@ -371,10 +416,32 @@ count_quota_update(struct quota_root *root,
 {
 	struct count_quota_root *croot = (struct count_quota_root *)root;
 
-	croot->cache_timeval.tv_sec = 0;
 	if (ctx->recalculate == QUOTA_RECALCULATE_FORCED) {
+		croot->cache_timeval.tv_sec = 0;
 		if (quota_count_recalculate(root, error_r) < 0)
 			return -1;
+	} else if (croot->cache_secs == 0 || ctx->auto_updating ||
+		   ctx->recalculate != QUOTA_RECALCULATE_DONT) {
+		/* the transaction didn't track the changed mails' sizes
+		   (or some sizes are missing), so the cached totals can't be
+		   updated with a diff. */
+		croot->cache_timeval.tv_sec = 0;
+	} else if (croot->cache_timeval.tv_sec != 0) {
+		/* apply our own changes to the cached totals. keep the
+		   original timestamp, so changes made by other processes
+		   still get noticed within cache_secs of the counting. */
+		if (ctx->bytes_used >= 0)
+			croot->cached_bytes += ctx->bytes_used;
+		else if (croot->cached_bytes < (uint64_t)-ctx->bytes_used)
+			croot->cached_bytes = 0;
+		else
+			croot->cached_bytes -= (uint64_t)-ctx->bytes_used;
+		if (ctx->count_used >= 0)
+			croot->cached_count += ctx->count_used;
+		else if (croot->cached_count < (uint64_t)-ctx->count_used)
+			croot->cached_count = 0;
+		else
+			croot->cached_count -= (uint64_t)-ctx->count_used;
 	}
 	return 0;
 }
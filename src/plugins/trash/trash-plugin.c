@@ -53,6 +53,14 @@ static enum quota_alloc_result (*trash_next_quota_test_alloc)(
 static int trash_clean_mailbox_open(struct trash_mailbox *trash)
 {
 	struct mail_search_args *search_args;
+	/* Return the mails oldest first. The sorting is done with the
+	   received dates already in the index cache, and it lets the
+	   cross-mailbox merging in trash_try_clean_mails() stop reading
+	   each mailbox as soon as enough space has been freed, instead of
+	   relying on the mails happening to be in received date order. */
+	static const enum mail_sort_type sort_program[] = {
+		MAIL_SORT_ARRIVAL, MAIL_SORT_END
+	};
 
 	trash->box = mailbox_alloc(trash->ns->list, trash->name, 0);
 	if (mailbox_open(trash->box) < 0) {
@@ -68,7 +76,7 @@ static int trash_clean_mailbox_open(struct trash_mailbox *trash)
 	search_args = mail_search_build_init();
 	mail_search_build_add_all(search_args);
 	trash->search_ctx = mailbox_search_init(trash->trans,
-						search_args, NULL,
+						search_args, sort_program,
 						MAIL_FETCH_PHYSICAL_SIZE |
 						MAIL_FETCH_RECEIVED_DATE, NULL);
 	mail_search_args_unref(&search_args);
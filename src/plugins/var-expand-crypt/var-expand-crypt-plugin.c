@@ -12,8 +12,25 @@
 
 #define VAR_EXPAND_CRYPT_DEFAULT_ALGO "AES-256-CBC"
 
+/* dcrypt contexts can be re-keyed and re-initialized after
+   dcrypt_ctx_sym_final(), so keep the ones we've created around instead
+   of paying a create/free cycle on every expansion - auth processes run
+   an expansion for every login. Processes are single-threaded, so no
+   locking is needed. */
+#define VAR_EXPAND_CRYPT_CTX_CACHE_MAX_COUNT 4
+
 struct module;
 
+struct var_expand_crypt_cached_ctx {
+	char *algo;
+	enum dcrypt_sym_mode mode;
+	struct dcrypt_context_symmetric *dctx;
+};
+
+static struct var_expand_crypt_cached_ctx
+	var_expand_crypt_ctx_cache[VAR_EXPAND_CRYPT_CTX_CACHE_MAX_COUNT];
+static unsigned int var_expand_crypt_ctx_cache_count = 0;
+
 enum crypt_field_format {
 	FORMAT_HEX,
 	FORMAT_BASE64
@@ -100,6 +117,71 @@ var_expand_crypt_settings(struct var_expand_crypt_context *ctx,
 	return 1;
 }
 
+static void
+var_expand_crypt_ctx_cache_delete(unsigned int idx)
+{
+	i_free(var_expand_crypt_ctx_cache[idx].algo);
+	memmove(var_expand_crypt_ctx_cache + idx,
+		var_expand_crypt_ctx_cache + idx + 1,
+		sizeof(var_expand_crypt_ctx_cache[0]) *
+		(var_expand_crypt_ctx_cache_count - idx - 1));
+	var_expand_crypt_ctx_cache_count--;
+}
+
+static int
+var_expand_crypt_ctx_acquire(const char *algo, enum dcrypt_sym_mode mode,
+			     struct dcrypt_context_symmetric **dctx_r,
+			     const char **error_r)
+{
+	struct var_expand_crypt_cached_ctx *entry;
+	unsigned int i;
+
+	for (i = 0; i < var_expand_crypt_ctx_cache_count; i++) {
+		entry = &var_expand_crypt_ctx_cache[i];
+		if (entry->mode == mode &&
+		    strcasecmp(entry->algo, algo) == 0) {
+			*dctx_r = entry->dctx;
+			return 0;
+		}
+	}
+	if (!dcrypt_ctx_sym_create(algo, mode, dctx_r, error_r))
+		return -1;
+	if (var_expand_crypt_ctx_cache_count ==
+	    VAR_EXPAND_CRYPT_CTX_CACHE_MAX_COUNT) {
+		/* drop the oldest entry */
+		dcrypt_ctx_sym_destroy(&var_expand_crypt_ctx_cache[0].dctx);
+		var_expand_crypt_ctx_cache_delete(0);
+	}
+	entry = &var_expand_crypt_ctx_cache[var_expand_crypt_ctx_cache_count++];
+	entry->algo = i_strdup(algo);
+	entry->mode = mode;
+	entry->dctx = *dctx_r;
+	return 0;
+}
+
+/* Called when a crypt operation has failed and the context may be stuck
+   in the middle of it - it's no longer safe to reuse. */
+static void var_expand_crypt_ctx_drop(struct dcrypt_context_symmetric *dctx)
+{
+	unsigned int i;
+
+	for (i = 0; i < var_expand_crypt_ctx_cache_count; i++) {
+		if (var_expand_crypt_ctx_cache[i].dctx == dctx) {
+			var_expand_crypt_ctx_cache_delete(i);
+			break;
+		}
+	}
+	dcrypt_ctx_sym_destroy(&dctx);
+}
+
+static void var_expand_crypt_ctx_cache_free(void)
+{
+	while (var_expand_crypt_ctx_cache_count > 0) {
+		dcrypt_ctx_sym_destroy(&var_expand_crypt_ctx_cache[0].dctx);
+		var_expand_crypt_ctx_cache_delete(0);
+	}
+}
+
 static int
 var_expand_crypt(struct dcrypt_context_symmetric *dctx, buffer_t *key, buffer_t *iv,
 		 const buffer_t *input, buffer_t *output, const char **error_r)
@@ -179,11 +261,13 @@ var_expand_encrypt(struct var_expand_context *_ctx,
 	str_append(field_value, value);
 
 	struct dcrypt_context_symmetric *dctx;
-	if (!dcrypt_ctx_sym_create(ctx.algo, DCRYPT_MODE_ENCRYPT, &dctx, error_r))
+	if (var_expand_crypt_ctx_acquire(ctx.algo, DCRYPT_MODE_ENCRYPT,
+					 &dctx, error_r) < 0)
 		return -1;
 
 	ret = var_expand_crypt(dctx, ctx.enckey, ctx.iv, field_value, tmp, error_r);
-	dcrypt_ctx_sym_destroy(&dctx);
+	if (ret < 0)
+		var_expand_crypt_ctx_drop(dctx);
 
 	if (ret == 0) {
 		/* makes compiler happy */
@@ -288,10 +372,12 @@ var_expand_decrypt(struct var_expand_context *_ctx,
 	}
 
 	struct dcrypt_context_symmetric *dctx;
-	if (!dcrypt_ctx_sym_create(ctx.algo, DCRYPT_MODE_DECRYPT, &dctx, error_r))
+	if (var_expand_crypt_ctx_acquire(ctx.algo, DCRYPT_MODE_DECRYPT,
+					 &dctx, error_r) < 0)
 		return -1;
 	ret = var_expand_crypt(dctx, ctx.enckey, ctx.iv, field_value, tmp, error_r);
-	dcrypt_ctx_sym_destroy(&dctx);
+	if (ret < 0)
+		var_expand_crypt_ctx_drop(dctx);
 
 	if (ret == 0) {
 		*result_r = str_c(tmp);
@@ -322,6 +408,7 @@ void var_expand_crypt_init(struct module *module ATTR_UNUSED)
 
 void var_expand_crypt_deinit(void)
 {
+	var_expand_crypt_ctx_cache_free();
 	var_expand_unregister_func_array(funcs);
 }
 
@@ -936,11 +936,28 @@ static int virtual_sync_backend_box_continue(struct virtual_sync_context *ctx,
 
 	t_array_init(&flag_update_uids, I_MIN(128, old_msg_count));
 	if (bbox->sync_highest_modseq < old_highest_modseq) {
-		for (seq = 1; seq <= old_msg_count; seq++) {
-			modseq = mail_index_modseq_lookup(view, seq);
-			if (modseq > bbox->sync_highest_modseq) {
-				mail_index_lookup_uid(view, seq, &uid);
-				seq_range_array_add(&flag_update_uids, uid);
+		/* first try to read the changed UIDs from the transaction
+		   log, so we don't need to scan through all the messages.
+		   if the log doesn't go back far enough, fall back to
+		   checking each message's modseq. */
+		if (mailbox_get_flag_update_uids(bbox->box,
+				bbox->sync_highest_modseq,
+				&flag_update_uids)) {
+			/* changes to messages the virtual index hasn't seen
+			   yet are handled as appends below */
+			if (bbox->sync_next_uid > 0) {
+				seq_range_array_remove_range(&flag_update_uids,
+					bbox->sync_next_uid, (uint32_t)-1);
+			}
+		} else {
+			array_clear(&flag_update_uids);
+			for (seq = 1; seq <= old_msg_count; seq++) {
+				modseq = mail_index_modseq_lookup(view, seq);
+				if (modseq > bbox->sync_highest_modseq) {
+					mail_index_lookup_uid(view, seq, &uid);
+					seq_range_array_add(&flag_update_uids,
+							    uid);
+				}
 			}
 		}
 	}
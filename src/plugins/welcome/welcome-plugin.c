@@ -16,6 +16,10 @@
 #define WELCOME_CONTEXT(obj) \
 	MODULE_CONTEXT_REQUIRE(obj, welcome_storage_module)
 
+/* Max number of asynchronously running scripts. When the limit is reached,
+   starting a new script first waits for the oldest one to finish. */
+#define WELCOME_MAX_PARALLEL_SCRIPTS 10
+
 struct welcome_mailbox {
 	union mailbox_module_context module_ctx;
 	bool created;
@@ -24,7 +28,9 @@ struct welcome_mailbox {
 static struct welcome_client_list {
 	struct welcome_client_list *prev, *next;
 	struct program_client *client;
+	bool finished;
 } *welcome_clients = NULL;
+static unsigned int welcome_clients_count = 0;
 
 static MODULE_CONTEXT_DEFINE_INIT(welcome_storage_module,
 				  &mail_storage_module_register);
@@ -38,11 +44,30 @@ static void welcome_client_destroy(struct welcome_client_list **_wclient) {
 	i_free(wclient);
 }
 
+static void welcome_clients_reap_finished(void)
+{
+	struct welcome_client_list *wclient, *next;
+
+	for (wclient = welcome_clients; wclient != NULL; wclient = next) {
+		next = wclient->next;
+		if (wclient->finished) {
+			DLLIST_REMOVE(&welcome_clients, wclient);
+			welcome_clients_count--;
+			welcome_client_destroy(&wclient);
+		}
+	}
+}
+
 static void script_finish(enum program_client_exit_status ret,
-			  struct program_client *client)
+			  struct welcome_client_list *wclient)
 {
-	if (ret != PROGRAM_CLIENT_EXIT_STATUS_SUCCESS)
-		e_error(client->event, "welcome: Execution failed: %d", ret);
+	if (ret != PROGRAM_CLIENT_EXIT_STATUS_SUCCESS) {
+		e_error(wclient->client->event,
+			"welcome: Execution failed: %d", ret);
+	}
+	/* the program client can't be destroyed in its own callback -
+	   it's reaped before the next script is started or at deinit */
+	wclient->finished = TRUE;
 }
 
 static void script_execute(struct mail_user *user, const char *cmd, bool wait)
@@ -76,12 +101,27 @@ static void script_execute(struct mail_user *user, const char *cmd, bool wait)
 	if (wait) {
 		enum program_client_exit_status ret =
 			program_client_run(wclient->client);
-		script_finish(ret, wclient->client);
+		if (ret != PROGRAM_CLIENT_EXIT_STATUS_SUCCESS) {
+			e_error(wclient->client->event,
+				"welcome: Execution failed: %d", ret);
+		}
 		welcome_client_destroy(&wclient);
 	} else {
+		/* don't let the scripts pile up without a bound if mailboxes
+		   are created faster than the scripts finish */
+		welcome_clients_reap_finished();
+		while (welcome_clients_count >= WELCOME_MAX_PARALLEL_SCRIPTS) {
+			struct welcome_client_list *oldest = welcome_clients;
+
+			while (oldest->next != NULL)
+				oldest = oldest->next;
+			program_client_wait(oldest->client);
+			welcome_clients_reap_finished();
+		}
 		DLLIST_PREPEND(&welcome_clients, wclient);
+		welcome_clients_count++;
 		program_client_run_async(wclient->client, script_finish,
-					 wclient->client);
+					 wclient);
 	}
 }
 
@@ -141,6 +181,7 @@ void welcome_plugin_deinit(void)
 		welcome_client_destroy(&welcome_clients);
 		welcome_clients = next;
 	}
+	welcome_clients_count = 0;
 
 	mail_storage_hooks_remove(&welcome_mail_storage_hooks);
 }
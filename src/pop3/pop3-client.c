@@ -20,6 +20,7 @@
 #include "mail-storage-service.h"
 #include "mail-autoexpunge.h"
 #include "pop3-commands.h"
+#include "pop3-snapshot.h"
 #include "mail-search-build.h"
 #include "mail-namespace.h"
 
@@ -271,9 +272,14 @@ static int init_mailbox(struct client *client, const char **error_r)
 			break;
 		}
 
+		if (i == 0 && pop3_snapshot_load(client) > 0)
+			return 0;
+
 		ret = read_mailbox(client, &failed_uid);
-		if (ret > 0)
+		if (ret > 0) {
+			pop3_snapshot_save(client);
 			return 0;
+		}
 		if (i == 2)
 			break;
 
@@ -88,6 +88,10 @@ struct client {
 	unsigned char *deleted_bitmask;
 	unsigned char *seen_bitmask;
 
+	/* pop3_snapshot_cache: highest-modseq the snapshot file is keyed by,
+	   0 = snapshot not usable for this session */
+	uint64_t snapshot_modseq;
+
 	/* settings: */
 	const struct pop3_settings *set;
 	const struct mail_storage_settings *mail_set;
@@ -105,6 +109,7 @@ struct client {
 	bool message_uidls_save:1;
 	bool delete_success:1;
 	bool quit_seen:1;
+	bool snapshot_has_uidls:1;
 };
 
 struct pop3_module_register {
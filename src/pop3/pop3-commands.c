@@ -14,6 +14,7 @@
 #include "mail-search-build.h"
 #include "pop3-capability.h"
 #include "pop3-commands.h"
+#include "pop3-snapshot.h"
 
 static enum mail_sort_type pop3_sort_program[] = {
 	MAIL_SORT_POP3_ORDER,
@@ -874,6 +875,11 @@ static void client_uidls_save(struct client *client)
 			seq_uidls[msgnum_to_seq(client, msgnum) - 1];
 	}
 	i_free(seq_uidls);
+
+	/* add the UIDLs to the snapshot, so the next session doesn't need to
+	   compute them either */
+	if (!client->snapshot_has_uidls)
+		pop3_snapshot_save(client);
 }
 
 static struct cmd_uidl_context *
@@ -0,0 +1,309 @@
+/* Copyright (c) 2024 Dovecot authors, see the included COPYING file */
+
+#include "pop3-common.h"
+#include "array.h"
+#include "str.h"
+#include "strescape.h"
+#include "istream.h"
+#include "write-full.h"
+#include "seq-range-array.h"
+#include "mail-storage.h"
+#include "mail-storage-private.h"
+#include "pop3-snapshot.h"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+/* The snapshot is a small text file in the INBOX index directory that caches
+   the result of the message listing done at session startup. It is keyed by
+   the mailbox state (uidvalidity + highest-modseq), so any change to the
+   mailbox - including this session's own flag updates and expunges at QUIT -
+   simply invalidates it and the next session falls back to listing the
+   mailbox normally.
+
+   Format:
+
+   <version> <uidvalidity> <highest-modseq> <mailbox msgs> <listed msgs>
+       <last seen msn> <fast size lookups> <deleted flag> <uidl format>
+       <reuse xuidl> <save uidl> <uidl duplicates>
+   <seq> <size> [<uidl>]
+   ...
+
+   All fields are TAB-separated and tab-escaped. One message line exists for
+   each listed message, in POP3 message order. The UIDL field is present only
+   if the UIDLs had been computed by the time the snapshot was written. The
+   UIDL settings are part of the header so that changing any of them
+   invalidates snapshots with cached UIDLs. */
+
+#define POP3_SNAPSHOT_FNAME "dovecot.pop3-snapshot"
+#define POP3_SNAPSHOT_VERSION 2
+
+static int pop3_snapshot_get_path(struct client *client, const char **path_r)
+{
+	const char *dir;
+	int ret;
+
+	ret = mailbox_get_path_to(client->mailbox,
+				  MAILBOX_LIST_PATH_TYPE_INDEX, &dir);
+	if (ret <= 0)
+		return ret;
+	*path_r = t_strconcat(dir, "/"POP3_SNAPSHOT_FNAME, NULL);
+	return 1;
+}
+
+static void
+snapshot_msgnum_to_seq_map_add(ARRAY_TYPE(uint32_t) *msgnum_to_seq_map,
+			       unsigned int listed_count, uint32_t seq,
+			       unsigned int msgnum)
+{
+	uint32_t iseq;
+
+	/* same logic as msgnum_to_seq_map_add() in pop3-client.c */
+	if (seq == msgnum+1)
+		return;
+
+	if (!array_is_created(msgnum_to_seq_map))
+		i_array_init(msgnum_to_seq_map, listed_count);
+
+	iseq = array_count(msgnum_to_seq_map) + 1;
+	for (; iseq <= msgnum; iseq++)
+		array_push_back(msgnum_to_seq_map, &iseq);
+	array_push_back(msgnum_to_seq_map, &seq);
+}
+
+static bool
+pop3_snapshot_parse_header(struct client *client,
+			   const struct mailbox_status *status,
+			   const char *line, unsigned int *listed_count_r,
+			   uint32_t *last_seen_r)
+{
+	const char *const *args = t_strsplit_tabescaped(line);
+	unsigned int version, mailbox_messages, fast_sizes;
+	unsigned int reuse_xuidl, save_uidl;
+	uint64_t modseq;
+	uint32_t uidvalidity;
+
+	if (str_array_length(args) != 12 ||
+	    str_to_uint(args[0], &version) < 0 ||
+	    version != POP3_SNAPSHOT_VERSION ||
+	    str_to_uint32(args[1], &uidvalidity) < 0 ||
+	    str_to_uint64(args[2], &modseq) < 0 ||
+	    str_to_uint(args[3], &mailbox_messages) < 0 ||
+	    str_to_uint(args[4], listed_count_r) < 0 ||
+	    str_to_uint32(args[5], last_seen_r) < 0 ||
+	    str_to_uint(args[6], &fast_sizes) < 0 || fast_sizes > 1 ||
+	    str_to_uint(args[9], &reuse_xuidl) < 0 || reuse_xuidl > 1 ||
+	    str_to_uint(args[10], &save_uidl) < 0 || save_uidl > 1)
+		return FALSE;
+
+	/* the snapshot must describe exactly the current mailbox state and
+	   must have been listed with the same settings. The UIDL settings
+	   matter because the snapshot may carry cached UIDL strings - serving
+	   UIDLs computed under an old pop3_uidl_format would break clients'
+	   message deduplication. */
+	return uidvalidity == status->uidvalidity &&
+		modseq == status->highest_modseq &&
+		mailbox_messages == status->messages &&
+		*listed_count_r <= mailbox_messages &&
+		(fast_sizes != 0) == client->set->pop3_fast_size_lookups &&
+		strcmp(args[7], client->set->pop3_deleted_flag) == 0 &&
+		strcmp(args[8], client->mail_set->pop3_uidl_format) == 0 &&
+		(reuse_xuidl != 0) == client->set->pop3_reuse_xuidl &&
+		(save_uidl != 0) == client->set->pop3_save_uidl &&
+		strcmp(args[11], client->set->pop3_uidl_duplicates) == 0;
+}
+
+int pop3_snapshot_load(struct client *client)
+{
+	struct mailbox_status status;
+	struct istream *input;
+	const char *path, *line, *const *args;
+	ARRAY(uoff_t) message_sizes;
+	ARRAY_TYPE(uint32_t) msgnum_to_seq_map = ARRAY_INIT;
+	const char **uidls = NULL;
+	pool_t uidl_pool = NULL;
+	unsigned int msgnum, count, listed_count;
+	uint32_t last_seen;
+	bool failed = FALSE;
+
+	if (!client->set->pop3_snapshot_cache)
+		return 0;
+
+	mailbox_get_open_status(client->mailbox,
+				STATUS_UIDVALIDITY | STATUS_MESSAGES |
+				STATUS_HIGHESTMODSEQ, &status);
+	if (status.nonpermanent_modseqs) {
+		/* modseqs can't be used as a persistent snapshot key */
+		return 0;
+	}
+	if (pop3_snapshot_get_path(client, &path) <= 0)
+		return 0;
+	/* remember the key for pop3_snapshot_save() */
+	client->snapshot_modseq = status.highest_modseq;
+
+	input = i_stream_create_file(path, SIZE_MAX);
+	line = i_stream_read_next_line(input);
+	if (line == NULL ||
+	    !pop3_snapshot_parse_header(client, &status, line,
+					&listed_count, &last_seen)) {
+		/* missing, unreadable or stale snapshot */
+		i_stream_unref(&input);
+		return 0;
+	}
+
+	client->total_size = 0;
+	client->highest_seq = 0;
+	i_array_init(&message_sizes, I_MAX(listed_count, 1));
+	i_array_init(&client->all_seqs, 32);
+
+	msgnum = 0;
+	while ((line = i_stream_read_next_line(input)) != NULL) {
+		uint32_t seq;
+		uoff_t size;
+
+		args = t_strsplit_tabescaped(line);
+		count = str_array_length(args);
+		if (msgnum >= listed_count || (count != 2 && count != 3) ||
+		    str_to_uint32(args[0], &seq) < 0 || seq == 0 ||
+		    str_to_uoff(args[1], &size) < 0) {
+			failed = TRUE;
+			break;
+		}
+		/* either all message lines have a UIDL or none of them do */
+		if (count == 3) {
+			if (msgnum == 0) {
+				uidl_pool = pool_alloconly_create(
+					"message uidls", 1024);
+				uidls = p_new(uidl_pool, const char *,
+					      MALLOC_ADD(listed_count, 1));
+			} else if (uidls == NULL) {
+				failed = TRUE;
+				break;
+			}
+			uidls[msgnum] = p_strdup(uidl_pool, args[2]);
+		} else if (uidls != NULL) {
+			failed = TRUE;
+			break;
+		}
+
+		seq_range_array_add(&client->all_seqs, seq);
+		snapshot_msgnum_to_seq_map_add(&msgnum_to_seq_map,
+					       listed_count, seq, msgnum);
+		if (client->highest_seq < seq)
+			client->highest_seq = seq;
+		client->total_size += size;
+		array_push_back(&message_sizes, &size);
+		msgnum++;
+	}
+	if (msgnum != listed_count || input->stream_errno != 0)
+		failed = TRUE;
+	i_stream_unref(&input);
+
+	if (failed) {
+		array_free(&message_sizes);
+		if (array_is_created(&msgnum_to_seq_map))
+			array_free(&msgnum_to_seq_map);
+		array_free(&client->all_seqs);
+		if (uidl_pool != NULL)
+			pool_unref(&uidl_pool);
+		client->total_size = 0;
+		client->highest_seq = 0;
+		e_debug(client->event, "Ignoring broken snapshot %s", path);
+		return 0;
+	}
+
+	client->uid_validity = status.uidvalidity;
+	client->messages_count = listed_count;
+	client->last_seen_pop3_msn = last_seen;
+	client->message_sizes = array_free_without_data(&message_sizes);
+	if (array_is_created(&msgnum_to_seq_map)) {
+		client->msgnum_to_seq_map_count =
+			array_count(&msgnum_to_seq_map);
+		client->msgnum_to_seq_map =
+			array_free_without_data(&msgnum_to_seq_map);
+	}
+	if (uidls != NULL) {
+		client->uidl_pool = uidl_pool;
+		client->message_uidls = uidls;
+		client->snapshot_has_uidls = TRUE;
+	}
+	client->trans = mailbox_transaction_begin(client->mailbox, 0, __func__);
+	e_debug(client->event, "Mailbox listing initialized from snapshot %s",
+		path);
+	return 1;
+}
+
+void pop3_snapshot_save(struct client *client)
+{
+	struct mailbox_status status;
+	string_t *data;
+	const char *path, *temp_path;
+	unsigned int msgnum;
+	int fd;
+
+	if (!client->set->pop3_snapshot_cache)
+		return;
+	if (client->snapshot_modseq == 0) {
+		/* snapshots aren't usable for this mailbox */
+		return;
+	}
+	if (pop3_snapshot_get_path(client, &path) <= 0)
+		return;
+
+	mailbox_get_open_status(client->mailbox, STATUS_MESSAGES, &status);
+
+	data = t_str_new(I_MAX(client->messages_count * 16, 256));
+	str_printfa(data, "%u\t%u\t%"PRIu64"\t%u\t%u\t%u\t%u\t",
+		    POP3_SNAPSHOT_VERSION, client->uid_validity,
+		    client->snapshot_modseq, status.messages,
+		    client->messages_count, client->last_seen_pop3_msn,
+		    client->set->pop3_fast_size_lookups ? 1 : 0);
+	str_append_tabescaped(data, client->set->pop3_deleted_flag);
+	str_append_c(data, '\t');
+	str_append_tabescaped(data, client->mail_set->pop3_uidl_format);
+	str_printfa(data, "\t%u\t%u\t",
+		    client->set->pop3_reuse_xuidl ? 1 : 0,
+		    client->set->pop3_save_uidl ? 1 : 0);
+	str_append_tabescaped(data, client->set->pop3_uidl_duplicates);
+	str_append_c(data, '\n');
+
+	for (msgnum = 0; msgnum < client->messages_count; msgnum++) {
+		uint32_t seq = msgnum < client->msgnum_to_seq_map_count ?
+			client->msgnum_to_seq_map[msgnum] : msgnum + 1;
+
+		str_printfa(data, "%u\t%"PRIuUOFF_T, seq,
+			    client->message_sizes[msgnum]);
+		if (client->message_uidls != NULL) {
+			str_append_c(data, '\t');
+			str_append_tabescaped(data,
+					      client->message_uidls[msgnum]);
+		}
+		str_append_c(data, '\n');
+	}
+
+	temp_path = t_strconcat(path, ".tmp", NULL);
+	fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (fd == -1) {
+		e_error(client->event, "open(%s) failed: %m", temp_path);
+		return;
+	}
+	if (write_full(fd, str_data(data), str_len(data)) < 0) {
+		e_error(client->event, "write(%s) failed: %m", temp_path);
+		i_close_fd(&fd);
+		i_unlink(temp_path);
+		return;
+	}
+	if (close(fd) < 0) {
+		e_error(client->event, "close(%s) failed: %m", temp_path);
+		i_unlink(temp_path);
+		return;
+	}
+	if (rename(temp_path, path) < 0) {
+		e_error(client->event, "rename(%s, %s) failed: %m",
+			temp_path, path);
+		i_unlink(temp_path);
+		return;
+	}
+	client->snapshot_has_uidls = client->message_uidls != NULL;
+}
@@ -0,0 +1,16 @@
+#ifndef POP3_SNAPSHOT_H
+#define POP3_SNAPSHOT_H
+
+struct client;
+
+/* Try to initialize the session state (message sizes, sequences and - when
+   available - UIDLs) from the snapshot written by a previous session. The
+   snapshot is used only when the mailbox is entirely unchanged since it was
+   written. Returns 1 if the snapshot was used, 0 if the listing needs to be
+   read from the mailbox. */
+int pop3_snapshot_load(struct client *client);
+/* Write a snapshot of the current session state, so the next session can
+   skip listing the mailbox if it is still unchanged. */
+void pop3_snapshot_save(struct client *client);
+
+#endif
@@ -26,6 +26,7 @@
 #include "smtp-client.h"
 
 #include "submission-commands.h"
+#include "submission-backend-relay.h"
 
 #include <stdio.h>
 #include <unistd.h>
@@ -459,6 +460,8 @@ int main(int argc, char *argv[])
 	if (io_loop_is_running(current_ioloop))
 		master_service_run(master_service, client_connected);
 	clients_destroy_all();
+	submission_backend_relay_spool_drain();
+	submission_backend_relay_conn_cache_clear();
 
 	smtp_client_deinit(&smtp_client);
 	smtp_server_deinit(&smtp_server);
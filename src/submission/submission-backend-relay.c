@@ -1,10 +1,13 @@
 /* Copyright (c) 2018 Dovecot authors, see the included COPYING file */
 
 #include "submission-common.h"
+#include "llist.h"
+#include "istream.h"
 #include "str.h"
 #include "str-sanitize.h"
 #include "mail-user.h"
 #include "iostream-ssl.h"
+#include "dsasl-client.h"
 #include "smtp-client.h"
 #include "smtp-client-connection.h"
 #include "smtp-client-transaction.h"
@@ -16,6 +19,7 @@
 struct submission_backend_relay {
 	struct submission_backend backend;
 
+	char *conn_cache_key;
 	struct smtp_client_connection *conn;
 	struct smtp_client_transaction *trans;
 
@@ -24,6 +28,13 @@ struct submission_backend_relay {
 	bool quit_confirmed:1;
 };
 
+/* An idle relay connection is kept alive after its client session ends, so
+   that the next session handled by this process can reuse it when it relays
+   to the same backend with the same credentials. This avoids repeating the
+   TCP, TLS and AUTH handshakes for every consecutive session. */
+static char *relay_conn_cache_key = NULL;
+static struct smtp_client_connection *relay_conn_cache_conn = NULL;
+
 static struct submission_backend_vfuncs backend_relay_vfuncs;
 
 /*
@@ -645,6 +656,229 @@ backend_relay_cmd_rset(struct submission_backend *backend,
 	return 0;
 }
 
+/*
+ * Spooled sending
+ */
+
+/* With submission_relay_spool enabled, the DATA command is replied as soon as
+   the message data is safely spooled locally. The message is then relayed in
+   the background, detached from the client transaction, with a few retries on
+   temporary failures. */
+
+#define RELAY_SPOOL_MAX_ATTEMPTS 3
+#define RELAY_SPOOL_RETRY_INTERVAL_MSECS (15*1000)
+#define RELAY_SPOOL_DRAIN_TIMEOUT_MSECS (60*1000)
+
+struct relay_spool_rcpt {
+	struct smtp_address *path;
+	struct smtp_params_rcpt params;
+};
+
+struct relay_spool_send {
+	struct relay_spool_send *prev, *next;
+	pool_t pool;
+	struct event *event;
+
+	struct smtp_client_connection *conn;
+	struct smtp_client_transaction *trans;
+
+	struct smtp_address *mail_from;
+	struct smtp_params_mail mail_params;
+	ARRAY(struct relay_spool_rcpt) rcpts;
+	struct istream *data_input;
+	uoff_t data_size;
+
+	unsigned int attempts;
+	struct timeout *to_retry;
+
+	bool retry_scheduled:1;
+};
+
+static struct relay_spool_send *relay_spool_sends = NULL;
+static bool relay_spool_draining = FALSE;
+static bool relay_spool_aborting = FALSE;
+
+static void relay_spool_send_attempt(struct relay_spool_send *dsend);
+
+static void relay_spool_send_free(struct relay_spool_send **_dsend)
+{
+	struct relay_spool_send *dsend = *_dsend;
+
+	*_dsend = NULL;
+
+	i_assert(dsend->trans == NULL);
+	DLLIST_REMOVE(&relay_spool_sends, dsend);
+	timeout_remove(&dsend->to_retry);
+	i_stream_unref(&dsend->data_input);
+	smtp_client_connection_unref(&dsend->conn);
+	event_unref(&dsend->event);
+	pool_unref(&dsend->pool);
+
+	if (relay_spool_sends == NULL && relay_spool_draining)
+		io_loop_stop(current_ioloop);
+}
+
+static void
+relay_spool_send_data_callback(const struct smtp_reply *relay_reply,
+			       struct relay_spool_send *dsend)
+{
+	if (smtp_reply_is_success(relay_reply)) {
+		e_info(dsend->event, "Successfully relayed spooled message: "
+		       "from=<%s>, size=%"PRIuUOFF_T", nrcpt=%u, reply=`%s'",
+		       smtp_address_encode(dsend->mail_from), dsend->data_size,
+		       array_count(&dsend->rcpts),
+		       str_sanitize(smtp_reply_log(relay_reply), 128));
+		return;
+	}
+
+	if (dsend->attempts < RELAY_SPOOL_MAX_ATTEMPTS &&
+	    (!smtp_reply_is_remote(relay_reply) ||
+	     smtp_reply_is_temp_fail(relay_reply))) {
+		e_warning(dsend->event, "Failed to relay spooled message "
+			  "(attempt %u/%u): from=<%s>, reply=`%s' - retrying",
+			  dsend->attempts, RELAY_SPOOL_MAX_ATTEMPTS,
+			  smtp_address_encode(dsend->mail_from),
+			  str_sanitize(smtp_reply_log(relay_reply), 128));
+		dsend->retry_scheduled = TRUE;
+		return;
+	}
+
+	e_error(dsend->event, "Failed to relay spooled message: "
+		"from=<%s>, nrcpt=%u, reply=`%s' - giving up, message is lost",
+		smtp_address_encode(dsend->mail_from),
+		array_count(&dsend->rcpts),
+		str_sanitize(smtp_reply_log(relay_reply), 128));
+}
+
+static void
+relay_spool_send_rcpt_callback(const struct smtp_reply *relay_reply,
+			       struct relay_spool_send *dsend)
+{
+	/* Individual RCPT failures are only interesting for debugging; the
+	   transaction-level data callback handles the overall result. */
+	if (!smtp_reply_is_success(relay_reply)) {
+		e_debug(dsend->event, "RCPT command failed: %s",
+			str_sanitize(smtp_reply_log(relay_reply), 128));
+	}
+}
+
+static void relay_spool_send_finished(struct relay_spool_send *dsend)
+{
+	dsend->trans = NULL;
+
+	if (dsend->retry_scheduled && !relay_spool_aborting) {
+		dsend->retry_scheduled = FALSE;
+		dsend->to_retry = timeout_add(RELAY_SPOOL_RETRY_INTERVAL_MSECS,
+					      relay_spool_send_attempt, dsend);
+		return;
+	}
+	relay_spool_send_free(&dsend);
+}
+
+static void relay_spool_send_attempt(struct relay_spool_send *dsend)
+{
+	struct relay_spool_rcpt *spool_rcpt;
+
+	timeout_remove(&dsend->to_retry);
+	dsend->attempts++;
+
+	if (smtp_client_connection_get_state(dsend->conn) ==
+	    SMTP_CLIENT_CONNECTION_STATE_DISCONNECTED)
+		smtp_client_connection_connect(dsend->conn, NULL, NULL);
+
+	dsend->trans = smtp_client_transaction_create(
+		dsend->conn, dsend->mail_from, &dsend->mail_params, 0,
+		relay_spool_send_finished, dsend);
+	array_foreach_modifiable(&dsend->rcpts, spool_rcpt) {
+		smtp_client_transaction_add_rcpt(
+			dsend->trans, spool_rcpt->path, &spool_rcpt->params,
+			relay_spool_send_rcpt_callback,
+			relay_spool_send_rcpt_callback, dsend);
+	}
+	i_stream_seek(dsend->data_input, 0);
+	smtp_client_transaction_send(dsend->trans, dsend->data_input,
+				     relay_spool_send_data_callback, dsend);
+}
+
+void submission_backend_relay_spool_drain(void)
+{
+	struct timeout *to;
+
+	if (relay_spool_sends == NULL)
+		return;
+
+	/* Finish relaying spooled messages that the clients already got a
+	   success reply for. */
+	relay_spool_draining = TRUE;
+	to = timeout_add(RELAY_SPOOL_DRAIN_TIMEOUT_MSECS,
+			 io_loop_stop, current_ioloop);
+	io_loop_run(current_ioloop);
+	timeout_remove(&to);
+	relay_spool_draining = FALSE;
+
+	relay_spool_aborting = TRUE;
+	while (relay_spool_sends != NULL) {
+		struct relay_spool_send *dsend = relay_spool_sends;
+
+		e_error(dsend->event, "Timed out while relaying spooled "
+			"message: from=<%s> - message is lost",
+			smtp_address_encode(dsend->mail_from));
+		if (dsend->trans != NULL)
+			smtp_client_transaction_destroy(&dsend->trans);
+		else
+			relay_spool_send_free(&dsend);
+	}
+	relay_spool_aborting = FALSE;
+}
+
+static int
+backend_relay_cmd_data_spool(struct submission_backend_relay *rbackend,
+			     struct smtp_server_cmd_ctx *cmd,
+			     struct smtp_server_transaction *trans,
+			     struct istream *data_input, uoff_t data_size)
+{
+	struct relay_spool_send *dsend;
+	struct smtp_server_recipient *rcpt;
+	pool_t pool;
+
+	pool = pool_alloconly_create("relay spool send", 1024);
+	dsend = p_new(pool, struct relay_spool_send, 1);
+	dsend->pool = pool;
+	dsend->event = event_create(NULL);
+	event_set_append_log_prefix(
+		dsend->event,
+		t_strdup_printf("spooled send %s: ", trans->id));
+
+	dsend->conn = rbackend->conn;
+	smtp_client_connection_ref(dsend->conn);
+
+	dsend->mail_from = smtp_address_clone(pool, trans->mail_from);
+	smtp_params_mail_copy(pool, &dsend->mail_params, &trans->params);
+	p_array_init(&dsend->rcpts, pool, array_count(&trans->rcpt_to));
+	array_foreach_elem(&trans->rcpt_to, rcpt) {
+		struct relay_spool_rcpt *spool_rcpt =
+			array_append_space(&dsend->rcpts);
+
+		spool_rcpt->path = smtp_address_clone(pool, rcpt->path);
+		smtp_params_rcpt_copy(pool, &spool_rcpt->params,
+				      &rcpt->params);
+	}
+	dsend->data_input = data_input;
+	i_stream_ref(data_input);
+	dsend->data_size = data_size;
+
+	DLLIST_PREPEND(&relay_spool_sends, dsend);
+
+	/* The pending relay transaction is dropped along with the client
+	   transaction; the spooled send runs its own transaction, so that it
+	   isn't tied to the lifetime of the client connection. */
+	relay_spool_send_attempt(dsend);
+
+	smtp_server_reply(cmd, 250, "2.0.0", "%s Ok: message spooled",
+			  trans->id);
+	return 0;
+}
+
 /*
  * DATA/BDAT commands
  */
@@ -772,12 +1006,19 @@ static int
 backend_relay_cmd_data(struct submission_backend *backend,
 		       struct smtp_server_cmd_ctx *cmd,
 		       struct smtp_server_transaction *trans,
-		       struct istream *data_input, uoff_t data_size ATTR_UNUSED)
+		       struct istream *data_input, uoff_t data_size)
 {
 	struct submission_backend_relay *rbackend =
 		container_of(backend, struct submission_backend_relay, backend);
 	struct relay_cmd_data_context *data_ctx;
 
+	if (backend->client->set->submission_relay_spool &&
+	    !HAS_ALL_BITS(trans->flags,
+			  SMTP_SERVER_TRANSACTION_FLAG_REPLY_PER_RCPT)) {
+		return backend_relay_cmd_data_spool(rbackend, cmd, trans,
+						    data_input, data_size);
+	}
+
 	/* start relaying to relay server */
 	data_ctx = p_new(trans->pool, struct relay_cmd_data_context, 1);
 	data_ctx->backend = rbackend;
@@ -1072,6 +1313,36 @@ backend_relay_cmd_quit(struct submission_backend *backend,
  * Relay backend
  */
 
+static char *
+backend_relay_conn_cache_key(const struct submision_backend_relay_settings *set)
+{
+	/* Per-user state is sent over trusted connections (XCLIENT) and
+	   rawlogs are written relative to the user's home directory, so such
+	   connections cannot be shared between sessions. */
+	if (set->trusted || set->rawlog_dir != NULL)
+		return NULL;
+
+	return i_strdup_printf("%u\t%s\t%s\t%s\t%u\t%u\t%u\t%s\t%s\t%s\t%s\t%s",
+		set->protocol,
+		(set->path == NULL ? "" : set->path),
+		(set->host == NULL ? "" : set->host),
+		(set->ip.family == 0 ? "" : net_ip2addr(&set->ip)),
+		set->port, set->ssl_mode, (set->ssl_verify ? 1 : 0),
+		set->my_hostname,
+		(set->user == NULL ? "" : set->user),
+		(set->master_user == NULL ? "" : set->master_user),
+		(set->password == NULL ? "" : set->password),
+		(set->sasl_mech == NULL ?
+		 "" : dsasl_client_mech_get_name(set->sasl_mech)));
+}
+
+void submission_backend_relay_conn_cache_clear(void)
+{
+	if (relay_conn_cache_conn != NULL)
+		smtp_client_connection_close(&relay_conn_cache_conn);
+	i_free(relay_conn_cache_key);
+}
+
 struct submission_backend_relay *
 submission_backend_relay_create(
 	struct client *client,
@@ -1090,6 +1361,21 @@ submission_backend_relay_create(
 
 	event_set_append_log_prefix(rbackend->backend.event, "relay: ");
 
+	rbackend->conn_cache_key = backend_relay_conn_cache_key(set);
+	if (rbackend->conn_cache_key != NULL && relay_conn_cache_conn != NULL &&
+	    strcmp(rbackend->conn_cache_key, relay_conn_cache_key) == 0 &&
+	    smtp_client_connection_get_state(relay_conn_cache_conn) ==
+		SMTP_CLIENT_CONNECTION_STATE_READY) {
+		/* The previous session left behind a matching relay connection
+		   that is still ready - reuse it instead of logging in again. */
+		e_debug(rbackend->backend.event,
+			"Reusing relay connection from previous session");
+		rbackend->conn = relay_conn_cache_conn;
+		relay_conn_cache_conn = NULL;
+		i_free(relay_conn_cache_key);
+		return rbackend;
+	}
+
 	mail_user_init_ssl_client_settings(user, &ssl_set);
 	if (set->ssl_verify)
 		ssl_set.verbose_invalid_cert = TRUE;
@@ -1176,8 +1462,21 @@ static void backend_relay_destroy(struct submission_backend *backend)
 
 	if (rbackend->trans != NULL)
 		smtp_client_transaction_destroy(&rbackend->trans);
-	if (rbackend->conn != NULL)
-		smtp_client_connection_close(&rbackend->conn);
+	if (rbackend->conn != NULL) {
+		if (rbackend->conn_cache_key != NULL &&
+		    smtp_client_connection_get_state(rbackend->conn) ==
+			SMTP_CLIENT_CONNECTION_STATE_READY) {
+			/* Keep the connection around for the next session */
+			submission_backend_relay_conn_cache_clear();
+			relay_conn_cache_key = rbackend->conn_cache_key;
+			relay_conn_cache_conn = rbackend->conn;
+			rbackend->conn_cache_key = NULL;
+			rbackend->conn = NULL;
+		} else {
+			smtp_client_connection_close(&rbackend->conn);
+		}
+	}
+	i_free(rbackend->conn_cache_key);
 }
 
 static void backend_relay_ready_cb(const struct smtp_reply *reply,
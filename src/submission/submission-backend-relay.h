@@ -40,6 +40,14 @@ submission_backend_relay_create(
 	struct client *client,
 	const struct submision_backend_relay_settings *set);
 
+/* Close the idle relay connection cached for reuse by the next session,
+   if any. */
+void submission_backend_relay_conn_cache_clear(void);
+
+/* Wait for pending spooled message sends to finish (with a timeout). Used at
+   process shutdown when submission_relay_spool is enabled. */
+void submission_backend_relay_spool_drain(void);
+
 /* Returns the base backend object for this relay backend */
 struct submission_backend *
 submission_backend_relay_get(struct submission_backend_relay *backend)
@@ -16,6 +16,8 @@
 #include "submission-commands.h"
 #include "submission-backend-relay.h"
 
+#include <unistd.h>
+
 /*
  * EHLO, HELO commands
  */
@@ -240,6 +242,19 @@ int cmd_data_continue(void *conn_ctx, struct smtp_server_cmd_ctx *cmd,
 	/* Current data stream position is the data size */
 	client->state.data_size = data_input->v_offset;
 
+	if (client->set->submission_relay_spool) {
+		/* The backend will reply success based on the local spool
+		   alone, so make sure the spooled data has hit the disk
+		   first. Small messages are still held in memory only. */
+		int fd = i_stream_get_fd(data_input);
+
+		if (fd != -1 && fdatasync(fd) < 0) {
+			e_error(client->event, "fdatasync(%s) failed: %m",
+				i_stream_get_name(data_input));
+			return -1;
+		}
+	}
+
 	/* prepend our own headers */
 	added_headers = t_str_new(200);
 	if (client->set->submission_add_received_header) {
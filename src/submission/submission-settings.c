@@ -105,6 +105,8 @@ static const struct setting_define submission_setting_defines[] = {
 	DEF(TIME_MSECS, submission_relay_connect_timeout),
 	DEF(TIME_MSECS, submission_relay_command_timeout),
 
+	DEF(BOOL, submission_relay_spool),
+
 	DEF(STR, imap_urlauth_host),
 	DEF(IN_PORT, imap_urlauth_port),
 
@@ -147,6 +149,8 @@ static const struct submission_settings submission_default_settings = {
 	.submission_relay_connect_timeout = 30*1000,
 	.submission_relay_command_timeout = 60*5*1000,
 
+	.submission_relay_spool = FALSE,
+
 	.imap_urlauth_host = "",
 	.imap_urlauth_port = 143,
 };
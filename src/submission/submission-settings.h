@@ -49,6 +49,8 @@ struct submission_settings {
 	unsigned int submission_relay_connect_timeout;
 	unsigned int submission_relay_command_timeout;
 
+	bool submission_relay_spool;
+
 	/* imap urlauth: */
 	const char *imap_urlauth_host;
 	in_port_t imap_urlauth_port;
@@ -182,7 +182,8 @@ parse_input(ARRAY_TYPE(const_string)* envs, const char *const **args_r,
 	return noreply;
 }
 
-static bool client_exec_script(struct master_service_connection *conn)
+static bool client_exec_script(struct master_service_connection *conn,
+			       bool *noreply_r)
 {
 	ARRAY_TYPE(const_string) envs;
 	const char *const *args = NULL;
@@ -190,17 +191,18 @@ static bool client_exec_script(struct master_service_connection *conn)
 	int status;
 	pid_t pid;
 
+	*noreply_r = FALSE;
 	t_array_init(&envs, 16);
 
 	net_set_nonblock(conn->fd, FALSE);
 
-	if (!passthrough && parse_input(&envs, &args, conn, &ret)) {
+	if (!passthrough) {
 		/* parse_input returns TRUE if noreply is set in the input.
-		 * In that case there is no need to fork and check exit
-		 * status. Parsing the input must only happen if passthrough
-		 * is not enabled. */
-		exec_child(conn, args, array_front(&envs));
-		i_unreached();
+		 * The script is forked even then: this process stays around
+		 * to serve further connections, so it can't exec the script
+		 * directly. Only the status reply is skipped. Parsing the
+		 * input must only happen if passthrough is not enabled. */
+		*noreply_r = parse_input(&envs, &args, conn, &ret);
 	}
 
 	if ((pid = fork()) == (pid_t)-1) {
@@ -244,16 +246,19 @@ static bool client_exec_script(struct master_service_connection *conn)
 
 static void client_connected(struct master_service_connection *conn)
 {
-	if (!passthrough) {
+	bool success, noreply;
+
+	success = client_exec_script(conn, &noreply);
+	if (!passthrough && !noreply) {
 		char response[2];
 
-		response[0] = client_exec_script(conn) ? '+' : '-';
+		response[0] = success ? '+' : '-';
 		response[1] = '\n';
 		if (write_full(conn->fd, &response, 2) < 0)
 			i_error("write(response) failed: %m");
-	} else {
-		client_exec_script(conn);
 	}
+	/* an alarm= option applies only to a single invocation */
+	alarm(0);
 }
 
 int main(int argc, char *argv[])
@@ -298,7 +303,10 @@ int main(int argc, char *argv[])
 	restrict_access_allow_coredumps(TRUE);
 
 	master_service_init_finish(master_service);
-	master_service_set_service_count(master_service, 1);
+	/* The process is not limited to a single script invocation: it stays
+	   around to serve up to service_count connections, so that bursts of
+	   invocations don't pay for a full service process restart each
+	   time. Only the script itself is forked per invocation. */
 
 	if (argv[0][0] == '/')
 		binary = argv[0];